@@ -16,6 +16,7 @@
 #include <unistd.h>
 
 #include "access/htup_details.h"
+#include "access/parallel.h"
 #include "access/reloptions.h"
 #include "access/sysattr.h"
 #include "access/table.h"
@@ -29,10 +30,15 @@
 #include "foreign/foreign.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
+#include "optimizer/paths.h"
 #include "optimizer/planmain.h"
 #include "optimizer/restrictinfo.h"
+#include "pgstat.h"
+#include "port/atomics.h"
+#include "storage/fd.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/sampling.h"
@@ -74,6 +80,9 @@ static const struct FileFdwOption valid_options[] = {
 	{"force_not_null", AttributeRelationId},
 	{"force_null", AttributeRelationId},
 
+	/* Scan options */
+	{"parallel", ForeignTableRelationId},
+
 	/*
 	 * force_quote is not supported by file_fdw because it's for COPY TO.
 	 */
@@ -82,6 +91,15 @@ static const struct FileFdwOption valid_options[] = {
 	{NULL, InvalidOid}
 };
 
+/*
+ * A parallel scan hands out the file in byte ranges of this many bytes,
+ * chosen so that each participant gets several ranges to balance the load,
+ * while keeping the per-range setup cost negligible.
+ */
+#define FILE_FDW_CHUNKS_PER_PARTICIPANT	16
+#define FILE_FDW_MIN_CHUNK_SIZE			(1024 * 1024)
+#define FILE_FDW_MAX_CHUNK_SIZE			(64 * 1024 * 1024)
+
 /*
  * FDW-specific information for RelOptInfo.fdw_private.
  */
@@ -89,12 +107,26 @@ typedef struct FileFdwPlanState
 {
 	char	   *filename;		/* file or program to read from */
 	bool		is_program;		/* true if filename represents an OS command */
-	List	   *options;		/* merged COPY options, excluding filename and
-								 * is_program */
+	bool		parallel;		/* may the file be split between workers? */
+	List	   *options;		/* merged COPY options, excluding filename,
+								 * is_program and parallel */
 	BlockNumber pages;			/* estimate of file's physical size */
 	double		ntuples;		/* estimate of number of data rows */
 } FileFdwPlanState;
 
+/*
+ * Shared state of a parallel scan.  Participants claim consecutive byte
+ * ranges of the file until it has all been handed out.  A range is scanned
+ * by whoever claimed it, starting at the first line that begins inside the
+ * range and ending with the line that straddles its end, if any.
+ */
+typedef struct FileFdwParallelState
+{
+	uint64		file_size;		/* size of the file when the scan started */
+	uint64		chunk_size;		/* bytes per range */
+	pg_atomic_uint64 next_offset;	/* start of the next unclaimed range */
+} FileFdwParallelState;
+
 /*
  * FDW-specific information for ForeignScanState.fdw_state.
  */
@@ -102,11 +134,28 @@ typedef struct FileFdwExecutionState
 {
 	char	   *filename;		/* file or program to read from */
 	bool		is_program;		/* true if filename represents an OS command */
-	List	   *options;		/* merged COPY options, excluding filename and
-								 * is_program */
+	List	   *options;		/* merged COPY options, excluding filename,
+								 * is_program and parallel */
 	CopyState	cstate;			/* COPY execution state */
+
+	/* for parallel-aware scans only */
+	bool		parallel;		/* is this a parallel-aware scan? */
+	FileFdwParallelState *pstate;	/* shared state, NULL if no workers */
+	List	   *chunk_options;	/* options, minus header, for later ranges */
+	File		file;			/* file being read range by range */
+	uint64		chunk_end;		/* end of the range being read */
+	uint64		read_pos;		/* offset of the next byte to hand to COPY */
+	bool		at_line_start;	/* was the last byte handed out a newline? */
+	bool		scan_done;		/* no more ranges to read */
 } FileFdwExecutionState;
 
+/*
+ * The scan whose current range the COPY data source callback reads from.
+ * COPY doesn't pass the callback any private state, so this is set before
+ * each call into the COPY code that may read data.
+ */
+static FileFdwExecutionState *current_chunk_scan = NULL;
+
 /*
  * SQL functions
  */
@@ -139,6 +188,17 @@ static bool fileAnalyzeForeignTable(Relation relation,
 									BlockNumber *totalpages);
 static bool fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 										  RangeTblEntry *rte);
+static Size fileEstimateDSMForeignScan(ForeignScanState *node,
+									   ParallelContext *pcxt);
+static void fileInitializeDSMForeignScan(ForeignScanState *node,
+										 ParallelContext *pcxt,
+										 void *coordinate);
+static void fileReInitializeDSMForeignScan(ForeignScanState *node,
+										   ParallelContext *pcxt,
+										   void *coordinate);
+static void fileInitializeWorkerForeignScan(ForeignScanState *node,
+											shm_toc *toc,
+											void *coordinate);
 
 /*
  * Helper functions
@@ -147,6 +207,7 @@ static bool is_valid_option(const char *option, Oid context);
 static void fileGetOptions(Oid foreigntableid,
 						   char **filename,
 						   bool *is_program,
+						   bool *parallel,
 						   List **other_options);
 static List *get_file_fdw_attribute_options(Oid relid);
 static bool check_selective_binary_conversion(RelOptInfo *baserel,
@@ -156,7 +217,13 @@ static void estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 						  FileFdwPlanState *fdw_private);
 static void estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 						   FileFdwPlanState *fdw_private,
+						   int parallel_workers,
 						   Cost *startup_cost, Cost *total_cost);
+static bool file_begin_chunk(ForeignScanState *node,
+							 FileFdwExecutionState *festate);
+static uint64 file_skip_partial_line(FileFdwExecutionState *festate,
+									 uint64 offset);
+static int	file_read_chunk(void *outbuf, int minread, int maxread);
 static int	file_acquire_sample_rows(Relation onerel, int elevel,
 									 HeapTuple *rows, int targrows,
 									 double *totalrows, double *totaldeadrows);
@@ -181,6 +248,10 @@ file_fdw_handler(PG_FUNCTION_ARGS)
 	fdwroutine->EndForeignScan = fileEndForeignScan;
 	fdwroutine->AnalyzeForeignTable = fileAnalyzeForeignTable;
 	fdwroutine->IsForeignScanParallelSafe = fileIsForeignScanParallelSafe;
+	fdwroutine->EstimateDSMForeignScan = fileEstimateDSMForeignScan;
+	fdwroutine->InitializeDSMForeignScan = fileInitializeDSMForeignScan;
+	fdwroutine->ReInitializeDSMForeignScan = fileReInitializeDSMForeignScan;
+	fdwroutine->InitializeWorkerForeignScan = fileInitializeWorkerForeignScan;
 
 	PG_RETURN_POINTER(fdwroutine);
 }
@@ -199,6 +270,7 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 	char	   *filename = NULL;
 	DefElem    *force_not_null = NULL;
 	DefElem    *force_null = NULL;
+	DefElem    *parallel = NULL;
 	List	   *other_options = NIL;
 	ListCell   *cell;
 
@@ -308,6 +380,16 @@ file_fdw_validator(PG_FUNCTION_ARGS)
 			force_null = def;
 			(void) defGetBoolean(def);
 		}
+		/* parallel is not a COPY option either; just check its value */
+		else if (strcmp(def->defname, "parallel") == 0)
+		{
+			if (parallel)
+				ereport(ERROR,
+						(errcode(ERRCODE_SYNTAX_ERROR),
+						 errmsg("conflicting or redundant options")));
+			parallel = def;
+			(void) defGetBoolean(def);
+		}
 		else
 			other_options = lappend(other_options, def);
 	}
@@ -349,12 +431,14 @@ is_valid_option(const char *option, Oid context)
 /*
  * Fetch the options for a file_fdw foreign table.
  *
- * We have to separate out filename/program from the other options because
- * those must not appear in the options list passed to the core COPY code.
+ * We have to separate out filename/program and parallel from the other
+ * options because those must not appear in the options list passed to the
+ * core COPY code.
  */
 static void
 fileGetOptions(Oid foreigntableid,
-			   char **filename, bool *is_program, List **other_options)
+			   char **filename, bool *is_program, bool *parallel,
+			   List **other_options)
 {
 	ForeignTable *table;
 	ForeignServer *server;
@@ -415,6 +499,22 @@ fileGetOptions(Oid foreigntableid,
 	if (*filename == NULL)
 		elog(ERROR, "either filename or program is required for file_fdw foreign tables");
 
+	/* Likewise separate out the parallel option, if present. */
+	*parallel = false;
+	prev = NULL;
+	foreach(lc, options)
+	{
+		DefElem    *def = (DefElem *) lfirst(lc);
+
+		if (strcmp(def->defname, "parallel") == 0)
+		{
+			*parallel = defGetBoolean(def);
+			options = list_delete_cell(options, lc, prev);
+			break;
+		}
+		prev = lc;
+	}
+
 	*other_options = options;
 }
 
@@ -515,6 +615,7 @@ fileGetForeignRelSize(PlannerInfo *root,
 	fileGetOptions(foreigntableid,
 				   &fdw_private->filename,
 				   &fdw_private->is_program,
+				   &fdw_private->parallel,
 				   &fdw_private->options);
 	baserel->fdw_private = (void *) fdw_private;
 
@@ -528,7 +629,8 @@ fileGetForeignRelSize(PlannerInfo *root,
  *
  *		Currently we don't support any push-down feature, so there is only one
  *		possible access path, which simply returns all records in the order in
- *		the data file.
+ *		the data file.  If the table allows it, we also offer a partial path
+ *		that splits the file between parallel workers.
  */
 static void
 fileGetForeignPaths(PlannerInfo *root,
@@ -549,7 +651,7 @@ fileGetForeignPaths(PlannerInfo *root,
 										  (Node *) columns, -1));
 
 	/* Estimate costs */
-	estimate_costs(root, baserel, fdw_private,
+	estimate_costs(root, baserel, fdw_private, 0,
 				   &startup_cost, &total_cost);
 
 	/*
@@ -577,6 +679,54 @@ fileGetForeignPaths(PlannerInfo *root,
 	 * appropriate pathkeys into the ForeignPath node to tell the planner
 	 * that.
 	 */
+
+	/*
+	 * Consider a parallel scan.  The file is split at line boundaries, so
+	 * this requires a plain file in text or CSV format whose records never
+	 * span lines; the user vouches for the latter by setting the parallel
+	 * option.
+	 */
+	if (fdw_private->parallel && !fdw_private->is_program &&
+		baserel->consider_parallel && baserel->lateral_relids == NULL)
+	{
+		ListCell   *lc;
+		bool		binary = false;
+		int			parallel_workers;
+
+		foreach(lc, fdw_private->options)
+		{
+			DefElem    *def = (DefElem *) lfirst(lc);
+
+			if (strcmp(def->defname, "format") == 0)
+				binary = (strcmp(defGetString(def), "binary") == 0);
+		}
+
+		parallel_workers = compute_parallel_worker(baserel,
+												   fdw_private->pages, -1,
+												   max_parallel_workers_per_gather);
+
+		if (!binary && parallel_workers > 0)
+		{
+			ForeignPath *path;
+
+			estimate_costs(root, baserel, fdw_private, parallel_workers,
+						   &startup_cost, &total_cost);
+
+			path = create_foreignscan_path(root, baserel,
+										   NULL,	/* default pathtarget */
+										   clamp_row_est(baserel->rows /
+														 get_parallel_divisor_workers(parallel_workers)),
+										   startup_cost,
+										   total_cost,
+										   NIL, /* no pathkeys */
+										   NULL,	/* no outer rel either */
+										   NULL,	/* no extra plan */
+										   coptions);
+			path->path.parallel_aware = true;
+			path->path.parallel_workers = parallel_workers;
+			add_partial_path(baserel, (Path *) path);
+		}
+	}
 }
 
 /*
@@ -623,11 +773,12 @@ fileExplainForeignScan(ForeignScanState *node, ExplainState *es)
 {
 	char	   *filename;
 	bool		is_program;
+	bool		parallel;
 	List	   *options;
 
 	/* Fetch options --- we only need filename and is_program at this point */
 	fileGetOptions(RelationGetRelid(node->ss.ss_currentRelation),
-				   &filename, &is_program, &options);
+				   &filename, &is_program, &parallel, &options);
 
 	if (is_program)
 		ExplainPropertyText("Foreign Program", filename, es);
@@ -656,8 +807,9 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	ForeignScan *plan = (ForeignScan *) node->ss.ps.plan;
 	char	   *filename;
 	bool		is_program;
+	bool		parallel;
 	List	   *options;
-	CopyState	cstate;
+	CopyState	cstate = NULL;
 	FileFdwExecutionState *festate;
 
 	/*
@@ -668,7 +820,7 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 
 	/* Fetch options of foreign table */
 	fileGetOptions(RelationGetRelid(node->ss.ss_currentRelation),
-				   &filename, &is_program, &options);
+				   &filename, &is_program, &parallel, &options);
 
 	/* Add any options from the plan (currently only convert_selectively) */
 	options = list_concat(options, plan->fdw_private);
@@ -676,24 +828,44 @@ fileBeginForeignScan(ForeignScanState *node, int eflags)
 	/*
 	 * Create CopyState from FDW options.  We always acquire all columns, so
 	 * as to match the expected ScanTupleSlot signature.
+	 *
+	 * A parallel-aware scan doesn't know yet which part of the file it will
+	 * read, so it creates a CopyState for each byte range it claims.
 	 */
-	cstate = BeginCopyFrom(NULL,
-						   node->ss.ss_currentRelation,
-						   filename,
-						   is_program,
-						   NULL,
-						   NIL,
-						   options);
+	if (!plan->scan.plan.parallel_aware)
+		cstate = BeginCopyFrom(NULL,
+							   node->ss.ss_currentRelation,
+							   filename,
+							   is_program,
+							   NULL,
+							   NIL,
+							   options);
 
 	/*
 	 * Save state in node->fdw_state.  We must save enough information to call
 	 * BeginCopyFrom() again.
 	 */
-	festate = (FileFdwExecutionState *) palloc(sizeof(FileFdwExecutionState));
+	festate = (FileFdwExecutionState *) palloc0(sizeof(FileFdwExecutionState));
 	festate->filename = filename;
 	festate->is_program = is_program;
 	festate->options = options;
 	festate->cstate = cstate;
+	festate->parallel = plan->scan.plan.parallel_aware;
+	festate->file = -1;
+
+	/* Only the first range of the file may start with a header line */
+	if (festate->parallel)
+	{
+		ListCell   *lc;
+
+		foreach(lc, options)
+		{
+			DefElem    *def = (DefElem *) lfirst(lc);
+
+			if (strcmp(def->defname, "header") != 0)
+				festate->chunk_options = lappend(festate->chunk_options, def);
+		}
+	}
 
 	node->fdw_state = (void *) festate;
 }
@@ -711,29 +883,50 @@ fileIterateForeignScan(ForeignScanState *node)
 	bool		found;
 	ErrorContextCallback errcallback;
 
-	/* Set up callback to identify error line number. */
-	errcallback.callback = CopyFromErrorCallback;
-	errcallback.arg = (void *) festate->cstate;
-	errcallback.previous = error_context_stack;
-	error_context_stack = &errcallback;
-
 	/*
 	 * The protocol for loading a virtual tuple into a slot is first
 	 * ExecClearTuple, then fill the values/isnull arrays, then
 	 * ExecStoreVirtualTuple.  If we don't find another row in the file, we
 	 * just skip the last step, leaving the slot empty as required.
-	 *
-	 * We can pass ExprContext = NULL because we read all columns from the
-	 * file, so no need to evaluate default expressions.
 	 */
 	ExecClearTuple(slot);
-	found = NextCopyFrom(festate->cstate, NULL,
-						 slot->tts_values, slot->tts_isnull);
-	if (found)
-		ExecStoreVirtualTuple(slot);
 
-	/* Remove error callback. */
-	error_context_stack = errcallback.previous;
+	for (;;)
+	{
+		/* In a parallel scan, claim a range of the file if we need one */
+		if (festate->cstate == NULL && !file_begin_chunk(node, festate))
+			break;
+
+		/* Set up callback to identify error line number. */
+		errcallback.callback = CopyFromErrorCallback;
+		errcallback.arg = (void *) festate->cstate;
+		errcallback.previous = error_context_stack;
+		error_context_stack = &errcallback;
+
+		/*
+		 * We can pass ExprContext = NULL because we read all columns from the
+		 * file, so no need to evaluate default expressions.
+		 */
+		current_chunk_scan = festate;
+		found = NextCopyFrom(festate->cstate, NULL,
+							 slot->tts_values, slot->tts_isnull);
+
+		/* Remove error callback. */
+		error_context_stack = errcallback.previous;
+
+		if (found)
+		{
+			ExecStoreVirtualTuple(slot);
+			break;
+		}
+
+		if (!festate->parallel)
+			break;
+
+		/* This range is exhausted; move on to the next one. */
+		EndCopyFrom(festate->cstate);
+		festate->cstate = NULL;
+	}
 
 	return slot;
 }
@@ -747,6 +940,19 @@ fileReScanForeignScan(ForeignScanState *node)
 {
 	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
 
+	/*
+	 * A parallel-aware scan starts over by claiming ranges again, once
+	 * fileReInitializeDSMForeignScan has reset the shared state.
+	 */
+	if (festate->parallel)
+	{
+		if (festate->cstate)
+			EndCopyFrom(festate->cstate);
+		festate->cstate = NULL;
+		festate->scan_done = false;
+		return;
+	}
+
 	EndCopyFrom(festate->cstate);
 
 	festate->cstate = BeginCopyFrom(NULL,
@@ -768,8 +974,13 @@ fileEndForeignScan(ForeignScanState *node)
 	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
 
 	/* if festate is NULL, we are in EXPLAIN; nothing to do */
-	if (festate)
+	if (festate == NULL)
+		return;
+
+	if (festate->cstate)
 		EndCopyFrom(festate->cstate);
+	if (festate->file >= 0)
+		FileClose(festate->file);
 }
 
 /*
@@ -783,11 +994,13 @@ fileAnalyzeForeignTable(Relation relation,
 {
 	char	   *filename;
 	bool		is_program;
+	bool		parallel;
 	List	   *options;
 	struct stat stat_buf;
 
 	/* Fetch options of foreign table */
-	fileGetOptions(RelationGetRelid(relation), &filename, &is_program, &options);
+	fileGetOptions(RelationGetRelid(relation), &filename, &is_program,
+				   &parallel, &options);
 
 	/*
 	 * If this is a program instead of a file, just return false to skip
@@ -834,6 +1047,251 @@ fileIsForeignScanParallelSafe(PlannerInfo *root, RelOptInfo *rel,
 	return true;
 }
 
+/*
+ * fileEstimateDSMForeignScan
+ *		Report the size of the shared state of a parallel scan
+ */
+static Size
+fileEstimateDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt)
+{
+	return sizeof(FileFdwParallelState);
+}
+
+/*
+ * fileInitializeDSMForeignScan
+ *		Set up the shared state of a parallel scan
+ */
+static void
+fileInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							 void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+	struct stat stat_buf;
+	uint64		chunk_size;
+
+	if (stat(festate->filename, &stat_buf) < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not stat file \"%s\": %m",
+						festate->filename)));
+
+	chunk_size = (uint64) stat_buf.st_size /
+		(FILE_FDW_CHUNKS_PER_PARTICIPANT * (pcxt->nworkers + 1));
+	chunk_size = Max(chunk_size, FILE_FDW_MIN_CHUNK_SIZE);
+	chunk_size = Min(chunk_size, FILE_FDW_MAX_CHUNK_SIZE);
+
+	pstate->file_size = (uint64) stat_buf.st_size;
+	pstate->chunk_size = chunk_size;
+	pg_atomic_init_u64(&pstate->next_offset, 0);
+
+	festate->pstate = pstate;
+}
+
+/*
+ * fileReInitializeDSMForeignScan
+ *		Reset the shared state of a parallel scan before a rescan
+ */
+static void
+fileReInitializeDSMForeignScan(ForeignScanState *node, ParallelContext *pcxt,
+							   void *coordinate)
+{
+	FileFdwParallelState *pstate = (FileFdwParallelState *) coordinate;
+
+	pg_atomic_write_u64(&pstate->next_offset, 0);
+}
+
+/*
+ * fileInitializeWorkerForeignScan
+ *		Attach a parallel worker to the shared state of a parallel scan
+ */
+static void
+fileInitializeWorkerForeignScan(ForeignScanState *node, shm_toc *toc,
+								void *coordinate)
+{
+	FileFdwExecutionState *festate = (FileFdwExecutionState *) node->fdw_state;
+
+	festate->pstate = (FileFdwParallelState *) coordinate;
+}
+
+/*
+ * file_begin_chunk
+ *		Claim the next range of the file for a parallel-aware scan, and set
+ *		up a CopyState reading it.  Returns false if there's nothing left.
+ *
+ * If the plan is run without workers, there is no shared state, and the
+ * whole file is read as a single range.
+ */
+static bool
+file_begin_chunk(ForeignScanState *node, FileFdwExecutionState *festate)
+{
+	FileFdwParallelState *pstate = festate->pstate;
+	List	   *options = festate->options;
+	MemoryContext oldcontext;
+	uint64		start;
+
+	Assert(festate->parallel && festate->cstate == NULL);
+
+	if (festate->scan_done)
+		return false;
+
+	/*
+	 * We're called from the per-tuple context, but the CopyState must live
+	 * until the range is exhausted.
+	 */
+	oldcontext = MemoryContextSwitchTo(node->ss.ps.state->es_query_cxt);
+
+	if (pstate == NULL)
+	{
+		festate->cstate = BeginCopyFrom(NULL,
+										node->ss.ss_currentRelation,
+										festate->filename,
+										false,
+										NULL,
+										NIL,
+										festate->options);
+		festate->scan_done = true;
+		MemoryContextSwitchTo(oldcontext);
+		return true;
+	}
+
+	start = pg_atomic_fetch_add_u64(&pstate->next_offset, pstate->chunk_size);
+	if (start >= pstate->file_size)
+	{
+		festate->scan_done = true;
+		MemoryContextSwitchTo(oldcontext);
+		return false;
+	}
+
+	if (festate->file < 0)
+	{
+		festate->file = PathNameOpenFile(festate->filename,
+										 O_RDONLY | PG_BINARY);
+		if (festate->file < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not open file \"%s\" for reading: %m",
+							festate->filename)));
+	}
+
+	festate->chunk_end = Min(start + pstate->chunk_size, pstate->file_size);
+	festate->at_line_start = true;
+
+	/*
+	 * A line belongs to the range its first byte is in, so skip over the
+	 * tail of a line that began in the previous range.  Such a line can't be
+	 * the header either.
+	 */
+	if (start > 0)
+	{
+		festate->read_pos = file_skip_partial_line(festate, start);
+		options = festate->chunk_options;
+	}
+	else
+		festate->read_pos = 0;
+
+	current_chunk_scan = festate;
+	festate->cstate = BeginCopyFrom(NULL,
+									node->ss.ss_currentRelation,
+									NULL,
+									false,
+									file_read_chunk,
+									NIL,
+									options);
+	MemoryContextSwitchTo(oldcontext);
+	return true;
+}
+
+/*
+ * file_skip_partial_line
+ *		Return the offset of the first line starting at or after offset
+ */
+static uint64
+file_skip_partial_line(FileFdwExecutionState *festate, uint64 offset)
+{
+	char		buf[1024];
+	uint64		pos = offset - 1;
+
+	for (;;)
+	{
+		int			nread;
+		char	   *nl;
+
+		nread = FileRead(festate->file, buf, sizeof(buf), (off_t) pos,
+						 WAIT_EVENT_COPY_FILE_READ);
+		if (nread < 0)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from file \"%s\": %m",
+							festate->filename)));
+		if (nread == 0)
+			return pos;			/* no more lines in the file */
+
+		nl = memchr(buf, '\n', nread);
+		if (nl != NULL)
+			return pos + (nl - buf) + 1;
+		pos += nread;
+	}
+}
+
+/*
+ * file_read_chunk
+ *		COPY data source callback for a parallel-aware scan
+ *
+ * Hands out the bytes of the current range, followed by the rest of the line
+ * that straddles the end of the range.  Returns 0 at the end of that.
+ */
+static int
+file_read_chunk(void *outbuf, int minread, int maxread)
+{
+	FileFdwExecutionState *festate = current_chunk_scan;
+	bool		past_end = (festate->read_pos >= festate->chunk_end);
+	int			nread;
+
+	Assert(festate != NULL && festate->file >= 0);
+
+	/* Past the end of the range, only finish the line in progress. */
+	if (past_end && festate->at_line_start)
+		return 0;
+
+	if (!past_end)
+		maxread = (int) Min((uint64) maxread,
+							festate->chunk_end - festate->read_pos);
+
+	nread = FileRead(festate->file, outbuf, maxread,
+					 (off_t) festate->read_pos, WAIT_EVENT_COPY_FILE_READ);
+	if (nread < 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from file \"%s\": %m",
+						festate->filename)));
+
+	if (nread == 0)
+	{
+		/* The file ended early; there's nothing more to read. */
+		festate->at_line_start = true;
+		festate->read_pos = festate->chunk_end;
+		return 0;
+	}
+
+	if (past_end)
+	{
+		char	   *nl = memchr(outbuf, '\n', nread);
+
+		if (nl != NULL)
+		{
+			nread = nl - (char *) outbuf + 1;
+			festate->at_line_start = true;
+		}
+	}
+	else
+		festate->at_line_start = (((char *) outbuf)[nread - 1] == '\n');
+
+	festate->read_pos += nread;
+
+	return nread;
+}
+
 /*
  * check_selective_binary_conversion
  *
@@ -1046,16 +1504,22 @@ estimate_size(PlannerInfo *root, RelOptInfo *baserel,
 /*
  * Estimate costs of scanning a foreign table.
  *
+ * If parallel_workers is more than zero, estimate the cost of a partial scan
+ * that each of that many workers, and the leader, perform on their share of
+ * the file.
+ *
  * Results are returned in *startup_cost and *total_cost.
  */
 static void
 estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 			   FileFdwPlanState *fdw_private,
+			   int parallel_workers,
 			   Cost *startup_cost, Cost *total_cost)
 {
 	BlockNumber pages = fdw_private->pages;
 	double		ntuples = fdw_private->ntuples;
 	Cost		run_cost = 0;
+	Cost		cpu_run_cost;
 	Cost		cpu_per_tuple;
 
 	/*
@@ -1073,7 +1537,17 @@ estimate_costs(PlannerInfo *root, RelOptInfo *baserel,
 
 	*startup_cost = baserel->baserestrictcost.startup;
 	cpu_per_tuple = cpu_tuple_cost * 10 + baserel->baserestrictcost.per_tuple;
-	run_cost += cpu_per_tuple * ntuples;
+	cpu_run_cost = cpu_per_tuple * ntuples;
+
+	/*
+	 * As in cost_seqscan(), parsing is divided among the participants of a
+	 * parallel scan, but the I/O is not, since the disk is assumed to be
+	 * the bottleneck.
+	 */
+	if (parallel_workers > 0)
+		cpu_run_cost /= get_parallel_divisor_workers(parallel_workers);
+
+	run_cost += cpu_run_cost;
 	*total_cost = *startup_cost + run_cost;
 }
 
@@ -1105,6 +1579,7 @@ file_acquire_sample_rows(Relation onerel, int elevel,
 	bool		found;
 	char	   *filename;
 	bool		is_program;
+	bool		parallel;
 	List	   *options;
 	CopyState	cstate;
 	ErrorContextCallback errcallback;
@@ -1119,7 +1594,8 @@ file_acquire_sample_rows(Relation onerel, int elevel,
 	nulls = (bool *) palloc(tupDesc->natts * sizeof(bool));
 
 	/* Fetch options of foreign table */
-	fileGetOptions(RelationGetRelid(onerel), &filename, &is_program, &options);
+	fileGetOptions(RelationGetRelid(onerel), &filename, &is_program,
+				   &parallel, &options);
 
 	/*
 	 * Create CopyState from FDW options.
@@ -10,11 +10,15 @@
  *		and we need to lock the relations so that we don't try to prewarm
  *		pages from a relation that is in the process of being dropped.
  *
- *		While prewarming, autoprewarm will use two workers.  There's a
- *		master worker that reads and sorts the list of blocks to be
- *		prewarmed and then launches a per-database worker for each
- *		relevant database in turn.  The former keeps running after the
- *		initial prewarm is complete to update the dump file periodically.
+ *		While prewarming, there's a master worker that reads and sorts the
+ *		list of blocks to be prewarmed and then launches a group of
+ *		per-database workers for each relevant database in turn.  The
+ *		workers of a group claim batches of blocks from a shared cursor,
+ *		issuing read-ahead requests for each batch, so that several reads
+ *		are in flight at once; within each database, the blocks that had
+ *		the highest usage count when they were dumped are loaded first.
+ *		The master worker keeps running after the initial prewarm is
+ *		complete to update the dump file periodically.
  *
  *	Copyright (c) 2016-2019, PostgreSQL Global Development Group
  *
@@ -34,7 +38,9 @@
 #include "catalog/pg_type.h"
 #include "miscadmin.h"
 #include "pgstat.h"
+#include "port/atomics.h"
 #include "postmaster/bgworker.h"
+#include "postmaster/postmaster.h"
 #include "storage/buf_internals.h"
 #include "storage/dsm.h"
 #include "storage/ipc.h"
@@ -54,6 +60,9 @@
 
 #define AUTOPREWARM_FILE "autoprewarm.blocks"
 
+/* Number of blocks a per-database worker claims at a time. */
+#define AUTOPREWARM_BATCH_SIZE 64
+
 /* Metadata for each block we dump. */
 typedef struct BlockInfoRecord
 {
@@ -62,6 +71,7 @@ typedef struct BlockInfoRecord
 	Oid			filenode;
 	ForkNumber	forknum;
 	BlockNumber blocknum;
+	uint32		usage_count;	/* buffer usage count at dump time */
 } BlockInfoRecord;
 
 /* Shared state information for autoprewarm bgworker. */
@@ -71,12 +81,13 @@ typedef struct AutoPrewarmSharedState
 	pid_t		bgworker_pid;	/* for main bgworker */
 	pid_t		pid_using_dumpfile; /* for autoprewarm or block dump */
 
-	/* Following items are for communication with per-database worker */
+	/* Following items are for communication with per-database workers */
 	dsm_handle	block_info_handle;
 	Oid			database;
 	int			prewarm_start_idx;
 	int			prewarm_stop_idx;
-	int			prewarmed_blocks;
+	pg_atomic_uint32 prewarm_next_idx;	/* next block for a worker to claim */
+	pg_atomic_uint32 prewarmed_blocks;
 } AutoPrewarmSharedState;
 
 void		_PG_init(void);
@@ -89,7 +100,9 @@ PG_FUNCTION_INFO_V1(autoprewarm_dump_now);
 static void apw_load_buffers(void);
 static int	apw_dump_now(bool is_bgworker, bool dump_unlogged);
 static void apw_start_master_worker(void);
-static void apw_start_database_worker(void);
+static void apw_start_database_workers(int nworkers);
+static int	apw_prefetch_blocks(Relation rel, BlockInfoRecord *block_info,
+								int pos, int end, BlockNumber nblocks);
 static bool apw_init_shmem(void);
 static void apw_detach_shmem(int code, Datum arg);
 static int	apw_compare_blockinfo(const void *p, const void *q);
@@ -106,6 +119,7 @@ static AutoPrewarmSharedState *apw_state = NULL;
 /* GUC variables. */
 static bool autoprewarm = true; /* start worker? */
 static int	autoprewarm_interval;	/* dump interval */
+static int	autoprewarm_workers;	/* workers per database */
 
 /*
  * Module load callback.
@@ -125,6 +139,18 @@ _PG_init(void)
 							NULL,
 							NULL);
 
+	DefineCustomIntVariable("pg_prewarm.autoprewarm_workers",
+							"Sets the number of workers that prewarm each database",
+							NULL,
+							&autoprewarm_workers,
+							4,
+							1, MAX_BACKENDS,
+							PGC_SIGHUP,
+							0,
+							NULL,
+							NULL,
+							NULL);
+
 	if (!process_shared_preload_libraries_in_progress)
 		return;
 
@@ -269,8 +295,8 @@ autoprewarm_main(Datum main_arg)
 }
 
 /*
- * Read the dump file and launch per-database workers one at a time to
- * prewarm the buffers found there.
+ * Read the dump file and launch per-database workers, one database at a
+ * time, to prewarm the buffers found there.
  */
 static void
 apw_load_buffers(void)
@@ -329,18 +355,25 @@ apw_load_buffers(void)
 	seg = dsm_create(sizeof(BlockInfoRecord) * num_elements, 0);
 	blkinfo = (BlockInfoRecord *) dsm_segment_address(seg);
 
-	/* Read records, one per line. */
+	/*
+	 * Read records, one per line.  Files written before usage counts were
+	 * recorded lack the last field; treat all their blocks as equally hot.
+	 */
 	for (i = 0; i < num_elements; i++)
 	{
+		char		line[128];
 		unsigned	forknum;
+		unsigned	usage_count = 0;
 
-		if (fscanf(file, "%u,%u,%u,%u,%u\n", &blkinfo[i].database,
+		if (fgets(line, sizeof(line), file) == NULL ||
+			sscanf(line, "%u,%u,%u,%u,%u,%u", &blkinfo[i].database,
 				   &blkinfo[i].tablespace, &blkinfo[i].filenode,
-				   &forknum, &blkinfo[i].blocknum) != 5)
+				   &forknum, &blkinfo[i].blocknum, &usage_count) < 5)
 			ereport(ERROR,
 					(errmsg("autoprewarm block dump file is corrupted at line %d",
 							i + 1)));
 		blkinfo[i].forknum = forknum;
+		blkinfo[i].usage_count = usage_count;
 	}
 
 	FreeFile(file);
@@ -352,7 +385,7 @@ apw_load_buffers(void)
 	/* Populate shared memory state. */
 	apw_state->block_info_handle = dsm_segment_handle(seg);
 	apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx = 0;
-	apw_state->prewarmed_blocks = 0;
+	pg_atomic_write_u32(&apw_state->prewarmed_blocks, 0);
 
 	/* Get the info position of the first block of the next database. */
 	while (apw_state->prewarm_start_idx < num_elements)
@@ -389,9 +422,11 @@ apw_load_buffers(void)
 		if (current_db == InvalidOid)
 			break;
 
-		/* Configure stop point and database for next per-database worker. */
+		/* Configure range and database for next per-database workers. */
 		apw_state->prewarm_stop_idx = j;
 		apw_state->database = current_db;
+		pg_atomic_write_u32(&apw_state->prewarm_next_idx,
+							apw_state->prewarm_start_idx);
 		Assert(apw_state->prewarm_start_idx < apw_state->prewarm_stop_idx);
 
 		/* If we've run out of free buffers, don't launch another worker. */
@@ -406,10 +441,15 @@ apw_load_buffers(void)
 			break;
 
 		/*
-		 * Start a per-database worker to load blocks for this database; this
-		 * function will return once the per-database worker exits.
+		 * Start per-database workers to load blocks for this database; this
+		 * function will return once all of them have exited.  Don't start
+		 * more workers than there are batches to hand out.
 		 */
-		apw_start_database_worker();
+		apw_start_database_workers(Min(autoprewarm_workers,
+									   (apw_state->prewarm_stop_idx -
+										apw_state->prewarm_start_idx +
+										AUTOPREWARM_BATCH_SIZE - 1) /
+									   AUTOPREWARM_BATCH_SIZE));
 
 		/* Prepare for next database. */
 		apw_state->prewarm_start_idx = apw_state->prewarm_stop_idx;
@@ -426,17 +466,22 @@ apw_load_buffers(void)
 	if (!got_sigterm)
 		ereport(LOG,
 				(errmsg("autoprewarm successfully prewarmed %d of %d previously-loaded blocks",
-						apw_state->prewarmed_blocks, num_elements)));
+						(int) pg_atomic_read_u32(&apw_state->prewarmed_blocks),
+						num_elements)));
 }
 
 /*
- * Prewarm all blocks for one database (and possibly also global objects, if
- * those got grouped with this database).
+ * Prewarm blocks for one database (and possibly also global objects, if
+ * those got grouped with this database), together with the other workers
+ * launched for it.  Each worker repeatedly claims the next batch of blocks,
+ * so all of them work their way down from the hottest blocks at once.
  */
 void
 autoprewarm_database_main(Datum main_arg)
 {
-	int			pos;
+	int			pos = 0;
+	int			end = 0;
+	int			prefetch_pos = 0;
 	BlockInfoRecord *block_info;
 	Relation	rel = NULL;
 	BlockNumber nblocks = 0;
@@ -456,19 +501,31 @@ autoprewarm_database_main(Datum main_arg)
 				 errmsg("could not map dynamic shared memory segment")));
 	BackgroundWorkerInitializeConnectionByOid(apw_state->database, InvalidOid, 0);
 	block_info = (BlockInfoRecord *) dsm_segment_address(seg);
-	pos = apw_state->prewarm_start_idx;
 
 	/*
 	 * Loop until we run out of blocks to prewarm or until we run out of free
 	 * buffers.
 	 */
-	while (pos < apw_state->prewarm_stop_idx && have_free_buffer())
+	while (have_free_buffer())
 	{
-		BlockInfoRecord *blk = &block_info[pos++];
+		BlockInfoRecord *blk;
 		Buffer		buf;
 
 		CHECK_FOR_INTERRUPTS();
 
+		/* Claim another batch once we're through with the current one. */
+		if (pos >= end)
+		{
+			pos = (int) pg_atomic_fetch_add_u32(&apw_state->prewarm_next_idx,
+												AUTOPREWARM_BATCH_SIZE);
+			if (pos >= apw_state->prewarm_stop_idx)
+				break;
+			end = Min(pos + AUTOPREWARM_BATCH_SIZE,
+					  apw_state->prewarm_stop_idx);
+			prefetch_pos = pos;
+		}
+		blk = &block_info[pos++];
+
 		/*
 		 * Quit if we've reached records for another database. If previous
 		 * blocks are of some global objects, then continue pre-warming.
@@ -540,12 +597,21 @@ autoprewarm_database_main(Datum main_arg)
 			continue;
 		}
 
+		/*
+		 * Ask the kernel to start reading this block and the following ones
+		 * of the same fork in our batch, so that they are on their way while
+		 * we read them one at a time.
+		 */
+		if (prefetch_pos < pos)
+			prefetch_pos = apw_prefetch_blocks(rel, block_info, pos - 1, end,
+											   nblocks);
+
 		/* Prewarm buffer. */
 		buf = ReadBufferExtended(rel, blk->forknum, blk->blocknum, RBM_NORMAL,
 								 NULL);
 		if (BufferIsValid(buf))
 		{
-			apw_state->prewarmed_blocks++;
+			pg_atomic_fetch_add_u32(&apw_state->prewarmed_blocks, 1);
 			ReleaseBuffer(buf);
 		}
 
@@ -562,6 +628,35 @@ autoprewarm_database_main(Datum main_arg)
 	}
 }
 
+/*
+ * Issue read-ahead requests for the block at position pos and the blocks
+ * following it up to end that belong to the same relation fork, skipping
+ * any beyond the end of the fork.  Returns the position of the first block
+ * not covered.
+ */
+static int
+apw_prefetch_blocks(Relation rel, BlockInfoRecord *block_info, int pos,
+					int end, BlockNumber nblocks)
+{
+	BlockInfoRecord *first = &block_info[pos];
+
+	for (; pos < end; pos++)
+	{
+		BlockInfoRecord *blk = &block_info[pos];
+
+		if (blk->database != first->database ||
+			blk->tablespace != first->tablespace ||
+			blk->filenode != first->filenode ||
+			blk->forknum != first->forknum)
+			break;
+
+		if (blk->blocknum < nblocks)
+			PrefetchBuffer(rel, blk->forknum, blk->blocknum);
+	}
+
+	return pos;
+}
+
 /*
  * Dump information on blocks in shared buffers.  We use a text format here
  * so that it's easy to understand and even change the file contents if
@@ -626,6 +721,8 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 			block_info_array[num_blocks].filenode = bufHdr->tag.rnode.relNode;
 			block_info_array[num_blocks].forknum = bufHdr->tag.forkNum;
 			block_info_array[num_blocks].blocknum = bufHdr->tag.blockNum;
+			block_info_array[num_blocks].usage_count =
+				BUF_STATE_GET_USAGECOUNT(buf_state);
 			++num_blocks;
 		}
 
@@ -658,12 +755,13 @@ apw_dump_now(bool is_bgworker, bool dump_unlogged)
 	{
 		CHECK_FOR_INTERRUPTS();
 
-		ret = fprintf(file, "%u,%u,%u,%u,%u\n",
+		ret = fprintf(file, "%u,%u,%u,%u,%u,%u\n",
 					  block_info_array[i].database,
 					  block_info_array[i].tablespace,
 					  block_info_array[i].filenode,
 					  (uint32) block_info_array[i].forknum,
-					  block_info_array[i].blocknum);
+					  block_info_array[i].blocknum,
+					  block_info_array[i].usage_count);
 		if (ret < 0)
 		{
 			int			save_errno = errno;
@@ -776,6 +874,8 @@ apw_init_shmem(void)
 		LWLockInitialize(&apw_state->lock, LWLockNewTrancheId());
 		apw_state->bgworker_pid = InvalidPid;
 		apw_state->pid_using_dumpfile = InvalidPid;
+		pg_atomic_init_u32(&apw_state->prewarm_next_idx, 0);
+		pg_atomic_init_u32(&apw_state->prewarmed_blocks, 0);
 	}
 	LWLockRelease(AddinShmemInitLock);
 
@@ -841,13 +941,16 @@ apw_start_master_worker(void)
 }
 
 /*
- * Start autoprewarm per-database worker process.
+ * Start up to nworkers autoprewarm per-database worker processes, and wait
+ * for them to exit.  It's enough if at least one of them can be started.
  */
 static void
-apw_start_database_worker(void)
+apw_start_database_workers(int nworkers)
 {
 	BackgroundWorker worker;
-	BackgroundWorkerHandle *handle;
+	BackgroundWorkerHandle **handles;
+	int			nregistered = 0;
+	int			i;
 
 	MemSet(&worker, 0, sizeof(BackgroundWorker));
 	worker.bgw_flags =
@@ -862,17 +965,29 @@ apw_start_database_worker(void)
 	/* must set notify PID to wait for shutdown */
 	worker.bgw_notify_pid = MyProcPid;
 
-	if (!RegisterDynamicBackgroundWorker(&worker, &handle))
+	handles = (BackgroundWorkerHandle **)
+		palloc(sizeof(BackgroundWorkerHandle *) * nworkers);
+	for (i = 0; i < nworkers; i++)
+	{
+		if (!RegisterDynamicBackgroundWorker(&worker, &handles[nregistered]))
+			break;
+		nregistered++;
+	}
+
+	if (nregistered == 0)
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_RESOURCES),
 				 errmsg("registering dynamic bgworker autoprewarm failed"),
 				 errhint("Consider increasing configuration parameter \"max_worker_processes\".")));
 
 	/*
-	 * Ignore return value; if it fails, postmaster has died, but we have
+	 * Ignore return values; if it fails, postmaster has died, but we have
 	 * checks for that elsewhere.
 	 */
-	WaitForBackgroundWorkerShutdown(handle);
+	for (i = 0; i < nregistered; i++)
+		WaitForBackgroundWorkerShutdown(handles[i]);
+
+	pfree(handles);
 }
 
 /* Compare member elements to check whether they are not equal. */
@@ -889,9 +1004,11 @@ do { \
  *
  * We depend on all records for a particular database being consecutive
  * in the dump file; each per-database worker will preload blocks until
- * it sees a block for some other database.  Sorting by tablespace,
- * filenode, forknum, and blocknum isn't critical for correctness, but
- * helps us get a sequential I/O pattern.
+ * it sees a block for some other database.  Within a database, blocks
+ * with a higher usage count come first, so that the hottest part of the
+ * working set is back soonest.  Sorting by tablespace, filenode, forknum,
+ * and blocknum isn't critical for correctness, but helps us get a
+ * sequential I/O pattern.
  */
 static int
 apw_compare_blockinfo(const void *p, const void *q)
@@ -900,6 +1017,13 @@ apw_compare_blockinfo(const void *p, const void *q)
 	const BlockInfoRecord *b = (const BlockInfoRecord *) q;
 
 	cmp_member_elem(database);
+
+	/* Hotter blocks first */
+	if (a->usage_count > b->usage_count)
+		return -1;
+	else if (a->usage_count < b->usage_count)
+		return 1;
+
 	cmp_member_elem(tablespace);
 	cmp_member_elem(filenode);
 	cmp_member_elem(forknum);
@@ -38,6 +38,9 @@ typedef enum
 
 static PGAlignedBlock blockbuffer;
 
+/* How far ahead of its reads buffer mode keeps read-ahead requests. */
+#define PREWARM_READAHEAD_BLOCKS	64
+
 /*
  * pg_prewarm(regclass, mode text, fork text,
  *			  first_block int8, last_block int8)
@@ -186,12 +189,24 @@ pg_prewarm(PG_FUNCTION_ARGS)
 	{
 		/*
 		 * In buffer mode, we actually pull the data into shared_buffers.
+		 * Where supported, we also keep the OS reading a window of blocks
+		 * ahead of us, so that the synchronous reads mostly find their data
+		 * already on its way.
 		 */
+#ifdef USE_PREFETCH
+		int64		prefetch_block = first_block;
+#endif
+
 		for (block = first_block; block <= last_block; ++block)
 		{
 			Buffer		buf;
 
 			CHECK_FOR_INTERRUPTS();
+#ifdef USE_PREFETCH
+			while (prefetch_block <= last_block &&
+				   prefetch_block < block + PREWARM_READAHEAD_BLOCKS)
+				PrefetchBuffer(rel, forkNumber, prefetch_block++);
+#endif
 			buf = ReadBufferExtended(rel, forkNumber, block, RBM_NORMAL, NULL);
 			ReleaseBuffer(buf);
 			++blocks_done;
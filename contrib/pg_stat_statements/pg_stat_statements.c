@@ -33,12 +33,22 @@
  * these strings in a temporary external query-texts file.  Offsets into this
  * file are kept in shared memory.
  *
+ * Besides the totals, each entry keeps a log-linear histogram of execution
+ * times, and optionally the execution time broken down by what the backend
+ * was waiting on, as estimated by sampling its wait event on a timer.  When
+ * pg_stat_statements.track_planid is on, entries are further separated by a
+ * hash of the shape of the executed plan, so that a change of plan for a
+ * query shows up as a new entry.
+ *
  * Note about locking issues: to create or delete an entry in the shared
  * hashtable, one must hold pgss->lock exclusively.  Modifying any field
  * in an entry except the counters requires the same.  To look up an entry,
  * one must hold the lock shared.  To read or update the counters within
  * an entry, one must hold the lock shared or exclusive (so the entry doesn't
- * disappear!) and also take the entry's mutex spinlock.
+ * disappear!).  The counters are atomic variables updated without any
+ * further locking, so backends executing the same statement don't contend
+ * on the entry; a reader may see the counters of a concurrent update only
+ * partially applied, which we accept for statistics.
  * The shared state variable pgss->extent (the next free spot in the external
  * query-text file) should be accessed only while holding either the
  * pgss->mutex spinlock, or exclusive lock on pgss->lock.  We use the mutex to
@@ -57,6 +67,7 @@
  */
 #include "postgres.h"
 
+#include <float.h>
 #include <math.h>
 #include <sys/stat.h>
 #include <unistd.h>
@@ -71,14 +82,20 @@
 #include "parser/scanner.h"
 #include "parser/scansup.h"
 #include "pgstat.h"
+#include "port/atomics.h"
+#include "port/pg_bitutils.h"
 #include "storage/fd.h"
 #include "storage/ipc.h"
+#include "storage/proc.h"
 #include "storage/spin.h"
 #include "tcop/utility.h"
 #include "utils/acl.h"
 #include "utils/builtins.h"
+#include "utils/float.h"
 #include "utils/hashutils.h"
 #include "utils/memutils.h"
+#include "utils/timeout.h"
+#include "utils/timestamp.h"
 
 PG_MODULE_MAGIC;
 
@@ -86,17 +103,14 @@ PG_MODULE_MAGIC;
 #define PGSS_DUMP_FILE	PGSTAT_STAT_PERMANENT_DIRECTORY "/pg_stat_statements.stat"
 
 /*
- * Location of external query text file.  We don't keep it in the core
- * system's stats_temp_directory.  The core system can safely use that GUC
- * setting, because the statistics collector temp file paths are set only once
- * as part of changing the GUC, but pg_stat_statements has no way of avoiding
- * race conditions.  Besides, we only expect modest, infrequent I/O for query
- * strings, so placing the file on a faster filesystem is not compelling.
+ * Location of external query text file.  We only expect modest, infrequent
+ * I/O for query strings, so placing the file on a faster filesystem is not
+ * compelling.
  */
 #define PGSS_TEXT_FILE	PG_STAT_TMP_DIR "/pgss_query_texts.stat"
 
 /* Magic number identifying the stats file format */
-static const uint32 PGSS_FILE_HEADER = 0x20171004;
+static const uint32 PGSS_FILE_HEADER = 0x20261017;
 
 /* PostgreSQL major version number, changes in which invalidate all entries */
 static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
@@ -112,6 +126,35 @@ static const uint32 PGSS_PG_MAJOR_VERSION = PG_VERSION_NUM / 100;
 
 #define JUMBLE_SIZE				1024	/* query serialization buffer size */
 
+/*
+ * Execution time histogram.  Bucket 0 counts executions faster than
+ * 2^PGSS_HIST_MIN_EXP microseconds, and the last bucket those of at least
+ * 2^PGSS_HIST_MAX_EXP microseconds (about 9.5 hours).  In between, each
+ * power of two is split into 2^PGSS_HIST_SUB_BITS equally wide buckets, which
+ * bounds the relative error of a bucket at 50% while keeping the histogram
+ * small enough to store in every entry.
+ */
+#define PGSS_HIST_MIN_EXP		4
+#define PGSS_HIST_MAX_EXP		35
+#define PGSS_HIST_SUB_BITS		1
+#define PGSS_HIST_BUCKETS \
+	(2 + ((PGSS_HIST_MAX_EXP - PGSS_HIST_MIN_EXP) << PGSS_HIST_SUB_BITS))
+
+/*
+ * Classes of wait events that sampled execution time is attributed to.
+ */
+typedef enum pgssWaitClass
+{
+	PGSS_WAIT_CPU = 0,			/* not waiting at all */
+	PGSS_WAIT_LOCK,				/* heavyweight locks and buffer pins */
+	PGSS_WAIT_LWLOCK,
+	PGSS_WAIT_IO,
+	PGSS_WAIT_IPC,
+	PGSS_WAIT_OTHER
+} pgssWaitClass;
+
+#define PGSS_NUM_WAIT_CLASSES	(PGSS_WAIT_OTHER + 1)
+
 /*
  * Extension version number, for supporting older extension versions' objects
  */
@@ -120,7 +163,8 @@ typedef enum pgssVersion
 	PGSS_V1_0 = 0,
 	PGSS_V1_1,
 	PGSS_V1_2,
-	PGSS_V1_3
+	PGSS_V1_3,
+	PGSS_V1_8
 } pgssVersion;
 
 /*
@@ -137,10 +181,14 @@ typedef struct pgssHashKey
 	Oid			userid;			/* user OID */
 	Oid			dbid;			/* database OID */
 	uint64		queryid;		/* query identifier */
+	uint64		planid;			/* plan identifier, or 0 if not tracked */
 } pgssHashKey;
 
 /*
  * The actual stats counters kept within pgssEntry.
+ *
+ * In shared memory, each field is stored in a pg_atomic_uint64 of its own,
+ * doubles by their bit pattern, so every field must be 8 bytes wide.
  */
 typedef struct Counters
 {
@@ -148,8 +196,7 @@ typedef struct Counters
 	double		total_time;		/* total execution time, in msec */
 	double		min_time;		/* minimum execution time in msec */
 	double		max_time;		/* maximum execution time in msec */
-	double		mean_time;		/* mean execution time in msec */
-	double		sum_var_time;	/* sum of variances in execution time in msec */
+	double		sum_sq_time;	/* sum of squared execution times, in msec^2 */
 	int64		rows;			/* total # of retrieved or affected rows */
 	int64		shared_blks_hit;	/* # of shared buffer hits */
 	int64		shared_blks_read;	/* # of shared disk blocks read */
@@ -163,9 +210,17 @@ typedef struct Counters
 	int64		temp_blks_written;	/* # of temp blocks written */
 	double		blk_read_time;	/* time spent reading, in msec */
 	double		blk_write_time; /* time spent writing, in msec */
+	double		wait_time[PGSS_NUM_WAIT_CLASSES];	/* sampled time, in msec */
+	int64		histogram[PGSS_HIST_BUCKETS];	/* # of executions by time */
 	double		usage;			/* usage factor */
 } Counters;
 
+#define PGSS_NUM_COUNTERS		(sizeof(Counters) / sizeof(uint64))
+
+/* Address of the shared counter holding the given field of Counters */
+#define COUNTER(entry, field) \
+	(&(entry)->counters[offsetof(Counters, field) / sizeof(uint64)])
+
 /*
  * Statistics per statement
  *
@@ -176,13 +231,23 @@ typedef struct Counters
 typedef struct pgssEntry
 {
 	pgssHashKey key;			/* hash key of entry - MUST BE FIRST */
-	Counters	counters;		/* the statistics for this query */
 	Size		query_offset;	/* query text offset in external file */
 	int			query_len;		/* # of valid bytes in query string, or -1 */
 	int			encoding;		/* query text encoding */
-	slock_t		mutex;			/* protects the counters only */
+	pg_atomic_uint64 counters[PGSS_NUM_COUNTERS];	/* see Counters */
 } pgssEntry;
 
+/*
+ * Format of an entry in the dump file; its query text follows it.
+ */
+typedef struct pgssDumpEntry
+{
+	pgssHashKey key;
+	Counters	counters;
+	int			query_len;
+	int			encoding;
+} pgssDumpEntry;
+
 /*
  * Global shared state
  */
@@ -249,6 +314,17 @@ static ProcessUtility_hook_type prev_ProcessUtility = NULL;
 static pgssSharedState *pgss = NULL;
 static HTAB *pgss_hash = NULL;
 
+/*
+ * Wait event sampling state.  The timeout handler counts samples by wait
+ * class; the statement being sampled remembers the counts at its start.
+ */
+static bool pgss_sample_timeout_registered = false;
+static TimeoutId pgss_sample_timeout;
+static volatile uint64 pgss_wait_samples[PGSS_NUM_WAIT_CLASSES];
+static QueryDesc *pgss_sampled_query = NULL;
+static int	pgss_sampled_interval;
+static uint64 pgss_sampled_start[PGSS_NUM_WAIT_CLASSES];
+
 /*---- GUC variables ----*/
 
 typedef enum
@@ -270,6 +346,8 @@ static int	pgss_max;			/* max # statements to track */
 static int	pgss_track;			/* tracking level */
 static bool pgss_track_utility; /* whether to track utility commands */
 static bool pgss_save;			/* whether to save stats across shutdown */
+static bool pgss_track_planid;	/* whether to separate entries by plan */
+static int	pgss_wait_sample_interval;	/* msec between wait samples, or 0 */
 
 
 #define pgss_enabled() \
@@ -293,7 +371,9 @@ PG_FUNCTION_INFO_V1(pg_stat_statements_reset);
 PG_FUNCTION_INFO_V1(pg_stat_statements_reset_1_7);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_2);
 PG_FUNCTION_INFO_V1(pg_stat_statements_1_3);
+PG_FUNCTION_INFO_V1(pg_stat_statements_1_8);
 PG_FUNCTION_INFO_V1(pg_stat_statements);
+PG_FUNCTION_INFO_V1(pg_stat_statements_histogram);
 
 static void pgss_shmem_startup(void);
 static void pgss_shmem_shutdown(int code, Datum arg);
@@ -309,10 +389,15 @@ static void pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 								QueryEnvironment *queryEnv,
 								DestReceiver *dest, char *completionTag);
 static uint64 pgss_hash_string(const char *str, int len);
-static void pgss_store(const char *query, uint64 queryId,
+static uint64 pgss_plan_id(PlannedStmt *stmt);
+static void pgss_start_sampling(QueryDesc *queryDesc);
+static void pgss_stop_sampling(double *wait_time);
+static void pgss_sample_wait_event(void);
+static void pgss_store(const char *query, uint64 queryId, uint64 planId,
 					   int query_location, int query_len,
 					   double total_time, uint64 rows,
 					   const BufferUsage *bufusage,
+					   const double *wait_time,
 					   pgssJumbleState *jstate);
 static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 										pgssVersion api_version,
@@ -320,6 +405,9 @@ static void pg_stat_statements_internal(FunctionCallInfo fcinfo,
 static Size pgss_memsize(void);
 static pgssEntry *entry_alloc(pgssHashKey *key, Size query_offset, int query_len,
 							  int encoding, bool sticky);
+static void entry_read_counters(pgssEntry *entry, Counters *counters);
+static int	hist_bucket(double time);
+static void hist_bucket_bounds(int bucket, double *lower, double *upper);
 static void entry_dealloc(void);
 static bool qtext_store(const char *query, int query_len,
 						Size *query_offset, int *gc_count);
@@ -335,6 +423,7 @@ static void JumbleQuery(pgssJumbleState *jstate, Query *query);
 static void JumbleRangeTable(pgssJumbleState *jstate, List *rtable);
 static void JumbleExpr(pgssJumbleState *jstate, Node *node);
 static void RecordConstLocation(pgssJumbleState *jstate, int location);
+static void JumblePlan(pgssJumbleState *jstate, PlannedStmt *stmt, Plan *plan);
 static char *generate_normalized_query(pgssJumbleState *jstate, const char *query,
 									   int query_loc, int *query_len_p, int encoding);
 static void fill_in_constant_lengths(pgssJumbleState *jstate, const char *query,
@@ -409,6 +498,30 @@ _PG_init(void)
 							 NULL,
 							 NULL);
 
+	DefineCustomBoolVariable("pg_stat_statements.track_planid",
+							 "Selects whether pg_stat_statements tracks each plan of a statement separately.",
+							 NULL,
+							 &pgss_track_planid,
+							 false,
+							 PGC_SUSET,
+							 0,
+							 NULL,
+							 NULL,
+							 NULL);
+
+	DefineCustomIntVariable("pg_stat_statements.wait_sample_interval",
+							"Sets the interval between samples of the wait event of a statement.",
+							"Zero disables sampling.",
+							&pgss_wait_sample_interval,
+							0,
+							0,
+							1000,
+							PGC_SUSET,
+							GUC_UNIT_MS,
+							NULL,
+							NULL,
+							NULL);
+
 	EmitWarningsOnPlaceholders("pg_stat_statements");
 
 	/*
@@ -576,11 +689,13 @@ pgss_shmem_startup(void)
 
 	for (i = 0; i < num; i++)
 	{
-		pgssEntry	temp;
+		pgssDumpEntry temp;
 		pgssEntry  *entry;
 		Size		query_offset;
+		uint64		words[PGSS_NUM_COUNTERS];
+		int			j;
 
-		if (fread(&temp, sizeof(pgssEntry), 1, file) != 1)
+		if (fread(&temp, sizeof(pgssDumpEntry), 1, file) != 1)
 			goto read_error;
 
 		/* Encoding is the only field we can easily sanity-check */
@@ -616,7 +731,9 @@ pgss_shmem_startup(void)
 							false);
 
 		/* copy in the actual stats */
-		entry->counters = temp.counters;
+		memcpy(words, &temp.counters, sizeof(Counters));
+		for (j = 0; j < PGSS_NUM_COUNTERS; j++)
+			pg_atomic_write_u64(&entry->counters[j], words[j]);
 	}
 
 	pfree(buffer);
@@ -724,6 +841,7 @@ pgss_shmem_shutdown(int code, Datum arg)
 	hash_seq_init(&hash_seq, pgss_hash);
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
+		pgssDumpEntry temp;
 		int			len = entry->query_len;
 		char	   *qstr = qtext_fetch(entry->query_offset, len,
 									   qbuffer, qbuffer_size);
@@ -731,7 +849,13 @@ pgss_shmem_shutdown(int code, Datum arg)
 		if (qstr == NULL)
 			continue;			/* Ignore any entries with bogus texts */
 
-		if (fwrite(entry, sizeof(pgssEntry), 1, file) != 1 ||
+		memset(&temp, 0, sizeof(temp));
+		temp.key = entry->key;
+		entry_read_counters(entry, &temp.counters);
+		temp.query_len = len;
+		temp.encoding = entry->encoding;
+
+		if (fwrite(&temp, sizeof(pgssDumpEntry), 1, file) != 1 ||
 			fwrite(qstr, 1, len + 1, file) != len + 1)
 		{
 			/* note: we assume hash_seq_term won't change errno */
@@ -835,11 +959,13 @@ pgss_post_parse_analyze(ParseState *pstate, Query *query)
 	if (jstate.clocations_count > 0)
 		pgss_store(pstate->p_sourcetext,
 				   query->queryId,
+				   UINT64CONST(0),
 				   query->stmt_location,
 				   query->stmt_len,
 				   0,
 				   0,
 				   NULL,
+				   NULL,
 				   &jstate);
 }
 
@@ -874,6 +1000,14 @@ pgss_ExecutorStart(QueryDesc *queryDesc, int eflags)
 			queryDesc->totaltime = InstrAlloc(1, INSTRUMENT_ALL);
 			MemoryContextSwitchTo(oldcxt);
 		}
+
+		/*
+		 * Sample the wait events of top-level statements.  A statement that
+		 * is still marked as being sampled must have failed, so we can take
+		 * over.
+		 */
+		if (pgss_wait_sample_interval > 0 && nested_level == 0)
+			pgss_start_sampling(queryDesc);
 	}
 }
 
@@ -934,19 +1068,31 @@ pgss_ExecutorEnd(QueryDesc *queryDesc)
 
 	if (queryId != UINT64CONST(0) && queryDesc->totaltime && pgss_enabled())
 	{
+		double		wait_time[PGSS_NUM_WAIT_CLASSES];
+		bool		sampled = false;
+
 		/*
 		 * Make sure stats accumulation is done.  (Note: it's okay if several
 		 * levels of hook all do this.)
 		 */
 		InstrEndLoop(queryDesc->totaltime);
 
+		if (queryDesc == pgss_sampled_query && nested_level == 0)
+		{
+			pgss_stop_sampling(wait_time);
+			sampled = true;
+		}
+
 		pgss_store(queryDesc->sourceText,
 				   queryId,
+				   pgss_track_planid ?
+				   pgss_plan_id(queryDesc->plannedstmt) : UINT64CONST(0),
 				   queryDesc->plannedstmt->stmt_location,
 				   queryDesc->plannedstmt->stmt_len,
 				   queryDesc->totaltime->total * 1000.0,	/* convert to msec */
 				   queryDesc->estate->es_processed,
 				   &queryDesc->totaltime->bufusage,
+				   sampled ? wait_time : NULL,
 				   NULL);
 	}
 
@@ -1053,11 +1199,13 @@ pgss_ProcessUtility(PlannedStmt *pstmt, const char *queryString,
 
 		pgss_store(queryString,
 				   0,			/* signal that it's a utility stmt */
+				   0,
 				   pstmt->stmt_location,
 				   pstmt->stmt_len,
 				   INSTR_TIME_GET_MILLISEC(duration),
 				   rows,
 				   &bufusage,
+				   NULL,
 				   NULL);
 	}
 	else
@@ -1085,21 +1233,202 @@ pgss_hash_string(const char *str, int len)
 											len, 0));
 }
 
+/*
+ * Compute an identifier for the shape of a plan: its node types, the
+ * relations and indexes it scans, and its join and aggregation strategies.
+ * Costs, estimates and expressions are left out, so that only choosing a
+ * different plan, not re-planning with different estimates, changes it.
+ */
+static uint64
+pgss_plan_id(PlannedStmt *stmt)
+{
+	pgssJumbleState jstate;
+	ListCell   *lc;
+	uint64		planid;
+
+	jstate.jumble = (unsigned char *) palloc(JUMBLE_SIZE);
+	jstate.jumble_len = 0;
+	jstate.clocations_buf_size = 0;
+	jstate.clocations = NULL;
+	jstate.clocations_count = 0;
+	jstate.highest_extern_param_id = 0;
+
+	JumblePlan(&jstate, stmt, stmt->planTree);
+	foreach(lc, stmt->subplans)
+		JumblePlan(&jstate, stmt, (Plan *) lfirst(lc));
+
+	planid = DatumGetUInt64(hash_any_extended(jstate.jumble,
+											  jstate.jumble_len, 0));
+	pfree(jstate.jumble);
+
+	/* Zero means that plans are not tracked */
+	if (planid == UINT64CONST(0))
+		planid = UINT64CONST(1);
+
+	return planid;
+}
+
+/*
+ * Start sampling the wait events of the given statement.
+ */
+static void
+pgss_start_sampling(QueryDesc *queryDesc)
+{
+	TimestampTz fin_time;
+	int			i;
+
+	if (!pgss_sample_timeout_registered)
+	{
+		pgss_sample_timeout = RegisterTimeout(USER_TIMEOUT,
+											  pgss_sample_wait_event);
+		pgss_sample_timeout_registered = true;
+	}
+
+	pgss_sampled_query = queryDesc;
+	pgss_sampled_interval = pgss_wait_sample_interval;
+	for (i = 0; i < PGSS_NUM_WAIT_CLASSES; i++)
+		pgss_sampled_start[i] = pgss_wait_samples[i];
+
+	fin_time = TimestampTzPlusMilliseconds(GetCurrentTimestamp(),
+										   pgss_sampled_interval);
+	enable_timeout_every(pgss_sample_timeout, fin_time,
+						 pgss_sampled_interval);
+}
+
+/*
+ * Stop sampling, and estimate the time spent in each wait class (in msec)
+ * from the number of samples taken since sampling started.
+ */
+static void
+pgss_stop_sampling(double *wait_time)
+{
+	int			i;
+
+	disable_timeout(pgss_sample_timeout, false);
+
+	for (i = 0; i < PGSS_NUM_WAIT_CLASSES; i++)
+		wait_time[i] = (double) (pgss_wait_samples[i] - pgss_sampled_start[i]) *
+			pgss_sampled_interval;
+
+	pgss_sampled_query = NULL;
+}
+
+/*
+ * Timeout handler: count a sample of the wait event we are in.
+ */
+static void
+pgss_sample_wait_event(void)
+{
+	volatile PGPROC *proc = MyProc;
+	uint32		wait_event_info;
+	pgssWaitClass wait_class;
+
+	if (proc == NULL)
+		return;
+
+	wait_event_info = proc->wait_event_info;
+	switch (wait_event_info & 0xFF000000)
+	{
+		case 0:
+			wait_class = PGSS_WAIT_CPU;
+			break;
+		case PG_WAIT_LOCK:
+		case PG_WAIT_BUFFER_PIN:
+			wait_class = PGSS_WAIT_LOCK;
+			break;
+		case PG_WAIT_LWLOCK:
+			wait_class = PGSS_WAIT_LWLOCK;
+			break;
+		case PG_WAIT_IO:
+			wait_class = PGSS_WAIT_IO;
+			break;
+		case PG_WAIT_IPC:
+			wait_class = PGSS_WAIT_IPC;
+			break;
+		default:
+			wait_class = PGSS_WAIT_OTHER;
+			break;
+	}
+	pgss_wait_samples[wait_class]++;
+}
+
+/*
+ * Helpers to access doubles kept in the bit pattern of a pg_atomic_uint64.
+ * Additions, minimums and maximums retry until no concurrent update gets in
+ * between.
+ */
+static inline double
+counter_read_double(volatile pg_atomic_uint64 *ptr)
+{
+	uint64		bits = pg_atomic_read_u64(ptr);
+	double		val;
+
+	memcpy(&val, &bits, sizeof(val));
+	return val;
+}
+
+static inline void
+counter_write_double(volatile pg_atomic_uint64 *ptr, double val)
+{
+	uint64		bits;
+
+	memcpy(&bits, &val, sizeof(bits));
+	pg_atomic_write_u64(ptr, bits);
+}
+
+static inline void
+counter_add_double(volatile pg_atomic_uint64 *ptr, double val)
+{
+	uint64		oldbits = pg_atomic_read_u64(ptr);
+	uint64		newbits;
+	double		oldval;
+	double		newval;
+
+	do
+	{
+		memcpy(&oldval, &oldbits, sizeof(oldval));
+		newval = oldval + val;
+		memcpy(&newbits, &newval, sizeof(newbits));
+	} while (!pg_atomic_compare_exchange_u64(ptr, &oldbits, newbits));
+}
+
+static inline void
+counter_min_max_double(volatile pg_atomic_uint64 *ptr, double val, bool max)
+{
+	uint64		oldbits = pg_atomic_read_u64(ptr);
+	uint64		newbits;
+	double		oldval;
+
+	memcpy(&newbits, &val, sizeof(newbits));
+	for (;;)
+	{
+		memcpy(&oldval, &oldbits, sizeof(oldval));
+		if (max ? oldval >= val : oldval <= val)
+			break;
+		if (pg_atomic_compare_exchange_u64(ptr, &oldbits, newbits))
+			break;
+	}
+}
+
 /*
  * Store some statistics for a statement.
  *
  * If queryId is 0 then this is a utility statement and we should compute
  * a suitable queryId internally.
  *
+ * wait_time, if not NULL, is the time spent in each wait class as found by
+ * sampling.
+ *
  * If jstate is not NULL then we're trying to create an entry for which
  * we have no statistics as yet; we just want to record the normalized
  * query string.  total_time, rows, bufusage are ignored in this case.
  */
 static void
-pgss_store(const char *query, uint64 queryId,
+pgss_store(const char *query, uint64 queryId, uint64 planId,
 		   int query_location, int query_len,
 		   double total_time, uint64 rows,
 		   const BufferUsage *bufusage,
+		   const double *wait_time,
 		   pgssJumbleState *jstate)
 {
 	pgssHashKey key;
@@ -1165,6 +1494,7 @@ pgss_store(const char *query, uint64 queryId,
 	key.userid = GetUserId();
 	key.dbid = MyDatabaseId;
 	key.queryid = queryId;
+	key.planid = planId;
 
 	/* Lookup the hash table entry with shared lock. */
 	LWLockAcquire(pgss->lock, LW_SHARED);
@@ -1176,8 +1506,11 @@ pgss_store(const char *query, uint64 queryId,
 	{
 		Size		query_offset;
 		int			gc_count;
-		bool		stored;
+		bool		stored = false;
+		bool		shared_text = false;
 		bool		do_gc;
+		pgssHashKey text_key;
+		pgssEntry  *text_entry;
 
 		/*
 		 * Create a new, normalized query string if caller asked.  We don't
@@ -1196,9 +1529,25 @@ pgss_store(const char *query, uint64 queryId,
 			LWLockAcquire(pgss->lock, LW_SHARED);
 		}
 
+		/*
+		 * A new plan of a statement shares the query text of the entry
+		 * without a plan, which is where the text normalized at parse
+		 * analysis was stored.  If that entry is gone, we fall back to the
+		 * text we have.
+		 */
+		if (planId != UINT64CONST(0))
+		{
+			text_key = key;
+			text_key.planid = UINT64CONST(0);
+			text_entry = (pgssEntry *) hash_search(pgss_hash, &text_key,
+												   HASH_FIND, NULL);
+			shared_text = (text_entry != NULL && text_entry->query_len >= 0);
+		}
+
 		/* Append new query text to file with only shared lock held */
-		stored = qtext_store(norm_query ? norm_query : query, query_len,
-							 &query_offset, &gc_count);
+		if (!shared_text)
+			stored = qtext_store(norm_query ? norm_query : query, query_len,
+								 &query_offset, &gc_count);
 
 		/*
 		 * Determine whether we need to garbage collect external query texts
@@ -1211,6 +1560,22 @@ pgss_store(const char *query, uint64 queryId,
 		LWLockRelease(pgss->lock);
 		LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 
+		/* Look for the shared text again, as it may have moved meanwhile */
+		if (shared_text)
+		{
+			text_entry = (pgssEntry *) hash_search(pgss_hash, &text_key,
+												   HASH_FIND, NULL);
+			if (text_entry != NULL && text_entry->query_len >= 0)
+			{
+				query_offset = text_entry->query_offset;
+				query_len = text_entry->query_len;
+				encoding = text_entry->encoding;
+				stored = true;
+			}
+			else
+				shared_text = false;
+		}
+
 		/*
 		 * A garbage collection may have occurred while we weren't holding the
 		 * lock.  In the unlikely event that this happens, the query text we
@@ -1218,7 +1583,7 @@ pgss_store(const char *query, uint64 queryId,
 		 * This should be infrequent enough that doing it while holding
 		 * exclusive lock isn't a performance problem.
 		 */
-		if (!stored || pgss->gc_count != gc_count)
+		if (!shared_text && (!stored || pgss->gc_count != gc_count))
 			stored = qtext_store(norm_query ? norm_query : query, query_len,
 								 &query_offset, NULL);
 
@@ -1239,60 +1604,58 @@ pgss_store(const char *query, uint64 queryId,
 	if (!jstate)
 	{
 		/*
-		 * Grab the spinlock while updating the counters (see comment about
-		 * locking rules at the head of the file)
+		 * The counters are updated atomically, without locking the entry
+		 * (see comment about locking rules at the head of the file)
 		 */
-		volatile pgssEntry *e = (volatile pgssEntry *) entry;
-
-		SpinLockAcquire(&e->mutex);
+		int			i;
 
 		/* "Unstick" entry if it was previously sticky */
-		if (e->counters.calls == 0)
-			e->counters.usage = USAGE_INIT;
-
-		e->counters.calls += 1;
-		e->counters.total_time += total_time;
-		if (e->counters.calls == 1)
+		if (pg_atomic_fetch_add_u64(COUNTER(entry, calls), 1) == 0)
+			counter_write_double(COUNTER(entry, usage), USAGE_INIT);
+
+		counter_add_double(COUNTER(entry, total_time), total_time);
+		counter_min_max_double(COUNTER(entry, min_time), total_time, false);
+		counter_min_max_double(COUNTER(entry, max_time), total_time, true);
+		counter_add_double(COUNTER(entry, sum_sq_time), total_time * total_time);
+		pg_atomic_fetch_add_u64(COUNTER(entry, rows), rows);
+		pg_atomic_fetch_add_u64(COUNTER(entry, shared_blks_hit),
+								bufusage->shared_blks_hit);
+		pg_atomic_fetch_add_u64(COUNTER(entry, shared_blks_read),
+								bufusage->shared_blks_read);
+		pg_atomic_fetch_add_u64(COUNTER(entry, shared_blks_dirtied),
+								bufusage->shared_blks_dirtied);
+		pg_atomic_fetch_add_u64(COUNTER(entry, shared_blks_written),
+								bufusage->shared_blks_written);
+		pg_atomic_fetch_add_u64(COUNTER(entry, local_blks_hit),
+								bufusage->local_blks_hit);
+		pg_atomic_fetch_add_u64(COUNTER(entry, local_blks_read),
+								bufusage->local_blks_read);
+		pg_atomic_fetch_add_u64(COUNTER(entry, local_blks_dirtied),
+								bufusage->local_blks_dirtied);
+		pg_atomic_fetch_add_u64(COUNTER(entry, local_blks_written),
+								bufusage->local_blks_written);
+		pg_atomic_fetch_add_u64(COUNTER(entry, temp_blks_read),
+								bufusage->temp_blks_read);
+		pg_atomic_fetch_add_u64(COUNTER(entry, temp_blks_written),
+								bufusage->temp_blks_written);
+		if (!INSTR_TIME_IS_ZERO(bufusage->blk_read_time))
+			counter_add_double(COUNTER(entry, blk_read_time),
+							   INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time));
+		if (!INSTR_TIME_IS_ZERO(bufusage->blk_write_time))
+			counter_add_double(COUNTER(entry, blk_write_time),
+							   INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time));
+		if (wait_time)
 		{
-			e->counters.min_time = total_time;
-			e->counters.max_time = total_time;
-			e->counters.mean_time = total_time;
-		}
-		else
-		{
-			/*
-			 * Welford's method for accurately computing variance. See
-			 * <http://www.johndcook.com/blog/standard_deviation/>
-			 */
-			double		old_mean = e->counters.mean_time;
-
-			e->counters.mean_time +=
-				(total_time - old_mean) / e->counters.calls;
-			e->counters.sum_var_time +=
-				(total_time - old_mean) * (total_time - e->counters.mean_time);
-
-			/* calculate min and max time */
-			if (e->counters.min_time > total_time)
-				e->counters.min_time = total_time;
-			if (e->counters.max_time < total_time)
-				e->counters.max_time = total_time;
+			for (i = 0; i < PGSS_NUM_WAIT_CLASSES; i++)
+			{
+				if (wait_time[i] > 0)
+					counter_add_double(COUNTER(entry, wait_time) + i,
+									   wait_time[i]);
+			}
 		}
-		e->counters.rows += rows;
-		e->counters.shared_blks_hit += bufusage->shared_blks_hit;
-		e->counters.shared_blks_read += bufusage->shared_blks_read;
-		e->counters.shared_blks_dirtied += bufusage->shared_blks_dirtied;
-		e->counters.shared_blks_written += bufusage->shared_blks_written;
-		e->counters.local_blks_hit += bufusage->local_blks_hit;
-		e->counters.local_blks_read += bufusage->local_blks_read;
-		e->counters.local_blks_dirtied += bufusage->local_blks_dirtied;
-		e->counters.local_blks_written += bufusage->local_blks_written;
-		e->counters.temp_blks_read += bufusage->temp_blks_read;
-		e->counters.temp_blks_written += bufusage->temp_blks_written;
-		e->counters.blk_read_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_read_time);
-		e->counters.blk_write_time += INSTR_TIME_GET_MILLISEC(bufusage->blk_write_time);
-		e->counters.usage += USAGE_EXEC(total_time);
-
-		SpinLockRelease(&e->mutex);
+		pg_atomic_fetch_add_u64(COUNTER(entry, histogram) +
+								hist_bucket(total_time), 1);
+		counter_add_double(COUNTER(entry, usage), USAGE_EXEC(total_time));
 	}
 
 done:
@@ -1338,7 +1701,8 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
 #define PG_STAT_STATEMENTS_COLS_V1_1	18
 #define PG_STAT_STATEMENTS_COLS_V1_2	19
 #define PG_STAT_STATEMENTS_COLS_V1_3	23
-#define PG_STAT_STATEMENTS_COLS			23	/* maximum of above */
+#define PG_STAT_STATEMENTS_COLS_V1_8	30
+#define PG_STAT_STATEMENTS_COLS			30	/* maximum of above */
 
 /*
  * Retrieve statement statistics.
@@ -1350,6 +1714,16 @@ pg_stat_statements_reset(PG_FUNCTION_ARGS)
  * expected API version is identified by embedding it in the C name of the
  * function.  Unfortunately we weren't bright enough to do that for 1.1.
  */
+Datum
+pg_stat_statements_1_8(PG_FUNCTION_ARGS)
+{
+	bool		showtext = PG_GETARG_BOOL(0);
+
+	pg_stat_statements_internal(fcinfo, PGSS_V1_8, showtext);
+
+	return (Datum) 0;
+}
+
 Datum
 pg_stat_statements_1_3(PG_FUNCTION_ARGS)
 {
@@ -1456,6 +1830,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			if (api_version != PGSS_V1_3)
 				elog(ERROR, "incorrect number of output arguments");
 			break;
+		case PG_STAT_STATEMENTS_COLS_V1_8:
+			if (api_version != PGSS_V1_8)
+				elog(ERROR, "incorrect number of output arguments");
+			break;
 		default:
 			elog(ERROR, "incorrect number of output arguments");
 	}
@@ -1539,8 +1917,10 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		bool		nulls[PG_STAT_STATEMENTS_COLS];
 		int			i = 0;
 		Counters	tmp;
+		double		mean;
 		double		stddev;
 		int64		queryid = entry->key.queryid;
+		int64		planid = entry->key.planid;
 
 		memset(values, 0, sizeof(values));
 		memset(nulls, 0, sizeof(nulls));
@@ -1552,6 +1932,8 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		{
 			if (api_version >= PGSS_V1_2)
 				values[i++] = Int64GetDatumFast(queryid);
+			if (api_version >= PGSS_V1_8)
+				values[i++] = Int64GetDatumFast(planid);
 
 			if (showtext)
 			{
@@ -1587,9 +1969,11 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		}
 		else
 		{
-			/* Don't show queryid */
+			/* Don't show queryid or planid */
 			if (api_version >= PGSS_V1_2)
 				nulls[i++] = true;
+			if (api_version >= PGSS_V1_8)
+				nulls[i++] = true;
 
 			/*
 			 * Don't show query text, but hint as to the reason for not doing
@@ -1601,14 +1985,7 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 				nulls[i++] = true;
 		}
 
-		/* copy counters to a local variable to keep locking time short */
-		{
-			volatile pgssEntry *e = (volatile pgssEntry *) entry;
-
-			SpinLockAcquire(&e->mutex);
-			tmp = e->counters;
-			SpinLockRelease(&e->mutex);
-		}
+		entry_read_counters(entry, &tmp);
 
 		/* Skip entry if unexecuted (ie, it's a pending "sticky" entry) */
 		if (tmp.calls == 0)
@@ -1620,16 +1997,19 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 		{
 			values[i++] = Float8GetDatumFast(tmp.min_time);
 			values[i++] = Float8GetDatumFast(tmp.max_time);
-			values[i++] = Float8GetDatumFast(tmp.mean_time);
+			mean = tmp.total_time / tmp.calls;
+			values[i++] = Float8GetDatumFast(mean);
 
 			/*
 			 * Note we are calculating the population variance here, not the
 			 * sample variance, as we have data for the whole population, so
 			 * Bessel's correction is not used, and we don't divide by
-			 * tmp.calls - 1.
+			 * tmp.calls - 1.  Rounding errors can make the difference
+			 * slightly negative when all the times are about the same.
 			 */
 			if (tmp.calls > 1)
-				stddev = sqrt(tmp.sum_var_time / tmp.calls);
+				stddev = sqrt(Max(tmp.sum_sq_time / tmp.calls - mean * mean,
+								  0.0));
 			else
 				stddev = 0.0;
 			values[i++] = Float8GetDatumFast(stddev);
@@ -1652,11 +2032,21 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 			values[i++] = Float8GetDatumFast(tmp.blk_read_time);
 			values[i++] = Float8GetDatumFast(tmp.blk_write_time);
 		}
+		if (api_version >= PGSS_V1_8)
+		{
+			values[i++] = Float8GetDatumFast(tmp.wait_time[PGSS_WAIT_CPU]);
+			values[i++] = Float8GetDatumFast(tmp.wait_time[PGSS_WAIT_LOCK]);
+			values[i++] = Float8GetDatumFast(tmp.wait_time[PGSS_WAIT_LWLOCK]);
+			values[i++] = Float8GetDatumFast(tmp.wait_time[PGSS_WAIT_IO]);
+			values[i++] = Float8GetDatumFast(tmp.wait_time[PGSS_WAIT_IPC]);
+			values[i++] = Float8GetDatumFast(tmp.wait_time[PGSS_WAIT_OTHER]);
+		}
 
 		Assert(i == (api_version == PGSS_V1_0 ? PG_STAT_STATEMENTS_COLS_V1_0 :
 					 api_version == PGSS_V1_1 ? PG_STAT_STATEMENTS_COLS_V1_1 :
 					 api_version == PGSS_V1_2 ? PG_STAT_STATEMENTS_COLS_V1_2 :
 					 api_version == PGSS_V1_3 ? PG_STAT_STATEMENTS_COLS_V1_3 :
+					 api_version == PGSS_V1_8 ? PG_STAT_STATEMENTS_COLS_V1_8 :
 					 -1 /* fail if you forget to update this assert */ ));
 
 		tuplestore_putvalues(tupstore, tupdesc, values, nulls);
@@ -1671,6 +2061,172 @@ pg_stat_statements_internal(FunctionCallInfo fcinfo,
 	tuplestore_donestoring(tupstore);
 }
 
+/* Number of output arguments (columns) for pg_stat_statements_histogram */
+#define PG_STAT_STATEMENTS_HISTOGRAM_COLS	8
+
+/*
+ * Retrieve the execution time histograms, as one row per nonempty bucket.
+ */
+Datum
+pg_stat_statements_histogram(PG_FUNCTION_ARGS)
+{
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	Oid			userid = GetUserId();
+	bool		is_allowed_role;
+	HASH_SEQ_STATUS hash_seq;
+	pgssEntry  *entry;
+
+	/* Superusers or members of pg_read_all_stats members are allowed */
+	is_allowed_role = is_member_of_role(GetUserId(), DEFAULT_ROLE_READ_ALL_STATS);
+
+	/* hash table must exist already */
+	if (!pgss || !pgss_hash)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("pg_stat_statements must be loaded via shared_preload_libraries")));
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Switch into long-lived context to construct returned data structures */
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+	if (tupdesc->natts != PG_STAT_STATEMENTS_HISTOGRAM_COLS)
+		elog(ERROR, "incorrect number of output arguments");
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	LWLockAcquire(pgss->lock, LW_SHARED);
+
+	hash_seq_init(&hash_seq, pgss_hash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		bool		visible = (is_allowed_role || entry->key.userid == userid);
+		int			bucket;
+
+		for (bucket = 0; bucket < PGSS_HIST_BUCKETS; bucket++)
+		{
+			Datum		values[PG_STAT_STATEMENTS_HISTOGRAM_COLS];
+			bool		nulls[PG_STAT_STATEMENTS_HISTOGRAM_COLS];
+			int64		calls;
+			double		lower;
+			double		upper;
+			int			i = 0;
+
+			calls = (int64) pg_atomic_read_u64(COUNTER(entry, histogram) +
+											   bucket);
+			if (calls == 0)
+				continue;
+
+			hist_bucket_bounds(bucket, &lower, &upper);
+
+			memset(nulls, 0, sizeof(nulls));
+
+			values[i++] = ObjectIdGetDatum(entry->key.userid);
+			values[i++] = ObjectIdGetDatum(entry->key.dbid);
+			if (visible)
+			{
+				values[i++] = Int64GetDatumFast(entry->key.queryid);
+				values[i++] = Int64GetDatumFast(entry->key.planid);
+			}
+			else
+			{
+				nulls[i++] = true;
+				nulls[i++] = true;
+			}
+			values[i++] = Int32GetDatum(bucket);
+			values[i++] = Float8GetDatumFast(lower);
+			values[i++] = Float8GetDatumFast(upper);
+			values[i++] = Int64GetDatumFast(calls);
+
+			Assert(i == PG_STAT_STATEMENTS_HISTOGRAM_COLS);
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	LWLockRelease(pgss->lock);
+
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * Histogram bucket for an execution time given in msec
+ */
+static int
+hist_bucket(double time)
+{
+	uint64		usec;
+	int			exp;
+
+	if (!(time * 1000.0 < (double) (UINT64CONST(1) << PGSS_HIST_MAX_EXP)))
+		return PGSS_HIST_BUCKETS - 1;
+	usec = (time > 0) ? (uint64) (time * 1000.0) : 0;
+	if (usec < (UINT64CONST(1) << PGSS_HIST_MIN_EXP))
+		return 0;
+
+	/* Power of two, then the subdivision given by the next bits */
+	exp = pg_leftmost_one_pos64(usec);
+	return 1 + ((exp - PGSS_HIST_MIN_EXP) << PGSS_HIST_SUB_BITS) +
+		(int) ((usec >> (exp - PGSS_HIST_SUB_BITS)) &
+			   ((1 << PGSS_HIST_SUB_BITS) - 1));
+}
+
+/*
+ * Bounds of a histogram bucket, in msec.  The lower bound is inclusive, the
+ * upper one exclusive.
+ */
+static void
+hist_bucket_bounds(int bucket, double *lower, double *upper)
+{
+	int			exp;
+	uint64		width;
+	uint64		start;
+
+	if (bucket == 0)
+	{
+		*lower = 0.0;
+		*upper = (double) (UINT64CONST(1) << PGSS_HIST_MIN_EXP) / 1000.0;
+		return;
+	}
+	if (bucket == PGSS_HIST_BUCKETS - 1)
+	{
+		*lower = (double) (UINT64CONST(1) << PGSS_HIST_MAX_EXP) / 1000.0;
+		*upper = get_float8_infinity();
+		return;
+	}
+
+	exp = PGSS_HIST_MIN_EXP + ((bucket - 1) >> PGSS_HIST_SUB_BITS);
+	width = UINT64CONST(1) << (exp - PGSS_HIST_SUB_BITS);
+	start = (UINT64CONST(1) << exp) +
+		((bucket - 1) & ((1 << PGSS_HIST_SUB_BITS) - 1)) * width;
+	*lower = (double) start / 1000.0;
+	*upper = (double) (start + width) / 1000.0;
+}
+
 /*
  * Estimate shared memory space needed.
  */
@@ -1718,14 +2274,17 @@ entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
 
 	if (!found)
 	{
+		int			i;
+
 		/* New entry, initialize it */
 
 		/* reset the statistics */
-		memset(&entry->counters, 0, sizeof(Counters));
+		for (i = 0; i < PGSS_NUM_COUNTERS; i++)
+			pg_atomic_init_u64(&entry->counters[i], 0);
+		counter_write_double(COUNTER(entry, min_time), DBL_MAX);
 		/* set the appropriate initial usage count */
-		entry->counters.usage = sticky ? pgss->cur_median_usage : USAGE_INIT;
-		/* re-initialize the mutex each time ... we assume no one using it */
-		SpinLockInit(&entry->mutex);
+		counter_write_double(COUNTER(entry, usage),
+							 sticky ? pgss->cur_median_usage : USAGE_INIT);
 		/* ... and don't forget the query text metadata */
 		Assert(query_len >= 0);
 		entry->query_offset = query_offset;
@@ -1736,14 +2295,31 @@ entry_alloc(pgssHashKey *key, Size query_offset, int query_len, int encoding,
 	return entry;
 }
 
+/*
+ * Copy the counters of an entry into a Counters struct.
+ * caller must hold a lock on pgss->lock
+ */
+static void
+entry_read_counters(pgssEntry *entry, Counters *counters)
+{
+	uint64		words[PGSS_NUM_COUNTERS];
+	int			i;
+
+	for (i = 0; i < PGSS_NUM_COUNTERS; i++)
+		words[i] = pg_atomic_read_u64(&entry->counters[i]);
+	memcpy(counters, words, sizeof(Counters));
+}
+
 /*
  * qsort comparator for sorting into increasing usage order
  */
 static int
 entry_cmp(const void *lhs, const void *rhs)
 {
-	double		l_usage = (*(pgssEntry *const *) lhs)->counters.usage;
-	double		r_usage = (*(pgssEntry *const *) rhs)->counters.usage;
+	double		l_usage = counter_read_double(COUNTER(*(pgssEntry *const *) lhs,
+													  usage));
+	double		r_usage = counter_read_double(COUNTER(*(pgssEntry *const *) rhs,
+													  usage));
 
 	if (l_usage < r_usage)
 		return -1;
@@ -1790,12 +2366,15 @@ entry_dealloc(void)
 	hash_seq_init(&hash_seq, pgss_hash);
 	while ((entry = hash_seq_search(&hash_seq)) != NULL)
 	{
+		double		usage = counter_read_double(COUNTER(entry, usage));
+
 		entries[i++] = entry;
 		/* "Sticky" entries get a different usage decay rate. */
-		if (entry->counters.calls == 0)
-			entry->counters.usage *= STICKY_DECREASE_FACTOR;
+		if (pg_atomic_read_u64(COUNTER(entry, calls)) == 0)
+			usage *= STICKY_DECREASE_FACTOR;
 		else
-			entry->counters.usage *= USAGE_DECREASE_FACTOR;
+			usage *= USAGE_DECREASE_FACTOR;
+		counter_write_double(COUNTER(entry, usage), usage);
 		/* In the mean length computation, ignore dropped texts. */
 		if (entry->query_len >= 0)
 		{
@@ -1809,7 +2388,8 @@ entry_dealloc(void)
 
 	/* Record the (approximate) median usage */
 	if (i > 0)
-		pgss->cur_median_usage = entries[i / 2]->counters.usage;
+		pgss->cur_median_usage =
+			counter_read_double(COUNTER(entries[i / 2], usage));
 	/* Record the mean query length */
 	if (nvalidtexts > 0)
 		pgss->mean_query_len = tottextlen / nvalidtexts;
@@ -2279,12 +2859,20 @@ entry_reset(Oid userid, Oid dbid, uint64 queryid)
 	LWLockAcquire(pgss->lock, LW_EXCLUSIVE);
 	num_entries = hash_get_num_entries(pgss_hash);
 
-	if (userid != 0 && dbid != 0 && queryid != UINT64CONST(0))
+	if (userid != 0 && dbid != 0 && queryid != UINT64CONST(0) &&
+		!pgss_track_planid)
 	{
-		/* If all the parameters are available, use the fast path. */
+		/*
+		 * If all the parameters are available, use the fast path.  That only
+		 * finds the entry of the statement without a plan identifier, so we
+		 * can't use it if entries for each plan may exist.  (They still
+		 * might, if track_planid was turned off since, but then they will age
+		 * out soon enough.)
+		 */
 		key.userid = userid;
 		key.dbid = dbid;
 		key.queryid = queryid;
+		key.planid = UINT64CONST(0);
 
 		/* Remove the key if exists */
 		entry = (pgssEntry *) hash_search(pgss_hash, &key, HASH_REMOVE, NULL);
@@ -3004,6 +3592,109 @@ RecordConstLocation(pgssJumbleState *jstate, int location)
 	}
 }
 
+/*
+ * Jumble a plan tree, for pgss_plan_id().  Only the choices the planner made
+ * are included: node types, scanned relations and indexes, and join and
+ * aggregation strategies.
+ */
+static void
+JumblePlan(pgssJumbleState *jstate, PlannedStmt *stmt, Plan *plan)
+{
+	NodeTag		tag;
+	ListCell   *lc;
+
+	if (plan == NULL)
+		return;
+
+	/* Guard against stack overflow due to overly complex plans */
+	check_stack_depth();
+
+	tag = nodeTag(plan);
+	APP_JUMB(tag);
+
+	switch (tag)
+	{
+		case T_SeqScan:
+		case T_SampleScan:
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+		case T_BitmapHeapScan:
+		case T_TidScan:
+		case T_ForeignScan:
+		case T_CustomScan:
+			{
+				Index		scanrelid = ((Scan *) plan)->scanrelid;
+
+				/* foreign and custom joins have no single relation */
+				if (scanrelid > 0)
+				{
+					RangeTblEntry *rte = rt_fetch(scanrelid, stmt->rtable);
+
+					APP_JUMB(rte->relid);
+				}
+			}
+			break;
+		default:
+			break;
+	}
+
+	switch (tag)
+	{
+		case T_IndexScan:
+			APP_JUMB(((IndexScan *) plan)->indexid);
+			APP_JUMB(((IndexScan *) plan)->indexorderdir);
+			break;
+		case T_IndexOnlyScan:
+			APP_JUMB(((IndexOnlyScan *) plan)->indexid);
+			APP_JUMB(((IndexOnlyScan *) plan)->indexorderdir);
+			break;
+		case T_BitmapIndexScan:
+			APP_JUMB(((BitmapIndexScan *) plan)->indexid);
+			break;
+		case T_NestLoop:
+		case T_MergeJoin:
+		case T_HashJoin:
+			APP_JUMB(((Join *) plan)->jointype);
+			break;
+		case T_Agg:
+			APP_JUMB(((Agg *) plan)->aggstrategy);
+			break;
+		case T_ModifyTable:
+			APP_JUMB(((ModifyTable *) plan)->operation);
+			foreach(lc, ((ModifyTable *) plan)->plans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_Append:
+			foreach(lc, ((Append *) plan)->appendplans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_MergeAppend:
+			foreach(lc, ((MergeAppend *) plan)->mergeplans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_BitmapAnd:
+			foreach(lc, ((BitmapAnd *) plan)->bitmapplans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_BitmapOr:
+			foreach(lc, ((BitmapOr *) plan)->bitmapplans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		case T_SubqueryScan:
+			JumblePlan(jstate, stmt, ((SubqueryScan *) plan)->subplan);
+			break;
+		case T_CustomScan:
+			foreach(lc, ((CustomScan *) plan)->custom_plans)
+				JumblePlan(jstate, stmt, (Plan *) lfirst(lc));
+			break;
+		default:
+			break;
+	}
+
+	JumblePlan(jstate, stmt, plan->lefttree);
+	JumblePlan(jstate, stmt, plan->righttree);
+}
+
 /*
  * Generate a normalized version of the query string that will be used to
  * represent all similar queries.
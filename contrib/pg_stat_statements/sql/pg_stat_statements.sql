@@ -253,6 +253,54 @@ SELECT query, calls, rows FROM pg_stat_statements ORDER BY query COLLATE "C";
 SELECT pg_stat_statements_reset(0,0,0);
 SELECT query, calls, rows FROM pg_stat_statements ORDER BY query COLLATE "C";
 
+--
+-- execution time histograms
+--
+SELECT pg_stat_statements_reset();
+SELECT 42 AS "HIST";
+SELECT 42 AS "HIST";
+SELECT 42 AS "HIST";
+SELECT s.calls, sum(h.calls) AS hist_calls,
+       bool_and(h.lower_bound < h.upper_bound) AS bounds_ok
+  FROM pg_stat_statements s
+  JOIN pg_stat_statements_histogram h USING (userid, dbid, queryid, planid)
+  WHERE s.query = 'SELECT $1 AS "HIST"'
+  GROUP BY s.calls;
+
+--
+-- separate entries for each plan
+--
+SET pg_stat_statements.track_utility = FALSE;
+SET pg_stat_statements.track_planid = TRUE;
+CREATE TABLE plan_test (a int PRIMARY KEY, b int);
+INSERT INTO plan_test SELECT g, g FROM generate_series(1, 100) g;
+SELECT pg_stat_statements_reset();
+SET enable_seqscan = off;
+SELECT b FROM plan_test WHERE a = 1;
+SELECT b FROM plan_test WHERE a = 2;
+RESET enable_seqscan;
+SET enable_indexscan = off;
+SET enable_bitmapscan = off;
+SELECT b FROM plan_test WHERE a = 3;
+RESET enable_indexscan;
+RESET enable_bitmapscan;
+SELECT query, calls FROM pg_stat_statements
+  WHERE query LIKE '%plan_test%' ORDER BY calls;
+SELECT count(DISTINCT queryid) AS queries, count(DISTINCT planid) AS plans
+  FROM pg_stat_statements WHERE query = 'SELECT b FROM plan_test WHERE a = $1';
+RESET pg_stat_statements.track_planid;
+DROP TABLE plan_test;
+
+--
+-- wait event sampling
+--
+SET pg_stat_statements.wait_sample_interval = 1;
+SELECT pg_stat_statements_reset();
+SELECT pg_sleep(0.1);
+SELECT other_wait_time > 0 AS sampled_sleep
+  FROM pg_stat_statements WHERE query = 'SELECT pg_sleep($1)';
+RESET pg_stat_statements.wait_sample_interval;
+
 --
 -- cleanup
 --
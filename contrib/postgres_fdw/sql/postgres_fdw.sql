@@ -2530,3 +2530,212 @@ SELECT 1 FROM ft1 LIMIT 1;
 ALTER SERVER loopback OPTIONS (ADD use_remote_estimate 'off');
 -- The invalid connection gets closed in pgfdw_xact_callback during commit.
 COMMIT;
+
+-- ===================================================================
+-- test asynchronous execution
+-- ===================================================================
+
+ALTER SERVER loopback OPTIONS (ADD async_capable 'true');
+ALTER SERVER loopback2 OPTIONS (ADD async_capable 'true');
+
+CREATE TABLE async_pt (a int, b int, c text) PARTITION BY RANGE (a);
+CREATE TABLE base_tbl1 (a int, b int, c text);
+CREATE TABLE base_tbl2 (a int, b int, c text);
+CREATE FOREIGN TABLE async_p1 PARTITION OF async_pt FOR VALUES FROM (1000) TO (2000)
+  SERVER loopback OPTIONS (table_name 'base_tbl1');
+CREATE FOREIGN TABLE async_p2 PARTITION OF async_pt FOR VALUES FROM (2000) TO (3000)
+  SERVER loopback2 OPTIONS (table_name 'base_tbl2');
+INSERT INTO async_p1 SELECT 1000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+INSERT INTO async_p2 SELECT 2000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+ANALYZE async_pt;
+
+-- simple queries
+CREATE TABLE result_tbl (a int, b int, c text);
+
+EXPLAIN (VERBOSE, COSTS OFF)
+INSERT INTO result_tbl SELECT * FROM async_pt WHERE b % 100 = 0;
+INSERT INTO result_tbl SELECT * FROM async_pt WHERE b % 100 = 0;
+
+SELECT * FROM result_tbl ORDER BY a;
+DELETE FROM result_tbl;
+
+-- Check case where multiple partitions use the same connection
+CREATE TABLE base_tbl3 (a int, b int, c text);
+CREATE FOREIGN TABLE async_p3 PARTITION OF async_pt FOR VALUES FROM (3000) TO (4000)
+  SERVER loopback2 OPTIONS (table_name 'base_tbl3');
+INSERT INTO async_p3 SELECT 3000 + i, i, to_char(i, 'FM0000') FROM generate_series(0, 999, 5) i;
+ANALYZE async_pt;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+INSERT INTO result_tbl SELECT * FROM async_pt WHERE b = 505;
+INSERT INTO result_tbl SELECT * FROM async_pt WHERE b = 505;
+
+SELECT * FROM result_tbl ORDER BY a;
+DELETE FROM result_tbl;
+
+DROP FOREIGN TABLE async_p3;
+DROP TABLE base_tbl3;
+
+-- Test that an async Append stops cleanly under a LIMIT, leaving the
+-- connections usable
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT * FROM async_pt t1 WHERE t1.a + t1.b = 3010 LIMIT 1;
+SELECT * FROM async_pt t1 WHERE t1.a + t1.b = 3010 LIMIT 1;
+SELECT count(*) FROM (SELECT * FROM async_pt LIMIT 10) ss;
+SELECT count(*) FROM async_pt;
+
+-- Test rescans of an async Append, with a parameter that changes
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT * FROM (VALUES (505), (705)) v(x),
+  LATERAL (SELECT * FROM async_pt t2 WHERE t2.b = v.x OFFSET 0) ss
+ORDER BY v.x, ss.a;
+SELECT * FROM (VALUES (505), (705)) v(x),
+  LATERAL (SELECT * FROM async_pt t2 WHERE t2.b = v.x OFFSET 0) ss
+ORDER BY v.x, ss.a;
+
+-- Disable async execution
+SET enable_async_append TO false;
+
+EXPLAIN (VERBOSE, COSTS OFF)
+SELECT * FROM async_pt WHERE b % 100 = 0;
+RESET enable_async_append;
+
+-- Clean up
+DROP TABLE async_pt;
+DROP TABLE base_tbl1;
+DROP TABLE base_tbl2;
+DROP TABLE result_tbl;
+
+ALTER SERVER loopback OPTIONS (DROP async_capable);
+ALTER SERVER loopback2 OPTIONS (DROP async_capable);
+
+-- ===================================================================
+-- batch insert
+-- ===================================================================
+
+BEGIN;
+
+CREATE SERVER batch10 FOREIGN DATA WRAPPER postgres_fdw OPTIONS( batch_size '10' );
+
+SELECT count(*)
+FROM pg_foreign_server
+WHERE srvname = 'batch10'
+AND srvoptions @> array['batch_size=10'];
+ALTER SERVER batch10 OPTIONS( SET batch_size '20' );
+
+SELECT count(*)
+FROM pg_foreign_server
+WHERE srvname = 'batch10'
+AND srvoptions @> array['batch_size=20'];
+CREATE FOREIGN TABLE table30 ( x int ) SERVER batch10 OPTIONS ( batch_size '30' );
+
+SELECT count(*)
+FROM pg_foreign_table
+WHERE ftrelid = 'table30'::regclass
+AND ftoptions @> array['batch_size=30'];
+ROLLBACK;
+
+ALTER SERVER loopback OPTIONS (ADD batch_size '0');
+
+CREATE TABLE batch_table ( x int );
+
+CREATE FOREIGN TABLE ftable ( x int ) SERVER loopback OPTIONS ( table_name 'batch_table', batch_size '10' );
+EXPLAIN (VERBOSE, COSTS OFF) INSERT INTO ftable SELECT * FROM generate_series(1, 10) i;
+INSERT INTO ftable SELECT * FROM generate_series(1, 10) i;
+INSERT INTO ftable SELECT * FROM generate_series(11, 31) i;
+INSERT INTO ftable VALUES (32);
+INSERT INTO ftable VALUES (33), (34);
+SELECT count(*), sum(x) FROM ftable;
+TRUNCATE batch_table;
+DROP FOREIGN TABLE ftable;
+
+-- Disable batch insert
+CREATE FOREIGN TABLE ftable ( x int ) SERVER loopback OPTIONS ( table_name 'batch_table', batch_size '1' );
+EXPLAIN (VERBOSE, COSTS OFF) INSERT INTO ftable VALUES (1), (2);
+INSERT INTO ftable VALUES (1), (2);
+SELECT count(*) FROM ftable;
+DROP FOREIGN TABLE ftable;
+DROP TABLE batch_table;
+
+-- The batch size is limited by the 65535 parameters a statement can have
+CREATE TABLE batch_table ( x int, y text );
+CREATE FOREIGN TABLE ftable ( x int, y text ) SERVER loopback
+  OPTIONS ( table_name 'batch_table', batch_size '100000' );
+EXPLAIN (ANALYZE, VERBOSE, COSTS OFF, TIMING OFF, SUMMARY OFF)
+INSERT INTO ftable SELECT i, i::text FROM generate_series(1, 70000) i;
+SELECT count(*), sum(x), count(DISTINCT y) FROM ftable;
+DROP FOREIGN TABLE ftable;
+DROP TABLE batch_table;
+
+-- Batches are kept per foreign partition when rows are routed
+CREATE TABLE batch_table ( x int ) PARTITION BY HASH (x);
+
+CREATE TABLE batch_table_p0 (LIKE batch_table);
+CREATE FOREIGN TABLE batch_table_p0f
+	PARTITION OF batch_table
+	FOR VALUES WITH (MODULUS 3, REMAINDER 0)
+	SERVER loopback
+	OPTIONS (table_name 'batch_table_p0', batch_size '10');
+
+CREATE TABLE batch_table_p1 (LIKE batch_table);
+CREATE FOREIGN TABLE batch_table_p1f
+	PARTITION OF batch_table
+	FOR VALUES WITH (MODULUS 3, REMAINDER 1)
+	SERVER loopback
+	OPTIONS (table_name 'batch_table_p1', batch_size '1');
+
+CREATE TABLE batch_table_p2
+	PARTITION OF batch_table
+	FOR VALUES WITH (MODULUS 3, REMAINDER 2);
+
+INSERT INTO batch_table SELECT * FROM generate_series(1, 66) i;
+SELECT count(*), sum(x) FROM batch_table;
+SELECT (SELECT count(*) FROM batch_table_p0) +
+       (SELECT count(*) FROM batch_table_p1) +
+       (SELECT count(*) FROM batch_table_p2) AS total;
+
+-- Check that batching doesn't interfere with cross-partition updates
+CREATE TABLE batch_cp_upd_test (a int) PARTITION BY LIST (a);
+CREATE TABLE batch_cp_upd_test1 (LIKE batch_cp_upd_test);
+CREATE FOREIGN TABLE batch_cp_upd_test1_f
+	PARTITION OF batch_cp_upd_test
+	FOR VALUES IN (1)
+	SERVER loopback
+	OPTIONS (table_name 'batch_cp_upd_test1', batch_size '10');
+CREATE TABLE batch_cp_up_test1 PARTITION OF batch_cp_upd_test
+	FOR VALUES IN (2);
+INSERT INTO batch_cp_upd_test VALUES (1), (2);
+
+-- The following moves a row from the local partition to the foreign one
+UPDATE batch_cp_upd_test t SET a = 1 FROM (VALUES (1), (2)) s(a) WHERE t.a = s.a;
+SELECT tableoid::regclass, * FROM batch_cp_upd_test;
+
+-- Clean up
+DROP TABLE batch_table, batch_cp_upd_test, batch_table_p0, batch_table_p1, batch_cp_upd_test1 CASCADE;
+
+-- ===================================================================
+-- test adaptive fetch size
+-- ===================================================================
+-- Without fetch_size, the number of rows per FETCH follows the width of the
+-- rows received so far.  Scan a table whose row width changes part way
+-- through, and check that every row comes back exactly once.
+CREATE TABLE fetch_tbl (id int, t text);
+INSERT INTO fetch_tbl SELECT i, repeat('x', 10) FROM generate_series(1, 15000) i;
+INSERT INTO fetch_tbl SELECT i, repeat('y', 5000) FROM generate_series(15001, 15600) i;
+INSERT INTO fetch_tbl SELECT i, repeat('z', 10) FROM generate_series(15601, 30000) i;
+CREATE FOREIGN TABLE ft_fetch (id int, t text)
+  SERVER loopback OPTIONS (table_name 'fetch_tbl');
+
+SELECT count(*), count(DISTINCT id), sum(length(t))
+  FROM (SELECT * FROM ft_fetch OFFSET 0) ss;
+SELECT id, length(t) FROM (SELECT * FROM ft_fetch OFFSET 0) ss
+  WHERE id IN (1, 15000, 15001, 15600, 15601, 30000) ORDER BY id;
+
+-- A configured fetch_size is used as is
+ALTER FOREIGN TABLE ft_fetch OPTIONS (ADD fetch_size '101');
+SELECT count(*), count(DISTINCT id), sum(length(t))
+  FROM (SELECT * FROM ft_fetch OFFSET 0) ss;
+
+-- Clean up
+DROP FOREIGN TABLE ft_fetch;
+DROP TABLE fetch_tbl;
@@ -0,0 +1,46 @@
+-- predictability
+SET synchronous_commit = on;
+
+SELECT 'init' FROM pg_create_logical_replication_slot('regression_slot', 'test_decoding');
+
+CREATE TABLE stream_test(data text);
+
+-- consume DDL
+SELECT data FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1');
+
+-- Transactions larger than logical_decoding_work_mem are streamed in several
+-- blocks.  The number of blocks depends on the size of the decoded changes,
+-- so only check which kinds of output we got.
+
+-- streamed, then committed
+BEGIN;
+SELECT 'msg1' FROM pg_logical_emit_message(true, 'test', 'msg1');
+INSERT INTO stream_test SELECT 'stream-commit-' || g.i FROM generate_series(1, 5000) g(i);
+COMMIT;
+SELECT DISTINCT data FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1') ORDER BY data;
+
+-- streamed, then aborted
+BEGIN;
+INSERT INTO stream_test SELECT 'stream-abort-' || g.i FROM generate_series(1, 5000) g(i);
+ROLLBACK;
+-- nothing flushes the abort record, and only flushed WAL is decoded
+CHECKPOINT;
+SELECT DISTINCT data FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1') ORDER BY data;
+
+-- streamed subtransaction rolled back, rest of the transaction committed
+BEGIN;
+SAVEPOINT s1;
+INSERT INTO stream_test SELECT 'stream-subxact-' || g.i FROM generate_series(1, 5000) g(i);
+ROLLBACK TO s1;
+INSERT INTO stream_test VALUES ('stream-after-rollback');
+COMMIT;
+SELECT DISTINCT data FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1', 'stream-changes', '1') ORDER BY data;
+
+-- without the option, the same transaction is decoded at commit
+BEGIN;
+INSERT INTO stream_test SELECT 'stream-off-' || g.i FROM generate_series(1, 5000) g(i);
+COMMIT;
+SELECT count(*) FROM pg_logical_slot_get_changes('regression_slot', NULL, NULL, 'include-xids', '0', 'skip-empty-xacts', '1') WHERE data ~ 'INSERT';
+
+DROP TABLE stream_test;
+SELECT pg_drop_replication_slot('regression_slot');
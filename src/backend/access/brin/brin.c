@@ -19,6 +19,8 @@
 #include "access/brin_page.h"
 #include "access/brin_pageops.h"
 #include "access/brin_xlog.h"
+#include "access/genam.h"
+#include "access/htup_details.h"
 #include "access/relation.h"
 #include "access/reloptions.h"
 #include "access/relscan.h"
@@ -27,13 +29,18 @@
 #include "access/xloginsert.h"
 #include "catalog/index.h"
 #include "catalog/pg_am.h"
+#include "catalog/pg_index.h"
+#include "commands/vacuum.h"
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/fmgroids.h"
 #include "utils/index_selfuncs.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 
@@ -101,6 +108,7 @@ brinhandler(PG_FUNCTION_ARGS)
 	amroutine->ampredlocks = false;
 	amroutine->amcanparallel = false;
 	amroutine->amcaninclude = false;
+	amroutine->amparallelvacuumoptions = VACUUM_OPTION_PARALLEL_CLEANUP;
 	amroutine->amkeytype = InvalidOid;
 
 	amroutine->ambuild = brinbuild;
@@ -1107,6 +1115,239 @@ brinGetStats(Relation index, BrinStatsData *stats)
 	UnlockReleaseBuffer(metabuffer);
 }
 
+/*
+ * Determine which heap blocks may contain rows satisfying "attno <op> value",
+ * according to the summaries of a BRIN index on that column.
+ *
+ * Looks for a valid, non-partial BRIN index on heapRel whose first column is
+ * attno and whose operator family has an operator for the given strategy and
+ * value type.  If one is found, the candidate blocks are returned in *blocks
+ * as a lossy bitmap (unsummarized ranges are always included), and the
+ * return value is the number of candidate blocks.  If no suitable index
+ * exists, *blocks is set to NULL and InvalidBlockNumber is returned; callers
+ * must then assume every block can match.
+ *
+ * This lets callers outside the executor, such as the storage offload path,
+ * skip page ranges that can't match a simple range predicate without having
+ * to read them first.
+ */
+BlockNumber
+brin_candidate_blocks(Relation heapRel, AttrNumber attno,
+					  StrategyNumber strategy, Datum value, Oid valtype,
+					  Snapshot snapshot, TIDBitmap **blocks)
+{
+	List	   *indexoidlist;
+	ListCell   *lc;
+	BlockNumber nblocks = InvalidBlockNumber;
+
+	*blocks = NULL;
+
+	indexoidlist = RelationGetIndexList(heapRel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	idxRel;
+		Oid			atttype;
+		Oid			oproid;
+		ScanKeyData skey;
+		IndexScanDesc scan;
+		TIDBitmap  *tbm;
+		TBMIterator *iterator;
+		TBMIterateResult *tbmres;
+		BlockNumber heapBlocks;
+
+		idxRel = index_open(lfirst_oid(lc), AccessShareLock);
+
+		if (idxRel->rd_rel->relam != BRIN_AM_OID ||
+			!idxRel->rd_index->indisvalid ||
+			idxRel->rd_index->indkey.values[0] != attno ||
+			!heap_attisnull(idxRel->rd_indextuple, Anum_pg_index_indpred,
+							NULL))
+		{
+			index_close(idxRel, AccessShareLock);
+			continue;
+		}
+
+		atttype = TupleDescAttr(RelationGetDescr(heapRel), attno - 1)->atttypid;
+		oproid = get_opfamily_member(idxRel->rd_opfamily[0], atttype, valtype,
+									 strategy);
+		if (!OidIsValid(oproid))
+		{
+			index_close(idxRel, AccessShareLock);
+			continue;
+		}
+
+		ScanKeyEntryInitialize(&skey, 0, 1, strategy, valtype,
+							   idxRel->rd_indcollation[0],
+							   get_opcode(oproid), value);
+
+		tbm = tbm_create(work_mem * 1024L, NULL);
+		scan = index_beginscan_bitmap(idxRel, snapshot, 1);
+		index_rescan(scan, &skey, 1, NULL, 0);
+		index_getbitmap(scan, tbm);
+		index_endscan(scan);
+		index_close(idxRel, AccessShareLock);
+
+		/* The last range may extend past the end of the table */
+		heapBlocks = RelationGetNumberOfBlocks(heapRel);
+		nblocks = 0;
+		iterator = tbm_begin_iterate(tbm);
+		while ((tbmres = tbm_iterate(iterator)) != NULL)
+		{
+			if (tbmres->blockno < heapBlocks)
+				nblocks++;
+		}
+		tbm_end_iterate(iterator);
+
+		*blocks = tbm;
+		break;
+	}
+
+	list_free(indexoidlist);
+
+	return nblocks;
+}
+
+/*
+ * Bound the minimum or maximum of a column using the summaries of a BRIN
+ * minmax index on it.
+ *
+ * 'sortop' is the ordering operator of a MIN or MAX aggregate over column
+ * attno of heapRel.  Looks for a valid, non-partial BRIN index whose first
+ * column is attno, whose opclass is a minmax one and whose operator family
+ * has sortop as its "<" or ">" operator.  For "<" (MIN), *bound is set to the
+ * smallest maximum of any summarized range and *boundop to the family's "<="
+ * operator; for ">" (MAX), to the largest minimum and ">=".  Unless every row
+ * of that range that held the bound value has since been deleted, the
+ * column's minimum (maximum) satisfies "attno boundop bound", so it can be
+ * found by scanning only the ranges that hold such values.  Summaries never
+ * shrink, though, so callers must be prepared for no live row to satisfy it.
+ *
+ * Returns false if no suitable index exists, or if no summarized range holds
+ * a non-null value.
+ */
+bool
+brin_minmax_bound(Relation heapRel, AttrNumber attno, Oid sortop,
+				  Oid *boundop, Datum *bound)
+{
+	List	   *indexoidlist;
+	ListCell   *lc;
+	bool		found = false;
+
+	indexoidlist = RelationGetIndexList(heapRel);
+	foreach(lc, indexoidlist)
+	{
+		Relation	idxRel;
+		Form_pg_attribute attr;
+		int			strategy;
+		BrinDesc   *bdesc;
+		BrinRevmap *revmap;
+		BlockNumber pagesPerRange;
+		BlockNumber nblocks;
+		BlockNumber heapBlk;
+		Buffer		buf = InvalidBuffer;
+		BrinTuple  *btup = NULL;
+		Size		btupsz = 0;
+		BrinMemTuple *dtup;
+		FmgrInfo	cmpfn;
+		MemoryContext perRangeCxt;
+		MemoryContext oldcxt;
+
+		idxRel = index_open(lfirst_oid(lc), AccessShareLock);
+
+		if (idxRel->rd_rel->relam != BRIN_AM_OID ||
+			!idxRel->rd_index->indisvalid ||
+			idxRel->rd_index->indkey.values[0] != attno ||
+			!heap_attisnull(idxRel->rd_indextuple, Anum_pg_index_indpred,
+							NULL) ||
+			index_getprocid(idxRel, 1, BRIN_PROCNUM_OPCINFO) != F_BRIN_MINMAX_OPCINFO)
+		{
+			index_close(idxRel, AccessShareLock);
+			continue;
+		}
+
+		attr = TupleDescAttr(RelationGetDescr(heapRel), attno - 1);
+		strategy = get_op_opfamily_strategy(sortop, idxRel->rd_opfamily[0]);
+		if (strategy != BTLessStrategyNumber &&
+			strategy != BTGreaterStrategyNumber)
+		{
+			index_close(idxRel, AccessShareLock);
+			continue;
+		}
+		*boundop = get_opfamily_member(idxRel->rd_opfamily[0],
+									   attr->atttypid, attr->atttypid,
+									   strategy == BTLessStrategyNumber ?
+									   BTLessEqualStrategyNumber :
+									   BTGreaterEqualStrategyNumber);
+		if (!OidIsValid(*boundop))
+		{
+			index_close(idxRel, AccessShareLock);
+			continue;
+		}
+
+		fmgr_info(get_opcode(sortop), &cmpfn);
+		bdesc = brin_build_desc(idxRel);
+		dtup = brin_new_memtuple(bdesc);
+		revmap = brinRevmapInitialize(idxRel, &pagesPerRange, NULL);
+		nblocks = RelationGetNumberOfBlocks(heapRel);
+
+		perRangeCxt = AllocSetContextCreate(CurrentMemoryContext,
+											"brin_minmax_bound cxt",
+											ALLOCSET_DEFAULT_SIZES);
+		oldcxt = MemoryContextSwitchTo(perRangeCxt);
+
+		for (heapBlk = 0; heapBlk < nblocks; heapBlk += pagesPerRange)
+		{
+			BrinTuple  *tup;
+			OffsetNumber off;
+			Size		size;
+			BrinValues *bval;
+			Datum		value;
+
+			CHECK_FOR_INTERRUPTS();
+
+			tup = brinGetTupleForHeapBlock(revmap, heapBlk, &buf, &off, &size,
+										   BUFFER_LOCK_SHARE, NULL);
+			if (tup == NULL)
+				continue;
+			btup = brin_copy_tuple(tup, size, btup, &btupsz);
+			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+
+			dtup = brin_deform_tuple(bdesc, btup, dtup);
+			bval = &dtup->bt_columns[0];
+			if (dtup->bt_placeholder || bval->bv_allnulls)
+				continue;
+
+			/* The range maximum bounds a minimum, and vice versa */
+			value = bval->bv_values[strategy == BTLessStrategyNumber ? 1 : 0];
+			if (!found ||
+				DatumGetBool(FunctionCall2Coll(&cmpfn,
+											   idxRel->rd_indcollation[0],
+											   value, *bound)))
+			{
+				MemoryContextSwitchTo(oldcxt);
+				if (found && !attr->attbyval)
+					pfree(DatumGetPointer(*bound));
+				*bound = datumCopy(value, attr->attbyval, attr->attlen);
+				found = true;
+				MemoryContextSwitchTo(perRangeCxt);
+			}
+		}
+
+		MemoryContextSwitchTo(oldcxt);
+		MemoryContextDelete(perRangeCxt);
+		if (BufferIsValid(buf))
+			ReleaseBuffer(buf);
+		brinRevmapTerminate(revmap);
+		brin_free_desc(bdesc);
+		index_close(idxRel, AccessShareLock);
+		break;
+	}
+
+	list_free(indexoidlist);
+
+	return found;
+}
+
 /*
  * Initialize a BrinBuildState appropriate to create tuples on the given index.
  */
@@ -16,18 +16,136 @@
 
 #include "access/gin_private.h"
 #include "access/ginxlog.h"
+#include "access/parallel.h"
+#include "access/table.h"
+#include "access/xact.h"
 #include "access/xloginsert.h"
 #include "access/tableam.h"
 #include "catalog/index.h"
+#include "executor/instrument.h"
+#include "lib/binaryheap.h"
 #include "miscadmin.h"
+#include "pgstat.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
+#include "storage/condition_variable.h"
+#include "storage/sharedfileset.h"
 #include "storage/smgr.h"
 #include "storage/indexfsm.h"
 #include "storage/predicate.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/datum.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 
 
+/* Magic numbers for parallel state sharing */
+#define PARALLEL_KEY_GIN_SHARED			UINT64CONST(0xB000000000000001)
+#define PARALLEL_KEY_GIN_RUNS			UINT64CONST(0xB000000000000002)
+#define PARALLEL_KEY_QUERY_TEXT			UINT64CONST(0xB000000000000003)
+#define PARALLEL_KEY_BUFFER_USAGE		UINT64CONST(0xB000000000000004)
+
+/*
+ * Status for GIN index builds performed in parallel.  This is allocated in a
+ * dynamic shared memory segment.
+ *
+ * Each participant scans a share of the heap through a parallel heap scan,
+ * and accumulates entries in its own BuildAccumulator as in a serial build.
+ * Whenever its memory budget fills up (and at the end of the scan), it
+ * writes the accumulated entries out as a sorted run in a shared temporary
+ * file, instead of inserting them into the index.  The leader then merges
+ * all the runs, combining the TID lists of equal keys, and inserts each key
+ * exactly once.
+ */
+typedef struct GinShared
+{
+	/*
+	 * These fields are not modified during the build.  They primarily exist
+	 * for the benefit of worker processes that need to set up the same state
+	 * as the leader.
+	 */
+	Oid			heaprelid;
+	Oid			indexrelid;
+	bool		isconcurrent;
+	int			nparticipants;
+
+	/*
+	 * workersdonecv is used to monitor the progress of workers.  All parallel
+	 * participants must indicate that they are done before leader can start
+	 * merging their runs.
+	 */
+	ConditionVariable workersdonecv;
+
+	/*
+	 * mutex protects all fields before fileset, as well as the per
+	 * participant run counts stored under PARALLEL_KEY_GIN_RUNS.
+	 *
+	 * nparticipantsdone is number of participants finished.
+	 *
+	 * reltuples is the total number of input heap tuples.
+	 *
+	 * indtuples is the total number of entries extracted.
+	 */
+	slock_t		mutex;
+	int			nparticipantsdone;
+	double		reltuples;
+	double		indtuples;
+
+	/* Temporary files holding the sorted runs */
+	SharedFileSet fileset;
+
+	/*
+	 * ParallelTableScanDescData data follows. Can't directly embed here, as
+	 * implementations of the parallel table scan desc interface might need
+	 * stronger alignment.
+	 */
+} GinShared;
+
+/*
+ * Return pointer to a GinShared's parallel table scan.
+ *
+ * c.f. shm_toc_allocate as to why BUFFERALIGN is used, rather than just
+ * MAXALIGN.
+ */
+#define ParallelTableScanFromGinShared(shared) \
+	(ParallelTableScanDesc) ((char *) (shared) + BUFFERALIGN(sizeof(GinShared)))
+
+/*
+ * Status for leader in parallel index build.
+ */
+typedef struct GinLeader
+{
+	/* parallel context itself */
+	ParallelContext *pcxt;
+
+	/*
+	 * nparticipants is the exact number of worker processes successfully
+	 * launched, plus one for the leader, which always participates.
+	 */
+	int			nparticipants;
+
+	/*
+	 * Leader process convenience pointers to shared state (leader avoids TOC
+	 * lookups).  runs[i] is the number of runs written by participant i.
+	 * snapshot is the snapshot used by the scan iff an MVCC snapshot is
+	 * required.
+	 */
+	GinShared  *ginshared;
+	int		   *runs;
+	Snapshot	snapshot;
+	BufferUsage *bufferusage;
+} GinLeader;
+
+/*
+ * Working state for ginbuild and its callback.
+ *
+ * When GIN index is built in parallel, there is a GinBuildState for each
+ * participant.  ginshared is set (and the participant number is valid) only
+ * in participants, which write sorted runs instead of inserting entries into
+ * the index.
+ */
 typedef struct
 {
 	GinState	ginstate;
@@ -36,8 +154,61 @@ typedef struct
 	MemoryContext tmpCtx;
 	MemoryContext funcCtx;
 	BuildAccumulator accum;
+	int			workmem;		/* accumulator memory budget, in KB */
+
+	/* parallel build state */
+	GinLeader  *ginleader;		/* set in leader of a parallel build */
+	GinShared  *ginshared;		/* set in participants */
+	int			participant;	/* this participant's number */
+	int			nruns;			/* number of runs written so far */
 } GinBuildState;
 
+/*
+ * Header of each entry in a sorted run.  It is followed by keylen bytes of
+ * key datum (the Datum itself for pass-by-value types) and nitems heap TIDs,
+ * in TID order.  A header with attnum == InvalidOffsetNumber ends the run.
+ */
+typedef struct GinRunEntryHeader
+{
+	OffsetNumber attnum;
+	GinNullCategory category;
+	uint32		keylen;
+	uint32		nitems;
+} GinRunEntryHeader;
+
+/*
+ * State for reading one sorted run during the leader's merge.  The current
+ * entry's key and TIDs are allocated in cxt, which is reset on each advance.
+ */
+typedef struct GinRunReader
+{
+	BufFile    *file;
+	MemoryContext cxt;
+	OffsetNumber attnum;		/* InvalidOffsetNumber once exhausted */
+	GinNullCategory category;
+	Datum		key;
+	ItemPointerData *items;
+	uint32		nitems;
+} GinRunReader;
+
+static void ginBuildDump(GinBuildState *buildstate);
+static void _gin_begin_parallel(GinBuildState *buildstate, Relation heap,
+								Relation index, bool isconcurrent,
+								int request);
+static void _gin_end_parallel(GinLeader *ginleader);
+static Size _gin_parallel_estimate_shared(Relation heap, Snapshot snapshot);
+static double _gin_parallel_heapscan(GinBuildState *buildstate);
+static void _gin_parallel_merge(GinBuildState *buildstate);
+static void _gin_leader_participate_as_worker(GinBuildState *buildstate,
+											  Relation heap, Relation index);
+static void _gin_parallel_scan_and_build(GinShared *ginshared, int *runs,
+										 int participant, Relation heap,
+										 Relation index, int workmem,
+										 bool progress);
+static void _gin_write_run(GinBuildState *buildstate);
+static bool _gin_read_run_entry(GinState *ginstate, GinRunReader *reader);
+static int	_gin_reader_cmp(Datum a, Datum b, void *arg);
+
 
 /*
  * Adds array of item pointers to tuple's posting list, or
@@ -287,25 +458,10 @@ ginBuildCallback(Relation index, HeapTuple htup, Datum *values,
 							   values[i], isnull[i],
 							   &htup->t_self);
 
-	/* If we've maxed out our available memory, dump everything to the index */
-	if (buildstate->accum.allocatedMemory >= (Size) maintenance_work_mem * 1024L)
+	/* If we've maxed out our available memory, dump everything */
+	if (buildstate->accum.allocatedMemory >= (Size) buildstate->workmem * 1024L)
 	{
-		ItemPointerData *list;
-		Datum		key;
-		GinNullCategory category;
-		uint32		nlist;
-		OffsetNumber attnum;
-
-		ginBeginBAScan(&buildstate->accum);
-		while ((list = ginGetBAEntry(&buildstate->accum,
-									 &attnum, &key, &category, &nlist)) != NULL)
-		{
-			/* there could be many entries, so be willing to abort here */
-			CHECK_FOR_INTERRUPTS();
-			ginEntryInsert(&buildstate->ginstate, attnum, key, category,
-						   list, nlist, &buildstate->buildStats);
-		}
-
+		ginBuildDump(buildstate);
 		MemoryContextReset(buildstate->tmpCtx);
 		ginInitBA(&buildstate->accum);
 	}
@@ -313,6 +469,36 @@ ginBuildCallback(Relation index, HeapTuple htup, Datum *values,
 	MemoryContextSwitchTo(oldCtx);
 }
 
+/*
+ * Dump everything in the BuildAccumulator: into the index in a serial build,
+ * or into a new sorted run in a parallel build participant.
+ */
+static void
+ginBuildDump(GinBuildState *buildstate)
+{
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+
+	if (buildstate->ginshared)
+	{
+		_gin_write_run(buildstate);
+		return;
+	}
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+		ginEntryInsert(&buildstate->ginstate, attnum, key, category,
+					   list, nlist, &buildstate->buildStats);
+	}
+}
+
 IndexBuildResult *
 ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 {
@@ -321,12 +507,7 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	GinBuildState buildstate;
 	Buffer		RootBuffer,
 				MetaBuffer;
-	ItemPointerData *list;
-	Datum		key;
-	GinNullCategory category;
-	uint32		nlist;
 	MemoryContext oldCtx;
-	OffsetNumber attnum;
 
 	if (RelationGetNumberOfBlocks(index) != 0)
 		elog(ERROR, "index \"%s\" already contains data",
@@ -335,6 +516,11 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	initGinState(&buildstate.ginstate, index);
 	buildstate.indtuples = 0;
 	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.workmem = maintenance_work_mem;
+	buildstate.ginleader = NULL;
+	buildstate.ginshared = NULL;
+	buildstate.participant = -1;
+	buildstate.nruns = 0;
 
 	/* initialize the meta page */
 	MetaBuffer = GinNewBuffer(index);
@@ -376,25 +562,36 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	ginInitBA(&buildstate.accum);
 
 	/*
-	 * Do the heap scan.  We disallow sync scan here because dataPlaceToPage
-	 * prefers to receive tuples in TID order.
+	 * Attempt to launch parallel worker scan when required.  The workers
+	 * (and the leader, as a participant) produce sorted runs, which we then
+	 * merge into the index.
 	 */
-	reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
-									   ginBuildCallback, (void *) &buildstate,
-									   NULL);
+	if (indexInfo->ii_ParallelWorkers > 0)
+		_gin_begin_parallel(&buildstate, heap, index,
+							indexInfo->ii_Concurrent,
+							indexInfo->ii_ParallelWorkers);
 
-	/* dump remaining entries to the index */
-	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
-	ginBeginBAScan(&buildstate.accum);
-	while ((list = ginGetBAEntry(&buildstate.accum,
-								 &attnum, &key, &category, &nlist)) != NULL)
+	if (buildstate.ginleader)
 	{
-		/* there could be many entries, so be willing to abort here */
-		CHECK_FOR_INTERRUPTS();
-		ginEntryInsert(&buildstate.ginstate, attnum, key, category,
-					   list, nlist, &buildstate.buildStats);
+		reltuples = _gin_parallel_heapscan(&buildstate);
+		_gin_parallel_merge(&buildstate);
+		_gin_end_parallel(buildstate.ginleader);
+	}
+	else
+	{
+		/*
+		 * Do the heap scan.  We disallow sync scan here because
+		 * dataPlaceToPage prefers to receive tuples in TID order.
+		 */
+		reltuples = table_index_build_scan(heap, index, indexInfo, false, true,
+										   ginBuildCallback,
+										   (void *) &buildstate, NULL);
+
+		/* dump remaining entries to the index */
+		oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+		ginBuildDump(&buildstate);
+		MemoryContextSwitchTo(oldCtx);
 	}
-	MemoryContextSwitchTo(oldCtx);
 
 	MemoryContextDelete(buildstate.funcCtx);
 	MemoryContextDelete(buildstate.tmpCtx);
@@ -427,6 +624,736 @@ ginbuild(Relation heap, Relation index, IndexInfo *indexInfo)
 	return result;
 }
 
+/*
+ * Create parallel context, and launch workers for leader.
+ *
+ * buildstate argument should be initialized (with the exception of the
+ * parallel state fields, which are set here).
+ *
+ * isconcurrent indicates if operation is CREATE INDEX CONCURRENTLY.
+ *
+ * request is the target number of parallel worker processes to launch.
+ *
+ * Sets buildstate's GinLeader, which caller must use to shut down parallel
+ * mode by passing it to _gin_end_parallel() at the very end of its index
+ * build.  If not even a single worker process can be launched, this is
+ * never set, and caller should proceed with a serial index build.
+ */
+static void
+_gin_begin_parallel(GinBuildState *buildstate, Relation heap, Relation index,
+					bool isconcurrent, int request)
+{
+	ParallelContext *pcxt;
+	int			nparticipants;
+	Snapshot	snapshot;
+	Size		estginshared;
+	Size		estruns;
+	GinShared  *ginshared;
+	int		   *runs;
+	GinLeader  *ginleader = (GinLeader *) palloc0(sizeof(GinLeader));
+	BufferUsage *bufferusage;
+	int			querylen;
+
+	/*
+	 * Enter parallel mode, and create context for parallel build of gin
+	 * index
+	 */
+	EnterParallelMode();
+	Assert(request > 0);
+	pcxt = CreateParallelContext("postgres", "_gin_parallel_build_main",
+								 request);
+
+	/* the leader always participates, and takes the last participant slot */
+	nparticipants = request + 1;
+
+	/*
+	 * Prepare for scan of the base relation.  In a normal index build, we use
+	 * SnapshotAny because we must retrieve all tuples and do our own time
+	 * qual checks (because we have to index RECENTLY_DEAD tuples).  In a
+	 * concurrent build, we take a regular MVCC snapshot and index whatever's
+	 * live according to that.
+	 */
+	if (!isconcurrent)
+		snapshot = SnapshotAny;
+	else
+		snapshot = RegisterSnapshot(GetTransactionSnapshot());
+
+	/*
+	 * Estimate size for our own PARALLEL_KEY_GIN_SHARED workspace, and the
+	 * per participant run counts
+	 */
+	estginshared = _gin_parallel_estimate_shared(heap, snapshot);
+	shm_toc_estimate_chunk(&pcxt->estimator, estginshared);
+	estruns = mul_size(sizeof(int), nparticipants);
+	shm_toc_estimate_chunk(&pcxt->estimator, estruns);
+	shm_toc_estimate_keys(&pcxt->estimator, 2);
+
+	/* Estimate space for BufferUsage -- PARALLEL_KEY_BUFFER_USAGE */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
+
+	/* Finally, estimate PARALLEL_KEY_QUERY_TEXT space */
+	if (debug_query_string)
+	{
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
+	else
+		querylen = 0;			/* keep compiler quiet */
+
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
+
+	/* If no DSM segment was available, back out (do serial build) */
+	if (pcxt->seg == NULL)
+	{
+		if (IsMVCCSnapshot(snapshot))
+			UnregisterSnapshot(snapshot);
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return;
+	}
+
+	/* Store shared build state, for which we reserved space */
+	ginshared = (GinShared *) shm_toc_allocate(pcxt->toc, estginshared);
+	/* Initialize immutable state */
+	ginshared->heaprelid = RelationGetRelid(heap);
+	ginshared->indexrelid = RelationGetRelid(index);
+	ginshared->isconcurrent = isconcurrent;
+	ginshared->nparticipants = nparticipants;
+	ConditionVariableInit(&ginshared->workersdonecv);
+	SpinLockInit(&ginshared->mutex);
+	/* Initialize mutable state */
+	ginshared->nparticipantsdone = 0;
+	ginshared->reltuples = 0.0;
+	ginshared->indtuples = 0.0;
+	SharedFileSetInit(&ginshared->fileset, pcxt->seg);
+	table_parallelscan_initialize(heap,
+								  ParallelTableScanFromGinShared(ginshared),
+								  snapshot);
+
+	runs = (int *) shm_toc_allocate(pcxt->toc, estruns);
+	memset(runs, 0, estruns);
+
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_SHARED, ginshared);
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_GIN_RUNS, runs);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_KEY_QUERY_TEXT, sharedquery);
+	}
+
+	/* Allocate space for each worker's BufferUsage; no need to initialize */
+	bufferusage = shm_toc_allocate(pcxt->toc,
+								   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_KEY_BUFFER_USAGE, bufferusage);
+
+	/* Launch workers, saving status for leader/caller */
+	LaunchParallelWorkers(pcxt);
+	ginleader->pcxt = pcxt;
+	ginleader->nparticipants = pcxt->nworkers_launched + 1;
+	ginleader->ginshared = ginshared;
+	ginleader->runs = runs;
+	ginleader->snapshot = snapshot;
+	ginleader->bufferusage = bufferusage;
+
+	/* If no workers were successfully launched, back out (do serial build) */
+	if (pcxt->nworkers_launched == 0)
+	{
+		_gin_end_parallel(ginleader);
+		return;
+	}
+
+	/* Save leader state now that it's clear build will be parallel */
+	buildstate->ginleader = ginleader;
+
+	/* Join heap scan ourselves */
+	_gin_leader_participate_as_worker(buildstate, heap, index);
+
+	/*
+	 * Caller needs to wait for all launched workers when we return.  Make
+	 * sure that the failure-to-start case will not hang forever.
+	 */
+	WaitForParallelWorkersToAttach(pcxt);
+}
+
+/*
+ * Shut down workers, destroy parallel context, and end parallel mode.
+ */
+static void
+_gin_end_parallel(GinLeader *ginleader)
+{
+	int			i;
+
+	/* Shutdown worker processes */
+	WaitForParallelWorkersToFinish(ginleader->pcxt);
+
+	/*
+	 * Next, accumulate buffer usage.  (This must wait for the workers to
+	 * finish, or we might get incomplete data.)
+	 */
+	for (i = 0; i < ginleader->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&ginleader->bufferusage[i]);
+
+	/* Free last reference to MVCC snapshot, if one was used */
+	if (IsMVCCSnapshot(ginleader->snapshot))
+		UnregisterSnapshot(ginleader->snapshot);
+	DestroyParallelContext(ginleader->pcxt);
+	ExitParallelMode();
+}
+
+/*
+ * Returns size of shared memory required to store state for a parallel
+ * gin index build based on the snapshot its parallel scan will use.
+ */
+static Size
+_gin_parallel_estimate_shared(Relation heap, Snapshot snapshot)
+{
+	/* c.f. shm_toc_allocate as to why BUFFERALIGN is used */
+	return add_size(BUFFERALIGN(sizeof(GinShared)),
+					table_parallelscan_estimate(heap, snapshot));
+}
+
+/*
+ * Within leader, wait for end of heap scan.
+ *
+ * When called, parallel heap scan started by _gin_begin_parallel() will
+ * already be underway within worker processes (the leader has finished its
+ * own share, so we should end up here just as workers are finishing).
+ *
+ * Fills in fields needed for ambuild statistics, and returns the total
+ * number of heap tuples scanned.
+ */
+static double
+_gin_parallel_heapscan(GinBuildState *buildstate)
+{
+	GinShared  *ginshared = buildstate->ginleader->ginshared;
+	int			nparticipants;
+	double		reltuples;
+
+	/*
+	 * Workers that were requested but not launched never report in, so only
+	 * wait for the ones we got (plus ourselves).
+	 */
+	nparticipants = buildstate->ginleader->nparticipants;
+	for (;;)
+	{
+		SpinLockAcquire(&ginshared->mutex);
+		if (ginshared->nparticipantsdone == nparticipants)
+		{
+			buildstate->indtuples = ginshared->indtuples;
+			reltuples = ginshared->reltuples;
+			SpinLockRelease(&ginshared->mutex);
+			break;
+		}
+		SpinLockRelease(&ginshared->mutex);
+
+		ConditionVariableSleep(&ginshared->workersdonecv,
+							   WAIT_EVENT_PARALLEL_CREATE_INDEX_SCAN);
+	}
+
+	ConditionVariableCancelSleep();
+
+	return reltuples;
+}
+
+/*
+ * Within leader, merge the sorted runs written by all participants, and
+ * insert the result into the index.
+ *
+ * Each run is sorted by (attnum, category, key), and every key appears at
+ * most once per run, so a k-way merge brings all TIDs for a key together.
+ * Runs from different participants cover interleaved sets of heap blocks, so
+ * their TID lists for the same key overlap; they are combined with
+ * ginMergeItemPointers() before the key is inserted, which means each key is
+ * normally inserted once, with its complete TID list in order.  That is the
+ * best case for building posting trees.
+ *
+ * The combined list for a very frequent key can grow without bound, though,
+ * so once it reaches half of maintenance_work_mem (the other half is for
+ * merging into it) we insert what we have and keep collecting;
+ * ginEntryInsert() merges the rest into the existing entry or posting tree.
+ */
+static void
+_gin_parallel_merge(GinBuildState *buildstate)
+{
+	GinLeader  *ginleader = buildstate->ginleader;
+	GinState   *ginstate = &buildstate->ginstate;
+	GinRunReader *readers;
+	binaryheap *heap;
+	int			nreaders = 0;
+	int			totalruns = 0;
+	MemoryContext mergeCtx;
+	MemoryContext oldCtx;
+	OffsetNumber curattnum = InvalidOffsetNumber;
+	GinNullCategory curcategory = GIN_CAT_NORM_KEY;
+	Datum		curkey = (Datum) 0;
+	bool		havekey = false;
+	ItemPointerData *curitems = NULL;
+	uint32		curnitems = 0;
+	uint32		maxitems;
+
+	/* workers that were not launched left their counts at zero */
+	for (int i = 0; i < ginleader->ginshared->nparticipants; i++)
+		totalruns += ginleader->runs[i];
+
+	if (totalruns == 0)
+		return;
+
+	maxitems = Min((Size) maintenance_work_mem * 1024L / 2,
+				   MaxAllocSize / 2) / sizeof(ItemPointerData);
+	maxitems = Max(maxitems, 1);
+
+	/* context for the current key and its TIDs, reset after each insert */
+	mergeCtx = AllocSetContextCreate(CurrentMemoryContext,
+									 "Gin build merge context",
+									 ALLOCSET_DEFAULT_SIZES);
+
+	readers = (GinRunReader *) palloc0(sizeof(GinRunReader) * totalruns);
+	heap = binaryheap_allocate(totalruns, _gin_reader_cmp, ginstate);
+
+	for (int i = 0; i < ginleader->ginshared->nparticipants; i++)
+	{
+		for (int run = 0; run < ginleader->runs[i]; run++)
+		{
+			GinRunReader *reader = &readers[nreaders];
+			char		name[MAXPGPATH];
+
+			snprintf(name, sizeof(name), "gin.%d.%d", i, run);
+			reader->file = BufFileOpenShared(&ginleader->ginshared->fileset,
+											 name);
+			reader->cxt = AllocSetContextCreate(CurrentMemoryContext,
+												"Gin build run reader",
+												ALLOCSET_SMALL_SIZES);
+			if (_gin_read_run_entry(ginstate, reader))
+				binaryheap_add_unordered(heap, PointerGetDatum(reader));
+			nreaders++;
+		}
+	}
+	binaryheap_build(heap);
+
+	while (!binaryheap_empty(heap))
+	{
+		GinRunReader *reader;
+
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		reader = (GinRunReader *) DatumGetPointer(binaryheap_first(heap));
+
+		if (havekey &&
+			ginCompareAttEntries(ginstate,
+								 curattnum, curkey, curcategory,
+								 reader->attnum, reader->key,
+								 reader->category) == 0)
+		{
+			/* same key as the one we're collecting: combine TID lists */
+			oldCtx = MemoryContextSwitchTo(mergeCtx);
+			if (curitems == NULL)
+			{
+				curitems = palloc(sizeof(ItemPointerData) * reader->nitems);
+				memcpy(curitems, reader->items,
+					   sizeof(ItemPointerData) * reader->nitems);
+				curnitems = reader->nitems;
+			}
+			else
+			{
+				ItemPointerData *merged;
+				int			nmerged;
+
+				merged = ginMergeItemPointers(curitems, curnitems,
+											  reader->items, reader->nitems,
+											  &nmerged);
+				pfree(curitems);
+				curitems = merged;
+				curnitems = nmerged;
+			}
+			MemoryContextSwitchTo(oldCtx);
+		}
+		else
+		{
+			/* new key, so insert the previous one */
+			if (curitems != NULL)
+				ginEntryInsert(ginstate, curattnum, curkey, curcategory,
+							   curitems, curnitems, &buildstate->buildStats);
+			MemoryContextReset(mergeCtx);
+
+			oldCtx = MemoryContextSwitchTo(mergeCtx);
+			havekey = true;
+			curattnum = reader->attnum;
+			curcategory = reader->category;
+			if (curcategory == GIN_CAT_NORM_KEY)
+			{
+				Form_pg_attribute attr;
+
+				attr = TupleDescAttr(ginstate->origTupdesc, curattnum - 1);
+				curkey = datumCopy(reader->key, attr->attbyval, attr->attlen);
+			}
+			else
+				curkey = (Datum) 0;
+			curitems = palloc(sizeof(ItemPointerData) * reader->nitems);
+			memcpy(curitems, reader->items,
+				   sizeof(ItemPointerData) * reader->nitems);
+			curnitems = reader->nitems;
+			MemoryContextSwitchTo(oldCtx);
+		}
+
+		/* flush a list that has grown too large, keeping the key */
+		if (curnitems >= maxitems)
+		{
+			ginEntryInsert(ginstate, curattnum, curkey, curcategory,
+						   curitems, curnitems, &buildstate->buildStats);
+			pfree(curitems);
+			curitems = NULL;
+			curnitems = 0;
+		}
+
+		/* advance this run */
+		if (_gin_read_run_entry(ginstate, reader))
+			binaryheap_replace_first(heap, PointerGetDatum(reader));
+		else
+			(void) binaryheap_remove_first(heap);
+	}
+
+	/* insert the last key */
+	if (curitems != NULL)
+		ginEntryInsert(ginstate, curattnum, curkey, curcategory,
+					   curitems, curnitems, &buildstate->buildStats);
+
+	for (int i = 0; i < nreaders; i++)
+	{
+		BufFileClose(readers[i].file);
+		MemoryContextDelete(readers[i].cxt);
+	}
+	binaryheap_free(heap);
+	pfree(readers);
+	MemoryContextDelete(mergeCtx);
+}
+
+/*
+ * Within leader, participate as a parallel worker.
+ */
+static void
+_gin_leader_participate_as_worker(GinBuildState *buildstate, Relation heap,
+								  Relation index)
+{
+	GinLeader  *ginleader = buildstate->ginleader;
+	int			workmem;
+
+	/*
+	 * Might as well use reliable figure when doling out maintenance_work_mem
+	 * (when requested number of workers were not launched, this will be
+	 * somewhat higher than it is for other workers).
+	 */
+	workmem = maintenance_work_mem / ginleader->nparticipants;
+
+	/* Perform work common to all participants */
+	_gin_parallel_scan_and_build(ginleader->ginshared, ginleader->runs,
+								 ginleader->ginshared->nparticipants - 1,
+								 heap, index, workmem, true);
+}
+
+/*
+ * Perform work within a launched parallel process.
+ */
+void
+_gin_parallel_build_main(dsm_segment *seg, shm_toc *toc)
+{
+	char	   *sharedquery;
+	GinShared  *ginshared;
+	int		   *runs;
+	Relation	heapRel;
+	Relation	indexRel;
+	LOCKMODE	heapLockmode;
+	LOCKMODE	indexLockmode;
+	BufferUsage *bufferusage;
+	int			workmem;
+
+	/* Set debug_query_string for individual workers first */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+
+	/* Report the query string from leader */
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
+
+	/* Look up gin shared state */
+	ginshared = shm_toc_lookup(toc, PARALLEL_KEY_GIN_SHARED, false);
+	runs = shm_toc_lookup(toc, PARALLEL_KEY_GIN_RUNS, false);
+
+	/* Open relations using lock modes known to be obtained by index.c */
+	if (!ginshared->isconcurrent)
+	{
+		heapLockmode = ShareLock;
+		indexLockmode = AccessExclusiveLock;
+	}
+	else
+	{
+		heapLockmode = ShareUpdateExclusiveLock;
+		indexLockmode = RowExclusiveLock;
+	}
+
+	/* Open relations within worker */
+	heapRel = table_open(ginshared->heaprelid, heapLockmode);
+	indexRel = index_open(ginshared->indexrelid, indexLockmode);
+
+	/* Attach to the shared temporary files */
+	SharedFileSetAttach(&ginshared->fileset, seg);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	/* Scan our share of the heap, writing sorted runs */
+	workmem = maintenance_work_mem / ginshared->nparticipants;
+	_gin_parallel_scan_and_build(ginshared, runs, ParallelWorkerNumber,
+								 heapRel, indexRel, workmem, false);
+
+	/* Report buffer usage during parallel execution */
+	bufferusage = shm_toc_lookup(toc, PARALLEL_KEY_BUFFER_USAGE, false);
+	InstrEndParallelQuery(&bufferusage[ParallelWorkerNumber]);
+
+	index_close(indexRel, indexLockmode);
+	table_close(heapRel, heapLockmode);
+}
+
+/*
+ * Perform a participant's portion of a parallel build: scan a share of the
+ * heap, and write the extracted entries to sorted runs.
+ *
+ * workmem is the amount of memory the BuildAccumulator may use before a run
+ * is written, expressed in KBs.
+ *
+ * When this returns, the participant is done, and need only release
+ * resources.
+ */
+static void
+_gin_parallel_scan_and_build(GinShared *ginshared, int *runs, int participant,
+							 Relation heap, Relation index, int workmem,
+							 bool progress)
+{
+	GinBuildState buildstate;
+	TableScanDesc scan;
+	double		reltuples;
+	IndexInfo  *indexInfo;
+	MemoryContext oldCtx;
+
+	initGinState(&buildstate.ginstate, index);
+	buildstate.indtuples = 0;
+	memset(&buildstate.buildStats, 0, sizeof(GinStatsData));
+	buildstate.workmem = Max(workmem, 64);
+	buildstate.ginleader = NULL;
+	buildstate.ginshared = ginshared;
+	buildstate.participant = participant;
+	buildstate.nruns = 0;
+
+	buildstate.tmpCtx = AllocSetContextCreate(CurrentMemoryContext,
+											  "Gin build temporary context",
+											  ALLOCSET_DEFAULT_SIZES);
+	buildstate.funcCtx = AllocSetContextCreate(CurrentMemoryContext,
+											   "Gin build temporary context for user-defined function",
+											   ALLOCSET_DEFAULT_SIZES);
+	buildstate.accum.ginstate = &buildstate.ginstate;
+	ginInitBA(&buildstate.accum);
+
+	/* Join parallel scan */
+	indexInfo = BuildIndexInfo(index);
+	indexInfo->ii_Concurrent = ginshared->isconcurrent;
+	scan = table_beginscan_parallel(heap,
+									ParallelTableScanFromGinShared(ginshared));
+	reltuples = table_index_build_scan(heap, index, indexInfo, true, progress,
+									   ginBuildCallback, (void *) &buildstate,
+									   scan);
+
+	/* write out whatever is left as a final run */
+	oldCtx = MemoryContextSwitchTo(buildstate.tmpCtx);
+	ginBuildDump(&buildstate);
+	MemoryContextSwitchTo(oldCtx);
+
+	MemoryContextDelete(buildstate.funcCtx);
+	MemoryContextDelete(buildstate.tmpCtx);
+
+	/* Done.  Record ambuild statistics and our run count. */
+	SpinLockAcquire(&ginshared->mutex);
+	ginshared->nparticipantsdone++;
+	ginshared->reltuples += reltuples;
+	ginshared->indtuples += buildstate.indtuples;
+	runs[participant] = buildstate.nruns;
+	SpinLockRelease(&ginshared->mutex);
+
+	/* Notify leader */
+	ConditionVariableSignal(&ginshared->workersdonecv);
+}
+
+/*
+ * Write the contents of a participant's BuildAccumulator as a new sorted
+ * run.  ginGetBAEntry() returns entries in key order, with sorted TID lists,
+ * which is exactly the order the leader's merge needs.
+ */
+static void
+_gin_write_run(GinBuildState *buildstate)
+{
+	GinState   *ginstate = &buildstate->ginstate;
+	ItemPointerData *list;
+	Datum		key;
+	GinNullCategory category;
+	uint32		nlist;
+	OffsetNumber attnum;
+	GinRunEntryHeader hdr;
+	BufFile    *file;
+	char		name[MAXPGPATH];
+	bool		byval;
+	bool		empty = true;
+
+	snprintf(name, sizeof(name), "gin.%d.%d",
+			 buildstate->participant, buildstate->nruns);
+	file = NULL;
+
+	ginBeginBAScan(&buildstate->accum);
+	while ((list = ginGetBAEntry(&buildstate->accum,
+								 &attnum, &key, &category, &nlist)) != NULL)
+	{
+		/* there could be many entries, so be willing to abort here */
+		CHECK_FOR_INTERRUPTS();
+
+		/* don't create a file for an empty run */
+		if (empty)
+		{
+			file = BufFileCreateShared(&buildstate->ginshared->fileset, name);
+			empty = false;
+		}
+
+		hdr.attnum = attnum;
+		hdr.category = category;
+		hdr.nitems = nlist;
+		hdr.keylen = 0;
+		byval = false;
+		if (category == GIN_CAT_NORM_KEY)
+		{
+			Form_pg_attribute attr;
+
+			attr = TupleDescAttr(ginstate->origTupdesc, attnum - 1);
+			byval = attr->attbyval;
+			if (byval)
+				hdr.keylen = sizeof(Datum);
+			else
+				hdr.keylen = datumGetSize(key, false, attr->attlen);
+		}
+
+		BufFileWrite(file, &hdr, sizeof(hdr));
+		if (byval)
+			BufFileWrite(file, &key, sizeof(Datum));
+		else if (hdr.keylen > 0)
+			BufFileWrite(file, DatumGetPointer(key), hdr.keylen);
+		BufFileWrite(file, list, sizeof(ItemPointerData) * nlist);
+	}
+
+	if (empty)
+		return;
+
+	/* terminate the run */
+	memset(&hdr, 0, sizeof(hdr));
+	hdr.attnum = InvalidOffsetNumber;
+	BufFileWrite(file, &hdr, sizeof(hdr));
+
+	BufFileExportShared(file);
+	BufFileClose(file);
+	buildstate->nruns++;
+}
+
+/*
+ * Read the next entry of a sorted run into *reader.  Returns false (and
+ * marks the reader exhausted) at the end of the run.
+ */
+static bool
+_gin_read_run_entry(GinState *ginstate, GinRunReader *reader)
+{
+	GinRunEntryHeader hdr;
+	MemoryContext oldCtx;
+
+	MemoryContextReset(reader->cxt);
+
+	if (BufFileRead(reader->file, &hdr, sizeof(hdr)) != sizeof(hdr))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from GIN build temporary file"),
+				 errdetail_internal("Short read while reading entry header.")));
+
+	if (hdr.attnum == InvalidOffsetNumber)
+	{
+		reader->attnum = InvalidOffsetNumber;
+		return false;
+	}
+
+	oldCtx = MemoryContextSwitchTo(reader->cxt);
+
+	reader->attnum = hdr.attnum;
+	reader->category = hdr.category;
+	reader->key = (Datum) 0;
+	if (hdr.keylen > 0)
+	{
+		Form_pg_attribute attr;
+
+		attr = TupleDescAttr(ginstate->origTupdesc, hdr.attnum - 1);
+		if (attr->attbyval)
+		{
+			if (BufFileRead(reader->file, &reader->key,
+							sizeof(Datum)) != sizeof(Datum))
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read from GIN build temporary file"),
+						 errdetail_internal("Short read while reading key.")));
+		}
+		else
+		{
+			char	   *keydata = palloc(hdr.keylen);
+
+			if (BufFileRead(reader->file, keydata,
+							hdr.keylen) != hdr.keylen)
+				ereport(ERROR,
+						(errcode_for_file_access(),
+						 errmsg("could not read from GIN build temporary file"),
+						 errdetail_internal("Short read while reading key.")));
+			reader->key = PointerGetDatum(keydata);
+		}
+	}
+
+	reader->nitems = hdr.nitems;
+	reader->items = palloc(sizeof(ItemPointerData) * hdr.nitems);
+	if (BufFileRead(reader->file, reader->items,
+					sizeof(ItemPointerData) * hdr.nitems) !=
+		sizeof(ItemPointerData) * hdr.nitems)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not read from GIN build temporary file"),
+				 errdetail_internal("Short read while reading item pointers.")));
+
+	MemoryContextSwitchTo(oldCtx);
+
+	return true;
+}
+
+/*
+ * binaryheap comparator for the leader's merge.  binaryheap keeps the
+ * largest element on top, so invert the entry order to get a min-heap.
+ */
+static int
+_gin_reader_cmp(Datum a, Datum b, void *arg)
+{
+	GinRunReader *ra = (GinRunReader *) DatumGetPointer(a);
+	GinRunReader *rb = (GinRunReader *) DatumGetPointer(b);
+	GinState   *ginstate = (GinState *) arg;
+
+	return -ginCompareAttEntries(ginstate,
+								 ra->attnum, ra->key, ra->category,
+								 rb->attnum, rb->key, rb->category);
+}
+
 /*
  *	ginbuildempty() -- build an empty gin index in the initialization fork
  */
@@ -4,23 +4,49 @@
  *	  Concurrent ("lazy") vacuuming.
  *
  *
- * The major space usage for LAZY VACUUM is storage for the array of dead tuple
+ * The major space usage for LAZY VACUUM is storage for the set of dead tuple
  * TIDs.  We want to ensure we can vacuum even the very largest relations with
- * finite memory space usage.  To do that, we set upper bounds on the number of
- * tuples we will keep track of at once.
+ * finite memory space usage.  To do that, we set an upper bound on the memory
+ * used to keep track of them at once.
  *
  * We are willing to use at most maintenance_work_mem (or perhaps
- * autovacuum_work_mem) memory space to keep track of dead tuples.  We
- * initially allocate an array of TIDs of that size, with an upper limit that
- * depends on table size (this limit ensures we don't allocate a huge area
- * uselessly for vacuuming small tables).  If the array threatens to overflow,
+ * autovacuum_work_mem) memory space to keep track of dead tuples.  The TIDs
+ * are kept in an IntegerSet (see lib/integerset.c), which grows as needed and
+ * stores the sorted, closely spaced TIDs of a heap scan in a small fraction
+ * of the 6 bytes per TID a plain array needs.  It is not limited to
+ * MaxAllocSize either, so with enough memory a single index pass suffices
+ * for even a very large table.  If the set threatens to outgrow the budget,
  * we suspend the heap scan phase and perform a pass of index cleanup and page
- * compaction, then resume the heap scan with an empty TID array.
+ * compaction, then resume the heap scan with an empty set.
  *
  * If we're processing a table with no indexes, we can just vacuum each page
  * as we go; there's no need to save up multiple tuples to minimize the number
- * of index scans performed.  So we don't use maintenance_work_mem memory for
- * the TID array, just enough to hold as many heap tuples as fit on one page.
+ * of index scans performed.  So we don't build the TID set at all, but vacuum
+ * each page from the list of its dead line pointers collected while scanning
+ * it.
+ *
+ * Index vacuuming and cleanup can be done in parallel.  Each pass over the
+ * indexes copies the dead tuple TIDs to a dynamic shared memory segment in a
+ * flat, per-page form, launches parallel workers, and lets each participant,
+ * the leader included, claim whole indexes until none are left.  A worker
+ * processes one index at a time, so there is no use for more workers than
+ * indexes.  The number of workers is chosen by the PARALLEL option or
+ * autovacuum_max_parallel_workers, limited by max_parallel_maintenance_workers
+ * and by how many indexes are big enough (min_parallel_index_scan_size) and
+ * of an access method that allows it (amparallelvacuumoptions).
+ *
+ * The heap scan can be done in parallel too, if the table is at least
+ * min_parallel_table_scan_size.  The leader and the workers get pages from a
+ * shared parallel block scan and each prunes, freezes and sets visibility
+ * map bits on the pages it gets.  Their dead tuple TIDs go straight into the
+ * flat form in dynamic shared memory, which the index passes then use as is;
+ * when it's full, the scan stops for a round of index and heap vacuuming, as
+ * a serial scan does when its IntegerSet reaches the memory budget.  The
+ * second heap pass, truncation and the pg_class updates are left to the
+ * leader.
+ *
+ * All participants draw on one shared cost-based delay balance, so a
+ * parallel vacuum stays within the cost limit of the vacuum that started it.
  *
  *
  * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
@@ -36,28 +62,38 @@
 
 #include <math.h>
 
+#include "access/amapi.h"
 #include "access/genam.h"
 #include "access/heapam.h"
 #include "access/heapam_xlog.h"
 #include "access/htup_details.h"
 #include "access/multixact.h"
+#include "access/parallel.h"
+#include "access/tableam.h"
 #include "access/transam.h"
 #include "access/visibilitymap.h"
+#include "access/xact.h"
 #include "access/xlog.h"
 #include "catalog/storage.h"
 #include "commands/dbcommands.h"
 #include "commands/progress.h"
 #include "commands/vacuum.h"
+#include "executor/instrument.h"
+#include "lib/integerset.h"
 #include "miscadmin.h"
+#include "optimizer/paths.h"
 #include "pgstat.h"
 #include "portability/instr_time.h"
 #include "postmaster/autovacuum.h"
 #include "storage/bufmgr.h"
 #include "storage/freespace.h"
 #include "storage/lmgr.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/pg_rusage.h"
+#include "utils/rel.h"
 #include "utils/timestamp.h"
 
 
@@ -92,11 +128,19 @@
 	((BlockNumber) (((uint64) 8 * 1024 * 1024 * 1024) / BLCKSZ))
 
 /*
- * Guesstimation of number of dead tuples per page.  This is used to
- * provide an upper limit to memory allocated when vacuuming small
- * tables.
+ * Dead tuple TIDs are stored in the IntegerSet as block number shifted left
+ * by VAC_TID_OFFSET_BITS, plus offset number.  Keeping the offset field
+ * narrow keeps the gaps between consecutive values small, which the set's
+ * simple-8b encoding compresses much better.  11 bits cover
+ * MaxHeapTuplesPerPage for any supported BLCKSZ.
  */
-#define LAZY_ALLOC_TUPLES		MaxHeapTuplesPerPage
+#define VAC_TID_OFFSET_BITS		11
+
+#define VacEncodeTid(blkno, offnum) \
+	(((uint64) (blkno) << VAC_TID_OFFSET_BITS) | (uint64) (offnum))
+#define VacDecodeBlock(val)		((BlockNumber) ((val) >> VAC_TID_OFFSET_BITS))
+#define VacDecodeOffset(val) \
+	((OffsetNumber) ((val) & ((UINT64CONST(1) << VAC_TID_OFFSET_BITS) - 1)))
 
 /*
  * Before we consider skipping a page that's marked as clean in
@@ -110,6 +154,102 @@
  */
 #define PREFETCH_SIZE			((BlockNumber) 32)
 
+/*
+ * DSM keys for parallel vacuum.  Unlike other parallel execution code, since
+ * we don't need to worry about DSM keys conflicting with plan_node_id we can
+ * use small integers.
+ */
+#define PARALLEL_VACUUM_KEY_SHARED			1
+#define PARALLEL_VACUUM_KEY_DEAD_TUPLES		2
+#define PARALLEL_VACUUM_KEY_QUERY_TEXT		3
+#define PARALLEL_VACUUM_KEY_BUFFER_USAGE	4
+#define PARALLEL_VACUUM_KEY_HEAP_SCAN		5
+
+/*
+ * Dead tuple TIDs as handed to parallel vacuum workers.  The IntegerSet the
+ * leader collects them in lives in backend-local memory, so for each index
+ * pass we flatten it into DSM: a sorted array of the pages that have dead
+ * tuples, followed by one array holding the dead offsets of all those pages,
+ * page by page.  Lookups binary-search the page, then its offsets.
+ *
+ * The flattened form is much bigger than the IntegerSet, so the arrays are
+ * sized to stay within the vacuum memory budget.  If all the dead tuples
+ * don't fit, the index pass is done in several rounds, each handing the
+ * workers the next batch of pages.
+ *
+ * A parallel heap scan has no IntegerSet; its participants add each page's
+ * dead offsets to the arrays directly, in no particular order of pages, and
+ * the leader sorts pages[] by block number before the arrays are used.
+ */
+typedef struct LVDeadTuplePage
+{
+	BlockNumber blkno;
+	uint16		noffsets;		/* # of dead offsets on this page */
+	uint64		first;			/* index of its first entry in offsets[] */
+} LVDeadTuplePage;
+
+typedef struct LVDeadTuples
+{
+	int64		maxpages;		/* allocated length of pages[] */
+	int64		maxtuples;		/* allocated length of the offset array */
+	int64		npages;			/* # of entries in pages[] */
+	int64		ntuples;		/* # of entries in the offset array */
+	/* pages[maxpages], followed by OffsetNumber offsets[maxtuples] */
+	LVDeadTuplePage pages[FLEXIBLE_ARRAY_MEMBER];
+} LVDeadTuples;
+
+#define SizeOfLVDeadTuples(npages, ntuples) \
+	add_size(add_size(offsetof(LVDeadTuples, pages), \
+					  mul_size(sizeof(LVDeadTuplePage), (npages))), \
+			 mul_size(sizeof(OffsetNumber), (ntuples)))
+#define LVDeadTuplesOffsets(dt) \
+	((OffsetNumber *) &(dt)->pages[(dt)->maxpages])
+
+/*
+ * Per-index slot in the shared parallel vacuum state.  The index's
+ * IndexBulkDeleteResult travels between the leader and whichever process
+ * vacuums the index in a given pass through here, which is why only AMs
+ * that use a plain IndexBulkDeleteResult can take part.
+ */
+typedef struct LVSharedIndStats
+{
+	Oid			indexrelid;		/* to cross-check the worker's index list */
+	bool		parallel;		/* processed by the shared loop this pass? */
+	bool		updated;		/* is stats valid? */
+	IndexBulkDeleteResult stats;
+} LVSharedIndStats;
+
+/*
+ * Shared state for one parallel index vacuum or cleanup pass, stored under
+ * PARALLEL_VACUUM_KEY_SHARED.
+ */
+typedef struct LVShared
+{
+	/* Information the workers need to open and vacuum the indexes */
+	Oid			relid;
+	int			elevel;
+	bool		scan_heap;		/* heap scan rather than an index pass? */
+	bool		for_cleanup;	/* cleanup pass rather than bulk-deletion? */
+	double		reltuples;		/* num_heap_tuples for IndexVacuumInfo */
+	bool		estimated_count;	/* is reltuples an estimate? */
+	int64		num_dead_tuples;	/* for bulk-deletion, # of dead TIDs */
+	int			maintenance_work_mem_worker;
+
+	/* Cost-based delay settings of the leader, and the shared balance */
+	double		cost_delay;
+	int			cost_limit;
+	pg_atomic_uint32 cost_balance;
+	pg_atomic_uint32 active_nworkers;	/* # of processes vacuuming an index */
+
+	/* Index of the next slot to be claimed by a participant */
+	pg_atomic_uint32 idx;
+
+	int			nindexes;
+	LVSharedIndStats indstats[FLEXIBLE_ARRAY_MEMBER];
+} LVShared;
+
+struct LVParallelState;
+
 typedef struct LVRelStats
 {
 	/* useindex = true means two-pass strategy; false means one-pass */
@@ -128,16 +268,80 @@ typedef struct LVRelStats
 	BlockNumber pages_removed;
 	double		tuples_deleted;
 	BlockNumber nonempty_pages; /* actually, last nonempty page + 1 */
-	/* List of TIDs of tuples we intend to delete */
-	/* NB: this list is ordered by TID address */
-	int			num_dead_tuples;	/* current # of entries */
-	int			max_dead_tuples;	/* # slots allocated in array */
-	ItemPointer dead_tuples;	/* array of ItemPointerData */
+	BlockNumber empty_pages;	/* # of new or empty pages */
+	BlockNumber vacuumed_pages; /* # of pages vacuumed during the heap scan */
+	double		num_tuples;		/* total number of nonremovable tuples */
+	double		live_tuples;	/* live tuples (reltuples estimate) */
+	double		tups_vacuumed;	/* tuples cleaned up by vacuum */
+	double		nkeep;			/* dead-but-not-removable tuples */
+	double		nunused;		/* unused line pointers */
+	/* Set of TIDs of tuples we intend to delete, encoded by VacEncodeTid */
+	IntegerSet *dead_tuples;
+	MemoryContext dead_tuples_cxt;	/* holds dead_tuples */
+	int64		num_dead_tuples;	/* current # of entries */
+	int64		num_dead_pages; /* # of distinct pages among them */
+	uint64		max_dead_tuples_mem;	/* memory budget for dead_tuples */
 	int			num_index_scans;
 	TransactionId latestRemovedXid;
 	bool		lock_waiter_detected;
+	/* Parallel index vacuum: max # of workers, and eligible indexes */
+	int			parallel_workers;
+	bool	   *can_parallel_vacuum;
+	/* Parallel heap scan in progress, or NULL; holds the dead tuples then */
+	struct LVParallelState *lps;
 } LVRelStats;
 
+/*
+ * Shared state of a parallel heap scan, stored under
+ * PARALLEL_VACUUM_KEY_HEAP_SCAN.  The participants get pages from pscan one
+ * at a time.  Before getting a page, a participant reserves room in the
+ * dead tuple arrays for a page's worth of dead tuples, and it gives the room
+ * back once it has recorded the page's actual dead tuples.  When there's no
+ * room left, full tells everyone to stop, and the leader vacuums the indexes
+ * and the heap before starting the next round of the scan.
+ */
+typedef struct LVParallelScan
+{
+	/* The leader's settings for this vacuum */
+	VacuumParams params;
+	bool		aggressive;
+	bool		useindex;
+	TransactionId OldestXmin;
+	TransactionId FreezeLimit;
+	MultiXactId MultiXactCutoff;
+
+	/* Protects the dead tuple arrays' counts and the room reserved in them */
+	slock_t		mutex;
+	bool		full;			/* no room for another page? */
+	int64		reserved_pages;
+	int64		reserved_tuples;
+
+	ParallelBlockTableScanDescData pscan;
+
+	/*
+	 * The counters of each worker for the last round; only the statistics
+	 * fields lazy_add_scan_stats adds up are used.
+	 */
+	LVRelStats	worker_stats[FLEXIBLE_ARRAY_MEMBER];
+} LVParallelScan;
+
+/*
+ * The leader's handle on a parallel vacuum's DSM segment.  It lasts for one
+ * index pass, or until after index cleanup if the heap is scanned in
+ * parallel.  A worker scanning the heap has one, too, to find the shared
+ * state in.
+ */
+typedef struct LVParallelState
+{
+	ParallelContext *pcxt;
+	LVShared   *lvshared;
+	LVDeadTuples *dead_tuples;
+	LVParallelScan *lvscan;		/* NULL unless scanning the heap */
+	BufferUsage *buffer_usage;
+	int			nworkers_heap;	/* # of workers for the heap scan */
+	bool		launched;		/* were workers launched before? */
+} LVParallelState;
+
 
 /* A few variables that don't seem worth passing around as parameters */
 static int	elevel = -1;
@@ -153,26 +357,100 @@ static BufferAccessStrategy vac_strategy;
 static void lazy_scan_heap(Relation onerel, VacuumParams *params,
 						   LVRelStats *vacrelstats, Relation *Irel, int nindexes,
 						   bool aggressive);
+static bool lazy_scan_page(Relation onerel, VacuumParams *params,
+						   LVRelStats *vacrelstats, int nindexes,
+						   BlockNumber blkno, bool aggressive, bool force_check,
+						   bool all_visible_according_to_vm,
+						   xl_heap_freeze_tuple *frozen, Buffer *vmbuffer);
+static void lazy_vacuum_dead_tuples(Relation onerel, LVRelStats *vacrelstats,
+									Relation *Irel,
+									IndexBulkDeleteResult **indstats,
+									int nindexes);
+static void lazy_parallel_scan_heap(Relation onerel, VacuumParams *params,
+									LVRelStats *vacrelstats, Relation *Irel,
+									int nindexes,
+									IndexBulkDeleteResult **indstats,
+									bool aggressive,
+									BlockNumber *next_fsm_block_to_vacuum);
+static void lazy_parallel_scan_pages(Relation onerel, VacuumParams *params,
+									 LVRelStats *vacrelstats, int nindexes,
+									 bool aggressive);
+static bool lazy_skippable_run(Relation onerel, BlockNumber blkno,
+							   BlockNumber nblocks, bool aggressive,
+							   Buffer *vmbuffer, BlockNumber *run_start,
+							   BlockNumber *run_end);
+static bool lazy_reserve_dead_tuples(LVParallelState *lps);
+static void lazy_release_dead_tuples(LVParallelState *lps);
+static void lazy_add_scan_stats(LVRelStats *dst, LVRelStats *src);
 static void lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats);
 static bool lazy_check_needs_freeze(Buffer buf, bool *hastup);
+static void lazy_vacuum_all_indexes(Relation *Irel,
+									IndexBulkDeleteResult **indstats,
+									LVRelStats *vacrelstats, int nindexes);
+static void lazy_cleanup_all_indexes(Relation *Irel,
+									 IndexBulkDeleteResult **indstats,
+									 LVRelStats *vacrelstats, int nindexes);
 static void lazy_vacuum_index(Relation indrel,
 							  IndexBulkDeleteResult **stats,
-							  LVRelStats *vacrelstats);
+							  IndexBulkDeleteCallback callback,
+							  void *callback_state,
+							  double reltuples, int64 num_dead_tuples);
 static void lazy_cleanup_index(Relation indrel,
-							   IndexBulkDeleteResult *stats,
-							   LVRelStats *vacrelstats);
-static int	lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-							 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer);
+							   IndexBulkDeleteResult **stats,
+							   double reltuples, bool estimated_count);
+static void update_index_statistics(Relation *Irel,
+									IndexBulkDeleteResult **indstats,
+									int nindexes);
+static int	compute_parallel_vacuum_workers(Relation *Irel, int nindexes,
+											int nrequested,
+											bool *can_parallel_vacuum);
+static int	compute_parallel_heap_workers(Relation onerel, BlockNumber nblocks,
+										  int nrequested);
+static bool index_can_parallel_vacuum(Relation indrel, bool for_cleanup,
+									  bool first_time);
+static bool lazy_parallel_vacuum_indexes(Relation *Irel,
+										 IndexBulkDeleteResult **indstats,
+										 LVRelStats *vacrelstats,
+										 int nindexes, bool for_cleanup);
+static LVParallelState *begin_parallel_heap_scan(Relation onerel,
+												 VacuumParams *params,
+												 LVRelStats *vacrelstats,
+												 Relation *Irel, int nindexes,
+												 bool aggressive,
+												 int nworkers_heap);
+static LVParallelState *begin_parallel_vacuum(Oid relid, Relation *Irel,
+											  int nindexes, int nworkers,
+											  int64 maxpages, int64 maxtuples,
+											  bool scan_heap);
+static void end_parallel_vacuum(LVParallelState *lps);
+static void launch_parallel_vacuum_workers(LVParallelState *lps,
+										   int nworkers);
+static void wait_parallel_vacuum_workers(LVParallelState *lps);
+static void parallel_vacuum_indexes(Relation *Irel, int nindexes,
+									LVShared *lvshared,
+									LVDeadTuples *dead_tuples);
+static void parallel_vacuum_scan_heap(Relation onerel, int nindexes,
+									  LVParallelScan *lvscan,
+									  LVDeadTuples *dead_tuples);
+static bool lazy_copy_dead_tuples(LVRelStats *vacrelstats,
+								  LVDeadTuples *dead_tuples, uint64 *next);
+static void lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
+							 OffsetNumber *deadoffsets, int ndeadoffsets,
+							 LVRelStats *vacrelstats, Buffer *vmbuffer);
 static bool should_attempt_truncation(VacuumParams *params,
 									  LVRelStats *vacrelstats);
 static void lazy_truncate_heap(Relation onerel, LVRelStats *vacrelstats);
 static BlockNumber count_nondeletable_pages(Relation onerel,
 											LVRelStats *vacrelstats);
-static void lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks);
-static void lazy_record_dead_tuple(LVRelStats *vacrelstats,
-								   ItemPointer itemptr);
+static void lazy_space_alloc(LVRelStats *vacrelstats);
+static void lazy_reset_dead_tuples(LVRelStats *vacrelstats);
+static void lazy_record_dead_tuples(LVRelStats *vacrelstats, BlockNumber blkno,
+									OffsetNumber *deadoffsets,
+									int ndeadoffsets);
 static bool lazy_tid_reaped(ItemPointer itemptr, void *state);
-static int	vac_cmp_itemptr(const void *left, const void *right);
+static bool lazy_shared_tid_reaped(ItemPointer itemptr, void *state);
+static int	vac_cmp_dead_page(const void *left, const void *right);
+static int	vac_cmp_offsetnumber(const void *left, const void *right);
 static bool heap_page_is_all_visible(Relation rel, Buffer buf,
 									 TransactionId *visibility_cutoff_xid, bool *all_frozen);
 
@@ -475,6 +753,9 @@ vacuum_log_cleanup_info(Relation rel, LVRelStats *vacrelstats)
  *		If there are no indexes then we can reclaim line pointers on the fly;
  *		dead line pointers need only be retained until all index pointers that
  *		reference them have been killed.
+ *
+ *		If the table is big enough, the pages are scanned by parallel workers
+ *		along with the leader, see lazy_parallel_scan_heap.
  */
 static void
 lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
@@ -482,26 +763,16 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 {
 	BlockNumber nblocks,
 				blkno;
-	HeapTupleData tuple;
 	char	   *relname;
-	TransactionId relfrozenxid = onerel->rd_rel->relfrozenxid;
-	TransactionId relminmxid = onerel->rd_rel->relminmxid;
-	BlockNumber empty_pages,
-				vacuumed_pages,
-				next_fsm_block_to_vacuum;
-	double		num_tuples,		/* total number of nonremovable tuples */
-				live_tuples,	/* live tuples (reltuples estimate) */
-				tups_vacuumed,	/* tuples cleaned up by vacuum */
-				nkeep,			/* dead-but-not-removable tuples */
-				nunused;		/* unused line pointers */
+	BlockNumber next_fsm_block_to_vacuum;
 	IndexBulkDeleteResult **indstats;
-	int			i;
 	PGRUsage	ru0;
 	Buffer		vmbuffer = InvalidBuffer;
 	BlockNumber next_unskippable_block;
 	bool		skipping_blocks;
 	xl_heap_freeze_tuple *frozen;
 	StringInfoData buf;
+	int			nworkers_heap = 0;
 	const int	initprog_index[] = {
 		PROGRESS_VACUUM_PHASE,
 		PROGRESS_VACUUM_TOTAL_HEAP_BLKS,
@@ -523,9 +794,7 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 						get_namespace_name(RelationGetNamespace(onerel)),
 						relname)));
 
-	empty_pages = vacuumed_pages = 0;
 	next_fsm_block_to_vacuum = (BlockNumber) 0;
-	num_tuples = live_tuples = tups_vacuumed = nkeep = nunused = 0;
 
 	indstats = (IndexBulkDeleteResult **)
 		palloc0(nindexes * sizeof(IndexBulkDeleteResult *));
@@ -537,13 +806,66 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	vacrelstats->nonempty_pages = 0;
 	vacrelstats->latestRemovedXid = InvalidTransactionId;
 
-	lazy_space_alloc(vacrelstats, nblocks);
+	lazy_space_alloc(vacrelstats);
 	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
 
-	/* Report that we're scanning the heap, advertising total # of blocks */
+	/*
+	 * Decide whether the heap scan and the index passes can use parallel
+	 * workers.  Parallel workers can't see the leader's local buffers, so
+	 * temporary tables are always done serially.
+	 */
+	vacrelstats->parallel_workers = 0;
+	vacrelstats->can_parallel_vacuum = NULL;
+	vacrelstats->lps = NULL;
+	if (params->nworkers >= 0 && RelationUsesLocalBuffers(onerel))
+	{
+		if (params->nworkers > 0)
+			ereport(WARNING,
+					(errmsg("disabling parallel option of vacuum on \"%s\" --- cannot vacuum temporary tables in parallel",
+							relname)));
+	}
+	else if (params->nworkers >= 0)
+	{
+		if (vacrelstats->useindex)
+		{
+			vacrelstats->can_parallel_vacuum =
+				(bool *) palloc0(nindexes * sizeof(bool));
+			vacrelstats->parallel_workers =
+				compute_parallel_vacuum_workers(Irel, nindexes,
+												params->nworkers,
+												vacrelstats->can_parallel_vacuum);
+		}
+		nworkers_heap = compute_parallel_heap_workers(onerel, nblocks,
+													  params->nworkers);
+	}
+
+	/*
+	 * A parallel heap scan keeps its parallel context until the indexes have
+	 * been cleaned up, and the index passes use it too.  If no DSM segment
+	 * can be had, the heap is scanned serially after all.
+	 */
+	if (nworkers_heap > 0)
+		vacrelstats->lps = begin_parallel_heap_scan(onerel, params,
+													vacrelstats, Irel,
+													nindexes, aggressive,
+													nworkers_heap);
+
+	/*
+	 * Report that we're scanning the heap, advertising total # of blocks.
+	 * The dead tuple set has no fixed capacity, so for max_dead_tuples we
+	 * report how many TIDs the memory budget would hold as a plain array,
+	 * which the set can always beat.  A parallel heap scan has a fixed
+	 * capacity in DSM instead.
+	 */
 	initprog_val[0] = PROGRESS_VACUUM_PHASE_SCAN_HEAP;
 	initprog_val[1] = nblocks;
-	initprog_val[2] = vacrelstats->max_dead_tuples;
+	if (!vacrelstats->useindex)
+		initprog_val[2] = MaxHeapTuplesPerPage;
+	else if (vacrelstats->lps != NULL)
+		initprog_val[2] = vacrelstats->lps->dead_tuples->maxtuples;
+	else
+		initprog_val[2] =
+			vacrelstats->max_dead_tuples_mem / sizeof(ItemPointerData);
 	pgstat_progress_update_multi_param(3, initprog_index, initprog_val);
 
 	/*
@@ -566,7 +888,8 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	 * skip based on the visibility map, either all-visible for a regular scan
 	 * or all-frozen for an aggressive scan.  We set it to nblocks if there's
 	 * no such block.  We also set up the skipping_blocks flag correctly at
-	 * this stage.
+	 * this stage.  (A parallel heap scan follows the same rules, but finds
+	 * the runs of skippable pages differently, see lazy_skippable_run.)
 	 *
 	 * Note: The value returned by visibilitymap_get_status could be slightly
 	 * out-of-date, since we make this test before reading the corresponding
@@ -590,1227 +913,2491 @@ lazy_scan_heap(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
 	 * the last page.  This is worth avoiding mainly because such a lock must
 	 * be replayed on any hot standby, where it can be disruptive.
 	 */
-	next_unskippable_block = 0;
-	if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
+	if (vacrelstats->lps != NULL)
+		lazy_parallel_scan_heap(onerel, params, vacrelstats, Irel, nindexes,
+								indstats, aggressive,
+								&next_fsm_block_to_vacuum);
+	else
 	{
-		while (next_unskippable_block < nblocks)
+		next_unskippable_block = 0;
+		if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
 		{
-			uint8		vmstatus;
-
-			vmstatus = visibilitymap_get_status(onerel, next_unskippable_block,
-												&vmbuffer);
-			if (aggressive)
-			{
-				if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
-					break;
-			}
-			else
+			while (next_unskippable_block < nblocks)
 			{
-				if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
-					break;
+				uint8		vmstatus;
+
+				vmstatus = visibilitymap_get_status(onerel,
+													next_unskippable_block,
+													&vmbuffer);
+				if (aggressive)
+				{
+					if ((vmstatus & VISIBILITYMAP_ALL_FROZEN) == 0)
+						break;
+				}
+				else
+				{
+					if ((vmstatus & VISIBILITYMAP_ALL_VISIBLE) == 0)
+						break;
+				}
+				vacuum_delay_point();
+				next_unskippable_block++;
 			}
-			vacuum_delay_point();
-			next_unskippable_block++;
 		}
-	}
 
-	if (next_unskippable_block >= SKIP_PAGES_THRESHOLD)
-		skipping_blocks = true;
-	else
-		skipping_blocks = false;
+		if (next_unskippable_block >= SKIP_PAGES_THRESHOLD)
+			skipping_blocks = true;
+		else
+			skipping_blocks = false;
 
-	for (blkno = 0; blkno < nblocks; blkno++)
-	{
-		Buffer		buf;
-		Page		page;
-		OffsetNumber offnum,
-					maxoff;
-		bool		tupgone,
-					hastup;
-		int			prev_dead_count;
-		int			nfrozen;
-		Size		freespace;
-		bool		all_visible_according_to_vm = false;
-		bool		all_visible;
-		bool		all_frozen = true;	/* provided all_visible is also true */
-		bool		has_dead_tuples;
-		TransactionId visibility_cutoff_xid = InvalidTransactionId;
+		for (blkno = 0; blkno < nblocks; blkno++)
+		{
+			bool		all_visible_according_to_vm = false;
 
-		/* see note above about forcing scanning of last page */
+			/* see note above about forcing scanning of last page */
 #define FORCE_CHECK_PAGE() \
-		(blkno == nblocks - 1 && should_attempt_truncation(params, vacrelstats))
+			(blkno == nblocks - 1 && should_attempt_truncation(params, vacrelstats))
 
-		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+										 blkno);
 
-		if (blkno == next_unskippable_block)
-		{
-			/* Time to advance next_unskippable_block */
-			next_unskippable_block++;
-			if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
+			if (blkno == next_unskippable_block)
 			{
-				while (next_unskippable_block < nblocks)
+				/* Time to advance next_unskippable_block */
+				next_unskippable_block++;
+				if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
 				{
-					uint8		vmskipflags;
-
-					vmskipflags = visibilitymap_get_status(onerel,
-														   next_unskippable_block,
-														   &vmbuffer);
-					if (aggressive)
+					while (next_unskippable_block < nblocks)
 					{
-						if ((vmskipflags & VISIBILITYMAP_ALL_FROZEN) == 0)
-							break;
-					}
-					else
-					{
-						if ((vmskipflags & VISIBILITYMAP_ALL_VISIBLE) == 0)
-							break;
+						uint8		vmskipflags;
+
+						vmskipflags = visibilitymap_get_status(onerel,
+															   next_unskippable_block,
+															   &vmbuffer);
+						if (aggressive)
+						{
+							if ((vmskipflags & VISIBILITYMAP_ALL_FROZEN) == 0)
+								break;
+						}
+						else
+						{
+							if ((vmskipflags & VISIBILITYMAP_ALL_VISIBLE) == 0)
+								break;
+						}
+						vacuum_delay_point();
+						next_unskippable_block++;
 					}
-					vacuum_delay_point();
-					next_unskippable_block++;
 				}
-			}
 
-			/*
-			 * We know we can't skip the current block.  But set up
-			 * skipping_blocks to do the right thing at the following blocks.
-			 */
-			if (next_unskippable_block - blkno > SKIP_PAGES_THRESHOLD)
-				skipping_blocks = true;
-			else
-				skipping_blocks = false;
+				/*
+				 * We know we can't skip the current block.  But set up
+				 * skipping_blocks to do the right thing at the following
+				 * blocks.
+				 */
+				if (next_unskippable_block - blkno > SKIP_PAGES_THRESHOLD)
+					skipping_blocks = true;
+				else
+					skipping_blocks = false;
 
-			/*
-			 * Normally, the fact that we can't skip this block must mean that
-			 * it's not all-visible.  But in an aggressive vacuum we know only
-			 * that it's not all-frozen, so it might still be all-visible.
-			 */
-			if (aggressive && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
-				all_visible_according_to_vm = true;
-		}
-		else
-		{
-			/*
-			 * The current block is potentially skippable; if we've seen a
-			 * long enough run of skippable blocks to justify skipping it, and
-			 * we're not forced to check it, then go ahead and skip.
-			 * Otherwise, the page must be at least all-visible if not
-			 * all-frozen, so we can set all_visible_according_to_vm = true.
-			 */
-			if (skipping_blocks && !FORCE_CHECK_PAGE())
-			{
 				/*
-				 * Tricky, tricky.  If this is in aggressive vacuum, the page
-				 * must have been all-frozen at the time we checked whether it
-				 * was skippable, but it might not be any more.  We must be
-				 * careful to count it as a skipped all-frozen page in that
-				 * case, or else we'll think we can't update relfrozenxid and
-				 * relminmxid.  If it's not an aggressive vacuum, we don't
-				 * know whether it was all-frozen, so we have to recheck; but
-				 * in this case an approximate answer is OK.
+				 * Normally, the fact that we can't skip this block must mean
+				 * that it's not all-visible.  But in an aggressive vacuum we
+				 * know only that it's not all-frozen, so it might still be
+				 * all-visible.
 				 */
-				if (aggressive || VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
-					vacrelstats->frozenskipped_pages++;
-				continue;
+				if (aggressive && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
+					all_visible_according_to_vm = true;
 			}
-			all_visible_according_to_vm = true;
-		}
-
-		vacuum_delay_point();
-
-		/*
-		 * If we are close to overrunning the available space for dead-tuple
-		 * TIDs, pause and do a cycle of vacuuming before we tackle this page.
-		 */
-		if ((vacrelstats->max_dead_tuples - vacrelstats->num_dead_tuples) < MaxHeapTuplesPerPage &&
-			vacrelstats->num_dead_tuples > 0)
-		{
-			const int	hvp_index[] = {
-				PROGRESS_VACUUM_PHASE,
-				PROGRESS_VACUUM_NUM_INDEX_VACUUMS
-			};
-			int64		hvp_val[2];
-
-			/*
-			 * Before beginning index vacuuming, we release any pin we may
-			 * hold on the visibility map page.  This isn't necessary for
-			 * correctness, but we do it anyway to avoid holding the pin
-			 * across a lengthy, unrelated operation.
-			 */
-			if (BufferIsValid(vmbuffer))
+			else
 			{
-				ReleaseBuffer(vmbuffer);
-				vmbuffer = InvalidBuffer;
+				/*
+				 * The current block is potentially skippable; if we've seen a
+				 * long enough run of skippable blocks to justify skipping it,
+				 * and we're not forced to check it, then go ahead and skip.
+				 * Otherwise, the page must be at least all-visible if not
+				 * all-frozen, so we can set all_visible_according_to_vm =
+				 * true.
+				 */
+				if (skipping_blocks && !FORCE_CHECK_PAGE())
+				{
+					/*
+					 * Tricky, tricky.  If this is in aggressive vacuum, the
+					 * page must have been all-frozen at the time we checked
+					 * whether it was skippable, but it might not be any more.
+					 * We must be careful to count it as a skipped all-frozen
+					 * page in that case, or else we'll think we can't update
+					 * relfrozenxid and relminmxid.  If it's not an aggressive
+					 * vacuum, we don't know whether it was all-frozen, so we
+					 * have to recheck; but in this case an approximate answer
+					 * is OK.
+					 */
+					if (aggressive || VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
+						vacrelstats->frozenskipped_pages++;
+					continue;
+				}
+				all_visible_according_to_vm = true;
 			}
 
-			/* Log cleanup info before we touch indexes */
-			vacuum_log_cleanup_info(onerel, vacrelstats);
-
-			/* Report that we are now vacuuming indexes */
-			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-										 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
-
-			/* Remove index entries */
-			for (i = 0; i < nindexes; i++)
-				lazy_vacuum_index(Irel[i],
-								  &indstats[i],
-								  vacrelstats);
-
-			/*
-			 * Report that we are now vacuuming the heap.  We also increase
-			 * the number of index scans here; note that by using
-			 * pgstat_progress_update_multi_param we can update both
-			 * parameters atomically.
-			 */
-			hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
-			hvp_val[1] = vacrelstats->num_index_scans + 1;
-			pgstat_progress_update_multi_param(2, hvp_index, hvp_val);
-
-			/* Remove tuples from heap */
-			lazy_vacuum_heap(onerel, vacrelstats);
-
-			/*
-			 * Forget the now-vacuumed tuples, and press on, but be careful
-			 * not to reset latestRemovedXid since we want that value to be
-			 * valid.
-			 */
-			vacrelstats->num_dead_tuples = 0;
-			vacrelstats->num_index_scans++;
+			vacuum_delay_point();
 
 			/*
-			 * Vacuum the Free Space Map to make newly-freed space visible on
-			 * upper-level FSM pages.  Note we have not yet processed blkno.
+			 * If we have used up the memory budget for dead-tuple TIDs, pause
+			 * and do a cycle of vacuuming before we tackle this page.  One
+			 * more page's worth of TIDs may overshoot the budget slightly,
+			 * which is fine.
 			 */
-			FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, blkno);
-			next_fsm_block_to_vacuum = blkno;
+			if (vacrelstats->num_dead_tuples > 0 &&
+				intset_memory_usage(vacrelstats->dead_tuples) >=
+				vacrelstats->max_dead_tuples_mem)
+			{
+				/*
+				 * Before beginning index vacuuming, we release any pin we may
+				 * hold on the visibility map page.  This isn't necessary for
+				 * correctness, but we do it anyway to avoid holding the pin
+				 * across a lengthy, unrelated operation.
+				 */
+				if (BufferIsValid(vmbuffer))
+				{
+					ReleaseBuffer(vmbuffer);
+					vmbuffer = InvalidBuffer;
+				}
 
-			/* Report that we are once again scanning the heap */
-			pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-										 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
-		}
+				lazy_vacuum_dead_tuples(onerel, vacrelstats, Irel, indstats,
+										nindexes);
 
-		/*
-		 * Pin the visibility map page in case we need to mark the page
-		 * all-visible.  In most cases this will be very cheap, because we'll
-		 * already have the correct page pinned anyway.  However, it's
-		 * possible that (a) next_unskippable_block is covered by a different
-		 * VM page than the current block or (b) we released our pin and did a
-		 * cycle of index vacuuming.
-		 *
-		 */
-		visibilitymap_pin(onerel, blkno, &vmbuffer);
+				/*
+				 * Forget the now-vacuumed tuples, and press on, but be
+				 * careful not to reset latestRemovedXid since we want that
+				 * value to be valid.
+				 */
+				lazy_reset_dead_tuples(vacrelstats);
 
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
-								 RBM_NORMAL, vac_strategy);
+				/*
+				 * Vacuum the Free Space Map to make newly-freed space visible
+				 * on upper-level FSM pages.  Note we have not yet processed
+				 * blkno.
+				 */
+				FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum,
+										blkno);
+				next_fsm_block_to_vacuum = blkno;
 
-		/* We need buffer cleanup lock so that we can prune HOT chains. */
-		if (!ConditionalLockBufferForCleanup(buf))
-		{
-			/*
-			 * If we're not performing an aggressive scan to guard against XID
-			 * wraparound, and we don't want to forcibly check the page, then
-			 * it's OK to skip vacuuming pages we get a lock conflict on. They
-			 * will be dealt with in some future vacuum.
-			 */
-			if (!aggressive && !FORCE_CHECK_PAGE())
-			{
-				ReleaseBuffer(buf);
-				vacrelstats->pinskipped_pages++;
-				continue;
+				/* Report that we are once again scanning the heap */
+				pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+											 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
 			}
 
 			/*
-			 * Read the page with share lock to see if any xids on it need to
-			 * be frozen.  If not we just skip the page, after updating our
-			 * scan statistics.  If there are some, we wait for cleanup lock.
-			 *
-			 * We could defer the lock request further by remembering the page
-			 * and coming back to it later, or we could even register
-			 * ourselves for multiple buffers and then service whichever one
-			 * is received first.  For now, this seems good enough.
-			 *
-			 * If we get here with aggressive false, then we're just forcibly
-			 * checking the page, and so we don't want to insist on getting
-			 * the lock; we only need to know if the page contains tuples, so
-			 * that we can update nonempty_pages correctly.  It's convenient
-			 * to use lazy_check_needs_freeze() for both situations, though.
+			 * Periodically do incremental FSM vacuuming to make newly-freed
+			 * space visible on upper FSM pages, if there are no indexes.
+			 * lazy_scan_page has updated the current block's own FSM entry,
+			 * whose upper pages we leave for the next range.
 			 */
-			LockBuffer(buf, BUFFER_LOCK_SHARE);
-			if (!lazy_check_needs_freeze(buf, &hastup))
-			{
-				UnlockReleaseBuffer(buf);
-				vacrelstats->scanned_pages++;
-				vacrelstats->pinskipped_pages++;
-				if (hastup)
-					vacrelstats->nonempty_pages = blkno + 1;
-				continue;
-			}
-			if (!aggressive)
+			if (lazy_scan_page(onerel, params, vacrelstats, nindexes, blkno,
+							   aggressive, FORCE_CHECK_PAGE(),
+							   all_visible_according_to_vm, frozen,
+							   &vmbuffer) &&
+				blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
 			{
-				/*
-				 * Here, we must not advance scanned_pages; that would amount
-				 * to claiming that the page contains no freezable tuples.
-				 */
-				UnlockReleaseBuffer(buf);
-				vacrelstats->pinskipped_pages++;
-				if (hastup)
-					vacrelstats->nonempty_pages = blkno + 1;
-				continue;
+				FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum,
+										blkno);
+				next_fsm_block_to_vacuum = blkno;
 			}
-			LockBuffer(buf, BUFFER_LOCK_UNLOCK);
-			LockBufferForCleanup(buf);
-			/* drop through to normal processing */
 		}
+	}
 
-		vacrelstats->scanned_pages++;
-		vacrelstats->tupcount_pages++;
-
-		page = BufferGetPage(buf);
-
-		if (PageIsNew(page))
-		{
-			bool		still_new;
+	/* report that everything is scanned and vacuumed */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, nblocks);
 
-			/*
-			 * All-zeroes pages can be left over if either a backend extends
-			 * the relation by a single page, but crashes before the newly
-			 * initialized page has been written out, or when bulk-extending
-			 * the relation (which creates a number of empty pages at the tail
-			 * end of the relation, but enters them into the FSM).
-			 *
-			 * Make sure these pages are in the FSM, to ensure they can be
-			 * reused. Do that by testing if there's any space recorded for
-			 * the page. If not, enter it.
-			 *
-			 * Note we do not enter the page into the visibilitymap. That has
-			 * the downside that we repeatedly visit this page in subsequent
-			 * vacuums, but otherwise we'll never not discover the space on a
-			 * promoted standby. The harm of repeated checking ought to
-			 * normally not be too bad - the space usually should be used at
-			 * some point, otherwise there wouldn't be any regular vacuums.
-			 */
+	pfree(frozen);
 
-			/*
-			 * Perform checking of FSM after releasing lock, the fsm is
-			 * approximate, after all.
-			 */
-			still_new = PageIsNew(page);
-			UnlockReleaseBuffer(buf);
+	/* save stats for use later */
+	vacrelstats->tuples_deleted = vacrelstats->tups_vacuumed;
+	vacrelstats->new_dead_tuples = vacrelstats->nkeep;
 
-			if (still_new)
-			{
-				empty_pages++;
+	/* now we can compute the new value for pg_class.reltuples */
+	vacrelstats->new_live_tuples = vac_estimate_reltuples(onerel,
+														  nblocks,
+														  vacrelstats->tupcount_pages,
+														  vacrelstats->live_tuples);
 
-				if (GetRecordedFreeSpace(onerel, blkno) == 0)
-				{
-					Size		freespace;
+	/* also compute total number of surviving heap entries */
+	vacrelstats->new_rel_tuples =
+		vacrelstats->new_live_tuples + vacrelstats->new_dead_tuples;
 
-					freespace = BufferGetPageSize(buf) - SizeOfPageHeaderData;
-					RecordPageWithFreeSpace(onerel, blkno, freespace);
-				}
-			}
-			continue;
-		}
+	/*
+	 * Release any remaining pin on visibility map page.
+	 */
+	if (BufferIsValid(vmbuffer))
+	{
+		ReleaseBuffer(vmbuffer);
+		vmbuffer = InvalidBuffer;
+	}
 
-		if (PageIsEmpty(page))
-		{
-			empty_pages++;
-			freespace = PageGetHeapFreeSpace(page);
+	/* If any tuples need to be deleted, perform final vacuum cycle */
+	/* XXX put a threshold on min number of tuples here? */
+	if (vacrelstats->num_dead_tuples > 0)
+		lazy_vacuum_dead_tuples(onerel, vacrelstats, Irel, indstats,
+								nindexes);
 
-			/*
-			 * Empty pages are always all-visible and all-frozen (note that
-			 * the same is currently not true for new pages, see above).
-			 */
-			if (!PageIsAllVisible(page))
-			{
-				START_CRIT_SECTION();
+	/*
+	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
+	 * not there were indexes.
+	 */
+	if (nblocks > next_fsm_block_to_vacuum)
+		FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, nblocks);
 
-				/* mark buffer dirty before writing a WAL record */
-				MarkBufferDirty(buf);
+	/* report all blocks vacuumed; and that we're cleaning up */
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, nblocks);
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
 
-				/*
-				 * It's possible that another backend has extended the heap,
-				 * initialized the page, and then failed to WAL-log the page
-				 * due to an ERROR.  Since heap extension is not WAL-logged,
-				 * recovery might try to replay our record setting the page
-				 * all-visible and find that the page isn't initialized, which
-				 * will cause a PANIC.  To prevent that, check whether the
-				 * page has been previously WAL-logged, and if not, do that
-				 * now.
-				 */
-				if (RelationNeedsWAL(onerel) &&
-					PageGetLSN(page) == InvalidXLogRecPtr)
-					log_newpage_buffer(buf, true);
-
-				PageSetAllVisible(page);
-				visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-								  vmbuffer, InvalidTransactionId,
-								  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
-				END_CRIT_SECTION();
-			}
+	/* Do post-vacuum cleanup for each index */
+	if (vacrelstats->useindex)
+		lazy_cleanup_all_indexes(Irel, indstats, vacrelstats, nindexes);
 
-			UnlockReleaseBuffer(buf);
-			RecordPageWithFreeSpace(onerel, blkno, freespace);
-			continue;
-		}
+	/* pg_class can't be updated in parallel mode */
+	if (vacrelstats->lps != NULL)
+	{
+		end_parallel_vacuum(vacrelstats->lps);
+		vacrelstats->lps = NULL;
+	}
 
-		/*
-		 * Prune all HOT-update chains in this page.
-		 *
-		 * We count tuples removed by the pruning step as removed by VACUUM.
-		 */
-		tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin, false,
-										 &vacrelstats->latestRemovedXid);
+	/* Update index statistics */
+	if (vacrelstats->useindex)
+		update_index_statistics(Irel, indstats, nindexes);
 
-		/*
-		 * Now scan the page to collect vacuumable items and check for tuples
-		 * requiring freezing.
-		 */
-		all_visible = true;
-		has_dead_tuples = false;
-		nfrozen = 0;
-		hastup = false;
-		prev_dead_count = vacrelstats->num_dead_tuples;
-		maxoff = PageGetMaxOffsetNumber(page);
+	/* If no indexes, make log report that lazy_vacuum_heap would've made */
+	if (vacrelstats->vacuumed_pages)
+		ereport(elevel,
+				(errmsg("\"%s\": removed %.0f row versions in %u pages",
+						RelationGetRelationName(onerel),
+						vacrelstats->tups_vacuumed,
+						vacrelstats->vacuumed_pages)));
 
-		/*
-		 * Note: If you change anything in the loop below, also look at
-		 * heap_page_is_all_visible to see if that needs to be changed.
-		 */
-		for (offnum = FirstOffsetNumber;
-			 offnum <= maxoff;
-			 offnum = OffsetNumberNext(offnum))
-		{
-			ItemId		itemid;
+	/*
+	 * This is pretty messy, but we split it up so that we can skip emitting
+	 * individual parts of the message when not applicable.
+	 */
+	initStringInfo(&buf);
+	appendStringInfo(&buf,
+					 _("%.0f dead row versions cannot be removed yet, oldest xmin: %u\n"),
+					 vacrelstats->nkeep, OldestXmin);
+	appendStringInfo(&buf, _("There were %.0f unused item identifiers.\n"),
+					 vacrelstats->nunused);
+	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
+									"Skipped %u pages due to buffer pins, ",
+									vacrelstats->pinskipped_pages),
+					 vacrelstats->pinskipped_pages);
+	appendStringInfo(&buf, ngettext("%u frozen page.\n",
+									"%u frozen pages.\n",
+									vacrelstats->frozenskipped_pages),
+					 vacrelstats->frozenskipped_pages);
+	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
+									"%u pages are entirely empty.\n",
+									vacrelstats->empty_pages),
+					 vacrelstats->empty_pages);
+	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
 
-			itemid = PageGetItemId(page, offnum);
+	ereport(elevel,
+			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions in %u out of %u pages",
+					RelationGetRelationName(onerel),
+					vacrelstats->tups_vacuumed, vacrelstats->num_tuples,
+					vacrelstats->scanned_pages, nblocks),
+			 errdetail_internal("%s", buf.data)));
+	pfree(buf.data);
+}
 
-			/* Unused items require no processing, but we count 'em */
-			if (!ItemIdIsUsed(itemid))
-			{
-				nunused += 1;
-				continue;
-			}
+/*
+ *	lazy_scan_page() -- prune, freeze and check the visibility of one page
+ *
+ *		This is what lazy_scan_heap does for each page it doesn't skip, and
+ *		what each participant of a parallel heap scan does for the pages it
+ *		gets.  The page's dead tuples are recorded for the index and heap
+ *		vacuuming passes, or, if that's not to happen, removed or forgotten
+ *		right away; returns true if any were.  Statistics are counted in
+ *		vacrelstats.
+ *
+ *		force_check says not to skip the page because of a buffer pin, see
+ *		lazy_scan_heap.  all_visible_according_to_vm is what the visibility
+ *		map said about the page when we decided not to skip it.  frozen is
+ *		workspace for MaxHeapTuplesPerPage freeze plans, and *vmbuffer a
+ *		visibility map buffer we may keep pinned across calls.
+ */
+static bool
+lazy_scan_page(Relation onerel, VacuumParams *params, LVRelStats *vacrelstats,
+			   int nindexes, BlockNumber blkno, bool aggressive,
+			   bool force_check, bool all_visible_according_to_vm,
+			   xl_heap_freeze_tuple *frozen, Buffer *vmbuffer)
+{
+	Buffer		buf;
+	Page		page;
+	HeapTupleData tuple;
+	OffsetNumber offnum,
+				maxoff;
+	bool		tupgone,
+				hastup;
+	OffsetNumber deadoffsets[MaxHeapTuplesPerPage];
+	int			ndeadoffsets;
+	int			nfrozen;
+	int			i;
+	Size		freespace;
+	bool		all_visible;
+	bool		all_frozen = true;	/* provided all_visible is also true */
+	bool		has_dead_tuples;
+	bool		removed = false;
+	TransactionId visibility_cutoff_xid = InvalidTransactionId;
 
-			/* Redirect items mustn't be touched */
-			if (ItemIdIsRedirected(itemid))
-			{
-				hastup = true;	/* this page won't be truncatable */
-				continue;
-			}
 
-			ItemPointerSet(&(tuple.t_self), blkno, offnum);
+	/*
+	 * Pin the visibility map page in case we need to mark the page
+	 * all-visible.  In most cases this will be very cheap, because we'll
+	 * already have the correct page pinned anyway.  However, it's
+	 * possible that (a) next_unskippable_block is covered by a different
+	 * VM page than the current block or (b) we released our pin and did a
+	 * cycle of index vacuuming.
+	 *
+	 */
+	visibilitymap_pin(onerel, blkno, vmbuffer);
+
+	buf = ReadBufferExtended(onerel, MAIN_FORKNUM, blkno,
+							 RBM_NORMAL, vac_strategy);
 
+	/* We need buffer cleanup lock so that we can prune HOT chains. */
+	if (!ConditionalLockBufferForCleanup(buf))
+	{
+		/*
+		 * If we're not performing an aggressive scan to guard against XID
+		 * wraparound, and we don't want to forcibly check the page, then
+		 * it's OK to skip vacuuming pages we get a lock conflict on. They
+		 * will be dealt with in some future vacuum.
+		 */
+		if (!aggressive && !force_check)
+		{
+			ReleaseBuffer(buf);
+			vacrelstats->pinskipped_pages++;
+			return false;
+		}
+
+		/*
+		 * Read the page with share lock to see if any xids on it need to
+		 * be frozen.  If not we just skip the page, after updating our
+		 * scan statistics.  If there are some, we wait for cleanup lock.
+		 *
+		 * We could defer the lock request further by remembering the page
+		 * and coming back to it later, or we could even register
+		 * ourselves for multiple buffers and then service whichever one
+		 * is received first.  For now, this seems good enough.
+		 *
+		 * If we get here with aggressive false, then we're just forcibly
+		 * checking the page, and so we don't want to insist on getting
+		 * the lock; we only need to know if the page contains tuples, so
+		 * that we can update nonempty_pages correctly.  It's convenient
+		 * to use lazy_check_needs_freeze() for both situations, though.
+		 */
+		LockBuffer(buf, BUFFER_LOCK_SHARE);
+		if (!lazy_check_needs_freeze(buf, &hastup))
+		{
+			UnlockReleaseBuffer(buf);
+			vacrelstats->scanned_pages++;
+			vacrelstats->pinskipped_pages++;
+			if (hastup)
+				vacrelstats->nonempty_pages = blkno + 1;
+			return false;
+		}
+		if (!aggressive)
+		{
 			/*
-			 * DEAD line pointers are to be vacuumed normally; but we don't
-			 * count them in tups_vacuumed, else we'd be double-counting (at
-			 * least in the common case where heap_page_prune() just freed up
-			 * a non-HOT tuple).
+			 * Here, we must not advance scanned_pages; that would amount
+			 * to claiming that the page contains no freezable tuples.
 			 */
-			if (ItemIdIsDead(itemid))
+			UnlockReleaseBuffer(buf);
+			vacrelstats->pinskipped_pages++;
+			if (hastup)
+				vacrelstats->nonempty_pages = blkno + 1;
+			return false;
+		}
+		LockBuffer(buf, BUFFER_LOCK_UNLOCK);
+		LockBufferForCleanup(buf);
+		/* drop through to normal processing */
+	}
+
+	vacrelstats->scanned_pages++;
+	vacrelstats->tupcount_pages++;
+
+	page = BufferGetPage(buf);
+
+	if (PageIsNew(page))
+	{
+		bool		still_new;
+
+		/*
+		 * All-zeroes pages can be left over if either a backend extends
+		 * the relation by a single page, but crashes before the newly
+		 * initialized page has been written out, or when bulk-extending
+		 * the relation (which creates a number of empty pages at the tail
+		 * end of the relation, but enters them into the FSM).
+		 *
+		 * Make sure these pages are in the FSM, to ensure they can be
+		 * reused. Do that by testing if there's any space recorded for
+		 * the page. If not, enter it.
+		 *
+		 * Note we do not enter the page into the visibilitymap. That has
+		 * the downside that we repeatedly visit this page in subsequent
+		 * vacuums, but otherwise we'll never not discover the space on a
+		 * promoted standby. The harm of repeated checking ought to
+		 * normally not be too bad - the space usually should be used at
+		 * some point, otherwise there wouldn't be any regular vacuums.
+		 */
+
+		/*
+		 * Perform checking of FSM after releasing lock, the fsm is
+		 * approximate, after all.
+		 */
+		still_new = PageIsNew(page);
+		UnlockReleaseBuffer(buf);
+
+		if (still_new)
+		{
+			vacrelstats->empty_pages++;
+
+			if (GetRecordedFreeSpace(onerel, blkno) == 0)
 			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
-				all_visible = false;
-				continue;
+				Size		freespace;
+
+				freespace = BufferGetPageSize(buf) - SizeOfPageHeaderData;
+				RecordPageWithFreeSpace(onerel, blkno, freespace);
 			}
+		}
+		return false;
+	}
 
-			Assert(ItemIdIsNormal(itemid));
+	if (PageIsEmpty(page))
+	{
+		vacrelstats->empty_pages++;
+		freespace = PageGetHeapFreeSpace(page);
 
-			tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
-			tuple.t_len = ItemIdGetLength(itemid);
-			tuple.t_tableOid = RelationGetRelid(onerel);
+		/*
+		 * Empty pages are always all-visible and all-frozen (note that
+		 * the same is currently not true for new pages, see above).
+		 */
+		if (!PageIsAllVisible(page))
+		{
+			START_CRIT_SECTION();
 
-			tupgone = false;
+			/* mark buffer dirty before writing a WAL record */
+			MarkBufferDirty(buf);
 
 			/*
-			 * The criteria for counting a tuple as live in this block need to
-			 * match what analyze.c's acquire_sample_rows() does, otherwise
-			 * VACUUM and ANALYZE may produce wildly different reltuples
-			 * values, e.g. when there are many recently-dead tuples.
-			 *
-			 * The logic here is a bit simpler than acquire_sample_rows(), as
-			 * VACUUM can't run inside a transaction block, which makes some
-			 * cases impossible (e.g. in-progress insert from the same
-			 * transaction).
+			 * It's possible that another backend has extended the heap,
+			 * initialized the page, and then failed to WAL-log the page
+			 * due to an ERROR.  Since heap extension is not WAL-logged,
+			 * recovery might try to replay our record setting the page
+			 * all-visible and find that the page isn't initialized, which
+			 * will cause a PANIC.  To prevent that, check whether the
+			 * page has been previously WAL-logged, and if not, do that
+			 * now.
 			 */
-			switch (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf))
-			{
-				case HEAPTUPLE_DEAD:
+			if (RelationNeedsWAL(onerel) &&
+				PageGetLSN(page) == InvalidXLogRecPtr)
+				log_newpage_buffer(buf, true);
 
-					/*
-					 * Ordinarily, DEAD tuples would have been removed by
-					 * heap_page_prune(), but it's possible that the tuple
-					 * state changed since heap_page_prune() looked.  In
-					 * particular an INSERT_IN_PROGRESS tuple could have
-					 * changed to DEAD if the inserter aborted.  So this
-					 * cannot be considered an error condition.
-					 *
-					 * If the tuple is HOT-updated then it must only be
-					 * removed by a prune operation; so we keep it just as if
-					 * it were RECENTLY_DEAD.  Also, if it's a heap-only
-					 * tuple, we choose to keep it, because it'll be a lot
-					 * cheaper to get rid of it in the next pruning pass than
-					 * to treat it like an indexed tuple. Finally, if index
-					 * cleanup is disabled, the second heap pass will not
-					 * execute, and the tuple will not get removed, so we must
-					 * treat it like any other dead tuple that we choose to
-					 * keep.
-					 *
-					 * If this were to happen for a tuple that actually needed
-					 * to be deleted, we'd be in trouble, because it'd
-					 * possibly leave a tuple below the relation's xmin
-					 * horizon alive.  heap_prepare_freeze_tuple() is prepared
-					 * to detect that case and abort the transaction,
-					 * preventing corruption.
-					 */
-					if (HeapTupleIsHotUpdated(&tuple) ||
-						HeapTupleIsHeapOnly(&tuple) ||
-						params->index_cleanup == VACOPT_TERNARY_DISABLED)
-						nkeep += 1;
-					else
-						tupgone = true; /* we can delete the tuple */
-					all_visible = false;
-					break;
-				case HEAPTUPLE_LIVE:
+			PageSetAllVisible(page);
+			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+							  *vmbuffer, InvalidTransactionId,
+							  VISIBILITYMAP_ALL_VISIBLE | VISIBILITYMAP_ALL_FROZEN);
+			END_CRIT_SECTION();
+		}
 
-					/*
-					 * Count it as live.  Not only is this natural, but it's
-					 * also what acquire_sample_rows() does.
-					 */
-					live_tuples += 1;
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(onerel, blkno, freespace);
+		return false;
+	}
 
-					/*
-					 * Is the tuple definitely visible to all transactions?
-					 *
-					 * NB: Like with per-tuple hint bits, we can't set the
-					 * PD_ALL_VISIBLE flag if the inserter committed
-					 * asynchronously. See SetHintBits for more info. Check
-					 * that the tuple is hinted xmin-committed because of
-					 * that.
-					 */
-					if (all_visible)
-					{
-						TransactionId xmin;
+	/*
+	 * Prune all HOT-update chains in this page.
+	 *
+	 * We count tuples removed by the pruning step as removed by VACUUM.
+	 */
+	vacrelstats->tups_vacuumed += heap_page_prune(onerel, buf, OldestXmin,
+												  false,
+												  &vacrelstats->latestRemovedXid);
 
-						if (!HeapTupleHeaderXminCommitted(tuple.t_data))
-						{
-							all_visible = false;
-							break;
-						}
+	/*
+	 * Now scan the page to collect vacuumable items and check for tuples
+	 * requiring freezing.
+	 */
+	all_visible = true;
+	has_dead_tuples = false;
+	nfrozen = 0;
+	hastup = false;
+	ndeadoffsets = 0;
+	maxoff = PageGetMaxOffsetNumber(page);
 
-						/*
-						 * The inserter definitely committed. But is it old
-						 * enough that everyone sees it as committed?
-						 */
-						xmin = HeapTupleHeaderGetXmin(tuple.t_data);
-						if (!TransactionIdPrecedes(xmin, OldestXmin))
-						{
-							all_visible = false;
-							break;
-						}
+	/*
+	 * Note: If you change anything in the loop below, also look at
+	 * heap_page_is_all_visible to see if that needs to be changed.
+	 */
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid;
+
+		itemid = PageGetItemId(page, offnum);
+
+		/* Unused items require no processing, but we count 'em */
+		if (!ItemIdIsUsed(itemid))
+		{
+			vacrelstats->nunused += 1;
+			continue;
+		}
+
+		/* Redirect items mustn't be touched */
+		if (ItemIdIsRedirected(itemid))
+		{
+			hastup = true;	/* this page won't be truncatable */
+			continue;
+		}
+
+		ItemPointerSet(&(tuple.t_self), blkno, offnum);
+
+		/*
+		 * DEAD line pointers are to be vacuumed normally; but we don't
+		 * count them in tups_vacuumed, else we'd be double-counting (at
+		 * least in the common case where heap_page_prune() just freed up
+		 * a non-HOT tuple).
+		 */
+		if (ItemIdIsDead(itemid))
+		{
+			deadoffsets[ndeadoffsets++] = offnum;
+			all_visible = false;
+			continue;
+		}
+
+		Assert(ItemIdIsNormal(itemid));
+
+		tuple.t_data = (HeapTupleHeader) PageGetItem(page, itemid);
+		tuple.t_len = ItemIdGetLength(itemid);
+		tuple.t_tableOid = RelationGetRelid(onerel);
+
+		tupgone = false;
+
+		/*
+		 * The criteria for counting a tuple as live in this block need to
+		 * match what analyze.c's acquire_sample_rows() does, otherwise
+		 * VACUUM and ANALYZE may produce wildly different reltuples
+		 * values, e.g. when there are many recently-dead tuples.
+		 *
+		 * The logic here is a bit simpler than acquire_sample_rows(), as
+		 * VACUUM can't run inside a transaction block, which makes some
+		 * cases impossible (e.g. in-progress insert from the same
+		 * transaction).
+		 */
+		switch (HeapTupleSatisfiesVacuum(&tuple, OldestXmin, buf))
+		{
+			case HEAPTUPLE_DEAD:
+
+				/*
+				 * Ordinarily, DEAD tuples would have been removed by
+				 * heap_page_prune(), but it's possible that the tuple
+				 * state changed since heap_page_prune() looked.  In
+				 * particular an INSERT_IN_PROGRESS tuple could have
+				 * changed to DEAD if the inserter aborted.  So this
+				 * cannot be considered an error condition.
+				 *
+				 * If the tuple is HOT-updated then it must only be
+				 * removed by a prune operation; so we keep it just as if
+				 * it were RECENTLY_DEAD.  Also, if it's a heap-only
+				 * tuple, we choose to keep it, because it'll be a lot
+				 * cheaper to get rid of it in the next pruning pass than
+				 * to treat it like an indexed tuple. Finally, if index
+				 * cleanup is disabled, the second heap pass will not
+				 * execute, and the tuple will not get removed, so we must
+				 * treat it like any other dead tuple that we choose to
+				 * keep.
+				 *
+				 * If this were to happen for a tuple that actually needed
+				 * to be deleted, we'd be in trouble, because it'd
+				 * possibly leave a tuple below the relation's xmin
+				 * horizon alive.  heap_prepare_freeze_tuple() is prepared
+				 * to detect that case and abort the transaction,
+				 * preventing corruption.
+				 */
+				if (HeapTupleIsHotUpdated(&tuple) ||
+					HeapTupleIsHeapOnly(&tuple) ||
+					params->index_cleanup == VACOPT_TERNARY_DISABLED)
+					vacrelstats->nkeep += 1;
+				else
+					tupgone = true; /* we can delete the tuple */
+				all_visible = false;
+				break;
+			case HEAPTUPLE_LIVE:
+
+				/*
+				 * Count it as live.  Not only is this natural, but it's
+				 * also what acquire_sample_rows() does.
+				 */
+				vacrelstats->live_tuples += 1;
+
+				/*
+				 * Is the tuple definitely visible to all transactions?
+				 *
+				 * NB: Like with per-tuple hint bits, we can't set the
+				 * PD_ALL_VISIBLE flag if the inserter committed
+				 * asynchronously. See SetHintBits for more info. Check
+				 * that the tuple is hinted xmin-committed because of
+				 * that.
+				 */
+				if (all_visible)
+				{
+					TransactionId xmin;
 
-						/* Track newest xmin on page. */
-						if (TransactionIdFollows(xmin, visibility_cutoff_xid))
-							visibility_cutoff_xid = xmin;
+					if (!HeapTupleHeaderXminCommitted(tuple.t_data))
+					{
+						all_visible = false;
+						break;
 					}
-					break;
-				case HEAPTUPLE_RECENTLY_DEAD:
 
 					/*
-					 * If tuple is recently deleted then we must not remove it
-					 * from relation.
+					 * The inserter definitely committed. But is it old
+					 * enough that everyone sees it as committed?
 					 */
-					nkeep += 1;
-					all_visible = false;
-					break;
-				case HEAPTUPLE_INSERT_IN_PROGRESS:
+					xmin = HeapTupleHeaderGetXmin(tuple.t_data);
+					if (!TransactionIdPrecedes(xmin, OldestXmin))
+					{
+						all_visible = false;
+						break;
+					}
 
-					/*
-					 * This is an expected case during concurrent vacuum.
-					 *
-					 * We do not count these rows as live, because we expect
-					 * the inserting transaction to update the counters at
-					 * commit, and we assume that will happen only after we
-					 * report our results.  This assumption is a bit shaky,
-					 * but it is what acquire_sample_rows() does, so be
-					 * consistent.
-					 */
-					all_visible = false;
-					break;
-				case HEAPTUPLE_DELETE_IN_PROGRESS:
-					/* This is an expected case during concurrent vacuum */
-					all_visible = false;
+					/* Track newest xmin on page. */
+					if (TransactionIdFollows(xmin, visibility_cutoff_xid))
+						visibility_cutoff_xid = xmin;
+				}
+				break;
+			case HEAPTUPLE_RECENTLY_DEAD:
 
-					/*
-					 * Count such rows as live.  As above, we assume the
-					 * deleting transaction will commit and update the
-					 * counters after we report.
-					 */
-					live_tuples += 1;
-					break;
-				default:
-					elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
-					break;
-			}
+				/*
+				 * If tuple is recently deleted then we must not remove it
+				 * from relation.
+				 */
+				vacrelstats->nkeep += 1;
+				all_visible = false;
+				break;
+			case HEAPTUPLE_INSERT_IN_PROGRESS:
 
-			if (tupgone)
-			{
-				lazy_record_dead_tuple(vacrelstats, &(tuple.t_self));
-				HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
-													   &vacrelstats->latestRemovedXid);
-				tups_vacuumed += 1;
-				has_dead_tuples = true;
-			}
-			else
-			{
-				bool		tuple_totally_frozen;
+				/*
+				 * This is an expected case during concurrent vacuum.
+				 *
+				 * We do not count these rows as live, because we expect
+				 * the inserting transaction to update the counters at
+				 * commit, and we assume that will happen only after we
+				 * report our results.  This assumption is a bit shaky,
+				 * but it is what acquire_sample_rows() does, so be
+				 * consistent.
+				 */
+				all_visible = false;
+				break;
+			case HEAPTUPLE_DELETE_IN_PROGRESS:
+				/* This is an expected case during concurrent vacuum */
+				all_visible = false;
 
-				num_tuples += 1;
-				hastup = true;
+				/*
+				 * Count such rows as live.  As above, we assume the
+				 * deleting transaction will commit and update the
+				 * counters after we report.
+				 */
+				vacrelstats->live_tuples += 1;
+				break;
+			default:
+				elog(ERROR, "unexpected HeapTupleSatisfiesVacuum result");
+				break;
+		}
+
+		if (tupgone)
+		{
+			deadoffsets[ndeadoffsets++] = offnum;
+			HeapTupleHeaderAdvanceLatestRemovedXid(tuple.t_data,
+												   &vacrelstats->latestRemovedXid);
+			vacrelstats->tups_vacuumed += 1;
+			has_dead_tuples = true;
+		}
+		else
+		{
+			bool		tuple_totally_frozen;
+
+			vacrelstats->num_tuples += 1;
+			hastup = true;
+
+			/*
+			 * Each non-removable tuple must be checked to see if it needs
+			 * freezing.  Note we already have exclusive buffer lock.
+			 */
+			if (heap_prepare_freeze_tuple(tuple.t_data,
+										  onerel->rd_rel->relfrozenxid,
+										  onerel->rd_rel->relminmxid,
+										  FreezeLimit, MultiXactCutoff,
+										  &frozen[nfrozen],
+										  &tuple_totally_frozen))
+				frozen[nfrozen++].offset = offnum;
+
+			if (!tuple_totally_frozen)
+				all_frozen = false;
+		}
+	}						/* scan along page */
+
+	/*
+	 * If we froze any tuples, mark the buffer dirty, and write a WAL
+	 * record recording the changes.  We must log the changes to be
+	 * crash-safe against future truncation of CLOG.
+	 */
+	if (nfrozen > 0)
+	{
+		START_CRIT_SECTION();
+
+		MarkBufferDirty(buf);
+
+		/* execute collected freezes */
+		for (i = 0; i < nfrozen; i++)
+		{
+			ItemId		itemid;
+			HeapTupleHeader htup;
+
+			itemid = PageGetItemId(page, frozen[i].offset);
+			htup = (HeapTupleHeader) PageGetItem(page, itemid);
+
+			heap_execute_freeze_tuple(htup, &frozen[i]);
+		}
+
+		/* Now WAL-log freezing if necessary */
+		if (RelationNeedsWAL(onerel))
+		{
+			XLogRecPtr	recptr;
+
+			recptr = log_heap_freeze(onerel, buf, FreezeLimit,
+									 frozen, nfrozen);
+			PageSetLSN(page, recptr);
+		}
+
+		END_CRIT_SECTION();
+	}
+
+	/*
+	 * If there are no indexes we can vacuum the page right now instead of
+	 * doing a second scan. Also we don't do that but forget dead tuples
+	 * when index cleanup is disabled.  Otherwise remember the page's dead
+	 * tuples for the index and heap vacuuming passes.
+	 */
+	if (vacrelstats->useindex && ndeadoffsets > 0)
+		lazy_record_dead_tuples(vacrelstats, blkno, deadoffsets,
+								ndeadoffsets);
+	else if (ndeadoffsets > 0)
+	{
+		if (nindexes == 0)
+		{
+			/* Remove tuples from heap if the table has no index */
+			lazy_vacuum_page(onerel, blkno, buf, deadoffsets, ndeadoffsets,
+							 vacrelstats, vmbuffer);
+			vacrelstats->vacuumed_pages++;
+			has_dead_tuples = false;
+		}
+		else
+		{
+			/*
+			 * Here, we have indexes but index cleanup is disabled.
+			 * Instead of vacuuming the dead tuples on the heap, we just
+			 * forget them.
+			 *
+			 * Note that deadoffsets could have tuples which became dead
+			 * after HOT-pruning but are not marked dead yet.
+			 * We do not process them because it's a very rare condition,
+			 * and the next vacuum will process them anyway.
+			 */
+			Assert(params->index_cleanup == VACOPT_TERNARY_DISABLED);
+		}
+
+		/*
+		 * Forget the now-vacuumed tuples, and press on, but be careful
+		 * not to reset latestRemovedXid since we want that value to be
+		 * valid.
+		 */
+		ndeadoffsets = 0;
+		removed = true;
+	}
+
+	freespace = PageGetHeapFreeSpace(page);
+
+	/* mark page all-visible, if appropriate */
+	if (all_visible && !all_visible_according_to_vm)
+	{
+		uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+
+		if (all_frozen)
+			flags |= VISIBILITYMAP_ALL_FROZEN;
+
+		/*
+		 * It should never be the case that the visibility map page is set
+		 * while the page-level bit is clear, but the reverse is allowed
+		 * (if checksums are not enabled).  Regardless, set the both bits
+		 * so that we get back in sync.
+		 *
+		 * NB: If the heap page is all-visible but the VM bit is not set,
+		 * we don't need to dirty the heap page.  However, if checksums
+		 * are enabled, we do need to make sure that the heap page is
+		 * dirtied before passing it to visibilitymap_set(), because it
+		 * may be logged.  Given that this situation should only happen in
+		 * rare cases after a crash, it is not worth optimizing.
+		 */
+		PageSetAllVisible(page);
+		MarkBufferDirty(buf);
+		visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+						  *vmbuffer, visibility_cutoff_xid, flags);
+	}
+
+	/*
+	 * As of PostgreSQL 9.2, the visibility map bit should never be set if
+	 * the page-level bit is clear.  However, it's possible that the bit
+	 * got cleared after we checked it and before we took the buffer
+	 * content lock, so we must recheck before jumping to the conclusion
+	 * that something bad has happened.
+	 */
+	else if (all_visible_according_to_vm && !PageIsAllVisible(page)
+			 && VM_ALL_VISIBLE(onerel, blkno, vmbuffer))
+	{
+		elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
+			 RelationGetRelationName(onerel), blkno);
+		visibilitymap_clear(onerel, blkno, *vmbuffer,
+							VISIBILITYMAP_VALID_BITS);
+	}
+
+	/*
+	 * It's possible for the value returned by GetOldestXmin() to move
+	 * backwards, so it's not wrong for us to see tuples that appear to
+	 * not be visible to everyone yet, while PD_ALL_VISIBLE is already
+	 * set. The real safe xmin value never moves backwards, but
+	 * GetOldestXmin() is conservative and sometimes returns a value
+	 * that's unnecessarily small, so if we see that contradiction it just
+	 * means that the tuples that we think are not visible to everyone yet
+	 * actually are, and the PD_ALL_VISIBLE flag is correct.
+	 *
+	 * There should never be dead tuples on a page with PD_ALL_VISIBLE
+	 * set, however.
+	 */
+	else if (PageIsAllVisible(page) && has_dead_tuples)
+	{
+		elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
+			 RelationGetRelationName(onerel), blkno);
+		PageClearAllVisible(page);
+		MarkBufferDirty(buf);
+		visibilitymap_clear(onerel, blkno, *vmbuffer,
+							VISIBILITYMAP_VALID_BITS);
+	}
+
+	/*
+	 * If the all-visible page is turned out to be all-frozen but not
+	 * marked, we should so mark it.  Note that all_frozen is only valid
+	 * if all_visible is true, so we must check both.
+	 */
+	else if (all_visible_according_to_vm && all_visible && all_frozen &&
+			 !VM_ALL_FROZEN(onerel, blkno, vmbuffer))
+	{
+		/*
+		 * We can pass InvalidTransactionId as the cutoff XID here,
+		 * because setting the all-frozen bit doesn't cause recovery
+		 * conflicts.
+		 */
+		visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
+						  *vmbuffer, InvalidTransactionId,
+						  VISIBILITYMAP_ALL_FROZEN);
+	}
+
+	UnlockReleaseBuffer(buf);
+
+	/* Remember the location of the last page with nonremovable tuples */
+	if (hastup)
+		vacrelstats->nonempty_pages = blkno + 1;
+
+	/*
+	 * If we remembered any tuples for deletion, then the page will be
+	 * visited again by lazy_vacuum_heap, which will compute and record
+	 * its post-compaction free space.  If not, then we're done with this
+	 * page, so remember its free space as-is.  (This path will always be
+	 * taken if there are no indexes.)
+	 */
+	if (ndeadoffsets == 0)
+		RecordPageWithFreeSpace(onerel, blkno, freespace);
+
+	return removed;
+}
+
+/*
+ *	lazy_vacuum_dead_tuples() -- vacuum the indexes and the heap
+ *
+ *		Removes the index entries of the dead tuples collected so far, then
+ *		the tuples themselves.  The caller forgets the dead tuples afterwards.
+ */
+static void
+lazy_vacuum_dead_tuples(Relation onerel, LVRelStats *vacrelstats,
+						Relation *Irel, IndexBulkDeleteResult **indstats,
+						int nindexes)
+{
+	const int	hvp_index[] = {
+		PROGRESS_VACUUM_PHASE,
+		PROGRESS_VACUUM_NUM_INDEX_VACUUMS
+	};
+	int64		hvp_val[2];
+
+	/* Log cleanup info before we touch indexes */
+	vacuum_log_cleanup_info(onerel, vacrelstats);
+
+	/* Report that we are now vacuuming indexes */
+	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+								 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
+
+	/* Remove index entries */
+	lazy_vacuum_all_indexes(Irel, indstats, vacrelstats, nindexes);
+
+	/*
+	 * Report that we are now vacuuming the heap.  We also increase the
+	 * number of index scans here; note that by using
+	 * pgstat_progress_update_multi_param we can update both parameters
+	 * atomically.
+	 */
+	hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
+	hvp_val[1] = vacrelstats->num_index_scans + 1;
+	pgstat_progress_update_multi_param(2, hvp_index, hvp_val);
+
+	/* Remove tuples from heap */
+	lazy_vacuum_heap(onerel, vacrelstats);
+	vacrelstats->num_index_scans++;
+}
+
+/*
+ *	lazy_parallel_scan_heap() -- scan the heap with parallel workers
+ *
+ *		The leader's side of a parallel heap scan.  Each round launches the
+ *		workers and joins them in scanning pages, until all pages have been
+ *		scanned or the shared dead tuple arrays are full.  In the latter case
+ *		the indexes and the heap are vacuumed before the next round, as the
+ *		serial scan does when it runs out of memory.  The workers' counters
+ *		are added to vacrelstats after each round.
+ */
+static void
+lazy_parallel_scan_heap(Relation onerel, VacuumParams *params,
+						LVRelStats *vacrelstats, Relation *Irel, int nindexes,
+						IndexBulkDeleteResult **indstats, bool aggressive,
+						BlockNumber *next_fsm_block_to_vacuum)
+{
+	LVParallelState *lps = vacrelstats->lps;
+	LVParallelScan *lvscan = lps->lvscan;
+	BlockNumber nblocks = vacrelstats->rel_pages;
+	int			i;
+
+	for (;;)
+	{
+		BlockNumber nscanned;
+
+		lps->lvshared->scan_heap = true;
+		MemSet(lvscan->worker_stats, 0,
+			   mul_size(sizeof(LVRelStats), lps->pcxt->nworkers));
+		launch_parallel_vacuum_workers(lps, lps->nworkers_heap);
+
+		ereport(elevel,
+				(errmsg(ngettext("launched %d parallel vacuum worker for heap scanning (planned: %d)",
+								 "launched %d parallel vacuum workers for heap scanning (planned: %d)",
+								 lps->pcxt->nworkers_launched),
+						lps->pcxt->nworkers_launched, lps->nworkers_heap)));
+
+		lazy_parallel_scan_pages(onerel, params, vacrelstats, nindexes,
+								 aggressive);
+
+		wait_parallel_vacuum_workers(lps);
+
+		for (i = 0; i < lps->pcxt->nworkers_launched; i++)
+			lazy_add_scan_stats(vacrelstats, &lvscan->worker_stats[i]);
+
+		/*
+		 * The participants got their pages in ascending order, so once they
+		 * have all stopped, the pages handed out so far are exactly the
+		 * scanned ones.
+		 */
+		nscanned = (BlockNumber)
+			Min(pg_atomic_read_u64(&lvscan->pscan.phs_nallocated), nblocks);
+		pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+									 nscanned);
+
+		if (vacrelstats->useindex)
+		{
+			LVDeadTuples *dead_tuples = lps->dead_tuples;
+
+			qsort(dead_tuples->pages, dead_tuples->npages,
+				  sizeof(LVDeadTuplePage), vac_cmp_dead_page);
+			vacrelstats->num_dead_tuples = dead_tuples->ntuples;
+			vacrelstats->num_dead_pages = dead_tuples->npages;
+			pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+										 vacrelstats->num_dead_tuples);
+		}
+
+		if (nscanned >= nblocks)
+			break;
+
+		/*
+		 * We stopped because the dead tuple arrays are full.  Vacuum the
+		 * indexes and the heap, and start over with empty arrays.
+		 */
+		Assert(lvscan->full && vacrelstats->num_dead_tuples > 0);
+		lazy_vacuum_dead_tuples(onerel, vacrelstats, Irel, indstats,
+								nindexes);
+		lazy_reset_dead_tuples(vacrelstats);
+
+		/* Vacuum the Free Space Map for the pages scanned so far */
+		FreeSpaceMapVacuumRange(onerel, *next_fsm_block_to_vacuum, nscanned);
+		*next_fsm_block_to_vacuum = nscanned;
+
+		/* Report that we are once again scanning the heap */
+		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
+									 PROGRESS_VACUUM_PHASE_SCAN_HEAP);
+	}
+}
+
+/*
+ *	lazy_parallel_scan_pages() -- scan pages of a parallel heap scan
+ *
+ *		Run by the leader and by each worker in every round of a parallel
+ *		heap scan.  Gets pages from the shared block scan and processes them
+ *		with lazy_scan_page, until there are no more or no room is left for
+ *		another page's dead tuples.  vacrelstats is the participant's own.
+ */
+static void
+lazy_parallel_scan_pages(Relation onerel, VacuumParams *params,
+						 LVRelStats *vacrelstats, int nindexes,
+						 bool aggressive)
+{
+	LVParallelState *lps = vacrelstats->lps;
+	ParallelBlockTableScanDesc pscan = &lps->lvscan->pscan;
+	BlockNumber nblocks = pscan->phs_nblocks;
+	BlockNumber run_start = 0;
+	BlockNumber run_end = 0;
+	bool		run_skippable = false;
+	Buffer		vmbuffer = InvalidBuffer;
+	xl_heap_freeze_tuple *frozen;
+
+	frozen = palloc(sizeof(xl_heap_freeze_tuple) * MaxHeapTuplesPerPage);
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+
+	table_block_parallelscan_startblock_init(onerel, pscan);
+
+	for (;;)
+	{
+		BlockNumber blkno;
+		bool		force_check;
+
+		/* Make sure the page's dead tuples will fit before taking it */
+		if (vacrelstats->useindex && !lazy_reserve_dead_tuples(lps))
+			break;
+
+		blkno = table_block_parallelscan_nextpage(onerel, pscan);
+		if (blkno == InvalidBlockNumber)
+		{
+			if (vacrelstats->useindex)
+				lazy_release_dead_tuples(lps);
+			break;
+		}
+
+		if (!IsParallelWorker())
+			pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED,
+										 blkno);
+
+		/* see lazy_scan_heap about forcing scanning of last page */
+		force_check = (blkno == nblocks - 1 &&
+					   should_attempt_truncation(params, vacrelstats));
+
+		/* Skip the page under the same rules as lazy_scan_heap */
+		if ((params->options & VACOPT_DISABLE_PAGE_SKIPPING) == 0)
+		{
+			if (blkno < run_start || blkno >= run_end)
+				run_skippable = lazy_skippable_run(onerel, blkno, nblocks,
+												   aggressive, &vmbuffer,
+												   &run_start, &run_end);
+			if (run_skippable && !force_check)
+			{
+				if (aggressive || VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
+					vacrelstats->frozenskipped_pages++;
+				if (vacrelstats->useindex)
+					lazy_release_dead_tuples(lps);
+				continue;
+			}
+		}
+
+		vacuum_delay_point();
+
+		(void) lazy_scan_page(onerel, params, vacrelstats, nindexes, blkno,
+							  aggressive, force_check,
+							  VM_ALL_VISIBLE(onerel, blkno, &vmbuffer),
+							  frozen, &vmbuffer);
+
+		if (vacrelstats->useindex)
+			lazy_release_dead_tuples(lps);
+	}
+
+	if (BufferIsValid(vmbuffer))
+		ReleaseBuffer(vmbuffer);
+	pfree(frozen);
+
+	if (VacuumActiveNWorkers)
+		pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+}
+
+/*
+ *	lazy_skippable_run() -- find the run of skippable pages around blkno
+ *
+ *		The participants of a parallel heap scan don't see the pages in one
+ *		sequence, so instead of tracking the next unskippable page as
+ *		lazy_scan_heap does, each looks up the whole run of pages the
+ *		visibility map lets us skip that blkno belongs to, and remembers it
+ *		in *run_start and *run_end (exclusive) for the pages that follow.  If
+ *		blkno can't be skipped, the run is just blkno.  Returns true if the
+ *		pages of the run are to be skipped, which is when the run is at
+ *		least SKIP_PAGES_THRESHOLD pages long, as in lazy_scan_heap.
+ */
+static bool
+lazy_skippable_run(Relation onerel, BlockNumber blkno, BlockNumber nblocks,
+				   bool aggressive, Buffer *vmbuffer,
+				   BlockNumber *run_start, BlockNumber *run_end)
+{
+	uint8		skipflag = aggressive ?
+		VISIBILITYMAP_ALL_FROZEN : VISIBILITYMAP_ALL_VISIBLE;
+	BlockNumber start = blkno;
+	BlockNumber end = blkno + 1;
+
+	if ((visibilitymap_get_status(onerel, blkno, vmbuffer) & skipflag) != 0)
+	{
+		while (start > 0 &&
+			   (visibilitymap_get_status(onerel, start - 1,
+										 vmbuffer) & skipflag) != 0)
+		{
+			vacuum_delay_point();
+			start--;
+		}
+		while (end < nblocks &&
+			   (visibilitymap_get_status(onerel, end,
+										 vmbuffer) & skipflag) != 0)
+		{
+			vacuum_delay_point();
+			end++;
+		}
+	}
+
+	*run_start = start;
+	*run_end = end;
+
+	return end - start >= SKIP_PAGES_THRESHOLD;
+}
+
+/*
+ *	lazy_reserve_dead_tuples() -- make room for a page's dead tuples
+ *
+ *		Reserves room for MaxHeapTuplesPerPage dead tuples in the shared
+ *		arrays, for the page a participant of a parallel heap scan is about
+ *		to take.  If there isn't enough, marks the arrays full, so that the
+ *		other participants stop, too, and returns false.
+ */
+static bool
+lazy_reserve_dead_tuples(LVParallelState *lps)
+{
+	LVParallelScan *lvscan = lps->lvscan;
+	LVDeadTuples *dead_tuples = lps->dead_tuples;
+	bool		reserved = false;
+
+	SpinLockAcquire(&lvscan->mutex);
+	if (!lvscan->full &&
+		dead_tuples->npages + lvscan->reserved_pages <
+		dead_tuples->maxpages &&
+		dead_tuples->ntuples + lvscan->reserved_tuples +
+		MaxHeapTuplesPerPage <= dead_tuples->maxtuples)
+	{
+		lvscan->reserved_pages++;
+		lvscan->reserved_tuples += MaxHeapTuplesPerPage;
+		reserved = true;
+	}
+	else
+		lvscan->full = true;
+	SpinLockRelease(&lvscan->mutex);
+
+	return reserved;
+}
+
+/*
+ *	lazy_release_dead_tuples() -- give back the room reserved for a page
+ */
+static void
+lazy_release_dead_tuples(LVParallelState *lps)
+{
+	LVParallelScan *lvscan = lps->lvscan;
+
+	SpinLockAcquire(&lvscan->mutex);
+	Assert(lvscan->reserved_pages > 0);
+	lvscan->reserved_pages--;
+	lvscan->reserved_tuples -= MaxHeapTuplesPerPage;
+	SpinLockRelease(&lvscan->mutex);
+}
+
+/*
+ *	lazy_add_scan_stats() -- add up the heap scan counters of two participants
+ */
+static void
+lazy_add_scan_stats(LVRelStats *dst, LVRelStats *src)
+{
+	dst->scanned_pages += src->scanned_pages;
+	dst->pinskipped_pages += src->pinskipped_pages;
+	dst->frozenskipped_pages += src->frozenskipped_pages;
+	dst->tupcount_pages += src->tupcount_pages;
+	dst->empty_pages += src->empty_pages;
+	dst->vacuumed_pages += src->vacuumed_pages;
+	dst->nonempty_pages = Max(dst->nonempty_pages, src->nonempty_pages);
+	dst->num_tuples += src->num_tuples;
+	dst->live_tuples += src->live_tuples;
+	dst->tups_vacuumed += src->tups_vacuumed;
+	dst->nkeep += src->nkeep;
+	dst->nunused += src->nunused;
+	if (TransactionIdFollows(src->latestRemovedXid, dst->latestRemovedXid))
+		dst->latestRemovedXid = src->latestRemovedXid;
+}
+
+/*
+ *	lazy_vacuum_heap() -- second pass over the heap
+ *
+ *		This routine marks dead tuples as unused and compacts out free
+ *		space on their pages.  Pages not having dead tuples recorded from
+ *		lazy_scan_heap are not visited at all.  After a parallel heap scan,
+ *		the pages and their dead tuples are taken from the sorted arrays in
+ *		DSM instead of the IntegerSet.
+ *
+ * Note: the reason for doing this as a second pass is we cannot remove
+ * the tuples until we've removed their index entries, and we want to
+ * process index entry removal in batches as large as possible.
+ */
+static void
+lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
+{
+	LVDeadTuples *dead_tuples = NULL;
+	int64		pageidx = 0;
+	int64		ntuples;
+	int			npages;
+	PGRUsage	ru0;
+	Buffer		vmbuffer = InvalidBuffer;
+	uint64		val;
+	bool		more;
+
+	pg_rusage_init(&ru0);
+	npages = 0;
+	ntuples = 0;
+
+	if (vacrelstats->lps != NULL)
+	{
+		dead_tuples = vacrelstats->lps->dead_tuples;
+		more = dead_tuples->npages > 0;
+	}
+	else
+	{
+		/* The set returns TIDs in order, so each page's TIDs come together */
+		intset_begin_iterate(vacrelstats->dead_tuples);
+		more = intset_iterate_next(vacrelstats->dead_tuples, &val);
+	}
+	while (more)
+	{
+		BlockNumber tblk;
+		OffsetNumber setoffsets[MaxHeapTuplesPerPage];
+		OffsetNumber *deadoffsets;
+		int			ndeadoffsets;
+		Buffer		buf;
+		Page		page;
+		Size		freespace;
+
+		if (dead_tuples != NULL)
+		{
+			LVDeadTuplePage *dpage = &dead_tuples->pages[pageidx++];
+
+			tblk = dpage->blkno;
+			deadoffsets = LVDeadTuplesOffsets(dead_tuples) + dpage->first;
+			ndeadoffsets = dpage->noffsets;
+			more = pageidx < dead_tuples->npages;
+		}
+		else
+		{
+			tblk = VacDecodeBlock(val);
+			deadoffsets = setoffsets;
+			ndeadoffsets = 0;
+			do
+			{
+				Assert(ndeadoffsets < MaxHeapTuplesPerPage);
+				deadoffsets[ndeadoffsets++] = VacDecodeOffset(val);
+				more = intset_iterate_next(vacrelstats->dead_tuples, &val);
+			} while (more && VacDecodeBlock(val) == tblk);
+		}
+
+		vacuum_delay_point();
+
+		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
+								 vac_strategy);
+		if (!ConditionalLockBufferForCleanup(buf))
+		{
+			/* leave the dead line pointers for the next vacuum */
+			ReleaseBuffer(buf);
+			continue;
+		}
+		lazy_vacuum_page(onerel, tblk, buf, deadoffsets, ndeadoffsets,
+						 vacrelstats, &vmbuffer);
+		ntuples += ndeadoffsets;
+
+		/* Now that we've compacted the page, record its available space */
+		page = BufferGetPage(buf);
+		freespace = PageGetHeapFreeSpace(page);
+
+		UnlockReleaseBuffer(buf);
+		RecordPageWithFreeSpace(onerel, tblk, freespace);
+		npages++;
+	}
+
+	if (BufferIsValid(vmbuffer))
+	{
+		ReleaseBuffer(vmbuffer);
+		vmbuffer = InvalidBuffer;
+	}
+
+	ereport(elevel,
+			(errmsg("\"%s\": removed %.0f row versions in %d pages",
+					RelationGetRelationName(onerel),
+					(double) ntuples, npages),
+			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+}
+
+/*
+ *	lazy_vacuum_page() -- free dead tuples on a page
+ *					 and repair its fragmentation.
+ *
+ * Caller must hold pin and buffer cleanup lock on the buffer.
+ *
+ * deadoffsets holds the offsets of the ndeadoffsets dead tuples on this
+ * page, in ascending order.
+ */
+static void
+lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
+				 OffsetNumber *deadoffsets, int ndeadoffsets,
+				 LVRelStats *vacrelstats, Buffer *vmbuffer)
+{
+	Page		page = BufferGetPage(buffer);
+	TransactionId visibility_cutoff_xid;
+	bool		all_frozen;
+	int			i;
+
+	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
+
+	START_CRIT_SECTION();
+
+	for (i = 0; i < ndeadoffsets; i++)
+	{
+		ItemId		itemid;
+
+		itemid = PageGetItemId(page, deadoffsets[i]);
+		ItemIdSetUnused(itemid);
+	}
+
+	PageRepairFragmentation(page);
+
+	/*
+	 * Mark buffer dirty before we write WAL.
+	 */
+	MarkBufferDirty(buffer);
+
+	/* XLOG stuff */
+	if (RelationNeedsWAL(onerel))
+	{
+		XLogRecPtr	recptr;
+
+		recptr = log_heap_clean(onerel, buffer,
+								NULL, 0, NULL, 0,
+								deadoffsets, ndeadoffsets,
+								vacrelstats->latestRemovedXid);
+		PageSetLSN(page, recptr);
+	}
+
+	/*
+	 * End critical section, so we safely can do visibility tests (which
+	 * possibly need to perform IO and allocate memory!). If we crash now the
+	 * page (including the corresponding vm bit) might not be marked all
+	 * visible, but that's fine. A later vacuum will fix that.
+	 */
+	END_CRIT_SECTION();
+
+	/*
+	 * Now that we have removed the dead tuples from the page, once again
+	 * check if the page has become all-visible.  The page is already marked
+	 * dirty, exclusively locked, and, if needed, a full page image has been
+	 * emitted in the log_heap_clean() above.
+	 */
+	if (heap_page_is_all_visible(onerel, buffer, &visibility_cutoff_xid,
+								 &all_frozen))
+		PageSetAllVisible(page);
+
+	/*
+	 * All the changes to the heap page have been done. If the all-visible
+	 * flag is now set, also set the VM all-visible bit (and, if possible, the
+	 * all-frozen bit) unless this has already been done previously.
+	 */
+	if (PageIsAllVisible(page))
+	{
+		uint8		vm_status = visibilitymap_get_status(onerel, blkno, vmbuffer);
+		uint8		flags = 0;
+
+		/* Set the VM all-frozen bit to flag, if needed */
+		if ((vm_status & VISIBILITYMAP_ALL_VISIBLE) == 0)
+			flags |= VISIBILITYMAP_ALL_VISIBLE;
+		if ((vm_status & VISIBILITYMAP_ALL_FROZEN) == 0 && all_frozen)
+			flags |= VISIBILITYMAP_ALL_FROZEN;
+
+		Assert(BufferIsValid(*vmbuffer));
+		if (flags != 0)
+			visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr,
+							  *vmbuffer, visibility_cutoff_xid, flags);
+	}
+}
+
+/*
+ *	lazy_check_needs_freeze() -- scan page to see if any tuples
+ *					 need to be cleaned to avoid wraparound
+ *
+ * Returns true if the page needs to be vacuumed using cleanup lock.
+ * Also returns a flag indicating whether page contains any tuples at all.
+ */
+static bool
+lazy_check_needs_freeze(Buffer buf, bool *hastup)
+{
+	Page		page = BufferGetPage(buf);
+	OffsetNumber offnum,
+				maxoff;
+	HeapTupleHeader tupleheader;
+
+	*hastup = false;
+
+	/*
+	 * New and empty pages, obviously, don't contain tuples. We could make
+	 * sure that the page is registered in the FSM, but it doesn't seem worth
+	 * waiting for a cleanup lock just for that, especially because it's
+	 * likely that the pin holder will do so.
+	 */
+	if (PageIsNew(page) || PageIsEmpty(page))
+		return false;
+
+	maxoff = PageGetMaxOffsetNumber(page);
+	for (offnum = FirstOffsetNumber;
+		 offnum <= maxoff;
+		 offnum = OffsetNumberNext(offnum))
+	{
+		ItemId		itemid;
+
+		itemid = PageGetItemId(page, offnum);
+
+		/* this should match hastup test in count_nondeletable_pages() */
+		if (ItemIdIsUsed(itemid))
+			*hastup = true;
+
+		/* dead and redirect items never need freezing */
+		if (!ItemIdIsNormal(itemid))
+			continue;
+
+		tupleheader = (HeapTupleHeader) PageGetItem(page, itemid);
+
+		if (heap_tuple_needs_freeze(tupleheader, FreezeLimit,
+									MultiXactCutoff, buf))
+			return true;
+	}							/* scan along page */
+
+	return false;
+}
+
+
+/*
+ *	lazy_vacuum_all_indexes() -- delete dead tuples' entries from all indexes.
+ *
+ *		Uses parallel workers if that was planned and still pays off for this
+ *		pass; otherwise the indexes are vacuumed one after another.
+ */
+static void
+lazy_vacuum_all_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+						LVRelStats *vacrelstats, int nindexes)
+{
+	int			i;
+
+	if (vacrelstats->parallel_workers > 0 &&
+		lazy_parallel_vacuum_indexes(Irel, indstats, vacrelstats, nindexes,
+									 false))
+		return;
+
+	for (i = 0; i < nindexes; i++)
+		lazy_vacuum_index(Irel[i], &indstats[i],
+						  lazy_tid_reaped, (void *) vacrelstats,
+						  vacrelstats->old_live_tuples,
+						  vacrelstats->num_dead_tuples);
+}
+
+/*
+ *	lazy_cleanup_all_indexes() -- do post-vacuum cleanup for all indexes.
+ *
+ *		Like lazy_vacuum_all_indexes, this may use parallel workers.  The
+ *		resulting statistics are left in indstats; pg_class is updated by
+ *		update_index_statistics afterwards.
+ */
+static void
+lazy_cleanup_all_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+						 LVRelStats *vacrelstats, int nindexes)
+{
+	int			i;
+
+	if (vacrelstats->parallel_workers > 0 &&
+		lazy_parallel_vacuum_indexes(Irel, indstats, vacrelstats, nindexes,
+									 true))
+		return;
+
+	for (i = 0; i < nindexes; i++)
+		lazy_cleanup_index(Irel[i], &indstats[i],
+						   vacrelstats->new_rel_tuples,
+						   vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+}
+
+/*
+ *	lazy_vacuum_index() -- vacuum one index relation.
+ *
+ *		Delete all the index entries pointing to tuples for which callback
+ *		returns true, and update running statistics.  reltuples is the
+ *		(approximate) number of heap tuples, num_dead_tuples the number of
+ *		TIDs the callback knows about, for the log message.
+ */
+static void
+lazy_vacuum_index(Relation indrel,
+				  IndexBulkDeleteResult **stats,
+				  IndexBulkDeleteCallback callback,
+				  void *callback_state,
+				  double reltuples, int64 num_dead_tuples)
+{
+	IndexVacuumInfo ivinfo;
+	PGRUsage	ru0;
+
+	pg_rusage_init(&ru0);
+
+	ivinfo.index = indrel;
+	ivinfo.analyze_only = false;
+	ivinfo.report_progress = false;
+	ivinfo.estimated_count = true;
+	ivinfo.message_level = elevel;
+	/* We can only provide an approximate value of num_heap_tuples here */
+	ivinfo.num_heap_tuples = reltuples;
+	ivinfo.strategy = vac_strategy;
+
+	/* Do bulk deletion */
+	*stats = index_bulk_delete(&ivinfo, *stats, callback, callback_state);
+
+	ereport(elevel,
+			(errmsg("scanned index \"%s\" to remove %.0f row versions",
+					RelationGetRelationName(indrel),
+					(double) num_dead_tuples),
+			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+}
+
+/*
+ *	lazy_cleanup_index() -- do post-vacuum cleanup for one index relation.
+ *
+ *		reltuples is the new estimate of the total number of surviving heap
+ *		tuples, and estimated_count says whether it is only an estimate.
+ */
+static void
+lazy_cleanup_index(Relation indrel,
+				   IndexBulkDeleteResult **stats,
+				   double reltuples, bool estimated_count)
+{
+	IndexVacuumInfo ivinfo;
+	PGRUsage	ru0;
+
+	pg_rusage_init(&ru0);
+
+	ivinfo.index = indrel;
+	ivinfo.analyze_only = false;
+	ivinfo.report_progress = false;
+	ivinfo.estimated_count = estimated_count;
+	ivinfo.message_level = elevel;
+
+	/*
+	 * Now we can provide a better estimate of total number of surviving
+	 * tuples (we assume indexes are more interested in that than in the
+	 * number of nominally live tuples).
+	 */
+	ivinfo.num_heap_tuples = reltuples;
+	ivinfo.strategy = vac_strategy;
+
+	*stats = index_vacuum_cleanup(&ivinfo, *stats);
+
+	if (!*stats)
+		return;
+
+	ereport(elevel,
+			(errmsg("index \"%s\" now contains %.0f row versions in %u pages",
+					RelationGetRelationName(indrel),
+					(*stats)->num_index_tuples,
+					(*stats)->num_pages),
+			 errdetail("%.0f index row versions were removed.\n"
+					   "%u index pages have been deleted, %u are currently reusable.\n"
+					   "%s.",
+					   (*stats)->tuples_removed,
+					   (*stats)->pages_deleted, (*stats)->pages_free,
+					   pg_rusage_show(&ru0))));
+}
+
+/*
+ *	update_index_statistics() -- update index statistics in pg_class.
+ *
+ *		This is done for all indexes once the cleanup pass is over, rather
+ *		than as each index is cleaned up, because pg_class can't be updated
+ *		in parallel mode.  Frees the statistics.
+ */
+static void
+update_index_statistics(Relation *Irel, IndexBulkDeleteResult **indstats,
+						int nindexes)
+{
+	int			i;
+
+	for (i = 0; i < nindexes; i++)
+	{
+		if (indstats[i] == NULL)
+			continue;
+
+		/*
+		 * Now update statistics in pg_class, but only if the index says the
+		 * count is accurate.
+		 */
+		if (!indstats[i]->estimated_count)
+			vac_update_relstats(Irel[i],
+								indstats[i]->num_pages,
+								indstats[i]->num_index_tuples,
+								0,
+								false,
+								InvalidTransactionId,
+								InvalidMultiXactId,
+								false);
+
+		pfree(indstats[i]);
+		indstats[i] = NULL;
+	}
+}
+
+/*
+ *	compute_parallel_vacuum_workers() -- plan parallel index vacuuming.
+ *
+ *		Returns the most parallel workers any index pass may use, which is 0
+ *		if parallel vacuum is out of the question.  nrequested is the PARALLEL
+ *		option's value, or 0 to decide by the number of indexes alone.  The
+ *		indexes that may be given to a worker at all are marked in
+ *		can_parallel_vacuum; each pass then checks the AM's flags for the
+ *		phase at hand.
+ */
+static int
+compute_parallel_vacuum_workers(Relation *Irel, int nindexes, int nrequested,
+								bool *can_parallel_vacuum)
+{
+	int			nindexes_parallel = 0;
+	int			parallel_workers;
+	int			i;
+
+	/*
+	 * We don't allow parallel vacuum in standalone mode, and
+	 * max_parallel_maintenance_workers = 0 turns it off.
+	 */
+	if (!IsUnderPostmaster || max_parallel_maintenance_workers == 0)
+		return 0;
 
-				/*
-				 * Each non-removable tuple must be checked to see if it needs
-				 * freezing.  Note we already have exclusive buffer lock.
-				 */
-				if (heap_prepare_freeze_tuple(tuple.t_data,
-											  relfrozenxid, relminmxid,
-											  FreezeLimit, MultiXactCutoff,
-											  &frozen[nfrozen],
-											  &tuple_totally_frozen))
-					frozen[nfrozen++].offset = offnum;
-
-				if (!tuple_totally_frozen)
-					all_frozen = false;
-			}
-		}						/* scan along page */
+	/*
+	 * Small indexes are not worth a worker; the leader does them, as well
+	 * as the indexes of AMs that can't be vacuumed in parallel at all.
+	 */
+	for (i = 0; i < nindexes; i++)
+	{
+		Relation	indrel = Irel[i];
 
-		/*
-		 * If we froze any tuples, mark the buffer dirty, and write a WAL
-		 * record recording the changes.  We must log the changes to be
-		 * crash-safe against future truncation of CLOG.
-		 */
-		if (nfrozen > 0)
-		{
-			START_CRIT_SECTION();
+		if (indrel->rd_indam->amparallelvacuumoptions ==
+			VACUUM_OPTION_NO_PARALLEL ||
+			RelationGetNumberOfBlocks(indrel) < min_parallel_index_scan_size)
+			continue;
 
-			MarkBufferDirty(buf);
+		can_parallel_vacuum[i] = true;
+		nindexes_parallel++;
+	}
 
-			/* execute collected freezes */
-			for (i = 0; i < nfrozen; i++)
-			{
-				ItemId		itemid;
-				HeapTupleHeader htup;
+	/* The leader vacuums one of them itself */
+	nindexes_parallel--;
+	if (nindexes_parallel <= 0)
+		return 0;
 
-				itemid = PageGetItemId(page, frozen[i].offset);
-				htup = (HeapTupleHeader) PageGetItem(page, itemid);
+	parallel_workers = (nrequested > 0) ?
+		Min(nrequested, nindexes_parallel) : nindexes_parallel;
 
-				heap_execute_freeze_tuple(htup, &frozen[i]);
-			}
+	return Min(parallel_workers, max_parallel_maintenance_workers);
+}
 
-			/* Now WAL-log freezing if necessary */
-			if (RelationNeedsWAL(onerel))
-			{
-				XLogRecPtr	recptr;
+/*
+ *	compute_parallel_heap_workers() -- plan a parallel heap scan.
+ *
+ *		Returns the number of workers to scan the heap with besides the
+ *		leader, which is 0 if the scan is to be serial.  nrequested is the
+ *		PARALLEL option's value, or 0 to decide by the size of the table, as
+ *		for a parallel sequential scan.  Tables smaller than
+ *		min_parallel_table_scan_size are always scanned serially.
+ */
+static int
+compute_parallel_heap_workers(Relation onerel, BlockNumber nblocks,
+							  int nrequested)
+{
+	int			parallel_workers;
 
-				recptr = log_heap_freeze(onerel, buf, FreezeLimit,
-										 frozen, nfrozen);
-				PageSetLSN(page, recptr);
-			}
+	if (!IsUnderPostmaster || max_parallel_maintenance_workers == 0)
+		return 0;
 
-			END_CRIT_SECTION();
-		}
+	if (nblocks == 0 || nblocks < (BlockNumber) min_parallel_table_scan_size)
+		return 0;
 
-		/*
-		 * If there are no indexes we can vacuum the page right now instead of
-		 * doing a second scan. Also we don't do that but forget dead tuples
-		 * when index cleanup is disabled.
-		 */
-		if (!vacrelstats->useindex && vacrelstats->num_dead_tuples > 0)
+	if (nrequested > 0)
+		parallel_workers = nrequested;
+	else
+	{
+		parallel_workers = RelationGetParallelWorkers(onerel, -1);
+		if (parallel_workers < 0)
 		{
-			if (nindexes == 0)
-			{
-				/* Remove tuples from heap if the table has no index */
-				lazy_vacuum_page(onerel, blkno, buf, 0, vacrelstats, &vmbuffer);
-				vacuumed_pages++;
-				has_dead_tuples = false;
-			}
-			else
-			{
-				/*
-				 * Here, we have indexes but index cleanup is disabled.
-				 * Instead of vacuuming the dead tuples on the heap, we just
-				 * forget them.
-				 *
-				 * Note that vacrelstats->dead_tuples could have tuples which
-				 * became dead after HOT-pruning but are not marked dead yet.
-				 * We do not process them because it's a very rare condition,
-				 * and the next vacuum will process them anyway.
-				 */
-				Assert(params->index_cleanup == VACOPT_TERNARY_DISABLED);
-			}
+			int			heap_parallel_threshold;
 
-			/*
-			 * Forget the now-vacuumed tuples, and press on, but be careful
-			 * not to reset latestRemovedXid since we want that value to be
-			 * valid.
-			 */
-			vacrelstats->num_dead_tuples = 0;
-
-			/*
-			 * Periodically do incremental FSM vacuuming to make newly-freed
-			 * space visible on upper FSM pages.  Note: although we've cleaned
-			 * the current block, we haven't yet updated its FSM entry (that
-			 * happens further down), so passing end == blkno is correct.
-			 */
-			if (blkno - next_fsm_block_to_vacuum >= VACUUM_FSM_EVERY_PAGES)
+			/* One more worker for every threefold increase in size */
+			heap_parallel_threshold = Max(min_parallel_table_scan_size, 1);
+			parallel_workers = 1;
+			while (nblocks >= (BlockNumber) heap_parallel_threshold * 3)
 			{
-				FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum,
-										blkno);
-				next_fsm_block_to_vacuum = blkno;
+				parallel_workers++;
+				heap_parallel_threshold *= 3;
+				if (heap_parallel_threshold > INT_MAX / 3)
+					break;		/* avoid overflow */
 			}
 		}
+	}
 
-		freespace = PageGetHeapFreeSpace(page);
+	return Min(parallel_workers, max_parallel_maintenance_workers);
+}
 
-		/* mark page all-visible, if appropriate */
-		if (all_visible && !all_visible_according_to_vm)
-		{
-			uint8		flags = VISIBILITYMAP_ALL_VISIBLE;
+/*
+ *	index_can_parallel_vacuum() -- may a parallel worker do this phase?
+ *
+ *		first_time is true if no bulk-deletion pass preceded the cleanup.
+ */
+static bool
+index_can_parallel_vacuum(Relation indrel, bool for_cleanup, bool first_time)
+{
+	uint8		vacoptions = indrel->rd_indam->amparallelvacuumoptions;
 
-			if (all_frozen)
-				flags |= VISIBILITYMAP_ALL_FROZEN;
+	if (!for_cleanup)
+		return (vacoptions & VACUUM_OPTION_PARALLEL_BULKDEL) != 0;
 
-			/*
-			 * It should never be the case that the visibility map page is set
-			 * while the page-level bit is clear, but the reverse is allowed
-			 * (if checksums are not enabled).  Regardless, set the both bits
-			 * so that we get back in sync.
-			 *
-			 * NB: If the heap page is all-visible but the VM bit is not set,
-			 * we don't need to dirty the heap page.  However, if checksums
-			 * are enabled, we do need to make sure that the heap page is
-			 * dirtied before passing it to visibilitymap_set(), because it
-			 * may be logged.  Given that this situation should only happen in
-			 * rare cases after a crash, it is not worth optimizing.
-			 */
-			PageSetAllVisible(page);
-			MarkBufferDirty(buf);
-			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, visibility_cutoff_xid, flags);
-		}
+	if (vacoptions & VACUUM_OPTION_PARALLEL_CLEANUP)
+		return true;
 
-		/*
-		 * As of PostgreSQL 9.2, the visibility map bit should never be set if
-		 * the page-level bit is clear.  However, it's possible that the bit
-		 * got cleared after we checked it and before we took the buffer
-		 * content lock, so we must recheck before jumping to the conclusion
-		 * that something bad has happened.
-		 */
-		else if (all_visible_according_to_vm && !PageIsAllVisible(page)
-				 && VM_ALL_VISIBLE(onerel, blkno, &vmbuffer))
-		{
-			elog(WARNING, "page is not marked all-visible but visibility map bit is set in relation \"%s\" page %u",
-				 relname, blkno);
-			visibilitymap_clear(onerel, blkno, vmbuffer,
-								VISIBILITYMAP_VALID_BITS);
-		}
+	/*
+	 * An AM that only does real work in amvacuumcleanup when ambulkdelete
+	 * wasn't called gains nothing from a worker after a bulk-deletion pass.
+	 */
+	return first_time && (vacoptions & VACUUM_OPTION_PARALLEL_COND_CLEANUP) != 0;
+}
 
-		/*
-		 * It's possible for the value returned by GetOldestXmin() to move
-		 * backwards, so it's not wrong for us to see tuples that appear to
-		 * not be visible to everyone yet, while PD_ALL_VISIBLE is already
-		 * set. The real safe xmin value never moves backwards, but
-		 * GetOldestXmin() is conservative and sometimes returns a value
-		 * that's unnecessarily small, so if we see that contradiction it just
-		 * means that the tuples that we think are not visible to everyone yet
-		 * actually are, and the PD_ALL_VISIBLE flag is correct.
-		 *
-		 * There should never be dead tuples on a page with PD_ALL_VISIBLE
-		 * set, however.
-		 */
-		else if (PageIsAllVisible(page) && has_dead_tuples)
-		{
-			elog(WARNING, "page containing dead tuples is marked as all-visible in relation \"%s\" page %u",
-				 relname, blkno);
-			PageClearAllVisible(page);
-			MarkBufferDirty(buf);
-			visibilitymap_clear(onerel, blkno, vmbuffer,
-								VISIBILITYMAP_VALID_BITS);
-		}
+/*
+ *	begin_parallel_heap_scan() -- set up a parallel heap scan.
+ *
+ *		Creates the parallel context for the rest of the vacuum, with room for
+ *		the dead tuples found by the heap scan and enough workers for the
+ *		index passes, too, and hands the workers our vacuum settings.
+ *		Returns NULL if no DSM segment is to be had.
+ */
+static LVParallelState *
+begin_parallel_heap_scan(Relation onerel, VacuumParams *params,
+						 LVRelStats *vacrelstats, Relation *Irel,
+						 int nindexes, bool aggressive, int nworkers_heap)
+{
+	BlockNumber nblocks = vacrelstats->rel_pages;
+	LVParallelState *lps;
+	LVParallelScan *lvscan;
+	int64		maxpages = 0;
+	int64		maxtuples = 0;
 
-		/*
-		 * If the all-visible page is turned out to be all-frozen but not
-		 * marked, we should so mark it.  Note that all_frozen is only valid
-		 * if all_visible is true, so we must check both.
-		 */
-		else if (all_visible_according_to_vm && all_visible && all_frozen &&
-				 !VM_ALL_FROZEN(onerel, blkno, &vmbuffer))
-		{
-			/*
-			 * We can pass InvalidTransactionId as the cutoff XID here,
-			 * because setting the all-frozen bit doesn't cause recovery
-			 * conflicts.
-			 */
-			visibilitymap_set(onerel, blkno, buf, InvalidXLogRecPtr,
-							  vmbuffer, InvalidTransactionId,
-							  VISIBILITYMAP_ALL_FROZEN);
-		}
+	/*
+	 * Size the dead tuple arrays from the vacuum memory budget, a quarter of
+	 * it for the pages, but no bigger than the table could need.  As for an
+	 * index pass, they must be small enough for InitializeParallelDSM's
+	 * fallback to backend-local memory.  On top of that, each participant
+	 * may hold a page's worth of room reserved while the arrays fill up, so
+	 * that they are only found full once the budget has been used.
+	 */
+	if (vacrelstats->useindex)
+	{
+		Size		max_size = Min(vacrelstats->max_dead_tuples_mem,
+								   MaxAllocSize / 2);
+		int			nparticipants = nworkers_heap + 1;
+
+		maxpages = max_size / 4 / sizeof(LVDeadTuplePage);
+		maxtuples = (max_size - maxpages * sizeof(LVDeadTuplePage)) /
+			sizeof(OffsetNumber);
+		maxpages = Max(Min(maxpages, (int64) nblocks), 1);
+		maxtuples = Max(Min(maxtuples, (int64) nblocks * MaxHeapTuplesPerPage),
+						MaxHeapTuplesPerPage);
+		maxpages += nparticipants;
+		maxtuples += (int64) nparticipants * MaxHeapTuplesPerPage;
+	}
 
-		UnlockReleaseBuffer(buf);
+	lps = begin_parallel_vacuum(RelationGetRelid(onerel), Irel, nindexes,
+								Max(nworkers_heap,
+									vacrelstats->parallel_workers),
+								maxpages, maxtuples, true);
+	if (lps == NULL)
+		return NULL;
+	lps->nworkers_heap = nworkers_heap;
+
+	lvscan = lps->lvscan;
+	lvscan->params = *params;
+	lvscan->aggressive = aggressive;
+	lvscan->useindex = vacrelstats->useindex;
+	lvscan->OldestXmin = OldestXmin;
+	lvscan->FreezeLimit = FreezeLimit;
+	lvscan->MultiXactCutoff = MultiXactCutoff;
+	SpinLockInit(&lvscan->mutex);
 
-		/* Remember the location of the last page with nonremovable tuples */
-		if (hastup)
-			vacrelstats->nonempty_pages = blkno + 1;
+	/*
+	 * Hand out the pages from the first to the last, like the serial scan,
+	 * rather than joining a synchronized scan: lazy_parallel_scan_heap
+	 * relies on the pages handed out so far being at the start of the table.
+	 * Pages added since we looked at the table's size are left alone, as
+	 * the serial scan does.
+	 */
+	table_block_parallelscan_initialize(onerel,
+										(ParallelTableScanDesc) &lvscan->pscan);
+	lvscan->pscan.base.phs_syncscan = false;
+	lvscan->pscan.phs_nblocks = nblocks;
 
-		/*
-		 * If we remembered any tuples for deletion, then the page will be
-		 * visited again by lazy_vacuum_heap, which will compute and record
-		 * its post-compaction free space.  If not, then we're done with this
-		 * page, so remember its free space as-is.  (This path will always be
-		 * taken if there are no indexes.)
-		 */
-		if (vacrelstats->num_dead_tuples == prev_dead_count)
-			RecordPageWithFreeSpace(onerel, blkno, freespace);
+	return lps;
+}
+
+/*
+ *	lazy_parallel_vacuum_indexes() -- vacuum or clean up indexes in parallel.
+ *
+ *		Vacuums or cleans up the indexes together with the launched workers,
+ *		and collects their results into indstats.  Unless the heap was
+ *		scanned in parallel, which leaves a parallel context holding the dead
+ *		tuples for the index passes to use, a context is set up for this pass
+ *		alone.  If the dead tuples don't all fit in its shared arrays, the
+ *		parallel indexes are vacuumed once per batch, relaunching the workers
+ *		each time.  Returns false without having done anything if this pass
+ *		can't use parallel workers after all, in which case the caller
+ *		processes the indexes serially.
+ */
+static bool
+lazy_parallel_vacuum_indexes(Relation *Irel, IndexBulkDeleteResult **indstats,
+							 LVRelStats *vacrelstats, int nindexes,
+							 bool for_cleanup)
+{
+	bool		first_time = (vacrelstats->num_index_scans == 0);
+	LVParallelState *lps = vacrelstats->lps;
+	LVShared   *lvshared;
+	LVDeadTuples *dead_tuples;
+	uint64		next = 0;
+	bool		more = false;
+	int			nrounds = 0;
+	int			nindexes_parallel = 0;
+	int			nworkers;
+	int			vac_work_mem;
+	int			i;
+
+	/* Count the indexes the workers can take in this pass */
+	for (i = 0; i < nindexes; i++)
+	{
+		if (vacrelstats->can_parallel_vacuum[i] &&
+			index_can_parallel_vacuum(Irel[i], for_cleanup, first_time))
+			nindexes_parallel++;
 	}
 
-	/* report that everything is scanned and vacuumed */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_SCANNED, blkno);
+	/* The leader takes one of them, so there must be at least two */
+	nworkers = Min(vacrelstats->parallel_workers, nindexes_parallel - 1);
+	if (nworkers <= 0)
+		return false;
 
-	pfree(frozen);
+	if (lps == NULL)
+	{
+		int64		maxpages = 0;
+		int64		maxtuples = 0;
 
-	/* save stats for use later */
-	vacrelstats->tuples_deleted = tups_vacuumed;
-	vacrelstats->new_dead_tuples = nkeep;
+		/*
+		 * Size the dead tuple arrays.  The flattened arrays are kept within
+		 * the vacuum memory budget, and small enough for
+		 * InitializeParallelDSM's fallback to backend-local memory.  If the
+		 * dead tuples need more, they are handed over in several rounds,
+		 * each with room for the same share of the pages and of the offsets.
+		 * MaxHeapTuplesPerPage offsets of slack let every round end on a
+		 * page boundary, see lazy_copy_dead_tuples.
+		 */
+		if (!for_cleanup)
+		{
+			Size		max_size;
+			Size		est_dead_tuples;
 
-	/* now we can compute the new value for pg_class.reltuples */
-	vacrelstats->new_live_tuples = vac_estimate_reltuples(onerel,
-														  nblocks,
-														  vacrelstats->tupcount_pages,
-														  live_tuples);
+			Assert(vacrelstats->num_dead_tuples > 0);
 
-	/* also compute total number of surviving heap entries */
-	vacrelstats->new_rel_tuples =
-		vacrelstats->new_live_tuples + vacrelstats->new_dead_tuples;
+			maxpages = vacrelstats->num_dead_pages;
+			maxtuples = vacrelstats->num_dead_tuples;
+			max_size = Min(vacrelstats->max_dead_tuples_mem, MaxAllocSize / 2);
+			est_dead_tuples = SizeOfLVDeadTuples(maxpages, maxtuples);
+			if (est_dead_tuples > max_size)
+			{
+				double		frac = (double) max_size / est_dead_tuples;
 
-	/*
-	 * Release any remaining pin on visibility map page.
-	 */
-	if (BufferIsValid(vmbuffer))
-	{
-		ReleaseBuffer(vmbuffer);
-		vmbuffer = InvalidBuffer;
+				maxpages = Max((int64) (maxpages * frac), 1);
+				maxtuples = (int64) (maxtuples * frac);
+			}
+			maxtuples += MaxHeapTuplesPerPage;
+		}
+
+		lps = begin_parallel_vacuum(Irel[0]->rd_index->indrelid, Irel,
+									nindexes, nworkers, maxpages, maxtuples,
+									false);
+		if (lps == NULL)
+			return false;
 	}
+	lvshared = lps->lvshared;
+	dead_tuples = lps->dead_tuples;
 
-	/* If any tuples need to be deleted, perform final vacuum cycle */
-	/* XXX put a threshold on min number of tuples here? */
-	if (vacrelstats->num_dead_tuples > 0)
+	/* Describe this pass to the workers */
+	lvshared->scan_heap = false;
+	lvshared->for_cleanup = for_cleanup;
+	if (for_cleanup)
 	{
-		const int	hvp_index[] = {
-			PROGRESS_VACUUM_PHASE,
-			PROGRESS_VACUUM_NUM_INDEX_VACUUMS
-		};
-		int64		hvp_val[2];
-
-		/* Log cleanup info before we touch indexes */
-		vacuum_log_cleanup_info(onerel, vacrelstats);
+		lvshared->reltuples = vacrelstats->new_rel_tuples;
+		lvshared->estimated_count =
+			(vacrelstats->tupcount_pages < vacrelstats->rel_pages);
+	}
+	else
+	{
+		lvshared->reltuples = vacrelstats->old_live_tuples;
+		lvshared->estimated_count = true;
+	}
 
-		/* Report that we are now vacuuming indexes */
-		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-									 PROGRESS_VACUUM_PHASE_VACUUM_INDEX);
+	/* The workers divide our memory budget among themselves */
+	vac_work_mem = IsAutoVacuumWorkerProcess() &&
+		autovacuum_work_mem != -1 ?
+		autovacuum_work_mem : maintenance_work_mem;
+	lvshared->maintenance_work_mem_worker = Max(vac_work_mem / nworkers, 1024);
 
-		/* Remove index entries */
-		for (i = 0; i < nindexes; i++)
-			lazy_vacuum_index(Irel[i],
-							  &indstats[i],
-							  vacrelstats);
+	for (i = 0; i < nindexes; i++)
+	{
+		LVSharedIndStats *slot = &lvshared->indstats[i];
 
-		/* Report that we are now vacuuming the heap */
-		hvp_val[0] = PROGRESS_VACUUM_PHASE_VACUUM_HEAP;
-		hvp_val[1] = vacrelstats->num_index_scans + 1;
-		pgstat_progress_update_multi_param(2, hvp_index, hvp_val);
+		slot->parallel = vacrelstats->can_parallel_vacuum[i] &&
+			index_can_parallel_vacuum(Irel[i], for_cleanup, first_time);
+		slot->updated = false;
 
-		/* Remove tuples from heap */
-		pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-									 PROGRESS_VACUUM_PHASE_VACUUM_HEAP);
-		lazy_vacuum_heap(onerel, vacrelstats);
-		vacrelstats->num_index_scans++;
+		/* Hand over the results of earlier passes over the index */
+		if (slot->parallel && indstats[i] != NULL)
+		{
+			memcpy(&slot->stats, indstats[i], sizeof(IndexBulkDeleteResult));
+			slot->updated = true;
+			pfree(indstats[i]);
+			indstats[i] = NULL;
+		}
 	}
 
 	/*
-	 * Vacuum the remainder of the Free Space Map.  We must do this whether or
-	 * not there were indexes.
+	 * A parallel heap scan has left all the dead tuples in the shared arrays
+	 * already.  Otherwise they are copied there from the IntegerSet a round
+	 * at a time below.
 	 */
-	if (blkno > next_fsm_block_to_vacuum)
-		FreeSpaceMapVacuumRange(onerel, next_fsm_block_to_vacuum, blkno);
-
-	/* report all blocks vacuumed; and that we're cleaning up */
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
-	pgstat_progress_update_param(PROGRESS_VACUUM_PHASE,
-								 PROGRESS_VACUUM_PHASE_INDEX_CLEANUP);
-
-	/* Do post-vacuum cleanup and statistics update for each index */
-	if (vacrelstats->useindex)
+	if (!for_cleanup && vacrelstats->lps == NULL)
 	{
-		for (i = 0; i < nindexes; i++)
-			lazy_cleanup_index(Irel[i], indstats[i], vacrelstats);
+		intset_begin_iterate(vacrelstats->dead_tuples);
+		more = intset_iterate_next(vacrelstats->dead_tuples, &next);
+		Assert(more);
 	}
 
-	/* If no indexes, make log report that lazy_vacuum_heap would've made */
-	if (vacuumed_pages)
-		ereport(elevel,
-				(errmsg("\"%s\": removed %.0f row versions in %u pages",
-						RelationGetRelationName(onerel),
-						tups_vacuumed, vacuumed_pages)));
-
 	/*
-	 * This is pretty messy, but we split it up so that we can skip emitting
-	 * individual parts of the message when not applicable.
+	 * Each round hands the workers the next batch of dead tuples; a cleanup
+	 * pass, or a bulk-deletion pass whose dead tuples all fit, takes just one.
 	 */
-	initStringInfo(&buf);
-	appendStringInfo(&buf,
-					 _("%.0f dead row versions cannot be removed yet, oldest xmin: %u\n"),
-					 nkeep, OldestXmin);
-	appendStringInfo(&buf, _("There were %.0f unused item identifiers.\n"),
-					 nunused);
-	appendStringInfo(&buf, ngettext("Skipped %u page due to buffer pins, ",
-									"Skipped %u pages due to buffer pins, ",
-									vacrelstats->pinskipped_pages),
-					 vacrelstats->pinskipped_pages);
-	appendStringInfo(&buf, ngettext("%u frozen page.\n",
-									"%u frozen pages.\n",
-									vacrelstats->frozenskipped_pages),
-					 vacrelstats->frozenskipped_pages);
-	appendStringInfo(&buf, ngettext("%u page is entirely empty.\n",
-									"%u pages are entirely empty.\n",
-									empty_pages),
-					 empty_pages);
-	appendStringInfo(&buf, _("%s."), pg_rusage_show(&ru0));
-
-	ereport(elevel,
-			(errmsg("\"%s\": found %.0f removable, %.0f nonremovable row versions in %u out of %u pages",
-					RelationGetRelationName(onerel),
-					tups_vacuumed, num_tuples,
-					vacrelstats->scanned_pages, nblocks),
-			 errdetail_internal("%s", buf.data)));
-	pfree(buf.data);
-}
+	do
+	{
+		if (!for_cleanup)
+		{
+			if (vacrelstats->lps == NULL)
+				more = lazy_copy_dead_tuples(vacrelstats, dead_tuples, &next);
+			lvshared->num_dead_tuples = dead_tuples->ntuples;
+		}
 
+		pg_atomic_write_u32(&lvshared->idx, 0);
+		launch_parallel_vacuum_workers(lps, nworkers);
 
-/*
- *	lazy_vacuum_heap() -- second pass over the heap
- *
- *		This routine marks dead tuples as unused and compacts out free
- *		space on their pages.  Pages not having dead tuples recorded from
- *		lazy_scan_heap are not visited at all.
- *
- * Note: the reason for doing this as a second pass is we cannot remove
- * the tuples until we've removed their index entries, and we want to
- * process index entry removal in batches as large as possible.
- */
-static void
-lazy_vacuum_heap(Relation onerel, LVRelStats *vacrelstats)
-{
-	int			tupindex;
-	int			npages;
-	PGRUsage	ru0;
-	Buffer		vmbuffer = InvalidBuffer;
+		if (for_cleanup)
+			ereport(elevel,
+					(errmsg(ngettext("launched %d parallel vacuum worker for index cleanup (planned: %d)",
+									 "launched %d parallel vacuum workers for index cleanup (planned: %d)",
+									 lps->pcxt->nworkers_launched),
+							lps->pcxt->nworkers_launched, nworkers)));
+		else
+			ereport(elevel,
+					(errmsg(ngettext("launched %d parallel vacuum worker for index vacuuming (planned: %d)",
+									 "launched %d parallel vacuum workers for index vacuuming (planned: %d)",
+									 lps->pcxt->nworkers_launched),
+							lps->pcxt->nworkers_launched, nworkers)));
 
-	pg_rusage_init(&ru0);
-	npages = 0;
+		/*
+		 * Do the indexes the workers can't take while they are starting up,
+		 * then join them in working through the rest.  The leader checks the
+		 * whole dead tuple set, so its own indexes need only the first round.
+		 */
+		if (VacuumActiveNWorkers)
+			pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
+		if (nrounds == 0)
+		{
+			for (i = 0; i < nindexes; i++)
+			{
+				if (lvshared->indstats[i].parallel)
+					continue;
 
-	tupindex = 0;
-	while (tupindex < vacrelstats->num_dead_tuples)
-	{
-		BlockNumber tblk;
-		Buffer		buf;
-		Page		page;
-		Size		freespace;
+				if (for_cleanup)
+					lazy_cleanup_index(Irel[i], &indstats[i],
+									   lvshared->reltuples,
+									   lvshared->estimated_count);
+				else
+					lazy_vacuum_index(Irel[i], &indstats[i],
+									  lazy_tid_reaped, (void *) vacrelstats,
+									  lvshared->reltuples,
+									  vacrelstats->num_dead_tuples);
+			}
+		}
+		if (VacuumActiveNWorkers)
+			pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
 
-		vacuum_delay_point();
+		parallel_vacuum_indexes(Irel, nindexes, lvshared, dead_tuples);
 
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		buf = ReadBufferExtended(onerel, MAIN_FORKNUM, tblk, RBM_NORMAL,
-								 vac_strategy);
-		if (!ConditionalLockBufferForCleanup(buf))
-		{
-			ReleaseBuffer(buf);
-			++tupindex;
-			continue;
-		}
-		tupindex = lazy_vacuum_page(onerel, tblk, buf, tupindex, vacrelstats,
-									&vmbuffer);
+		wait_parallel_vacuum_workers(lps);
 
-		/* Now that we've compacted the page, record its available space */
-		page = BufferGetPage(buf);
-		freespace = PageGetHeapFreeSpace(page);
+		nrounds++;
+	} while (more);
 
-		UnlockReleaseBuffer(buf);
-		RecordPageWithFreeSpace(onerel, tblk, freespace);
-		npages++;
-	}
+	if (nrounds > 1)
+		ereport(elevel,
+				(errmsg("index vacuuming was split into %d rounds to fit the dead tuples in memory",
+						nrounds)));
 
-	if (BufferIsValid(vmbuffer))
+	/* Copy the results out of DSM before it goes away */
+	for (i = 0; i < nindexes; i++)
 	{
-		ReleaseBuffer(vmbuffer);
-		vmbuffer = InvalidBuffer;
+		LVSharedIndStats *slot = &lvshared->indstats[i];
+
+		if (!slot->parallel || !slot->updated)
+			continue;
+
+		Assert(indstats[i] == NULL);
+		indstats[i] = (IndexBulkDeleteResult *)
+			palloc(sizeof(IndexBulkDeleteResult));
+		memcpy(indstats[i], &slot->stats, sizeof(IndexBulkDeleteResult));
 	}
 
-	ereport(elevel,
-			(errmsg("\"%s\": removed %d row versions in %d pages",
-					RelationGetRelationName(onerel),
-					tupindex, npages),
-			 errdetail_internal("%s", pg_rusage_show(&ru0))));
-}
+	if (lps != vacrelstats->lps)
+		end_parallel_vacuum(lps);
 
-/*
- *	lazy_vacuum_page() -- free dead tuples on a page
- *					 and repair its fragmentation.
- *
- * Caller must hold pin and buffer cleanup lock on the buffer.
+	return true;
+}
+
+/*
+ *	begin_parallel_vacuum() -- create the parallel context for a parallel
+ *		vacuum and enter parallel mode.
  *
- * tupindex is the index in vacrelstats->dead_tuples of the first dead
- * tuple for this page.  We assume the rest follow sequentially.
- * The return value is the first tupindex after the tuples of this page.
+ *		The DSM segment holds the shared state of the index passes, room for
+ *		maxpages pages' and maxtuples dead tuples if maxtuples > 0, and, if
+ *		scan_heap is true, the shared state of a parallel heap scan.  Returns
+ *		NULL, having left parallel mode again, if no DSM segment is to be had.
  */
-static int
-lazy_vacuum_page(Relation onerel, BlockNumber blkno, Buffer buffer,
-				 int tupindex, LVRelStats *vacrelstats, Buffer *vmbuffer)
+static LVParallelState *
+begin_parallel_vacuum(Oid relid, Relation *Irel, int nindexes, int nworkers,
+					  int64 maxpages, int64 maxtuples, bool scan_heap)
 {
-	Page		page = BufferGetPage(buffer);
-	OffsetNumber unused[MaxOffsetNumber];
-	int			uncnt = 0;
-	TransactionId visibility_cutoff_xid;
-	bool		all_frozen;
+	LVParallelState *lps;
+	ParallelContext *pcxt;
+	LVShared   *lvshared;
+	Size		est_shared;
+	Size		est_dead_tuples = 0;
+	Size		est_heap_scan = 0;
+	int			querylen;
+	int			i;
 
-	pgstat_progress_update_param(PROGRESS_VACUUM_HEAP_BLKS_VACUUMED, blkno);
+	EnterParallelMode();
+	pcxt = CreateParallelContext("postgres", "parallel_vacuum_main",
+								 nworkers);
 
-	START_CRIT_SECTION();
+	/* Estimate size for shared information -- PARALLEL_VACUUM_KEY_SHARED */
+	est_shared = add_size(offsetof(LVShared, indstats),
+						  mul_size(sizeof(LVSharedIndStats), nindexes));
+	shm_toc_estimate_chunk(&pcxt->estimator, est_shared);
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
-	for (; tupindex < vacrelstats->num_dead_tuples; tupindex++)
+	/* Estimate size for dead tuples -- PARALLEL_VACUUM_KEY_DEAD_TUPLES */
+	if (maxtuples > 0)
 	{
-		BlockNumber tblk;
-		OffsetNumber toff;
-		ItemId		itemid;
-
-		tblk = ItemPointerGetBlockNumber(&vacrelstats->dead_tuples[tupindex]);
-		if (tblk != blkno)
-			break;				/* past end of tuples for this block */
-		toff = ItemPointerGetOffsetNumber(&vacrelstats->dead_tuples[tupindex]);
-		itemid = PageGetItemId(page, toff);
-		ItemIdSetUnused(itemid);
-		unused[uncnt++] = toff;
+		est_dead_tuples = SizeOfLVDeadTuples(maxpages, maxtuples);
+		shm_toc_estimate_chunk(&pcxt->estimator, est_dead_tuples);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
 	}
 
-	PageRepairFragmentation(page);
+	/* Estimate size for the heap scan -- PARALLEL_VACUUM_KEY_HEAP_SCAN */
+	if (scan_heap)
+	{
+		est_heap_scan = add_size(offsetof(LVParallelScan, worker_stats),
+								 mul_size(sizeof(LVRelStats), nworkers));
+		shm_toc_estimate_chunk(&pcxt->estimator, est_heap_scan);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
+	}
 
-	/*
-	 * Mark buffer dirty before we write WAL.
-	 */
-	MarkBufferDirty(buffer);
+	/* Estimate space for BufferUsage -- PARALLEL_VACUUM_KEY_BUFFER_USAGE */
+	shm_toc_estimate_chunk(&pcxt->estimator,
+						   mul_size(sizeof(BufferUsage), pcxt->nworkers));
+	shm_toc_estimate_keys(&pcxt->estimator, 1);
 
-	/* XLOG stuff */
-	if (RelationNeedsWAL(onerel))
+	/* Finally, estimate PARALLEL_VACUUM_KEY_QUERY_TEXT space */
+	if (debug_query_string)
 	{
-		XLogRecPtr	recptr;
-
-		recptr = log_heap_clean(onerel, buffer,
-								NULL, 0, NULL, 0,
-								unused, uncnt,
-								vacrelstats->latestRemovedXid);
-		PageSetLSN(page, recptr);
+		querylen = strlen(debug_query_string);
+		shm_toc_estimate_chunk(&pcxt->estimator, querylen + 1);
+		shm_toc_estimate_keys(&pcxt->estimator, 1);
 	}
+	else
+		querylen = 0;			/* keep compiler quiet */
 
-	/*
-	 * End critical section, so we safely can do visibility tests (which
-	 * possibly need to perform IO and allocate memory!). If we crash now the
-	 * page (including the corresponding vm bit) might not be marked all
-	 * visible, but that's fine. A later vacuum will fix that.
-	 */
-	END_CRIT_SECTION();
+	/* Everyone's had a chance to ask for space, so now create the DSM */
+	InitializeParallelDSM(pcxt);
 
 	/*
-	 * Now that we have removed the dead tuples from the page, once again
-	 * check if the page has become all-visible.  The page is already marked
-	 * dirty, exclusively locked, and, if needed, a full page image has been
-	 * emitted in the log_heap_clean() above.
+	 * InitializeParallelDSM creates the segment with
+	 * DSM_CREATE_NULL_IF_MAXSEGMENTS.  If none was available, back out (do
+	 * serial vacuum).
 	 */
-	if (heap_page_is_all_visible(onerel, buffer, &visibility_cutoff_xid,
-								 &all_frozen))
-		PageSetAllVisible(page);
+	if (pcxt->seg == NULL)
+	{
+		DestroyParallelContext(pcxt);
+		ExitParallelMode();
+		return NULL;
+	}
 
-	/*
-	 * All the changes to the heap page have been done. If the all-visible
-	 * flag is now set, also set the VM all-visible bit (and, if possible, the
-	 * all-frozen bit) unless this has already been done previously.
-	 */
-	if (PageIsAllVisible(page))
+	lps = (LVParallelState *) palloc0(sizeof(LVParallelState));
+	lps->pcxt = pcxt;
+
+	/* Prepare shared information; each pass fills in its own part */
+	lvshared = (LVShared *) shm_toc_allocate(pcxt->toc, est_shared);
+	MemSet(lvshared, 0, est_shared);
+	lvshared->relid = relid;
+	lvshared->elevel = elevel;
+	lvshared->cost_delay = VacuumCostDelay;
+	lvshared->cost_limit = VacuumCostLimit;
+	pg_atomic_init_u32(&lvshared->cost_balance, 0);
+	pg_atomic_init_u32(&lvshared->active_nworkers, 0);
+	pg_atomic_init_u32(&lvshared->idx, 0);
+	lvshared->nindexes = nindexes;
+	for (i = 0; i < nindexes; i++)
+		lvshared->indstats[i].indexrelid = RelationGetRelid(Irel[i]);
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_SHARED, lvshared);
+	lps->lvshared = lvshared;
+
+	if (maxtuples > 0)
 	{
-		uint8		vm_status = visibilitymap_get_status(onerel, blkno, vmbuffer);
-		uint8		flags = 0;
+		LVDeadTuples *dead_tuples;
+
+		dead_tuples = (LVDeadTuples *) shm_toc_allocate(pcxt->toc,
+														est_dead_tuples);
+		dead_tuples->maxpages = maxpages;
+		dead_tuples->maxtuples = maxtuples;
+		dead_tuples->npages = 0;
+		dead_tuples->ntuples = 0;
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES,
+					   dead_tuples);
+		lps->dead_tuples = dead_tuples;
+	}
 
-		/* Set the VM all-frozen bit to flag, if needed */
-		if ((vm_status & VISIBILITYMAP_ALL_VISIBLE) == 0)
-			flags |= VISIBILITYMAP_ALL_VISIBLE;
-		if ((vm_status & VISIBILITYMAP_ALL_FROZEN) == 0 && all_frozen)
-			flags |= VISIBILITYMAP_ALL_FROZEN;
+	if (scan_heap)
+	{
+		LVParallelScan *lvscan;
 
-		Assert(BufferIsValid(*vmbuffer));
-		if (flags != 0)
-			visibilitymap_set(onerel, blkno, buffer, InvalidXLogRecPtr,
-							  *vmbuffer, visibility_cutoff_xid, flags);
+		lvscan = (LVParallelScan *) shm_toc_allocate(pcxt->toc,
+													 est_heap_scan);
+		MemSet(lvscan, 0, est_heap_scan);
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_HEAP_SCAN, lvscan);
+		lps->lvscan = lvscan;
+	}
+
+	/* Allocate space for each worker's BufferUsage; no need to initialize */
+	lps->buffer_usage = shm_toc_allocate(pcxt->toc,
+										 mul_size(sizeof(BufferUsage),
+												  pcxt->nworkers));
+	shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE,
+				   lps->buffer_usage);
+
+	/* Store query string for workers */
+	if (debug_query_string)
+	{
+		char	   *sharedquery;
+
+		sharedquery = (char *) shm_toc_allocate(pcxt->toc, querylen + 1);
+		memcpy(sharedquery, debug_query_string, querylen + 1);
+		shm_toc_insert(pcxt->toc, PARALLEL_VACUUM_KEY_QUERY_TEXT,
+					   sharedquery);
 	}
 
-	return tupindex;
+	return lps;
 }
 
 /*
- *	lazy_check_needs_freeze() -- scan page to see if any tuples
- *					 need to be cleaned to avoid wraparound
+ *	end_parallel_vacuum() -- destroy the parallel context and exit parallel
+ *		mode.
+ */
+static void
+end_parallel_vacuum(LVParallelState *lps)
+{
+	DestroyParallelContext(lps->pcxt);
+	ExitParallelMode();
+	pfree(lps);
+}
+
+/*
+ *	launch_parallel_vacuum_workers() -- start up to nworkers workers for a
+ *		pass or a round of one.
  *
- * Returns true if the page needs to be vacuumed using cleanup lock.
- * Also returns a flag indicating whether page contains any tuples at all.
+ *		If we got any, our cost balance moves into the shared one, and we
+ *		account against that until wait_parallel_vacuum_workers.
  */
-static bool
-lazy_check_needs_freeze(Buffer buf, bool *hastup)
+static void
+launch_parallel_vacuum_workers(LVParallelState *lps, int nworkers)
 {
-	Page		page = BufferGetPage(buf);
-	OffsetNumber offnum,
-				maxoff;
-	HeapTupleHeader tupleheader;
+	LVShared   *lvshared = lps->lvshared;
 
-	*hastup = false;
+	if (lps->launched)
+		ReinitializeParallelDSM(lps->pcxt);
+	ReinitializeParallelWorkers(lps->pcxt, nworkers);
+	LaunchParallelWorkers(lps->pcxt);
+	lps->launched = true;
 
-	/*
-	 * New and empty pages, obviously, don't contain tuples. We could make
-	 * sure that the page is registered in the FSM, but it doesn't seem worth
-	 * waiting for a cleanup lock just for that, especially because it's
-	 * likely that the pin holder will do so.
-	 */
-	if (PageIsNew(page) || PageIsEmpty(page))
-		return false;
+	if (lps->pcxt->nworkers_launched > 0)
+	{
+		pg_atomic_write_u32(&lvshared->cost_balance, VacuumCostBalance);
+		VacuumCostBalance = 0;
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = &lvshared->cost_balance;
+		VacuumActiveNWorkers = &lvshared->active_nworkers;
+	}
+}
 
-	maxoff = PageGetMaxOffsetNumber(page);
-	for (offnum = FirstOffsetNumber;
-		 offnum <= maxoff;
-		 offnum = OffsetNumberNext(offnum))
+/*
+ *	wait_parallel_vacuum_workers() -- wait for the workers to finish.
+ *
+ *		Collects their buffer usage, and carries what is left of the shared
+ *		cost balance back to our own.
+ */
+static void
+wait_parallel_vacuum_workers(LVParallelState *lps)
+{
+	int			i;
+
+	WaitForParallelWorkersToFinish(lps->pcxt);
+	for (i = 0; i < lps->pcxt->nworkers_launched; i++)
+		InstrAccumParallelQuery(&lps->buffer_usage[i]);
+
+	if (VacuumSharedCostBalance)
 	{
-		ItemId		itemid;
+		VacuumCostBalance = pg_atomic_read_u32(VacuumSharedCostBalance);
+		VacuumCostBalanceLocal = 0;
+		VacuumSharedCostBalance = NULL;
+		VacuumActiveNWorkers = NULL;
+	}
+}
 
-		itemid = PageGetItemId(page, offnum);
+/*
+ *	parallel_vacuum_indexes() -- process indexes from the shared list.
+ *
+ *		Claims indexes one at a time and vacuums or cleans them up until none
+ *		are left.  Run by the leader and the parallel workers alike; the
+ *		index's statistics live in its shared slot throughout.
+ */
+static void
+parallel_vacuum_indexes(Relation *Irel, int nindexes, LVShared *lvshared,
+						LVDeadTuples *dead_tuples)
+{
+	for (;;)
+	{
+		uint32		idx = pg_atomic_fetch_add_u32(&lvshared->idx, 1);
+		LVSharedIndStats *slot;
+		IndexBulkDeleteResult *stats;
 
-		/* this should match hastup test in count_nondeletable_pages() */
-		if (ItemIdIsUsed(itemid))
-			*hastup = true;
+		if (idx >= (uint32) nindexes)
+			break;
 
-		/* dead and redirect items never need freezing */
-		if (!ItemIdIsNormal(itemid))
+		slot = &lvshared->indstats[idx];
+		if (!slot->parallel)
 			continue;
 
-		tupleheader = (HeapTupleHeader) PageGetItem(page, itemid);
+		if (RelationGetRelid(Irel[idx]) != slot->indexrelid)
+			elog(ERROR, "parallel vacuum found index %u where %u was expected",
+				 RelationGetRelid(Irel[idx]), slot->indexrelid);
 
-		if (heap_tuple_needs_freeze(tupleheader, FreezeLimit,
-									MultiXactCutoff, buf))
-			return true;
-	}							/* scan along page */
+		if (VacuumActiveNWorkers)
+			pg_atomic_add_fetch_u32(VacuumActiveNWorkers, 1);
 
-	return false;
-}
+		/* The AM updates the shared copy of earlier results in place */
+		stats = slot->updated ? &slot->stats : NULL;
+		if (lvshared->for_cleanup)
+			lazy_cleanup_index(Irel[idx], &stats,
+							   lvshared->reltuples,
+							   lvshared->estimated_count);
+		else
+			lazy_vacuum_index(Irel[idx], &stats,
+							  lazy_shared_tid_reaped, (void *) dead_tuples,
+							  lvshared->reltuples,
+							  lvshared->num_dead_tuples);
 
+		/* On the first pass over the index, the AM allocated the result */
+		if (stats != NULL && stats != &slot->stats)
+		{
+			memcpy(&slot->stats, stats, sizeof(IndexBulkDeleteResult));
+			pfree(stats);
+		}
+		slot->updated = (stats != NULL);
+
+		if (VacuumActiveNWorkers)
+			pg_atomic_sub_fetch_u32(VacuumActiveNWorkers, 1);
+	}
+}
 
 /*
- *	lazy_vacuum_index() -- vacuum one index relation.
+ *	parallel_vacuum_scan_heap() -- a worker's part of a parallel heap scan.
  *
- *		Delete all the index entries pointing to tuples listed in
- *		vacrelstats->dead_tuples, and update running statistics.
+ *		Scans pages with the leader's settings until the round is over, and
+ *		leaves its counters in its slot for the leader to add up.
  */
 static void
-lazy_vacuum_index(Relation indrel,
-				  IndexBulkDeleteResult **stats,
-				  LVRelStats *vacrelstats)
+parallel_vacuum_scan_heap(Relation onerel, int nindexes,
+						  LVParallelScan *lvscan, LVDeadTuples *dead_tuples)
 {
-	IndexVacuumInfo ivinfo;
-	PGRUsage	ru0;
+	LVParallelState *lps;
+	LVRelStats *vacrelstats;
 
-	pg_rusage_init(&ru0);
+	OldestXmin = lvscan->OldestXmin;
+	FreezeLimit = lvscan->FreezeLimit;
+	MultiXactCutoff = lvscan->MultiXactCutoff;
 
-	ivinfo.index = indrel;
-	ivinfo.analyze_only = false;
-	ivinfo.report_progress = false;
-	ivinfo.estimated_count = true;
-	ivinfo.message_level = elevel;
-	/* We can only provide an approximate value of num_heap_tuples here */
-	ivinfo.num_heap_tuples = vacrelstats->old_live_tuples;
-	ivinfo.strategy = vac_strategy;
+	lps = (LVParallelState *) palloc0(sizeof(LVParallelState));
+	lps->lvscan = lvscan;
+	lps->dead_tuples = dead_tuples;
 
-	/* Do bulk deletion */
-	*stats = index_bulk_delete(&ivinfo, *stats,
-							   lazy_tid_reaped, (void *) vacrelstats);
+	vacrelstats = (LVRelStats *) palloc0(sizeof(LVRelStats));
+	vacrelstats->useindex = lvscan->useindex;
+	vacrelstats->rel_pages = lvscan->pscan.phs_nblocks;
+	vacrelstats->latestRemovedXid = InvalidTransactionId;
+	vacrelstats->lps = lps;
 
-	ereport(elevel,
-			(errmsg("scanned index \"%s\" to remove %d row versions",
-					RelationGetRelationName(indrel),
-					vacrelstats->num_dead_tuples),
-			 errdetail_internal("%s", pg_rusage_show(&ru0))));
+	lazy_parallel_scan_pages(onerel, &lvscan->params, vacrelstats, nindexes,
+							 lvscan->aggressive);
+
+	memcpy(&lvscan->worker_stats[ParallelWorkerNumber], vacrelstats,
+		   sizeof(LVRelStats));
+	pfree(vacrelstats);
+	pfree(lps);
 }
 
 /*
- *	lazy_cleanup_index() -- do post-vacuum cleanup for one index relation.
+ * Perform work within a launched parallel process.
+ *
+ * Opens the table and its indexes the same way the leader did, and joins in
+ * scanning the heap, or vacuuming or cleaning up the indexes, as described
+ * in the shared state.
  */
-static void
-lazy_cleanup_index(Relation indrel,
-				   IndexBulkDeleteResult *stats,
-				   LVRelStats *vacrelstats)
+void
+parallel_vacuum_main(dsm_segment *seg, shm_toc *toc)
 {
-	IndexVacuumInfo ivinfo;
-	PGRUsage	ru0;
-
-	pg_rusage_init(&ru0);
-
-	ivinfo.index = indrel;
-	ivinfo.analyze_only = false;
-	ivinfo.report_progress = false;
-	ivinfo.estimated_count = (vacrelstats->tupcount_pages < vacrelstats->rel_pages);
-	ivinfo.message_level = elevel;
+	Relation	onerel;
+	Relation   *indrels;
+	LVShared   *lvshared;
+	LVDeadTuples *dead_tuples = NULL;
+	BufferUsage *buffer_usage;
+	char	   *sharedquery;
+	int			nindexes;
 
-	/*
-	 * Now we can provide a better estimate of total number of surviving
-	 * tuples (we assume indexes are more interested in that than in the
-	 * number of nominally live tuples).
-	 */
-	ivinfo.num_heap_tuples = vacrelstats->new_rel_tuples;
-	ivinfo.strategy = vac_strategy;
+	lvshared = (LVShared *) shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_SHARED,
+										   false);
+	elevel = lvshared->elevel;
 
-	stats = index_vacuum_cleanup(&ivinfo, stats);
+	ereport(DEBUG1,
+			(errmsg("starting parallel vacuum worker for %s",
+					lvshared->scan_heap ? "heap scan" :
+					lvshared->for_cleanup ? "cleanup" : "bulk delete")));
 
-	if (!stats)
-		return;
+	/* Set debug_query_string for individual workers */
+	sharedquery = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_QUERY_TEXT, true);
+	debug_query_string = sharedquery;
+	pgstat_report_activity(STATE_RUNNING, debug_query_string);
 
 	/*
-	 * Now update statistics in pg_class, but only if the index says the count
-	 * is accurate.
+	 * Open the table and its indexes with the leader's lock modes; group
+	 * locking keeps those from conflicting with the leader's own locks.
 	 */
-	if (!stats->estimated_count)
-		vac_update_relstats(indrel,
-							stats->num_pages,
-							stats->num_index_tuples,
-							0,
-							false,
-							InvalidTransactionId,
-							InvalidMultiXactId,
-							false);
+	onerel = table_open(lvshared->relid, ShareUpdateExclusiveLock);
+	vac_open_indexes(onerel, RowExclusiveLock, &nindexes, &indrels);
+	if (nindexes != lvshared->nindexes)
+		elog(ERROR, "parallel vacuum found %d indexes on relation %u, expected %d",
+			 nindexes, lvshared->relid, lvshared->nindexes);
+
+	/* A heap scan has no dead tuple arrays if there are no index passes */
+	if (lvshared->scan_heap || !lvshared->for_cleanup)
+		dead_tuples = (LVDeadTuples *)
+			shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_DEAD_TUPLES,
+						   lvshared->scan_heap);
+
+	/* Do cost-based delay against the leader's limits and shared balance */
+	VacuumCostDelay = lvshared->cost_delay;
+	VacuumCostLimit = lvshared->cost_limit;
+	VacuumCostActive = (VacuumCostDelay > 0);
+	VacuumCostBalance = 0;
+	VacuumPageHit = 0;
+	VacuumPageMiss = 0;
+	VacuumPageDirty = 0;
+	VacuumCostBalanceLocal = 0;
+	VacuumSharedCostBalance = &lvshared->cost_balance;
+	VacuumActiveNWorkers = &lvshared->active_nworkers;
+
+	if (!lvshared->scan_heap)
+		maintenance_work_mem = lvshared->maintenance_work_mem_worker;
+	vac_strategy = GetAccessStrategy(BAS_VACUUM);
+
+	/* Prepare to track buffer usage during parallel execution */
+	InstrStartParallelQuery();
+
+	if (lvshared->scan_heap)
+		parallel_vacuum_scan_heap(onerel, nindexes,
+								  (LVParallelScan *)
+								  shm_toc_lookup(toc,
+												 PARALLEL_VACUUM_KEY_HEAP_SCAN,
+												 false),
+								  dead_tuples);
+	else
+		parallel_vacuum_indexes(indrels, nindexes, lvshared, dead_tuples);
 
-	ereport(elevel,
-			(errmsg("index \"%s\" now contains %.0f row versions in %u pages",
-					RelationGetRelationName(indrel),
-					stats->num_index_tuples,
-					stats->num_pages),
-			 errdetail("%.0f index row versions were removed.\n"
-					   "%u index pages have been deleted, %u are currently reusable.\n"
-					   "%s.",
-					   stats->tuples_removed,
-					   stats->pages_deleted, stats->pages_free,
-					   pg_rusage_show(&ru0))));
+	/* Report buffer usage during parallel execution */
+	buffer_usage = shm_toc_lookup(toc, PARALLEL_VACUUM_KEY_BUFFER_USAGE, false);
+	InstrEndParallelQuery(&buffer_usage[ParallelWorkerNumber]);
 
-	pfree(stats);
+	vac_close_indexes(nindexes, indrels, RowExclusiveLock);
+	table_close(onerel, ShareUpdateExclusiveLock);
+	FreeAccessStrategy(vac_strategy);
 }
 
 /*
@@ -2124,110 +3711,250 @@ count_nondeletable_pages(Relation onerel, LVRelStats *vacrelstats)
  * See the comments at the head of this file for rationale.
  */
 static void
-lazy_space_alloc(LVRelStats *vacrelstats, BlockNumber relblocks)
+lazy_space_alloc(LVRelStats *vacrelstats)
 {
-	long		maxtuples;
 	int			vac_work_mem = IsAutoVacuumWorkerProcess() &&
 	autovacuum_work_mem != -1 ?
 	autovacuum_work_mem : maintenance_work_mem;
 
-	if (vacrelstats->useindex)
-	{
-		maxtuples = (vac_work_mem * 1024L) / sizeof(ItemPointerData);
-		maxtuples = Min(maxtuples, INT_MAX);
-		maxtuples = Min(maxtuples, MaxAllocSize / sizeof(ItemPointerData));
+	StaticAssertStmt(MaxHeapTuplesPerPage < (1 << VAC_TID_OFFSET_BITS),
+					 "VAC_TID_OFFSET_BITS too small for MaxHeapTuplesPerPage");
 
-		/* curious coding here to ensure the multiplication can't overflow */
-		if ((BlockNumber) (maxtuples / LAZY_ALLOC_TUPLES) > relblocks)
-			maxtuples = relblocks * LAZY_ALLOC_TUPLES;
+	vacrelstats->num_dead_tuples = 0;
+	vacrelstats->num_dead_pages = 0;
+	vacrelstats->max_dead_tuples_mem = (uint64) vac_work_mem * 1024;
+	vacrelstats->dead_tuples = NULL;
+	vacrelstats->dead_tuples_cxt = NULL;
 
-		/* stay sane if small maintenance_work_mem */
-		maxtuples = Max(maxtuples, MaxHeapTuplesPerPage);
-	}
-	else
+	/* With no index pass, dead tuples are never remembered across pages */
+	if (!vacrelstats->useindex)
+		return;
+
+	vacrelstats->dead_tuples_cxt =
+		GenerationContextCreate(CurrentMemoryContext,
+								"VACUUM dead tuple set context",
+								16 * 1024);
+	lazy_reset_dead_tuples(vacrelstats);
+}
+
+/*
+ * lazy_reset_dead_tuples - forget all remembered dead tuples
+ *
+ * IntegerSet has no way to remove members, so we throw the whole set away
+ * and start a new one.  During a parallel heap scan, the arrays in DSM are
+ * emptied instead.
+ */
+static void
+lazy_reset_dead_tuples(LVRelStats *vacrelstats)
+{
+	MemoryContext oldcxt;
+
+	if (vacrelstats->lps != NULL)
 	{
-		maxtuples = MaxHeapTuplesPerPage;
+		LVParallelState *lps = vacrelstats->lps;
+
+		lps->dead_tuples->npages = 0;
+		lps->dead_tuples->ntuples = 0;
+		lps->lvscan->full = false;
+		vacrelstats->num_dead_tuples = 0;
+		vacrelstats->num_dead_pages = 0;
+		return;
 	}
 
+	MemoryContextReset(vacrelstats->dead_tuples_cxt);
+	oldcxt = MemoryContextSwitchTo(vacrelstats->dead_tuples_cxt);
+	vacrelstats->dead_tuples = intset_create();
+	MemoryContextSwitchTo(oldcxt);
+
 	vacrelstats->num_dead_tuples = 0;
-	vacrelstats->max_dead_tuples = (int) maxtuples;
-	vacrelstats->dead_tuples = (ItemPointer)
-		palloc(maxtuples * sizeof(ItemPointerData));
+	vacrelstats->num_dead_pages = 0;
 }
 
 /*
- * lazy_record_dead_tuple - remember one deletable tuple
+ * lazy_record_dead_tuples - remember the deletable tuples of one page
+ *
+ * Pages are processed in order and deadoffsets is sorted, so the values
+ * arrive in the ascending order IntegerSet requires.
+ *
+ * In a parallel heap scan, the page gets the next slots of the arrays in
+ * DSM, which the caller has made sure there's room for by reserving it.
+ * The counts in vacrelstats aren't kept up to date then; the leader sets
+ * them from the arrays after each round.
  */
 static void
-lazy_record_dead_tuple(LVRelStats *vacrelstats,
-					   ItemPointer itemptr)
+lazy_record_dead_tuples(LVRelStats *vacrelstats, BlockNumber blkno,
+						OffsetNumber *deadoffsets, int ndeadoffsets)
 {
-	/*
-	 * The array shouldn't overflow under normal behavior, but perhaps it
-	 * could if we are given a really small maintenance_work_mem. In that
-	 * case, just forget the last few tuples (we'll get 'em next time).
-	 */
-	if (vacrelstats->num_dead_tuples < vacrelstats->max_dead_tuples)
+	int			i;
+
+	if (vacrelstats->lps != NULL)
 	{
-		vacrelstats->dead_tuples[vacrelstats->num_dead_tuples] = *itemptr;
-		vacrelstats->num_dead_tuples++;
-		pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
-									 vacrelstats->num_dead_tuples);
+		LVParallelState *lps = vacrelstats->lps;
+		LVDeadTuples *dead_tuples = lps->dead_tuples;
+		LVDeadTuplePage *dpage;
+		int64		first;
+
+		SpinLockAcquire(&lps->lvscan->mutex);
+		Assert(dead_tuples->npages < dead_tuples->maxpages);
+		Assert(dead_tuples->ntuples + ndeadoffsets <= dead_tuples->maxtuples);
+		dpage = &dead_tuples->pages[dead_tuples->npages++];
+		first = dead_tuples->ntuples;
+		dead_tuples->ntuples += ndeadoffsets;
+		SpinLockRelease(&lps->lvscan->mutex);
+
+		dpage->blkno = blkno;
+		dpage->noffsets = ndeadoffsets;
+		dpage->first = first;
+		memcpy(LVDeadTuplesOffsets(dead_tuples) + first, deadoffsets,
+			   ndeadoffsets * sizeof(OffsetNumber));
+		return;
 	}
+
+	for (i = 0; i < ndeadoffsets; i++)
+		intset_add_member(vacrelstats->dead_tuples,
+						  VacEncodeTid(blkno, deadoffsets[i]));
+
+	vacrelstats->num_dead_tuples += ndeadoffsets;
+	if (ndeadoffsets > 0)
+		vacrelstats->num_dead_pages++;
+	pgstat_progress_update_param(PROGRESS_VACUUM_NUM_DEAD_TUPLES,
+								 vacrelstats->num_dead_tuples);
 }
 
 /*
  *	lazy_tid_reaped() -- is a particular tid deletable?
  *
  *		This has the right signature to be an IndexBulkDeleteCallback.
- *
- *		Assumes dead_tuples array is in sorted order.
  */
 static bool
 lazy_tid_reaped(ItemPointer itemptr, void *state)
 {
 	LVRelStats *vacrelstats = (LVRelStats *) state;
-	ItemPointer res;
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(itemptr);
+
+	if (vacrelstats->lps != NULL)
+		return lazy_shared_tid_reaped(itemptr, vacrelstats->lps->dead_tuples);
+
+	/* can't be one of ours, and mustn't be aliased by VacEncodeTid */
+	if (offnum > MaxHeapTuplesPerPage)
+		return false;
+
+	return intset_is_member(vacrelstats->dead_tuples,
+							VacEncodeTid(ItemPointerGetBlockNumber(itemptr),
+										 offnum));
+}
+
+/*
+ * lazy_copy_dead_tuples - flatten the next batch of dead tuples for workers
+ *
+ * The caller has begun iterating over vacrelstats->dead_tuples and put the
+ * first value not yet handed out in *next.  We copy whole pages' worth of
+ * values into dead_tuples until it is full, leaving the first value that
+ * didn't fit in *next.  Returns true if there are values left over for
+ * another batch.
+ *
+ * A new page is only started while there is room for MaxHeapTuplesPerPage
+ * more offsets, so a page is never split between batches.
+ */
+static bool
+lazy_copy_dead_tuples(LVRelStats *vacrelstats, LVDeadTuples *dead_tuples,
+					  uint64 *next)
+{
+	OffsetNumber *offsets = LVDeadTuplesOffsets(dead_tuples);
+	int64		npages = 0;
+	int64		ntuples = 0;
+	bool		more = true;
+
+	do
+	{
+		BlockNumber blkno = VacDecodeBlock(*next);
+
+		if (npages == 0 || dead_tuples->pages[npages - 1].blkno != blkno)
+		{
+			if (npages >= dead_tuples->maxpages ||
+				ntuples + MaxHeapTuplesPerPage > dead_tuples->maxtuples)
+				break;
+			dead_tuples->pages[npages].blkno = blkno;
+			dead_tuples->pages[npages].noffsets = 0;
+			dead_tuples->pages[npages].first = ntuples;
+			npages++;
+		}
+
+		Assert(ntuples < dead_tuples->maxtuples);
+		offsets[ntuples++] = VacDecodeOffset(*next);
+		dead_tuples->pages[npages - 1].noffsets++;
 
-	res = (ItemPointer) bsearch((void *) itemptr,
-								(void *) vacrelstats->dead_tuples,
-								vacrelstats->num_dead_tuples,
-								sizeof(ItemPointerData),
-								vac_cmp_itemptr);
+		more = intset_iterate_next(vacrelstats->dead_tuples, next);
+	} while (more);
 
-	return (res != NULL);
+	Assert(npages > 0);
+	dead_tuples->npages = npages;
+	dead_tuples->ntuples = ntuples;
+
+	return more;
 }
 
 /*
- * Comparator routines for use with qsort() and bsearch().
+ * Comparators for lazy_shared_tid_reaped's binary searches.  The first also
+ * sorts the pages of a parallel heap scan.
  */
 static int
-vac_cmp_itemptr(const void *left, const void *right)
+vac_cmp_dead_page(const void *left, const void *right)
 {
-	BlockNumber lblk,
-				rblk;
-	OffsetNumber loff,
-				roff;
-
-	lblk = ItemPointerGetBlockNumber((ItemPointer) left);
-	rblk = ItemPointerGetBlockNumber((ItemPointer) right);
+	BlockNumber l = ((const LVDeadTuplePage *) left)->blkno;
+	BlockNumber r = ((const LVDeadTuplePage *) right)->blkno;
 
-	if (lblk < rblk)
+	if (l < r)
 		return -1;
-	if (lblk > rblk)
+	if (l > r)
 		return 1;
+	return 0;
+}
 
-	loff = ItemPointerGetOffsetNumber((ItemPointer) left);
-	roff = ItemPointerGetOffsetNumber((ItemPointer) right);
+static int
+vac_cmp_offsetnumber(const void *left, const void *right)
+{
+	OffsetNumber l = *(const OffsetNumber *) left;
+	OffsetNumber r = *(const OffsetNumber *) right;
 
-	if (loff < roff)
+	if (l < r)
 		return -1;
-	if (loff > roff)
+	if (l > r)
 		return 1;
-
 	return 0;
 }
 
+/*
+ *	lazy_shared_tid_reaped() -- is a particular tid deletable?
+ *
+ *		Like lazy_tid_reaped, but looks in the flattened copy of the dead
+ *		tuples that parallel vacuum keeps in DSM.
+ */
+static bool
+lazy_shared_tid_reaped(ItemPointer itemptr, void *state)
+{
+	LVDeadTuples *dead_tuples = (LVDeadTuples *) state;
+	BlockNumber blkno = ItemPointerGetBlockNumber(itemptr);
+	OffsetNumber offnum = ItemPointerGetOffsetNumber(itemptr);
+	LVDeadTuplePage key;
+	LVDeadTuplePage *page;
+
+	key.blkno = blkno;
+	page = (LVDeadTuplePage *) bsearch((void *) &key,
+									   (void *) dead_tuples->pages,
+									   dead_tuples->npages,
+									   sizeof(LVDeadTuplePage),
+									   vac_cmp_dead_page);
+	if (page == NULL)
+		return false;
+
+	return bsearch((void *) &offnum,
+				   (void *) (LVDeadTuplesOffsets(dead_tuples) + page->first),
+				   page->noffsets,
+				   sizeof(OffsetNumber),
+				   vac_cmp_offsetnumber) != NULL;
+}
+
 /*
  * Check if every tuple in the given page is visible to all current and future
  * transactions. Also return the visibility_cutoff_xid which is the highest
@@ -169,6 +169,18 @@ visibilitymap_clear(Relation rel, BlockNumber heapBlk, Buffer buf, uint8 flags)
 	return cleared;
 }
 
+/*
+ *	visibilitymap_mapblock - return the map block that covers heapBlk
+ *
+ * Callers that keep several map pages pinned at once can use this to decide
+ * which of their buffers to pass to visibilitymap_get_status.
+ */
+BlockNumber
+visibilitymap_mapblock(BlockNumber heapBlk)
+{
+	return HEAPBLK_TO_MAPBLOCK(heapBlk);
+}
+
 /*
  *	visibilitymap_pin - pin a map page for setting a bit
  *
@@ -7358,6 +7358,14 @@ StartupXLOG(void)
 					(errmsg("redo is not required")));
 		}
 	}
+	else
+	{
+		/*
+		 * No recovery was needed, so the statistics saved at the last clean
+		 * shutdown are still valid.  Load them into shared memory.
+		 */
+		pgstat_restore_stats();
+	}
 
 	/*
 	 * Kill WAL receiver, if it's still running, before we continue to write
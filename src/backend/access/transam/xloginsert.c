@@ -76,6 +76,9 @@ static uint32 mainrdata_len;	/* total # of bytes in chain */
 /* flags for the in-progress insertion */
 static uint8 curinsert_flags = 0;
 
+/* did the assembled record include the toplevel xid of a subtransaction? */
+static bool curinsert_topxid_included = false;
+
 /*
  * These are used to hold the record header while constructing a record.
  * 'hdr_scratch' is not a plain variable, but is palloc'd at initialization,
@@ -88,11 +91,13 @@ static XLogRecData hdr_rdt;
 static char *hdr_scratch = NULL;
 
 #define SizeOfXlogOrigin	(sizeof(RepOriginId) + sizeof(char))
+#define SizeOfXLogTransactionId	(sizeof(TransactionId) + sizeof(char))
 
 #define HEADER_SCRATCH_SIZE \
 	(SizeOfXLogRecord + \
 	 MaxSizeOfXLogRecordBlockHeader * (XLR_MAX_BLOCK_ID + 1) + \
-	 SizeOfXLogRecordDataHeaderLong + SizeOfXlogOrigin)
+	 SizeOfXLogRecordDataHeaderLong + SizeOfXlogOrigin + \
+	 SizeOfXLogTransactionId)
 
 /*
  * An array of XLogRecData structs, to hold registered data.
@@ -202,6 +207,7 @@ XLogResetInsertion(void)
 	mainrdata_len = 0;
 	mainrdata_last = (XLogRecData *) &mainrdata_head;
 	curinsert_flags = 0;
+	curinsert_topxid_included = false;
 	begininsert_called = false;
 }
 
@@ -462,6 +468,10 @@ XLogInsert(RmgrId rmid, uint8 info)
 		EndPos = XLogInsertRecord(rdt, fpw_lsn, curinsert_flags);
 	} while (EndPos == InvalidXLogRecPtr);
 
+	/* the toplevel xid only needs to be logged once per subtransaction */
+	if (curinsert_topxid_included)
+		MarkSubTransactionAssigned();
+
 	XLogResetInsertion();
 
 	return EndPos;
@@ -743,6 +753,21 @@ XLogRecordAssemble(RmgrId rmid, uint8 info,
 		scratch += sizeof(replorigin_session_origin);
 	}
 
+	/*
+	 * followed by the toplevel xid, if this is the first record of a
+	 * subtransaction (see IsSubTransactionAssignmentPending)
+	 */
+	curinsert_topxid_included = false;
+	if (IsSubTransactionAssignmentPending())
+	{
+		TransactionId xid = GetTopTransactionIdIfAny();
+
+		*(scratch++) = (char) XLR_BLOCK_ID_TOPLEVEL_XID;
+		memcpy(scratch, &xid, sizeof(TransactionId));
+		scratch += sizeof(TransactionId);
+		curinsert_topxid_included = true;
+	}
+
 	/* followed by main data, if any */
 	if (mainrdata_len > 0)
 	{
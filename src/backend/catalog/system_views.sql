@@ -1026,6 +1026,26 @@ CREATE VIEW pg_stat_progress_create_index AS
     FROM pg_stat_get_progress_info('CREATE INDEX') AS S
         LEFT JOIN pg_database D ON S.datid = D.oid;
 
+CREATE VIEW pg_stat_lwlocks AS
+    SELECT
+        S.tranche,
+        S.acquires,
+        S.contended,
+        S.wait_time,
+        S.max_hold_time
+    FROM pg_stat_get_lwlocks() AS S;
+
+CREATE VIEW pg_cost_calibration AS
+    SELECT
+        C.node_type,
+        T.spcname AS tablespace,
+        C.parameter,
+        C.samples,
+        C.ms_per_unit,
+        C.fitted_cost
+    FROM pg_get_cost_calibration() AS C
+        LEFT JOIN pg_tablespace T ON T.oid = C.spcid;
+
 CREATE VIEW pg_user_mappings AS
     SELECT
         U.oid       AS umid,
@@ -1058,7 +1078,7 @@ REVOKE ALL ON pg_replication_origin_status FROM public;
 
 -- All columns of pg_subscription except subconninfo are readable.
 REVOKE ALL ON pg_subscription FROM public;
-GRANT SELECT (subdbid, subname, subowner, subenabled, subslotname, subpublications)
+GRANT SELECT (subdbid, subname, subowner, subenabled, substream, subslotname, subpublications)
     ON pg_subscription TO public;
 
 
@@ -1312,6 +1332,8 @@ REVOKE EXECUTE ON FUNCTION pg_stat_reset() FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_shared(text) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_table_counters(oid) FROM public;
 REVOKE EXECUTE ON FUNCTION pg_stat_reset_single_function_counters(oid) FROM public;
+REVOKE EXECUTE ON FUNCTION pg_cardinality_feedback_reset() FROM public;
+REVOKE EXECUTE ON FUNCTION pg_cost_calibration_reset() FROM public;
 
 REVOKE EXECUTE ON FUNCTION lo_import(text) FROM public;
 REVOKE EXECUTE ON FUNCTION lo_import(text, oid) FROM public;
@@ -127,6 +127,7 @@
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
+#include "postmaster/proxy.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
 #include "storage/proc.h"
@@ -649,6 +650,9 @@ Async_Listen(const char *channel)
 	if (Trace_notify)
 		elog(DEBUG1, "Async_Listen(%s,%d)", channel, MyProcPid);
 
+	/* Notifications must reach this session through this backend */
+	SessionPoolPin("LISTEN");
+
 	queue_listen(LISTEN_LISTEN, channel);
 }
 
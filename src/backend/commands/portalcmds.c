@@ -28,6 +28,7 @@
 #include "executor/executor.h"
 #include "executor/tstoreReceiver.h"
 #include "miscadmin.h"
+#include "postmaster/proxy.h"
 #include "rewrite/rewriteHandler.h"
 #include "tcop/pquery.h"
 #include "tcop/tcopprot.h"
@@ -69,6 +70,8 @@ PerformCursorOpen(DeclareCursorStmt *cstmt, ParamListInfo params,
 		ereport(ERROR,
 				(errcode(ERRCODE_INSUFFICIENT_PRIVILEGE),
 				 errmsg("cannot create a cursor WITH HOLD within security-restricted operation")));
+	else
+		SessionPoolPin("WITH HOLD cursor");
 
 	/*
 	 * Parse analysis was done already, but we still have to run the rule
@@ -16,20 +16,25 @@
 
 #include "access/relation.h"
 #include "access/relscan.h"
+#include "access/sysattr.h"
 #include "access/table.h"
 #include "catalog/catalog.h"
 #include "catalog/dependency.h"
 #include "catalog/indexing.h"
 #include "catalog/namespace.h"
+#include "catalog/objectaddress.h"
 #include "catalog/pg_namespace.h"
 #include "catalog/pg_statistic_ext.h"
 #include "catalog/pg_statistic_ext_data.h"
 #include "commands/comment.h"
 #include "commands/defrem.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/optimizer.h"
 #include "statistics/statistics.h"
 #include "utils/builtins.h"
 #include "utils/inval.h"
+#include "utils/lsyscache.h"
 #include "utils/memutils.h"
 #include "utils/rel.h"
 #include "utils/syscache.h"
@@ -38,7 +43,7 @@
 
 static char *ChooseExtendedStatisticName(const char *name1, const char *name2,
 										 const char *label, Oid namespaceid);
-static char *ChooseExtendedStatisticNameAddition(List *exprs);
+static char *ChooseExtendedStatisticNameAddition(List *exprs, Oid relid);
 
 
 /* qsort comparator for the attnums in CreateStatistics */
@@ -60,6 +65,7 @@ CreateStatistics(CreateStatsStmt *stmt)
 {
 	int16		attnums[STATS_MAX_DIMENSIONS];
 	int			numcols = 0;
+	List	   *stxexprs = NIL;
 	char	   *namestr;
 	NameData	stxname;
 	Oid			statoid;
@@ -77,18 +83,22 @@ CreateStatistics(CreateStatsStmt *stmt)
 	Oid			relid;
 	ObjectAddress parentobject,
 				myself;
-	Datum		types[3];		/* one for each possible type of statistic */
+	Datum		types[4];		/* one for each possible type of statistic */
 	int			ntypes;
 	ArrayType  *stxkind;
 	bool		build_ndistinct;
 	bool		build_dependencies;
 	bool		build_mcv;
+	bool		build_histogram;
 	bool		requested_type = false;
 	int			i;
 	ListCell   *cell;
 
 	Assert(IsA(stmt, CreateStatsStmt));
 
+	/* The columns and expressions must have been transformed already */
+	Assert(stmt->transformed);
+
 	/*
 	 * Examine the FROM clause.  Currently, we only allow it to be a single
 	 * simple table, but later we'll probably allow multiple tables and JOIN
@@ -158,7 +168,7 @@ CreateStatistics(CreateStatsStmt *stmt)
 	{
 		namespaceId = RelationGetNamespace(rel);
 		namestr = ChooseExtendedStatisticName(RelationGetRelationName(rel),
-											  ChooseExtendedStatisticNameAddition(stmt->exprs),
+											  ChooseExtendedStatisticNameAddition(stmt->exprs, relid),
 											  "stat",
 											  namespaceId);
 	}
@@ -187,72 +197,97 @@ CreateStatistics(CreateStatsStmt *stmt)
 	}
 
 	/*
-	 * Currently, we only allow simple column references in the expression
-	 * list.  That will change someday, and again the grammar already supports
-	 * it so we have to enforce restrictions here.  For now, we can convert
-	 * the expression list to a simple array of attnums.  While at it, enforce
-	 * some constraints.
+	 * Sort out the simple column references, which are stored as an array of
+	 * attnums, from the other expressions, which are stored as expression
+	 * trees.  While at it, enforce some constraints.
 	 */
 	foreach(cell, stmt->exprs)
 	{
 		Node	   *expr = (Node *) lfirst(cell);
-		ColumnRef  *cref;
-		char	   *attname;
-		HeapTuple	atttuple;
-		Form_pg_attribute attForm;
 		TypeCacheEntry *type;
 
-		if (!IsA(expr, ColumnRef))
-			ereport(ERROR,
-					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-					 errmsg("only simple column references are allowed in CREATE STATISTICS")));
-		cref = (ColumnRef *) expr;
-
-		if (list_length(cref->fields) != 1)
-			ereport(ERROR,
-					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-					 errmsg("only simple column references are allowed in CREATE STATISTICS")));
-		attname = strVal((Value *) linitial(cref->fields));
-
-		atttuple = SearchSysCacheAttName(relid, attname);
-		if (!HeapTupleIsValid(atttuple))
-			ereport(ERROR,
-					(errcode(ERRCODE_UNDEFINED_COLUMN),
-					 errmsg("column \"%s\" does not exist",
-							attname)));
-		attForm = (Form_pg_attribute) GETSTRUCT(atttuple);
-
-		/* Disallow use of system attributes in extended stats */
-		if (attForm->attnum <= 0)
-			ereport(ERROR,
-					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-					 errmsg("statistics creation on system columns is not supported")));
-
-		/* Disallow data types without a less-than operator */
-		type = lookup_type_cache(attForm->atttypid, TYPECACHE_LT_OPR);
-		if (type->lt_opr == InvalidOid)
-			ereport(ERROR,
-					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
-					 errmsg("column \"%s\" cannot be used in statistics because its type %s has no default btree operator class",
-							attname, format_type_be(attForm->atttypid))));
-
 		/* Make sure no more than STATS_MAX_DIMENSIONS columns are used */
-		if (numcols >= STATS_MAX_DIMENSIONS)
+		if (numcols + list_length(stxexprs) >= STATS_MAX_DIMENSIONS)
 			ereport(ERROR,
 					(errcode(ERRCODE_TOO_MANY_COLUMNS),
 					 errmsg("cannot have more than %d columns in statistics",
 							STATS_MAX_DIMENSIONS)));
 
-		attnums[numcols] = attForm->attnum;
-		numcols++;
-		ReleaseSysCache(atttuple);
+		if (IsA(expr, Var) && ((Var *) expr)->varattno != InvalidAttrNumber)
+		{
+			Var		   *var = (Var *) expr;
+			HeapTuple	atttuple;
+			Form_pg_attribute attForm;
+
+			/* Disallow use of system attributes in extended stats */
+			if (var->varattno < 0)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("statistics creation on system columns is not supported")));
+
+			atttuple = SearchSysCacheAttNum(relid, var->varattno);
+			if (!HeapTupleIsValid(atttuple))
+				elog(ERROR, "cache lookup failed for attribute %d of relation %u",
+					 var->varattno, relid);
+			attForm = (Form_pg_attribute) GETSTRUCT(atttuple);
+
+			/* Disallow data types without a less-than operator */
+			type = lookup_type_cache(attForm->atttypid, TYPECACHE_LT_OPR);
+			if (type->lt_opr == InvalidOid)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("column \"%s\" cannot be used in statistics because its type %s has no default btree operator class",
+								NameStr(attForm->attname),
+								format_type_be(attForm->atttypid))));
+
+			attnums[numcols] = attForm->attnum;
+			numcols++;
+			ReleaseSysCache(atttuple);
+		}
+		else
+		{
+			Bitmapset  *attrs = NULL;
+			int			k;
+
+			/* Disallow use of system attributes in extended stats */
+			pull_varattnos(expr, 1, &attrs);
+			k = -1;
+			while ((k = bms_next_member(attrs, k)) >= 0)
+			{
+				if (k + FirstLowInvalidHeapAttributeNumber < 0)
+					ereport(ERROR,
+							(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+							 errmsg("statistics creation on system columns is not supported")));
+			}
+
+			/*
+			 * ANALYZE evaluates the expressions on the sampled rows, so like
+			 * index expressions they must be immutable.  Run them through
+			 * the planner first, so that inlined functions are judged by
+			 * what they actually do (see CheckMutability).
+			 */
+			if (contain_mutable_functions((Node *) expression_planner((Expr *) expr)))
+				ereport(ERROR,
+						(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
+						 errmsg("functions in statistics expression must be marked IMMUTABLE")));
+
+			/* Disallow data types without a less-than operator */
+			type = lookup_type_cache(exprType(expr), TYPECACHE_LT_OPR);
+			if (type->lt_opr == InvalidOid)
+				ereport(ERROR,
+						(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+						 errmsg("expression cannot be used in statistics because its type %s has no default btree operator class",
+								format_type_be(exprType(expr)))));
+
+			stxexprs = lappend(stxexprs, expr);
+		}
 	}
 
 	/*
-	 * Check that at least two columns were specified in the statement. The
-	 * upper bound was already checked in the loop above.
+	 * Check that at least two columns or expressions were specified in the
+	 * statement. The upper bound was already checked in the loop above.
 	 */
-	if (numcols < 2)
+	if (numcols + list_length(stxexprs) < 2)
 		ereport(ERROR,
 				(errcode(ERRCODE_INVALID_OBJECT_DEFINITION),
 				 errmsg("extended statistics require at least 2 columns")));
@@ -276,6 +311,20 @@ CreateStatistics(CreateStatsStmt *stmt)
 					 errmsg("duplicate column name in statistics definition")));
 	}
 
+	/* Likewise for the expressions, which we have to compare one by one */
+	foreach(cell, stxexprs)
+	{
+		ListCell   *cell2;
+
+		for_each_cell(cell2, lnext(cell))
+		{
+			if (equal(lfirst(cell), lfirst(cell2)))
+				ereport(ERROR,
+						(errcode(ERRCODE_DUPLICATE_OBJECT),
+						 errmsg("duplicate expression in statistics definition")));
+		}
+	}
+
 	/* Form an int2vector representation of the sorted column list */
 	stxkeys = buildint2vector(attnums, numcols);
 
@@ -285,6 +334,7 @@ CreateStatistics(CreateStatsStmt *stmt)
 	build_ndistinct = false;
 	build_dependencies = false;
 	build_mcv = false;
+	build_histogram = false;
 	foreach(cell, stmt->stat_types)
 	{
 		char	   *type = strVal((Value *) lfirst(cell));
@@ -304,19 +354,40 @@ CreateStatistics(CreateStatsStmt *stmt)
 			build_mcv = true;
 			requested_type = true;
 		}
+		else if (strcmp(type, "histogram") == 0)
+		{
+			build_histogram = true;
+			requested_type = true;
+		}
 		else
 			ereport(ERROR,
 					(errcode(ERRCODE_SYNTAX_ERROR),
 					 errmsg("unrecognized statistics kind \"%s\"",
 							type)));
 	}
-	/* If no statistic type was specified, build them all. */
+
+	/*
+	 * If no statistic type was specified, build all the default kinds.
+	 * Histograms are considerably more expensive to build and store, so they
+	 * are only built when requested explicitly, except on expressions.  Only
+	 * histograms support those, so that's all we build then.
+	 */
 	if (!requested_type)
 	{
-		build_ndistinct = true;
-		build_dependencies = true;
-		build_mcv = true;
+		if (stxexprs != NIL)
+			build_histogram = true;
+		else
+		{
+			build_ndistinct = true;
+			build_dependencies = true;
+			build_mcv = true;
+		}
 	}
+	else if (stxexprs != NIL &&
+			 (build_ndistinct || build_dependencies || build_mcv))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("only histogram statistics can be built on expressions")));
 
 	/* construct the char array of enabled statistic types */
 	ntypes = 0;
@@ -326,6 +397,8 @@ CreateStatistics(CreateStatsStmt *stmt)
 		types[ntypes++] = CharGetDatum(STATS_EXT_DEPENDENCIES);
 	if (build_mcv)
 		types[ntypes++] = CharGetDatum(STATS_EXT_MCV);
+	if (build_histogram)
+		types[ntypes++] = CharGetDatum(STATS_EXT_HISTOGRAM);
 	Assert(ntypes > 0 && ntypes <= lengthof(types));
 	stxkind = construct_array(types, ntypes, CHAROID, 1, true, 'c');
 
@@ -347,6 +420,12 @@ CreateStatistics(CreateStatsStmt *stmt)
 	values[Anum_pg_statistic_ext_stxkeys - 1] = PointerGetDatum(stxkeys);
 	values[Anum_pg_statistic_ext_stxkind - 1] = PointerGetDatum(stxkind);
 
+	if (stxexprs != NIL)
+		values[Anum_pg_statistic_ext_stxexprs - 1] =
+			CStringGetTextDatum(nodeToString(stxexprs));
+	else
+		nulls[Anum_pg_statistic_ext_stxexprs - 1] = true;
+
 	/* insert it into pg_statistic_ext */
 	htup = heap_form_tuple(statrel->rd_att, values, nulls);
 	CatalogTupleInsert(statrel, htup);
@@ -369,6 +448,7 @@ CreateStatistics(CreateStatsStmt *stmt)
 	datanulls[Anum_pg_statistic_ext_data_stxdndistinct - 1] = true;
 	datanulls[Anum_pg_statistic_ext_data_stxddependencies - 1] = true;
 	datanulls[Anum_pg_statistic_ext_data_stxdmcv - 1] = true;
+	datanulls[Anum_pg_statistic_ext_data_stxdhistogram - 1] = true;
 
 	/* insert it into pg_statistic_ext_data */
 	htup = heap_form_tuple(datarel->rd_att, datavalues, datanulls);
@@ -396,6 +476,16 @@ CreateStatistics(CreateStatsStmt *stmt)
 		recordDependencyOn(&myself, &parentobject, DEPENDENCY_AUTO);
 	}
 
+	/*
+	 * Likewise for the columns used in the expressions, and add normal
+	 * dependencies on the functions, operators etc. they use, as for index
+	 * expressions.
+	 */
+	if (stxexprs != NIL)
+		recordDependencyOnSingleRelExpr(&myself, (Node *) stxexprs, relid,
+										DEPENDENCY_NORMAL, DEPENDENCY_AUTO,
+										false);
+
 	/*
 	 * Also add dependencies on namespace and owner.  These are required
 	 * because the stats object might have a different namespace and/or owner
@@ -490,12 +580,16 @@ RemoveStatisticsById(Oid statsOid)
  * values, this assumption could fail.  But that seems like a corner case
  * that doesn't justify zapping the stats in common cases.)
  *
- * For MCV lists that's not the case, as those statistics store the datums
- * internally. In this case we simply reset the statistics value to NULL.
+ * For MCV lists and histograms that's not the case, as those statistics
+ * store the datums internally. In this case we simply reset the statistics
+ * value to NULL.
  *
  * Note that "type change" includes collation change, which means we can rely
- * on the MCV list being consistent with the collation info in pg_attribute
- * during estimation.
+ * on the MCV list and histogram being consistent with the collation info in
+ * pg_attribute during estimation.
+ *
+ * Statistics on expressions would need the expressions rebuilt for the new
+ * column type, so we simply refuse the type change for columns they use.
  */
 void
 UpdateStatisticsForTypeChange(Oid statsOid, Oid relationOid, int attnum,
@@ -509,6 +603,34 @@ UpdateStatisticsForTypeChange(Oid statsOid, Oid relationOid, int attnum,
 	Datum		values[Natts_pg_statistic_ext_data];
 	bool		nulls[Natts_pg_statistic_ext_data];
 	bool		replaces[Natts_pg_statistic_ext_data];
+	bool		isnull;
+	Datum		datum;
+
+	oldtup = SearchSysCache1(STATEXTOID, ObjectIdGetDatum(statsOid));
+	if (!HeapTupleIsValid(oldtup))
+		elog(ERROR, "cache lookup failed for statistics object %u", statsOid);
+
+	datum = SysCacheGetAttr(STATEXTOID, oldtup,
+							Anum_pg_statistic_ext_stxexprs, &isnull);
+	if (!isnull)
+	{
+		Bitmapset  *attrs = NULL;
+
+		pull_varattnos(stringToNode(TextDatumGetCString(datum)), 1, &attrs);
+		if (bms_is_member(attnum - FirstLowInvalidHeapAttributeNumber, attrs))
+		{
+			ObjectAddress object;
+
+			ObjectAddressSet(object, StatisticExtRelationId, statsOid);
+			ereport(ERROR,
+					(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+					 errmsg("cannot alter type of a column used by statistics on expressions"),
+					 errdetail("%s depends on column \"%s\"",
+							   getObjectDescription(&object),
+							   get_attname(relationOid, attnum, false))));
+		}
+	}
+	ReleaseSysCache(oldtup);
 
 	oldtup = SearchSysCache1(STATEXTDATASTXOID, ObjectIdGetDatum(statsOid));
 	if (!HeapTupleIsValid(oldtup))
@@ -519,7 +641,8 @@ UpdateStatisticsForTypeChange(Oid statsOid, Oid relationOid, int attnum,
 	 * table's columns then there's no need to reset the stats. Functional
 	 * dependencies and ndistinct stats should still hold true.
 	 */
-	if (!statext_is_kind_built(oldtup, STATS_EXT_MCV))
+	if (!statext_is_kind_built(oldtup, STATS_EXT_MCV) &&
+		!statext_is_kind_built(oldtup, STATS_EXT_HISTOGRAM))
 	{
 		ReleaseSysCache(oldtup);
 		return;
@@ -535,6 +658,8 @@ UpdateStatisticsForTypeChange(Oid statsOid, Oid relationOid, int attnum,
 
 	replaces[Anum_pg_statistic_ext_data_stxdmcv - 1] = true;
 	nulls[Anum_pg_statistic_ext_data_stxdmcv - 1] = true;
+	replaces[Anum_pg_statistic_ext_data_stxdhistogram - 1] = true;
+	nulls[Anum_pg_statistic_ext_data_stxdhistogram - 1] = true;
 
 	rel = heap_open(StatisticExtDataRelationId, RowExclusiveLock);
 
@@ -612,7 +737,7 @@ ChooseExtendedStatisticName(const char *name1, const char *name2,
  * ChooseIndexNameAddition.
  */
 static char *
-ChooseExtendedStatisticNameAddition(List *exprs)
+ChooseExtendedStatisticNameAddition(List *exprs, Oid relid)
 {
 	char		buf[NAMEDATALEN * 2];
 	int			buflen = 0;
@@ -621,14 +746,14 @@ ChooseExtendedStatisticNameAddition(List *exprs)
 	buf[0] = '\0';
 	foreach(lc, exprs)
 	{
-		ColumnRef  *cref = (ColumnRef *) lfirst(lc);
+		Node	   *expr = (Node *) lfirst(lc);
 		const char *name;
 
-		/* It should be one of these, but just skip if it happens not to be */
-		if (!IsA(cref, ColumnRef))
-			continue;
-
-		name = strVal((Value *) linitial(cref->fields));
+		/* use the column names, and "expr" for the other expressions */
+		if (IsA(expr, Var) && ((Var *) expr)->varattno != InvalidAttrNumber)
+			name = get_attname(relid, ((Var *) expr)->varattno, false);
+		else
+			name = "expr";
 
 		if (buflen > 0)
 			buf[buflen++] = '_';	/* insert _ between names */
@@ -53,6 +53,8 @@
 #include "jit/jit.h"
 #include "mb/pg_wchar.h"
 #include "miscadmin.h"
+#include "optimizer/cardfeedback.h"
+#include "optimizer/costcalib.h"
 #include "parser/parsetree.h"
 #include "storage/bufmgr.h"
 #include "storage/lmgr.h"
@@ -479,6 +481,22 @@ standard_ExecutorEnd(QueryDesc *queryDesc)
 	 */
 	oldcontext = MemoryContextSwitchTo(estate->es_query_cxt);
 
+	/*
+	 * If we counted rows, or timed the nodes, let the planner learn from
+	 * that before the plan state goes away.  Timed nodes count rows too;
+	 * INSTRUMENT_ROWS alone is what EXPLAIN (ANALYZE, TIMING OFF) asks for.
+	 */
+	if (!(estate->es_top_eflags & EXEC_FLAG_EXPLAIN_ONLY))
+	{
+		if (enable_cardinality_feedback &&
+			(estate->es_instrument & (INSTRUMENT_TIMER | INSTRUMENT_ROWS)))
+			cardinality_feedback_record(queryDesc->planstate);
+		if (enable_cost_calibration &&
+			(estate->es_instrument & INSTRUMENT_TIMER) &&
+			(estate->es_instrument & INSTRUMENT_BUFFERS))
+			cost_calibration_record(queryDesc->planstate);
+	}
+
 	ExecEndPlan(queryDesc->planstate, estate);
 
 	/* do away with our snapshots */
@@ -1302,6 +1320,11 @@ InitResultRelInfo(ResultRelInfo *resultRelInfo,
 	/* The following fields are set later if needed */
 	resultRelInfo->ri_FdwState = NULL;
 	resultRelInfo->ri_usesFdwDirectModify = false;
+	resultRelInfo->ri_NumSlots = 0;
+	resultRelInfo->ri_NumSlotsInitialized = 0;
+	resultRelInfo->ri_BatchSize = 0;
+	resultRelInfo->ri_Slots = NULL;
+	resultRelInfo->ri_PlanSlots = NULL;
 	resultRelInfo->ri_ConstraintExprs = NULL;
 	resultRelInfo->ri_GeneratedExprs = NULL;
 	resultRelInfo->ri_junkFilter = NULL;
@@ -449,6 +449,65 @@ ExecSimpleRelationInsert(EState *estate, TupleTableSlot *slot)
 	}
 }
 
+/*
+ * Insert the tuples represented in the slots to the relation as one batch,
+ * then update the indexes and execute constraints and per-row triggers for
+ * each of them.
+ *
+ * Batched counterpart of ExecSimpleRelationInsert(), only usable when the
+ * relation has no BEFORE ROW INSERT triggers, as those could change or skip
+ * the tuples.
+ *
+ * Caller is responsible for opening the indexes.
+ */
+void
+ExecSimpleRelationMultiInsert(EState *estate, TupleTableSlot **slots,
+							  int nslots)
+{
+	ResultRelInfo *resultRelInfo = estate->es_result_relation_info;
+	Relation	rel = resultRelInfo->ri_RelationDesc;
+	int			i;
+
+	/* For now we support only tables. */
+	Assert(rel->rd_rel->relkind == RELKIND_RELATION);
+	Assert(resultRelInfo->ri_TrigDesc == NULL ||
+		   !resultRelInfo->ri_TrigDesc->trig_insert_before_row);
+
+	CheckCmdReplicaIdentity(rel, CMD_INSERT);
+
+	for (i = 0; i < nslots; i++)
+	{
+		/* Compute stored generated columns */
+		if (rel->rd_att->constr &&
+			rel->rd_att->constr->has_generated_stored)
+			ExecComputeStoredGenerated(estate, slots[i]);
+
+		/* Check the constraints of the tuple */
+		if (rel->rd_att->constr)
+			ExecConstraints(resultRelInfo, slots[i], estate);
+		if (resultRelInfo->ri_PartitionCheck)
+			ExecPartitionCheck(resultRelInfo, slots[i], estate, true);
+	}
+
+	/* OK, store the tuples and create index entries for them */
+	table_multi_insert(rel, slots, nslots, GetCurrentCommandId(true), 0, NULL);
+
+	for (i = 0; i < nslots; i++)
+	{
+		List	   *recheckIndexes = NIL;
+
+		if (resultRelInfo->ri_NumIndices > 0)
+			recheckIndexes = ExecInsertIndexTuples(slots[i], estate, false,
+												   NULL, NIL);
+
+		/* AFTER ROW INSERT Triggers */
+		ExecARInsertTriggers(estate, resultRelInfo, slots[i],
+							 recheckIndexes, NULL);
+
+		list_free(recheckIndexes);
+	}
+}
+
 /*
  * Find the searchslot tuple and update it with data in the slot,
  * update the indexes, and execute any constraints and per-row triggers.
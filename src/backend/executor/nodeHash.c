@@ -35,9 +35,11 @@
 #include "executor/nodeHash.h"
 #include "executor/nodeHashjoin.h"
 #include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
 #include "pgstat.h"
 #include "port/atomics.h"
 #include "port/pg_bitutils.h"
+#include "utils/datum.h"
 #include "utils/dynahash.h"
 #include "utils/memutils.h"
 #include "utils/lsyscache.h"
@@ -55,6 +57,9 @@ static void ExecHashSkewTableInsert(HashJoinTable hashtable,
 									uint32 hashvalue,
 									int bucketNumber);
 static void ExecHashRemoveNextSkewBucket(HashJoinTable hashtable);
+static void ExecHashResetPruneKeys(HashState *node);
+static void ExecHashCollectPruneKeys(HashState *node, ExprContext *econtext);
+static void ExecHashPublishPruneKeys(HashState *node);
 
 static void *dense_alloc(HashJoinTable hashtable, Size size);
 static HashJoinTuple ExecParallelHashTupleAlloc(HashJoinTable hashtable,
@@ -114,6 +119,10 @@ MultiExecHash(HashState *node)
 	else
 		MultiExecPrivateHash(node);
 
+	/* let the outer side of the join know which partitions it can skip */
+	if (node->nprunekeys > 0)
+		ExecHashPublishPruneKeys(node);
+
 	/* must provide our own instrumentation support */
 	if (node->ps.instrument)
 		InstrStopNode(node->ps.instrument, node->hashtable->partialTuples);
@@ -157,6 +166,9 @@ MultiExecPrivateHash(HashState *node)
 	hashkeys = node->hashkeys;
 	econtext = node->ps.ps_ExprContext;
 
+	if (node->nprunekeys > 0)
+		ExecHashResetPruneKeys(node);
+
 	/*
 	 * Get all tuples from the node below the Hash node and insert into the
 	 * hash table (or temp files).
@@ -174,6 +186,9 @@ MultiExecPrivateHash(HashState *node)
 		{
 			int			bucketNumber;
 
+			if (node->nprunekeys > 0)
+				ExecHashCollectPruneKeys(node, econtext);
+
 			bucketNumber = ExecHashGetSkewBucket(hashtable, hashvalue);
 			if (bucketNumber != INVALID_SKEW_BUCKET_NO)
 			{
@@ -394,6 +409,49 @@ ExecInitHash(Hash *node, EState *estate, int eflags)
 	hashstate->hashkeys =
 		ExecInitExprList(node->hashkeys, (PlanState *) hashstate);
 
+	/*
+	 * Set up to collect the range of the keys that the outer side of the
+	 * join can use for partition pruning, if any.  The planner only asks for
+	 * that when the hash table is private to this process.
+	 */
+	hashstate->nprunekeys = list_length(node->prunekeyidx);
+	if (hashstate->nprunekeys > 0)
+	{
+		ListCell   *lc1,
+				   *lc2,
+				   *lc3;
+		int			i = 0;
+
+		Assert(!node->plan.parallel_aware);
+		Assert(list_length(node->pruneparams) == 2 * hashstate->nprunekeys);
+
+		hashstate->prunekeys = (HashPruneKeyState *)
+			palloc0(hashstate->nprunekeys * sizeof(HashPruneKeyState));
+
+		forthree(lc1, node->prunekeyidx,
+				 lc2, node->prunecmpfuncs,
+				 lc3, node->prunecollations)
+		{
+			HashPruneKeyState *pk = &hashstate->prunekeys[i];
+			int			keyidx = lfirst_int(lc1);
+
+			pk->key = (ExprState *) list_nth(hashstate->hashkeys, keyidx);
+			fmgr_info(lfirst_oid(lc2), &pk->cmpfn);
+			pk->collation = lfirst_oid(lc3);
+			get_typlenbyval(exprType((Node *) list_nth(node->hashkeys, keyidx)),
+							&pk->typlen, &pk->typbyval);
+			pk->minparam = list_nth_int(node->pruneparams, 2 * i);
+			pk->maxparam = list_nth_int(node->pruneparams, 2 * i + 1);
+			pk->found = false;
+
+			hashstate->pruneparamids =
+				bms_add_member(hashstate->pruneparamids, pk->minparam);
+			hashstate->pruneparamids =
+				bms_add_member(hashstate->pruneparamids, pk->maxparam);
+			i++;
+		}
+	}
+
 	return hashstate;
 }
 
@@ -2202,6 +2260,105 @@ ExecReScanHash(HashState *node)
 		ExecReScan(node->ps.lefttree);
 }
 
+/*
+ * ExecHashResetPruneKeys
+ *
+ *		Forget the key ranges collected by a previous build of the hash table.
+ */
+static void
+ExecHashResetPruneKeys(HashState *node)
+{
+	int			i;
+
+	for (i = 0; i < node->nprunekeys; i++)
+	{
+		HashPruneKeyState *pk = &node->prunekeys[i];
+
+		if (pk->found && !pk->typbyval)
+		{
+			pfree(DatumGetPointer(pk->min));
+			pfree(DatumGetPointer(pk->max));
+		}
+		pk->found = false;
+	}
+}
+
+/*
+ * ExecHashCollectPruneKeys
+ *
+ *		Widen the collected key ranges to cover the tuple being inserted in
+ *		the hash table.  Null keys are ignored, since they can't match any
+ *		outer tuple.
+ */
+static void
+ExecHashCollectPruneKeys(HashState *node, ExprContext *econtext)
+{
+	int			i;
+
+	for (i = 0; i < node->nprunekeys; i++)
+	{
+		HashPruneKeyState *pk = &node->prunekeys[i];
+		MemoryContext oldContext;
+		Datum		value;
+		bool		isNull;
+
+		oldContext = MemoryContextSwitchTo(econtext->ecxt_per_tuple_memory);
+		value = ExecEvalExpr(pk->key, econtext, &isNull);
+		MemoryContextSwitchTo(oldContext);
+
+		if (isNull)
+			continue;
+
+		if (!pk->found)
+		{
+			pk->min = datumCopy(value, pk->typbyval, pk->typlen);
+			pk->max = datumCopy(value, pk->typbyval, pk->typlen);
+			pk->found = true;
+		}
+		else if (DatumGetInt32(FunctionCall2Coll(&pk->cmpfn, pk->collation,
+												 value, pk->min)) < 0)
+		{
+			if (!pk->typbyval)
+				pfree(DatumGetPointer(pk->min));
+			pk->min = datumCopy(value, pk->typbyval, pk->typlen);
+		}
+		else if (DatumGetInt32(FunctionCall2Coll(&pk->cmpfn, pk->collation,
+												 value, pk->max)) > 0)
+		{
+			if (!pk->typbyval)
+				pfree(DatumGetPointer(pk->max));
+			pk->max = datumCopy(value, pk->typbyval, pk->typlen);
+		}
+	}
+}
+
+/*
+ * ExecHashPublishPruneKeys
+ *
+ *		Store the collected key ranges in their PARAM_EXEC params, where the
+ *		outer side's Append finds them when it first decides which of its
+ *		subplans to run.  A key with no non-null value gets null params, so
+ *		that all the partitions are pruned.
+ */
+static void
+ExecHashPublishPruneKeys(HashState *node)
+{
+	ParamExecData *params = node->ps.state->es_param_exec_vals;
+	int			i;
+
+	for (i = 0; i < node->nprunekeys; i++)
+	{
+		HashPruneKeyState *pk = &node->prunekeys[i];
+
+		params[pk->minparam].execPlan = NULL;
+		params[pk->minparam].value = pk->min;
+		params[pk->minparam].isnull = !pk->found;
+		params[pk->maxparam].execPlan = NULL;
+		params[pk->maxparam].value = pk->max;
+		params[pk->maxparam].isnull = !pk->found;
+	}
+}
+
 
 /*
  * ExecHashBuildSkewHash
@@ -255,6 +255,14 @@ ExecHashJoinImpl(PlanState *pstate, bool parallel)
 					 */
 					node->hj_FirstOuterTupleSlot = NULL;
 				}
+				else if (hashNode->nprunekeys > 0)
+				{
+					/*
+					 * The outer relation can't be started before the hash
+					 * table has told it which of its partitions to skip.
+					 */
+					node->hj_FirstOuterTupleSlot = NULL;
+				}
 				else if (HJ_FILL_OUTER(node) ||
 						 (outerNode->plan->startup_cost < hashNode->ps.plan->total_cost &&
 						  !node->hj_OuterNotEmpty))
@@ -1338,6 +1346,17 @@ ExecReScanHashJoin(HashJoinState *node)
 			node->hj_HashTable = NULL;
 			node->hj_JoinState = HJ_BUILD_HASHTABLE;
 
+			/*
+			 * The rebuilt hash table will set new pruning params for the
+			 * outer side, so make it redo its partition pruning.  It will
+			 * then be re-scanned by its first ExecProcNode, which happens
+			 * after the hash table is built.
+			 */
+			if (hashNode->pruneparamids != NULL)
+				node->js.ps.lefttree->chgParam =
+					bms_add_members(node->js.ps.lefttree->chgParam,
+									hashNode->pruneparamids);
+
 			/*
 			 * if chgParam of subnode is not null then plan will be re-scanned
 			 * by first ExecProcNode.
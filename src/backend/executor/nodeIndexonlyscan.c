@@ -46,10 +46,42 @@
 
 
 static TupleTableSlot *IndexOnlyNext(IndexOnlyScanState *node);
+static inline Buffer *IndexOnlyVMBuffer(IndexOnlyScanState *node,
+										BlockNumber heapBlk);
 static void StoreIndexTuple(TupleTableSlot *slot, IndexTuple itup,
 							TupleDesc itupdesc);
 
 
+/*
+ * Maximum number of visibility map pages an index-only scan keeps pinned.
+ * Each map page covers about 250MB of heap (with 8kB blocks), so this is
+ * enough to cover quite large tables without repinning.
+ */
+#define IOSS_MAX_VM_BUFFERS		16
+
+/* ----------------------------------------------------------------
+ *		IndexOnlyVMBuffer
+ *
+ *		Returns the VM buffer slot to use when testing heapBlk.
+ *
+ *		Index order is generally unrelated to heap order, so with a single
+ *		VM buffer a scan of a large table keeps dropping one map page and
+ *		pinning another, and in a parallel scan every worker does the same
+ *		to the same few buffer headers.  Instead we keep a small
+ *		direct-mapped array of pinned map pages, indexed by map block
+ *		number.  The bits are still read from the shared map page on every
+ *		test (see the notes on memory ordering in IndexOnlyNext), only the
+ *		pin is reused.
+ * ----------------------------------------------------------------
+ */
+static inline Buffer *
+IndexOnlyVMBuffer(IndexOnlyScanState *node, BlockNumber heapBlk)
+{
+	BlockNumber mapBlock = visibilitymap_mapblock(heapBlk);
+
+	return &node->ioss_VMBuffers[mapBlock % node->ioss_NumVMBuffers];
+}
+
 /* ----------------------------------------------------------------
  *		IndexOnlyNext
  *
@@ -101,7 +133,6 @@ IndexOnlyNext(IndexOnlyScanState *node)
 
 		/* Set it up for index-only scan */
 		node->ioss_ScanDesc->xs_want_itup = true;
-		node->ioss_VMBuffer = InvalidBuffer;
 
 		/*
 		 * If no run-time keys to calculate or they are ready, go ahead and
@@ -160,7 +191,8 @@ IndexOnlyNext(IndexOnlyScanState *node)
 		 */
 		if (!VM_ALL_VISIBLE(scandesc->heapRelation,
 							ItemPointerGetBlockNumber(tid),
-							&node->ioss_VMBuffer))
+							IndexOnlyVMBuffer(node,
+											  ItemPointerGetBlockNumber(tid))))
 		{
 			/*
 			 * Rats, we have to visit the heap to check visibility.
@@ -377,11 +409,14 @@ ExecEndIndexOnlyScan(IndexOnlyScanState *node)
 	indexRelationDesc = node->ioss_RelationDesc;
 	indexScanDesc = node->ioss_ScanDesc;
 
-	/* Release VM buffer pin, if any. */
-	if (node->ioss_VMBuffer != InvalidBuffer)
+	/* Release VM buffer pins, if any. */
+	for (int i = 0; i < node->ioss_NumVMBuffers; i++)
 	{
-		ReleaseBuffer(node->ioss_VMBuffer);
-		node->ioss_VMBuffer = InvalidBuffer;
+		if (node->ioss_VMBuffers[i] != InvalidBuffer)
+		{
+			ReleaseBuffer(node->ioss_VMBuffers[i]);
+			node->ioss_VMBuffers[i] = InvalidBuffer;
+		}
 	}
 
 	/*
@@ -540,6 +575,21 @@ ExecInitIndexOnlyScan(IndexOnlyScan *node, EState *estate, int eflags)
 						   RelationGetDescr(currentRelation),
 						   table_slot_callbacks(currentRelation));
 
+	/*
+	 * Set up the VM buffer slots, sized from the table's estimated size so
+	 * that small tables don't pay for slots they will never use.  Don't let a
+	 * single scan pin a meaningful fraction of a tiny buffer pool, though.
+	 */
+	indexstate->ioss_NumVMBuffers =
+		Min(visibilitymap_mapblock(currentRelation->rd_rel->relpages) + 1,
+			IOSS_MAX_VM_BUFFERS);
+	indexstate->ioss_NumVMBuffers =
+		Max(Min(indexstate->ioss_NumVMBuffers, NBuffers / 64), 1);
+	indexstate->ioss_VMBuffers = (Buffer *)
+		palloc(indexstate->ioss_NumVMBuffers * sizeof(Buffer));
+	for (int i = 0; i < indexstate->ioss_NumVMBuffers; i++)
+		indexstate->ioss_VMBuffers[i] = InvalidBuffer;
+
 	/*
 	 * Initialize result type and projection info.  The node's targetlist will
 	 * contain Vars with varno = INDEX_VAR, referencing the scan tuple.
@@ -680,7 +730,6 @@ ExecIndexOnlyScanInitializeDSM(IndexOnlyScanState *node,
 								 node->ioss_NumOrderByKeys,
 								 piscan);
 	node->ioss_ScanDesc->xs_want_itup = true;
-	node->ioss_VMBuffer = InvalidBuffer;
 
 	/*
 	 * If no run-time keys to calculate or they are ready, go ahead and pass
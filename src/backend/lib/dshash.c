@@ -17,8 +17,10 @@
  * is only expected to happen a small number of times until a stable size is
  * found, since growth is geometric.
  *
- * Future versions may support iterators and incremental resizing; for now
- * the implementation is minimalist.
+ * Sequential scans hold one partition lock at a time, taking them in the same
+ * order as a resize, so the table can't be resized under a scan.  Future
+ * versions may support incremental resizing; for now the implementation is
+ * minimalist.
  *
  * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -384,36 +386,8 @@ dshash_get_hash_table_handle(dshash_table *hash_table)
 void *
 dshash_find(dshash_table *hash_table, const void *key, bool exclusive)
 {
-	dshash_hash hash;
-	size_t		partition;
-	dshash_table_item *item;
-
-	hash = hash_key(hash_table, key);
-	partition = PARTITION_FOR_HASH(hash);
-
-	Assert(hash_table->control->magic == DSHASH_MAGIC);
-	Assert(!hash_table->find_locked);
-
-	LWLockAcquire(PARTITION_LOCK(hash_table, partition),
-				  exclusive ? LW_EXCLUSIVE : LW_SHARED);
-	ensure_valid_bucket_pointers(hash_table);
-
-	/* Search the active bucket. */
-	item = find_in_bucket(hash_table, key, BUCKET_FOR_HASH(hash_table, hash));
-
-	if (!item)
-	{
-		/* Not found. */
-		LWLockRelease(PARTITION_LOCK(hash_table, partition));
-		return NULL;
-	}
-	else
-	{
-		/* The caller will free the lock by calling dshash_release. */
-		hash_table->find_locked = true;
-		hash_table->find_exclusively_locked = exclusive;
-		return ENTRY_FROM_ITEM(item);
-	}
+	return dshash_find_extended(hash_table, key, exclusive, false, false,
+								NULL);
 }
 
 /*
@@ -430,33 +404,68 @@ void *
 dshash_find_or_insert(dshash_table *hash_table,
 					  const void *key,
 					  bool *found)
+{
+	return dshash_find_extended(hash_table, key, true, false, true, found);
+}
+
+/*
+ * Find an entry, optionally creating it, without necessarily waiting for the
+ * partition lock.
+ *
+ * This is the common code behind dshash_find() and dshash_find_or_insert().
+ * If 'insert' is true, a missing entry is created, '*found' reports whether
+ * it already existed, and the lock taken is always exclusive.  If 'nowait' is
+ * true and the partition lock cannot be acquired immediately, NULL is
+ * returned and nothing is locked; '*found' is then set to false.  Note that
+ * an insertion may still have to wait if it triggers a resize of the table.
+ */
+void *
+dshash_find_extended(dshash_table *hash_table, const void *key,
+					 bool exclusive, bool nowait, bool insert, bool *found)
 {
 	dshash_hash hash;
 	size_t		partition_index;
 	dshash_partition *partition;
 	dshash_table_item *item;
+	LWLockMode	lockmode;
 
 	hash = hash_key(hash_table, key);
 	partition_index = PARTITION_FOR_HASH(hash);
 	partition = &hash_table->control->partitions[partition_index];
+	lockmode = (exclusive || insert) ? LW_EXCLUSIVE : LW_SHARED;
 
 	Assert(hash_table->control->magic == DSHASH_MAGIC);
 	Assert(!hash_table->find_locked);
+	Assert(!insert || found != NULL);
+
+	if (found)
+		*found = false;
 
 restart:
-	LWLockAcquire(PARTITION_LOCK(hash_table, partition_index),
-				  LW_EXCLUSIVE);
+	if (!nowait)
+		LWLockAcquire(PARTITION_LOCK(hash_table, partition_index), lockmode);
+	else if (!LWLockConditionalAcquire(PARTITION_LOCK(hash_table,
+													  partition_index),
+									   lockmode))
+		return NULL;
 	ensure_valid_bucket_pointers(hash_table);
 
 	/* Search the active bucket. */
 	item = find_in_bucket(hash_table, key, BUCKET_FOR_HASH(hash_table, hash));
 
 	if (item)
-		*found = true;
+	{
+		if (found)
+			*found = true;
+	}
+	else if (!insert)
+	{
+		/* Not found. */
+		LWLockRelease(PARTITION_LOCK(hash_table, partition_index));
+		return NULL;
+	}
 	else
 	{
-		*found = false;
-
 		/* Check if we are getting too full. */
 		if (partition->count > MAX_COUNT_PER_PARTITION(hash_table))
 		{
@@ -487,7 +496,7 @@ restart:
 
 	/* The caller must release the lock with dshash_release_lock. */
 	hash_table->find_locked = true;
-	hash_table->find_exclusively_locked = true;
+	hash_table->find_exclusively_locked = (lockmode == LW_EXCLUSIVE);
 	return ENTRY_FROM_ITEM(item);
 }
 
@@ -574,6 +583,137 @@ dshash_release_lock(dshash_table *hash_table, void *entry)
 	LWLockRelease(PARTITION_LOCK(hash_table, partition_index));
 }
 
+/*
+ * Initialize a sequential scan over the whole hash table.
+ *
+ * The scan holds at most one partition lock at a time, in the mode given by
+ * 'exclusive', and moves from one partition to the next in the same order as
+ * resize() acquires them, so the table can't be resized under the scan.  Keys
+ * inserted or deleted by other backends while the scan is in progress may or
+ * may not be returned.  The scan must be finished with dshash_seq_term, even
+ * if it's abandoned before dshash_seq_next returns NULL.
+ */
+void
+dshash_seq_init(dshash_seq_status *status, dshash_table *hash_table,
+				bool exclusive)
+{
+	status->hash_table = hash_table;
+	status->curbucket = 0;
+	status->nbuckets = 0;
+	status->curitem = NULL;
+	status->pnextitem = InvalidDsaPointer;
+	status->curpartition = -1;
+	status->exclusive = exclusive;
+}
+
+/*
+ * Return the next entry of a sequential scan, or NULL at the end.  The
+ * returned entry is locked along with the rest of its partition until the
+ * next call.
+ */
+void *
+dshash_seq_next(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	dsa_pointer next_item_pointer;
+
+	if (status->curpartition < 0)
+	{
+		int			partition;
+
+		Assert(status->curbucket == 0);
+		Assert(!hash_table->find_locked);
+
+		/* First call: lock the first partition and start from bucket 0. */
+		partition = 0;
+		LWLockAcquire(PARTITION_LOCK(hash_table, partition),
+					  status->exclusive ? LW_EXCLUSIVE : LW_SHARED);
+		status->curpartition = partition;
+
+		/* The table can't be resized until the scan ends. */
+		ensure_valid_bucket_pointers(hash_table);
+		status->nbuckets = ((size_t) 1) << hash_table->size_log2;
+
+		next_item_pointer = hash_table->buckets[status->curbucket];
+	}
+	else
+		next_item_pointer = status->pnextitem;
+
+	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table,
+											   status->curpartition),
+								status->exclusive ? LW_EXCLUSIVE : LW_SHARED));
+
+	/* Move on to the next non-empty bucket if this one is exhausted. */
+	while (!DsaPointerIsValid(next_item_pointer))
+	{
+		int			next_partition;
+
+		if (++status->curbucket >= status->nbuckets)
+		{
+			/* All buckets have been scanned. */
+			status->curitem = NULL;
+			return NULL;
+		}
+
+		next_partition = status->curbucket >>
+			NUM_SPLITS(hash_table->size_log2);
+		if (next_partition != status->curpartition)
+		{
+			/*
+			 * Lock the next partition before releasing the current one, so
+			 * that a resize can't slip in between.  This is the same order
+			 * resize() uses, so we can't deadlock against it.
+			 */
+			LWLockAcquire(PARTITION_LOCK(hash_table, next_partition),
+						  status->exclusive ? LW_EXCLUSIVE : LW_SHARED);
+			LWLockRelease(PARTITION_LOCK(hash_table, status->curpartition));
+			status->curpartition = next_partition;
+		}
+
+		next_item_pointer = hash_table->buckets[status->curbucket];
+	}
+
+	status->curitem = dsa_get_address(hash_table->area, next_item_pointer);
+
+	/* Remember the next item in case the caller deletes this one. */
+	status->pnextitem = status->curitem->next;
+
+	return ENTRY_FROM_ITEM(status->curitem);
+}
+
+/*
+ * Finish a sequential scan, releasing the partition lock it holds.
+ */
+void
+dshash_seq_term(dshash_seq_status *status)
+{
+	if (status->curpartition >= 0)
+		LWLockRelease(PARTITION_LOCK(status->hash_table,
+									 status->curpartition));
+	status->curpartition = -1;
+}
+
+/*
+ * Delete the entry most recently returned by dshash_seq_next.  The scan must
+ * have been started in exclusive mode.
+ */
+void
+dshash_delete_current(dshash_seq_status *status)
+{
+	dshash_table *hash_table = status->hash_table;
+	dshash_table_item *item = status->curitem;
+
+	Assert(status->exclusive);
+	Assert(item != NULL);
+	Assert(hash_table->control->magic == DSHASH_MAGIC);
+	Assert(LWLockHeldByMeInMode(PARTITION_LOCK(hash_table,
+											   PARTITION_FOR_HASH(item->hash)),
+								LW_EXCLUSIVE));
+
+	delete_item(hash_table, item);
+	status->curitem = NULL;
+}
+
 /*
  * A compare function that forwards to memcmp.
  */
@@ -381,6 +381,29 @@ ClientAuthentication(Port *port)
 					 errmsg("connection requires a valid client certificate")));
 	}
 
+	/*
+	 * A connection proxy connects over the Unix-domain socket as the server's
+	 * own OS user, so methods that ask the operating system who the client
+	 * is can't work through it.  If the proxy has authenticated the client
+	 * already, there's nothing more to do, unless the configuration has been
+	 * changed to reject the connection in the meantime.
+	 */
+	if (port->proxied)
+	{
+		if (port->hba->auth_method == uaPeer ||
+			port->hba->auth_method == uaIdent)
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_AUTHORIZATION_SPECIFICATION),
+					 errmsg("%s authentication is not supported through a connection proxy",
+							port->hba->auth_method == uaPeer ? "peer" : "ident")));
+
+		if (port->proxy_preauth && port->hba->auth_method != uaReject)
+		{
+			sendAuthRequest(port, AUTH_REQ_OK, NULL, 0);
+			return;
+		}
+	}
+
 	/*
 	 * Now proceed to do the actual authentication check
 	 */
@@ -35,6 +35,7 @@
 #include "optimizer/cost.h"
 #include "optimizer/geqo.h"
 #include "optimizer/inherit.h"
+#include "optimizer/joininfo.h"
 #include "optimizer/optimizer.h"
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
@@ -48,6 +49,7 @@
 #include "partitioning/partprune.h"
 #include "rewrite/rewriteManip.h"
 #include "utils/lsyscache.h"
+#include "utils/memutils.h"
 
 
 /* results of subquery_is_pushdown_safe */
@@ -61,6 +63,8 @@ typedef struct pushdown_safety_info
 /* These parameters are set by GUC */
 bool		enable_geqo = false;	/* just in case GUC doesn't set it */
 int			geqo_threshold;
+bool		enable_dpccp = false;
+int			greedy_join_threshold = 0;
 int			min_parallel_table_scan_size;
 int			min_parallel_index_scan_size;
 
@@ -125,6 +129,9 @@ static void set_result_pathlist(PlannerInfo *root, RelOptInfo *rel,
 static void set_worktable_pathlist(PlannerInfo *root, RelOptInfo *rel,
 								   RangeTblEntry *rte);
 static RelOptInfo *make_rel_from_joinlist(PlannerInfo *root, List *joinlist);
+static bool greedy_evaluate_join(PlannerInfo *root,
+								 RelOptInfo *rel1, RelOptInfo *rel2,
+								 double *rows, Cost *cost);
 static bool subquery_is_pushdown_safe(Query *subquery, Query *topquery,
 									  pushdown_safety_info *safetyInfo);
 static bool recurse_pushdown_safe(Node *setOp, Query *topquery,
@@ -2800,7 +2807,8 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 	{
 		/*
 		 * Consider the different orders in which we could join the rels,
-		 * using a plugin, GEQO, or the regular join search code.
+		 * using a plugin, the greedy search, GEQO, or the regular join search
+		 * code.
 		 *
 		 * We put the initial_rels list into a PlannerInfo field because
 		 * has_legal_joinclause() needs to look at it (ugly :-().
@@ -2809,6 +2817,9 @@ make_rel_from_joinlist(PlannerInfo *root, List *joinlist)
 
 		if (join_search_hook)
 			return (*join_search_hook) (root, levels_needed, initial_rels);
+		else if (greedy_join_threshold > 0 &&
+				 levels_needed >= greedy_join_threshold)
+			return greedy_join_search(root, levels_needed, initial_rels);
 		else if (enable_geqo && levels_needed >= geqo_threshold)
 			return geqo(root, levels_needed, initial_rels);
 		else
@@ -2850,6 +2861,9 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 {
 	int			lev;
 	RelOptInfo *rel;
+	DPccpState *dpccp = NULL;
+	int			savelength = 0;
+	struct HTAB *savehash = NULL;
 
 	/*
 	 * This function cannot be invoked recursively within any one planning
@@ -2857,6 +2871,25 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 	 */
 	Assert(root->join_rel_level == NULL);
 
+	/*
+	 * If enable_dpccp is set, generate the pairs of rels to join by
+	 * enumerating the connected subgraphs of the join graph, rather than by
+	 * looking at all pairs of rels at each level.  That doesn't always work,
+	 * since the graph only approximates the legal join orders; if we end up
+	 * without a final rel, we throw away the joinrels made so far and redo
+	 * the search the usual way, much as geqo_eval() does.
+	 */
+	if (enable_dpccp)
+		dpccp = dpccp_prepare(root, levels_needed, initial_rels);
+	if (dpccp != NULL)
+	{
+		savelength = list_length(root->join_rel_list);
+		savehash = root->join_rel_hash;
+		root->join_rel_hash = NULL;
+	}
+
+retry:
+
 	/*
 	 * We employ a simple "dynamic programming" algorithm: we first find all
 	 * ways to build joins of two jointree items, then all ways to build joins
@@ -2881,7 +2914,10 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 		 * level, and build paths for making each one from every available
 		 * pair of lower-level relations.
 		 */
-		join_search_one_level(root, lev);
+		if (dpccp != NULL)
+			dpccp_join_search_one_level(root, dpccp, lev);
+		else
+			join_search_one_level(root, lev);
 
 		/*
 		 * Run generate_partitionwise_join_paths() and generate_gather_paths()
@@ -2916,6 +2952,14 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 		}
 	}
 
+	if (dpccp != NULL && root->join_rel_level[levels_needed] == NIL)
+	{
+		root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+		root->join_rel_hash = savehash;
+		dpccp = NULL;
+		goto retry;
+	}
+
 	/*
 	 * We should have a single rel at the final level.
 	 */
@@ -2930,6 +2974,201 @@ standard_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
 	return rel;
 }
 
+/*
+ * greedy_join_search
+ *	  Find a join order for a large join problem by repeatedly joining the
+ *	  pair of rels with the smallest result.
+ *
+ * The dynamic-programming search is exponential in the number of rels, and
+ * GEQO's random search can come up with different plans for the same query
+ * from one planning to the next.  For join problems of greedy_join_threshold
+ * or more rels, we use this deterministic heuristic instead: starting from
+ * the initial rels, we consider each pair of rels linked by a join clause or
+ * a join order restriction, and join the legal pair whose joinrel has the
+ * fewest estimated rows (and then the cheapest path), until a single rel
+ * remains.  Cartesian products are considered only when no other legal join
+ * is left.  This is Fegaras' Greedy Operator Ordering.
+ *
+ * The arguments and result are as for standard_join_search().
+ */
+RelOptInfo *
+greedy_join_search(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	RelOptInfo **rels;
+	bool	   *evaluated;
+	bool	   *legal;
+	double	   *rows;
+	Cost	   *costs;
+	int			nremaining;
+	int			n = levels_needed;
+	int			i;
+	ListCell   *lc;
+
+	/* Like standard_join_search(), we don't use join_rel_level[] */
+	Assert(root->join_rel_level == NULL);
+
+	rels = (RelOptInfo **) palloc(n * sizeof(RelOptInfo *));
+	i = 0;
+	foreach(lc, initial_rels)
+		rels[i++] = (RelOptInfo *) lfirst(lc);
+
+	/* Cache of the estimates for each pair of rels, indexed by i * n + j */
+	evaluated = (bool *) palloc0(n * n * sizeof(bool));
+	legal = (bool *) palloc(n * n * sizeof(bool));
+	rows = (double *) palloc(n * n * sizeof(double));
+	costs = (Cost *) palloc(n * n * sizeof(Cost));
+
+	for (nremaining = n; nremaining > 1; nremaining--)
+	{
+		int			best_i = -1;
+		int			best_j = -1;
+		bool		force;
+		RelOptInfo *joinrel;
+
+		/*
+		 * Look for the best join of connected rels first; if there's none,
+		 * try again allowing cartesian products.
+		 */
+		for (force = false;; force = true)
+		{
+			for (i = 0; i < n; i++)
+			{
+				int			j;
+
+				if (rels[i] == NULL)
+					continue;
+
+				for (j = i + 1; j < n; j++)
+				{
+					int			k = i * n + j;
+
+					if (rels[j] == NULL)
+						continue;
+
+					if (!force &&
+						!have_relevant_joinclause(root, rels[i], rels[j]) &&
+						!have_join_order_restriction(root, rels[i], rels[j]))
+						continue;
+
+					if (!evaluated[k])
+					{
+						legal[k] = greedy_evaluate_join(root, rels[i], rels[j],
+														&rows[k], &costs[k]);
+						evaluated[k] = true;
+					}
+
+					if (!legal[k])
+						continue;
+
+					if (best_i < 0 ||
+						rows[k] < rows[best_i * n + best_j] ||
+						(rows[k] == rows[best_i * n + best_j] &&
+						 costs[k] < costs[best_i * n + best_j]))
+					{
+						best_i = i;
+						best_j = j;
+					}
+				}
+			}
+
+			if (best_i >= 0 || force)
+				break;
+		}
+
+		if (best_i < 0)
+			elog(ERROR, "failed to join all relations together");
+
+		/* Make the chosen join for real */
+		joinrel = make_join_rel(root, rels[best_i], rels[best_j]);
+		Assert(joinrel != NULL);
+
+		/* Create paths for partitionwise joins. */
+		generate_partitionwise_join_paths(root, joinrel);
+
+		/*
+		 * Except for the topmost scan/join rel, consider gathering partial
+		 * paths.  We'll do the same for the topmost scan/join rel once we
+		 * know the final targetlist (see grouping_planner).
+		 */
+		if (nremaining > 2)
+			generate_gather_paths(root, joinrel, false);
+
+		/* Find and save the cheapest paths for this rel */
+		set_cheapest(joinrel);
+
+#ifdef OPTIMIZER_DEBUG
+		debug_print_rel(root, joinrel);
+#endif
+
+		/* The joinrel replaces the first rel; forget its old estimates */
+		rels[best_i] = joinrel;
+		rels[best_j] = NULL;
+		for (i = 0; i < n; i++)
+		{
+			evaluated[i * n + best_i] = false;
+			evaluated[best_i * n + i] = false;
+		}
+	}
+
+	for (i = 0; i < n; i++)
+	{
+		if (rels[i] != NULL)
+			return rels[i];
+	}
+
+	return NULL;				/* keep compiler quiet */
+}
+
+/*
+ * greedy_evaluate_join
+ *	  Estimate the size and cost of joining rel1 and rel2, for
+ *	  greedy_join_search().
+ *
+ * Returns false if the join is not legal.  The joinrel is built in a
+ * temporary memory context and then thrown away, as in geqo_eval().
+ */
+static bool
+greedy_evaluate_join(PlannerInfo *root, RelOptInfo *rel1, RelOptInfo *rel2,
+					 double *rows, Cost *cost)
+{
+	MemoryContext mycontext;
+	MemoryContext oldcxt;
+	RelOptInfo *joinrel;
+	int			savelength;
+	struct HTAB *savehash;
+	bool		result = false;
+
+	mycontext = AllocSetContextCreate(CurrentMemoryContext,
+									  "Greedy join search",
+									  ALLOCSET_DEFAULT_SIZES);
+	oldcxt = MemoryContextSwitchTo(mycontext);
+
+	/*
+	 * make_join_rel will add entries to root->join_rel_list and maybe
+	 * root->join_rel_hash; see geqo_eval() for why we handle them this way.
+	 */
+	savelength = list_length(root->join_rel_list);
+	savehash = root->join_rel_hash;
+	root->join_rel_hash = NULL;
+
+	joinrel = make_join_rel(root, rel1, rel2);
+	if (joinrel != NULL && joinrel->pathlist != NIL)
+	{
+		set_cheapest(joinrel);
+		*rows = joinrel->rows;
+		*cost = joinrel->cheapest_total_path->total_cost;
+		result = true;
+	}
+
+	root->join_rel_list = list_truncate(root->join_rel_list, savelength);
+	root->join_rel_hash = savehash;
+
+	MemoryContextSwitchTo(oldcxt);
+	MemoryContextDelete(mycontext);
+
+	return result;
+}
+
 /*****************************************************************************
  *			PUSHING QUALS DOWN INTO SUBQUERIES
  *****************************************************************************/
@@ -3892,6 +4131,10 @@ print_path(PlannerInfo *root, Path *path, int indent)
 			ptype = "Material";
 			subpath = ((MaterialPath *) path)->subpath;
 			break;
+		case T_ResultCachePath:
+			ptype = "ResultCache";
+			subpath = ((ResultCachePath *) path)->subpath;
+			break;
 		case T_UniquePath:
 			ptype = "Unique";
 			subpath = ((UniquePath *) path)->subpath;
@@ -16,6 +16,7 @@
 
 #include "nodes/makefuncs.h"
 #include "nodes/nodeFuncs.h"
+#include "optimizer/cardfeedback.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
@@ -103,9 +104,19 @@ clauselist_selectivity(PlannerInfo *root,
 	 * Apply normal selectivity estimates for the remaining clauses, passing
 	 * 'estimatedclauses' so that it skips already estimated ones.
 	 */
-	return s1 * clauselist_selectivity_simple(root, clauses, varRelid,
-											  jointype, sjinfo,
-											  estimatedclauses);
+	s1 *= clauselist_selectivity_simple(root, clauses, varRelid,
+										jointype, sjinfo,
+										estimatedclauses);
+
+	/*
+	 * Finally, correct the estimate by what previous executions of the same
+	 * clauses have taught us, if anything.  This only makes sense when we
+	 * are looking at the clauses as a whole, as the executor sees them.
+	 */
+	if (enable_cardinality_feedback && varRelid == 0 && jointype == JOIN_INNER)
+		s1 = cardinality_feedback_adjust(root, clauses, s1);
+
+	return s1;
 }
 
 /*
@@ -20,6 +20,7 @@
 #include "optimizer/pathnode.h"
 #include "optimizer/paths.h"
 #include "partitioning/partbounds.h"
+#include "port/pg_bitutils.h"
 #include "utils/lsyscache.h"
 #include "utils/memutils.h"
 
@@ -324,6 +325,296 @@ make_rels_by_clauseless_joins(PlannerInfo *root,
 }
 
 
+/*
+ * State of a DPccp join search; see dpccp_prepare().
+ *
+ * Sets of initial rels are bitmaps of their positions in the initial_rels
+ * list.  The csg-cmp pairs are collected per level, that is by the number
+ * of initial rels they join together.
+ */
+struct DPccpState
+{
+	int			nrels;			/* number of initial rels */
+	RelOptInfo **rels;			/* the initial rels */
+	uint64	   *neighbors;		/* adjacency bitmap of each initial rel */
+	uint64	  **pairs;			/* per level: array of (set1, set2) pairs */
+	int		   *npairs;			/* per level: number of pairs */
+	int		   *maxpairs;		/* per level: allocated size of pairs */
+};
+
+#define DPCCP_BIT(i)	(UINT64CONST(1) << (i))
+/* the set of initial rels numbered 0 .. i */
+#define DPCCP_UPTO(i)	((i) >= 63 ? ~UINT64CONST(0) : DPCCP_BIT((i) + 1) - 1)
+
+static uint64 dpccp_neighborhood(DPccpState *state, uint64 set);
+static void dpccp_enumerate_csg_rec(DPccpState *state, uint64 set,
+									uint64 excluded, uint64 csg);
+static void dpccp_enumerate_cmp(DPccpState *state, uint64 csg);
+static void dpccp_add_pair(DPccpState *state, uint64 set1, uint64 set2);
+static RelOptInfo *dpccp_find_rel(PlannerInfo *root, DPccpState *state,
+								  uint64 set);
+
+/*
+ * dpccp_prepare
+ *	  Set up a join search by enumeration of connected subgraphs.
+ *
+ * The usual dynamic-programming search looks at every pair of rels of
+ * complementary levels to find those that are linked by a join clause, which
+ * is most of the planning time for big join problems, since most pairs are
+ * not.  Instead, we use the DPccp algorithm of Moerkotte and Neumann,
+ * "Analysis of Two Existing and One New Dynamic Programming Algorithm for
+ * the Generation of Optimal Bushy Join Trees without Cross Products" (VLDB
+ * 2006), to generate directly the pairs of connected sets of initial rels
+ * that are connected to each other, each pair exactly once.
+ *
+ * Two initial rels are connected if there's a join clause or join order
+ * restriction between them.  A clause mentioning three or more rels connects
+ * all of them with each other, which may create a few pairs that have to be
+ * joined without a usable clause, just as in the usual search.
+ *
+ * DPccp cannot make cartesian products, so we return NULL, and the caller
+ * has to do the usual search, if the initial rels are not all connected.
+ * We also return NULL if there are more than 64 of them.
+ */
+DPccpState *
+dpccp_prepare(PlannerInfo *root, int levels_needed, List *initial_rels)
+{
+	DPccpState *state;
+	ListCell   *lc;
+	uint64		reached;
+	uint64		frontier;
+	int			i,
+				j;
+
+	if (levels_needed > 64)
+		return NULL;
+
+	state = (DPccpState *) palloc0(sizeof(DPccpState));
+	state->nrels = levels_needed;
+	state->rels = (RelOptInfo **) palloc(levels_needed * sizeof(RelOptInfo *));
+	state->neighbors = (uint64 *) palloc0(levels_needed * sizeof(uint64));
+
+	i = 0;
+	foreach(lc, initial_rels)
+		state->rels[i++] = (RelOptInfo *) lfirst(lc);
+
+	for (i = 0; i < levels_needed; i++)
+	{
+		for (j = i + 1; j < levels_needed; j++)
+		{
+			if (have_relevant_joinclause(root, state->rels[i], state->rels[j]) ||
+				have_join_order_restriction(root, state->rels[i], state->rels[j]))
+			{
+				state->neighbors[i] |= DPCCP_BIT(j);
+				state->neighbors[j] |= DPCCP_BIT(i);
+			}
+		}
+	}
+
+	/* Check that the join graph is connected */
+	reached = DPCCP_BIT(0);
+	frontier = reached;
+	while (frontier != 0)
+	{
+		frontier = dpccp_neighborhood(state, reached) & ~reached;
+		reached |= frontier;
+	}
+	if (reached != DPCCP_UPTO(levels_needed - 1))
+	{
+		pfree(state->rels);
+		pfree(state->neighbors);
+		pfree(state);
+		return NULL;
+	}
+
+	/* Enumerate all the csg-cmp pairs up front */
+	state->pairs = (uint64 **) palloc0((levels_needed + 1) * sizeof(uint64 *));
+	state->npairs = (int *) palloc0((levels_needed + 1) * sizeof(int));
+	state->maxpairs = (int *) palloc0((levels_needed + 1) * sizeof(int));
+
+	for (i = levels_needed - 1; i >= 0; i--)
+	{
+		dpccp_enumerate_cmp(state, DPCCP_BIT(i));
+		dpccp_enumerate_csg_rec(state, DPCCP_BIT(i), DPCCP_UPTO(i), 0);
+	}
+
+	return state;
+}
+
+/*
+ * dpccp_join_search_one_level
+ *	  Like join_search_one_level(), but joins the csg-cmp pairs of 'level'
+ *	  initial rels found by dpccp_prepare().
+ */
+void
+dpccp_join_search_one_level(PlannerInfo *root, DPccpState *state, int level)
+{
+	uint64	   *pairs = state->pairs[level];
+	int			i;
+
+	Assert(root->join_rel_level[level] == NIL);
+
+	/* Set join_cur_level so that new joinrels are added to proper list */
+	root->join_cur_level = level;
+
+	for (i = 0; i < state->npairs[level]; i++)
+	{
+		RelOptInfo *rel1 = dpccp_find_rel(root, state, pairs[2 * i]);
+		RelOptInfo *rel2 = dpccp_find_rel(root, state, pairs[2 * i + 1]);
+
+		/* Either side may have had no legal join order at all */
+		if (rel1 != NULL && rel2 != NULL)
+			(void) make_join_rel(root, rel1, rel2);
+	}
+}
+
+/*
+ * Return the initial rels adjacent to 'set', but not in it.
+ */
+static uint64
+dpccp_neighborhood(DPccpState *state, uint64 set)
+{
+	uint64		result = 0;
+	uint64		rest = set;
+
+	while (rest != 0)
+	{
+		int			i = pg_rightmost_one_pos64(rest);
+
+		result |= state->neighbors[i];
+		rest &= ~DPCCP_BIT(i);
+	}
+
+	return result & ~set;
+}
+
+/*
+ * Enumerate the connected sets that extend the connected set 'set' with
+ * rels outside 'excluded'.
+ *
+ * If 'csg' is zero, these are the csgs of the pairs, and we look for the
+ * complements of each one.  Otherwise, these are the complements of 'csg',
+ * and we emit the pairs they form with it.
+ */
+static void
+dpccp_enumerate_csg_rec(DPccpState *state, uint64 set, uint64 excluded,
+						uint64 csg)
+{
+	uint64		neighbors;
+	uint64		subset;
+
+	/* Protect against stack overflow with many rels */
+	check_stack_depth();
+
+	neighbors = dpccp_neighborhood(state, set) & ~excluded;
+	if (neighbors == 0)
+		return;
+
+	/* Each non-empty subset of the neighborhood makes a new connected set */
+	for (subset = neighbors; subset != 0; subset = (subset - 1) & neighbors)
+	{
+		if (csg == 0)
+			dpccp_enumerate_cmp(state, set | subset);
+		else
+			dpccp_add_pair(state, csg, set | subset);
+	}
+
+	/* ... which we extend in turn, not going back to this neighborhood */
+	for (subset = neighbors; subset != 0; subset = (subset - 1) & neighbors)
+		dpccp_enumerate_csg_rec(state, set | subset, excluded | neighbors,
+								csg);
+}
+
+/*
+ * Enumerate the connected sets that are connected to the connected set
+ * 'csg', and emit the pairs.  To generate each pair only once, only rels
+ * numbered above the lowest-numbered rel of 'csg' are considered.
+ */
+static void
+dpccp_enumerate_cmp(DPccpState *state, uint64 csg)
+{
+	uint64		excluded;
+	uint64		neighbors;
+	int			i;
+
+	excluded = DPCCP_UPTO(pg_rightmost_one_pos64(csg)) | csg;
+	neighbors = dpccp_neighborhood(state, csg) & ~excluded;
+
+	for (i = state->nrels - 1; i >= 0; i--)
+	{
+		if ((neighbors & DPCCP_BIT(i)) == 0)
+			continue;
+
+		dpccp_add_pair(state, csg, DPCCP_BIT(i));
+		dpccp_enumerate_csg_rec(state, DPCCP_BIT(i),
+								excluded | (neighbors & DPCCP_UPTO(i)),
+								csg);
+	}
+}
+
+/*
+ * Remember a pair to be joined, at the level of its union.
+ */
+static void
+dpccp_add_pair(DPccpState *state, uint64 set1, uint64 set2)
+{
+	int			level = pg_popcount64(set1 | set2);
+
+	if (state->npairs[level] >= state->maxpairs[level])
+	{
+		if (state->maxpairs[level] == 0)
+		{
+			state->maxpairs[level] = 16;
+			state->pairs[level] = (uint64 *)
+				palloc(state->maxpairs[level] * 2 * sizeof(uint64));
+		}
+		else
+		{
+			if ((Size) state->maxpairs[level] * 4 * sizeof(uint64) >= MaxAllocSize)
+				ereport(ERROR,
+						(errcode(ERRCODE_PROGRAM_LIMIT_EXCEEDED),
+						 errmsg("too many ways to join %d relations", state->nrels),
+						 errhint("Lower join_collapse_limit or from_collapse_limit.")));
+			state->maxpairs[level] *= 2;
+			state->pairs[level] = (uint64 *)
+				repalloc(state->pairs[level],
+						 state->maxpairs[level] * 2 * sizeof(uint64));
+		}
+	}
+
+	state->pairs[level][2 * state->npairs[level]] = set1;
+	state->pairs[level][2 * state->npairs[level] + 1] = set2;
+	state->npairs[level]++;
+}
+
+/*
+ * Find the rel joining a set of initial rels, or NULL if it was never made.
+ */
+static RelOptInfo *
+dpccp_find_rel(PlannerInfo *root, DPccpState *state, uint64 set)
+{
+	Relids		relids = NULL;
+	RelOptInfo *rel;
+	uint64		rest = set;
+
+	if (pg_popcount64(set) == 1)
+		return state->rels[pg_rightmost_one_pos64(set)];
+
+	while (rest != 0)
+	{
+		int			i = pg_rightmost_one_pos64(rest);
+
+		relids = bms_add_members(relids, state->rels[i]->relids);
+		rest &= ~DPCCP_BIT(i);
+	}
+
+	rel = find_join_rel(root, relids);
+	bms_free(relids);
+
+	return rel;
+}
+
+
 /*
  * join_is_legal
  *	   Determine whether a proposed join is legal given the query's
@@ -83,6 +83,7 @@ static Plan *create_gating_plan(PlannerInfo *root, Path *path, Plan *plan,
 static Plan *create_join_plan(PlannerInfo *root, JoinPath *best_path);
 static Plan *create_append_plan(PlannerInfo *root, AppendPath *best_path,
 								int flags);
+static bool is_async_capable_plan(Plan *plan, Path *path);
 static Plan *create_merge_append_plan(PlannerInfo *root, MergeAppendPath *best_path,
 									  int flags);
 static Result *create_group_result_plan(PlannerInfo *root,
@@ -90,6 +91,9 @@ static Result *create_group_result_plan(PlannerInfo *root,
 static ProjectSet *create_project_set_plan(PlannerInfo *root, ProjectSetPath *best_path);
 static Material *create_material_plan(PlannerInfo *root, MaterialPath *best_path,
 									  int flags);
+static ResultCache *create_resultcache_plan(PlannerInfo *root,
+											ResultCachePath *best_path,
+											int flags);
 static Plan *create_unique_plan(PlannerInfo *root, UniquePath *best_path,
 								int flags);
 static Gather *create_gather_plan(PlannerInfo *root, GatherPath *best_path);
@@ -103,6 +107,8 @@ static Unique *create_upper_unique_plan(PlannerInfo *root, UpperUniquePath *best
 										int flags);
 static Agg *create_agg_plan(PlannerInfo *root, AggPath *best_path);
 static Plan *create_groupingsets_plan(PlannerInfo *root, GroupingSetsPath *best_path);
+static void make_minmaxagg_initplan(PlannerInfo *root, PlannerInfo *subroot,
+									Path *path, Cost pathcost, Param *param);
 static Result *create_minmaxagg_plan(PlannerInfo *root, MinMaxAggPath *best_path);
 static WindowAgg *create_windowagg_plan(PlannerInfo *root, WindowAggPath *best_path);
 static SetOp *create_setop_plan(PlannerInfo *root, SetOpPath *best_path,
@@ -152,6 +158,11 @@ static CustomScan *create_customscan_plan(PlannerInfo *root,
 static NestLoop *create_nestloop_plan(PlannerInfo *root, NestPath *best_path);
 static MergeJoin *create_mergejoin_plan(PlannerInfo *root, MergePath *best_path);
 static HashJoin *create_hashjoin_plan(PlannerInfo *root, HashPath *best_path);
+static void add_hashjoin_partition_pruning(PlannerInfo *root,
+										   HashPath *best_path,
+										   Append *outer_plan,
+										   Hash *hash_plan,
+										   List *hashclauses);
 static Node *replace_nestloop_params(PlannerInfo *root, Node *expr);
 static Node *replace_nestloop_params_mutator(Node *node, PlannerInfo *root);
 static void fix_indexqual_references(PlannerInfo *root, IndexPath *index_path,
@@ -262,6 +273,9 @@ static Sort *make_sort_from_groupcols(List *groupcls,
 									  AttrNumber *grpColIdx,
 									  Plan *lefttree);
 static Material *make_material(Plan *lefttree);
+static ResultCache *make_resultcache(Plan *lefttree, Oid *hashoperators,
+									 Oid *collations, List *param_exprs,
+									 bool singlerow, uint32 est_entries);
 static WindowAgg *make_windowagg(List *tlist, Index winref,
 								 int partNumCols, AttrNumber *partColIdx, Oid *partOperators, Oid *partCollations,
 								 int ordNumCols, AttrNumber *ordColIdx, Oid *ordOperators, Oid *ordCollations,
@@ -436,6 +450,11 @@ create_plan_recurse(PlannerInfo *root, Path *best_path, int flags)
 												 (MaterialPath *) best_path,
 												 flags);
 			break;
+		case T_ResultCache:
+			plan = (Plan *) create_resultcache_plan(root,
+													(ResultCachePath *) best_path,
+													flags);
+			break;
 		case T_Unique:
 			if (IsA(best_path, UpperUniquePath))
 			{
@@ -1077,6 +1096,7 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 	Oid		   *nodeSortOperators = NULL;
 	Oid		   *nodeCollations = NULL;
 	bool	   *nodeNullsFirst = NULL;
+	bool		consider_async = false;
 
 	/*
 	 * The subpaths list could be empty, if every child was proven empty by
@@ -1139,6 +1159,15 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 		tlist_was_changed = (orig_tlist_length != list_length(plan->plan.targetlist));
 	}
 
+	/*
+	 * If appropriate, consider async append.  Async subplans return tuples in
+	 * whatever order they become available, so an ordered Append can't use
+	 * them; nor can a parallel-aware one, whose subplans are run by workers.
+	 */
+	consider_async = (enable_async_append && pathkeys == NIL &&
+					  !best_path->path.parallel_safe &&
+					  list_length(best_path->subpaths) > 1);
+
 	/* Build the plan for each child */
 	foreach(subpaths, best_path->subpaths)
 	{
@@ -1205,6 +1234,10 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 			}
 		}
 
+		/* If needed, check to see if subplan can be executed asynchronously */
+		if (consider_async && is_async_capable_plan(subplan, subpath))
+			subplan->async_capable = true;
+
 		subplans = lappend(subplans, subplan);
 	}
 
@@ -1262,6 +1295,35 @@ create_append_plan(PlannerInfo *root, AppendPath *best_path, int flags)
 		return (Plan *) plan;
 }
 
+/*
+ * is_async_capable_plan
+ *		Check whether a given subplan of an Append can be executed
+ *		asynchronously.  Only foreign scans whose FDW says so qualify; if a
+ *		Result node was put on top of the scan to project, we don't look
+ *		through it.
+ */
+static bool
+is_async_capable_plan(Plan *plan, Path *path)
+{
+	switch (nodeTag(path))
+	{
+		case T_ForeignPath:
+			{
+				FdwRoutine *fdwroutine = path->parent->fdwroutine;
+
+				Assert(fdwroutine != NULL);
+				if (IsA(plan, ForeignScan) &&
+					fdwroutine->IsForeignPathAsyncCapable != NULL &&
+					fdwroutine->IsForeignPathAsyncCapable((ForeignPath *) path))
+					return true;
+			}
+			break;
+		default:
+			break;
+	}
+	return false;
+}
+
 /*
  * create_merge_append_plan
  *	  Create a MergeAppend plan for 'best_path' and (recursively) plans
@@ -1501,6 +1563,65 @@ create_material_plan(PlannerInfo *root, MaterialPath *best_path, int flags)
 	return plan;
 }
 
+/*
+ * create_resultcache_plan
+ *	  Create a ResultCache plan for 'best_path' and (recursively) plans
+ *	  for its subpaths.
+ *
+ *	  Returns a Plan node.
+ */
+static ResultCache *
+create_resultcache_plan(PlannerInfo *root, ResultCachePath *best_path,
+						int flags)
+{
+	ResultCache *plan;
+	Plan	   *subplan;
+	Oid		   *operators;
+	Oid		   *collations;
+	List	   *param_exprs;
+	ListCell   *lc;
+	ListCell   *lc2;
+	int			nkeys;
+	int			i;
+
+	/*
+	 * As with Material, we don't want any excess columns in the cached
+	 * tuples, so request a smaller tlist.
+	 */
+	subplan = create_plan_recurse(root, best_path->subpath,
+								  flags | CP_SMALL_TLIST);
+
+	/*
+	 * The cache keys are expressed in terms of the outer relation's Vars;
+	 * convert those into the nestloop Params that the join supplies.
+	 */
+	param_exprs = (List *) replace_nestloop_params(root, (Node *)
+												   best_path->param_exprs);
+
+	nkeys = list_length(param_exprs);
+	Assert(nkeys > 0);
+	operators = palloc(nkeys * sizeof(Oid));
+	collations = palloc(nkeys * sizeof(Oid));
+
+	i = 0;
+	forboth(lc, param_exprs, lc2, best_path->hash_operators)
+	{
+		Expr	   *param_expr = (Expr *) lfirst(lc);
+		Oid			opno = lfirst_oid(lc2);
+
+		operators[i] = opno;
+		collations[i] = exprCollation((Node *) param_expr);
+		i++;
+	}
+
+	plan = make_resultcache(subplan, operators, collations, param_exprs,
+							best_path->singlerow, best_path->est_entries);
+
+	copy_generic_path_info(&plan->plan, (Path *) best_path);
+
+	return plan;
+}
+
 /*
  * create_unique_plan
  *	  Create a Unique plan for 'best_path' and (recursively) plans
@@ -2303,6 +2424,43 @@ create_groupingsets_plan(PlannerInfo *root, GroupingSetsPath *best_path)
 	return (Plan *) plan;
 }
 
+/*
+ * make_minmaxagg_initplan
+ *
+ *	  Turn the path of a MIN/MAX aggregate's subquery into an InitPlan of
+ *	  the outer query, setting 'param'.
+ */
+static void
+make_minmaxagg_initplan(PlannerInfo *root, PlannerInfo *subroot, Path *path,
+						Cost pathcost, Param *param)
+{
+	Query	   *subparse = subroot->parse;
+	Plan	   *plan;
+
+	/*
+	 * Generate the plan for the subquery. We already have a Path, but we
+	 * have to convert it to a Plan and attach a LIMIT node above it. Since
+	 * we are entering a different planner context (subroot), recurse to
+	 * create_plan not create_plan_recurse.
+	 */
+	plan = create_plan(subroot, path);
+
+	plan = (Plan *) make_limit(plan,
+							   subparse->limitOffset,
+							   subparse->limitCount);
+
+	/* Must apply correct cost/width data to Limit node */
+	plan->startup_cost = path->startup_cost;
+	plan->total_cost = pathcost;
+	plan->plan_rows = 1;
+	plan->plan_width = path->pathtarget->width;
+	plan->parallel_aware = false;
+	plan->parallel_safe = path->parallel_safe;
+
+	/* Convert the plan into an InitPlan in the outer query. */
+	SS_make_initplan_from_plan(root, subroot, plan, param);
+}
+
 /*
  * create_minmaxagg_plan
  *
@@ -2320,32 +2478,16 @@ create_minmaxagg_plan(PlannerInfo *root, MinMaxAggPath *best_path)
 	foreach(lc, best_path->mmaggregates)
 	{
 		MinMaxAggInfo *mminfo = (MinMaxAggInfo *) lfirst(lc);
-		PlannerInfo *subroot = mminfo->subroot;
-		Query	   *subparse = subroot->parse;
-		Plan	   *plan;
-
-		/*
-		 * Generate the plan for the subquery. We already have a Path, but we
-		 * have to convert it to a Plan and attach a LIMIT node above it.
-		 * Since we are entering a different planner context (subroot),
-		 * recurse to create_plan not create_plan_recurse.
-		 */
-		plan = create_plan(subroot, mminfo->path);
-
-		plan = (Plan *) make_limit(plan,
-								   subparse->limitOffset,
-								   subparse->limitCount);
 
-		/* Must apply correct cost/width data to Limit node */
-		plan->startup_cost = mminfo->path->startup_cost;
-		plan->total_cost = mminfo->pathcost;
-		plan->plan_rows = 1;
-		plan->plan_width = mminfo->path->pathtarget->width;
-		plan->parallel_aware = false;
-		plan->parallel_safe = mminfo->path->parallel_safe;
+		make_minmaxagg_initplan(root, mminfo->subroot, mminfo->path,
+								mminfo->pathcost, mminfo->param);
 
-		/* Convert the plan into an InitPlan in the outer query. */
-		SS_make_initplan_from_plan(root, subroot, plan, mminfo->param);
+		/* And one for its fallback subquery, if it has one */
+		if (mminfo->fallback_path)
+			make_minmaxagg_initplan(root, mminfo->fallback_subroot,
+									mminfo->fallback_path,
+									mminfo->fallback_path->total_cost,
+									mminfo->fallback_param);
 	}
 
 	/* Generate the output plan --- basically just a Result */
@@ -4531,6 +4673,14 @@ create_hashjoin_plan(PlannerInfo *root,
 		hash_plan->rows_total = best_path->inner_rows_total;
 	}
 
+	/*
+	 * If the outer side is a partitioned Append, it might be able to skip
+	 * some partitions once the inner join keys are known.
+	 */
+	if (enable_partition_pruning && IsA(outer_plan, Append))
+		add_hashjoin_partition_pruning(root, best_path, (Append *) outer_plan,
+									   hash_plan, hashclauses);
+
 	join_plan = make_hashjoin(tlist,
 							  joinclauses,
 							  otherclauses,
@@ -4548,6 +4698,101 @@ create_hashjoin_plan(PlannerInfo *root,
 	return join_plan;
 }
 
+/*
+ * add_hashjoin_partition_pruning
+ *	  Let the partitioned Append on the outer side of a hash join skip, at
+ *	  run time, the partitions that can't contain any value of the inner
+ *	  join keys.
+ *
+ * The Hash node collects the range of the inner values of the join keys that
+ * are partition keys of the outer rel into PARAM_EXEC params, and we add
+ * quals comparing the partition key with those params to the ones the Append
+ * uses for run-time pruning.  The executor builds the hash table before
+ * starting the outer side in that case.
+ */
+static void
+add_hashjoin_partition_pruning(PlannerInfo *root, HashPath *best_path,
+							   Append *outer_plan, Hash *hash_plan,
+							   List *hashclauses)
+{
+	AppendPath *apath;
+	RelOptInfo *rel;
+	List	   *joinquals;
+	List	   *prunequal;
+	List	   *keyidx;
+	List	   *cmpfuncs;
+	List	   *collations;
+	List	   *params;
+	PartitionPruneInfo *partpruneinfo;
+	Bitmapset  *paramids = NULL;
+	bool		used = false;
+	ListCell   *lc;
+
+	/*
+	 * Only possible if unmatched outer tuples are not emitted, and if the
+	 * hash table is private to each process, so that it sees all the inner
+	 * values.
+	 */
+	if (best_path->jpath.jointype != JOIN_INNER &&
+		best_path->jpath.jointype != JOIN_SEMI &&
+		best_path->jpath.jointype != JOIN_RIGHT)
+		return;
+	if (best_path->jpath.path.parallel_aware)
+		return;
+
+	if (!IsA(best_path->jpath.outerjoinpath, AppendPath))
+		return;
+	apath = (AppendPath *) best_path->jpath.outerjoinpath;
+	rel = apath->path.parent;
+
+	/* See create_append_plan; parameterized Appends are left alone */
+	if (rel->reloptkind != RELOPT_BASEREL ||
+		apath->partitioned_rels == NIL ||
+		apath->path.param_info != NULL)
+		return;
+
+	joinquals = make_hashjoin_pruning_quals(root, rel, hashclauses,
+											&keyidx, &cmpfuncs,
+											&collations, &params);
+	if (joinquals == NIL)
+		return;
+
+	prunequal = list_concat(extract_actual_clauses(rel->baserestrictinfo,
+												   false),
+							joinquals);
+	partpruneinfo = make_partition_pruneinfo(root, rel,
+											 apath->subpaths,
+											 apath->partitioned_rels,
+											 prunequal);
+
+	/* Don't bother collecting the ranges if no pruning step uses them */
+	foreach(lc, params)
+		paramids = bms_add_member(paramids, lfirst_int(lc));
+	if (partpruneinfo != NULL)
+	{
+		foreach(lc, partpruneinfo->prune_infos)
+		{
+			ListCell   *lc2;
+
+			foreach(lc2, (List *) lfirst(lc))
+			{
+				PartitionedRelPruneInfo *pinfo = lfirst(lc2);
+
+				if (bms_overlap(pinfo->execparamids, paramids))
+					used = true;
+			}
+		}
+	}
+	if (!used)
+		return;
+
+	outer_plan->part_prune_info = partpruneinfo;
+	hash_plan->prunekeyidx = keyidx;
+	hash_plan->prunecmpfuncs = cmpfuncs;
+	hash_plan->prunecollations = collations;
+	hash_plan->pruneparams = params;
+}
+
 
 /*****************************************************************************
  *
@@ -6147,6 +6392,28 @@ make_material(Plan *lefttree)
 	return node;
 }
 
+static ResultCache *
+make_resultcache(Plan *lefttree, Oid *hashoperators, Oid *collations,
+				 List *param_exprs, bool singlerow, uint32 est_entries)
+{
+	ResultCache *node = makeNode(ResultCache);
+	Plan	   *plan = &node->plan;
+
+	plan->targetlist = lefttree->targetlist;
+	plan->qual = NIL;
+	plan->lefttree = lefttree;
+	plan->righttree = NULL;
+
+	node->numKeys = list_length(param_exprs);
+	node->hashOperators = hashoperators;
+	node->collations = collations;
+	node->param_exprs = param_exprs;
+	node->singlerow = singlerow;
+	node->est_entries = est_entries;
+
+	return node;
+}
+
 /*
  * materialize_finished_plan: stick a Material node atop a completed plan
  *
@@ -6769,6 +7036,7 @@ is_projection_capable_path(Path *path)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_ResultCache:
 		case T_Sort:
 		case T_Unique:
 		case T_SetOp:
@@ -6813,6 +7081,7 @@ is_projection_capable_plan(Plan *plan)
 	{
 		case T_Hash:
 		case T_Material:
+		case T_ResultCache:
 		case T_Sort:
 		case T_Unique:
 		case T_SetOp:
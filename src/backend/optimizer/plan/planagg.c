@@ -16,6 +16,13 @@
  * non-optimizable aggregates, there's no point since we'll have to
  * scan all the rows anyway.
  *
+ * Without a suitable btree index, a BRIN minmax index on tab.col can still
+ * help: the subquery then gets an extra "col <= bound" (">=" for MAX) qual
+ * derived from the index summaries, so that a bitmap scan reads only the
+ * page ranges that can hold the result, and a sort picks it out.  Since the
+ * summaries may describe deleted rows, an unbounded subquery stands by in
+ * case the bounded one finds nothing.
+ *
  *
  * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
  * Portions Copyright (c) 1994, Regents of the University of California
@@ -28,7 +35,9 @@
  */
 #include "postgres.h"
 
+#include "access/brin.h"
 #include "access/htup_details.h"
+#include "access/table.h"
 #include "catalog/pg_aggregate.h"
 #include "catalog/pg_type.h"
 #include "nodes/makefuncs.h"
@@ -51,6 +60,15 @@
 static bool find_minmax_aggs_walker(Node *node, List **context);
 static bool build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 							  Oid eqop, Oid sortop, bool nulls_first);
+static bool build_brin_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
+								   Oid eqop, Oid sortop, bool nulls_first);
+static PlannerInfo *plan_minmax_subquery(PlannerInfo *root,
+										 MinMaxAggInfo *mminfo,
+										 Oid eqop, Oid sortop,
+										 bool nulls_first, Expr *bound_qual,
+										 RelOptInfo **final_rel);
+static Path *make_sorted_minmax_path(PlannerInfo *subroot,
+									 RelOptInfo *final_rel);
 static void minmax_qp_callback(PlannerInfo *root, void *extra);
 static Oid	fetch_agg_sort_op(Oid aggfnoid);
 
@@ -179,6 +197,9 @@ preprocess_minmax_aggregates(PlannerInfo *root)
 			continue;
 		if (build_minmax_path(root, mminfo, eqop, mminfo->aggsortop, !reverse))
 			continue;
+		if (build_brin_minmax_path(root, mminfo, eqop, mminfo->aggsortop,
+								   reverse))
+			continue;
 
 		/* No indexable path for this aggregate, so fail */
 		return;
@@ -202,6 +223,12 @@ preprocess_minmax_aggregates(PlannerInfo *root)
 										  exprType((Node *) mminfo->target),
 										  -1,
 										  exprCollation((Node *) mminfo->target));
+		if (mminfo->fallback_path)
+			mminfo->fallback_param =
+				SS_make_initplan_output_param(root,
+											  exprType((Node *) mminfo->target),
+											  -1,
+											  exprCollation((Node *) mminfo->target));
 	}
 
 	/*
@@ -317,6 +344,9 @@ find_minmax_aggs_walker(Node *node, List **context)
 		mminfo->path = NULL;
 		mminfo->pathcost = 0;
 		mminfo->param = NULL;
+		mminfo->fallback_subroot = NULL;
+		mminfo->fallback_path = NULL;
+		mminfo->fallback_param = NULL;
 
 		*context = lappend(*context, mminfo);
 
@@ -342,6 +372,158 @@ find_minmax_aggs_walker(Node *node, List **context)
 static bool
 build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 				  Oid eqop, Oid sortop, bool nulls_first)
+{
+	PlannerInfo *subroot;
+	RelOptInfo *final_rel;
+	Path	   *sorted_path;
+	Cost		path_cost;
+	double		path_fraction;
+
+	subroot = plan_minmax_subquery(root, mminfo, eqop, sortop, nulls_first,
+								   NULL, &final_rel);
+
+	/*
+	 * Get the best presorted path, that being the one that's cheapest for
+	 * fetching just one row.  If there's no such path, fail.
+	 */
+	if (final_rel->rows > 1.0)
+		path_fraction = 1.0 / final_rel->rows;
+	else
+		path_fraction = 1.0;
+
+	sorted_path =
+		get_cheapest_fractional_path_for_pathkeys(final_rel->pathlist,
+												  subroot->query_pathkeys,
+												  NULL,
+												  path_fraction);
+	if (!sorted_path)
+		return false;
+
+	/*
+	 * The path might not return exactly what we want, so fix that.  (We
+	 * assume that this won't change any conclusions about which was the
+	 * cheapest path.)
+	 */
+	sorted_path = apply_projection_to_path(subroot, final_rel, sorted_path,
+										   create_pathtarget(subroot,
+															 subroot->processed_tlist));
+
+	/*
+	 * Determine cost to get just the first row of the presorted path.
+	 *
+	 * Note: cost calculation here should match
+	 * compare_fractional_path_costs().
+	 */
+	path_cost = sorted_path->startup_cost +
+		path_fraction * (sorted_path->total_cost - sorted_path->startup_cost);
+
+	/* Save state for further processing */
+	mminfo->subroot = subroot;
+	mminfo->path = sorted_path;
+	mminfo->pathcost = path_cost;
+
+	return true;
+}
+
+/*
+ * build_brin_minmax_path
+ *		Given a MIN/MAX aggregate over a column with a BRIN minmax index,
+ *		try to build a Path that needs to read only some of its page ranges.
+ *
+ * The bound comes from the index summaries as they are now, and the plan
+ * may be used long after, so the bounded subquery only narrows down where to
+ * look; it may find nothing even though the table has rows.  We therefore
+ * also plan the unbounded subquery as a fallback, to be run only in that
+ * case.
+ *
+ * If successful, stash both paths in *mminfo and return true.
+ * Otherwise, return false.
+ */
+static bool
+build_brin_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
+					   Oid eqop, Oid sortop, bool nulls_first)
+{
+	Var		   *var = (Var *) mminfo->target;
+	RangeTblEntry *rte;
+	Relation	rel;
+	Oid			boundop;
+	Datum		bound;
+	bool		found;
+	int16		typlen;
+	bool		typbyval;
+	Expr	   *bound_qual;
+	PlannerInfo *subroot;
+	PlannerInfo *fallback_subroot;
+	RelOptInfo *final_rel;
+	RelOptInfo *fallback_rel;
+	Path	   *path;
+	Path	   *fallback_path;
+	Cost		path_cost;
+
+	/* Only plain columns of plain tables can have a BRIN index */
+	if (!IsA(var, Var) || var->varlevelsup != 0 || var->varattno <= 0)
+		return false;
+	rte = planner_rt_fetch(var->varno, root);
+	if (rte->rtekind != RTE_RELATION || rte->inh)
+		return false;
+
+	/* We should already hold a lock on the relation */
+	rel = table_open(rte->relid, NoLock);
+	found = brin_minmax_bound(rel, var->varattno, sortop, &boundop, &bound);
+	table_close(rel, NoLock);
+	if (!found)
+		return false;
+
+	get_typlenbyval(var->vartype, &typlen, &typbyval);
+	bound_qual = make_opclause(boundop, BOOLOID, false,
+							   (Expr *) copyObject(var),
+							   (Expr *) makeConst(var->vartype,
+												  var->vartypmod,
+												  var->varcollid,
+												  typlen,
+												  bound,
+												  false,
+												  typbyval),
+							   InvalidOid, var->varcollid);
+
+	subroot = plan_minmax_subquery(root, mminfo, eqop, sortop, nulls_first,
+								   bound_qual, &final_rel);
+	path = make_sorted_minmax_path(subroot, final_rel);
+
+	fallback_subroot = plan_minmax_subquery(root, mminfo, eqop, sortop,
+											nulls_first, NULL, &fallback_rel);
+	fallback_path = make_sorted_minmax_path(fallback_subroot, fallback_rel);
+
+	/*
+	 * The sort has to see all of its input before returning the first row.
+	 * If the bounded subquery isn't expected to find more than a row, it
+	 * could just as well find none, so charge for the fallback too.
+	 */
+	path_cost = path->total_cost;
+	if (final_rel->rows <= 1.0)
+		path_cost += fallback_path->total_cost;
+
+	/* Save state for further processing */
+	mminfo->subroot = subroot;
+	mminfo->path = path;
+	mminfo->pathcost = path_cost;
+	mminfo->fallback_subroot = fallback_subroot;
+	mminfo->fallback_path = fallback_path;
+
+	return true;
+}
+
+/*
+ * plan_minmax_subquery
+ *		Plan the subquery for a MIN/MAX aggregate, with "bound_qual" added to
+ *		its quals if not NULL.
+ *
+ * Returns the subquery's PlannerInfo, and its final RelOptInfo in *final_rel.
+ */
+static PlannerInfo *
+plan_minmax_subquery(PlannerInfo *root, MinMaxAggInfo *mminfo,
+					 Oid eqop, Oid sortop, bool nulls_first,
+					 Expr *bound_qual, RelOptInfo **final_rel)
 {
 	PlannerInfo *subroot;
 	Query	   *parse;
@@ -349,10 +531,6 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 	List	   *tlist;
 	NullTest   *ntest;
 	SortGroupClause *sortcl;
-	RelOptInfo *final_rel;
-	Path	   *sorted_path;
-	Cost		path_cost;
-	double		path_fraction;
 
 	/*
 	 * We are going to construct what is effectively a sub-SELECT query, so
@@ -419,6 +597,10 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 		parse->jointree->quals = (Node *)
 			lcons(ntest, (List *) parse->jointree->quals);
 
+	if (bound_qual)
+		parse->jointree->quals = (Node *)
+			lappend((List *) parse->jointree->quals, bound_qual);
+
 	/* Build suitable ORDER BY clause */
 	sortcl = makeNode(SortGroupClause);
 	sortcl->tleSortGroupRef = assignSortGroupRef(tle, subroot->processed_tlist);
@@ -442,7 +624,7 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 	subroot->tuple_fraction = 1.0;
 	subroot->limit_tuples = 1.0;
 
-	final_rel = query_planner(subroot, minmax_qp_callback, NULL);
+	*final_rel = query_planner(subroot, minmax_qp_callback, NULL);
 
 	/*
 	 * Since we didn't go through subquery_planner() to handle the subquery,
@@ -451,49 +633,29 @@ build_minmax_path(PlannerInfo *root, MinMaxAggInfo *mminfo,
 	 * matter if we end up not using the subplan.)
 	 */
 	SS_identify_outer_params(subroot);
-	SS_charge_for_initplans(subroot, final_rel);
-
-	/*
-	 * Get the best presorted path, that being the one that's cheapest for
-	 * fetching just one row.  If there's no such path, fail.
-	 */
-	if (final_rel->rows > 1.0)
-		path_fraction = 1.0 / final_rel->rows;
-	else
-		path_fraction = 1.0;
+	SS_charge_for_initplans(subroot, *final_rel);
 
-	sorted_path =
-		get_cheapest_fractional_path_for_pathkeys(final_rel->pathlist,
-												  subroot->query_pathkeys,
-												  NULL,
-												  path_fraction);
-	if (!sorted_path)
-		return false;
-
-	/*
-	 * The path might not return exactly what we want, so fix that.  (We
-	 * assume that this won't change any conclusions about which was the
-	 * cheapest path.)
-	 */
-	sorted_path = apply_projection_to_path(subroot, final_rel, sorted_path,
-										   create_pathtarget(subroot,
-															 subroot->processed_tlist));
+	return subroot;
+}
 
-	/*
-	 * Determine cost to get just the first row of the presorted path.
-	 *
-	 * Note: cost calculation here should match
-	 * compare_fractional_path_costs().
-	 */
-	path_cost = sorted_path->startup_cost +
-		path_fraction * (sorted_path->total_cost - sorted_path->startup_cost);
+/*
+ * make_sorted_minmax_path
+ *		Sort the cheapest path of a MIN/MAX subquery into the wanted order,
+ *		for use when no presorted path is good enough.
+ */
+static Path *
+make_sorted_minmax_path(PlannerInfo *subroot, RelOptInfo *final_rel)
+{
+	Path	   *path = final_rel->cheapest_total_path;
 
-	/* Save state for further processing */
-	mminfo->subroot = subroot;
-	mminfo->path = sorted_path;
-	mminfo->pathcost = path_cost;
+	if (!pathkeys_contained_in(subroot->query_pathkeys, path->pathkeys))
+		path = (Path *) create_sort_path(subroot, final_rel, path,
+										 subroot->query_pathkeys,
+										 subroot->limit_tuples);
 
-	return true;
+	return apply_projection_to_path(subroot, final_rel, path,
+									create_pathtarget(subroot,
+													  subroot->processed_tlist));
 }
 
 /*
@@ -108,6 +108,7 @@ static Plan *set_mergeappend_references(PlannerInfo *root,
 										MergeAppend *mplan,
 										int rtoffset);
 static void set_hash_references(PlannerInfo *root, Plan *plan, int rtoffset);
+static Node *minmax_agg_output(MinMaxAggInfo *mminfo);
 static Node *fix_scan_expr(PlannerInfo *root, Node *node, int rtoffset);
 static Node *fix_scan_expr_mutator(Node *node, fix_scan_expr_context *context);
 static bool fix_scan_expr_walker(Node *node, fix_scan_expr_context *context);
@@ -670,6 +671,20 @@ set_plan_refs(PlannerInfo *root, Plan *plan, int rtoffset)
 			 */
 			Assert(plan->qual == NIL);
 			break;
+		case T_ResultCache:
+			{
+				ResultCache *rcplan = (ResultCache *) plan;
+
+				/*
+				 * Like Material, ResultCache does not evaluate its
+				 * targetlist; it just returns the tuples of its subplan.
+				 */
+				set_dummy_tlist_references(plan, rtoffset);
+
+				rcplan->param_exprs = fix_scan_list(root, rcplan->param_exprs,
+													rtoffset);
+				break;
+			}
 		case T_LockRows:
 			{
 				LockRows   *splan = (LockRows *) plan;
@@ -1591,6 +1606,33 @@ fix_param_node(PlannerInfo *root, Param *p)
 	return (Node *) copyObject(p);
 }
 
+/*
+ * minmax_agg_output
+ *		Build the expression that replaces an optimized MIN/MAX Aggref
+ *
+ * That's the output Param of its initplan, or if a fallback initplan is
+ * needed in case that one finds no row, COALESCE() of both their outputs.
+ * Initplans are only run when their output is first needed, so the fallback
+ * is run only if the first one came up empty.
+ */
+static Node *
+minmax_agg_output(MinMaxAggInfo *mminfo)
+{
+	CoalesceExpr *coalesce;
+
+	if (mminfo->fallback_param == NULL)
+		return (Node *) copyObject(mminfo->param);
+
+	coalesce = makeNode(CoalesceExpr);
+	coalesce->coalescetype = mminfo->param->paramtype;
+	coalesce->coalescecollid = mminfo->param->paramcollid;
+	coalesce->args = list_make2(copyObject(mminfo->param),
+								copyObject(mminfo->fallback_param));
+	coalesce->location = -1;
+
+	return (Node *) coalesce;
+}
+
 /*
  * fix_scan_expr
  *		Do set_plan_references processing on a scan-level expression
@@ -1675,7 +1717,7 @@ fix_scan_expr_mutator(Node *node, fix_scan_expr_context *context)
 
 				if (mminfo->aggfnoid == aggref->aggfnoid &&
 					equal(mminfo->target, curTarget->expr))
-					return (Node *) copyObject(mminfo->param);
+					return minmax_agg_output(mminfo);
 			}
 		}
 		/* If no match, just fall through to process it normally */
@@ -2585,7 +2627,7 @@ fix_upper_expr_mutator(Node *node, fix_upper_expr_context *context)
 
 				if (mminfo->aggfnoid == aggref->aggfnoid &&
 					equal(mminfo->target, curTarget->expr))
-					return (Node *) copyObject(mminfo->param);
+					return minmax_agg_output(mminfo);
 			}
 		}
 		/* If no match, just fall through to process it normally */
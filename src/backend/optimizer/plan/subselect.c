@@ -2698,6 +2698,11 @@ finalize_plan(PlannerInfo *root, Plan *plan,
 			/* rescan_param does *not* get added to scan_params */
 			break;
 
+		case T_ResultCache:
+			finalize_primnode((Node *) ((ResultCache *) plan)->param_exprs,
+							  &context);
+			break;
+
 		case T_GatherMerge:
 			/* child nodes are allowed to reference rescan_param, if any */
 			locally_added_param = ((GatherMerge *) plan)->rescan_param;
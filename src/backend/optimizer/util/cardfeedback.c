@@ -0,0 +1,703 @@
+/*-------------------------------------------------------------------------
+ *
+ * cardfeedback.c
+ *	  Learned cardinality feedback for selectivity estimation
+ *
+ * When enable_cardinality_feedback is on, every query executed with row
+ * instrumentation (EXPLAIN ANALYZE, auto_explain.log_analyze and the like)
+ * reports the selectivity actually observed at its sequential scans and
+ * inner joins.  The observations are kept in a fixed-size shared hash table,
+ * keyed by the relation and a signature of the qual clauses, and
+ * clauselist_selectivity() blends them into its own estimate the next time
+ * it is asked about the same clause list.
+ *
+ * The store holds the observed selectivity itself rather than the ratio of
+ * actual to estimated rows.  A ratio would be relative to an estimate that
+ * the feedback has already influenced, and would chase its own tail.
+ *
+ * For each entry we keep an exponential moving average of the logarithm of
+ * the observed selectivity: each new observation gets a weight of
+ * (1 - cardinality_feedback_decay).  How much the planner trusts an entry
+ * grows with the number of observations behind it, as
+ * 1 - cardinality_feedback_decay ^ nsamples.
+ *
+ * The signature ignores the order of AND'ed clauses and of the arguments of
+ * commutative operators, so the planner's restriction lists and the quals
+ * the executor ends up evaluating hash alike.  Vars are identified by the
+ * OID and column number of the relation they belong to.  Clauses containing
+ * anything we don't know how to hash (sublinks, PARAM_EXEC Params,
+ * PlaceHolderVars, ...) get no feedback.
+ *
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/util/cardfeedback.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/parallel.h"
+#include "executor/executor.h"
+#include "executor/instrument.h"
+#include "fmgr.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/cardfeedback.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/datum.h"
+#include "utils/hashutils.h"
+#include "utils/hsearch.h"
+#include "utils/lsyscache.h"
+#include "utils/selfuncs.h"
+
+
+/* GUC parameters */
+bool		enable_cardinality_feedback = false;
+double		cardinality_feedback_decay = 0.5;
+int			cardinality_feedback_max_entries = 1000;
+
+/* Observed selectivities are clamped to this before taking the log */
+#define FEEDBACK_MIN_SELECTIVITY	1.0e-10
+
+/*
+ * Hash key of a feedback entry.  relid is the relation all the clauses
+ * reference, or InvalidOid if they span several range table entries.
+ */
+typedef struct CardFeedbackKey
+{
+	Oid			relid;
+	uint64		signature;
+} CardFeedbackKey;
+
+typedef struct CardFeedbackEntry
+{
+	CardFeedbackKey key;		/* hash key (must be first) */
+	double		logsel;			/* moving average of log(selectivity) */
+	int64		nsamples;		/* number of observations */
+} CardFeedbackEntry;
+
+typedef struct CardFeedbackShared
+{
+	LWLock		lock;			/* protects the hash table */
+} CardFeedbackShared;
+
+/* State of a signature computation */
+typedef struct FeedbackHashContext
+{
+	PlannerInfo *root;			/* planner's info, or NULL in the executor */
+	EState	   *estate;			/* executor's state, or NULL in the planner */
+	Index		varno;			/* first range table index seen, or 0 */
+	Oid			relid;			/* relation OID of varno */
+	bool		multirel;		/* seen Vars of another range table entry? */
+} FeedbackHashContext;
+
+static CardFeedbackShared *FeedbackShared = NULL;
+static HTAB *FeedbackHash = NULL;
+
+static bool feedback_signature(List *clauses, PlannerInfo *root,
+							   EState *estate, CardFeedbackKey *key);
+static bool feedback_hash_node(Node *node, FeedbackHashContext *context,
+							   uint64 *hash);
+static bool feedback_hash_list(List *list, bool ordered,
+							   FeedbackHashContext *context, uint64 *hash);
+static bool feedback_record_walker(PlanState *planstate, void *context);
+static void feedback_record_scan(PlanState *planstate);
+static void feedback_record_join(PlanState *planstate);
+static void feedback_store(CardFeedbackKey *key, double selectivity);
+
+
+/*
+ * Estimate shared memory space needed.
+ */
+Size
+CardinalityFeedbackShmemSize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(CardFeedbackShared));
+	size = add_size(size, hash_estimate_size(cardinality_feedback_max_entries,
+											 sizeof(CardFeedbackEntry)));
+	return size;
+}
+
+/*
+ * Allocate and initialize shared memory.
+ */
+void
+CardinalityFeedbackShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	FeedbackShared = (CardFeedbackShared *)
+		ShmemInitStruct("Cardinality Feedback",
+						sizeof(CardFeedbackShared),
+						&found);
+	if (!found)
+		LWLockInitialize(&FeedbackShared->lock,
+						 LWTRANCHE_CARDINALITY_FEEDBACK);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(CardFeedbackKey);
+	info.entrysize = sizeof(CardFeedbackEntry);
+	FeedbackHash = ShmemInitHash("Cardinality Feedback Hash",
+								 cardinality_feedback_max_entries,
+								 cardinality_feedback_max_entries,
+								 &info,
+								 HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE);
+}
+
+/*
+ * cardinality_feedback_adjust
+ *	  Blend what we have learned about 'clauses' into the estimate 's'.
+ *
+ * 'clauses' is a list of RestrictInfos or bare clauses, as passed to
+ * clauselist_selectivity().  Returns 's' unchanged if there's no feedback
+ * for them.
+ */
+Selectivity
+cardinality_feedback_adjust(PlannerInfo *root, List *clauses, Selectivity s)
+{
+	CardFeedbackKey key;
+	CardFeedbackEntry *entry;
+	double		logsel = 0.0;
+	int64		nsamples = 0;
+	double		weight;
+
+	if (!enable_cardinality_feedback || clauses == NIL || s <= 0.0)
+		return s;
+
+	if (!feedback_signature(clauses, root, NULL, &key))
+		return s;
+
+	LWLockAcquire(&FeedbackShared->lock, LW_SHARED);
+	entry = (CardFeedbackEntry *) hash_search(FeedbackHash, &key,
+											  HASH_FIND, NULL);
+	if (entry != NULL)
+	{
+		logsel = entry->logsel;
+		nsamples = entry->nsamples;
+	}
+	LWLockRelease(&FeedbackShared->lock);
+
+	if (nsamples == 0)
+		return s;
+
+	weight = 1.0 - pow(cardinality_feedback_decay, (double) nsamples);
+	s = exp((1.0 - weight) * log(s) + weight * logsel);
+	CLAMP_PROBABILITY(s);
+
+	return s;
+}
+
+/*
+ * cardinality_feedback_record
+ *	  Record the selectivities observed while executing a plan tree.
+ *
+ * Called at executor end for queries run with row instrumentation.
+ */
+void
+cardinality_feedback_record(PlanState *planstate)
+{
+	/* The leader sees the workers' counts; don't report them twice */
+	if (IsParallelWorker())
+		return;
+
+	(void) feedback_record_walker(planstate, NULL);
+}
+
+/*
+ * Walk the plan state tree bottom-up, so that the instrumentation of a
+ * node's children has been finalized by the time the node looks at it.
+ */
+static bool
+feedback_record_walker(PlanState *planstate, void *context)
+{
+	Instrumentation *instr = planstate->instrument;
+
+	(void) planstate_tree_walker(planstate, feedback_record_walker, context);
+
+	if (instr == NULL)
+		return false;
+
+	InstrEndLoop(instr);
+	if (instr->nloops <= 0)
+		return false;
+
+	switch (nodeTag(planstate->plan))
+	{
+		case T_SeqScan:
+			feedback_record_scan(planstate);
+			break;
+		case T_HashJoin:
+		case T_NestLoop:
+			feedback_record_join(planstate);
+			break;
+		default:
+
+			/*
+			 * Index and bitmap scans stop early under a LIMIT without
+			 * telling us how much of the relation they covered, so what
+			 * they returned is no measure of their selectivity.  Merge joins
+			 * re-read inner tuples on mark/restore, inflating the inner row
+			 * count.
+			 */
+			break;
+	}
+
+	return false;
+}
+
+/*
+ * The selectivity of a sequential scan's filter is the fraction of the
+ * scanned tuples it let through.
+ */
+static void
+feedback_record_scan(PlanState *planstate)
+{
+	Plan	   *plan = planstate->plan;
+	Instrumentation *instr = planstate->instrument;
+	double		scanned;
+	CardFeedbackKey key;
+
+	scanned = instr->ntuples + instr->nfiltered1;
+	if (plan->qual == NIL || scanned <= 0)
+		return;
+
+	if (feedback_signature(plan->qual, NULL, planstate->state, &key))
+		feedback_store(&key, instr->ntuples / scanned);
+}
+
+/*
+ * The selectivity of an inner join's clauses is the fraction of the cross
+ * product of its inputs that it returned.
+ */
+static void
+feedback_record_join(PlanState *planstate)
+{
+	Join	   *join = (Join *) planstate->plan;
+	Instrumentation *instr = planstate->instrument;
+	Instrumentation *outer;
+	Instrumentation *inner;
+	double		inner_rows;
+	List	   *quals;
+	CardFeedbackKey key;
+
+	/* Parallel hash joins split the inner side between participants */
+	if (join->jointype != JOIN_INNER || join->plan.parallel_aware)
+		return;
+
+	outer = outerPlanState(planstate)->instrument;
+	if (IsA(join, HashJoin))
+	{
+		/*
+		 * The Hash node leaves out tuples with NULL join keys, so look at
+		 * its input instead.
+		 */
+		inner = outerPlanState(innerPlanState(planstate))->instrument;
+		quals = list_copy(((HashJoin *) join)->hashclauses);
+	}
+	else
+	{
+		/*
+		 * A parameterized inner side returns rows for one outer row at a
+		 * time, and a unique one stops after the first match.
+		 */
+		if (((NestLoop *) join)->nestParams != NIL || join->inner_unique)
+			return;
+		inner = innerPlanState(planstate)->instrument;
+		quals = NIL;
+	}
+	quals = list_concat(quals, list_copy(join->joinqual));
+	quals = list_concat(quals, list_copy(join->plan.qual));
+
+	if (quals == NIL || outer == NULL || inner == NULL)
+		return;
+
+	InstrEndLoop(outer);
+	InstrEndLoop(inner);
+	if (outer->ntuples <= 0 || inner->ntuples <= 0 || inner->nloops <= 0)
+		return;
+	inner_rows = inner->ntuples / inner->nloops;
+
+	if (feedback_signature(quals, NULL, planstate->state, &key))
+		feedback_store(&key, instr->ntuples / (outer->ntuples * inner_rows));
+}
+
+/*
+ * Fold one observation into the store.  If the table is full, observations
+ * of clause lists we haven't seen before are dropped.
+ */
+static void
+feedback_store(CardFeedbackKey *key, double selectivity)
+{
+	CardFeedbackEntry *entry;
+	double		logsel;
+	bool		found;
+
+	selectivity = Max(selectivity, FEEDBACK_MIN_SELECTIVITY);
+	CLAMP_PROBABILITY(selectivity);
+	logsel = log(selectivity);
+
+	LWLockAcquire(&FeedbackShared->lock, LW_EXCLUSIVE);
+	entry = (CardFeedbackEntry *) hash_search(FeedbackHash, key,
+											  HASH_ENTER_NULL, &found);
+	if (entry != NULL)
+	{
+		if (!found)
+		{
+			entry->logsel = logsel;
+			entry->nsamples = 1;
+		}
+		else
+		{
+			entry->logsel = cardinality_feedback_decay * entry->logsel +
+				(1.0 - cardinality_feedback_decay) * logsel;
+			entry->nsamples++;
+		}
+	}
+	LWLockRelease(&FeedbackShared->lock);
+}
+
+/*
+ * Compute the hash key for a list of implicitly AND'ed clauses.  Exactly one
+ * of 'root' and 'estate' is given, telling how to resolve Vars.  Returns
+ * false if the clauses can't be hashed.
+ */
+static bool
+feedback_signature(List *clauses, PlannerInfo *root, EState *estate,
+				   CardFeedbackKey *key)
+{
+	FeedbackHashContext context;
+	uint64		hash;
+
+	context.root = root;
+	context.estate = estate;
+	context.varno = 0;
+	context.relid = InvalidOid;
+	context.multirel = false;
+
+	if (!feedback_hash_list(clauses, false, &context, &hash))
+		return false;
+
+	/* Clauses without Vars are pseudoconstant; not interesting */
+	if (context.varno == 0)
+		return false;
+
+	/* Zero the padding, since the key is hashed as a blob */
+	memset(key, 0, sizeof(CardFeedbackKey));
+	key->relid = context.multirel ? InvalidOid : context.relid;
+	key->signature = hash;
+
+	return true;
+}
+
+/*
+ * Hash the elements of a list.  Unless 'ordered', the result doesn't depend
+ * on the order of the elements.
+ */
+static bool
+feedback_hash_list(List *list, bool ordered, FeedbackHashContext *context,
+				   uint64 *hash)
+{
+	uint64		result = 0;
+	ListCell   *lc;
+
+	foreach(lc, list)
+	{
+		uint64		elemhash;
+
+		if (!feedback_hash_node((Node *) lfirst(lc), context, &elemhash))
+			return false;
+
+		if (ordered)
+			result = hash_combine64(result, elemhash);
+		else
+			result += elemhash;
+	}
+
+	*hash = hash_combine64(DatumGetUInt64(hash_uint32_extended(list_length(list), 0)),
+						   result);
+	return true;
+}
+
+/*
+ * Hash one expression node.
+ */
+static bool
+feedback_hash_node(Node *node, FeedbackHashContext *context, uint64 *hash)
+{
+	uint64		result;
+	uint64		subhash;
+
+	if (node == NULL)
+	{
+		*hash = 0;
+		return true;
+	}
+
+	check_stack_depth();
+
+	/* Look through RestrictInfos and binary-compatible relabelings */
+	if (IsA(node, RestrictInfo))
+	{
+		RestrictInfo *rinfo = (RestrictInfo *) node;
+
+		/* Pseudoconstant quals end up in a gating Result node */
+		if (rinfo->pseudoconstant)
+			return false;
+		return feedback_hash_node((Node *) rinfo->clause, context, hash);
+	}
+	if (IsA(node, RelabelType))
+		return feedback_hash_node((Node *) ((RelabelType *) node)->arg,
+								  context, hash);
+
+	result = DatumGetUInt64(hash_uint32_extended((uint32) nodeTag(node), 0));
+
+	switch (nodeTag(node))
+	{
+		case T_List:
+			if (!feedback_hash_list((List *) node, false, context, &subhash))
+				return false;
+			result = hash_combine64(result, subhash);
+			break;
+
+		case T_Var:
+			{
+				Var		   *var = (Var *) node;
+				Index		varno;
+				AttrNumber	attno;
+				RangeTblEntry *rte;
+
+				if (var->varlevelsup != 0)
+					return false;
+
+				/*
+				 * The executor's Vars may have been renumbered to refer to
+				 * the input of a join; varnoold/varoattno still tell where
+				 * they came from.
+				 */
+				if (context->root != NULL)
+				{
+					varno = var->varno;
+					attno = var->varattno;
+					if (varno < 1 || varno >= context->root->simple_rel_array_size)
+						return false;
+					rte = context->root->simple_rte_array[varno];
+				}
+				else
+				{
+					varno = var->varnoold;
+					attno = var->varoattno;
+					if (varno < 1 || varno > context->estate->es_range_table_size)
+						return false;
+					rte = exec_rt_fetch(varno, context->estate);
+				}
+				if (rte == NULL || rte->rtekind != RTE_RELATION)
+					return false;
+
+				if (context->varno == 0)
+				{
+					context->varno = varno;
+					context->relid = rte->relid;
+				}
+				else if (context->varno != varno)
+					context->multirel = true;
+
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended(rte->relid, 0)));
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended((uint32) attno, 0)));
+			}
+			break;
+
+		case T_Const:
+			{
+				Const	   *con = (Const *) node;
+
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended(con->consttype, 0)));
+				if (con->constisnull)
+					subhash = 1;
+				else if (con->constbyval)
+					subhash = DatumGetUInt64(hash_any_extended((unsigned char *) &con->constvalue,
+															   sizeof(Datum), 0));
+				else
+					subhash = DatumGetUInt64(hash_any_extended((unsigned char *) DatumGetPointer(con->constvalue),
+															   (int) datumGetSize(con->constvalue,
+																				  false,
+																				  con->constlen),
+															   0));
+				result = hash_combine64(result, subhash);
+			}
+			break;
+
+		case T_Param:
+			{
+				Param	   *param = (Param *) node;
+
+				/* PARAM_EXEC values change from one rescan to the next */
+				if (param->paramkind != PARAM_EXTERN)
+					return false;
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended(param->paramid, 0)));
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended(param->paramtype, 0)));
+			}
+			break;
+
+		case T_OpExpr:
+		case T_DistinctExpr:
+		case T_NullIfExpr:
+			{
+				OpExpr	   *opexpr = (OpExpr *) node;
+				Oid			opno = opexpr->opno;
+				List	   *args = opexpr->args;
+
+				/*
+				 * Hash "a < b" and "b > a" alike: use the lower-numbered
+				 * operator of a commutator pair, swapping the arguments to
+				 * match.  The arguments of a self-commutative operator hash
+				 * in either order.
+				 */
+				if (IsA(node, OpExpr) && list_length(args) == 2)
+				{
+					Oid			commutator = get_commutator(opno);
+
+					if (OidIsValid(commutator))
+					{
+						if (commutator < opno)
+						{
+							opno = commutator;
+							args = list_make2(lsecond(args), linitial(args));
+						}
+						else if (commutator == opno)
+						{
+							if (!feedback_hash_list(args, false, context,
+													&subhash))
+								return false;
+							result = hash_combine64(result,
+													DatumGetUInt64(hash_uint32_extended(opno, 0)));
+							result = hash_combine64(result, subhash);
+							break;
+						}
+					}
+				}
+
+				if (!feedback_hash_list(args, true, context, &subhash))
+					return false;
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended(opno, 0)));
+				result = hash_combine64(result, subhash);
+			}
+			break;
+
+		case T_ScalarArrayOpExpr:
+			{
+				ScalarArrayOpExpr *saop = (ScalarArrayOpExpr *) node;
+
+				if (!feedback_hash_list(saop->args, true, context, &subhash))
+					return false;
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended(saop->opno, 0)));
+				result = hash_combine64(result, saop->useOr ? 1 : 0);
+				result = hash_combine64(result, subhash);
+			}
+			break;
+
+		case T_BoolExpr:
+			{
+				BoolExpr   *boolexpr = (BoolExpr *) node;
+
+				if (!feedback_hash_list(boolexpr->args,
+										boolexpr->boolop == NOT_EXPR,
+										context, &subhash))
+					return false;
+				result = hash_combine64(result, (uint64) boolexpr->boolop);
+				result = hash_combine64(result, subhash);
+			}
+			break;
+
+		case T_NullTest:
+			{
+				NullTest   *ntest = (NullTest *) node;
+
+				if (!feedback_hash_node((Node *) ntest->arg, context, &subhash))
+					return false;
+				result = hash_combine64(result, (uint64) ntest->nulltesttype);
+				result = hash_combine64(result, ntest->argisrow ? 1 : 0);
+				result = hash_combine64(result, subhash);
+			}
+			break;
+
+		case T_BooleanTest:
+			{
+				BooleanTest *btest = (BooleanTest *) node;
+
+				if (!feedback_hash_node((Node *) btest->arg, context, &subhash))
+					return false;
+				result = hash_combine64(result, (uint64) btest->booltesttype);
+				result = hash_combine64(result, subhash);
+			}
+			break;
+
+		case T_FuncExpr:
+			{
+				FuncExpr   *funcexpr = (FuncExpr *) node;
+
+				if (!feedback_hash_list(funcexpr->args, true, context,
+										&subhash))
+					return false;
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended(funcexpr->funcid, 0)));
+				result = hash_combine64(result, subhash);
+			}
+			break;
+
+		case T_ArrayExpr:
+			{
+				ArrayExpr  *arrayexpr = (ArrayExpr *) node;
+
+				if (!feedback_hash_list(arrayexpr->elements, true, context,
+										&subhash))
+					return false;
+				result = hash_combine64(result,
+										DatumGetUInt64(hash_uint32_extended(arrayexpr->element_typeid, 0)));
+				result = hash_combine64(result, subhash);
+			}
+			break;
+
+		default:
+			return false;
+	}
+
+	*hash = result;
+	return true;
+}
+
+/*
+ * pg_cardinality_feedback_reset
+ *	  Forget everything learned so far.
+ */
+Datum
+pg_cardinality_feedback_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	CardFeedbackEntry *entry;
+
+	LWLockAcquire(&FeedbackShared->lock, LW_EXCLUSIVE);
+	hash_seq_init(&hash_seq, FeedbackHash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(FeedbackHash, &entry->key, HASH_REMOVE, NULL);
+	LWLockRelease(&FeedbackShared->lock);
+
+	PG_RETURN_VOID();
+}
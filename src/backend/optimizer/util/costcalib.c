@@ -0,0 +1,623 @@
+/*-------------------------------------------------------------------------
+ *
+ * costcalib.c
+ *	  Calibration of the planner's cost constants against measured times
+ *
+ * When enable_cost_calibration is on, every query executed with timing and
+ * buffer instrumentation (EXPLAIN (ANALYZE, BUFFERS), auto_explain with
+ * log_analyze and log_buffers) contributes one sample per sequential scan,
+ * index scan, sort and hash join node.  A sample pairs the time the node
+ * spent on its own work, excluding its children, with the quantities the
+ * corresponding cost function charges for: pages read, tuples processed,
+ * operators evaluated and so on, counted from what actually happened.
+ *
+ * For each kind of node, and for scans each tablespace, we accumulate the
+ * normal equations of the least-squares fit of time against those terms,
+ * so keeping any number of samples takes constant space.  On demand, the
+ * coefficients are solved for by ridge regression, giving the number of
+ * milliseconds each term costs on this host.  Expressed relative to the
+ * cost of a sequential page read in the database's default tablespace,
+ * those are directly comparable to seq_page_cost, random_page_cost,
+ * cpu_tuple_cost and cpu_operator_cost, and can be used to set them, per
+ * tablespace where the storage differs.
+ *
+ * The ridge penalty is scaled by the diagonal of X'X, so that it does not
+ * depend on the units of the terms.  Terms that never occurred (no pages
+ * read because everything was cached, say) can't be fitted and are
+ * reported as unknown.
+ *
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/optimizer/util/costcalib.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/parallel.h"
+#include "executor/instrument.h"
+#include "fmgr.h"
+#include "funcapi.h"
+#include "miscadmin.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/costcalib.h"
+#include "optimizer/optimizer.h"
+#include "storage/lwlock.h"
+#include "storage/shmem.h"
+#include "utils/builtins.h"
+#include "utils/hsearch.h"
+#include "utils/rel.h"
+#include "utils/tuplestore.h"
+
+
+/* GUC parameters */
+bool		enable_cost_calibration = false;
+double		cost_calibration_ridge = 0.01;
+
+/* Maximum number of (node kind, tablespace) combinations tracked */
+#define CALIB_MAX_ENTRIES	64
+
+/* Maximum number of cost terms of any kind of node */
+#define CALIB_MAX_TERMS		3
+
+#define LOG2(x)  (log(x) / 0.693147180559945)
+
+typedef enum CalibNodeKind
+{
+	CALIB_SEQSCAN,
+	CALIB_INDEXSCAN,
+	CALIB_SORT,
+	CALIB_HASHJOIN
+} CalibNodeKind;
+
+/*
+ * The terms of each kind of node, named after the cost constant each one is
+ * charged at.
+ */
+typedef struct CalibNodeInfo
+{
+	const char *name;
+	int			nterms;
+	const char *params[CALIB_MAX_TERMS];
+} CalibNodeInfo;
+
+static const CalibNodeInfo calib_nodes[] = {
+	/* pages read, tuples scanned, qual operators evaluated */
+	{"Seq Scan", 3, {"seq_page_cost", "cpu_tuple_cost", "cpu_operator_cost"}},
+	/* pages read, tuples fetched, qual operators evaluated */
+	{"Index Scan", 3, {"random_page_cost", "cpu_tuple_cost", "cpu_operator_cost"}},
+	/* comparisons (at two operators apiece), temp pages */
+	{"Sort", 2, {"cpu_operator_cost", "seq_page_cost"}},
+	/* hash clause evaluations, tuples hashed and emitted, temp pages */
+	{"Hash Join", 3, {"cpu_operator_cost", "cpu_tuple_cost", "seq_page_cost"}}
+};
+
+typedef struct CalibKey
+{
+	int32		kind;			/* CalibNodeKind */
+	Oid			spcid;			/* tablespace of scans, else InvalidOid */
+} CalibKey;
+
+typedef struct CalibEntry
+{
+	CalibKey	key;			/* hash key (must be first) */
+	int64		nsamples;
+	double		xtx[CALIB_MAX_TERMS][CALIB_MAX_TERMS];	/* X'X */
+	double		xty[CALIB_MAX_TERMS];	/* X'y, y in milliseconds */
+} CalibEntry;
+
+typedef struct CalibShared
+{
+	LWLock		lock;			/* protects the hash table */
+} CalibShared;
+
+static CalibShared *CalibSharedState = NULL;
+static HTAB *CalibHash = NULL;
+
+static bool calib_record_walker(PlanState *planstate, void *context);
+static void calib_record_node(PlanState *planstate);
+static void calib_store(CalibNodeKind kind, Oid spcid, double *x, double ms);
+static bool calib_count_ops_walker(Node *node, int *count);
+static double calib_count_ops(List *quals);
+static bool calib_fit(CalibEntry *entry, double *beta, bool *known);
+
+
+/*
+ * Estimate shared memory space needed.
+ */
+Size
+CostCalibrationShmemSize(void)
+{
+	Size		size;
+
+	size = MAXALIGN(sizeof(CalibShared));
+	size = add_size(size, hash_estimate_size(CALIB_MAX_ENTRIES,
+											 sizeof(CalibEntry)));
+	return size;
+}
+
+/*
+ * Allocate and initialize shared memory.
+ */
+void
+CostCalibrationShmemInit(void)
+{
+	HASHCTL		info;
+	bool		found;
+
+	CalibSharedState = (CalibShared *)
+		ShmemInitStruct("Cost Calibration",
+						sizeof(CalibShared),
+						&found);
+	if (!found)
+		LWLockInitialize(&CalibSharedState->lock, LWTRANCHE_COST_CALIBRATION);
+
+	memset(&info, 0, sizeof(info));
+	info.keysize = sizeof(CalibKey);
+	info.entrysize = sizeof(CalibEntry);
+	CalibHash = ShmemInitHash("Cost Calibration Hash",
+							  CALIB_MAX_ENTRIES, CALIB_MAX_ENTRIES,
+							  &info,
+							  HASH_ELEM | HASH_BLOBS | HASH_FIXED_SIZE);
+}
+
+/*
+ * cost_calibration_record
+ *	  Take samples from the nodes of an executed plan tree.
+ *
+ * Called at executor end for queries run with timing and buffer
+ * instrumentation.
+ */
+void
+cost_calibration_record(PlanState *planstate)
+{
+	/* The leader sees the workers' counts; don't report them twice */
+	if (IsParallelWorker())
+		return;
+
+	(void) calib_record_walker(planstate, NULL);
+}
+
+/*
+ * Walk the plan state tree bottom-up, so that the instrumentation of a
+ * node's children has been finalized by the time the node looks at it.
+ */
+static bool
+calib_record_walker(PlanState *planstate, void *context)
+{
+	Instrumentation *instr = planstate->instrument;
+
+	(void) planstate_tree_walker(planstate, calib_record_walker, context);
+
+	if (instr == NULL || !instr->need_timer || !instr->need_bufusage)
+		return false;
+
+	InstrEndLoop(instr);
+	if (instr->nloops > 0)
+		calib_record_node(planstate);
+
+	return false;
+}
+
+#define BLOCKS_READ(instr) \
+	((double) (instr)->bufusage.shared_blks_read + \
+	 (double) (instr)->bufusage.local_blks_read)
+#define TEMP_BLOCKS(instr) \
+	((double) (instr)->bufusage.temp_blks_read + \
+	 (double) (instr)->bufusage.temp_blks_written)
+
+/*
+ * Take a sample from one node, if it's of a kind we calibrate.
+ *
+ * The times and buffer counts of a node include those of its children,
+ * which we subtract to get at the node's own work.
+ */
+static void
+calib_record_node(PlanState *planstate)
+{
+	Plan	   *plan = planstate->plan;
+	Instrumentation *instr = planstate->instrument;
+	CalibNodeKind kind;
+	Oid			spcid = InvalidOid;
+	double		x[CALIB_MAX_TERMS];
+	double		ms;
+
+	switch (nodeTag(plan))
+	{
+		case T_SeqScan:
+			{
+				double		tuples = instr->ntuples + instr->nfiltered1;
+
+				kind = CALIB_SEQSCAN;
+				spcid = ((ScanState *) planstate)->ss_currentRelation->rd_rel->reltablespace;
+				x[0] = BLOCKS_READ(instr);
+				x[1] = tuples;
+				x[2] = tuples * calib_count_ops(plan->qual);
+				ms = instr->total * 1000.0;
+			}
+			break;
+
+		case T_IndexScan:
+		case T_IndexOnlyScan:
+			{
+				double		tuples;
+				List	   *indexquals;
+
+				if (IsA(plan, IndexScan))
+					indexquals = ((IndexScan *) plan)->indexqualorig;
+				else
+					indexquals = ((IndexOnlyScan *) plan)->indexqual;
+
+				tuples = instr->ntuples + instr->nfiltered1 + instr->nfiltered2;
+
+				kind = CALIB_INDEXSCAN;
+				spcid = ((ScanState *) planstate)->ss_currentRelation->rd_rel->reltablespace;
+				x[0] = BLOCKS_READ(instr);
+				x[1] = tuples;
+				x[2] = tuples * (calib_count_ops(indexquals) +
+								 calib_count_ops(plan->qual));
+				ms = instr->total * 1000.0;
+			}
+			break;
+
+		case T_Sort:
+			{
+				Instrumentation *child = outerPlanState(planstate)->instrument;
+				double		input;
+
+				if (child == NULL)
+					return;
+				InstrEndLoop(child);
+
+				input = child->ntuples;
+				kind = CALIB_SORT;
+				x[0] = input > 1 ? 2.0 * input * LOG2(input) : 0.0;
+				x[1] = TEMP_BLOCKS(instr) - TEMP_BLOCKS(child);
+				x[2] = 0.0;
+				ms = (instr->total - child->total) * 1000.0;
+			}
+			break;
+
+		case T_HashJoin:
+			{
+				Instrumentation *outer = outerPlanState(planstate)->instrument;
+				Instrumentation *inner;
+				double		nclauses;
+
+				/*
+				 * The Hash node's time is all spent building the hash table,
+				 * which is the join's business too; look past it.
+				 */
+				inner = outerPlanState(innerPlanState(planstate))->instrument;
+				if (outer == NULL || inner == NULL)
+					return;
+				InstrEndLoop(outer);
+				InstrEndLoop(inner);
+
+				nclauses = list_length(((HashJoin *) plan)->hashclauses);
+				kind = CALIB_HASHJOIN;
+				x[0] = nclauses * (inner->ntuples + outer->ntuples);
+				x[1] = inner->ntuples + instr->ntuples;
+				x[2] = TEMP_BLOCKS(instr) - TEMP_BLOCKS(outer) - TEMP_BLOCKS(inner);
+				ms = (instr->total - outer->total - inner->total) * 1000.0;
+			}
+			break;
+
+		default:
+			return;
+	}
+
+	/* Scans of relations in the default tablespace */
+	if (kind == CALIB_SEQSCAN || kind == CALIB_INDEXSCAN)
+	{
+		if (!OidIsValid(spcid))
+			spcid = MyDatabaseTableSpace;
+	}
+
+	/* Timer granularity can make the subtractions above come out negative */
+	if (ms < 0.0)
+		return;
+
+	calib_store(kind, spcid, x, ms);
+}
+
+/*
+ * Fold one sample into the normal equations.  If the table is full, samples
+ * of kinds we haven't seen before are dropped.
+ */
+static void
+calib_store(CalibNodeKind kind, Oid spcid, double *x, double ms)
+{
+	CalibKey	key;
+	CalibEntry *entry;
+	int			nterms = calib_nodes[kind].nterms;
+	bool		found;
+	int			i,
+				j;
+
+	/* No negative quantities; those would be measurement noise too */
+	for (i = 0; i < nterms; i++)
+		x[i] = Max(x[i], 0.0);
+
+	key.kind = (int32) kind;
+	key.spcid = spcid;
+
+	LWLockAcquire(&CalibSharedState->lock, LW_EXCLUSIVE);
+	entry = (CalibEntry *) hash_search(CalibHash, &key, HASH_ENTER_NULL,
+									   &found);
+	if (entry != NULL)
+	{
+		if (!found)
+		{
+			entry->nsamples = 0;
+			memset(entry->xtx, 0, sizeof(entry->xtx));
+			memset(entry->xty, 0, sizeof(entry->xty));
+		}
+
+		entry->nsamples++;
+		for (i = 0; i < nterms; i++)
+		{
+			for (j = 0; j < nterms; j++)
+				entry->xtx[i][j] += x[i] * x[j];
+			entry->xty[i] += x[i] * ms;
+		}
+	}
+	LWLockRelease(&CalibSharedState->lock);
+}
+
+/*
+ * Count the operators and functions in a list of quals, which is what
+ * cost_qual_eval() charges cpu_operator_cost for, give or take procost.
+ */
+static bool
+calib_count_ops_walker(Node *node, int *count)
+{
+	if (node == NULL)
+		return false;
+	if (IsA(node, OpExpr) ||
+		IsA(node, DistinctExpr) ||
+		IsA(node, NullIfExpr) ||
+		IsA(node, ScalarArrayOpExpr) ||
+		IsA(node, FuncExpr))
+		(*count)++;
+	return expression_tree_walker(node, calib_count_ops_walker,
+								  (void *) count);
+}
+
+static double
+calib_count_ops(List *quals)
+{
+	int			count = 0;
+
+	(void) calib_count_ops_walker((Node *) quals, &count);
+	return (double) count;
+}
+
+/*
+ * Solve (X'X + lambda * diag(X'X)) beta = X'y for beta, by Gaussian
+ * elimination with partial pivoting.  Terms whose column is all zero are
+ * left out, and flagged as not known.  Returns false if the system is
+ * singular, which can only happen with cost_calibration_ridge = 0.
+ */
+static bool
+calib_fit(CalibEntry *entry, double *beta, bool *known)
+{
+	int			n = calib_nodes[entry->key.kind].nterms;
+	double		a[CALIB_MAX_TERMS][CALIB_MAX_TERMS + 1];
+	double		scale = 0.0;
+	int			i,
+				j,
+				k;
+
+	for (i = 0; i < n; i++)
+	{
+		known[i] = entry->xtx[i][i] > 0.0;
+		for (j = 0; j < n; j++)
+		{
+			if (known[i] && entry->xtx[j][j] > 0.0)
+				a[i][j] = entry->xtx[i][j];
+			else
+				a[i][j] = 0.0;
+		}
+		if (known[i])
+		{
+			a[i][i] *= 1.0 + cost_calibration_ridge;
+			a[i][n] = entry->xty[i];
+		}
+		else
+		{
+			a[i][i] = 1.0;
+			a[i][n] = 0.0;
+		}
+		scale = Max(scale, a[i][i]);
+	}
+
+	for (k = 0; k < n; k++)
+	{
+		int			pivot = k;
+
+		for (i = k + 1; i < n; i++)
+		{
+			if (fabs(a[i][k]) > fabs(a[pivot][k]))
+				pivot = i;
+		}
+		if (fabs(a[pivot][k]) <= 1e-12 * scale)
+			return false;
+		if (pivot != k)
+		{
+			for (j = k; j <= n; j++)
+			{
+				double		tmp = a[k][j];
+
+				a[k][j] = a[pivot][j];
+				a[pivot][j] = tmp;
+			}
+		}
+		for (i = k + 1; i < n; i++)
+		{
+			double		factor = a[i][k] / a[k][k];
+
+			for (j = k; j <= n; j++)
+				a[i][j] -= factor * a[k][j];
+		}
+	}
+
+	for (i = n - 1; i >= 0; i--)
+	{
+		double		sum = a[i][n];
+
+		for (j = i + 1; j < n; j++)
+			sum -= a[i][j] * beta[j];
+		beta[i] = sum / a[i][i];
+	}
+
+	return true;
+}
+
+/*
+ * Returns the fitted cost coefficients, one row per node kind, tablespace
+ * and cost term.
+ */
+Datum
+pg_get_cost_calibration(PG_FUNCTION_ARGS)
+{
+#define PG_GET_COST_CALIBRATION_COLS	6
+	ReturnSetInfo *rsinfo = (ReturnSetInfo *) fcinfo->resultinfo;
+	TupleDesc	tupdesc;
+	Tuplestorestate *tupstore;
+	MemoryContext per_query_ctx;
+	MemoryContext oldcontext;
+	HASH_SEQ_STATUS hash_seq;
+	CalibEntry *entry;
+	CalibEntry *entries;
+	int			nentries = 0;
+	double		ref_ms = 0.0;
+	int			e;
+
+	/* check to see if caller supports us returning a tuplestore */
+	if (rsinfo == NULL || !IsA(rsinfo, ReturnSetInfo))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("set-valued function called in context that cannot accept a set")));
+	if (!(rsinfo->allowedModes & SFRM_Materialize))
+		ereport(ERROR,
+				(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+				 errmsg("materialize mode required, but it is not " \
+						"allowed in this context")));
+
+	/* Build a tuple descriptor for our result type */
+	if (get_call_result_type(fcinfo, NULL, &tupdesc) != TYPEFUNC_COMPOSITE)
+		elog(ERROR, "return type must be a row type");
+
+	per_query_ctx = rsinfo->econtext->ecxt_per_query_memory;
+	oldcontext = MemoryContextSwitchTo(per_query_ctx);
+
+	tupstore = tuplestore_begin_heap(true, false, work_mem);
+	rsinfo->returnMode = SFRM_Materialize;
+	rsinfo->setResult = tupstore;
+	rsinfo->setDesc = tupdesc;
+	MemoryContextSwitchTo(oldcontext);
+
+	/* Copy the entries out, so as not to fit while holding the lock */
+	entries = (CalibEntry *) palloc(CALIB_MAX_ENTRIES * sizeof(CalibEntry));
+	LWLockAcquire(&CalibSharedState->lock, LW_SHARED);
+	hash_seq_init(&hash_seq, CalibHash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+	{
+		if (nentries >= CALIB_MAX_ENTRIES)
+		{
+			hash_seq_term(&hash_seq);
+			break;
+		}
+		memcpy(&entries[nentries++], entry, sizeof(CalibEntry));
+	}
+	LWLockRelease(&CalibSharedState->lock);
+
+	/*
+	 * Everything is expressed relative to a sequential page read in the
+	 * database's default tablespace, which costs seq_page_cost.
+	 */
+	for (e = 0; e < nentries; e++)
+	{
+		double		beta[CALIB_MAX_TERMS];
+		bool		known[CALIB_MAX_TERMS];
+
+		if (entries[e].key.kind == CALIB_SEQSCAN &&
+			entries[e].key.spcid == MyDatabaseTableSpace &&
+			calib_fit(&entries[e], beta, known) &&
+			known[0] && beta[0] > 0.0)
+			ref_ms = beta[0];
+	}
+
+	for (e = 0; e < nentries; e++)
+	{
+		const CalibNodeInfo *info = &calib_nodes[entries[e].key.kind];
+		double		beta[CALIB_MAX_TERMS];
+		bool		known[CALIB_MAX_TERMS];
+		bool		solved;
+		int			i;
+
+		solved = calib_fit(&entries[e], beta, known);
+
+		for (i = 0; i < info->nterms; i++)
+		{
+			Datum		values[PG_GET_COST_CALIBRATION_COLS];
+			bool		nulls[PG_GET_COST_CALIBRATION_COLS];
+
+			MemSet(nulls, 0, sizeof(nulls));
+
+			values[0] = CStringGetTextDatum(info->name);
+			if (OidIsValid(entries[e].key.spcid))
+				values[1] = ObjectIdGetDatum(entries[e].key.spcid);
+			else
+				nulls[1] = true;
+			values[2] = CStringGetTextDatum(info->params[i]);
+			values[3] = Int64GetDatum(entries[e].nsamples);
+			if (solved && known[i])
+			{
+				values[4] = Float8GetDatum(beta[i]);
+				if (ref_ms > 0.0)
+					values[5] = Float8GetDatum(beta[i] * seq_page_cost / ref_ms);
+				else
+					nulls[5] = true;
+			}
+			else
+			{
+				nulls[4] = true;
+				nulls[5] = true;
+			}
+
+			tuplestore_putvalues(tupstore, tupdesc, values, nulls);
+		}
+	}
+
+	/* clean up and return the tuplestore */
+	tuplestore_donestoring(tupstore);
+
+	return (Datum) 0;
+}
+
+/*
+ * pg_cost_calibration_reset
+ *	  Discard all samples taken so far.
+ */
+Datum
+pg_cost_calibration_reset(PG_FUNCTION_ARGS)
+{
+	HASH_SEQ_STATUS hash_seq;
+	CalibEntry *entry;
+
+	LWLockAcquire(&CalibSharedState->lock, LW_EXCLUSIVE);
+	hash_seq_init(&hash_seq, CalibHash);
+	while ((entry = hash_seq_search(&hash_seq)) != NULL)
+		hash_search(CalibHash, &entry->key, HASH_REMOVE, NULL);
+	LWLockRelease(&CalibSharedState->lock);
+
+	PG_RETURN_VOID();
+}
@@ -34,6 +34,7 @@
 #include "foreign/fdwapi.h"
 #include "miscadmin.h"
 #include "nodes/makefuncs.h"
+#include "nodes/nodeFuncs.h"
 #include "nodes/supportnodes.h"
 #include "optimizer/clauses.h"
 #include "optimizer/cost.h"
@@ -1312,6 +1313,9 @@ get_relation_statistics(RelOptInfo *rel, Relation relation)
 		HeapTuple	htup;
 		HeapTuple	dtup;
 		Bitmapset  *keys = NULL;
+		List	   *exprs = NIL;
+		Datum		datum;
+		bool		isnull;
 		int			i;
 
 		htup = SearchSysCache1(STATEXTOID, ObjectIdGetDatum(statOid));
@@ -1331,6 +1335,23 @@ get_relation_statistics(RelOptInfo *rel, Relation relation)
 		for (i = 0; i < staForm->stxkeys.dim1; i++)
 			keys = bms_add_member(keys, staForm->stxkeys.values[i]);
 
+		/*
+		 * Then the expressions, if any.  As for index expressions, run them
+		 * through eval_const_expressions so that they match the similarly
+		 * processed qual clauses, and fix up the varno if needed.
+		 */
+		datum = SysCacheGetAttr(STATEXTOID, htup,
+								Anum_pg_statistic_ext_stxexprs, &isnull);
+		if (!isnull)
+		{
+			exprs = (List *) stringToNode(TextDatumGetCString(datum));
+			exprs = (List *) eval_const_expressions(NULL, (Node *) exprs);
+			fix_opfuncids((Node *) exprs);
+
+			if (rel->relid != 1)
+				ChangeVarNodes((Node *) exprs, 1, rel->relid, 0);
+		}
+
 		/* add one StatisticExtInfo for each kind built */
 		if (statext_is_kind_built(dtup, STATS_EXT_NDISTINCT))
 		{
@@ -1340,6 +1361,7 @@ get_relation_statistics(RelOptInfo *rel, Relation relation)
 			info->rel = rel;
 			info->kind = STATS_EXT_NDISTINCT;
 			info->keys = bms_copy(keys);
+			info->exprs = copyObject(exprs);
 
 			stainfos = lcons(info, stainfos);
 		}
@@ -1352,6 +1374,7 @@ get_relation_statistics(RelOptInfo *rel, Relation relation)
 			info->rel = rel;
 			info->kind = STATS_EXT_DEPENDENCIES;
 			info->keys = bms_copy(keys);
+			info->exprs = copyObject(exprs);
 
 			stainfos = lcons(info, stainfos);
 		}
@@ -1364,6 +1387,20 @@ get_relation_statistics(RelOptInfo *rel, Relation relation)
 			info->rel = rel;
 			info->kind = STATS_EXT_MCV;
 			info->keys = bms_copy(keys);
+			info->exprs = copyObject(exprs);
+
+			stainfos = lcons(info, stainfos);
+		}
+
+		if (statext_is_kind_built(dtup, STATS_EXT_HISTOGRAM))
+		{
+			StatisticExtInfo *info = makeNode(StatisticExtInfo);
+
+			info->statOid = statOid;
+			info->rel = rel;
+			info->kind = STATS_EXT_HISTOGRAM;
+			info->keys = bms_copy(keys);
+			info->exprs = copyObject(exprs);
 
 			stainfos = lcons(info, stainfos);
 		}
@@ -3968,6 +3968,7 @@ CreateStatsStmt:
 					n->exprs = $6;
 					n->relations = $8;
 					n->stxcomment = NULL;
+					n->transformed = false;
 					n->if_not_exists = false;
 					$$ = (Node *)n;
 				}
@@ -3980,6 +3981,7 @@ CreateStatsStmt:
 					n->exprs = $9;
 					n->relations = $11;
 					n->stxcomment = NULL;
+					n->transformed = false;
 					n->if_not_exists = true;
 					$$ = (Node *)n;
 				}
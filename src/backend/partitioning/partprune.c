@@ -48,6 +48,7 @@
 #include "optimizer/appendinfo.h"
 #include "optimizer/cost.h"
 #include "optimizer/optimizer.h"
+#include "optimizer/paramassign.h"
 #include "optimizer/pathnode.h"
 #include "parser/parsetree.h"
 #include "partitioning/partbounds.h"
@@ -319,6 +320,136 @@ make_partition_pruneinfo(PlannerInfo *root, RelOptInfo *parentrel,
 	return pruneinfo;
 }
 
+/*
+ * make_hashjoin_pruning_quals
+ *		Builds pruning quals for 'outerrel', the partitioned outer rel of a
+ *		hash join, that compare its partition key with the range of the
+ *		values of the inner join key.
+ *
+ * 'hashclauses' are the join's hash clauses, with the outer rel's expressions
+ * on the left.  For each clause that equates a partition key column with an
+ * inner value of the same type, we make a pair of PARAM_EXEC params, which
+ * the Hash node sets to the minimum and maximum of the inner values while
+ * building the hash table, and quals bounding the partition key by them.
+ * For each such clause, we also append its position in 'hashclauses', the
+ * btree comparison function and collation to use for the inner values, and
+ * the paramids of its minimum and maximum to the output lists.
+ *
+ * Returns the list of quals, or NIL if no clause is usable.
+ */
+List *
+make_hashjoin_pruning_quals(PlannerInfo *root, RelOptInfo *outerrel,
+							List *hashclauses,
+							List **keyidx, List **cmpfuncs,
+							List **collations, List **params)
+{
+	PartitionScheme part_scheme = outerrel->part_scheme;
+	List	   *result = NIL;
+	ListCell   *lc;
+	int			i = 0;
+
+	*keyidx = *cmpfuncs = *collations = *params = NIL;
+
+	/* Hash partitioning can't make use of a range */
+	if (part_scheme == NULL ||
+		part_scheme->strategy == PARTITION_STRATEGY_HASH)
+		return NIL;
+
+	foreach(lc, hashclauses)
+	{
+		OpExpr	   *hclause = lfirst_node(OpExpr, lc);
+		Expr	   *outerkey = (Expr *) linitial(hclause->args);
+		Expr	   *leftop = outerkey;
+		int			partkeyidx = -1;
+		int			k;
+		Oid			opfamily;
+		Oid			opcintype;
+		Oid			partcoll;
+		Oid			lefttype;
+		Oid			righttype;
+		Oid			geop;
+		Oid			leop;
+		Oid			cmpfunc;
+		Param	   *minparam;
+		Param	   *maxparam;
+
+		if (IsA(leftop, RelabelType))
+			leftop = ((RelabelType *) leftop)->arg;
+
+		for (k = 0; k < part_scheme->partnatts && partkeyidx < 0; k++)
+		{
+			ListCell   *lc2;
+
+			foreach(lc2, outerrel->partexprs[k])
+			{
+				if (equal(leftop, lfirst(lc2)))
+				{
+					partkeyidx = k;
+					break;
+				}
+			}
+		}
+
+		if (partkeyidx < 0)
+		{
+			i++;
+			continue;
+		}
+
+		/*
+		 * The inner values must be comparable by the partition key's own
+		 * btree opfamily, with the partition key's collation.
+		 */
+		opfamily = part_scheme->partopfamily[partkeyidx];
+		opcintype = part_scheme->partopcintype[partkeyidx];
+		partcoll = part_scheme->partcollation[partkeyidx];
+		op_input_types(hclause->opno, &lefttype, &righttype);
+
+		if (lefttype != opcintype || righttype != opcintype ||
+			!op_in_opfamily(hclause->opno, opfamily) ||
+			hclause->inputcollid != partcoll)
+		{
+			i++;
+			continue;
+		}
+
+		geop = get_opfamily_member(opfamily, opcintype, opcintype,
+								   BTGreaterEqualStrategyNumber);
+		leop = get_opfamily_member(opfamily, opcintype, opcintype,
+								   BTLessEqualStrategyNumber);
+		cmpfunc = get_opfamily_proc(opfamily, opcintype, opcintype,
+									BTORDER_PROC);
+		if (!OidIsValid(geop) || !OidIsValid(leop) || !OidIsValid(cmpfunc))
+		{
+			i++;
+			continue;
+		}
+
+		minparam = generate_new_exec_param(root, opcintype, -1, partcoll);
+		maxparam = generate_new_exec_param(root, opcintype, -1, partcoll);
+
+		result = lappend(result,
+						 make_opclause(geop, BOOLOID, false,
+									   (Expr *) copyObject(outerkey),
+									   (Expr *) minparam,
+									   InvalidOid, partcoll));
+		result = lappend(result,
+						 make_opclause(leop, BOOLOID, false,
+									   (Expr *) copyObject(outerkey),
+									   (Expr *) maxparam,
+									   InvalidOid, partcoll));
+
+		*keyidx = lappend_int(*keyidx, i);
+		*cmpfuncs = lappend_oid(*cmpfuncs, cmpfunc);
+		*collations = lappend_oid(*collations, partcoll);
+		*params = lappend_int(*params, minparam->paramid);
+		*params = lappend_int(*params, maxparam->paramid);
+		i++;
+	}
+
+	return result;
+}
+
 /*
  * make_partitionedrel_pruneinfo
  *		Build a List of PartitionedRelPruneInfos, one for each partitioned
@@ -113,6 +113,7 @@
 bool		autovacuum_start_daemon = false;
 int			autovacuum_max_workers;
 int			autovacuum_work_mem = -1;
+int			autovacuum_max_parallel_workers = 0;
 int			autovacuum_naptime;
 int			autovacuum_vac_thresh;
 double		autovacuum_vac_scale;
@@ -2748,19 +2749,11 @@ static PgStat_StatTabEntry *
 get_pgstat_tabentry_relid(Oid relid, bool isshared, PgStat_StatDBEntry *shared,
 						  PgStat_StatDBEntry *dbentry)
 {
-	PgStat_StatTabEntry *tabentry = NULL;
-
-	if (isshared)
-	{
-		if (PointerIsValid(shared))
-			tabentry = hash_search(shared->tables, &relid,
-								   HASH_FIND, NULL);
-	}
-	else if (PointerIsValid(dbentry))
-		tabentry = hash_search(dbentry->tables, &relid,
-							   HASH_FIND, NULL);
+	/* A table can't have stats if its database has none */
+	if (isshared ? !PointerIsValid(shared) : !PointerIsValid(dbentry))
+		return NULL;
 
-	return tabentry;
+	return pgstat_fetch_stat_tabentry_extended(isshared, relid);
 }
 
 /*
@@ -2892,6 +2885,9 @@ table_recheck_autovac(Oid relid, HTAB *table_toast_map,
 			(!wraparound ? VACOPT_SKIP_LOCKED : 0);
 		tab->at_params.index_cleanup = VACOPT_TERNARY_DEFAULT;
 		tab->at_params.truncate = VACOPT_TERNARY_DEFAULT;
+		/* parallel index vacuum shares this worker's cost budget */
+		tab->at_params.nworkers = autovacuum_max_parallel_workers > 0 ?
+			autovacuum_max_parallel_workers : -1;
 		tab->at_params.freeze_min_age = freeze_min_age;
 		tab->at_params.freeze_table_age = freeze_table_age;
 		tab->at_params.multixact_freeze_min_age = multixact_freeze_min_age;
@@ -3350,8 +3346,8 @@ AutoVacuumShmemInit(void)
  *
  * Cause the next pgstats read operation to obtain fresh data, but throttle
  * such refreshing in the autovacuum launcher.  This is mostly to avoid
- * rereading the pgstats files too many times in quick succession when there
- * are many databases.
+ * copying the shared statistics too many times in quick succession when
+ * there are many databases.
  *
  * Note: we avoid throttling in the autovac worker, as it would be
  * counterproductive in the recheck logic.
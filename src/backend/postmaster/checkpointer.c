@@ -378,6 +378,8 @@ CheckpointerMain(void)
 			ExitOnAnyError = true;
 			/* Close down the database */
 			ShutdownXLOG(0, 0);
+			/* Save the statistics, now that nobody else can change them */
+			pgstat_write_statsfile();
 			/* Normal exit from the checkpointer is here */
 			proc_exit(0);		/* done */
 		}
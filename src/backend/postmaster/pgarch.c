@@ -167,9 +167,11 @@ pgarch_start(void)
 			/* Close the postmaster's sockets */
 			ClosePostmasterPorts(false);
 
-			/* Drop our connection to postmaster's shared memory, as well */
+			/*
+			 * Drop our connection to postmaster's dynamic shared memory.  We
+			 * keep the main segment, where the archiver statistics live.
+			 */
 			dsm_detach_all();
-			PGSharedMemoryDetach();
 
 			PgArchiverMain(0, NULL);
 			break;
@@ -525,7 +527,7 @@ pgarch_ArchiverCopyLoop(void)
 				pgarch_archiveDone(xlog);
 
 				/*
-				 * Tell the collector about the WAL file that we successfully
+				 * Record in the statistics the WAL file that we successfully
 				 * archived
 				 */
 				pgstat_send_archiver(xlog, false);
@@ -535,7 +537,7 @@ pgarch_ArchiverCopyLoop(void)
 			else
 			{
 				/*
-				 * Tell the collector about the WAL file that we failed to
+				 * Record in the statistics the WAL file that we failed to
 				 * archive
 				 */
 				pgstat_send_archiver(xlog, true);
@@ -113,6 +113,7 @@
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/fork_process.h"
 #include "postmaster/pgarch.h"
+#include "postmaster/proxy.h"
 #include "postmaster/postmaster.h"
 #include "postmaster/syslogger.h"
 #include "replication/logicallauncher.h"
@@ -252,9 +253,11 @@ static pid_t StartupPID = 0,
 			WalReceiverPID = 0,
 			AutoVacPID = 0,
 			PgArchPID = 0,
-			PgStatPID = 0,
 			SysLoggerPID = 0;
 
+/* PIDs of connection proxies; 0 when not running */
+static pid_t ConnectionProxyPIDs[MAX_CONNECTION_PROXIES];
+
 /* Startup process's status */
 typedef enum
 {
@@ -436,6 +439,9 @@ static bool CreateOptsFile(int argc, char *argv[], char *fullprogname);
 static pid_t StartChildProcess(AuxProcType type);
 static void StartAutovacuumWorker(void);
 static void MaybeStartWalReceiver(void);
+static void MaybeStartConnectionProxies(void);
+static void SignalConnectionProxies(int signal);
+static int	CountConnectionProxies(void);
 static void InitPostmasterDeathWatchHandle(void);
 
 /*
@@ -514,7 +520,7 @@ typedef struct
 	PGPROC	   *AuxiliaryProcs;
 	PGPROC	   *PreparedXactProcs;
 	PMSignalData *PMSignalState;
-	InheritableSocket pgStatSock;
+	PgStat_ShmemControl *PgStatShmem;
 	pid_t		PostmasterPid;
 	TimestampTz PgStartTime;
 	TimestampTz PgReloadTime;
@@ -523,6 +529,7 @@ typedef struct
 	bool		IsBinaryUpgrade;
 	int			max_safe_fds;
 	int			MaxBackends;
+	int			FastPathLockGroupsPerBackend;
 #ifdef WIN32
 	HANDLE		PostmasterHandle;
 	HANDLE		initial_signal_pipe;
@@ -1185,6 +1192,13 @@ PostmasterMain(int argc, char *argv[])
 		ereport(FATAL,
 				(errmsg("no socket created for listening")));
 
+	/*
+	 * Connection proxies listen on sockets of their own, opened here so that
+	 * configuration problems are reported at startup.
+	 */
+	if (ConnectionProxies > 0)
+		ConnectionProxyListen();
+
 	/*
 	 * If no valid TCP ports, write an empty line for listen address,
 	 * indicating the Unix socket must be used.  Note that this line is not
@@ -1322,12 +1336,6 @@ PostmasterMain(int argc, char *argv[])
 
 	whereToSendOutput = DestNone;
 
-	/*
-	 * Initialize stats collection subsystem (this does NOT start the
-	 * collector process!)
-	 */
-	pgstat_init();
-
 	/*
 	 * Initialize the autovacuum subsystem (again, no process start yet)
 	 */
@@ -1428,6 +1436,7 @@ CloseServerPorts(int status, Datum arg)
 			ListenSocket[i] = PGINVALID_SOCKET;
 		}
 	}
+	ConnectionProxyCloseSockets();
 
 	/*
 	 * Next, remove any filesystem entries for Unix sockets.  To avoid race
@@ -1776,15 +1785,13 @@ ServerLoop(void)
 				start_autovac_launcher = false; /* signal processed */
 		}
 
-		/* If we have lost the stats collector, try to start a new one */
-		if (PgStatPID == 0 &&
-			(pmState == PM_RUN || pmState == PM_HOT_STANDBY))
-			PgStatPID = pgstat_start();
-
 		/* If we have lost the archiver, try to start a new one. */
 		if (PgArchPID == 0 && PgArchStartupAllowed())
 			PgArchPID = pgarch_start();
 
+		/* Likewise for connection proxies */
+		MaybeStartConnectionProxies();
+
 		/* If we need to signal the autovacuum launcher, do so now */
 		if (avlauncher_needs_signal)
 		{
@@ -2155,6 +2162,25 @@ retry1:
 									valptr),
 							 errhint("Valid values are: \"false\", 0, \"true\", 1, \"database\".")));
 			}
+			else if (strcmp(nameptr, "proxy_token") == 0)
+				port->proxy_token = pstrdup(valptr);
+			else if (strcmp(nameptr, "proxy_client_addr") == 0)
+				port->proxy_client_addr = pstrdup(valptr);
+			else if (strcmp(nameptr, "proxy_client_port") == 0)
+				port->proxy_client_port = pstrdup(valptr);
+			else if (strcmp(nameptr, "proxy_preauth") == 0)
+			{
+				/*
+				 * These are sent by connection proxies, and checked once the
+				 * whole packet has been read.
+				 */
+				if (!parse_bool(valptr, &port->proxy_preauth))
+					ereport(FATAL,
+							(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+							 errmsg("invalid value for parameter \"%s\": \"%s\"",
+									"proxy_preauth",
+									valptr)));
+			}
 			else if (strncmp(nameptr, "_pq_.", 5) == 0)
 			{
 				/*
@@ -2562,6 +2588,7 @@ ClosePostmasterPorts(bool am_syslogger)
 			ListenSocket[i] = PGINVALID_SOCKET;
 		}
 	}
+	ConnectionProxyCloseSockets();
 
 	/* If using syslogger, close the read side of the pipe */
 	if (!am_syslogger)
@@ -2677,8 +2704,7 @@ SIGHUP_handler(SIGNAL_ARGS)
 			signal_child(PgArchPID, SIGHUP);
 		if (SysLoggerPID != 0)
 			signal_child(SysLoggerPID, SIGHUP);
-		if (PgStatPID != 0)
-			signal_child(PgStatPID, SIGHUP);
+		SignalConnectionProxies(SIGHUP);
 
 		/* Reload authentication config files too */
 		if (!load_hba())
@@ -2780,6 +2806,12 @@ pmdie(SIGNAL_ARGS)
 				pmState = PM_STOP_BACKENDS;
 			}
 
+			/*
+			 * Connection proxies stop accepting clients, and exit once their
+			 * current clients have disconnected.
+			 */
+			SignalConnectionProxies(SIGTERM);
+
 			/*
 			 * Now wait for online backup mode to end and backends to exit. If
 			 * that is already the case, PostmasterStateMachine will take the
@@ -2880,6 +2912,7 @@ reaper(SIGNAL_ARGS)
 	int			save_errno = errno;
 	int			pid;			/* process id of dead child process */
 	int			exitstatus;		/* its exit status */
+	int			i;
 
 	/*
 	 * We rely on the signal mechanism to have blocked all signals ... except
@@ -2990,8 +3023,6 @@ reaper(SIGNAL_ARGS)
 				AutoVacPID = StartAutoVacLauncher();
 			if (PgArchStartupAllowed() && PgArchPID == 0)
 				PgArchPID = pgarch_start();
-			if (PgStatPID == 0)
-				PgStatPID = pgstat_start();
 
 			/* workers may be scheduled to start now */
 			maybe_start_bgworkers();
@@ -3058,13 +3089,6 @@ reaper(SIGNAL_ARGS)
 				SignalChildren(SIGUSR2);
 
 				pmState = PM_SHUTDOWN_2;
-
-				/*
-				 * We can also shut down the stats collector now; there's
-				 * nothing left for it to do.
-				 */
-				if (PgStatPID != 0)
-					signal_child(PgStatPID, SIGQUIT);
 			}
 			else
 			{
@@ -3142,18 +3166,22 @@ reaper(SIGNAL_ARGS)
 		}
 
 		/*
-		 * Was it the statistics collector?  If so, just try to start a new
-		 * one; no need to force reset of the rest of the system.  (If fail,
-		 * we'll try again in future cycles of the main loop.)
+		 * Was it a connection proxy?  As with the archiver, there's no need
+		 * to reset the rest of the system; the sessions it served are gone,
+		 * but the backends serving them just see their connections drop.  A
+		 * new proxy is started from the main loop.
 		 */
-		if (pid == PgStatPID)
+		for (i = 0; i < ConnectionProxies; i++)
 		{
-			PgStatPID = 0;
+			if (pid == ConnectionProxyPIDs[i])
+				break;
+		}
+		if (i < ConnectionProxies)
+		{
+			ConnectionProxyPIDs[i] = 0;
 			if (!EXIT_STATUS_0(exitstatus))
-				LogChildExit(LOG, _("statistics collector process"),
+				LogChildExit(LOG, _("connection proxy"),
 							 pid, exitstatus);
-			if (pmState == PM_RUN || pmState == PM_HOT_STANDBY)
-				PgStatPID = pgstat_start();
 			continue;
 		}
 
@@ -3605,21 +3633,9 @@ HandleChildCrash(int pid, int exitstatus, const char *procname)
 		signal_child(PgArchPID, SIGQUIT);
 	}
 
-	/*
-	 * Force a power-cycle of the pgstat process too.  (This isn't absolutely
-	 * necessary, but it seems like a good idea for robustness, and it
-	 * simplifies the state-machine logic in the case where a shutdown request
-	 * arrives during crash processing.)
-	 */
-	if (PgStatPID != 0 && take_action)
-	{
-		ereport(DEBUG2,
-				(errmsg_internal("sending %s to process %d",
-								 "SIGQUIT",
-								 (int) PgStatPID)));
-		signal_child(PgStatPID, SIGQUIT);
-		allow_immediate_pgstat_restart();
-	}
+	/* Connection proxies have to go too, so their clients reconnect */
+	if (take_action)
+		SignalConnectionProxies(SIGQUIT);
 
 	/* We do NOT restart the syslogger */
 
@@ -3768,6 +3784,8 @@ PostmasterStateMachine(void)
 			signal_child(StartupPID, SIGTERM);
 		if (WalReceiverPID != 0)
 			signal_child(WalReceiverPID, SIGTERM);
+		/* connection proxies drop their clients */
+		SignalConnectionProxies(SIGINT);
 		/* checkpointer, archiver, stats, and syslogger may continue for now */
 
 		/* Now transition to PM_WAIT_BACKENDS state to wait for them to die */
@@ -3783,7 +3801,8 @@ PostmasterStateMachine(void)
 		/*
 		 * PM_WAIT_BACKENDS state ends when we have no regular backends
 		 * (including autovac workers), no bgworkers (including unconnected
-		 * ones), and no walwriter, autovac launcher or bgwriter.  If we are
+		 * ones), and no walwriter, autovac launcher, bgwriter or connection
+		 * proxy (proxies hold client connections to backends).  If we are
 		 * doing crash recovery or an immediate shutdown then we expect the
 		 * checkpointer to exit as well, otherwise not. The archiver, stats,
 		 * and syslogger processes are disregarded since they are not
@@ -3799,7 +3818,8 @@ PostmasterStateMachine(void)
 			(CheckpointerPID == 0 ||
 			 (!FatalError && Shutdown < ImmediateShutdown)) &&
 			WalWriterPID == 0 &&
-			AutoVacPID == 0)
+			AutoVacPID == 0 &&
+			CountConnectionProxies() == 0)
 		{
 			if (Shutdown >= ImmediateShutdown || FatalError)
 			{
@@ -3843,12 +3863,10 @@ PostmasterStateMachine(void)
 					FatalError = true;
 					pmState = PM_WAIT_DEAD_END;
 
-					/* Kill the walsenders, archiver and stats collector too */
+					/* Kill the walsenders and archiver too */
 					SignalChildren(SIGQUIT);
 					if (PgArchPID != 0)
 						signal_child(PgArchPID, SIGQUIT);
-					if (PgStatPID != 0)
-						signal_child(PgStatPID, SIGQUIT);
 				}
 			}
 		}
@@ -3883,8 +3901,7 @@ PostmasterStateMachine(void)
 		 * normal state transition leading up to PM_WAIT_DEAD_END, or during
 		 * FatalError processing.
 		 */
-		if (dlist_is_empty(&BackendList) &&
-			PgArchPID == 0 && PgStatPID == 0)
+		if (dlist_is_empty(&BackendList) && PgArchPID == 0)
 		{
 			/* These other guys should be dead already */
 			Assert(StartupPID == 0);
@@ -4084,8 +4101,7 @@ TerminateChildren(int signal)
 		signal_child(AutoVacPID, signal);
 	if (PgArchPID != 0)
 		signal_child(PgArchPID, signal);
-	if (PgStatPID != 0)
-		signal_child(PgStatPID, signal);
+	SignalConnectionProxies(signal);
 }
 
 /*
@@ -4401,6 +4417,22 @@ BackendInitialize(Port *port)
 	if (status != STATUS_OK)
 		proc_exit(0);
 
+	/*
+	 * If the connection comes from a connection proxy, make sure it really
+	 * does, and take over the address of the proxy's client.
+	 */
+	if (port->proxy_token || port->proxy_client_addr ||
+		port->proxy_client_port || port->proxy_preauth)
+	{
+		ProxyValidateBackendConnection(port);
+		if (port->remote_port[0] == '\0')
+			snprintf(remote_ps_data, sizeof(remote_ps_data), "%s",
+					 port->remote_host);
+		else
+			snprintf(remote_ps_data, sizeof(remote_ps_data), "%s(%s)",
+					 port->remote_host, port->remote_port);
+	}
+
 	/*
 	 * Now that we have the user and database name, we can set the process
 	 * title for ps.  It's good to do this as early as possible in startup.
@@ -4893,6 +4925,7 @@ SubPostmasterMain(int argc, char *argv[])
 		strcmp(argv[1], "--forkavlauncher") == 0 ||
 		strcmp(argv[1], "--forkavworker") == 0 ||
 		strcmp(argv[1], "--forkboot") == 0 ||
+		strcmp(argv[1], "--forkarch") == 0 ||
 		strncmp(argv[1], "--forkbgworker=", 15) == 0)
 		PGSharedMemoryReAttach();
 	else
@@ -5056,16 +5089,13 @@ SubPostmasterMain(int argc, char *argv[])
 	}
 	if (strcmp(argv[1], "--forkarch") == 0)
 	{
-		/* Do not want to attach to shared memory */
+		/*
+		 * The archiver only needs the statistics area of shared memory, which
+		 * PgStatShmem points to already.
+		 */
 
 		PgArchiverMain(argc, argv); /* does not return */
 	}
-	if (strcmp(argv[1], "--forkcol") == 0)
-	{
-		/* Do not want to attach to shared memory */
-
-		PgstatCollectorMain(argc, argv);	/* does not return */
-	}
 	if (strcmp(argv[1], "--forklog") == 0)
 	{
 		/* Do not want to attach to shared memory */
@@ -5178,12 +5208,6 @@ sigusr1_handler(SIGNAL_ARGS)
 	if (CheckPostmasterSignal(PMSIGNAL_BEGIN_HOT_STANDBY) &&
 		pmState == PM_RECOVERY && Shutdown == NoShutdown)
 	{
-		/*
-		 * Likewise, start other special children as needed.
-		 */
-		Assert(PgStatPID == 0);
-		PgStatPID = pgstat_start();
-
 		ereport(LOG,
 				(errmsg("database system is ready to accept read only connections")));
 
@@ -5638,6 +5662,66 @@ MaybeStartWalReceiver(void)
 	}
 }
 
+/*
+ * MaybeStartConnectionProxies
+ *		Start the connection proxies that aren't running, if our state
+ *		allows accepting client connections.
+ */
+static void
+MaybeStartConnectionProxies(void)
+{
+	int			i;
+
+	if ((pmState != PM_RUN && pmState != PM_HOT_STANDBY) ||
+		Shutdown > NoShutdown || FatalError)
+		return;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ConnectionProxyPIDs[i] == 0)
+			ConnectionProxyPIDs[i] = StartConnectionProxy(i);
+	}
+}
+
+/*
+ * SignalConnectionProxies
+ *		Send a signal to all running connection proxies.
+ */
+static void
+SignalConnectionProxies(int signal)
+{
+	int			i;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ConnectionProxyPIDs[i] != 0)
+		{
+			ereport(DEBUG2,
+					(errmsg_internal("sending signal %d to process %d",
+									 signal, (int) ConnectionProxyPIDs[i])));
+			signal_child(ConnectionProxyPIDs[i], signal);
+		}
+	}
+}
+
+/*
+ * CountConnectionProxies
+ *		Count the running connection proxies.
+ */
+static int
+CountConnectionProxies(void)
+{
+	int			i;
+	int			cnt = 0;
+
+	for (i = 0; i < ConnectionProxies; i++)
+	{
+		if (ConnectionProxyPIDs[i] != 0)
+			cnt++;
+	}
+	return cnt;
+}
+
 
 /*
  * Create the opts file
@@ -6126,7 +6210,7 @@ extern slock_t *ShmemLock;
 extern slock_t *ProcStructLock;
 extern PGPROC *AuxiliaryProcs;
 extern PMSignalData *PMSignalState;
-extern pgsocket pgStatSock;
+extern PgStat_ShmemControl *PgStatShmem;
 extern pg_time_t first_syslogger_file_time;
 
 #ifndef WIN32
@@ -6182,8 +6266,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->AuxiliaryProcs = AuxiliaryProcs;
 	param->PreparedXactProcs = PreparedXactProcs;
 	param->PMSignalState = PMSignalState;
-	if (!write_inheritable_socket(&param->pgStatSock, pgStatSock, childPid))
-		return false;
+	param->PgStatShmem = PgStatShmem;
 
 	param->PostmasterPid = PostmasterPid;
 	param->PgStartTime = PgStartTime;
@@ -6195,6 +6278,7 @@ save_backend_variables(BackendParameters *param, Port *port,
 	param->max_safe_fds = max_safe_fds;
 
 	param->MaxBackends = MaxBackends;
+	param->FastPathLockGroupsPerBackend = FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	param->PostmasterHandle = PostmasterHandle;
@@ -6418,7 +6502,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	AuxiliaryProcs = param->AuxiliaryProcs;
 	PreparedXactProcs = param->PreparedXactProcs;
 	PMSignalState = param->PMSignalState;
-	read_inheritable_socket(&pgStatSock, &param->pgStatSock);
+	PgStatShmem = param->PgStatShmem;
 
 	PostmasterPid = param->PostmasterPid;
 	PgStartTime = param->PgStartTime;
@@ -6430,6 +6514,7 @@ restore_backend_variables(BackendParameters *param, Port *port)
 	max_safe_fds = param->max_safe_fds;
 
 	MaxBackends = param->MaxBackends;
+	FastPathLockGroupsPerBackend = param->FastPathLockGroupsPerBackend;
 
 #ifdef WIN32
 	PostmasterHandle = param->PostmasterHandle;
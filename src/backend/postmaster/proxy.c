@@ -0,0 +1,2350 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.c
+ *
+ *	Built-in connection pooler.
+ *
+ *	When connection_proxies is set, the postmaster opens an additional set
+ *	of listen sockets on proxy_port and launches that many connection proxy
+ *	processes, which all accept client connections on them.  A proxy does
+ *	not execute queries itself: it relays the frontend/backend protocol
+ *	between its clients and ordinary backends, which it opens through the
+ *	postmaster's Unix-domain socket just like any other client would.
+ *
+ *	Client sessions are grouped into pools by their startup parameters
+ *	(user, database and whatever else the client sent), and each pool of
+ *	each proxy holds at most session_pool_size backends.  A backend is
+ *	attached to a session only while that session has a request or a
+ *	transaction in progress.  As soon as the backend reports ReadyForQuery
+ *	in idle state with no further requests outstanding, it goes back to the
+ *	pool and can serve the next transaction of any session in it.
+ *
+ *	Some commands leave state behind in the backend that later transactions
+ *	of the same session depend on: temporary tables, prepared statements,
+ *	session-level SET, LISTEN, session-level advisory locks and holdable
+ *	cursors.  The backend reports those with a "session_pinned"
+ *	ParameterStatus message (see SessionPoolPin), which the proxy swallows;
+ *	from then on the backend belongs to that session alone and is closed
+ *	together with it.
+ *
+ *	The first backend opened for a new session authenticates the client,
+ *	with the proxy relaying the authentication exchange.  Backends opened
+ *	later to grow a pool skip authentication.  Both kinds of startup packet
+ *	carry a random token from shared memory, which the backend checks
+ *	before believing anything else the proxy tells it, such as the real
+ *	address of the client.
+ *
+ *	Connection proxies need fork() semantics and Unix-domain sockets, so
+ *	they are not available on EXEC_BACKEND builds.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ *
+ * IDENTIFICATION
+ *	  src/backend/postmaster/proxy.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#ifdef HAVE_SYS_UN_H
+#include <sys/un.h>
+#endif
+#include <netinet/in.h>
+#ifdef HAVE_NETINET_TCP_H
+#include <netinet/tcp.h>
+#endif
+
+#include "access/parallel.h"
+#include "common/ip.h"
+#include "lib/ilist.h"
+#include "lib/stringinfo.h"
+#include "libpq/libpq.h"
+#include "libpq/pqformat.h"
+#include "libpq/pqsignal.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "port/pg_bswap.h"
+#include "postmaster/fork_process.h"
+#include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
+#include "replication/walsender.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/latch.h"
+#include "storage/shmem.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/memutils.h"
+#include "utils/ps_status.h"
+#include "utils/varlena.h"
+
+
+/*
+ * Once this much data is queued for sending to a connection, stop reading
+ * from the connection that produces it until the queue drains.  The same
+ * limit applies to data received but not processed yet.
+ */
+#define PROXY_BUFFER_LIMIT		65536
+
+/* Amount of data requested from the kernel by one recv() call */
+#define PROXY_RECV_SIZE			8192
+
+/* Maximum number of listen sockets, as in postmaster.c */
+#define PROXY_MAXLISTEN			64
+
+/* Size of the cancel request mailbox of each proxy */
+#define PROXY_CANCEL_MAILBOX	16
+
+/* Number of hex digits in the proxy token */
+#define PROXY_TOKEN_LEN			32
+
+/* Don't restart a proxy more often than this; in seconds */
+#define PROXY_RESTART_INTERVAL	1
+
+/*
+ * Per-proxy shared state.  Cancel requests for a session may arrive at any
+ * proxy, since they all accept on the same sockets; a proxy that receives
+ * one for a session that isn't its own drops the key into the owner's
+ * mailbox and wakes it up with SIGUSR1.
+ */
+typedef struct ProxySlot
+{
+	pid_t		pid;			/* PID of proxy, or 0 if not running */
+	slock_t		mutex;			/* protects the mailbox */
+	int			ncancels;
+	int32		cancel_keys[PROXY_CANCEL_MAILBOX];
+} ProxySlot;
+
+typedef struct ProxyShmemStruct
+{
+	/* secret shared by proxies and backends, set at shmem init */
+	char		token[PROXY_TOKEN_LEN + 1];
+	ProxySlot	slots[FLEXIBLE_ARRAY_MEMBER];
+} ProxyShmemStruct;
+
+/*
+ * A socket the proxy reads from and writes to.  Both client sessions and
+ * backends start with one of these.  All sockets are non-blocking; data
+ * flows through inbuf (received, not yet processed; inbuf.cursor marks how
+ * far processing got) and outbuf (queued for sending; outbuf.cursor marks
+ * how much was sent already).
+ */
+typedef enum ProxyConnKind
+{
+	PROXY_CONN_CLIENT,
+	PROXY_CONN_BACKEND
+} ProxyConnKind;
+
+typedef struct ProxyConn
+{
+	ProxyConnKind kind;
+	pgsocket	sock;
+	int			event_pos;		/* position in the wait event set, or -1 */
+	uint32		events;			/* events registered there */
+	StringInfoData inbuf;
+	StringInfoData outbuf;
+	bool		eof;			/* peer closed the connection, or error */
+	bool		close_after_flush;	/* close as soon as outbuf is sent */
+	bool		closed;
+	dlist_node	node;			/* in proxy_conns or closed_conns */
+} ProxyConn;
+
+/*
+ * A pool of backends sharing the same startup parameters.
+ */
+typedef struct ProxyPool
+{
+	ProtocolVersion proto;
+	char	   *params;			/* startup parameters, with terminator */
+	int			params_len;
+	int			nsessions;		/* client sessions using this pool */
+	int			nconns;			/* backend connections using this pool */
+	int			nbackends;		/* pooled backends, busy or idle */
+	int			nlaunching;		/* backends being started */
+	int			nwaiting;		/* length of waiting_sessions */
+	dlist_head	idle_backends;
+	dlist_head	waiting_sessions;
+	dlist_node	node;			/* in proxy_pools */
+} ProxyPool;
+
+typedef enum ProxySessionState
+{
+	SESSION_STARTUP,			/* waiting for the startup packet */
+	SESSION_AUTH,				/* relaying authentication */
+	SESSION_ACTIVE				/* authenticated */
+} ProxySessionState;
+
+typedef enum ProxyBackendState
+{
+	BACKEND_AUTH,				/* authenticating its session's client */
+	BACKEND_STARTUP,			/* starting up without authentication */
+	BACKEND_READY				/* ready for queries */
+} ProxyBackendState;
+
+struct ProxyBackend;
+
+typedef struct ProxySession
+{
+	ProxyConn	conn;			/* must be first */
+	ProxySessionState state;
+	ProxyPool  *pool;
+	struct ProxyBackend *backend;	/* attached backend, if any */
+	int32		cancel_key;		/* key handed out in BackendKeyData */
+	char	   *remote_host;	/* numeric client address, NULL if local */
+	char	   *remote_port;
+	int			outstanding;	/* requests still waiting for ReadyForQuery */
+	bool		extended;		/* extended-query messages not yet synced */
+	bool		pinned;			/* owns its backend for good */
+	bool		waiting;		/* in pool->waiting_sessions */
+	dlist_node	wait_node;
+} ProxySession;
+
+typedef struct ProxyBackend
+{
+	ProxyConn	conn;			/* must be first */
+	ProxyBackendState state;
+	ProxyPool  *pool;
+	ProxySession *session;		/* session served, or NULL if idle */
+	int32		pid;			/* from BackendKeyData */
+	int32		cancel_key;
+	char		txn_status;		/* from the last ReadyForQuery */
+	bool		pooled;			/* counted in pool->nbackends */
+	bool		idle;			/* in pool->idle_backends */
+	dlist_node	idle_node;
+} ProxyBackend;
+
+/* GUC variables */
+int			ConnectionProxies = 0;
+int			ProxyPortNumber = 6543;
+int			SessionPoolSize = 10;
+
+/* State shared with backends and other proxies */
+static ProxyShmemStruct *ProxyShmem = NULL;
+
+/* Sockets opened by the postmaster on proxy_port */
+static pgsocket ProxyListenSocket[PROXY_MAXLISTEN];
+static bool ProxyListenSocketsInitialized = false;
+
+/* Path of the Unix-domain socket proxies use to reach the postmaster */
+static char ProxyBackendSocketPath[MAXPGPATH];
+
+/* Restart throttling, kept by the postmaster */
+static time_t last_proxy_start_time[MAX_CONNECTION_PROXIES];
+
+/* ----------
+ * State of the proxy process
+ * ----------
+ */
+static int	MyProxyId = -1;
+static pgsocket MyListenSocket[PROXY_MAXLISTEN];
+static int	nMyListenSockets = 0;
+
+static dlist_head proxy_conns = DLIST_STATIC_INIT(proxy_conns);
+static dlist_head closed_conns = DLIST_STATIC_INIT(closed_conns);
+static int	nproxy_conns = 0;
+static dlist_head proxy_pools = DLIST_STATIC_INIT(proxy_pools);
+
+static WaitEventSet *proxy_wait_set = NULL;
+static bool proxy_wait_set_stale = true;
+static bool proxy_draining = false;
+
+/*
+ * Flags set by interrupt handlers for later service in the main loop.
+ */
+static volatile sig_atomic_t got_SIGHUP = false;
+static volatile sig_atomic_t got_SIGTERM = false;
+static volatile sig_atomic_t got_SIGINT = false;
+
+/* ----------
+ * Local function forward declarations
+ * ----------
+ */
+static void ConnectionProxyMain(void) pg_attribute_noreturn();
+static void proxy_sighup_handler(SIGNAL_ARGS);
+static void proxy_sigterm_handler(SIGNAL_ARGS);
+static void proxy_sigint_handler(SIGNAL_ARGS);
+static void proxy_sigusr1_handler(SIGNAL_ARGS);
+static void proxy_quickdie(SIGNAL_ARGS);
+static void ProxyShmemExit(int code, Datum arg);
+
+static void ProxyRebuildWaitSet(void);
+static void ProxyUpdateEvents(void);
+static void ProxyAccept(pgsocket listen_sock);
+static void ProxyStartDraining(void);
+static void ProxyReceiveCancels(void);
+static void ProxyRead(ProxyConn *conn);
+static void ProxyFlush(ProxyConn *conn);
+static void ProxyProcessInput(ProxyConn *conn);
+static void ProxyQueue(ProxyConn *conn, const char *data, int len);
+static void ProxyCloseConn(ProxyConn *conn);
+static bool ProxyNextMessage(ProxyConn *conn, char *msgtype, int *msglen);
+static void ProxyForwardMessage(ProxyConn *from, ProxyConn *to, int msglen);
+
+static void ProxyProcessClient(ProxySession *session);
+static bool ProxyProcessStartupPacket(ProxySession *session);
+static void ProxySendError(ProxySession *session, const char *sqlstate,
+						   const char *message);
+static void ProxyCloseSession(ProxySession *session);
+static bool ProxySessionIsClean(ProxySession *session);
+
+static void ProxyProcessBackend(ProxyBackend *backend);
+static ProxyBackend *ProxyOpenBackend(ProxyPool *pool, ProxySession *session);
+static void ProxyLaunchBackends(ProxyPool *pool);
+static void ProxyAssignBackend(ProxySession *session);
+static void ProxyAttachBackend(ProxyBackend *backend, ProxySession *session);
+static void ProxyReleaseBackend(ProxyBackend *backend);
+static void ProxyTerminateBackend(ProxyBackend *backend);
+static void ProxyCloseBackend(ProxyBackend *backend);
+static void ProxyBackendFailed(ProxyBackend *backend, const char *msg, int len);
+static void ProxyFailWaitingSessions(ProxyPool *pool, const char *msg, int len);
+
+static ProxyPool *ProxyGetPool(ProtocolVersion proto, const char *params,
+							   int params_len);
+static void ProxyFreeUnusedPools(void);
+static void ProxyCancelSession(int32 cancel_key);
+static void ProxySendCancelRequest(int32 pid, int32 cancel_key);
+static pgsocket ProxyConnectPostmaster(void);
+static int32 ProxyRandomKey(void);
+
+
+/* ------------------------------------------------------------
+ * Functions called from postmaster
+ * ------------------------------------------------------------
+ */
+
+/*
+ * ConnectionProxyListen
+ *
+ *	Open the listen sockets on proxy_port.  Called at postmaster startup,
+ *	after the regular sockets have been set up, if connection_proxies > 0.
+ *	We listen on the same addresses and socket directories as the server.
+ */
+void
+ConnectionProxyListen(void)
+{
+	char	   *rawstring;
+	List	   *elemlist;
+	ListCell   *l;
+	int			i;
+
+	for (i = 0; i < PROXY_MAXLISTEN; i++)
+		ProxyListenSocket[i] = PGINVALID_SOCKET;
+	ProxyListenSocketsInitialized = true;
+
+#if defined(EXEC_BACKEND) || !defined(HAVE_UNIX_SOCKETS)
+	ereport(FATAL,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("connection proxies are not supported on this platform")));
+#endif
+
+	if (ProxyPortNumber == PostPortNumber)
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("\"proxy_port\" must differ from \"port\"")));
+
+	/*
+	 * Proxies reach the backends through the first Unix-domain socket of the
+	 * postmaster, so there has to be one.
+	 */
+	rawstring = pstrdup(Unix_socket_directories ? Unix_socket_directories : "");
+	if (!SplitDirectoriesString(rawstring, ',', &elemlist))
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("invalid list syntax in parameter \"%s\"",
+						"unix_socket_directories")));
+	if (elemlist == NIL)
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+				 errmsg("connection proxies require a Unix-domain socket"),
+				 errhint("Set \"unix_socket_directories\" to at least one directory.")));
+
+	UNIXSOCK_PATH(ProxyBackendSocketPath, PostPortNumber,
+				  (char *) linitial(elemlist));
+
+	foreach(l, elemlist)
+	{
+		char	   *socketdir = (char *) lfirst(l);
+
+		if (StreamServerPort(AF_UNIX, NULL,
+							 (unsigned short) ProxyPortNumber,
+							 socketdir,
+							 ProxyListenSocket, PROXY_MAXLISTEN) != STATUS_OK)
+			ereport(WARNING,
+					(errmsg("could not create Unix-domain socket for connection proxy in directory \"%s\"",
+							socketdir)));
+	}
+	list_free_deep(elemlist);
+	pfree(rawstring);
+
+	if (ListenAddresses)
+	{
+		rawstring = pstrdup(ListenAddresses);
+		if (!SplitIdentifierString(rawstring, ',', &elemlist))
+			ereport(FATAL,
+					(errcode(ERRCODE_INVALID_PARAMETER_VALUE),
+					 errmsg("invalid list syntax in parameter \"%s\"",
+							"listen_addresses")));
+
+		foreach(l, elemlist)
+		{
+			char	   *curhost = (char *) lfirst(l);
+
+			if (StreamServerPort(AF_UNSPEC,
+								 strcmp(curhost, "*") == 0 ? NULL : curhost,
+								 (unsigned short) ProxyPortNumber,
+								 NULL,
+								 ProxyListenSocket, PROXY_MAXLISTEN) != STATUS_OK)
+				ereport(WARNING,
+						(errmsg("could not create listen socket for connection proxy for \"%s\"",
+								curhost)));
+		}
+		list_free(elemlist);
+		pfree(rawstring);
+	}
+
+	if (ProxyListenSocket[0] == PGINVALID_SOCKET)
+		ereport(FATAL,
+				(errmsg("no socket created for connection proxies")));
+}
+
+/*
+ * ConnectionProxyCloseSockets
+ *
+ *	Close the proxy listen sockets.  Used by the postmaster at exit, and by
+ *	every child process other than the proxies themselves.
+ */
+void
+ConnectionProxyCloseSockets(void)
+{
+	int			i;
+
+	if (!ProxyListenSocketsInitialized)
+		return;
+
+	for (i = 0; i < PROXY_MAXLISTEN; i++)
+	{
+		if (ProxyListenSocket[i] != PGINVALID_SOCKET)
+		{
+			StreamClose(ProxyListenSocket[i]);
+			ProxyListenSocket[i] = PGINVALID_SOCKET;
+		}
+	}
+}
+
+/*
+ * StartConnectionProxy
+ *
+ *	Called from postmaster to start proxy number "id", at startup or after
+ *	the previous one exited.
+ *
+ *	Returns PID of child process, or 0 if fail.
+ *
+ *	Note: if fail, we will be called again from the postmaster main loop.
+ */
+int
+StartConnectionProxy(int id)
+{
+	time_t		curtime;
+	pid_t		proxyPid;
+	int			i;
+
+	Assert(id >= 0 && id < ConnectionProxies);
+
+	/*
+	 * Do nothing if too soon since the last start of this proxy, to avoid
+	 * respawning it in a tight loop if it dies immediately at launch.
+	 */
+	curtime = time(NULL);
+	if ((unsigned int) (curtime - last_proxy_start_time[id]) <
+		(unsigned int) PROXY_RESTART_INTERVAL)
+		return 0;
+	last_proxy_start_time[id] = curtime;
+
+#ifdef EXEC_BACKEND
+	return 0;
+#else
+	switch ((proxyPid = fork_process()))
+	{
+		case -1:
+			ereport(LOG,
+					(errmsg("could not fork connection proxy: %m")));
+			return 0;
+
+		case 0:
+			/* in postmaster child ... */
+			InitPostmasterChild();
+
+			/*
+			 * Take over the proxy listen sockets before closing the rest of
+			 * the postmaster's sockets.
+			 */
+			MyProxyId = id;
+			for (i = 0; i < PROXY_MAXLISTEN; i++)
+			{
+				if (ProxyListenSocket[i] != PGINVALID_SOCKET)
+					MyListenSocket[nMyListenSockets++] = ProxyListenSocket[i];
+				ProxyListenSocket[i] = PGINVALID_SOCKET;
+			}
+			ClosePostmasterPorts(false);
+
+			/*
+			 * Drop our connection to postmaster's dynamic shared memory.  We
+			 * keep the main segment, where the proxy slots live.
+			 */
+			dsm_detach_all();
+
+			ConnectionProxyMain();
+			break;
+
+		default:
+			return (int) proxyPid;
+	}
+
+	/* shouldn't get here */
+	return 0;
+#endif
+}
+
+/* ------------------------------------------------------------
+ * Shared memory
+ * ------------------------------------------------------------
+ */
+
+Size
+ProxyShmemSize(void)
+{
+	return add_size(offsetof(ProxyShmemStruct, slots),
+					mul_size(ConnectionProxies, sizeof(ProxySlot)));
+}
+
+void
+ProxyShmemInit(void)
+{
+	bool		found;
+	int			i;
+
+	ProxyShmem = (ProxyShmemStruct *)
+		ShmemInitStruct("Connection Proxy Data", ProxyShmemSize(), &found);
+
+	if (!found)
+	{
+		uint8		random_bytes[PROXY_TOKEN_LEN / 2];
+
+		memset(ProxyShmem, 0, ProxyShmemSize());
+		for (i = 0; i < ConnectionProxies; i++)
+			SpinLockInit(&ProxyShmem->slots[i].mutex);
+
+		/*
+		 * Without a token, backends reject every proxy connection, so
+		 * failing to make one only matters if proxies are enabled.
+		 */
+		if (ConnectionProxies > 0)
+		{
+			if (!pg_strong_random(random_bytes, sizeof(random_bytes)))
+				ereport(FATAL,
+						(errmsg("could not generate connection proxy token")));
+			for (i = 0; i < sizeof(random_bytes); i++)
+				sprintf(ProxyShmem->token + 2 * i, "%02x", random_bytes[i]);
+		}
+	}
+}
+
+/* ------------------------------------------------------------
+ * Functions called from backends
+ * ------------------------------------------------------------
+ */
+
+/*
+ * ProxyValidateBackendConnection
+ *
+ *	Called during backend startup if the startup packet contained any of the
+ *	proxy_* parameters.  Those are honored only if they come over the
+ *	Unix-domain socket with the right token; if they carry the address of
+ *	the proxy's client, make that the remote address of this connection so
+ *	that pg_hba.conf matching and logging see the real client.
+ */
+void
+ProxyValidateBackendConnection(Port *port)
+{
+	if (port->raddr.addr.ss_family != AF_UNIX ||
+		ProxyShmem == NULL || ProxyShmem->token[0] == '\0' ||
+		port->proxy_token == NULL ||
+		strcmp(port->proxy_token, ProxyShmem->token) != 0)
+		ereport(FATAL,
+				(errcode(ERRCODE_INVALID_AUTHORIZATION_SPECIFICATION),
+				 errmsg("invalid connection proxy token")));
+
+	port->proxied = true;
+
+	if (port->proxy_client_addr != NULL)
+	{
+		struct addrinfo hint;
+		struct addrinfo *addrs = NULL;
+		char		remote_host[NI_MAXHOST];
+		char		remote_port[NI_MAXSERV];
+		int			ret;
+
+		MemSet(&hint, 0, sizeof(hint));
+		hint.ai_family = AF_UNSPEC;
+		hint.ai_socktype = SOCK_STREAM;
+		hint.ai_flags = AI_NUMERICHOST;
+
+		ret = pg_getaddrinfo_all(port->proxy_client_addr,
+								 port->proxy_client_port,
+								 &hint, &addrs);
+		if (ret != 0 || addrs == NULL ||
+			addrs->ai_addrlen > sizeof(port->raddr.addr))
+			ereport(FATAL,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("invalid client address \"%s\" from connection proxy",
+							port->proxy_client_addr)));
+
+		memcpy(&port->raddr.addr, addrs->ai_addr, addrs->ai_addrlen);
+		port->raddr.salen = addrs->ai_addrlen;
+		pg_freeaddrinfo_all(hint.ai_family, addrs);
+
+		remote_host[0] = '\0';
+		remote_port[0] = '\0';
+		if (pg_getnameinfo_all(&port->raddr.addr, port->raddr.salen,
+							   remote_host, sizeof(remote_host),
+							   remote_port, sizeof(remote_port),
+							   NI_NUMERICHOST | NI_NUMERICSERV) == 0)
+		{
+			free(port->remote_host);
+			free(port->remote_port);
+			port->remote_host = strdup(remote_host);
+			port->remote_port = strdup(remote_port);
+		}
+		port->remote_hostname = NULL;
+	}
+
+	if (Log_connections)
+	{
+		if (port->remote_port && port->remote_port[0])
+			ereport(LOG,
+					(errmsg("connection received through connection proxy: host=%s port=%s",
+							port->remote_host, port->remote_port)));
+		else
+			ereport(LOG,
+					(errmsg("connection received through connection proxy: host=%s",
+							port->remote_host)));
+	}
+}
+
+/*
+ * SessionPoolPin
+ *
+ *	Tell the connection proxy serving this backend, if any, that the session
+ *	now has state that must survive the current transaction, so the backend
+ *	must not be handed to other sessions anymore.  "reason" is only used for
+ *	debugging output.
+ */
+void
+SessionPoolPin(const char *reason)
+{
+	static bool pinned = false;
+	StringInfoData buf;
+
+	if (pinned || MyProcPort == NULL || !MyProcPort->proxied ||
+		whereToSendOutput != DestRemote ||
+		IsParallelWorker() || am_walsender)
+		return;
+
+	pinned = true;
+	elog(DEBUG1, "session pinned to its backend by %s", reason);
+
+	pq_beginmessage(&buf, 'S');
+	pq_sendstring(&buf, "session_pinned");
+	pq_sendstring(&buf, "on");
+	pq_endmessage(&buf);
+}
+
+/* ------------------------------------------------------------
+ * Local functions called by the proxy process follow
+ * ------------------------------------------------------------
+ */
+
+/*
+ * ConnectionProxyMain
+ *
+ *	The main entry point for a proxy process.
+ */
+static void
+ConnectionProxyMain(void)
+{
+	WaitEvent  *events = NULL;
+	int			max_events = 0;
+	int			i;
+
+	/*
+	 * Properly accept or ignore signals the postmaster might send us.
+	 *
+	 * SIGTERM asks for a smart shutdown: stop accepting new clients and exit
+	 * once the existing ones are gone.  SIGINT asks to exit right away.
+	 */
+	pqsignal(SIGHUP, proxy_sighup_handler);
+	pqsignal(SIGINT, proxy_sigint_handler);
+	pqsignal(SIGTERM, proxy_sigterm_handler);
+	pqsignal(SIGQUIT, proxy_quickdie);
+	pqsignal(SIGALRM, SIG_IGN);
+	pqsignal(SIGPIPE, SIG_IGN);
+	pqsignal(SIGUSR1, proxy_sigusr1_handler);
+	pqsignal(SIGUSR2, SIG_IGN);
+
+	/* Reset some signals that are accepted by postmaster but not here */
+	pqsignal(SIGCHLD, SIG_DFL);
+	PG_SETMASK(&UnBlockSig);
+
+	/*
+	 * Identify myself via ps
+	 */
+	init_ps_display("connection proxy", "", "", "");
+
+	/* Announce ourselves in shared memory, for cancel forwarding */
+	SpinLockAcquire(&ProxyShmem->slots[MyProxyId].mutex);
+	ProxyShmem->slots[MyProxyId].pid = MyProcPid;
+	ProxyShmem->slots[MyProxyId].ncancels = 0;
+	SpinLockRelease(&ProxyShmem->slots[MyProxyId].mutex);
+	on_shmem_exit(ProxyShmemExit, 0);
+
+	for (i = 0; i < nMyListenSockets; i++)
+	{
+		if (!pg_set_noblock(MyListenSocket[i]))
+			ereport(FATAL,
+					(errmsg("could not set listen socket to nonblocking mode: %m")));
+	}
+
+	for (;;)
+	{
+		int			nevents;
+
+		if (got_SIGINT)
+			proc_exit(0);
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		if (got_SIGTERM && !proxy_draining)
+			ProxyStartDraining();
+
+		/* When draining, we're done once the last connection is gone */
+		if (proxy_draining && nproxy_conns == 0)
+			proc_exit(0);
+
+		ProxyReceiveCancels();
+
+		/* Free connections closed during the previous iteration */
+		while (!dlist_is_empty(&closed_conns))
+		{
+			ProxyConn  *conn = dlist_container(ProxyConn, node,
+											   dlist_pop_head_node(&closed_conns));
+
+			pfree(conn->inbuf.data);
+			pfree(conn->outbuf.data);
+			if (conn->kind == PROXY_CONN_CLIENT)
+			{
+				ProxySession *session = (ProxySession *) conn;
+
+				if (session->remote_host)
+					pfree(session->remote_host);
+				if (session->remote_port)
+					pfree(session->remote_port);
+			}
+			pfree(conn);
+		}
+		ProxyFreeUnusedPools();
+
+		ProxyUpdateEvents();
+		if (proxy_wait_set_stale)
+			ProxyRebuildWaitSet();
+
+		if (max_events < nproxy_conns + nMyListenSockets + 2)
+		{
+			if (events)
+				pfree(events);
+			max_events = nproxy_conns + nMyListenSockets + 2;
+			events = MemoryContextAlloc(TopMemoryContext,
+										sizeof(WaitEvent) * max_events);
+		}
+
+		nevents = WaitEventSetWait(proxy_wait_set, -1, events, max_events,
+								   WAIT_EVENT_CONNECTION_PROXY_MAIN);
+
+		for (i = 0; i < nevents; i++)
+		{
+			WaitEvent  *event = &events[i];
+			ProxyConn  *conn = (ProxyConn *) event->user_data;
+
+			if (event->events & WL_LATCH_SET)
+			{
+				ResetLatch(MyLatch);
+				continue;
+			}
+
+			/*
+			 * Emergency bailout if postmaster has died.  This is to avoid the
+			 * necessity for manual cleanup of all postmaster children.
+			 */
+			if (event->events & WL_POSTMASTER_DEATH)
+				proc_exit(1);
+
+			if (conn == NULL)
+			{
+				ProxyAccept(event->fd);
+				continue;
+			}
+
+			/* might have been closed while handling an earlier event */
+			if (conn->closed)
+				continue;
+
+			if (event->events & WL_SOCKET_WRITEABLE)
+				ProxyFlush(conn);
+			if (!conn->closed && (event->events & WL_SOCKET_READABLE))
+			{
+				ProxyRead(conn);
+				ProxyProcessInput(conn);
+			}
+		}
+	}
+}
+
+/* SIGQUIT signal handler for proxy process */
+static void
+proxy_quickdie(SIGNAL_ARGS)
+{
+	/*
+	 * We DO NOT want to run proc_exit() or atexit() callbacks; they wouldn't
+	 * be safe to run from a signal handler.  Our clients and backends will
+	 * see their connections drop.
+	 */
+	_exit(2);
+}
+
+/* SIGHUP: set flag to re-read config file at next convenient time */
+static void
+proxy_sighup_handler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/* SIGTERM: stop accepting connections, exit when the last one is gone */
+static void
+proxy_sigterm_handler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGTERM = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/* SIGINT: exit right away */
+static void
+proxy_sigint_handler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGINT = true;
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/* SIGUSR1: another proxy put a cancel request in our mailbox */
+static void
+proxy_sigusr1_handler(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/* Clear our shared slot at exit */
+static void
+ProxyShmemExit(int code, Datum arg)
+{
+	SpinLockAcquire(&ProxyShmem->slots[MyProxyId].mutex);
+	ProxyShmem->slots[MyProxyId].pid = 0;
+	ProxyShmem->slots[MyProxyId].ncancels = 0;
+	SpinLockRelease(&ProxyShmem->slots[MyProxyId].mutex);
+}
+
+/* Is the output queue of this connection too long to add more? */
+static inline bool
+ProxyOutputFull(ProxyConn *conn)
+{
+	return conn->outbuf.len - conn->outbuf.cursor >= PROXY_BUFFER_LIMIT;
+}
+
+/* Does the input buffer hold a complete message? */
+static inline bool
+ProxyInputComplete(ProxyConn *conn)
+{
+	int			avail = conn->inbuf.len - conn->inbuf.cursor;
+	uint32		n32;
+
+	if (avail < 5)
+		return false;
+	memcpy(&n32, conn->inbuf.data + conn->inbuf.cursor + 1, 4);
+	return avail >= 1 + (int64) pg_ntoh32(n32);
+}
+
+/*
+ * Compute the events each connection has to wait for.  A connection waits
+ * for WL_SOCKET_WRITEABLE while it has queued output, and for
+ * WL_SOCKET_READABLE unless it has enough unprocessed input already (but
+ * always until a message is complete, however large it is).  A
+ * connection that waits for nothing has to be left out of the wait event
+ * set altogether, which means rebuilding the set.
+ */
+static void
+ProxyUpdateEvents(void)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &proxy_conns)
+	{
+		ProxyConn  *conn = dlist_container(ProxyConn, node, iter.cur);
+		uint32		events = 0;
+
+		if (conn->outbuf.cursor < conn->outbuf.len)
+			events |= WL_SOCKET_WRITEABLE;
+		if (!conn->eof && !conn->close_after_flush &&
+			(conn->inbuf.len - conn->inbuf.cursor < PROXY_BUFFER_LIMIT ||
+			 !ProxyInputComplete(conn)))
+			events |= WL_SOCKET_READABLE;
+
+		if (events == conn->events)
+			continue;
+
+		if (events == 0 || conn->event_pos < 0)
+			proxy_wait_set_stale = true;
+		else if (!proxy_wait_set_stale)
+			ModifyWaitEvent(proxy_wait_set, conn->event_pos, events, NULL);
+		conn->events = events;
+	}
+}
+
+/*
+ * Build a new wait event set for the current set of connections.  There's
+ * no way to remove a socket from a WaitEventSet, so we do this whenever a
+ * connection goes away or stops waiting for anything.
+ */
+static void
+ProxyRebuildWaitSet(void)
+{
+	dlist_iter	iter;
+	int			i;
+
+	if (proxy_wait_set)
+		FreeWaitEventSet(proxy_wait_set);
+
+	proxy_wait_set = CreateWaitEventSet(TopMemoryContext,
+										nproxy_conns + nMyListenSockets + 2);
+	AddWaitEventToSet(proxy_wait_set, WL_LATCH_SET, PGINVALID_SOCKET,
+					  MyLatch, NULL);
+	AddWaitEventToSet(proxy_wait_set, WL_POSTMASTER_DEATH, PGINVALID_SOCKET,
+					  NULL, NULL);
+	for (i = 0; i < nMyListenSockets; i++)
+		AddWaitEventToSet(proxy_wait_set, WL_SOCKET_READABLE,
+						  MyListenSocket[i], NULL, NULL);
+
+	dlist_foreach(iter, &proxy_conns)
+	{
+		ProxyConn  *conn = dlist_container(ProxyConn, node, iter.cur);
+
+		if (conn->events != 0)
+			conn->event_pos = AddWaitEventToSet(proxy_wait_set, conn->events,
+												conn->sock, NULL, conn);
+		else
+			conn->event_pos = -1;
+	}
+
+	proxy_wait_set_stale = false;
+}
+
+/*
+ * Set up a new connection entry for a connected socket.
+ */
+static ProxyConn *
+ProxyNewConn(ProxyConnKind kind, pgsocket sock)
+{
+	ProxyConn  *conn;
+	MemoryContext oldcontext;
+
+	oldcontext = MemoryContextSwitchTo(TopMemoryContext);
+
+	if (kind == PROXY_CONN_CLIENT)
+		conn = (ProxyConn *) palloc0(sizeof(ProxySession));
+	else
+		conn = (ProxyConn *) palloc0(sizeof(ProxyBackend));
+	conn->kind = kind;
+	conn->sock = sock;
+	conn->event_pos = -1;
+	initStringInfo(&conn->inbuf);
+	initStringInfo(&conn->outbuf);
+	dlist_push_tail(&proxy_conns, &conn->node);
+	nproxy_conns++;
+
+	MemoryContextSwitchTo(oldcontext);
+
+	return conn;
+}
+
+/*
+ * Accept new client connections on a listen socket.
+ */
+static void
+ProxyAccept(pgsocket listen_sock)
+{
+	/* Don't let a flood of new connections starve the existing ones */
+	int			budget = 32;
+
+	while (budget-- > 0)
+	{
+		SockAddr	raddr;
+		pgsocket	sock;
+		ProxySession *session;
+
+		raddr.salen = sizeof(raddr.addr);
+		sock = accept(listen_sock, (struct sockaddr *) &raddr.addr,
+					  &raddr.salen);
+		if (sock == PGINVALID_SOCKET)
+		{
+			if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				ereport(LOG,
+						(errcode_for_socket_access(),
+						 errmsg("could not accept new connection: %m")));
+			return;
+		}
+
+		if (!pg_set_noblock(sock))
+		{
+			ereport(LOG,
+					(errcode_for_socket_access(),
+					 errmsg("could not set socket to nonblocking mode: %m")));
+			closesocket(sock);
+			continue;
+		}
+
+		session = (ProxySession *) ProxyNewConn(PROXY_CONN_CLIENT, sock);
+		session->state = SESSION_STARTUP;
+		session->cancel_key = ProxyRandomKey();
+
+		if (!IS_AF_UNIX(raddr.addr.ss_family))
+		{
+			char		remote_host[NI_MAXHOST];
+			char		remote_port[NI_MAXSERV];
+			int			on = 1;
+
+#ifdef TCP_NODELAY
+			(void) setsockopt(sock, IPPROTO_TCP, TCP_NODELAY,
+							  (char *) &on, sizeof(on));
+#endif
+			(void) setsockopt(sock, SOL_SOCKET, SO_KEEPALIVE,
+							  (char *) &on, sizeof(on));
+
+			if (pg_getnameinfo_all(&raddr.addr, raddr.salen,
+								   remote_host, sizeof(remote_host),
+								   remote_port, sizeof(remote_port),
+								   NI_NUMERICHOST | NI_NUMERICSERV) == 0)
+			{
+				session->remote_host = MemoryContextStrdup(TopMemoryContext,
+														   remote_host);
+				session->remote_port = MemoryContextStrdup(TopMemoryContext,
+														   remote_port);
+			}
+		}
+	}
+}
+
+/*
+ * Start a smart shutdown: stop accepting new clients and get rid of idle
+ * backends.  Busy ones are terminated as their sessions release them.
+ */
+static void
+ProxyStartDraining(void)
+{
+	dlist_iter	iter;
+	int			i;
+
+	proxy_draining = true;
+
+	for (i = 0; i < nMyListenSockets; i++)
+		closesocket(MyListenSocket[i]);
+	nMyListenSockets = 0;
+	proxy_wait_set_stale = true;
+
+	dlist_foreach(iter, &proxy_pools)
+	{
+		ProxyPool  *pool = dlist_container(ProxyPool, node, iter.cur);
+
+		while (!dlist_is_empty(&pool->idle_backends))
+			ProxyTerminateBackend(dlist_container(ProxyBackend, idle_node,
+												  dlist_head_node(&pool->idle_backends)));
+	}
+}
+
+/*
+ * Service the cancel requests other proxies left in our mailbox.
+ */
+static void
+ProxyReceiveCancels(void)
+{
+	ProxySlot  *slot = &ProxyShmem->slots[MyProxyId];
+	int32		keys[PROXY_CANCEL_MAILBOX];
+	int			nkeys;
+	int			i;
+
+	SpinLockAcquire(&slot->mutex);
+	nkeys = slot->ncancels;
+	memcpy(keys, slot->cancel_keys, nkeys * sizeof(int32));
+	slot->ncancels = 0;
+	SpinLockRelease(&slot->mutex);
+
+	for (i = 0; i < nkeys; i++)
+		ProxyCancelSession(keys[i]);
+}
+
+/*
+ * Read whatever the socket has for us into the connection's input buffer.
+ */
+static void
+ProxyRead(ProxyConn *conn)
+{
+	int			n;
+
+	if (conn->eof)
+		return;
+
+	/* Get rid of already processed data first */
+	if (conn->inbuf.cursor > 0)
+	{
+		memmove(conn->inbuf.data, conn->inbuf.data + conn->inbuf.cursor,
+				conn->inbuf.len - conn->inbuf.cursor);
+		conn->inbuf.len -= conn->inbuf.cursor;
+		conn->inbuf.cursor = 0;
+		conn->inbuf.data[conn->inbuf.len] = '\0';
+	}
+
+	enlargeStringInfo(&conn->inbuf, PROXY_RECV_SIZE);
+	n = recv(conn->sock, conn->inbuf.data + conn->inbuf.len,
+			 conn->inbuf.maxlen - conn->inbuf.len - 1, 0);
+	if (n > 0)
+	{
+		conn->inbuf.len += n;
+		conn->inbuf.data[conn->inbuf.len] = '\0';
+	}
+	else if (n == 0)
+		conn->eof = true;
+	else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+	{
+		if (errno != ECONNRESET)
+			ereport(COMMERROR,
+					(errcode_for_socket_access(),
+					 errmsg("could not receive data from %s: %m",
+							conn->kind == PROXY_CONN_CLIENT ? "client" : "backend")));
+		conn->eof = true;
+	}
+}
+
+/*
+ * Send as much of the connection's output buffer as the socket takes.  The
+ * connection may be closed on return.
+ */
+static void
+ProxyFlush(ProxyConn *conn)
+{
+	bool		was_full = ProxyOutputFull(conn);
+
+	while (conn->outbuf.cursor < conn->outbuf.len)
+	{
+		int			n;
+
+		n = send(conn->sock, conn->outbuf.data + conn->outbuf.cursor,
+				 conn->outbuf.len - conn->outbuf.cursor, 0);
+		if (n < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				break;
+
+			/* The connection is broken; nobody is there to receive more */
+			if (errno != EPIPE && errno != ECONNRESET)
+				ereport(COMMERROR,
+						(errcode_for_socket_access(),
+						 errmsg("could not send data to %s: %m",
+								conn->kind == PROXY_CONN_CLIENT ? "client" : "backend")));
+			resetStringInfo(&conn->outbuf);
+			conn->eof = true;
+			if (conn->kind == PROXY_CONN_CLIENT)
+				ProxyCloseSession((ProxySession *) conn);
+			else
+				ProxyCloseBackend((ProxyBackend *) conn);
+			return;
+		}
+		conn->outbuf.cursor += n;
+	}
+
+	if (conn->outbuf.cursor == conn->outbuf.len)
+	{
+		resetStringInfo(&conn->outbuf);
+
+		if (conn->close_after_flush)
+		{
+			if (conn->kind == PROXY_CONN_CLIENT)
+				ProxyCloseSession((ProxySession *) conn);
+			else
+				ProxyCloseBackend((ProxyBackend *) conn);
+			return;
+		}
+	}
+
+	/*
+	 * The connection feeding this one may have stopped because our queue was
+	 * full; let it continue now.
+	 */
+	if (was_full && !ProxyOutputFull(conn))
+	{
+		if (conn->kind == PROXY_CONN_CLIENT)
+		{
+			ProxySession *session = (ProxySession *) conn;
+
+			if (session->backend)
+				ProxyProcessInput(&session->backend->conn);
+		}
+		else
+		{
+			ProxyBackend *backend = (ProxyBackend *) conn;
+
+			if (backend->session)
+				ProxyProcessInput(&backend->session->conn);
+		}
+	}
+}
+
+/*
+ * Process the complete messages in a connection's input buffer, then deal
+ * with end of file if we saw it.
+ */
+static void
+ProxyProcessInput(ProxyConn *conn)
+{
+	if (conn->closed)
+		return;
+
+	if (conn->kind == PROXY_CONN_CLIENT)
+		ProxyProcessClient((ProxySession *) conn);
+	else
+		ProxyProcessBackend((ProxyBackend *) conn);
+}
+
+/*
+ * Queue a message for sending and try to send it right away.
+ */
+static void
+ProxyQueue(ProxyConn *conn, const char *data, int len)
+{
+	appendBinaryStringInfo(&conn->outbuf, data, len);
+	ProxyFlush(conn);
+}
+
+/*
+ * Close the socket of a connection.  The memory is freed at the start of
+ * the next main loop iteration, since pending wait events may still point
+ * to it.
+ */
+static void
+ProxyCloseConn(ProxyConn *conn)
+{
+	Assert(!conn->closed);
+
+	closesocket(conn->sock);
+	conn->sock = PGINVALID_SOCKET;
+	conn->closed = true;
+	dlist_delete(&conn->node);
+	dlist_push_tail(&closed_conns, &conn->node);
+	nproxy_conns--;
+	if (conn->event_pos >= 0)
+		proxy_wait_set_stale = true;
+}
+
+/*
+ * Check whether the input buffer holds a complete protocol message, and
+ * return its type byte and length (including the length word itself).
+ */
+static bool
+ProxyNextMessage(ProxyConn *conn, char *msgtype, int *msglen)
+{
+	const char *p = conn->inbuf.data + conn->inbuf.cursor;
+	int			avail = conn->inbuf.len - conn->inbuf.cursor;
+	uint32		n32;
+
+	if (avail < 5)
+		return false;
+
+	memcpy(&n32, p + 1, 4);
+	n32 = pg_ntoh32(n32);
+	if (n32 < 4 || n32 > MaxAllocSize - PROXY_RECV_SIZE)
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid message length from %s",
+						conn->kind == PROXY_CONN_CLIENT ? "client" : "backend")));
+		conn->eof = true;
+		conn->inbuf.cursor = conn->inbuf.len;
+		return false;
+	}
+
+	if (avail < 1 + (int) n32)
+	{
+		/* make room for the rest of the message */
+		enlargeStringInfo(&conn->inbuf, 1 + (int) n32 - avail);
+		return false;
+	}
+
+	*msgtype = p[0];
+	*msglen = 1 + (int) n32;
+	return true;
+}
+
+/* Copy the message at the front of "from"'s input to "to"'s output */
+static void
+ProxyForwardMessage(ProxyConn *from, ProxyConn *to, int msglen)
+{
+	appendBinaryStringInfo(&to->outbuf,
+						   from->inbuf.data + from->inbuf.cursor, msglen);
+	from->inbuf.cursor += msglen;
+}
+
+/* ------------------------------------------------------------
+ * Client sessions
+ * ------------------------------------------------------------
+ */
+
+/*
+ * Process input from a client.
+ */
+static void
+ProxyProcessClient(ProxySession *session)
+{
+	ProxyConn  *conn = &session->conn;
+	char		msgtype;
+	int			msglen;
+
+	if (session->state == SESSION_STARTUP)
+	{
+		while (session->state == SESSION_STARTUP && !conn->close_after_flush)
+		{
+			if (!ProxyProcessStartupPacket(session))
+				break;
+		}
+	}
+
+	while (!conn->closed && !conn->close_after_flush &&
+		   session->state != SESSION_STARTUP &&
+		   ProxyNextMessage(conn, &msgtype, &msglen))
+	{
+		ProxyBackend *backend;
+
+		/* Terminate: the backend stays around for other sessions */
+		if (msgtype == 'X')
+		{
+			conn->inbuf.cursor += msglen;
+			conn->eof = true;
+			break;
+		}
+
+		if (session->backend == NULL)
+		{
+			/* only possible once authenticated */
+			Assert(session->state == SESSION_ACTIVE);
+			ProxyAssignBackend(session);
+			if (session->backend == NULL)
+				return;			/* wait for one to become available */
+		}
+		backend = session->backend;
+
+		if (ProxyOutputFull(&backend->conn))
+			break;
+
+		if (session->state == SESSION_ACTIVE)
+		{
+			/*
+			 * Each simple query, function call and Sync produces exactly one
+			 * ReadyForQuery.  Extended-query messages arriving without a Sync
+			 * mean the backend may hold an unnamed statement or portal the
+			 * session still needs.
+			 */
+			switch (msgtype)
+			{
+				case 'Q':
+				case 'F':
+					session->outstanding++;
+					break;
+				case 'S':
+					session->outstanding++;
+					session->extended = false;
+					break;
+				case 'P':
+				case 'B':
+				case 'E':
+				case 'D':
+				case 'C':
+					session->extended = true;
+					break;
+				default:
+					break;
+			}
+		}
+
+		ProxyForwardMessage(conn, &backend->conn, msglen);
+	}
+
+	if (session->backend && !session->backend->conn.closed)
+		ProxyFlush(&session->backend->conn);
+
+	if (!conn->closed && conn->eof && !ProxyNextMessage(conn, &msgtype, &msglen))
+		ProxyCloseSession(session);
+}
+
+/*
+ * Process the startup packet of a client, if it is complete.  Returns true
+ * if there may be more to do in SESSION_STARTUP state.
+ */
+static bool
+ProxyProcessStartupPacket(ProxySession *session)
+{
+	ProxyConn  *conn = &session->conn;
+	const char *buf = conn->inbuf.data + conn->inbuf.cursor;
+	int			avail = conn->inbuf.len - conn->inbuf.cursor;
+	uint32		len;
+	ProtocolVersion proto;
+	const char *params;
+	int			params_len;
+	int			offset;
+	ProxyBackend *backend;
+
+	if (avail < 4)
+	{
+		if (conn->eof)
+			ProxyCloseSession(session);
+		return false;
+	}
+
+	memcpy(&len, buf, 4);
+	len = pg_ntoh32(len);
+	if (len < 8 || len > MAX_STARTUP_PACKET_LENGTH)
+	{
+		ereport(COMMERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("invalid length of startup packet")));
+		ProxyCloseSession(session);
+		return false;
+	}
+	if (avail < len)
+	{
+		if (conn->eof)
+			ProxyCloseSession(session);
+		return false;
+	}
+
+	memcpy(&proto, buf + 4, 4);
+	proto = pg_ntoh32(proto);
+	conn->inbuf.cursor += len;
+
+	if (proto == CANCEL_REQUEST_CODE)
+	{
+		CancelRequestPacket *canc = (CancelRequestPacket *) (buf + 4);
+		int32		pid = (int32) pg_ntoh32(canc->backendPID);
+		int32		key = (int32) pg_ntoh32(canc->cancelAuthCode);
+		int			i;
+
+		if (len != sizeof(CancelRequestPacket) + 4)
+		{
+			ProxyCloseSession(session);
+			return false;
+		}
+
+		if (pid == MyProcPid)
+			ProxyCancelSession(key);
+		else
+		{
+			for (i = 0; i < ConnectionProxies; i++)
+			{
+				ProxySlot  *slot = &ProxyShmem->slots[i];
+				bool		posted = false;
+
+				SpinLockAcquire(&slot->mutex);
+				if (slot->pid == pid && slot->ncancels < PROXY_CANCEL_MAILBOX)
+				{
+					slot->cancel_keys[slot->ncancels++] = key;
+					posted = true;
+				}
+				SpinLockRelease(&slot->mutex);
+
+				if (posted)
+				{
+					kill(pid, SIGUSR1);
+					break;
+				}
+			}
+		}
+
+		/* As in the postmaster, the requester gets no answer */
+		ProxyCloseSession(session);
+		return false;
+	}
+
+	/* We don't do SSL or GSSAPI encryption; the client may go on without */
+	if (proto == NEGOTIATE_SSL_CODE || proto == NEGOTIATE_GSS_CODE)
+	{
+		ProxyQueue(conn, "N", 1);
+		return !conn->closed;
+	}
+
+	if (PG_PROTOCOL_MAJOR(proto) != 3)
+	{
+		ProxySendError(session, "0A000",
+					   "connection proxy supports only protocol version 3");
+		return false;
+	}
+
+	/*
+	 * Check the parameters.  Replication connections can't be pooled, and
+	 * the client must not pass parameters only the proxy may send.
+	 */
+	params = buf + 8;
+	params_len = len - 8;
+	if (params_len < 1 || params[params_len - 1] != '\0')
+	{
+		ProxySendError(session, "08P01",
+					   "invalid startup packet layout: expected terminator as last byte");
+		return false;
+	}
+
+	offset = 0;
+	while (offset < params_len - 1)
+	{
+		const char *name = params + offset;
+		const char *value;
+
+		offset += strlen(name) + 1;
+		if (offset >= params_len)
+		{
+			ProxySendError(session, "08P01", "invalid startup packet layout");
+			return false;
+		}
+		value = params + offset;
+		offset += strlen(value) + 1;
+
+		if (strcmp(name, "replication") == 0)
+		{
+			ProxySendError(session, "0A000",
+						   "replication connections are not supported by connection proxies");
+			return false;
+		}
+		if (strncmp(name, "proxy_", 6) == 0)
+		{
+			ProxySendError(session, "42501",
+						   "startup parameters beginning with \"proxy_\" are reserved");
+			return false;
+		}
+	}
+
+	session->pool = ProxyGetPool(proto, params, params_len);
+	session->pool->nsessions++;
+
+	/* Open a backend to authenticate the client */
+	backend = ProxyOpenBackend(session->pool, session);
+	if (backend == NULL)
+	{
+		ProxySendError(session, "08006",
+					   "connection proxy could not connect to the server");
+		return false;
+	}
+	session->state = SESSION_AUTH;
+	return false;
+}
+
+/*
+ * Queue a FATAL error for the client, and close the connection once it has
+ * been sent.
+ */
+static void
+ProxySendError(ProxySession *session, const char *sqlstate,
+			   const char *message)
+{
+	StringInfo	out = &session->conn.outbuf;
+	int			start = out->len;
+	uint32		n32;
+
+	appendStringInfoChar(out, 'E');
+	appendBinaryStringInfo(out, "\0\0\0\0", 4);
+	appendBinaryStringInfo(out, "SFATAL", 7);
+	appendBinaryStringInfo(out, "VFATAL", 7);
+	appendStringInfoChar(out, 'C');
+	appendBinaryStringInfo(out, sqlstate, strlen(sqlstate) + 1);
+	appendStringInfoChar(out, 'M');
+	appendBinaryStringInfo(out, message, strlen(message) + 1);
+	appendStringInfoChar(out, '\0');
+
+	n32 = pg_hton32(out->len - start - 1);
+	memcpy(out->data + start + 1, &n32, 4);
+
+	session->conn.close_after_flush = true;
+	ProxyFlush(&session->conn);
+}
+
+/*
+ * Can the session's backend serve other sessions now?
+ */
+static bool
+ProxySessionIsClean(ProxySession *session)
+{
+	ProxyBackend *backend = session->backend;
+
+	return backend != NULL &&
+		backend->state == BACKEND_READY &&
+		backend->txn_status == 'I' &&
+		!backend->conn.eof &&
+		session->outstanding == 0 &&
+		!session->extended &&
+		!session->pinned;
+}
+
+/*
+ * Close a client session, handing its backend back to the pool if its
+ * state allows that.
+ */
+static void
+ProxyCloseSession(ProxySession *session)
+{
+	ProxyPool  *pool = session->pool;
+
+	if (session->conn.closed)
+		return;
+
+	if (session->backend)
+	{
+		if (ProxySessionIsClean(session))
+			ProxyReleaseBackend(session->backend);
+		else
+		{
+			ProxyBackend *backend = session->backend;
+
+			backend->session = NULL;
+			session->backend = NULL;
+			ProxyCloseBackend(backend);
+		}
+	}
+
+	if (session->waiting)
+	{
+		dlist_delete(&session->wait_node);
+		session->waiting = false;
+		pool->nwaiting--;
+	}
+
+	if (pool)
+		pool->nsessions--;
+
+	ProxyCloseConn(&session->conn);
+}
+
+/* ------------------------------------------------------------
+ * Backends
+ * ------------------------------------------------------------
+ */
+
+/*
+ * Process input from a backend.
+ */
+static void
+ProxyProcessBackend(ProxyBackend *backend)
+{
+	ProxyConn  *conn = &backend->conn;
+	char		msgtype;
+	int			msglen;
+
+	while (!conn->closed && ProxyNextMessage(conn, &msgtype, &msglen))
+	{
+		ProxySession *session = backend->session;
+		const char *msg = conn->inbuf.data + conn->inbuf.cursor;
+
+		if (backend->state == BACKEND_STARTUP)
+		{
+			switch (msgtype)
+			{
+				case 'K':
+					if (msglen == 13)
+					{
+						uint32		n32;
+
+						memcpy(&n32, msg + 5, 4);
+						backend->pid = (int32) pg_ntoh32(n32);
+						memcpy(&n32, msg + 9, 4);
+						backend->cancel_key = (int32) pg_ntoh32(n32);
+					}
+					break;
+				case 'Z':
+					backend->state = BACKEND_READY;
+					backend->txn_status = msg[5];
+					backend->pool->nlaunching--;
+					backend->pooled = true;
+					backend->pool->nbackends++;
+					conn->inbuf.cursor += msglen;
+					ProxyReleaseBackend(backend);
+					continue;
+				case 'E':
+					ProxyBackendFailed(backend, msg, msglen);
+					return;
+				default:
+					/* AuthenticationOk, ParameterStatus, notices */
+					break;
+			}
+			conn->inbuf.cursor += msglen;
+			continue;
+		}
+
+		if (session == NULL)
+		{
+			/*
+			 * An idle backend has nothing to say, except maybe a FATAL error
+			 * when it is being shut down.  We notice that at end of file.
+			 */
+			conn->inbuf.cursor += msglen;
+			continue;
+		}
+
+		if (ProxyOutputFull(&session->conn))
+			break;
+
+		switch (msgtype)
+		{
+			case 'K':
+				if (backend->state == BACKEND_AUTH && msglen == 13)
+				{
+					char		keydata[13];
+					uint32		n32;
+
+					/*
+					 * Remember the backend's key for ourselves, and hand out
+					 * the session's own key instead, so that the client's
+					 * cancel requests come to us.
+					 */
+					memcpy(&n32, msg + 5, 4);
+					backend->pid = (int32) pg_ntoh32(n32);
+					memcpy(&n32, msg + 9, 4);
+					backend->cancel_key = (int32) pg_ntoh32(n32);
+
+					keydata[0] = 'K';
+					n32 = pg_hton32(12);
+					memcpy(keydata + 1, &n32, 4);
+					n32 = pg_hton32((uint32) MyProcPid);
+					memcpy(keydata + 5, &n32, 4);
+					n32 = pg_hton32((uint32) session->cancel_key);
+					memcpy(keydata + 9, &n32, 4);
+					appendBinaryStringInfo(&session->conn.outbuf, keydata, 13);
+					conn->inbuf.cursor += msglen;
+					continue;
+				}
+				break;
+
+			case 'S':
+				if (msglen > 20 &&
+					strcmp(msg + 5, "session_pinned") == 0)
+				{
+					/* This backend now belongs to the session for good */
+					session->pinned = true;
+					if (backend->pooled)
+					{
+						backend->pooled = false;
+						backend->pool->nbackends--;
+						ProxyLaunchBackends(backend->pool);
+					}
+					conn->inbuf.cursor += msglen;
+					continue;
+				}
+				break;
+
+			case 'Z':
+				backend->txn_status = msg[5];
+				if (backend->state == BACKEND_AUTH)
+				{
+					/*
+					 * Authentication is complete.  Keep the backend if the
+					 * pool has room for it.
+					 */
+					backend->state = BACKEND_READY;
+					session->state = SESSION_ACTIVE;
+					ProxyForwardMessage(conn, &session->conn, msglen);
+					ProxyFlush(&session->conn);
+					if (session->conn.closed)
+						return;
+					if (backend->pool->nbackends < SessionPoolSize &&
+						!proxy_draining)
+					{
+						backend->pooled = true;
+						backend->pool->nbackends++;
+						ProxyReleaseBackend(backend);
+					}
+					else
+					{
+						backend->session = NULL;
+						session->backend = NULL;
+						ProxyTerminateBackend(backend);
+					}
+
+					/* The client may have sent its first query already */
+					ProxyProcessInput(&session->conn);
+					return;
+				}
+
+				if (session->outstanding > 0)
+					session->outstanding--;
+				ProxyForwardMessage(conn, &session->conn, msglen);
+				if (ProxySessionIsClean(session))
+				{
+					ProxyFlush(&session->conn);
+					if (!session->conn.closed)
+						ProxyReleaseBackend(backend);
+					/* continue with the session's next request, if any */
+					if (!session->conn.closed)
+						ProxyProcessInput(&session->conn);
+					return;
+				}
+				continue;
+
+			default:
+				break;
+		}
+
+		ProxyForwardMessage(conn, &session->conn, msglen);
+	}
+
+	if (conn->closed)
+		return;
+
+	if (backend->session && !backend->session->conn.closed)
+		ProxyFlush(&backend->session->conn);
+
+	if (!conn->closed && conn->eof && !ProxyNextMessage(conn, &msgtype, &msglen))
+	{
+		if (backend->state == BACKEND_STARTUP)
+			ProxyBackendFailed(backend, NULL, 0);
+		else
+			ProxyCloseBackend(backend);
+	}
+}
+
+/*
+ * Open a new backend for a pool.  If "session" is given, the backend
+ * authenticates that session's client and is attached to it; otherwise it
+ * is started without authentication, to serve already authenticated
+ * sessions of the pool.
+ */
+static ProxyBackend *
+ProxyOpenBackend(ProxyPool *pool, ProxySession *session)
+{
+	ProxyBackend *backend;
+	pgsocket	sock;
+	StringInfoData packet;
+	uint32		n32;
+
+	sock = ProxyConnectPostmaster();
+	if (sock == PGINVALID_SOCKET)
+		return NULL;
+
+	/*
+	 * Build the startup packet: the client's own parameters, followed by the
+	 * ones only a proxy may send.
+	 */
+	initStringInfo(&packet);
+	appendBinaryStringInfo(&packet, "\0\0\0\0", 4);
+	n32 = pg_hton32(pool->proto);
+	appendBinaryStringInfo(&packet, (char *) &n32, 4);
+	appendBinaryStringInfo(&packet, pool->params, pool->params_len - 1);
+	appendBinaryStringInfo(&packet, "proxy_token", 12);
+	appendBinaryStringInfo(&packet, ProxyShmem->token, PROXY_TOKEN_LEN + 1);
+	if (session && session->remote_host)
+	{
+		appendBinaryStringInfo(&packet, "proxy_client_addr", 18);
+		appendBinaryStringInfo(&packet, session->remote_host,
+							   strlen(session->remote_host) + 1);
+		appendBinaryStringInfo(&packet, "proxy_client_port", 18);
+		appendBinaryStringInfo(&packet, session->remote_port,
+							   strlen(session->remote_port) + 1);
+	}
+	if (session == NULL)
+		appendBinaryStringInfo(&packet, "proxy_preauth\0on", 17);
+	appendStringInfoChar(&packet, '\0');
+	n32 = pg_hton32(packet.len);
+	memcpy(packet.data, &n32, 4);
+
+	/* The main loop sends it once the socket is writable */
+	backend = (ProxyBackend *) ProxyNewConn(PROXY_CONN_BACKEND, sock);
+	backend->pool = pool;
+	backend->txn_status = 'I';
+	appendBinaryStringInfo(&backend->conn.outbuf, packet.data, packet.len);
+	pfree(packet.data);
+	pool->nconns++;
+
+	if (session)
+	{
+		backend->state = BACKEND_AUTH;
+		backend->session = session;
+		session->backend = backend;
+	}
+	else
+	{
+		backend->state = BACKEND_STARTUP;
+		pool->nlaunching++;
+	}
+
+	return backend;
+}
+
+/*
+ * Start new backends for sessions waiting in the pool, as far as the pool
+ * size allows.
+ */
+static void
+ProxyLaunchBackends(ProxyPool *pool)
+{
+	while (pool->nlaunching < pool->nwaiting &&
+		   pool->nbackends + pool->nlaunching < SessionPoolSize)
+	{
+		if (ProxyOpenBackend(pool, NULL) == NULL)
+		{
+			ProxyFailWaitingSessions(pool, NULL, 0);
+			break;
+		}
+	}
+}
+
+/*
+ * Find a backend for a session that has work to do.  If none is idle, the
+ * session waits for one.
+ */
+static void
+ProxyAssignBackend(ProxySession *session)
+{
+	ProxyPool  *pool = session->pool;
+
+	Assert(session->backend == NULL);
+
+	if (!dlist_is_empty(&pool->idle_backends))
+	{
+		ProxyBackend *backend;
+
+		backend = dlist_container(ProxyBackend, idle_node,
+								  dlist_pop_head_node(&pool->idle_backends));
+		backend->idle = false;
+		ProxyAttachBackend(backend, session);
+		return;
+	}
+
+	if (!session->waiting)
+	{
+		dlist_push_tail(&pool->waiting_sessions, &session->wait_node);
+		session->waiting = true;
+		pool->nwaiting++;
+	}
+	ProxyLaunchBackends(pool);
+}
+
+static void
+ProxyAttachBackend(ProxyBackend *backend, ProxySession *session)
+{
+	Assert(backend->session == NULL && session->backend == NULL);
+
+	backend->session = session;
+	session->backend = backend;
+	session->outstanding = 0;
+	session->extended = false;
+}
+
+/*
+ * Detach a ready backend from its session, if any, and give it to the next
+ * waiting session or put it on the idle list.
+ */
+static void
+ProxyReleaseBackend(ProxyBackend *backend)
+{
+	ProxyPool  *pool = backend->pool;
+
+	if (backend->session)
+	{
+		backend->session->backend = NULL;
+		backend->session = NULL;
+	}
+
+	/* The pool may have shrunk since the backend was started */
+	if (!backend->pooled || pool->nbackends > SessionPoolSize ||
+		(proxy_draining && pool->nwaiting == 0))
+	{
+		ProxyTerminateBackend(backend);
+		return;
+	}
+
+	if (pool->nwaiting > 0)
+	{
+		ProxySession *session;
+
+		session = dlist_container(ProxySession, wait_node,
+								  dlist_pop_head_node(&pool->waiting_sessions));
+		session->waiting = false;
+		pool->nwaiting--;
+		ProxyAttachBackend(backend, session);
+		ProxyProcessInput(&session->conn);
+		return;
+	}
+
+	/*
+	 * Most recently used backends go first, so that a lightly loaded pool
+	 * keeps using the same few of them.
+	 */
+	dlist_push_head(&pool->idle_backends, &backend->idle_node);
+	backend->idle = true;
+}
+
+/*
+ * Ask a backend to exit, and forget about it.
+ */
+static void
+ProxyTerminateBackend(ProxyBackend *backend)
+{
+	ProxyPool  *pool = backend->pool;
+
+	Assert(backend->session == NULL);
+
+	if (backend->idle)
+	{
+		dlist_delete(&backend->idle_node);
+		backend->idle = false;
+	}
+	if (backend->pooled)
+	{
+		backend->pooled = false;
+		pool->nbackends--;
+	}
+
+	if (!backend->conn.eof)
+	{
+		backend->conn.close_after_flush = true;
+		ProxyQueue(&backend->conn, "X\0\0\0\4", 5);
+	}
+	else
+		ProxyCloseBackend(backend);
+}
+
+/*
+ * Close the connection to a backend.  A session it was serving is closed
+ * too once it has received what the backend sent.
+ */
+static void
+ProxyCloseBackend(ProxyBackend *backend)
+{
+	ProxyPool  *pool = backend->pool;
+	ProxySession *session = backend->session;
+	bool		replace;
+
+	if (backend->conn.closed)
+		return;
+
+	/* Replace a pooled backend that went away, but not a failed launch */
+	replace = backend->pooled;
+
+	if (backend->idle)
+	{
+		dlist_delete(&backend->idle_node);
+		backend->idle = false;
+	}
+	if (backend->pooled)
+	{
+		backend->pooled = false;
+		pool->nbackends--;
+	}
+	if (backend->state == BACKEND_STARTUP)
+		pool->nlaunching--;
+	pool->nconns--;
+
+	if (session)
+	{
+		backend->session = NULL;
+		session->backend = NULL;
+		if (!session->conn.closed)
+		{
+			session->conn.close_after_flush = true;
+			ProxyFlush(&session->conn);
+		}
+	}
+
+	ProxyCloseConn(&backend->conn);
+
+	if (replace && pool->nwaiting > 0)
+		ProxyLaunchBackends(pool);
+}
+
+/*
+ * A backend started for the pool failed to come up, with the given
+ * ErrorResponse message if there was one.
+ */
+static void
+ProxyBackendFailed(ProxyBackend *backend, const char *msg, int len)
+{
+	ProxyPool  *pool = backend->pool;
+	char	   *errmsg_copy = NULL;
+
+	if (msg)
+	{
+		const char *field = msg + 5;
+		const char *text = NULL;
+
+		/* Find the primary message text for the log */
+		while (field < msg + len && *field != '\0')
+		{
+			if (*field == 'M')
+				text = field + 1;
+			field += 1 + strnlen(field + 1, msg + len - field - 1) + 1;
+		}
+		ereport(LOG,
+				(errmsg("connection proxy could not start a backend: %s",
+						text && text < msg + len ? text : "unknown error")));
+
+		errmsg_copy = palloc(len);
+		memcpy(errmsg_copy, msg, len);
+	}
+
+	ProxyCloseBackend(backend);
+	ProxyFailWaitingSessions(pool, errmsg_copy, len);
+
+	if (errmsg_copy)
+		pfree(errmsg_copy);
+}
+
+/*
+ * If no backend of the pool is up or coming up, the sessions waiting in it
+ * won't be served, so send them the error that got us here (or a generic
+ * one) and close them.
+ */
+static void
+ProxyFailWaitingSessions(ProxyPool *pool, const char *msg, int len)
+{
+	if (pool->nbackends > 0 || pool->nlaunching > 0)
+		return;
+
+	while (pool->nwaiting > 0)
+	{
+		ProxySession *session;
+
+		session = dlist_container(ProxySession, wait_node,
+								  dlist_pop_head_node(&pool->waiting_sessions));
+		session->waiting = false;
+		pool->nwaiting--;
+
+		if (msg)
+		{
+			session->conn.close_after_flush = true;
+			ProxyQueue(&session->conn, msg, len);
+		}
+		else
+			ProxySendError(session, "08006",
+						   "connection proxy could not connect to the server");
+	}
+}
+
+/* ------------------------------------------------------------
+ * Pools and miscellaneous
+ * ------------------------------------------------------------
+ */
+
+/*
+ * Find the pool for a set of startup parameters, creating it if needed.
+ */
+static ProxyPool *
+ProxyGetPool(ProtocolVersion proto, const char *params, int params_len)
+{
+	dlist_iter	iter;
+	ProxyPool  *pool;
+
+	dlist_foreach(iter, &proxy_pools)
+	{
+		pool = dlist_container(ProxyPool, node, iter.cur);
+
+		if (pool->proto == proto &&
+			pool->params_len == params_len &&
+			memcmp(pool->params, params, params_len) == 0)
+			return pool;
+	}
+
+	pool = MemoryContextAllocZero(TopMemoryContext, sizeof(ProxyPool));
+	pool->proto = proto;
+	pool->params = MemoryContextAlloc(TopMemoryContext, params_len);
+	memcpy(pool->params, params, params_len);
+	pool->params_len = params_len;
+	dlist_init(&pool->idle_backends);
+	dlist_init(&pool->waiting_sessions);
+	dlist_push_tail(&proxy_pools, &pool->node);
+
+	return pool;
+}
+
+/*
+ * Forget the pools nothing refers to anymore.
+ */
+static void
+ProxyFreeUnusedPools(void)
+{
+	dlist_mutable_iter iter;
+
+	dlist_foreach_modify(iter, &proxy_pools)
+	{
+		ProxyPool  *pool = dlist_container(ProxyPool, node, iter.cur);
+
+		if (pool->nsessions > 0 || pool->nconns > 0)
+			continue;
+
+		dlist_delete(&pool->node);
+		pfree(pool->params);
+		pfree(pool);
+	}
+}
+
+/*
+ * Cancel the current query of our session with the given key, if it has
+ * one running.
+ */
+static void
+ProxyCancelSession(int32 cancel_key)
+{
+	dlist_iter	iter;
+
+	dlist_foreach(iter, &proxy_conns)
+	{
+		ProxyConn  *conn = dlist_container(ProxyConn, node, iter.cur);
+		ProxySession *session = (ProxySession *) conn;
+
+		if (conn->kind != PROXY_CONN_CLIENT ||
+			session->cancel_key != cancel_key)
+			continue;
+
+		if (session->backend && session->backend->state == BACKEND_READY)
+			ProxySendCancelRequest(session->backend->pid,
+								   session->backend->cancel_key);
+		return;
+	}
+}
+
+/*
+ * Pass a cancel request on to the postmaster.
+ */
+static void
+ProxySendCancelRequest(int32 pid, int32 cancel_key)
+{
+	pgsocket	sock;
+	struct
+	{
+		uint32		packetlen;
+		CancelRequestPacket cp;
+	}			crp;
+
+	sock = ProxyConnectPostmaster();
+	if (sock == PGINVALID_SOCKET)
+		return;
+
+	crp.packetlen = pg_hton32((uint32) sizeof(crp));
+	crp.cp.cancelRequestCode = (MsgType) pg_hton32(CANCEL_REQUEST_CODE);
+	crp.cp.backendPID = pg_hton32(pid);
+	crp.cp.cancelAuthCode = pg_hton32(cancel_key);
+
+	if (send(sock, (char *) &crp, sizeof(crp), 0) != (int) sizeof(crp))
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not send cancel request: %m")));
+	closesocket(sock);
+}
+
+/*
+ * Open a connection to the postmaster's Unix-domain socket, and make it
+ * non-blocking.  Connecting to a local socket doesn't take long, so we
+ * don't bother doing that part asynchronously.
+ */
+static pgsocket
+ProxyConnectPostmaster(void)
+{
+#ifdef HAVE_UNIX_SOCKETS
+	struct sockaddr_un addr;
+	pgsocket	sock;
+
+	sock = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (sock == PGINVALID_SOCKET)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not create socket: %m")));
+		return PGINVALID_SOCKET;
+	}
+
+	MemSet(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strlcpy(addr.sun_path, ProxyBackendSocketPath, sizeof(addr.sun_path));
+
+	if (connect(sock, (struct sockaddr *) &addr, sizeof(addr)) < 0)
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not connect to server socket \"%s\": %m",
+						ProxyBackendSocketPath)));
+		closesocket(sock);
+		return PGINVALID_SOCKET;
+	}
+
+	if (!pg_set_noblock(sock))
+	{
+		ereport(LOG,
+				(errcode_for_socket_access(),
+				 errmsg("could not set socket to nonblocking mode: %m")));
+		closesocket(sock);
+		return PGINVALID_SOCKET;
+	}
+
+	return sock;
+#else
+	return PGINVALID_SOCKET;
+#endif
+}
+
+/*
+ * Generate a cancel key for a new session.
+ */
+static int32
+ProxyRandomKey(void)
+{
+	int32		key;
+
+	if (!pg_strong_random(&key, sizeof(key)))
+		key = (int32) random();
+	return key;
+}
@@ -0,0 +1,1212 @@
+/*-------------------------------------------------------------------------
+ * applyparallelworker.c
+ *	   PostgreSQL logical replication: parallel apply workers
+ *
+ * Copyright (c) 2016-2019, PostgreSQL Global Development Group
+ *
+ * IDENTIFICATION
+ *	  src/backend/replication/logical/applyparallelworker.c
+ *
+ * NOTES
+ *	  When max_parallel_apply_workers_per_subscription is set, the apply
+ *	  worker (called the leader here) doesn't apply remote transactions
+ *	  itself, but hands each of them to one of a pool of parallel apply
+ *	  workers, which apply them concurrently.  The leader keeps receiving the
+ *	  replication stream and forwards every message of a transaction to the
+ *	  worker assigned at BEGIN, through a shm_mq in a DSM segment shared by
+ *	  all the workers of the leader.
+ *
+ *	  Transactions are numbered in the order they committed on the
+ *	  publisher, and the workers commit them in that same order: before
+ *	  committing, a worker waits for the preceding transaction to commit.
+ *	  This keeps the replication origin progress, which all the workers share
+ *	  with the leader, correct: everything up to the origin's LSN is applied.
+ *
+ *	  Concurrent transactions changing the same rows must also apply those
+ *	  changes in commit order.  The leader remembers, for the replica
+ *	  identity key of every row changed, the last transaction changing it;
+ *	  a change to a key some earlier transaction still in progress changed
+ *	  carries the number of that transaction, and the worker waits for it to
+ *	  commit before applying the change.  Changes to relations where this
+ *	  isn't enough, because their triggers or unique indexes on other columns
+ *	  may make them conflict with changes to other rows, and TRUNCATE, are
+ *	  serialized instead: they wait for all the preceding transactions, and
+ *	  the following transactions wait for theirs to finish before starting.
+ *
+ *	  All these waits are done on the transaction id of the awaited
+ *	  transaction, like waits for row locks are, so that the deadlock
+ *	  detector sees them; a deadlock between a transaction and one committed
+ *	  later than it on the publisher can only arise from conflicts the above
+ *	  doesn't foresee, and is reported as an error.
+ *
+ *	  While tables of the subscription are being synchronized the leader
+ *	  applies the transactions itself, as the synchronization relies on the
+ *	  apply position the leader reports; streamed transactions are applied by
+ *	  the leader too.  In both cases the leader first waits for all the
+ *	  transactions handed out before to commit.
+ *
+ *	  The parallel apply workers use slots of max_logical_replication_workers
+ *	  and are started on demand.  They exit when the leader does; if one of
+ *	  them fails, the leader fails as well, and replication restarts from the
+ *	  last transaction committed in order.
+ *
+ *-------------------------------------------------------------------------
+ */
+
+#include "postgres.h"
+
+#include "access/htup_details.h"
+#include "access/transam.h"
+#include "access/xact.h"
+#include "catalog/pg_class.h"
+#include "catalog/pg_index.h"
+#include "libpq/pqformat.h"
+#include "miscadmin.h"
+#include "pgstat.h"
+#include "postmaster/bgworker.h"
+#include "replication/logicallauncher.h"
+#include "replication/logicalproto.h"
+#include "replication/logicalrelation.h"
+#include "replication/logicalworker.h"
+#include "replication/origin.h"
+#include "replication/walreceiver.h"
+#include "replication/worker_internal.h"
+#include "storage/condition_variable.h"
+#include "storage/dsm.h"
+#include "storage/ipc.h"
+#include "storage/lmgr.h"
+#include "storage/proc.h"
+#include "storage/shm_mq.h"
+#include "storage/shm_toc.h"
+#include "storage/spin.h"
+#include "tcop/tcopprot.h"
+#include "utils/guc.h"
+#include "utils/hashutils.h"
+#include "utils/inval.h"
+#include "utils/memutils.h"
+#include "utils/rel.h"
+#include "utils/relcache.h"
+#include "utils/syscache.h"
+#include "utils/timestamp.h"
+
+#define PARALLEL_APPLY_MAGIC		0x50a10c01
+
+#define PARALLEL_APPLY_KEY_SHARED	1
+#define PARALLEL_APPLY_KEY_MQ		2
+
+/* Size of the queue of each parallel apply worker. */
+#define PARALLEL_APPLY_QUEUE_SIZE	(1024 * 1024)
+
+/* Forget about keys changed by committed transactions beyond this. */
+#define PARALLEL_APPLY_MAX_KEYS		65536
+
+/*
+ * State of a parallel apply worker, in shared memory.
+ */
+typedef struct ParallelApplyWorkerSlot
+{
+	bool		busy;			/* handed a transaction not committed yet */
+	bool		exited;			/* worker has exited */
+	uint64		seq;			/* number of that transaction */
+	TransactionId xid;			/* its local transaction id, once assigned */
+
+	/* Commit positions of the last transaction, until the leader got them. */
+	bool		finished;
+	uint64		finished_seq;
+	XLogRecPtr	remote_end;
+	XLogRecPtr	local_end;
+} ParallelApplyWorkerSlot;
+
+typedef struct ParallelApplyShared
+{
+	slock_t		mutex;			/* protects the fields below */
+	ConditionVariable cv;		/* broadcast on any change of the state */
+	PGPROC	   *leader;			/* the apply worker */
+
+	/* All transactions up to this one are committed. */
+	uint64		last_committed_seq;
+
+	int			nworkers;
+	ParallelApplyWorkerSlot workers[FLEXIBLE_ARRAY_MEMBER];
+} ParallelApplyShared;
+
+/* Replica identity key of a row, hashed */
+typedef struct ParallelApplyKey
+{
+	LogicalRepRelId relid;
+	uint32		hash;
+} ParallelApplyKey;
+
+typedef struct ParallelApplyKeyEntry
+{
+	ParallelApplyKey key;		/* hash key - must be first */
+	uint64		seq;			/* last transaction changing the row */
+} ParallelApplyKeyEntry;
+
+typedef struct ParallelApplyRelEntry
+{
+	LogicalRepRelId relid;		/* hash key - must be first */
+	bool		valid;
+	bool		safe;			/* can changes be ordered by key alone? */
+} ParallelApplyRelEntry;
+
+/* Last RELATION or TYPE message for an object, to catch up new workers */
+typedef struct ParallelApplySchemaKey
+{
+	char		action;
+	uint32		remoteid;
+} ParallelApplySchemaKey;
+
+typedef struct ParallelApplySchemaEntry
+{
+	ParallelApplySchemaKey key; /* hash key - must be first */
+	char	   *data;
+	int			len;
+} ParallelApplySchemaEntry;
+
+/* Shared state, in the leader and the parallel apply workers. */
+static dsm_segment *pa_seg = NULL;
+static ParallelApplyShared *pa_shared = NULL;
+
+/* Leader state. */
+static shm_mq_handle **pa_queues = NULL;
+static int	pa_nlaunched = 0;
+static TimestampTz pa_last_launch_failure = 0;
+static int	pa_current = -1;	/* worker of the current transaction */
+static uint64 pa_current_seq = 0;
+static uint64 pa_last_seq = 0;
+static uint64 pa_last_barrier_seq = 0;
+static HTAB *pa_key_hash = NULL;
+static HTAB *pa_rel_hash = NULL;
+static HTAB *pa_schema_hash = NULL;
+
+/* Parallel apply worker state. */
+static ParallelApplyWorkerSlot *MyParallelApplySlot = NULL;
+static uint64 pa_my_seq = 0;
+
+/* Flags set by signal handlers */
+static volatile sig_atomic_t got_SIGHUP = false;
+
+static void pa_wait_for_transaction(uint64 seq);
+static void pa_leader_detach_cb(dsm_segment *seg, Datum arg);
+
+
+/*
+ * Create the shared memory segment of the parallel apply workers.
+ */
+static void
+pa_setup(void)
+{
+	shm_toc_estimator e;
+	shm_toc    *toc;
+	Size		sharedsize;
+	Size		segsize;
+	int			nworkers = max_parallel_apply_workers_per_subscription;
+	int			i;
+	MemoryContext oldctx;
+
+	sharedsize = add_size(offsetof(ParallelApplyShared, workers),
+						  mul_size(nworkers, sizeof(ParallelApplyWorkerSlot)));
+
+	shm_toc_initialize_estimator(&e);
+	shm_toc_estimate_chunk(&e, sharedsize);
+	shm_toc_estimate_chunk(&e, mul_size(nworkers, PARALLEL_APPLY_QUEUE_SIZE));
+	shm_toc_estimate_keys(&e, 2);
+	segsize = shm_toc_estimate(&e);
+
+	pa_seg = dsm_create(segsize, 0);
+	dsm_pin_mapping(pa_seg);
+	on_dsm_detach(pa_seg, pa_leader_detach_cb, (Datum) 0);
+
+	toc = shm_toc_create(PARALLEL_APPLY_MAGIC, dsm_segment_address(pa_seg),
+						 segsize);
+
+	pa_shared = shm_toc_allocate(toc, sharedsize);
+	SpinLockInit(&pa_shared->mutex);
+	ConditionVariableInit(&pa_shared->cv);
+	pa_shared->leader = MyProc;
+	pa_shared->last_committed_seq = 0;
+	pa_shared->nworkers = nworkers;
+	for (i = 0; i < nworkers; i++)
+		memset(&pa_shared->workers[i], 0, sizeof(ParallelApplyWorkerSlot));
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_SHARED, pa_shared);
+
+	shm_toc_insert(toc, PARALLEL_APPLY_KEY_MQ,
+				   shm_toc_allocate(toc, mul_size(nworkers,
+												  PARALLEL_APPLY_QUEUE_SIZE)));
+
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	pa_queues = palloc0(nworkers * sizeof(shm_mq_handle *));
+	MemoryContextSwitchTo(oldctx);
+}
+
+/*
+ * Stop waiting on the condition variable in the segment, if we failed while
+ * waiting, before the segment goes away under ProcKill().
+ */
+static void
+pa_leader_detach_cb(dsm_segment *seg, Datum arg)
+{
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Send a message to a parallel apply worker, prefixed with the number of the
+ * transaction the worker has to wait for before processing it.
+ */
+static void
+pa_send(int worker, uint64 depends, const char *data, int len)
+{
+	shm_mq_iovec iov[2];
+	shm_mq_result res;
+
+	iov[0].data = (const char *) &depends;
+	iov[0].len = sizeof(uint64);
+	iov[1].data = data;
+	iov[1].len = len;
+
+	res = shm_mq_sendv(pa_queues[worker], iov, 2, false);
+	if (res != SHM_MQ_SUCCESS)
+		ereport(ERROR,
+				(errcode(ERRCODE_CONNECTION_FAILURE),
+				 errmsg("could not send data to logical replication parallel apply worker for subscription \"%s\"",
+						MySubscription->name)));
+}
+
+/*
+ * Start a new parallel apply worker, and catch it up on the schema of the
+ * relations the publisher has described so far.
+ */
+static bool
+pa_launch_worker(void)
+{
+	int			worker = pa_nlaunched;
+	shm_toc    *toc;
+	shm_mq	   *mq;
+	MemoryContext oldctx;
+
+	toc = shm_toc_attach(PARALLEL_APPLY_MAGIC, dsm_segment_address(pa_seg));
+	mq = shm_mq_create((char *) shm_toc_lookup(toc, PARALLEL_APPLY_KEY_MQ, false) +
+					   worker * PARALLEL_APPLY_QUEUE_SIZE,
+					   PARALLEL_APPLY_QUEUE_SIZE);
+	shm_mq_set_sender(mq, MyProc);
+
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	pa_queues[worker] = shm_mq_attach(mq, pa_seg, NULL);
+	MemoryContextSwitchTo(oldctx);
+
+	if (!logicalrep_worker_launch(MyLogicalRepWorker->dbid,
+								  MySubscription->oid,
+								  MySubscription->name,
+								  MyLogicalRepWorker->userid,
+								  InvalidOid,
+								  dsm_segment_handle(pa_seg),
+								  worker))
+	{
+		shm_mq_detach(pa_queues[worker]);
+		pa_queues[worker] = NULL;
+		pa_last_launch_failure = GetCurrentTimestamp();
+		return false;
+	}
+
+	pa_nlaunched++;
+
+	if (pa_schema_hash)
+	{
+		HASH_SEQ_STATUS status;
+		ParallelApplySchemaEntry *entry;
+
+		hash_seq_init(&status, pa_schema_hash);
+		while ((entry = hash_seq_search(&status)) != NULL)
+			pa_send(worker, 0, entry->data, entry->len);
+	}
+
+	return true;
+}
+
+static int
+pa_finished_cmp(const void *a, const void *b)
+{
+	const ParallelApplyWorkerSlot *sa = (const ParallelApplyWorkerSlot *) a;
+	const ParallelApplyWorkerSlot *sb = (const ParallelApplyWorkerSlot *) b;
+
+	if (sa->finished_seq < sb->finished_seq)
+		return -1;
+	if (sa->finished_seq > sb->finished_seq)
+		return 1;
+	return 0;
+}
+
+/*
+ * Collect the commit positions of the transactions the parallel apply
+ * workers finished, for the feedback sent to the publisher.
+ *
+ * Fails if a parallel apply worker has exited.
+ */
+void
+pa_process_finished(void)
+{
+	ParallelApplyWorkerSlot *finished;
+	int			nfinished = 0;
+	bool		exited = false;
+	int			i;
+
+	if (pa_shared == NULL || pa_nlaunched == 0)
+		return;
+
+	finished = palloc(pa_nlaunched * sizeof(ParallelApplyWorkerSlot));
+
+	SpinLockAcquire(&pa_shared->mutex);
+	for (i = 0; i < pa_nlaunched; i++)
+	{
+		ParallelApplyWorkerSlot *slot = &pa_shared->workers[i];
+
+		if (slot->exited)
+			exited = true;
+		if (slot->finished)
+		{
+			finished[nfinished++] = *slot;
+			slot->finished = false;
+		}
+	}
+	SpinLockRelease(&pa_shared->mutex);
+
+	if (exited)
+		ereport(ERROR,
+				(errmsg("logical replication parallel apply worker for subscription \"%s\" has exited unexpectedly",
+						MySubscription->name)));
+
+	/* the flush positions have to be tracked in commit order */
+	qsort(finished, nfinished, sizeof(ParallelApplyWorkerSlot),
+		  pa_finished_cmp);
+
+	for (i = 0; i < nfinished; i++)
+		store_flush_position(finished[i].remote_end, finished[i].local_end);
+
+	pfree(finished);
+}
+
+/*
+ * Is any parallel apply worker applying a transaction, or did it commit one
+ * we didn't collect the commit positions of yet?
+ */
+bool
+pa_has_busy_workers(void)
+{
+	bool		result = false;
+	int			i;
+
+	if (pa_shared == NULL)
+		return false;
+
+	SpinLockAcquire(&pa_shared->mutex);
+	for (i = 0; i < pa_nlaunched; i++)
+	{
+		if (pa_shared->workers[i].busy || pa_shared->workers[i].finished)
+			result = true;
+	}
+	SpinLockRelease(&pa_shared->mutex);
+
+	return result;
+}
+
+/*
+ * Wait for all transactions handed to parallel apply workers to commit.
+ */
+void
+pa_wait_all(void)
+{
+	Assert(pa_current < 0);
+
+	if (pa_shared == NULL)
+		return;
+
+	for (;;)
+	{
+		pa_process_finished();
+
+		if (!pa_has_busy_workers())
+			break;
+
+		ConditionVariableSleep(&pa_shared->cv,
+							   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+	}
+	ConditionVariableCancelSleep();
+
+	/* there is nothing left to depend on */
+	if (pa_key_hash)
+	{
+		hash_destroy(pa_key_hash);
+		pa_key_hash = NULL;
+	}
+}
+
+/*
+ * Find a parallel apply worker not applying a transaction, starting a new
+ * one or waiting for one to finish if needed.
+ *
+ * Returns -1 if there is no parallel apply worker at all.
+ */
+static int
+pa_get_idle_worker(void)
+{
+	int			nworkers = Min(pa_shared->nworkers,
+							   max_parallel_apply_workers_per_subscription);
+	int			result = -1;
+
+	for (;;)
+	{
+		int			i;
+
+		pa_process_finished();
+
+		SpinLockAcquire(&pa_shared->mutex);
+		for (i = 0; i < pa_nlaunched; i++)
+		{
+			if (!pa_shared->workers[i].busy)
+			{
+				result = i;
+				break;
+			}
+		}
+		SpinLockRelease(&pa_shared->mutex);
+
+		if (result >= 0)
+			break;
+
+		/*
+		 * Start another worker, unless we recently failed to for lack of
+		 * slots.
+		 */
+		if (pa_nlaunched < nworkers &&
+			(pa_last_launch_failure == 0 ||
+			 TimestampDifferenceExceeds(pa_last_launch_failure,
+										GetCurrentTimestamp(),
+										wal_retrieve_retry_interval)) &&
+			pa_launch_worker())
+		{
+			result = pa_nlaunched - 1;
+			break;
+		}
+
+		if (pa_nlaunched == 0)
+			break;
+
+		ConditionVariableSleep(&pa_shared->cv,
+							   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+	}
+	ConditionVariableCancelSleep();
+
+	return result;
+}
+
+/*
+ * Relcache invalidation callback: recheck the relations on next use.
+ */
+static void
+pa_relcache_cb(Datum arg, Oid reloid)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyRelEntry *entry;
+
+	hash_seq_init(&status, pa_rel_hash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+		entry->valid = false;
+}
+
+/*
+ * Does the unique index cover exactly the replica identity key columns of
+ * the remote relation?
+ */
+static bool
+pa_index_matches_key(LogicalRepRelMapEntry *rel, Form_pg_index index)
+{
+	Bitmapset  *keys = NULL;
+	bool		result = true;
+	int			i;
+
+	for (i = 0; i < index->indnkeyatts; i++)
+	{
+		AttrNumber	attnum = index->indkey.values[i];
+
+		/* expression columns, or columns not sent by the publisher */
+		if (attnum <= 0 || rel->attrmap[attnum - 1] < 0)
+		{
+			result = false;
+			break;
+		}
+
+		keys = bms_add_member(keys, rel->attrmap[attnum - 1]);
+	}
+
+	if (result)
+		result = bms_equal(keys, rel->remoterel.attkeys);
+
+	bms_free(keys);
+
+	return result;
+}
+
+/*
+ * Can the changes to the relation be applied concurrently with changes to
+ * other rows of it, and of other relations?
+ *
+ * That's not the case if the local relation has triggers (foreign keys
+ * included), which could look at other rows, or unique or exclusion
+ * constraints other than on the replica identity key, as the changes are
+ * only ordered by the latter.
+ */
+static bool
+pa_relation_is_safe(LogicalRepRelId relid)
+{
+	ParallelApplyRelEntry *entry;
+	bool		found;
+
+	if (pa_rel_hash == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(LogicalRepRelId);
+		ctl.entrysize = sizeof(ParallelApplyRelEntry);
+		ctl.hcxt = ApplyContext;
+		pa_rel_hash = hash_create("logical replication parallel apply relations",
+								  128, &ctl,
+								  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+
+		CacheRegisterRelcacheCallback(pa_relcache_cb, (Datum) 0);
+	}
+
+	entry = hash_search(pa_rel_hash, &relid, HASH_ENTER, &found);
+
+	if (!found || !entry->valid)
+	{
+		LogicalRepRelMapEntry *rel;
+		Relation	localrel;
+		Oid			idxoid = InvalidOid;
+		List	   *indexes;
+		ListCell   *lc;
+		bool		started_tx = false;
+
+		if (!IsTransactionState())
+		{
+			StartTransactionCommand();
+			started_tx = true;
+		}
+
+		rel = logicalrep_rel_open(relid, AccessShareLock);
+		localrel = rel->localrel;
+
+		entry->safe = (localrel->trigdesc == NULL);
+
+		if (rel->remoterel.replident != REPLICA_IDENTITY_FULL)
+		{
+			idxoid = RelationGetReplicaIndex(localrel);
+			if (!OidIsValid(idxoid))
+				idxoid = RelationGetPrimaryKeyIndex(localrel);
+		}
+
+		indexes = RelationGetIndexList(localrel);
+		foreach(lc, indexes)
+		{
+			Oid			indexoid = lfirst_oid(lc);
+			HeapTuple	tup;
+			Form_pg_index index;
+
+			if (!entry->safe)
+				break;
+
+			tup = SearchSysCache1(INDEXRELID, ObjectIdGetDatum(indexoid));
+			if (!HeapTupleIsValid(tup))
+				elog(ERROR, "cache lookup failed for index %u", indexoid);
+			index = (Form_pg_index) GETSTRUCT(tup);
+
+			if (index->indisexclusion ||
+				(index->indisunique &&
+				 (indexoid != idxoid || !pa_index_matches_key(rel, index))))
+				entry->safe = false;
+
+			ReleaseSysCache(tup);
+		}
+		list_free(indexes);
+
+		logicalrep_rel_close(rel, AccessShareLock);
+
+		if (started_tx)
+			CommitTransactionCommand();
+
+		entry->valid = true;
+	}
+
+	return entry->safe;
+}
+
+/*
+ * Make the current transaction wait for all the preceding ones before the
+ * change at hand, and the following transactions wait for the current one
+ * before starting.  Returns the transaction to wait for.
+ */
+static uint64
+pa_serialize_change(void)
+{
+	pa_last_barrier_seq = pa_current_seq;
+
+	return pa_current_seq - 1;
+}
+
+/*
+ * Record that the current transaction changes the row with the given replica
+ * identity key, returning the last preceding transaction that changed it (or
+ * 0).  Sets *unknown if the key isn't included in the tuple.
+ */
+static uint64
+pa_key_dependency(LogicalRepRelId relid, LogicalRepRelation *remoterel,
+				  LogicalRepTupleData *tuple, bool *unknown)
+{
+	ParallelApplyKey key;
+	ParallelApplyKeyEntry *entry;
+	bool		found;
+	uint64		result = 0;
+	int			i;
+
+	memset(&key, 0, sizeof(key));
+	key.relid = relid;
+	key.hash = DatumGetUInt32(hash_uint32(relid));
+
+	i = -1;
+	while ((i = bms_next_member(remoterel->attkeys, i)) >= 0)
+	{
+		uint32		h = 0;
+
+		/* unchanged TOASTed value, which isn't sent */
+		if (!tuple->changed[i])
+		{
+			*unknown = true;
+			return 0;
+		}
+
+		if (tuple->values[i] != NULL)
+			h = DatumGetUInt32(hash_any((unsigned char *) tuple->values[i],
+										strlen(tuple->values[i])));
+		key.hash = hash_combine(key.hash, h);
+	}
+
+	if (pa_key_hash == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ParallelApplyKey);
+		ctl.entrysize = sizeof(ParallelApplyKeyEntry);
+		ctl.hcxt = ApplyContext;
+		pa_key_hash = hash_create("logical replication parallel apply keys",
+								  1024, &ctl,
+								  HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = hash_search(pa_key_hash, &key, HASH_ENTER, &found);
+	if (found && entry->seq != pa_current_seq)
+		result = entry->seq;
+	entry->seq = pa_current_seq;
+
+	return result;
+}
+
+/*
+ * Compute the transaction an INSERT, UPDATE or DELETE message depends on.
+ */
+static uint64
+pa_change_dependency(char action, StringInfo s)
+{
+	StringInfoData msg = *s;
+	LogicalRepRelId relid;
+	LogicalRepRelation *remoterel;
+	LogicalRepTupleData oldtup;
+	LogicalRepTupleData newtup;
+	bool		has_oldtuple = false;
+	bool		has_newtuple = true;
+	bool		unknown = false;
+	uint64		result = 0;
+
+	switch (action)
+	{
+		case 'I':
+			relid = logicalrep_read_insert(&msg, &newtup);
+			break;
+		case 'U':
+			relid = logicalrep_read_update(&msg, &has_oldtuple, &oldtup,
+										   &newtup);
+			break;
+		case 'D':
+			relid = logicalrep_read_delete(&msg, &oldtup);
+			has_oldtuple = true;
+			has_newtuple = false;
+			break;
+		default:
+			elog(ERROR, "unexpected action \"%c\"", action);
+			return 0;			/* keep compiler quiet */
+	}
+
+	if (!pa_relation_is_safe(relid))
+		return pa_serialize_change();
+
+	remoterel = logicalrep_get_remoterel(relid);
+
+	/* Only inserts are possible without a key, and they don't conflict. */
+	if (bms_is_empty(remoterel->attkeys))
+		return action == 'I' ? 0 : pa_serialize_change();
+
+	if (has_oldtuple)
+		result = pa_key_dependency(relid, remoterel, &oldtup, &unknown);
+	if (has_newtuple)
+		result = Max(result,
+					 pa_key_dependency(relid, remoterel, &newtup, &unknown));
+
+	if (unknown)
+		return pa_serialize_change();
+
+	return result;
+}
+
+/*
+ * Forget the keys only changed by transactions known to have committed.
+ */
+static void
+pa_prune_keys(void)
+{
+	HASH_SEQ_STATUS status;
+	ParallelApplyKeyEntry *entry;
+	uint64		last_committed_seq;
+
+	if (pa_key_hash == NULL ||
+		hash_get_num_entries(pa_key_hash) < PARALLEL_APPLY_MAX_KEYS)
+		return;
+
+	SpinLockAcquire(&pa_shared->mutex);
+	last_committed_seq = pa_shared->last_committed_seq;
+	SpinLockRelease(&pa_shared->mutex);
+
+	hash_seq_init(&status, pa_key_hash);
+	while ((entry = hash_seq_search(&status)) != NULL)
+	{
+		if (entry->seq <= last_committed_seq)
+			hash_search(pa_key_hash, &entry->key, HASH_REMOVE, NULL);
+	}
+}
+
+/*
+ * Remember a RELATION or TYPE message, to send it to workers started later.
+ */
+static void
+pa_remember_schema(char action, StringInfo s, int msgstart)
+{
+	ParallelApplySchemaKey key;
+	ParallelApplySchemaEntry *entry;
+	StringInfoData msg = *s;
+	bool		found;
+	int			len = s->len - msgstart;
+
+	if (pa_schema_hash == NULL)
+	{
+		HASHCTL		ctl;
+
+		memset(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(ParallelApplySchemaKey);
+		ctl.entrysize = sizeof(ParallelApplySchemaEntry);
+		ctl.hcxt = ApplyContext;
+		pa_schema_hash = hash_create("logical replication parallel apply schema",
+									 128, &ctl,
+									 HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	memset(&key, 0, sizeof(key));
+	key.action = action;
+	key.remoteid = pq_getmsgint(&msg, 4);
+
+	entry = hash_search(pa_schema_hash, &key, HASH_ENTER, &found);
+	if (found)
+		pfree(entry->data);
+
+	entry->data = MemoryContextAlloc(ApplyContext, len);
+	memcpy(entry->data, s->data + msgstart, len);
+	entry->len = len;
+
+	/* the relation may map to another local one now */
+	if (action == 'R' && pa_rel_hash != NULL)
+		hash_search(pa_rel_hash, &key.remoteid, HASH_REMOVE, NULL);
+}
+
+/*
+ * Process a replication protocol message in the apply worker: hand it to a
+ * parallel apply worker if it belongs to a transaction applied in parallel.
+ *
+ * The message starts at msgstart, s->cursor points past the action.
+ * Returns false if the caller still has to apply the message itself.
+ */
+bool
+pa_handle_message(char action, StringInfo s, int msgstart)
+{
+	const char *data = s->data + msgstart;
+	int			len = s->len - msgstart;
+	int			i;
+
+	switch (action)
+	{
+		case 'B':
+			Assert(pa_current < 0);
+
+			if (max_parallel_apply_workers_per_subscription == 0 ||
+				!AllTablesyncsReady())
+			{
+				/* apply it ourselves, after everything handed out before */
+				pa_wait_all();
+				return false;
+			}
+
+			if (pa_shared == NULL)
+				pa_setup();
+
+			pa_current = pa_get_idle_worker();
+			if (pa_current < 0)
+				return false;
+
+			pa_prune_keys();
+
+			pa_current_seq = ++pa_last_seq;
+
+			SpinLockAcquire(&pa_shared->mutex);
+			pa_shared->workers[pa_current].busy = true;
+			pa_shared->workers[pa_current].seq = pa_current_seq;
+			pa_shared->workers[pa_current].xid = InvalidTransactionId;
+			SpinLockRelease(&pa_shared->mutex);
+
+			pa_send(pa_current, pa_last_barrier_seq, data, len);
+
+			in_remote_transaction = true;
+			pgstat_report_activity(STATE_RUNNING, NULL);
+			return true;
+
+		case 'R':
+		case 'Y':
+			/* all workers need these, and we need relations ourselves */
+			pa_remember_schema(action, s, msgstart);
+			for (i = 0; i < pa_nlaunched; i++)
+				pa_send(i, 0, data, len);
+			return false;
+
+		default:
+			break;
+	}
+
+	if (pa_current < 0)
+		return false;
+
+	switch (action)
+	{
+		case 'I':
+		case 'U':
+		case 'D':
+			pa_send(pa_current, pa_change_dependency(action, s), data, len);
+			break;
+
+		case 'T':
+			pa_send(pa_current, pa_serialize_change(), data, len);
+			break;
+
+		case 'O':
+			pa_send(pa_current, 0, data, len);
+			break;
+
+		case 'C':
+			pa_send(pa_current, 0, data, len);
+
+			pa_current = -1;
+			in_remote_transaction = false;
+			pgstat_report_activity(STATE_IDLE, NULL);
+			break;
+
+		default:
+			ereport(ERROR,
+					(errcode(ERRCODE_PROTOCOL_VIOLATION),
+					 errmsg("invalid logical replication message type \"%c\" in transaction",
+							action)));
+	}
+
+	return true;
+}
+
+/*
+ * Wait for the transaction with the given number to commit.
+ *
+ * Called in a parallel apply worker, in a transaction.
+ */
+static void
+pa_wait_for_transaction(uint64 seq)
+{
+	if (seq == 0)
+		return;
+
+	for (;;)
+	{
+		TransactionId xid = InvalidTransactionId;
+		bool		committed;
+		bool		exited = false;
+		int			i;
+
+		SpinLockAcquire(&pa_shared->mutex);
+		committed = (pa_shared->last_committed_seq >= seq);
+		for (i = 0; !committed && i < pa_shared->nworkers; i++)
+		{
+			ParallelApplyWorkerSlot *slot = &pa_shared->workers[i];
+
+			if (slot->busy && slot->seq == seq)
+			{
+				xid = slot->xid;
+				exited = slot->exited;
+				break;
+			}
+		}
+		SpinLockRelease(&pa_shared->mutex);
+
+		if (committed)
+			break;
+
+		if (exited)
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("logical replication parallel apply worker for subscription \"%s\" cannot continue because a preceding transaction failed",
+							MySubscription->name)));
+
+		if (TransactionIdIsValid(xid))
+		{
+			ConditionVariableCancelSleep();
+
+			/* wait like for a row lock, so that deadlocks are detected */
+			XactLockTableWait(xid, NULL, NULL, XLTW_None);
+
+			if (TransactionIdDidCommit(xid))
+				break;
+
+			ereport(ERROR,
+					(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+					 errmsg("logical replication parallel apply worker for subscription \"%s\" cannot continue because a preceding transaction failed",
+							MySubscription->name)));
+		}
+
+		/* the transaction didn't start yet */
+		ConditionVariableSleep(&pa_shared->cv,
+							   WAIT_EVENT_LOGICAL_PARALLEL_APPLY_STATE_CHANGE);
+	}
+	ConditionVariableCancelSleep();
+}
+
+/*
+ * Publish the local transaction id of the transaction the parallel apply
+ * worker started applying.
+ */
+void
+pa_start_transaction(TransactionId xid)
+{
+	SpinLockAcquire(&pa_shared->mutex);
+	MyParallelApplySlot->xid = xid;
+	pa_my_seq = MyParallelApplySlot->seq;
+	SpinLockRelease(&pa_shared->mutex);
+
+	ConditionVariableBroadcast(&pa_shared->cv);
+}
+
+/*
+ * Wait for the transaction committed before the current one on the
+ * publisher to be committed here too.
+ */
+void
+pa_wait_for_preceding(void)
+{
+	pa_wait_for_transaction(pa_my_seq - 1);
+}
+
+/*
+ * Report the commit of the current transaction to the leader and the other
+ * parallel apply workers.
+ */
+void
+pa_finish_transaction(XLogRecPtr remote_end, XLogRecPtr local_end)
+{
+	SpinLockAcquire(&pa_shared->mutex);
+	if (pa_shared->last_committed_seq < pa_my_seq)
+		pa_shared->last_committed_seq = pa_my_seq;
+	MyParallelApplySlot->finished = true;
+	MyParallelApplySlot->finished_seq = pa_my_seq;
+	MyParallelApplySlot->remote_end = remote_end;
+	MyParallelApplySlot->local_end = local_end;
+	MyParallelApplySlot->busy = false;
+	MyParallelApplySlot->seq = 0;
+	MyParallelApplySlot->xid = InvalidTransactionId;
+	SpinLockRelease(&pa_shared->mutex);
+
+	pa_my_seq = 0;
+
+	ConditionVariableBroadcast(&pa_shared->cv);
+	SetLatch(&pa_shared->leader->procLatch);
+}
+
+/*
+ * Let the leader and the other parallel apply workers know we're gone.
+ */
+static void
+pa_worker_detach_cb(dsm_segment *seg, Datum arg)
+{
+	/* as in pa_leader_detach_cb */
+	ConditionVariableCancelSleep();
+
+	SpinLockAcquire(&pa_shared->mutex);
+	MyParallelApplySlot->exited = true;
+	SpinLockRelease(&pa_shared->mutex);
+
+	ConditionVariableBroadcast(&pa_shared->cv);
+	SetLatch(&pa_shared->leader->procLatch);
+}
+
+/* SIGHUP: set flag to reload configuration at next convenient time */
+static void
+pa_worker_sighup(SIGNAL_ARGS)
+{
+	int			save_errno = errno;
+
+	got_SIGHUP = true;
+
+	/* Waken anything waiting on the process latch */
+	SetLatch(MyLatch);
+
+	errno = save_errno;
+}
+
+/* Logical replication parallel apply worker entry point */
+void
+ParallelApplyWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	dsm_handle	handle;
+	int			worker;
+	shm_toc    *toc;
+	shm_mq	   *mq;
+	shm_mq_handle *mqh;
+	char		originname[NAMEDATALEN];
+	RepOriginId originid;
+
+	memcpy(&handle, MyBgworkerEntry->bgw_extra, sizeof(dsm_handle));
+	memcpy(&worker, MyBgworkerEntry->bgw_extra + sizeof(dsm_handle),
+		   sizeof(int));
+
+	/* Setup signal handling */
+	pqsignal(SIGHUP, pa_worker_sighup);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * Attach to the shared memory segment before attaching to the worker
+	 * slot, which is what the leader waits for, so that the leader learns
+	 * about our exit from then on.
+	 */
+	pa_seg = dsm_attach(handle);
+	if (pa_seg == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("could not map dynamic shared memory segment")));
+
+	toc = shm_toc_attach(PARALLEL_APPLY_MAGIC, dsm_segment_address(pa_seg));
+	if (toc == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_OBJECT_NOT_IN_PREREQUISITE_STATE),
+				 errmsg("invalid magic number in dynamic shared memory segment")));
+
+	pa_shared = shm_toc_lookup(toc, PARALLEL_APPLY_KEY_SHARED, false);
+	MyParallelApplySlot = &pa_shared->workers[worker];
+	on_dsm_detach(pa_seg, pa_worker_detach_cb, (Datum) 0);
+
+	mq = (shm_mq *) ((char *) shm_toc_lookup(toc, PARALLEL_APPLY_KEY_MQ, false) +
+					 worker * PARALLEL_APPLY_QUEUE_SIZE);
+	shm_mq_set_receiver(mq, MyProc);
+	mqh = shm_mq_attach(mq, pa_seg, NULL);
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+
+	/* Run as replica session replication role. */
+	SetConfigOption("session_replication_role", "replica",
+					PGC_SUSET, PGC_S_OVERRIDE);
+
+	/* Connect to our database. */
+	BackgroundWorkerInitializeConnectionByOid(MyLogicalRepWorker->dbid,
+											  MyLogicalRepWorker->userid,
+											  0);
+
+	/*
+	 * Set always-secure search path, so malicious users can't redirect user
+	 * code (e.g. pg_index.indexprs).
+	 */
+	SetConfigOption("search_path", "", PGC_SUSET, PGC_S_OVERRIDE);
+
+	InitializeApplyWorker();
+
+	/* Share the replication origin of the leader. */
+	StartTransactionCommand();
+	snprintf(originname, sizeof(originname), "pg_%u", MySubscription->oid);
+	originid = replorigin_by_name(originname, false);
+	replorigin_session_setup(originid, MyLogicalRepWorker->leader_pid);
+	replorigin_session_origin = originid;
+	CommitTransactionCommand();
+
+	ApplyMessageContext = AllocSetContextCreate(ApplyContext,
+												"ApplyMessageContext",
+												ALLOCSET_DEFAULT_SIZES);
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+
+	for (;;)
+	{
+		shm_mq_result res;
+		Size		len;
+		void	   *data;
+		uint64		depends;
+		char		action;
+		StringInfoData s;
+
+		CHECK_FOR_INTERRUPTS();
+
+		if (got_SIGHUP)
+		{
+			got_SIGHUP = false;
+			ProcessConfigFile(PGC_SIGHUP);
+		}
+
+		res = shm_mq_receive(mqh, &len, &data, false);
+		if (res != SHM_MQ_SUCCESS)
+			ereport(ERROR,
+					(errcode(ERRCODE_CONNECTION_FAILURE),
+					 errmsg("lost connection to the logical replication apply worker")));
+
+		MemoryContextSwitchTo(ApplyMessageContext);
+
+		memcpy(&depends, data, sizeof(uint64));
+
+		s.data = (char *) data;
+		s.len = len;
+		s.cursor = sizeof(uint64);
+		s.maxlen = -1;
+
+		action = s.data[s.cursor];
+
+		/* the wait needs a transaction, which BEGIN starts */
+		if (action != 'B')
+			pa_wait_for_transaction(depends);
+
+		apply_dispatch(&s);
+
+		if (action == 'B')
+			pa_wait_for_transaction(depends);
+
+		MemoryContextSwitchTo(TopMemoryContext);
+		MemoryContextReset(ApplyMessageContext);
+	}
+}
@@ -191,6 +191,29 @@ logicalrep_relmap_update(LogicalRepRelation *remoterel)
 	MemoryContextSwitchTo(oldctx);
 }
 
+/*
+ * Get the description of a remote relation last sent by the publisher,
+ * without opening the local relation it's mapped to.
+ */
+LogicalRepRelation *
+logicalrep_get_remoterel(LogicalRepRelId remoteid)
+{
+	LogicalRepRelMapEntry *entry;
+	bool		found;
+
+	if (LogicalRepRelMap == NULL)
+		logicalrep_relmap_init();
+
+	entry = hash_search(LogicalRepRelMap, (void *) &remoteid,
+						HASH_FIND, &found);
+
+	if (!found)
+		elog(ERROR, "no relation map entry for remote relation ID %u",
+			 remoteid);
+
+	return &entry->remoterel;
+}
+
 /*
  * Find attribute index in TupleDesc struct by attribute name.
  *
@@ -31,10 +31,13 @@
  *	  smallest current LSN from the heap.
  *
  *	  In order to cope with large transactions - which can be several times as
- *	  big as the available memory - this module supports spooling the contents
- *	  of a large transactions to disk. When the transaction is replayed the
- *	  contents of individual (sub-)transactions will be read from disk in
- *	  chunks.
+ *	  big as the available memory - the memory used by all decoded changes is
+ *	  limited to logical_decoding_work_mem.  Whenever that limit is exceeded
+ *	  the largest transaction is evicted from memory: if the output plugin
+ *	  supports it, and the transaction can be decoded before its commit, it is
+ *	  streamed (cf. ReorderBufferStreamTXN()); otherwise its contents are
+ *	  spooled to disk. When a spooled transaction is replayed the contents of
+ *	  individual (sub-)transactions will be read from disk in chunks.
  *
  *	  This module also has to deal with reassembling toast records from the
  *	  individual chunks stored in WAL. When a new (or initial) version of a
@@ -151,16 +154,14 @@ typedef struct ReorderBufferDiskChange
 } ReorderBufferDiskChange;
 
 /*
- * Maximum number of changes kept in memory, per transaction. After that,
- * changes are spooled to disk.
- *
- * The current value should be sufficient to decode the entire transaction
- * without hitting disk in OLTP workloads, while starting to spool to disk in
- * other workloads reasonably fast.
- *
- * At some point in the future it probably makes sense to have a more elaborate
- * resource management here, but it's not entirely clear what that would look
- * like.
+ * Maximum memory used by decoded changes of all transactions, in kilobytes.
+ * Above that, the largest transaction is streamed or spooled to disk.
+ */
+int			logical_decoding_work_mem;
+
+/*
+ * Maximum number of changes of a spooled transaction restored into memory at
+ * once, per (sub)transaction.
  */
 static const Size max_changes_in_memory = 4096;
 
@@ -175,6 +176,9 @@ static ReorderBufferTXN *ReorderBufferTXNByXid(ReorderBuffer *rb,
 											   XLogRecPtr lsn, bool create_as_top);
 static void ReorderBufferTransferSnapToParent(ReorderBufferTXN *txn,
 											  ReorderBufferTXN *subtxn);
+static void ReorderBufferProcessTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+									XLogRecPtr commit_lsn, Snapshot snapshot_now,
+									CommandId command_id, bool streaming);
 
 static void AssertTXNLsnOrder(ReorderBuffer *rb);
 
@@ -193,12 +197,35 @@ static void ReorderBufferIterTXNFinish(ReorderBuffer *rb,
 									   ReorderBufferIterTXNState *state);
 static void ReorderBufferExecuteInvalidations(ReorderBuffer *rb, ReorderBufferTXN *txn);
 
+/* ---------------------------------------
+ * memory accounting and eviction
+ * ---------------------------------------
+ */
+static Size ReorderBufferChangeSize(ReorderBufferChange *change);
+static void ReorderBufferChangeMemoryUpdate(ReorderBuffer *rb,
+											ReorderBufferChange *change,
+											bool addition);
+static void ReorderBufferProcessPartialChange(ReorderBuffer *rb,
+											  ReorderBufferTXN *txn,
+											  ReorderBufferChange *change,
+											  bool toast_insert);
+static void ReorderBufferCheckMemoryLimit(ReorderBuffer *rb);
+static ReorderBufferTXN *ReorderBufferLargestTXN(ReorderBuffer *rb);
+
+/* ---------------------------------------
+ * streaming of in-progress transactions
+ * ---------------------------------------
+ */
+static bool ReorderBufferCanStartStreaming(ReorderBuffer *rb);
+static ReorderBufferTXN *ReorderBufferLargestStreamableTopTXN(ReorderBuffer *rb);
+static void ReorderBufferStreamTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+static void ReorderBufferTruncateTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
+
 /*
  * ---------------------------------------
  * Disk serialization support functions
  * ---------------------------------------
  */
-static void ReorderBufferCheckSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
 static void ReorderBufferSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn);
 static void ReorderBufferSerializeChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 										 int fd, ReorderBufferChange *change);
@@ -278,6 +305,7 @@ ReorderBufferAllocate(void)
 
 	buffer->outbuf = NULL;
 	buffer->outbufsize = 0;
+	buffer->size = 0;
 
 	buffer->current_restart_decoding_lsn = InvalidXLogRecPtr;
 
@@ -359,6 +387,12 @@ ReorderBufferReturnTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 		txn->invalidations = NULL;
 	}
 
+	if (txn->snapshot_now != NULL)
+	{
+		ReorderBufferFreeSnap(rb, txn->snapshot_now);
+		txn->snapshot_now = NULL;
+	}
+
 	pfree(txn);
 }
 
@@ -383,6 +417,9 @@ ReorderBufferGetChange(ReorderBuffer *rb)
 void
 ReorderBufferReturnChange(ReorderBuffer *rb, ReorderBufferChange *change)
 {
+	/* update memory accounting info */
+	ReorderBufferChangeMemoryUpdate(rb, change, false);
+
 	/* free contained data */
 	switch (change->action)
 	{
@@ -583,23 +620,35 @@ ReorderBufferTXNByXid(ReorderBuffer *rb, TransactionId xid, bool create,
 }
 
 /*
- * Queue a change into a transaction so it can be replayed upon commit.
+ * Queue a change into a transaction so it can be replayed upon commit, or
+ * streamed before that.
+ *
+ * toast_insert marks the insertion of a toast chunk, which has to be decoded
+ * together with the change to the main table that follows it.
  */
 void
 ReorderBufferQueueChange(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn,
-						 ReorderBufferChange *change)
+						 ReorderBufferChange *change, bool toast_insert)
 {
 	ReorderBufferTXN *txn;
 
 	txn = ReorderBufferTXNByXid(rb, xid, true, NULL, lsn, true);
 
 	change->lsn = lsn;
+	change->txn = txn;
 	Assert(InvalidXLogRecPtr != lsn);
 	dlist_push_tail(&txn->changes, &change->node);
 	txn->nentries++;
 	txn->nentries_mem++;
 
-	ReorderBufferCheckSerializeTXN(rb, txn);
+	/* remember whether the transaction can be cut off after this change */
+	ReorderBufferProcessPartialChange(rb, txn, change, toast_insert);
+
+	/* update memory accounting information */
+	ReorderBufferChangeMemoryUpdate(rb, change, true);
+
+	/* check the memory limits and evict something if needed */
+	ReorderBufferCheckMemoryLimit(rb);
 }
 
 /*
@@ -627,7 +676,7 @@ ReorderBufferQueueMessage(ReorderBuffer *rb, TransactionId xid,
 		change->data.msg.message = palloc(message_size);
 		memcpy(change->data.msg.message, message, message_size);
 
-		ReorderBufferQueueChange(rb, xid, lsn, change);
+		ReorderBufferQueueChange(rb, xid, lsn, change, false);
 
 		MemoryContextSwitchTo(oldcontext);
 	}
@@ -807,12 +856,20 @@ ReorderBufferAssignChild(ReorderBuffer *rb, TransactionId xid,
 
 	subtxn->is_known_as_subxact = true;
 	subtxn->toplevel_xid = xid;
+	subtxn->toptxn = txn;
 	Assert(subtxn->nsubtxns == 0);
 
 	/* add to subtransaction list */
 	dlist_push_tail(&txn->subtxns, &subtxn->node);
 	txn->nsubtxns++;
 
+	/* the subxact's changes now count against its toplevel transaction */
+	txn->total_size += subtxn->size;
+	subtxn->total_size = 0;
+	if (subtxn->has_partial_change)
+		txn->has_partial_change = true;
+	subtxn->has_partial_change = false;
+
 	/* Possibly transfer the subtxn's snapshot to its top-level txn. */
 	ReorderBufferTransferSnapToParent(txn, subtxn);
 
@@ -1207,6 +1264,12 @@ ReorderBufferCleanupTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 	bool		found;
 	dlist_mutable_iter iter;
 
+	/*
+	 * Release leftover toast chunks first, they may belong to one of the
+	 * subtransactions cleaned up below.
+	 */
+	ReorderBufferToastReset(rb, txn);
+
 	/* cleanup subtransactions & their changes */
 	dlist_foreach_modify(iter, &txn->subtxns)
 	{
@@ -1433,57 +1496,69 @@ ReorderBufferFreeSnap(ReorderBuffer *rb, Snapshot snap)
 }
 
 /*
- * Perform the replay of a transaction and its non-aborted subtransactions.
- *
- * Subtransactions previously have to be processed by
- * ReorderBufferCommitChild(), even if previously assigned to the toplevel
- * transaction with ReorderBufferAssignChild.
- *
- * We currently can only decode a transaction's contents when its commit
- * record is read because that's the only place where we know about cache
- * invalidations. Thus, once a toplevel commit is read, we iterate over the top
- * and subtransactions (using a k-way merge) and replay the changes in lsn
- * order.
+ * Helper functions passing a change to the output plugin, either as part of
+ * the replay at commit or as part of a stream block.
  */
-void
-ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
-					XLogRecPtr commit_lsn, XLogRecPtr end_lsn,
-					TimestampTz commit_time,
-					RepOriginId origin_id, XLogRecPtr origin_lsn)
+static inline void
+ReorderBufferApplyChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						 Relation relation, ReorderBufferChange *change,
+						 bool streaming)
 {
-	ReorderBufferTXN *txn;
-	volatile Snapshot snapshot_now;
-	volatile CommandId command_id = FirstCommandId;
-	bool		using_subtxn;
-	ReorderBufferIterTXNState *volatile iterstate = NULL;
-
-	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
-								false);
-
-	/* unknown transaction, nothing to replay */
-	if (txn == NULL)
-		return;
+	if (streaming)
+		rb->stream_change(rb, txn, relation, change);
+	else
+		rb->apply_change(rb, txn, relation, change);
+}
 
-	txn->final_lsn = commit_lsn;
-	txn->end_lsn = end_lsn;
-	txn->commit_time = commit_time;
-	txn->origin_id = origin_id;
-	txn->origin_lsn = origin_lsn;
+static inline void
+ReorderBufferApplyTruncate(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						   int nrelations, Relation *relations,
+						   ReorderBufferChange *change, bool streaming)
+{
+	if (streaming)
+		rb->stream_truncate(rb, txn, nrelations, relations, change);
+	else
+		rb->apply_truncate(rb, txn, nrelations, relations, change);
+}
 
-	/*
-	 * If this transaction has no snapshot, it didn't make any changes to the
-	 * database, so there's nothing to decode.  Note that
-	 * ReorderBufferCommitChild will have transferred any snapshots from
-	 * subtransactions if there were any.
-	 */
-	if (txn->base_snapshot == NULL)
-	{
-		Assert(txn->ninvalidations == 0);
-		ReorderBufferCleanupTXN(rb, txn);
-		return;
-	}
+static inline void
+ReorderBufferApplyMessage(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						  ReorderBufferChange *change, bool streaming)
+{
+	if (streaming)
+		rb->stream_message(rb, txn, change->lsn, true,
+						   change->data.msg.prefix,
+						   change->data.msg.message_size,
+						   change->data.msg.message);
+	else
+		rb->message(rb, txn, change->lsn, true,
+					change->data.msg.prefix,
+					change->data.msg.message_size,
+					change->data.msg.message);
+}
 
-	snapshot_now = txn->base_snapshot;
+/*
+ * Replay the changes of a transaction and its non-aborted subtransactions
+ * that are currently in the reorder buffer, starting with the given snapshot
+ * and command id.
+ *
+ * Without streaming the whole transaction is replayed at its commit and
+ * cleaned up afterwards.  With streaming, the changes decoded so far are sent
+ * as one stream block and then discarded; the snapshot and command id the
+ * block ended with are stored in the transaction for the next one.
+ */
+static void
+ReorderBufferProcessTXN(ReorderBuffer *rb, ReorderBufferTXN *txn,
+						XLogRecPtr commit_lsn, Snapshot snapshot,
+						CommandId cid, bool streaming)
+{
+	volatile Snapshot snapshot_now = snapshot;
+	volatile CommandId command_id = cid;
+	bool		using_subtxn;
+	bool		stream_started = false;
+	XLogRecPtr	prev_lsn = InvalidXLogRecPtr;
+	MemoryContext ccxt = CurrentMemoryContext;
+	ReorderBufferIterTXNState *volatile iterstate = NULL;
 
 	/* build data to be able to lookup the CommandIds of catalog tuples */
 	ReorderBufferBuildTupleCidHash(rb, txn);
@@ -1513,7 +1588,8 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		else
 			StartTransactionCommand();
 
-		rb->begin(rb, txn);
+		if (!streaming)
+			rb->begin(rb, txn);
 
 		ReorderBufferIterTXNInit(rb, txn, &iterstate);
 		while ((change = ReorderBufferIterTXNNext(rb, iterstate)) != NULL)
@@ -1521,6 +1597,15 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 			Relation	relation = NULL;
 			Oid			reloid;
 
+			/* the first change opens the stream block */
+			if (streaming && !stream_started)
+			{
+				rb->stream_start(rb, txn, change->lsn);
+				txn->streamed = true;
+				stream_started = true;
+			}
+			prev_lsn = change->lsn;
+
 			switch (change->action)
 			{
 				case REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM:
@@ -1597,7 +1682,8 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					if (!IsToastRelation(relation))
 					{
 						ReorderBufferToastReplace(rb, txn, relation, change);
-						rb->apply_change(rb, txn, relation, change);
+						ReorderBufferApplyChange(rb, txn, relation, change,
+												 streaming);
 
 						/*
 						 * Only clear reassembled toast chunks if we're sure
@@ -1695,7 +1781,9 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 							relations[nrelations++] = relation;
 						}
 
-						rb->apply_truncate(rb, txn, nrelations, relations, change);
+						ReorderBufferApplyTruncate(rb, txn, nrelations,
+												   relations, change,
+												   streaming);
 
 						for (i = 0; i < nrelations; i++)
 							RelationClose(relations[i]);
@@ -1704,10 +1792,7 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 					}
 
 				case REORDER_BUFFER_CHANGE_MESSAGE:
-					rb->message(rb, txn, change->lsn, true,
-								change->data.msg.prefix,
-								change->data.msg.message_size,
-								change->data.msg.message);
+					ReorderBufferApplyMessage(rb, txn, change, streaming);
 					break;
 
 				case REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT:
@@ -1793,8 +1878,17 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		ReorderBufferIterTXNFinish(rb, iterstate);
 		iterstate = NULL;
 
-		/* call commit callback */
-		rb->commit(rb, txn, commit_lsn);
+		/*
+		 * Close the stream block, or call the commit callback if the whole
+		 * transaction has been replayed.
+		 */
+		if (streaming)
+		{
+			if (stream_started)
+				rb->stream_stop(rb, txn, prev_lsn);
+		}
+		else
+			rb->commit(rb, txn, commit_lsn);
 
 		/* this is just a sanity check against bad output plugin behaviour */
 		if (GetCurrentTransactionIdIfAny() != InvalidTransactionId)
@@ -1818,11 +1912,33 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 		if (using_subtxn)
 			RollbackAndReleaseCurrentSubTransaction();
 
+		/*
+		 * The next stream block continues where this one ended.  Remember
+		 * the snapshot before freeing it, it may be one of the changes.
+		 */
+		if (streaming)
+		{
+			txn->command_id = command_id;
+			txn->snapshot_now = ReorderBufferCopySnap(rb, snapshot_now, txn,
+													  command_id);
+		}
+
 		if (snapshot_now->copied)
 			ReorderBufferFreeSnap(rb, snapshot_now);
 
-		/* remove potential on-disk data, and deallocate */
-		ReorderBufferCleanupTXN(rb, txn);
+		if (streaming)
+		{
+			/* the streamed changes aren't needed anymore */
+			ReorderBufferTruncateTXN(rb, txn);
+		}
+		else
+		{
+			/* remove potential on-disk data, and deallocate */
+			ReorderBufferCleanupTXN(rb, txn);
+		}
+
+		/* ending the transaction above changed the memory context */
+		MemoryContextSwitchTo(ccxt);
 	}
 	PG_CATCH();
 	{
@@ -1855,6 +1971,70 @@ ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
 	PG_END_TRY();
 }
 
+/*
+ * Perform the replay of a transaction and its non-aborted subtransactions.
+ *
+ * Subtransactions previously have to be processed by
+ * ReorderBufferCommitChild(), even if previously assigned to the toplevel
+ * transaction with ReorderBufferAssignChild.
+ *
+ * Unless the transaction was streamed, we can only decode its contents when
+ * its commit record is read because that's the only place where we know about
+ * cache invalidations. Thus, once a toplevel commit is read, we iterate over
+ * the top and subtransactions (using a k-way merge) and replay the changes in
+ * lsn order.
+ */
+void
+ReorderBufferCommit(ReorderBuffer *rb, TransactionId xid,
+					XLogRecPtr commit_lsn, XLogRecPtr end_lsn,
+					TimestampTz commit_time,
+					RepOriginId origin_id, XLogRecPtr origin_lsn)
+{
+	ReorderBufferTXN *txn;
+
+	txn = ReorderBufferTXNByXid(rb, xid, false, NULL, InvalidXLogRecPtr,
+								false);
+
+	/* unknown transaction, nothing to replay */
+	if (txn == NULL)
+		return;
+
+	txn->final_lsn = commit_lsn;
+	txn->end_lsn = end_lsn;
+	txn->commit_time = commit_time;
+	txn->origin_id = origin_id;
+	txn->origin_lsn = origin_lsn;
+
+	/*
+	 * If this transaction has no snapshot, it didn't make any changes to the
+	 * database, so there's nothing to decode.  Note that
+	 * ReorderBufferCommitChild will have transferred any snapshots from
+	 * subtransactions if there were any.
+	 */
+	if (txn->base_snapshot == NULL)
+	{
+		Assert(txn->ninvalidations == 0);
+		ReorderBufferCleanupTXN(rb, txn);
+		return;
+	}
+
+	/*
+	 * If parts of the transaction were already streamed, send the changes
+	 * decoded since the last stream block and tell the output plugin that
+	 * the transaction committed.
+	 */
+	if (txn->streamed)
+	{
+		ReorderBufferStreamTXN(rb, txn);
+		rb->stream_commit(rb, txn, commit_lsn);
+		ReorderBufferCleanupTXN(rb, txn);
+		return;
+	}
+
+	ReorderBufferProcessTXN(rb, txn, commit_lsn, txn->base_snapshot,
+							FirstCommandId, false);
+}
+
 /*
  * Abort a transaction that possibly has previous changes. Needs to be first
  * called for subtransactions and then for the toplevel xid.
@@ -1882,6 +2062,13 @@ ReorderBufferAbort(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn)
 	/* cosmetic... */
 	txn->final_lsn = lsn;
 
+	/*
+	 * Parts of the transaction may have been streamed already, tell the
+	 * output plugin to throw them away.
+	 */
+	if (txn->streamed || (txn->toptxn != NULL && txn->toptxn->streamed))
+		rb->stream_abort(rb, txn, lsn);
+
 	/* remove potential on-disk data, and deallocate */
 	ReorderBufferCleanupTXN(rb, txn);
 }
@@ -1915,6 +2102,9 @@ ReorderBufferAbortOld(ReorderBuffer *rb, TransactionId oldestRunningXid)
 		{
 			elog(DEBUG2, "aborting old transaction %u", txn->xid);
 
+			if (txn->streamed)
+				rb->stream_abort(rb, txn, txn->final_lsn);
+
 			/* remove potential on-disk data, and deallocate this tx */
 			ReorderBufferCleanupTXN(rb, txn);
 		}
@@ -1962,6 +2152,10 @@ ReorderBufferForget(ReorderBuffer *rb, TransactionId xid, XLogRecPtr lsn)
 	else
 		Assert(txn->ninvalidations == 0);
 
+	/* changes we already streamed must not be applied after all */
+	if (txn->streamed)
+		rb->stream_abort(rb, txn, lsn);
+
 	/* remove potential on-disk data, and deallocate */
 	ReorderBufferCleanupTXN(rb, txn);
 }
@@ -2030,7 +2224,7 @@ ReorderBufferAddSnapshot(ReorderBuffer *rb, TransactionId xid,
 	change->data.snapshot = snap;
 	change->action = REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT;
 
-	ReorderBufferQueueChange(rb, xid, lsn, change);
+	ReorderBufferQueueChange(rb, xid, lsn, change, false);
 }
 
 /*
@@ -2079,7 +2273,7 @@ ReorderBufferAddNewCommandId(ReorderBuffer *rb, TransactionId xid,
 	change->data.command_id = cid;
 	change->action = REORDER_BUFFER_CHANGE_INTERNAL_COMMAND_ID;
 
-	ReorderBufferQueueChange(rb, xid, lsn, change);
+	ReorderBufferQueueChange(rb, xid, lsn, change, false);
 }
 
 
@@ -2207,42 +2401,374 @@ ReorderBufferXidHasBaseSnapshot(ReorderBuffer *rb, TransactionId xid)
 
 /*
  * ---------------------------------------
- * Disk serialization support
+ * Memory accounting
  * ---------------------------------------
  */
 
 /*
- * Ensure the IO buffer is >= sz.
+ * Approximate the memory used by a change, including the tuples or other
+ * data it references.
+ */
+static Size
+ReorderBufferChangeSize(ReorderBufferChange *change)
+{
+	Size		sz = sizeof(ReorderBufferChange);
+
+	switch (change->action)
+	{
+		case REORDER_BUFFER_CHANGE_INSERT:
+		case REORDER_BUFFER_CHANGE_UPDATE:
+		case REORDER_BUFFER_CHANGE_DELETE:
+		case REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT:
+			{
+				ReorderBufferTupleBuf *oldtup,
+						   *newtup;
+
+				oldtup = change->data.tp.oldtuple;
+				newtup = change->data.tp.newtuple;
+
+				if (oldtup)
+					sz += sizeof(HeapTupleData) + oldtup->tuple.t_len;
+
+				if (newtup)
+					sz += sizeof(HeapTupleData) + newtup->tuple.t_len;
+
+				break;
+			}
+		case REORDER_BUFFER_CHANGE_MESSAGE:
+			sz += strlen(change->data.msg.prefix) + 1 +
+				change->data.msg.message_size;
+			break;
+		case REORDER_BUFFER_CHANGE_INTERNAL_SNAPSHOT:
+			{
+				Snapshot	snap = change->data.snapshot;
+
+				sz += sizeof(SnapshotData) +
+					sizeof(TransactionId) * snap->xcnt +
+					sizeof(TransactionId) * snap->subxcnt;
+
+				break;
+			}
+		case REORDER_BUFFER_CHANGE_TRUNCATE:
+			sz += sizeof(Oid) * change->data.truncate.nrelids;
+			break;
+		case REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM:
+		case REORDER_BUFFER_CHANGE_INTERNAL_COMMAND_ID:
+		case REORDER_BUFFER_CHANGE_INTERNAL_TUPLECID:
+			/* no data in addition to the struct itself */
+			break;
+	}
+
+	return sz;
+}
+
+/*
+ * Add or subtract the size of a change to or from the memory counters of its
+ * transaction, the toplevel transaction and the whole reorder buffer.
+ *
+ * Changes that have not been queued into a transaction (and tuplecids, which
+ * are kept separately) are not accounted for.
  */
 static void
-ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
+ReorderBufferChangeMemoryUpdate(ReorderBuffer *rb,
+								ReorderBufferChange *change,
+								bool addition)
 {
-	if (!rb->outbufsize)
+	ReorderBufferTXN *txn;
+	ReorderBufferTXN *toptxn;
+	Size		sz;
+
+	if (change->txn == NULL)
+		return;
+
+	txn = change->txn;
+	toptxn = txn->toptxn ? txn->toptxn : txn;
+
+	sz = ReorderBufferChangeSize(change);
+
+	if (addition)
 	{
-		rb->outbuf = MemoryContextAlloc(rb->context, sz);
-		rb->outbufsize = sz;
+		txn->size += sz;
+		toptxn->total_size += sz;
+		rb->size += sz;
 	}
-	else if (rb->outbufsize < sz)
+	else
 	{
-		rb->outbuf = repalloc(rb->outbuf, sz);
-		rb->outbufsize = sz;
+		Assert(txn->size >= sz);
+		Assert(toptxn->total_size >= sz);
+		Assert(rb->size >= sz);
+
+		txn->size -= sz;
+		toptxn->total_size -= sz;
+		rb->size -= sz;
+	}
+}
+
+/*
+ * Track whether the toplevel transaction of a just queued change can be
+ * streamed after it.
+ *
+ * Toast chunks are always followed by the change to the main table they
+ * belong to, and a speculative insertion by its confirmation (or by another
+ * change, if the insertion failed).  A stream block must not end in between,
+ * as the pieces are only decoded together.
+ */
+static void
+ReorderBufferProcessPartialChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
+								  ReorderBufferChange *change,
+								  bool toast_insert)
+{
+	ReorderBufferTXN *toptxn = txn->toptxn ? txn->toptxn : txn;
+
+	if (toast_insert ||
+		change->action == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_INSERT)
+		toptxn->has_partial_change = true;
+	else if (toptxn->has_partial_change &&
+			 (change->action == REORDER_BUFFER_CHANGE_INSERT ||
+			  change->action == REORDER_BUFFER_CHANGE_UPDATE ||
+			  change->action == REORDER_BUFFER_CHANGE_DELETE ||
+			  change->action == REORDER_BUFFER_CHANGE_INTERNAL_SPEC_CONFIRM) &&
+			 change->data.tp.clear_toast_afterwards)
+		toptxn->has_partial_change = false;
+}
+
+/*
+ * Find the (sub)transaction using the most memory.
+ *
+ * This does a linear search over all transactions, which is fine as it's
+ * only done once the memory limit has been reached, and evicting the
+ * transaction found frees a good chunk of memory.
+ */
+static ReorderBufferTXN *
+ReorderBufferLargestTXN(ReorderBuffer *rb)
+{
+	HASH_SEQ_STATUS hash_seq;
+	ReorderBufferTXNByIdEnt *ent;
+	ReorderBufferTXN *largest = NULL;
+
+	hash_seq_init(&hash_seq, rb->by_txn);
+	while ((ent = hash_seq_search(&hash_seq)) != NULL)
+	{
+		ReorderBufferTXN *txn = ent->txn;
+
+		if (largest == NULL || txn->size > largest->size)
+			largest = txn;
+	}
+
+	Assert(largest != NULL);
+	Assert(largest->size > 0);
+	Assert(largest->size <= rb->size);
+
+	return largest;
+}
+
+/*
+ * Check whether the decoded changes exceed logical_decoding_work_mem, and if
+ * so evict transactions from memory until we're below the limit again.
+ *
+ * The largest streamable transaction is streamed if the output plugin
+ * supports it; otherwise the largest (sub)transaction is spilled to disk.
+ */
+static void
+ReorderBufferCheckMemoryLimit(ReorderBuffer *rb)
+{
+	ReorderBufferTXN *txn;
+
+	while (rb->size >= logical_decoding_work_mem * 1024L)
+	{
+		if (ReorderBufferCanStartStreaming(rb) &&
+			(txn = ReorderBufferLargestStreamableTopTXN(rb)) != NULL)
+		{
+			ReorderBufferStreamTXN(rb, txn);
+
+			/* all changes of the transaction were sent and freed */
+			Assert(txn->total_size == 0);
+		}
+		else
+		{
+			txn = ReorderBufferLargestTXN(rb);
+			ReorderBufferSerializeTXN(rb, txn);
+
+			/* all changes of the transaction were written out */
+			Assert(txn->size == 0);
+			Assert(txn->nentries_mem == 0);
+		}
+	}
+}
+
+
+/*
+ * ---------------------------------------
+ * Streaming of in-progress transactions
+ * ---------------------------------------
+ */
+
+/*
+ * Can we stream transactions right now?
+ *
+ * This requires an output plugin supporting it, and that we're past the
+ * point from which on changes have to be sent; before that (e.g. while
+ * creating a slot or after a restart) transactions are only collected.
+ */
+static bool
+ReorderBufferCanStartStreaming(ReorderBuffer *rb)
+{
+	LogicalDecodingContext *ctx = rb->private_data;
+	SnapBuild  *builder = ctx->snapshot_builder;
+
+	if (!rb->streaming)
+		return false;
+
+	return SnapBuildCurrentState(builder) == SNAPBUILD_CONSISTENT &&
+		!SnapBuildXactNeedsSkip(builder, ctx->reader->EndRecPtr);
+}
+
+/*
+ * Find the toplevel transaction using the most memory, including its
+ * subtransactions, that can be streamed.
+ *
+ * Transactions that modified the catalog are not streamed: their changes can
+ * only be decoded with the invalidations we learn about at commit.  Neither
+ * are transactions whose last change is incomplete, see
+ * ReorderBufferProcessPartialChange().
+ */
+static ReorderBufferTXN *
+ReorderBufferLargestStreamableTopTXN(ReorderBuffer *rb)
+{
+	dlist_iter	iter;
+	ReorderBufferTXN *largest = NULL;
+
+	dlist_foreach(iter, &rb->toplevel_by_lsn)
+	{
+		ReorderBufferTXN *txn = dlist_container(ReorderBufferTXN, node,
+												iter.cur);
+		dlist_iter	subiter;
+		bool		catalog_changes;
+
+		if (txn->total_size == 0 || txn->base_snapshot == NULL ||
+			txn->has_partial_change)
+			continue;
+
+		if (largest != NULL && txn->total_size <= largest->total_size)
+			continue;
+
+		catalog_changes = txn->has_catalog_changes || txn->ntuplecids > 0;
+		dlist_foreach(subiter, &txn->subtxns)
+		{
+			ReorderBufferTXN *subtxn = dlist_container(ReorderBufferTXN, node,
+													   subiter.cur);
+
+			if (subtxn->has_catalog_changes)
+				catalog_changes = true;
+		}
+
+		if (!catalog_changes)
+			largest = txn;
 	}
+
+	return largest;
 }
 
 /*
- * Check whether the transaction tx should spill its data to disk.
+ * Send the changes of a toplevel transaction decoded so far to the output
+ * plugin as a stream block, and free them.
  */
 static void
-ReorderBufferCheckSerializeTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
+ReorderBufferStreamTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
 {
+	Snapshot	snapshot_now;
+	CommandId	command_id;
+
+	Assert(txn->toptxn == NULL);
+	Assert(txn->base_snapshot != NULL);
+
 	/*
-	 * TODO: improve accounting so we cheaply can take subtransactions into
-	 * account here.
+	 * The first block starts out with the base snapshot, later ones with the
+	 * snapshot the previous block ended with.  Either is copied so that it
+	 * covers the subtransactions known by now.
 	 */
-	if (txn->nentries_mem >= max_changes_in_memory)
+	if (txn->snapshot_now == NULL)
+	{
+		command_id = FirstCommandId;
+		snapshot_now = ReorderBufferCopySnap(rb, txn->base_snapshot, txn,
+											 command_id);
+	}
+	else
 	{
-		ReorderBufferSerializeTXN(rb, txn);
-		Assert(txn->nentries_mem == 0);
+		command_id = txn->command_id;
+		snapshot_now = ReorderBufferCopySnap(rb, txn->snapshot_now, txn,
+											 command_id);
+
+		ReorderBufferFreeSnap(rb, txn->snapshot_now);
+		txn->snapshot_now = NULL;
+	}
+
+	ReorderBufferProcessTXN(rb, txn, InvalidXLogRecPtr, snapshot_now,
+							command_id, true);
+}
+
+/*
+ * Discard the changes of a transaction and its subtransactions after they
+ * have been streamed, including those spilled to disk.  The transactions
+ * themselves are kept, further changes may follow.
+ */
+static void
+ReorderBufferTruncateTXN(ReorderBuffer *rb, ReorderBufferTXN *txn)
+{
+	dlist_mutable_iter iter;
+
+	dlist_foreach_modify(iter, &txn->subtxns)
+	{
+		ReorderBufferTXN *subtxn;
+
+		subtxn = dlist_container(ReorderBufferTXN, node, iter.cur);
+		ReorderBufferTruncateTXN(rb, subtxn);
+	}
+
+	dlist_foreach_modify(iter, &txn->changes)
+	{
+		ReorderBufferChange *change;
+
+		change = dlist_container(ReorderBufferChange, node, iter.cur);
+		dlist_delete(&change->node);
+		ReorderBufferReturnChange(rb, change);
+	}
+
+	/* toast chunks of the streamed changes aren't needed anymore either */
+	ReorderBufferToastReset(rb, txn);
+
+	if (txn->serialized)
+	{
+		ReorderBufferRestoreCleanup(rb, txn);
+		txn->serialized = false;
+	}
+
+	txn->nentries = 0;
+	txn->nentries_mem = 0;
+}
+
+
+/*
+ * ---------------------------------------
+ * Disk serialization support
+ * ---------------------------------------
+ */
+
+/*
+ * Ensure the IO buffer is >= sz.
+ */
+static void
+ReorderBufferSerializeReserve(ReorderBuffer *rb, Size sz)
+{
+	if (!rb->outbufsize)
+	{
+		rb->outbuf = MemoryContextAlloc(rb->context, sz);
+		rb->outbufsize = sz;
+	}
+	else if (rb->outbufsize < sz)
+	{
+		rb->outbuf = repalloc(rb->outbuf, sz);
+		rb->outbufsize = sz;
 	}
 }
 
@@ -2804,6 +3330,13 @@ ReorderBufferRestoreChange(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	dlist_push_tail(&txn->changes, &change->node);
 	txn->nentries_mem++;
+
+	/*
+	 * Account for the restored change, it's subtracted again when returned.
+	 * The memory limit is only enforced when queueing new changes though.
+	 */
+	change->txn = txn;
+	ReorderBufferChangeMemoryUpdate(rb, change, true);
 }
 
 /*
@@ -3064,6 +3597,9 @@ ReorderBufferToastReplace(ReorderBuffer *rb, ReorderBufferTXN *txn,
 
 	newtup = change->data.tp.newtuple;
 
+	/* the tuple is replaced below, account for its new size */
+	ReorderBufferChangeMemoryUpdate(rb, change, false);
+
 	heap_deform_tuple(&newtup->tuple, desc, attrs, isnull);
 
 	for (natt = 0; natt < desc->natts; natt++)
@@ -3176,6 +3712,8 @@ ReorderBufferToastReplace(ReorderBuffer *rb, ReorderBufferTXN *txn,
 	memcpy(newtup->tuple.t_data, tmphtup->t_data, tmphtup->t_len);
 	newtup->tuple.t_len = tmphtup->t_len;
 
+	ReorderBufferChangeMemoryUpdate(rb, change, true);
+
 	/*
 	 * free resources we won't further need, more persistent stuff will be
 	 * free'd in ReorderBufferToastReset().
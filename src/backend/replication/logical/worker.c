@@ -18,6 +18,19 @@
  *	  This module includes server facing code and shares libpqwalreceiver
  *	  module with walreceiver for providing the libpq specific functionality.
  *
+ *
+ * STREAMED TRANSACTIONS
+ * ---------------------
+ *	  Large in-progress transactions may be streamed by the publisher in
+ *	  several chunks, enclosed by STREAM START and STREAM STOP messages, each
+ *	  change carrying the XID of the (sub)transaction it belongs to.  We
+ *	  can't apply those changes right away, because the transaction may still
+ *	  abort, so the changes are spooled to a temporary file per toplevel
+ *	  transaction.  On STREAM COMMIT the file is replayed and the changes are
+ *	  applied in a single local transaction, skipping those of
+ *	  subtransactions a STREAM ABORT was received for.  On STREAM ABORT of the
+ *	  toplevel transaction the file is simply discarded.
+ *
  *-------------------------------------------------------------------------
  */
 
@@ -57,6 +70,7 @@
 #include "replication/walreceiver.h"
 #include "replication/worker_internal.h"
 #include "rewrite/rewriteHandler.h"
+#include "storage/buffile.h"
 #include "storage/bufmgr.h"
 #include "storage/ipc.h"
 #include "storage/lmgr.h"
@@ -93,7 +107,7 @@ typedef struct SlotErrCallbackArg
 	int			remote_attnum;
 } SlotErrCallbackArg;
 
-static MemoryContext ApplyMessageContext = NULL;
+MemoryContext ApplyMessageContext = NULL;
 MemoryContext ApplyContext = NULL;
 
 WalReceiverConn *wrconn = NULL;
@@ -104,9 +118,51 @@ bool		MySubscriptionValid = false;
 bool		in_remote_transaction = false;
 static XLogRecPtr remote_final_lsn = InvalidXLogRecPtr;
 
-static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
+/* fields valid only when processing streamed transaction */
+static bool in_streamed_transaction = false;
+static TransactionId stream_xid = InvalidTransactionId;
+
+/*
+ * Spool file of a streamed toplevel transaction, along with the XIDs of its
+ * subtransactions the publisher told us were aborted.
+ */
+typedef struct StreamXidEntry
+{
+	TransactionId xid;			/* hash key - must be first */
+	BufFile    *file;			/* spooled changes */
+	List	   *aborted_subxids;	/* subtransactions to skip on commit */
+} StreamXidEntry;
+
+static HTAB *StreamXidHash = NULL;
+
+/*
+ * Consecutive INSERTs into the same relation are buffered and written with a
+ * single multi-insert, like COPY does.  The buffer is flushed when the limits
+ * below are reached, and before any other change or the commit is applied.
+ */
+#define MAX_BUFFERED_INSERTS		1000
+#define MAX_BUFFERED_INSERT_BYTES	65535
+
+typedef struct ApplyInsertBuffer
+{
+	LogicalRepRelMapEntry *rel; /* relation being inserted into, or NULL */
+	EState	   *estate;			/* executor state, lives until the flush */
+	TupleTableSlot *remoteslot; /* remote tuple is converted in here */
+	TupleTableSlot *slots[MAX_BUFFERED_INSERTS];	/* buffered tuples */
+	int			nused;			/* number of buffered tuples */
+	Size		nbytes;			/* size of the buffered changes */
+} ApplyInsertBuffer;
+
+static ApplyInsertBuffer insert_buffer;
+
+static StreamXidEntry *stream_get_entry(TransactionId xid, bool create);
+static void stream_cleanup_entry(TransactionId xid);
+static void stream_write_change(char action, StringInfo s);
+static bool handle_streamed_transaction(char action, StringInfo s);
+static void apply_handle_commit_internal(LogicalRepCommitData *commit_data);
+static void apply_flush_inserts(void);
 
-static void store_flush_position(XLogRecPtr remote_lsn);
+static void send_feedback(XLogRecPtr recvpos, bool force, bool requestReply);
 
 static void maybe_reread_subscription(void);
 
@@ -460,6 +516,16 @@ apply_handle_begin(StringInfo s)
 
 	in_remote_transaction = true;
 
+	/*
+	 * A parallel apply worker assigns the transaction id right away, so that
+	 * the workers applying later transactions can wait for it to finish.
+	 */
+	if (am_parallel_apply_worker())
+	{
+		ensure_transaction();
+		pa_start_transaction(GetTopTransactionId());
+	}
+
 	pgstat_report_activity(STATE_RUNNING, NULL);
 }
 
@@ -477,6 +543,42 @@ apply_handle_commit(StringInfo s)
 
 	Assert(commit_data.commit_lsn == remote_final_lsn);
 
+	apply_handle_commit_internal(&commit_data);
+}
+
+/*
+ * Common part of COMMIT and STREAM COMMIT handling, once all the changes of
+ * the remote transaction were applied.
+ */
+static void
+apply_handle_commit_internal(LogicalRepCommitData *commit_data)
+{
+	apply_flush_inserts();
+
+	/*
+	 * A parallel apply worker commits in the order the transactions were
+	 * committed remotely, and leaves the flush position tracking to the apply
+	 * worker.
+	 */
+	if (am_parallel_apply_worker())
+	{
+		Assert(IsTransactionState());
+
+		pa_wait_for_preceding();
+
+		replorigin_session_origin_lsn = commit_data->end_lsn;
+		replorigin_session_origin_timestamp = commit_data->committime;
+
+		CommitTransactionCommand();
+		pgstat_report_stat(false);
+
+		pa_finish_transaction(commit_data->end_lsn, XactLastCommitEnd);
+
+		in_remote_transaction = false;
+		pgstat_report_activity(STATE_IDLE, NULL);
+		return;
+	}
+
 	/* The synchronization worker runs in single transaction. */
 	if (IsTransactionState() && !am_tablesync_worker())
 	{
@@ -484,13 +586,13 @@ apply_handle_commit(StringInfo s)
 		 * Update origin state so we can restart streaming from correct
 		 * position in case of crash.
 		 */
-		replorigin_session_origin_lsn = commit_data.end_lsn;
-		replorigin_session_origin_timestamp = commit_data.committime;
+		replorigin_session_origin_lsn = commit_data->end_lsn;
+		replorigin_session_origin_timestamp = commit_data->committime;
 
 		CommitTransactionCommand();
 		pgstat_report_stat(false);
 
-		store_flush_position(commit_data.end_lsn);
+		store_flush_position(commit_data->end_lsn, XactLastCommitEnd);
 	}
 	else
 	{
@@ -502,7 +604,7 @@ apply_handle_commit(StringInfo s)
 	in_remote_transaction = false;
 
 	/* Process any tables that are being synchronized in parallel. */
-	process_syncing_tables(commit_data.end_lsn);
+	process_syncing_tables(commit_data->end_lsn);
 
 	pgstat_report_activity(STATE_IDLE, NULL);
 }
@@ -516,16 +618,222 @@ static void
 apply_handle_origin(StringInfo s)
 {
 	/*
-	 * ORIGIN message can only come inside remote transaction and before any
-	 * actual writes.
+	 * ORIGIN message can only come inside remote transaction or streaming
+	 * block, and before any actual writes.
 	 */
-	if (!in_remote_transaction ||
-		(IsTransactionState() && !am_tablesync_worker()))
+	if (!in_streamed_transaction &&
+		(!in_remote_transaction ||
+		 (IsTransactionState() && !am_tablesync_worker() &&
+		  !am_parallel_apply_worker())))
 		ereport(ERROR,
 				(errcode(ERRCODE_PROTOCOL_VIOLATION),
 				 errmsg("ORIGIN message sent out of order")));
 }
 
+/*
+ * Handle STREAM START message.
+ */
+static void
+apply_handle_stream_start(StringInfo s)
+{
+	bool		first_segment;
+
+	if (in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("duplicate STREAM START message")));
+
+	/* notify handle methods we're processing a remote transaction */
+	in_streamed_transaction = true;
+
+	/* extract XID of the top-level transaction */
+	stream_xid = logicalrep_read_stream_start(s, &first_segment);
+
+	/*
+	 * Start spooling the transaction on its first segment.  Spooled changes
+	 * of an earlier attempt to stream it (interrupted by a reconnect) are
+	 * thrown away, the publisher sends them again.
+	 */
+	if (first_segment)
+		stream_cleanup_entry(stream_xid);
+
+	(void) stream_get_entry(stream_xid, true);
+
+	pgstat_report_activity(STATE_RUNNING, NULL);
+}
+
+/*
+ * Handle STREAM STOP message.
+ */
+static void
+apply_handle_stream_stop(StringInfo s)
+{
+	if (!in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM STOP message without STREAM START")));
+
+	in_streamed_transaction = false;
+	stream_xid = InvalidTransactionId;
+
+	pgstat_report_activity(STATE_IDLE, NULL);
+}
+
+/*
+ * Handle STREAM ABORT message.
+ *
+ * For the toplevel transaction the spooled changes are discarded; for a
+ * subtransaction we only remember to skip its changes on commit.
+ */
+static void
+apply_handle_stream_abort(StringInfo s)
+{
+	TransactionId xid;
+	TransactionId subxid;
+	StreamXidEntry *entry;
+
+	if (in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM ABORT message without STREAM STOP")));
+
+	logicalrep_read_stream_abort(s, &xid, &subxid);
+
+	if (xid == subxid)
+	{
+		stream_cleanup_entry(xid);
+		return;
+	}
+
+	/* nothing to do if we never saw the transaction */
+	entry = stream_get_entry(xid, false);
+	if (entry == NULL)
+		return;
+
+	{
+		MemoryContext oldctx = MemoryContextSwitchTo(ApplyContext);
+
+		entry->aborted_subxids = lappend_int(entry->aborted_subxids,
+											 (int) subxid);
+		MemoryContextSwitchTo(oldctx);
+	}
+}
+
+/*
+ * Handle STREAM COMMIT message.
+ *
+ * Replays the changes spooled for the transaction and commits them.
+ */
+static void
+apply_handle_stream_commit(StringInfo s)
+{
+	TransactionId xid;
+	LogicalRepCommitData commit_data;
+	StreamXidEntry *entry;
+	StringInfoData s2;
+	MemoryContext oldctx;
+	MemoryContext replayctx;
+	int			nchanges = 0;
+
+	if (in_streamed_transaction)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM COMMIT message without STREAM STOP")));
+
+	xid = logicalrep_read_stream_commit(s, &commit_data);
+
+	entry = stream_get_entry(xid, false);
+	if (entry == NULL)
+		ereport(ERROR,
+				(errcode(ERRCODE_PROTOCOL_VIOLATION),
+				 errmsg("STREAM COMMIT message for unknown transaction %u",
+						xid)));
+
+	/*
+	 * Streamed transactions are applied by this worker, after the ones handed
+	 * to parallel apply workers so far committed.
+	 */
+	pa_wait_all();
+
+	remote_final_lsn = commit_data.commit_lsn;
+	in_remote_transaction = true;
+
+	pgstat_report_activity(STATE_RUNNING, NULL);
+
+	/*
+	 * Changes are applied in a context reset after each of them, so that
+	 * replaying a large transaction doesn't accumulate memory.
+	 */
+	replayctx = AllocSetContextCreate(ApplyContext,
+									  "ApplyStreamReplayContext",
+									  ALLOCSET_DEFAULT_SIZES);
+
+	oldctx = MemoryContextSwitchTo(ApplyContext);
+	initStringInfo(&s2);
+	MemoryContextSwitchTo(oldctx);
+
+	if (BufFileSeek(entry->file, 0, 0, SEEK_SET) != 0)
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not rewind streaming transaction's changes file: %m")));
+
+	for (;;)
+	{
+		int			len;
+		TransactionId subxid;
+		size_t		nbytes;
+
+		CHECK_FOR_INTERRUPTS();
+
+		/* read length of the change (including the action), or EOF */
+		nbytes = BufFileRead(entry->file, &len, sizeof(len));
+		if (nbytes == 0)
+			break;
+
+		if (nbytes != sizeof(len) ||
+			BufFileRead(entry->file, &subxid, sizeof(subxid)) != sizeof(subxid))
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from streaming transaction's changes file: %m")));
+
+		Assert(len > 0);
+
+		resetStringInfo(&s2);
+		enlargeStringInfo(&s2, len);
+
+		if (BufFileRead(entry->file, s2.data, len) != len)
+			ereport(ERROR,
+					(errcode_for_file_access(),
+					 errmsg("could not read from streaming transaction's changes file: %m")));
+
+		/* skip changes of aborted subtransactions */
+		if (list_member_int(entry->aborted_subxids, (int) subxid))
+			continue;
+
+		s2.len = len;
+		s2.cursor = 0;
+		s2.data[len] = '\0';
+
+		oldctx = MemoryContextSwitchTo(replayctx);
+		apply_dispatch(&s2);
+		MemoryContextSwitchTo(oldctx);
+
+		MemoryContextReset(replayctx);
+
+		nchanges++;
+	}
+
+	elog(DEBUG1, "replayed %d (all) changes from file of streamed transaction %u",
+		 nchanges, xid);
+
+	pfree(s2.data);
+	MemoryContextDelete(replayctx);
+
+	stream_cleanup_entry(xid);
+
+	apply_handle_commit_internal(&commit_data);
+}
+
 /*
  * Handle RELATION message.
  *
@@ -578,6 +886,9 @@ GetRelationIdentityOrPK(Relation rel)
 
 /*
  * Handle INSERT message.
+ *
+ * Unless the local relation has triggers, the tuple is only added to the
+ * insert buffer here, see apply_flush_inserts().
  */
 static void
 apply_handle_insert(StringInfo s)
@@ -588,26 +899,63 @@ apply_handle_insert(StringInfo s)
 	EState	   *estate;
 	TupleTableSlot *remoteslot;
 	MemoryContext oldctx;
+	int			msglen = s->len - s->cursor;
 
 	ensure_transaction();
 
 	relid = logicalrep_read_insert(s, &newtup);
-	rel = logicalrep_rel_open(relid, RowExclusiveLock);
-	if (!should_apply_changes_for_rel(rel))
+
+	if (insert_buffer.rel != NULL &&
+		insert_buffer.rel->remoterel.remoteid == relid)
+	{
+		rel = insert_buffer.rel;
+		estate = insert_buffer.estate;
+		remoteslot = insert_buffer.remoteslot;
+	}
+	else
 	{
+		apply_flush_inserts();
+
+		rel = logicalrep_rel_open(relid, RowExclusiveLock);
+		if (!should_apply_changes_for_rel(rel))
+		{
+			/*
+			 * The relation can't become interesting in the middle of the
+			 * transaction so it's safe to unlock it.
+			 */
+			logicalrep_rel_close(rel, RowExclusiveLock);
+			return;
+		}
+
 		/*
-		 * The relation can't become interesting in the middle of the
-		 * transaction so it's safe to unlock it.
+		 * Initialize the executor state.  When buffering, it has to survive
+		 * until the flush, which happens at the latest before the commit.
 		 */
-		logicalrep_rel_close(rel, RowExclusiveLock);
-		return;
-	}
+		if (rel->localrel->trigdesc == NULL)
+			oldctx = MemoryContextSwitchTo(TopTransactionContext);
+		else
+			oldctx = CurrentMemoryContext;
 
-	/* Initialize the executor state. */
-	estate = create_estate_for_relation(rel);
-	remoteslot = ExecInitExtraTupleSlot(estate,
-										RelationGetDescr(rel->localrel),
-										&TTSOpsVirtual);
+		estate = create_estate_for_relation(rel);
+		remoteslot = ExecInitExtraTupleSlot(estate,
+											RelationGetDescr(rel->localrel),
+											&TTSOpsVirtual);
+		MemoryContextSwitchTo(oldctx);
+
+		if (rel->localrel->trigdesc == NULL)
+		{
+			/* Index predicates may call functions needing a snapshot */
+			PushActiveSnapshot(GetTransactionSnapshot());
+			oldctx = MemoryContextSwitchTo(estate->es_query_cxt);
+			ExecOpenIndices(estate->es_result_relation_info, false);
+			MemoryContextSwitchTo(oldctx);
+			PopActiveSnapshot();
+
+			insert_buffer.rel = rel;
+			insert_buffer.estate = estate;
+			insert_buffer.remoteslot = remoteslot;
+		}
+	}
 
 	/* Input functions may need an active snapshot, so get one */
 	PushActiveSnapshot(GetTransactionSnapshot());
@@ -618,6 +966,35 @@ apply_handle_insert(StringInfo s)
 	slot_fill_defaults(rel, estate, remoteslot);
 	MemoryContextSwitchTo(oldctx);
 
+	if (insert_buffer.rel == rel)
+	{
+		TupleTableSlot *slot;
+
+		PopActiveSnapshot();
+
+		/* Copy the tuple into the buffer, reusing the slots of the batch. */
+		if (insert_buffer.slots[insert_buffer.nused] == NULL)
+		{
+			oldctx = MemoryContextSwitchTo(estate->es_query_cxt);
+			insert_buffer.slots[insert_buffer.nused] =
+				table_slot_create(rel->localrel, &estate->es_tupleTable);
+			MemoryContextSwitchTo(oldctx);
+		}
+		slot = insert_buffer.slots[insert_buffer.nused];
+		ExecCopySlot(slot, remoteslot);
+
+		insert_buffer.nused++;
+		insert_buffer.nbytes += msglen;
+
+		ResetPerTupleExprContext(estate);
+
+		if (insert_buffer.nused >= MAX_BUFFERED_INSERTS ||
+			insert_buffer.nbytes >= MAX_BUFFERED_INSERT_BYTES)
+			apply_flush_inserts();
+
+		return;
+	}
+
 	ExecOpenIndices(estate->es_result_relation_info, false);
 
 	/* Do the insert. */
@@ -638,6 +1015,46 @@ apply_handle_insert(StringInfo s)
 	CommandCounterIncrement();
 }
 
+/*
+ * Write out the buffered INSERTs, if any, and release the buffer.
+ */
+static void
+apply_flush_inserts(void)
+{
+	EState	   *estate = insert_buffer.estate;
+	MemoryContext oldctx;
+
+	if (insert_buffer.rel == NULL)
+		return;
+
+	if (insert_buffer.nused > 0)
+	{
+		PushActiveSnapshot(GetTransactionSnapshot());
+
+		oldctx = MemoryContextSwitchTo(GetPerTupleMemoryContext(estate));
+		ExecSimpleRelationMultiInsert(estate, insert_buffer.slots,
+									  insert_buffer.nused);
+		MemoryContextSwitchTo(oldctx);
+
+		PopActiveSnapshot();
+	}
+
+	/* Cleanup. */
+	ExecCloseIndices(estate->es_result_relation_info);
+
+	/* Handle queued AFTER triggers. */
+	AfterTriggerEndQuery(estate);
+
+	ExecResetTupleTable(estate->es_tupleTable, false);
+	FreeExecutorState(estate);
+
+	logicalrep_rel_close(insert_buffer.rel, NoLock);
+
+	memset(&insert_buffer, 0, sizeof(insert_buffer));
+
+	CommandCounterIncrement();
+}
+
 /*
  * Check if the logical replication relation is updatable and throw
  * appropriate error if it isn't.
@@ -985,11 +1402,25 @@ apply_handle_truncate(StringInfo s)
 /*
  * Logical replication protocol message dispatcher.
  */
-static void
+void
 apply_dispatch(StringInfo s)
 {
+	int			msgstart = s->cursor;
 	char		action = pq_getmsgbyte(s);
 
+	/* changes of a streamed transaction are spooled, not applied */
+	if (handle_streamed_transaction(action, s))
+		return;
+
+	/* the apply worker may hand the transaction to a parallel apply worker */
+	if (!am_tablesync_worker() && !am_parallel_apply_worker() &&
+		pa_handle_message(action, s, msgstart))
+		return;
+
+	/* any change other than another INSERT ends the current insert batch */
+	if (action != 'I')
+		apply_flush_inserts();
+
 	switch (action)
 	{
 			/* BEGIN */
@@ -1028,6 +1459,22 @@ apply_dispatch(StringInfo s)
 		case 'O':
 			apply_handle_origin(s);
 			break;
+			/* STREAM START */
+		case 'S':
+			apply_handle_stream_start(s);
+			break;
+			/* STREAM END */
+		case 'E':
+			apply_handle_stream_stop(s);
+			break;
+			/* STREAM ABORT */
+		case 'A':
+			apply_handle_stream_abort(s);
+			break;
+			/* STREAM COMMIT */
+		case 'c':
+			apply_handle_stream_commit(s);
+			break;
 		default:
 			ereport(ERROR,
 					(errcode(ERRCODE_PROTOCOL_VIOLATION),
@@ -1035,6 +1482,129 @@ apply_dispatch(StringInfo s)
 	}
 }
 
+/*
+ * Find the spool file entry of a streamed toplevel transaction, optionally
+ * creating it (along with the hash table itself).
+ */
+static StreamXidEntry *
+stream_get_entry(TransactionId xid, bool create)
+{
+	StreamXidEntry *entry;
+	bool		found;
+
+	if (StreamXidHash == NULL)
+	{
+		HASHCTL		ctl;
+
+		if (!create)
+			return NULL;
+
+		MemSet(&ctl, 0, sizeof(ctl));
+		ctl.keysize = sizeof(TransactionId);
+		ctl.entrysize = sizeof(StreamXidEntry);
+		ctl.hcxt = ApplyContext;
+		StreamXidHash = hash_create("logical replication streamed transactions",
+									16, &ctl,
+									HASH_ELEM | HASH_BLOBS | HASH_CONTEXT);
+	}
+
+	entry = (StreamXidEntry *) hash_search(StreamXidHash, &xid,
+										   create ? HASH_ENTER : HASH_FIND,
+										   &found);
+
+	if (create && !found)
+	{
+		MemoryContext oldctx = MemoryContextSwitchTo(ApplyContext);
+
+		/* the file has to survive the local transactions */
+		entry->file = BufFileCreateTemp(true);
+		entry->aborted_subxids = NIL;
+
+		MemoryContextSwitchTo(oldctx);
+	}
+
+	return entry;
+}
+
+/*
+ * Discard the spool file of a streamed toplevel transaction, if any.
+ */
+static void
+stream_cleanup_entry(TransactionId xid)
+{
+	StreamXidEntry *entry = stream_get_entry(xid, false);
+
+	if (entry == NULL)
+		return;
+
+	BufFileClose(entry->file);
+	list_free(entry->aborted_subxids);
+
+	hash_search(StreamXidHash, &xid, HASH_REMOVE, NULL);
+}
+
+/*
+ * Spool a change of the current streamed transaction to its file.
+ *
+ * Each change is stored as its length (including the action), the XID of
+ * the subtransaction it belongs to, the action and the rest of the message
+ * in the format handled by apply_dispatch.
+ */
+static void
+stream_write_change(char action, StringInfo s)
+{
+	StreamXidEntry *entry;
+	TransactionId subxid;
+	int			len;
+
+	Assert(in_streamed_transaction);
+
+	entry = stream_get_entry(stream_xid, false);
+	Assert(entry != NULL);
+
+	/* XID of the (sub)transaction the change belongs to */
+	subxid = pq_getmsgint(s, 4);
+
+	/* total on-disk size, including the action type character */
+	len = (s->len - s->cursor) + sizeof(char);
+
+	if (BufFileWrite(entry->file, &len, sizeof(len)) != sizeof(len) ||
+		BufFileWrite(entry->file, &subxid, sizeof(subxid)) != sizeof(subxid) ||
+		BufFileWrite(entry->file, &action, sizeof(action)) != sizeof(action) ||
+		BufFileWrite(entry->file, &s->data[s->cursor], len - sizeof(char)) !=
+		len - sizeof(char))
+		ereport(ERROR,
+				(errcode_for_file_access(),
+				 errmsg("could not write to streaming transaction's changes file: %m")));
+}
+
+/*
+ * Handle a change message when inside a streaming block.
+ *
+ * Returns true if the change was spooled to the transaction's file, false
+ * if it has to be handled by apply_dispatch right away.
+ */
+static bool
+handle_streamed_transaction(char action, StringInfo s)
+{
+	if (!in_streamed_transaction)
+		return false;
+
+	switch (action)
+	{
+		case 'I':
+		case 'U':
+		case 'D':
+		case 'T':
+		case 'R':
+		case 'Y':
+			stream_write_change(action, s);
+			return true;
+		default:
+			return false;
+	}
+}
+
 /*
  * Figure out which write/flush positions to report to the walsender process.
  *
@@ -1090,23 +1660,28 @@ get_flush_position(XLogRecPtr *write, XLogRecPtr *flush,
 }
 
 /*
- * Store current remote/local lsn pair in the tracking list.
+ * Store a remote/local lsn pair of a commit in the tracking list.
+ *
+ * local_lsn is the end of the local commit record, which is normally
+ * XactLastCommitEnd, but comes from a parallel apply worker for transactions
+ * applied by one.
  */
-static void
-store_flush_position(XLogRecPtr remote_lsn)
+void
+store_flush_position(XLogRecPtr remote_lsn, XLogRecPtr local_lsn)
 {
 	FlushPosition *flushpos;
+	MemoryContext oldctx;
 
 	/* Need to do this in permanent context */
-	MemoryContextSwitchTo(ApplyContext);
+	oldctx = MemoryContextSwitchTo(ApplyContext);
 
 	/* Track commit lsn  */
 	flushpos = (FlushPosition *) palloc(sizeof(FlushPosition));
-	flushpos->local_end = XactLastCommitEnd;
+	flushpos->local_end = local_lsn;
 	flushpos->remote_end = remote_lsn;
 
 	dlist_push_tail(&lsn_mapping, &flushpos->node);
-	MemoryContextSwitchTo(ApplyMessageContext);
+	MemoryContextSwitchTo(oldctx);
 }
 
 
@@ -1242,6 +1817,9 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 			}
 		}
 
+		/* collect the commits of parallel apply workers */
+		pa_process_finished();
+
 		/* confirm all writes so far */
 		send_feedback(last_received, false, false);
 
@@ -1279,7 +1857,7 @@ LogicalRepApplyLoop(XLogRecPtr last_received)
 		 * no particular urgency about waking up unless we get data or a
 		 * signal.
 		 */
-		if (!dlist_is_empty(&lsn_mapping))
+		if (!dlist_is_empty(&lsn_mapping) || pa_has_busy_workers())
 			wait_time = WalWriterDelay;
 		else
 			wait_time = NAPTIME_PER_CYCLE;
@@ -1540,6 +2118,20 @@ maybe_reread_subscription(void)
 		proc_exit(0);
 	}
 
+	/*
+	 * Exit if streaming was enabled or disabled, as that's requested when
+	 * starting the replication.  The launcher will start new worker.
+	 */
+	if (newsub->stream != MySubscription->stream)
+	{
+		ereport(LOG,
+				(errmsg("logical replication apply worker for subscription \"%s\" will "
+						"restart because subscription's streaming option was changed",
+						MySubscription->name)));
+
+		proc_exit(0);
+	}
+
 	/*
 	 * Exit if publication list was changed. The launcher will start new
 	 * worker.
@@ -1600,51 +2192,15 @@ logicalrep_worker_sighup(SIGNAL_ARGS)
 	errno = save_errno;
 }
 
-/* Logical Replication Apply worker entry point */
+/*
+ * Common initialization of the apply, table synchronization and parallel
+ * apply workers, once connected to the database: load the subscription and
+ * set up the memory contexts and caches based on it.
+ */
 void
-ApplyWorkerMain(Datum main_arg)
+InitializeApplyWorker(void)
 {
-	int			worker_slot = DatumGetInt32(main_arg);
 	MemoryContext oldctx;
-	char		originname[NAMEDATALEN];
-	XLogRecPtr	origin_startpos;
-	char	   *myslotname;
-	WalRcvStreamOptions options;
-
-	/* Attach to slot */
-	logicalrep_worker_attach(worker_slot);
-
-	/* Setup signal handling */
-	pqsignal(SIGHUP, logicalrep_worker_sighup);
-	pqsignal(SIGTERM, die);
-	BackgroundWorkerUnblockSignals();
-
-	/*
-	 * We don't currently need any ResourceOwner in a walreceiver process, but
-	 * if we did, we could call CreateAuxProcessResourceOwner here.
-	 */
-
-	/* Initialise stats to a sanish value */
-	MyLogicalRepWorker->last_send_time = MyLogicalRepWorker->last_recv_time =
-		MyLogicalRepWorker->reply_time = GetCurrentTimestamp();
-
-	/* Load the libpq-specific functions */
-	load_file("libpqwalreceiver", false);
-
-	/* Run as replica session replication role. */
-	SetConfigOption("session_replication_role", "replica",
-					PGC_SUSET, PGC_S_OVERRIDE);
-
-	/* Connect to our database. */
-	BackgroundWorkerInitializeConnectionByOid(MyLogicalRepWorker->dbid,
-											  MyLogicalRepWorker->userid,
-											  0);
-
-	/*
-	 * Set always-secure search path, so malicious users can't redirect user
-	 * code (e.g. pg_index.indexprs).
-	 */
-	SetConfigOption("search_path", "", PGC_SUSET, PGC_S_OVERRIDE);
 
 	/* Load the subscription into persistent memory context. */
 	ApplyContext = AllocSetContextCreate(TopMemoryContext,
@@ -1689,12 +2245,65 @@ ApplyWorkerMain(Datum main_arg)
 		ereport(LOG,
 				(errmsg("logical replication table synchronization worker for subscription \"%s\", table \"%s\" has started",
 						MySubscription->name, get_rel_name(MyLogicalRepWorker->relid))));
+	else if (am_parallel_apply_worker())
+		ereport(LOG,
+				(errmsg("logical replication parallel apply worker for subscription \"%s\" has started",
+						MySubscription->name)));
 	else
 		ereport(LOG,
 				(errmsg("logical replication apply worker for subscription \"%s\" has started",
 						MySubscription->name)));
 
 	CommitTransactionCommand();
+}
+
+/* Logical Replication Apply worker entry point */
+void
+ApplyWorkerMain(Datum main_arg)
+{
+	int			worker_slot = DatumGetInt32(main_arg);
+	MemoryContext oldctx;
+	char		originname[NAMEDATALEN];
+	XLogRecPtr	origin_startpos;
+	char	   *myslotname;
+	WalRcvStreamOptions options;
+
+	/* Attach to slot */
+	logicalrep_worker_attach(worker_slot);
+
+	/* Setup signal handling */
+	pqsignal(SIGHUP, logicalrep_worker_sighup);
+	pqsignal(SIGTERM, die);
+	BackgroundWorkerUnblockSignals();
+
+	/*
+	 * We don't currently need any ResourceOwner in a walreceiver process, but
+	 * if we did, we could call CreateAuxProcessResourceOwner here.
+	 */
+
+	/* Initialise stats to a sanish value */
+	MyLogicalRepWorker->last_send_time = MyLogicalRepWorker->last_recv_time =
+		MyLogicalRepWorker->reply_time = GetCurrentTimestamp();
+
+	/* Load the libpq-specific functions */
+	load_file("libpqwalreceiver", false);
+
+	/* Run as replica session replication role. */
+	SetConfigOption("session_replication_role", "replica",
+					PGC_SUSET, PGC_S_OVERRIDE);
+
+	/* Connect to our database. */
+	BackgroundWorkerInitializeConnectionByOid(MyLogicalRepWorker->dbid,
+											  MyLogicalRepWorker->userid,
+											  0);
+
+	/*
+	 * Set always-secure search path, so malicious users can't redirect user
+	 * code (e.g. pg_index.indexprs).
+	 */
+	SetConfigOption("search_path", "", PGC_SUSET, PGC_S_OVERRIDE);
+
+	InitializeApplyWorker();
 
 	/* Connect to the origin and start the replication. */
 	elog(DEBUG1, "connecting to publisher using connection string \"%s\"",
@@ -1738,7 +2347,7 @@ ApplyWorkerMain(Datum main_arg)
 		originid = replorigin_by_name(originname, true);
 		if (!OidIsValid(originid))
 			originid = replorigin_create(originname);
-		replorigin_session_setup(originid);
+		replorigin_session_setup(originid, 0);
 		replorigin_session_origin = originid;
 		origin_startpos = replorigin_session_get_progress(false);
 		CommitTransactionCommand();
@@ -1769,8 +2378,18 @@ ApplyWorkerMain(Datum main_arg)
 	options.logical = true;
 	options.startpoint = origin_startpos;
 	options.slotname = myslotname;
-	options.proto.logical.proto_version = LOGICALREP_PROTO_VERSION_NUM;
 	options.proto.logical.publication_names = MySubscription->publications;
+	options.proto.logical.streaming = MySubscription->stream;
+
+	/*
+	 * Only request the streaming-capable protocol version when streaming was
+	 * enabled for the subscription, so that subscriptions not using it keep
+	 * working against publishers that only know protocol version 1.
+	 */
+	if (MySubscription->stream)
+		options.proto.logical.proto_version = LOGICALREP_PROTO_STREAM_VERSION_NUM;
+	else
+		options.proto.logical.proto_version = LOGICALREP_PROTO_MIN_VERSION_NUM;
 
 	/* Start normal logical streaming replication. */
 	walrcv_startstreaming(wrconn, &options);
@@ -18,12 +18,15 @@
 
 #include "access/genam.h"
 #include "access/htup_details.h"
+#include "access/sysattr.h"
 #include "access/table.h"
 #include "access/tuptoaster.h"
 #include "catalog/indexing.h"
 #include "catalog/pg_collation.h"
 #include "catalog/pg_statistic_ext.h"
 #include "catalog/pg_statistic_ext_data.h"
+#include "catalog/pg_type.h"
+#include "executor/executor.h"
 #include "miscadmin.h"
 #include "nodes/nodeFuncs.h"
 #include "optimizer/clauses.h"
@@ -60,6 +63,7 @@ typedef struct StatExtEntry
 	char	   *schema;			/* statistics object's schema */
 	char	   *name;			/* statistics object's name */
 	Bitmapset  *columns;		/* attribute numbers covered by the object */
+	List	   *exprs;			/* expressions covered by the object */
 	List	   *types;			/* 'char' list of enabled statistic kinds */
 } StatExtEntry;
 
@@ -67,9 +71,13 @@ typedef struct StatExtEntry
 static List *fetch_statentries_for_relation(Relation pg_statext, Oid relid);
 static VacAttrStats **lookup_var_attr_stats(Relation rel, Bitmapset *attrs,
 											int nvacatts, VacAttrStats **vacatts);
+static Bitmapset *build_expression_sample(Relation onerel, StatExtEntry *stat,
+										  int numrows, HeapTuple **rows,
+										  VacAttrStats ***stats);
 static void statext_store(Oid relid,
 						  MVNDistinct *ndistinct, MVDependencies *dependencies,
-						  MCVList *mcv, VacAttrStats **stats);
+						  MCVList *mcv, MVHistogram *histogram,
+						  VacAttrStats **stats);
 
 
 /*
@@ -104,7 +112,10 @@ BuildRelationExtStatistics(Relation onerel, double totalrows,
 		MVNDistinct *ndistinct = NULL;
 		MVDependencies *dependencies = NULL;
 		MCVList    *mcv = NULL;
+		MVHistogram *histogram = NULL;
 		VacAttrStats **stats;
+		Bitmapset  *attrs = stat->columns;
+		HeapTuple  *statrows = rows;
 		ListCell   *lc2;
 
 		/*
@@ -126,9 +137,14 @@ BuildRelationExtStatistics(Relation onerel, double totalrows,
 			continue;
 		}
 
+		/* evaluate the expressions, if any, and use them as extra columns */
+		if (stat->exprs != NIL)
+			attrs = build_expression_sample(onerel, stat, numrows, &statrows,
+											&stats);
+
 		/* check allowed number of dimensions */
-		Assert(bms_num_members(stat->columns) >= 2 &&
-			   bms_num_members(stat->columns) <= STATS_MAX_DIMENSIONS);
+		Assert(bms_num_members(attrs) >= 2 &&
+			   bms_num_members(attrs) <= STATS_MAX_DIMENSIONS);
 
 		/* compute statistic of each requested type */
 		foreach(lc2, stat->types)
@@ -136,18 +152,22 @@ BuildRelationExtStatistics(Relation onerel, double totalrows,
 			char		t = (char) lfirst_int(lc2);
 
 			if (t == STATS_EXT_NDISTINCT)
-				ndistinct = statext_ndistinct_build(totalrows, numrows, rows,
-													stat->columns, stats);
+				ndistinct = statext_ndistinct_build(totalrows, numrows, statrows,
+													attrs, stats);
 			else if (t == STATS_EXT_DEPENDENCIES)
-				dependencies = statext_dependencies_build(numrows, rows,
-														  stat->columns, stats);
+				dependencies = statext_dependencies_build(numrows, statrows,
+														  attrs, stats);
 			else if (t == STATS_EXT_MCV)
-				mcv = statext_mcv_build(numrows, rows, stat->columns, stats,
+				mcv = statext_mcv_build(numrows, statrows, attrs, stats,
 										totalrows);
+			else if (t == STATS_EXT_HISTOGRAM)
+				histogram = statext_histogram_build(numrows, statrows,
+													attrs, stats);
 		}
 
 		/* store the statistics in the catalog */
-		statext_store(stat->statOid, ndistinct, dependencies, mcv, stats);
+		statext_store(stat->statOid, ndistinct, dependencies, mcv, histogram,
+					  stats);
 	}
 
 	table_close(pg_stext, RowExclusiveLock);
@@ -179,6 +199,10 @@ statext_is_kind_built(HeapTuple htup, char type)
 			attnum = Anum_pg_statistic_ext_data_stxdmcv;
 			break;
 
+		case STATS_EXT_HISTOGRAM:
+			attnum = Anum_pg_statistic_ext_data_stxdhistogram;
+			break;
+
 		default:
 			elog(ERROR, "unexpected statistics type requested: %d", type);
 	}
@@ -230,6 +254,12 @@ fetch_statentries_for_relation(Relation pg_statext, Oid relid)
 											staForm->stxkeys.values[i]);
 		}
 
+		/* the expressions, if any */
+		datum = SysCacheGetAttr(STATEXTOID, htup,
+								Anum_pg_statistic_ext_stxexprs, &isnull);
+		if (!isnull)
+			entry->exprs = (List *) stringToNode(TextDatumGetCString(datum));
+
 		/* decode the stxkind char array into a list of chars */
 		datum = SysCacheGetAttr(STATEXTOID, htup,
 								Anum_pg_statistic_ext_stxkind, &isnull);
@@ -244,7 +274,8 @@ fetch_statentries_for_relation(Relation pg_statext, Oid relid)
 		{
 			Assert((enabled[i] == STATS_EXT_NDISTINCT) ||
 				   (enabled[i] == STATS_EXT_DEPENDENCIES) ||
-				   (enabled[i] == STATS_EXT_MCV));
+				   (enabled[i] == STATS_EXT_MCV) ||
+				   (enabled[i] == STATS_EXT_HISTOGRAM));
 			entry->types = lappend_int(entry->types, (int) enabled[i]);
 		}
 
@@ -312,6 +343,138 @@ lookup_var_attr_stats(Relation rel, Bitmapset *attrs,
 	return stats;
 }
 
+/*
+ * build_expression_sample
+ *		Evaluate the expressions of a statistics object on the sampled rows.
+ *
+ * The code building the statistics only knows how to deal with columns, so
+ * we build new sample rows with the statistics object's columns followed by
+ * the values of its expressions, along with VacAttrStats describing them,
+ * much like compute_index_stats does for expression indexes.  The new rows
+ * and stats are returned in *rows and *stats, and the attnums of all the
+ * dimensions (in the new rows) are returned as a bitmap.
+ */
+static Bitmapset *
+build_expression_sample(Relation onerel, StatExtEntry *stat, int numrows,
+						HeapTuple **rows, VacAttrStats ***stats)
+{
+	int			ncolumns;
+	int			ndims;
+	int			i,
+				j;
+	AttrNumber *attnums;
+	TupleDesc	tupdesc;
+	VacAttrStats **newstats;
+	HeapTuple  *newrows;
+	Datum	   *values;
+	bool	   *nulls;
+	Bitmapset  *attrs = NULL;
+	EState	   *estate;
+	ExprContext *econtext;
+	TupleTableSlot *slot;
+	List	   *exprstates;
+	ListCell   *lc;
+
+	attnums = build_attnums_array(stat->columns, &ncolumns);
+	ndims = ncolumns + list_length(stat->exprs);
+
+	tupdesc = CreateTemplateTupleDesc(ndims);
+	newstats = (VacAttrStats **) palloc(ndims * sizeof(VacAttrStats *));
+
+	/* the columns come first, in the same order as in the bitmap */
+	for (i = 0; i < ncolumns; i++)
+	{
+		TupleDescCopyEntry(tupdesc, i + 1, RelationGetDescr(onerel),
+						   attnums[i]);
+
+		newstats[i] = (VacAttrStats *) palloc(sizeof(VacAttrStats));
+		memcpy(newstats[i], (*stats)[i], sizeof(VacAttrStats));
+	}
+
+	/* then the expressions, which have no per-column stats to copy */
+	foreach(lc, stat->exprs)
+	{
+		Node	   *expr = (Node *) lfirst(lc);
+		VacAttrStats *exprstats;
+		HeapTuple	typtuple;
+
+		TupleDescInitEntry(tupdesc, i + 1, "expr", exprType(expr),
+						   exprTypmod(expr), 0);
+		TupleDescInitEntryCollation(tupdesc, i + 1, exprCollation(expr));
+
+		exprstats = (VacAttrStats *) palloc0(sizeof(VacAttrStats));
+		exprstats->attr = (Form_pg_attribute) palloc(ATTRIBUTE_FIXED_PART_SIZE);
+		memcpy(exprstats->attr, TupleDescAttr(tupdesc, i),
+			   ATTRIBUTE_FIXED_PART_SIZE);
+		exprstats->attr->attstattarget = default_statistics_target;
+
+		exprstats->attrtypid = exprType(expr);
+		exprstats->attrtypmod = exprTypmod(expr);
+		exprstats->attrcollid = exprCollation(expr);
+
+		typtuple = SearchSysCacheCopy1(TYPEOID,
+									   ObjectIdGetDatum(exprstats->attrtypid));
+		if (!HeapTupleIsValid(typtuple))
+			elog(ERROR, "cache lookup failed for type %u", exprstats->attrtypid);
+		exprstats->attrtype = (Form_pg_type) GETSTRUCT(typtuple);
+
+		newstats[i++] = exprstats;
+	}
+
+	for (i = 0; i < ndims; i++)
+	{
+		newstats[i]->tupDesc = tupdesc;
+		newstats[i]->tupattnum = i + 1;
+		attrs = bms_add_member(attrs, i + 1);
+	}
+
+	/* set up for evaluating the expressions, as compute_index_stats does */
+	estate = CreateExecutorState();
+	econtext = GetPerTupleExprContext(estate);
+	slot = MakeSingleTupleTableSlot(RelationGetDescr(onerel),
+									&TTSOpsHeapTuple);
+	econtext->ecxt_scantuple = slot;
+	exprstates = ExecPrepareExprList(stat->exprs, estate);
+
+	newrows = (HeapTuple *) palloc(numrows * sizeof(HeapTuple));
+	values = (Datum *) palloc(ndims * sizeof(Datum));
+	nulls = (bool *) palloc(ndims * sizeof(bool));
+
+	for (j = 0; j < numrows; j++)
+	{
+		HeapTuple	heapTuple = (*rows)[j];
+
+		vacuum_delay_point();
+
+		ResetExprContext(econtext);
+		ExecStoreHeapTuple(heapTuple, slot, false);
+
+		for (i = 0; i < ncolumns; i++)
+			values[i] = heap_getattr(heapTuple, attnums[i],
+									 RelationGetDescr(onerel), &nulls[i]);
+
+		foreach(lc, exprstates)
+		{
+			ExprState  *exprstate = (ExprState *) lfirst(lc);
+
+			values[i] = ExecEvalExprSwitchContext(exprstate, econtext,
+												  &nulls[i]);
+			i++;
+		}
+
+		/* this copies the expression results out of the per-tuple context */
+		newrows[j] = heap_form_tuple(tupdesc, values, nulls);
+	}
+
+	ExecDropSingleTupleTableSlot(slot);
+	FreeExecutorState(estate);
+
+	*rows = newrows;
+	*stats = newstats;
+
+	return attrs;
+}
+
 /*
  * statext_store
  *	Serializes the statistics and stores them into the pg_statistic_ext_data
@@ -320,7 +483,7 @@ lookup_var_attr_stats(Relation rel, Bitmapset *attrs,
 static void
 statext_store(Oid statOid,
 			  MVNDistinct *ndistinct, MVDependencies *dependencies,
-			  MCVList *mcv, VacAttrStats **stats)
+			  MCVList *mcv, MVHistogram *histogram, VacAttrStats **stats)
 {
 	Relation	pg_stextdata;
 	HeapTuple	stup,
@@ -361,11 +524,19 @@ statext_store(Oid statOid,
 		nulls[Anum_pg_statistic_ext_data_stxdmcv - 1] = (data == NULL);
 		values[Anum_pg_statistic_ext_data_stxdmcv - 1] = PointerGetDatum(data);
 	}
+	if (histogram != NULL)
+	{
+		bytea	   *data = statext_histogram_serialize(histogram, stats);
+
+		nulls[Anum_pg_statistic_ext_data_stxdhistogram - 1] = (data == NULL);
+		values[Anum_pg_statistic_ext_data_stxdhistogram - 1] = PointerGetDatum(data);
+	}
 
 	/* always replace the value (either by bytea or NULL) */
 	replaces[Anum_pg_statistic_ext_data_stxdndistinct - 1] = true;
 	replaces[Anum_pg_statistic_ext_data_stxddependencies - 1] = true;
 	replaces[Anum_pg_statistic_ext_data_stxdmcv - 1] = true;
+	replaces[Anum_pg_statistic_ext_data_stxdhistogram - 1] = true;
 
 	/* there should already be a pg_statistic_ext_data tuple */
 	oldtup = SearchSysCache1(STATEXTDATASTXOID, ObjectIdGetDatum(statOid));
@@ -1166,6 +1337,230 @@ statext_mcv_clauselist_selectivity(PlannerInfo *root, List *clauses, int varReli
 	return sel;
 }
 
+/*
+ * statext_histogram_clause_expr
+ *		Determines if a clause can be estimated using a histogram, and if so
+ *		returns the column or expression it restricts.
+ *
+ * Histograms are only used for range clauses, i.e. (expr op Const) with op
+ * being one of ("<", "<=", ">", ">="), where expr is either a plain column
+ * or an expression matching one on which a statistics object was built (see
+ * statext_histogram_dimension). The remaining clauses (equalities in
+ * particular) are better handled by MCV lists and functional dependencies.
+ *
+ * Returns NULL if the clause is not compatible with histograms.
+ */
+static Node *
+statext_histogram_clause_expr(PlannerInfo *root, Node *clause, Index relid)
+{
+	RangeTblEntry *rte = root->simple_rte_array[relid];
+	RestrictInfo *rinfo = (RestrictInfo *) clause;
+	OpExpr	   *expr;
+	Node	   *clause_expr;
+	Oid			userid;
+
+	if (!IsA(rinfo, RestrictInfo))
+		return NULL;
+
+	/* Pseudoconstants are not really interesting here. */
+	if (rinfo->pseudoconstant)
+		return NULL;
+
+	/* clauses referencing other relations are incompatible */
+	if (!bms_equal(rinfo->clause_relids, bms_make_singleton(relid)))
+		return NULL;
+
+	if (!is_opclause(rinfo->clause))
+		return NULL;
+	expr = (OpExpr *) rinfo->clause;
+
+	/* Only expressions with two arguments are considered compatible. */
+	if (list_length(expr->args) != 2)
+		return NULL;
+
+	switch (get_oprrest(expr->opno))
+	{
+		case F_SCALARLTSEL:
+		case F_SCALARLESEL:
+		case F_SCALARGTSEL:
+		case F_SCALARGESEL:
+			break;
+
+		default:
+			return NULL;
+	}
+
+	/* Check if the expression has the right shape (one Const) */
+	if (!examine_opclause_args(expr, &clause_expr, NULL, NULL))
+		return NULL;
+
+	/* Skip system attributes, we don't allow stats on those. */
+	if (IsA(clause_expr, Var) &&
+		!AttrNumberIsForUserDefinedAttr(((Var *) clause_expr)->varattno))
+		return NULL;
+
+	/*
+	 * As for MCV lists, the operator has to be leak-proof if there are any
+	 * securityQuals on the RTE, or it might reveal the histogram boundaries.
+	 */
+	if (rte->securityQuals != NIL &&
+		!get_func_leakproof(get_opcode(expr->opno)))
+		return NULL;
+
+	/*
+	 * Check that the user has permission to read all the columns the clause
+	 * references, as in statext_is_compatible_clause.
+	 */
+	userid = rte->checkAsUser ? rte->checkAsUser : GetUserId();
+
+	if (pg_class_aclcheck(rte->relid, userid, ACL_SELECT) != ACLCHECK_OK)
+	{
+		Bitmapset  *attnums = NULL;
+		int			k = -1;
+
+		pull_varattnos(clause_expr, relid, &attnums);
+
+		while ((k = bms_next_member(attnums, k)) >= 0)
+		{
+			AttrNumber	attnum = k + FirstLowInvalidHeapAttributeNumber;
+
+			if (attnum == InvalidAttrNumber)
+			{
+				/* Have a whole-row reference, must have access to all columns */
+				if (pg_attribute_aclcheck_all(rte->relid, userid, ACL_SELECT,
+											  ACLMASK_ALL) != ACLCHECK_OK)
+					return NULL;
+			}
+			else if (pg_attribute_aclcheck(rte->relid, attnum, userid,
+										   ACL_SELECT) != ACLCHECK_OK)
+				return NULL;
+		}
+	}
+
+	return clause_expr;
+}
+
+/*
+ * statext_histogram_clauselist_selectivity
+ *		Estimate range clauses using the best multi-column histogram.
+ *
+ * Selects the histogram covering the most dimensions restricted by range
+ * clauses (see statext_histogram_clause_expr), breaking ties in favor of
+ * histograms with fewer dimensions overall, and estimates all the range
+ * clauses it covers at once.  We need at least two dimensions, as otherwise
+ * the per-column statistics are just as good, except for expressions: those
+ * have no statistics of their own, so a single one is enough.
+ *
+ * Unlike MCV lists, histograms describe the whole data distribution, so no
+ * correction for the part of the data not covered by the statistics is
+ * needed.
+ *
+ * 'estimatedclauses' is an input/output parameter, just like for
+ * statext_mcv_clauselist_selectivity.
+ */
+static Selectivity
+statext_histogram_clauselist_selectivity(PlannerInfo *root, List *clauses,
+										 int varRelid, JoinType jointype,
+										 SpecialJoinInfo *sjinfo,
+										 RelOptInfo *rel,
+										 Bitmapset **estimatedclauses)
+{
+	ListCell   *l;
+	Node	  **list_exprs;
+	int			listidx;
+	StatisticExtInfo *stat = NULL;
+	int			best_num_matched = 0;
+	int			best_num_dims = STATS_MAX_DIMENSIONS + 1;
+	List	   *stat_clauses;
+
+	/* check if there's any stats that might be useful for us. */
+	if (!has_stats_of_kind(rel->statlist, STATS_EXT_HISTOGRAM))
+		return 1.0;
+
+	list_exprs = (Node **) palloc(sizeof(Node *) * list_length(clauses));
+
+	/* collect the columns/expressions of the (unestimated) range clauses */
+	listidx = 0;
+	foreach(l, clauses)
+	{
+		Node	   *clause = (Node *) lfirst(l);
+
+		if (!bms_is_member(listidx, *estimatedclauses))
+			list_exprs[listidx] = statext_histogram_clause_expr(root, clause,
+																rel->relid);
+		else
+			list_exprs[listidx] = NULL;
+
+		listidx++;
+	}
+
+	/* find the best suited histogram for these columns/expressions */
+	foreach(l, rel->statlist)
+	{
+		StatisticExtInfo *info = (StatisticExtInfo *) lfirst(l);
+		Bitmapset  *matched = NULL;
+		int			num_keys = bms_num_members(info->keys);
+		int			num_dims = num_keys + list_length(info->exprs);
+		int			num_matched;
+		bool		has_expr = false;
+
+		if (info->kind != STATS_EXT_HISTOGRAM)
+			continue;
+
+		for (listidx = 0; listidx < list_length(clauses); listidx++)
+		{
+			int			dim;
+
+			if (!list_exprs[listidx])
+				continue;
+
+			dim = statext_histogram_dimension(info, list_exprs[listidx]);
+			if (dim < 0)
+				continue;
+
+			matched = bms_add_member(matched, dim);
+			has_expr |= (dim >= num_keys);
+		}
+
+		num_matched = bms_num_members(matched);
+		bms_free(matched);
+
+		if (num_matched < 2 && !has_expr)
+			continue;
+
+		if (num_matched > best_num_matched ||
+			(num_matched == best_num_matched && num_dims < best_num_dims))
+		{
+			stat = info;
+			best_num_matched = num_matched;
+			best_num_dims = num_dims;
+		}
+	}
+
+	/* if no matching stats could be found then we've nothing to do */
+	if (!stat)
+		return 1.0;
+
+	/* now filter the clauses to be estimated using the selected histogram */
+	stat_clauses = NIL;
+
+	listidx = 0;
+	foreach(l, clauses)
+	{
+		if (list_exprs[listidx] != NULL &&
+			statext_histogram_dimension(stat, list_exprs[listidx]) >= 0)
+		{
+			stat_clauses = lappend(stat_clauses, (Node *) lfirst(l));
+			*estimatedclauses = bms_add_member(*estimatedclauses, listidx);
+		}
+
+		listidx++;
+	}
+
+	return histogram_clauselist_selectivity(root, stat, stat_clauses,
+											varRelid, jointype, sjinfo, rel);
+}
+
 /*
  * statext_clauselist_selectivity
  *		Estimate clauses using the best multi-column statistics.
@@ -1177,9 +1572,15 @@ statext_clauselist_selectivity(PlannerInfo *root, List *clauses, int varRelid,
 {
 	Selectivity sel;
 
-	/* First, try estimating clauses using a multivariate MCV list. */
-	sel = statext_mcv_clauselist_selectivity(root, clauses, varRelid, jointype,
-											 sjinfo, rel, estimatedclauses);
+	/* First, try estimating range clauses using a multivariate histogram. */
+	sel = statext_histogram_clauselist_selectivity(root, clauses, varRelid,
+												   jointype, sjinfo, rel,
+												   estimatedclauses);
+
+	/* Then, try estimating the remaining clauses using an MCV list. */
+	sel *= statext_mcv_clauselist_selectivity(root, clauses, varRelid,
+											  jointype, sjinfo, rel,
+											  estimatedclauses);
 
 	/*
 	 * Then, apply functional dependencies on the remaining clauses by calling
@@ -1202,27 +1603,28 @@ statext_clauselist_selectivity(PlannerInfo *root, List *clauses, int varRelid,
 }
 
 /*
- * examine_operator_expression
- *		Split expression into Var and Const parts.
+ * examine_opclause_args
+ *		Split expression into an expression and a Const part.
  *
- * Attempts to match the arguments to either (Var op Const) or (Const op Var),
- * possibly with a RelabelType on top. When the expression matches this form,
- * returns true, otherwise returns false.
+ * Attempts to match the arguments to either (expr op Const) or (Const op
+ * expr), possibly with a RelabelType on top of either side.  When the
+ * expression matches this form, returns true, otherwise returns false.
  *
- * Optionally returns pointers to the extracted Var/Const nodes, when passed
- * non-null pointers (varp, cstp and varonleftp). The varonleftp flag specifies
- * on which side of the operator we found the Var node.
+ * Optionally returns pointers to the extracted parts, when passed non-null
+ * pointers (exprp, cstp and expronleftp). The expronleftp flag specifies on
+ * which side of the operator we found the expression.
  */
 bool
-examine_opclause_expression(OpExpr *expr, Var **varp, Const **cstp, bool *varonleftp)
+examine_opclause_args(OpExpr *expr, Node **exprp, Const **cstp,
+					  bool *expronleftp)
 {
-	Var	   *var;
-	Const  *cst;
-	bool	varonleft;
-	Node   *leftop,
-		   *rightop;
+	Node	   *clause_expr;
+	Const	   *cst;
+	bool		expronleft;
+	Node	   *leftop,
+			   *rightop;
 
-	/* enforced by statext_is_compatible_clause_internal */
+	/* enforced by the callers */
 	Assert(list_length(expr->args) == 2);
 
 	leftop = linitial(expr->args);
@@ -1235,24 +1637,58 @@ examine_opclause_expression(OpExpr *expr, Var **varp, Const **cstp, bool *varonl
 	if (IsA(rightop, RelabelType))
 		rightop = (Node *) ((RelabelType *) rightop)->arg;
 
-	if (IsA(leftop, Var) && IsA(rightop, Const))
+	if (IsA(rightop, Const))
 	{
-		var = (Var *) leftop;
+		clause_expr = leftop;
 		cst = (Const *) rightop;
-		varonleft = true;
+		expronleft = true;
 	}
-	else if (IsA(leftop, Const) && IsA(rightop, Var))
+	else if (IsA(leftop, Const))
 	{
-		var = (Var *) rightop;
+		clause_expr = rightop;
 		cst = (Const *) leftop;
-		varonleft = false;
+		expronleft = false;
 	}
 	else
 		return false;
 
+	/* return pointers to the extracted parts if requested */
+	if (exprp)
+		*exprp = clause_expr;
+
+	if (cstp)
+		*cstp = cst;
+
+	if (expronleftp)
+		*expronleftp = expronleft;
+
+	return true;
+}
+
+/*
+ * examine_opclause_expression
+ *		Split expression into Var and Const parts.
+ *
+ * Same as examine_opclause_args, but only matches (Var op Const) or
+ * (Const op Var).  The varonleftp flag specifies on which side of the
+ * operator we found the Var node.
+ */
+bool
+examine_opclause_expression(OpExpr *expr, Var **varp, Const **cstp, bool *varonleftp)
+{
+	Node	   *clause_expr;
+	Const	   *cst;
+	bool		varonleft;
+
+	if (!examine_opclause_args(expr, &clause_expr, &cst, &varonleft))
+		return false;
+
+	if (!IsA(clause_expr, Var))
+		return false;
+
 	/* return pointers to the extracted parts if requested */
 	if (varp)
-		*varp = var;
+		*varp = (Var *) clause_expr;
 
 	if (cstp)
 		*cstp = cst;
@@ -1262,3 +1698,38 @@ examine_opclause_expression(OpExpr *expr, Var **varp, Const **cstp, bool *varonl
 
 	return true;
 }
+
+/*
+ * statext_histogram_dimension
+ *		Match a column or expression to a dimension of a histogram.
+ *
+ * The dimensions are the statistics object's columns (in attnum order),
+ * followed by its expressions.  Returns the index of the dimension, or -1
+ * if the column or expression is not covered by the statistics object.
+ */
+int
+statext_histogram_dimension(StatisticExtInfo *stat, Node *expr)
+{
+	int			dim;
+	ListCell   *lc;
+
+	if (IsA(expr, Var) && bms_is_member(((Var *) expr)->varattno, stat->keys))
+		return bms_member_index(stat->keys, ((Var *) expr)->varattno);
+
+	dim = bms_num_members(stat->keys);
+	foreach(lc, stat->exprs)
+	{
+		Node	   *stat_expr = (Node *) lfirst(lc);
+
+		/* strip RelabelType, as examine_opclause_args does for the clause */
+		if (IsA(stat_expr, RelabelType))
+			stat_expr = (Node *) ((RelabelType *) stat_expr)->arg;
+
+		if (equal(expr, stat_expr))
+			return dim;
+
+		dim++;
+	}
+
+	return -1;
+}
@@ -0,0 +1,794 @@
+/*-------------------------------------------------------------------------
+ *
+ * histogram.c
+ *	  POSTGRES multivariate histograms
+ *
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * IDENTIFICATION
+ *	  src/backend/statistics/histogram.c
+ *
+ *-------------------------------------------------------------------------
+ */
+#include "postgres.h"
+
+#include <math.h>
+
+#include "access/htup_details.h"
+#include "catalog/pg_statistic_ext.h"
+#include "catalog/pg_statistic_ext_data.h"
+#include "fmgr.h"
+#include "nodes/nodeFuncs.h"
+#include "optimizer/clauses.h"
+#include "statistics/extended_stats_internal.h"
+#include "statistics/statistics.h"
+#include "utils/builtins.h"
+#include "utils/bytea.h"
+#include "utils/datum.h"
+#include "utils/fmgrprotos.h"
+#include "utils/lsyscache.h"
+#include "utils/selfuncs.h"
+#include "utils/syscache.h"
+
+/*
+ * Buckets with fewer than twice this many sampled rows are never split, so
+ * that the per-bucket frequencies stay reasonably reliable.
+ */
+#define STATS_HIST_MIN_BUCKET_ROWS	10
+
+/*
+ * Number of buckets allowed per unit of statistics target.  With the default
+ * target of 100 that means up to 1000 buckets, i.e. roughly 30 sampled rows
+ * per bucket with the default sample size.
+ */
+#define STATS_HIST_BUCKETS_PER_TARGET	10
+
+/*
+ * Fraction of a bucket assumed to satisfy a clause when the clause matches
+ * only some of the bucket's range in that dimension.
+ */
+#define STATS_HIST_PARTIAL_MATCH	0.5
+
+/*
+ * Used to compute size of serialized histogram representation.
+ */
+#define MinSizeOfHistogram		\
+	(VARHDRSZ + sizeof(uint32) * 3 + sizeof(AttrNumber) + sizeof(double))
+
+/*
+ * A bucket while the histogram is being built: a contiguous range of the
+ * array of sampled rows.
+ */
+typedef struct HistogramBuildBucket
+{
+	int			start;			/* index of the first row */
+	int			nrows;			/* number of rows in the bucket */
+	bool		splittable;		/* may the bucket be split any further? */
+} HistogramBuildBucket;
+
+/* sort context for sorting the rows by a single dimension */
+typedef struct HistogramSortContext
+{
+	int			dim;
+	MultiSortSupport mss;
+} HistogramSortContext;
+
+static int	compare_sort_items_dim(const void *a, const void *b, void *arg);
+static int	count_distinct_in_dimension(SortItem *items, int nitems, int dim,
+										MultiSortSupport mss);
+static bool split_bucket(HistogramBuildBucket *bucket,
+						 HistogramBuildBucket *newbucket,
+						 SortItem *items, MultiSortSupport mss, int ndims);
+
+/*
+ * statext_histogram_build
+ *		Build a multivariate histogram on the sampled rows.
+ *
+ * The histogram is built by recursive partitioning of the sample, similar
+ * to the way equi-depth histograms are built in a single dimension:
+ *
+ *	   (1) put all the rows with no NULL values into a single bucket
+ *
+ *	   (2) pick the bucket with the most rows, and within it the dimension
+ *		   with the most distinct values
+ *
+ *	   (3) split the bucket at the median value of that dimension
+ *
+ *	   (4) repeat until we reach the maximum number of buckets, or until no
+ *		   bucket can be split any more
+ *
+ * The boundaries of each bucket are the smallest and largest values of the
+ * rows it ended up with, so empty space between the buckets is not covered
+ * by any of them.
+ */
+MVHistogram *
+statext_histogram_build(int numrows, HeapTuple *rows, Bitmapset *attrs,
+						VacAttrStats **stats)
+{
+	int			i,
+				dim,
+				numattrs,
+				nitems,
+				nvalid,
+				nbuckets,
+				maxbuckets;
+	AttrNumber *attnums;
+	SortItem   *items;
+	MultiSortSupport mss;
+	HistogramBuildBucket *buckets;
+	MVHistogram *histogram;
+
+	attnums = build_attnums_array(attrs, &numattrs);
+
+	/* comparator for all the columns */
+	mss = build_mss(stats, numattrs);
+
+	/* load the sampled rows (we don't care about the ordering, though) */
+	items = build_sorted_items(numrows, &nitems, rows, stats[0]->tupDesc,
+							   mss, numattrs, attnums);
+
+	if (!items)
+		return NULL;
+
+	/* move rows with a NULL in any dimension to the end, and skip them */
+	nvalid = 0;
+	for (i = 0; i < nitems; i++)
+	{
+		bool		hasnull = false;
+
+		for (dim = 0; dim < numattrs; dim++)
+			hasnull |= items[i].isnull[dim];
+
+		if (!hasnull)
+		{
+			SortItem	tmp = items[nvalid];
+
+			items[nvalid++] = items[i];
+			items[i] = tmp;
+		}
+	}
+
+	/* we need at least a couple of rows for a meaningful histogram */
+	if (nvalid < 2)
+	{
+		pfree(items);
+		return NULL;
+	}
+
+	/*
+	 * Maximum number of buckets, based on the attribute with the largest
+	 * stats target.
+	 */
+	maxbuckets = stats[0]->attr->attstattarget;
+	for (i = 1; i < numattrs; i++)
+	{
+		if (stats[i]->attr->attstattarget > maxbuckets)
+			maxbuckets = stats[i]->attr->attstattarget;
+	}
+	maxbuckets = Min(maxbuckets * STATS_HIST_BUCKETS_PER_TARGET,
+					 STATS_HIST_MAX_BUCKETS);
+	maxbuckets = Max(maxbuckets, 1);
+
+	buckets = (HistogramBuildBucket *)
+		palloc(sizeof(HistogramBuildBucket) * maxbuckets);
+
+	buckets[0].start = 0;
+	buckets[0].nrows = nvalid;
+	buckets[0].splittable = true;
+	nbuckets = 1;
+
+	while (nbuckets < maxbuckets)
+	{
+		int			best = -1;
+
+		/* find the largest bucket that may still be split */
+		for (i = 0; i < nbuckets; i++)
+		{
+			if (!buckets[i].splittable ||
+				buckets[i].nrows < 2 * STATS_HIST_MIN_BUCKET_ROWS)
+				continue;
+
+			if (best == -1 || buckets[i].nrows > buckets[best].nrows)
+				best = i;
+		}
+
+		if (best == -1)
+			break;
+
+		if (split_bucket(&buckets[best], &buckets[nbuckets], items, mss,
+						 numattrs))
+			nbuckets++;
+		else
+			buckets[best].splittable = false;
+	}
+
+	/* build the histogram itself */
+	histogram = (MVHistogram *) palloc0(offsetof(MVHistogram, buckets) +
+										sizeof(MVBucket) * nbuckets);
+
+	histogram->magic = STATS_HIST_MAGIC;
+	histogram->type = STATS_HIST_TYPE_BASIC;
+	histogram->nbuckets = nbuckets;
+	histogram->ndimensions = numattrs;
+	histogram->nullfrac = (double) (nitems - nvalid) / nitems;
+
+	/* store info about data type OIDs */
+	for (dim = 0; dim < numattrs; dim++)
+		histogram->types[dim] = stats[dim]->attrtypid;
+
+	for (i = 0; i < nbuckets; i++)
+	{
+		HistogramBuildBucket *bucket = &buckets[i];
+		MVBucket   *result = &histogram->buckets[i];
+		int			j;
+
+		result->frequency = (double) bucket->nrows / nvalid;
+		result->min = (Datum *) palloc(sizeof(Datum) * numattrs);
+		result->max = (Datum *) palloc(sizeof(Datum) * numattrs);
+
+		/* the boundaries are the extreme values of the bucket's rows */
+		for (dim = 0; dim < numattrs; dim++)
+		{
+			SortItem   *minitem = &items[bucket->start];
+			SortItem   *maxitem = &items[bucket->start];
+
+			for (j = bucket->start + 1; j < bucket->start + bucket->nrows; j++)
+			{
+				if (multi_sort_compare_dim(dim, &items[j], minitem, mss) < 0)
+					minitem = &items[j];
+				if (multi_sort_compare_dim(dim, &items[j], maxitem, mss) > 0)
+					maxitem = &items[j];
+			}
+
+			result->min[dim] = minitem->values[dim];
+			result->max[dim] = maxitem->values[dim];
+		}
+	}
+
+	pfree(items);
+	pfree(buckets);
+
+	return histogram;
+}
+
+/*
+ * compare_sort_items_dim
+ *		qsort_arg comparator sorting SortItems by a single dimension
+ */
+static int
+compare_sort_items_dim(const void *a, const void *b, void *arg)
+{
+	HistogramSortContext *cxt = (HistogramSortContext *) arg;
+
+	return multi_sort_compare_dim(cxt->dim, (const SortItem *) a,
+								  (const SortItem *) b, cxt->mss);
+}
+
+/*
+ * count_distinct_in_dimension
+ *		Count distinct values in a dimension, with items sorted by it.
+ */
+static int
+count_distinct_in_dimension(SortItem *items, int nitems, int dim,
+							MultiSortSupport mss)
+{
+	int			i;
+	int			ndistinct = 1;
+
+	for (i = 1; i < nitems; i++)
+	{
+		if (multi_sort_compare_dim(dim, &items[i - 1], &items[i], mss) != 0)
+			ndistinct++;
+	}
+
+	return ndistinct;
+}
+
+/*
+ * split_bucket
+ *		Split the bucket in the dimension with the most distinct values.
+ *
+ * The bucket is split at the median of the chosen dimension, adjusted to the
+ * nearest boundary between two distinct values so that no value ends up in
+ * both halves.  The upper half is stored into 'newbucket'.  Returns false if
+ * the bucket holds a single distinct value in every dimension, and so can't
+ * be split at all.
+ */
+static bool
+split_bucket(HistogramBuildBucket *bucket, HistogramBuildBucket *newbucket,
+			 SortItem *items, MultiSortSupport mss, int ndims)
+{
+	int			dim;
+	int			split;
+	int			bestdim = -1;
+	int			bestndistinct = 1;
+	SortItem   *rows = &items[bucket->start];
+	HistogramSortContext cxt;
+
+	cxt.mss = mss;
+
+	for (dim = 0; dim < ndims; dim++)
+	{
+		int			ndistinct;
+
+		cxt.dim = dim;
+		qsort_arg((void *) rows, bucket->nrows, sizeof(SortItem),
+				  compare_sort_items_dim, &cxt);
+
+		ndistinct = count_distinct_in_dimension(rows, bucket->nrows, dim, mss);
+
+		if (ndistinct > bestndistinct)
+		{
+			bestdim = dim;
+			bestndistinct = ndistinct;
+		}
+	}
+
+	/* all the rows are the same, so there's nothing to split */
+	if (bestdim == -1)
+		return false;
+
+	/* sort the rows by the chosen dimension, unless it was the last one */
+	if (bestdim != ndims - 1)
+	{
+		cxt.dim = bestdim;
+		qsort_arg((void *) rows, bucket->nrows, sizeof(SortItem),
+				  compare_sort_items_dim, &cxt);
+	}
+
+	/* look for the first value boundary at or above the median ... */
+	for (split = bucket->nrows / 2; split < bucket->nrows; split++)
+	{
+		if (multi_sort_compare_dim(bestdim, &rows[split - 1], &rows[split],
+								   mss) != 0)
+			break;
+	}
+
+	/* ... and if there's none, for the last one below it */
+	if (split == bucket->nrows)
+	{
+		for (split = bucket->nrows / 2 - 1; split > 0; split--)
+		{
+			if (multi_sort_compare_dim(bestdim, &rows[split - 1], &rows[split],
+									   mss) != 0)
+				break;
+		}
+	}
+
+	/* there are at least two distinct values, so there has to be one */
+	Assert(split > 0 && split < bucket->nrows);
+
+	newbucket->start = bucket->start + split;
+	newbucket->nrows = bucket->nrows - split;
+	newbucket->splittable = true;
+
+	bucket->nrows = split;
+
+	return true;
+}
+
+/*
+ * statext_histogram_load
+ *		Load the histogram for the indicated pg_statistic_ext tuple
+ */
+MVHistogram *
+statext_histogram_load(Oid mvoid)
+{
+	MVHistogram *result;
+	bool		isnull;
+	Datum		histogram;
+	HeapTuple	htup = SearchSysCache1(STATEXTDATASTXOID, ObjectIdGetDatum(mvoid));
+
+	if (!HeapTupleIsValid(htup))
+		elog(ERROR, "cache lookup failed for statistics object %u", mvoid);
+
+	histogram = SysCacheGetAttr(STATEXTDATASTXOID, htup,
+								Anum_pg_statistic_ext_data_stxdhistogram,
+								&isnull);
+
+	if (isnull)
+		elog(ERROR,
+			 "requested statistic kind \"%c\" is not yet built for statistics object %u",
+			 STATS_EXT_HISTOGRAM, mvoid);
+
+	result = statext_histogram_deserialize(DatumGetByteaP(histogram));
+
+	ReleaseSysCache(htup);
+
+	return result;
+}
+
+/*
+ * statext_histogram_serialize
+ *		Serialize the histogram into a pg_histogram value.
+ *
+ * The serialized representation starts with the header fields, followed by
+ * the data type OIDs, followed by the buckets.  Each bucket consists of its
+ * frequency and the lower and upper boundary in each dimension, stored using
+ * datumSerialize.
+ *
+ * Unlike MCV lists we don't deduplicate the boundary values.  The buckets
+ * are split on different dimensions, so there's not much redundancy between
+ * them, and the value is TOAST-compressed anyway.
+ */
+bytea *
+statext_histogram_serialize(MVHistogram *histogram, VacAttrStats **stats)
+{
+	int			i,
+				dim;
+	int			ndims = histogram->ndimensions;
+	Size		total_length;
+	bytea	   *output;
+	char	   *ptr;
+	char	   *endptr PG_USED_FOR_ASSERTS_ONLY;
+
+	/* header and type OIDs */
+	total_length = MinSizeOfHistogram + sizeof(Oid) * ndims;
+
+	/* the buckets */
+	for (i = 0; i < histogram->nbuckets; i++)
+	{
+		MVBucket   *bucket = &histogram->buckets[i];
+
+		total_length += sizeof(double);
+
+		for (dim = 0; dim < ndims; dim++)
+		{
+			bool		typbyval = stats[dim]->attrtype->typbyval;
+			int			typlen = stats[dim]->attrtype->typlen;
+
+			total_length += datumEstimateSpace(bucket->min[dim], false,
+											   typbyval, typlen);
+			total_length += datumEstimateSpace(bucket->max[dim], false,
+											   typbyval, typlen);
+		}
+	}
+
+	output = (bytea *) palloc0(total_length);
+	SET_VARSIZE(output, total_length);
+
+	ptr = VARDATA(output);
+	endptr = (char *) output + total_length;
+
+	/* store the histogram header */
+	memcpy(ptr, &histogram->magic, sizeof(uint32));
+	ptr += sizeof(uint32);
+
+	memcpy(ptr, &histogram->type, sizeof(uint32));
+	ptr += sizeof(uint32);
+
+	memcpy(ptr, &histogram->nbuckets, sizeof(uint32));
+	ptr += sizeof(uint32);
+
+	memcpy(ptr, &histogram->ndimensions, sizeof(AttrNumber));
+	ptr += sizeof(AttrNumber);
+
+	memcpy(ptr, &histogram->nullfrac, sizeof(double));
+	ptr += sizeof(double);
+
+	memcpy(ptr, histogram->types, sizeof(Oid) * ndims);
+	ptr += sizeof(Oid) * ndims;
+
+	/* and then the buckets */
+	for (i = 0; i < histogram->nbuckets; i++)
+	{
+		MVBucket   *bucket = &histogram->buckets[i];
+
+		memcpy(ptr, &bucket->frequency, sizeof(double));
+		ptr += sizeof(double);
+
+		for (dim = 0; dim < ndims; dim++)
+		{
+			bool		typbyval = stats[dim]->attrtype->typbyval;
+			int			typlen = stats[dim]->attrtype->typlen;
+
+			datumSerialize(bucket->min[dim], false, typbyval, typlen, &ptr);
+			datumSerialize(bucket->max[dim], false, typbyval, typlen, &ptr);
+		}
+	}
+
+	Assert(ptr == endptr);
+
+	return output;
+}
+
+/*
+ * statext_histogram_deserialize
+ *		Reads serialized histogram into MVHistogram structure.
+ */
+MVHistogram *
+statext_histogram_deserialize(bytea *data)
+{
+	int			i,
+				dim;
+	MVHistogram *histogram;
+	MVHistogram header;
+	char	   *ptr;
+	char	   *endptr PG_USED_FOR_ASSERTS_ONLY;
+
+	if (data == NULL)
+		return NULL;
+
+	/*
+	 * We can't possibly deserialize a histogram if there's not even a
+	 * complete header.
+	 */
+	if (VARSIZE_ANY(data) < MinSizeOfHistogram)
+		elog(ERROR, "invalid histogram size %zd (expected at least %zu)",
+			 VARSIZE_ANY(data), MinSizeOfHistogram);
+
+	ptr = VARDATA_ANY(data);
+	endptr = (char *) data + VARSIZE_ANY(data);
+
+	/* get the header and perform further sanity checks */
+	memcpy(&header.magic, ptr, sizeof(uint32));
+	ptr += sizeof(uint32);
+
+	memcpy(&header.type, ptr, sizeof(uint32));
+	ptr += sizeof(uint32);
+
+	memcpy(&header.nbuckets, ptr, sizeof(uint32));
+	ptr += sizeof(uint32);
+
+	memcpy(&header.ndimensions, ptr, sizeof(AttrNumber));
+	ptr += sizeof(AttrNumber);
+
+	memcpy(&header.nullfrac, ptr, sizeof(double));
+	ptr += sizeof(double);
+
+	if (header.magic != STATS_HIST_MAGIC)
+		elog(ERROR, "invalid histogram magic %u (expected %u)",
+			 header.magic, STATS_HIST_MAGIC);
+
+	if (header.type != STATS_HIST_TYPE_BASIC)
+		elog(ERROR, "invalid histogram type %u (expected %u)",
+			 header.type, STATS_HIST_TYPE_BASIC);
+
+	if (header.ndimensions == 0)
+		elog(ERROR, "invalid zero-length dimension array in histogram");
+	else if ((header.ndimensions > STATS_MAX_DIMENSIONS) ||
+			 (header.ndimensions < 0))
+		elog(ERROR, "invalid length (%d) dimension array in histogram",
+			 header.ndimensions);
+
+	if (header.nbuckets == 0)
+		elog(ERROR, "invalid zero-length bucket array in histogram");
+	else if (header.nbuckets > STATS_HIST_MAX_BUCKETS)
+		elog(ERROR, "invalid length (%u) bucket array in histogram",
+			 header.nbuckets);
+
+	if (VARSIZE_ANY(data) < MinSizeOfHistogram +
+		sizeof(Oid) * header.ndimensions +
+		(sizeof(double) * header.nbuckets))
+		elog(ERROR, "invalid histogram size %zd", VARSIZE_ANY(data));
+
+	histogram = (MVHistogram *) palloc0(offsetof(MVHistogram, buckets) +
+										sizeof(MVBucket) * header.nbuckets);
+
+	histogram->magic = header.magic;
+	histogram->type = header.type;
+	histogram->nbuckets = header.nbuckets;
+	histogram->ndimensions = header.ndimensions;
+	histogram->nullfrac = header.nullfrac;
+
+	memcpy(histogram->types, ptr, sizeof(Oid) * header.ndimensions);
+	ptr += sizeof(Oid) * header.ndimensions;
+
+	for (i = 0; i < histogram->nbuckets; i++)
+	{
+		MVBucket   *bucket = &histogram->buckets[i];
+
+		memcpy(&bucket->frequency, ptr, sizeof(double));
+		ptr += sizeof(double);
+
+		bucket->min = (Datum *) palloc(sizeof(Datum) * header.ndimensions);
+		bucket->max = (Datum *) palloc(sizeof(Datum) * header.ndimensions);
+
+		for (dim = 0; dim < header.ndimensions; dim++)
+		{
+			bool		isnull;
+
+			bucket->min[dim] = datumRestore(&ptr, &isnull);
+			Assert(!isnull);
+
+			bucket->max[dim] = datumRestore(&ptr, &isnull);
+			Assert(!isnull);
+		}
+	}
+
+	Assert(ptr == endptr);
+
+	return histogram;
+}
+
+/*
+ * pg_histogram_in		- input routine for type pg_histogram.
+ *
+ * pg_histogram is real enough to be a table column, but it has no operations
+ * of its own, and disallows input too
+ */
+Datum
+pg_histogram_in(PG_FUNCTION_ARGS)
+{
+	/*
+	 * pg_histogram stores the data in binary form and parsing text input is
+	 * not needed, so disallow this.
+	 */
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("cannot accept a value of type %s", "pg_histogram")));
+
+	PG_RETURN_VOID();			/* keep compiler quiet */
+}
+
+/*
+ * pg_histogram_out		- output routine for type pg_histogram.
+ *
+ * Histograms are serialized into a bytea value, so we simply call byteaout()
+ * to serialize the value into text, just like for MCV lists.
+ */
+Datum
+pg_histogram_out(PG_FUNCTION_ARGS)
+{
+	return byteaout(fcinfo);
+}
+
+/*
+ * pg_histogram_recv		- binary input routine for type pg_histogram.
+ */
+Datum
+pg_histogram_recv(PG_FUNCTION_ARGS)
+{
+	ereport(ERROR,
+			(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+			 errmsg("cannot accept a value of type %s", "pg_histogram")));
+
+	PG_RETURN_VOID();			/* keep compiler quiet */
+}
+
+/*
+ * pg_histogram_send		- binary output routine for type pg_histogram.
+ *
+ * Histograms are serialized in a bytea value (although the type is named
+ * differently), so let's just send that.
+ */
+Datum
+pg_histogram_send(PG_FUNCTION_ARGS)
+{
+	return byteasend(fcinfo);
+}
+
+/*
+ * histogram_clauselist_selectivity
+ *		Return the selectivity estimate computed using a histogram.
+ *
+ * The clauses are all of the form (expr op Const) with op being one of the
+ * inequality operators and expr a column or expression covered by the
+ * histogram, so each of them is monotonic in that dimension.  Evaluating
+ * the operator on the lower and upper boundary of a bucket then tells us
+ * whether the bucket matches the clause fully (both boundaries match), not at
+ * all (neither matches) or only partially.  Partially matching buckets are
+ * assumed to satisfy STATS_HIST_PARTIAL_MATCH of the clause, and the results
+ * of clauses in different dimensions are combined as if the values were
+ * independent within the bucket.
+ *
+ * Rows with NULL values can't satisfy any of the clauses, so the sum of the
+ * matching bucket frequencies is scaled by the fraction of non-NULL rows.
+ */
+Selectivity
+histogram_clauselist_selectivity(PlannerInfo *root, StatisticExtInfo *stat,
+								 List *clauses, int varRelid,
+								 JoinType jointype, SpecialJoinInfo *sjinfo,
+								 RelOptInfo *rel)
+{
+	int			i;
+	ListCell   *l;
+	MVHistogram *histogram;
+	double	   *matches;
+	Selectivity s = 0.0;
+
+	/* load the histogram stored in the statistics object */
+	histogram = statext_histogram_load(stat->statOid);
+
+	/* fraction of each bucket matching all the clauses so far */
+	matches = (double *) palloc(sizeof(double) * histogram->nbuckets);
+	for (i = 0; i < histogram->nbuckets; i++)
+		matches[i] = 1.0;
+
+	foreach(l, clauses)
+	{
+		Node	   *clause = (Node *) lfirst(l);
+		OpExpr	   *expr;
+		FmgrInfo	opproc;
+		Node	   *clause_expr;
+		Const	   *cst;
+		bool		expronleft;
+		Oid			collid;
+		int			idx;
+
+		/* if it's a RestrictInfo, then extract the clause */
+		if (IsA(clause, RestrictInfo))
+			clause = (Node *) ((RestrictInfo *) clause)->clause;
+
+		/* enforced by statext_histogram_clauselist_selectivity */
+		Assert(is_opclause(clause));
+		expr = (OpExpr *) clause;
+
+		if (!examine_opclause_args(expr, &clause_expr, &cst, &expronleft))
+			elog(ERROR, "unexpected clause in histogram estimation");
+
+		/* strict operators never match a NULL constant */
+		if (cst->constisnull)
+		{
+			for (i = 0; i < histogram->nbuckets; i++)
+				matches[i] = 0.0;
+			break;
+		}
+
+		fmgr_info(get_opcode(expr->opno), &opproc);
+
+		/* match the column or expression to a dimension of the statistic */
+		idx = statext_histogram_dimension(stat, clause_expr);
+		if (idx < 0)
+			elog(ERROR, "unexpected clause in histogram estimation");
+
+		/*
+		 * As with MCV lists, we rely on the statistics being reset on a type
+		 * (or collation) change, so using the clause's collation is OK.  Type
+		 * changes are not allowed for columns used in expressions at all.
+		 */
+		collid = exprCollation(clause_expr);
+
+		for (i = 0; i < histogram->nbuckets; i++)
+		{
+			MVBucket   *bucket = &histogram->buckets[i];
+			bool		minmatch,
+						maxmatch;
+
+			/* skip buckets already ruled out by preceding clauses */
+			if (matches[i] == 0.0)
+				continue;
+
+			if (expronleft)
+			{
+				minmatch = DatumGetBool(FunctionCall2Coll(&opproc,
+														  collid,
+														  bucket->min[idx],
+														  cst->constvalue));
+				maxmatch = DatumGetBool(FunctionCall2Coll(&opproc,
+														  collid,
+														  bucket->max[idx],
+														  cst->constvalue));
+			}
+			else
+			{
+				minmatch = DatumGetBool(FunctionCall2Coll(&opproc,
+														  collid,
+														  cst->constvalue,
+														  bucket->min[idx]));
+				maxmatch = DatumGetBool(FunctionCall2Coll(&opproc,
+														  collid,
+														  cst->constvalue,
+														  bucket->max[idx]));
+			}
+
+			if (!minmatch && !maxmatch)
+				matches[i] = 0.0;
+			else if (!minmatch || !maxmatch)
+				matches[i] *= STATS_HIST_PARTIAL_MATCH;
+		}
+	}
+
+	/* sum frequencies of the matching parts of the buckets */
+	for (i = 0; i < histogram->nbuckets; i++)
+		s += matches[i] * histogram->buckets[i].frequency;
+
+	pfree(matches);
+
+	s *= (1.0 - histogram->nullfrac);
+	CLAMP_PROBABILITY(s);
+
+	return s;
+}
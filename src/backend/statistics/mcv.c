@@ -72,8 +72,6 @@
 	 ((ndims) * sizeof(DimensionInfo)) + \
 	 ((nitems) * ITEM_SIZE(ndims)))
 
-static MultiSortSupport build_mss(VacAttrStats **stats, int numattrs);
-
 static SortItem *build_distinct_groups(int numrows, SortItem *items,
 									   MultiSortSupport mss, int *ndistinct);
 
@@ -347,7 +345,7 @@ statext_mcv_build(int numrows, HeapTuple *rows, Bitmapset *attrs,
  * build_mss
  *	build MultiSortSupport for the attributes passed in attrs
  */
-static MultiSortSupport
+MultiSortSupport
 build_mss(VacAttrStats **stats, int numattrs)
 {
 	int			i;
@@ -555,6 +555,17 @@ FindLockCycleRecurseMember(PGPROC *checkProc,
 	int			numLockModes,
 				lm;
 
+	/*
+	 * Relation extension and page locks are never held while waiting for
+	 * another heavyweight lock, so they cannot be part of a real deadlock
+	 * cycle.  They do conflict among lock group members, though (see
+	 * LockCheckConflicts), and following those edges would make a group
+	 * waiting on itself look like a deadlock.
+	 */
+	if (LOCK_LOCKTAG(*lock) == LOCKTAG_RELATION_EXTEND ||
+		LOCK_LOCKTAG(*lock) == LOCKTAG_PAGE)
+		return false;
+
 	lockMethodTable = GetLocksMethodTable(lock);
 	numLockModes = lockMethodTable->numLockModes;
 	conflictMask = lockMethodTable->conflictTab[checkProc->waitLockMode];
@@ -72,6 +72,17 @@
  *
  * This protects us against the problem from above as nobody can release too
  *	  quick, before we're queued, since after Phase 2 we're already queued.
+ *
+ * Between Phase 1 and Phase 2 we may spin for a while, polling the lock with
+ * exponential backoff, before paying for a semaphore sleep and wakeup.  On
+ * hosts with many cores most LWLocks are held for far less time than a
+ * process switch takes, so a short spin usually wins; how long we spin
+ * adapts to how often spinning has recently paid off (see LWLockSpin).
+ *
+ * Because a woken waiter has to compete for the lock again, a stream of
+ * newly arriving lockers can starve it.  With lwlock_fair_handoff enabled, a
+ * backend that finds waiters already queued neither spins nor tries to
+ * barge in Phase 1, but queues up behind them.
  * -------------------------------------------------------------------------
  */
 #include "postgres.h"
@@ -79,12 +90,15 @@
 #include "miscadmin.h"
 #include "pgstat.h"
 #include "pg_trace.h"
+#include "portability/instr_time.h"
 #include "postmaster/postmaster.h"
 #include "replication/slot.h"
 #include "storage/ipc.h"
 #include "storage/predicate.h"
 #include "storage/proc.h"
 #include "storage/proclist.h"
+#include "storage/s_lock.h"
+#include "storage/shmem.h"
 #include "storage/spin.h"
 #include "utils/memutils.h"
 
@@ -137,6 +151,7 @@ typedef struct LWLockHandle
 {
 	LWLock	   *lock;
 	LWLockMode	mode;
+	instr_time	acquired;		/* when acquired, if track_lwlock_stats */
 } LWLockHandle;
 
 static int	num_held_lwlocks = 0;
@@ -157,11 +172,44 @@ NamedLWLockTranche *NamedLWLockTrancheArray = NULL;
 
 static bool lock_named_request_allowed = true;
 
+/* GUC variables */
+int			lwlock_spin_limit = 50;
+bool		lwlock_fair_handoff = false;
+bool		track_lwlock_stats = false;
+
+/*
+ * Number of polls LWLockSpin currently allows itself, adapted between
+ * MIN_LWLOCK_SPINS and lwlock_spin_limit.  Between polls we wait an
+ * exponentially growing number of spin-delay instructions, up to
+ * MAX_LWLOCK_SPIN_DELAY.
+ */
+#define MIN_LWLOCK_SPINS		4
+#define MAX_LWLOCK_SPIN_DELAY	32
+
+static int	lwlock_spin_budget = MIN_LWLOCK_SPINS;
+
+/*
+ * Per-tranche counters, kept separately for every PGPROC so that each set is
+ * only ever written by its owning backend and no atomics are needed.  All
+ * tranches allocated by LWLockNewTrancheId share the last slot.  Backends
+ * that have no PGPROC don't collect stats.
+ */
+static LWLockTrancheStats *LWLockStatsArray = NULL;
+
+#define LWLockStatsSlot(tranche) \
+	((tranche) < LWTRANCHE_FIRST_USER_DEFINED ? (tranche) : \
+	 LWTRANCHE_FIRST_USER_DEFINED)
+#define MyLWLockStats(tranche) \
+	(&LWLockStatsArray[MyProc->pgprocno * NUM_LWLOCK_STATS_TRANCHES + \
+					   LWLockStatsSlot(tranche)])
+
 static void InitializeLWLocks(void);
 static void RegisterLWLockTranches(void);
 
 static inline void LWLockReportWaitStart(LWLock *lock);
 static inline void LWLockReportWaitEnd(void);
+static inline void LWLockRememberHeld(LWLock *lock, LWLockMode mode,
+									  instr_time *waitStart);
 
 #ifdef LWLOCK_STATS
 typedef struct lwlock_stats_key
@@ -523,6 +571,13 @@ RegisterLWLockTranches(void)
 	LWLockRegisterTranche(LWTRANCHE_PARALLEL_APPEND, "parallel_append");
 	LWLockRegisterTranche(LWTRANCHE_PARALLEL_HASH_JOIN, "parallel_hash_join");
 	LWLockRegisterTranche(LWTRANCHE_SXACT, "serializable_xact");
+	LWLockRegisterTranche(LWTRANCHE_PGSTATS_DSA, "pgstats_dsa");
+	LWLockRegisterTranche(LWTRANCHE_PGSTATS_DB_HASH, "pgstats_db_hash");
+	LWLockRegisterTranche(LWTRANCHE_PGSTATS_TABLE_HASH,
+						  "pgstats_table_hash");
+	LWLockRegisterTranche(LWTRANCHE_CARDINALITY_FEEDBACK,
+						  "cardinality_feedback");
+	LWLockRegisterTranche(LWTRANCHE_COST_CALIBRATION, "cost_calibration");
 
 	/* Register named tranches. */
 	for (i = 0; i < NamedLWLockTrancheRequests; i++)
@@ -541,6 +596,64 @@ InitLWLockAccess(void)
 #endif
 }
 
+/*
+ * Compute shmem space needed for the per-tranche LWLock statistics.
+ */
+Size
+LWLockStatsShmemSize(void)
+{
+	Size		size;
+
+	size = mul_size(add_size(MaxBackends, NUM_AUXILIARY_PROCS),
+					NUM_LWLOCK_STATS_TRANCHES);
+	return mul_size(size, sizeof(LWLockTrancheStats));
+}
+
+/*
+ * Allocate and initialize the per-tranche LWLock statistics.
+ */
+void
+LWLockStatsShmemInit(void)
+{
+	bool		found;
+
+	LWLockStatsArray = (LWLockTrancheStats *)
+		ShmemInitStruct("LWLock Tranche Stats", LWLockStatsShmemSize(),
+						&found);
+	if (!found)
+		MemSet(LWLockStatsArray, 0, LWLockStatsShmemSize());
+}
+
+/*
+ * LWLockGetTrancheStats - sum up the statistics of one tranche slot
+ *
+ * slot is a tranche ID below LWTRANCHE_FIRST_USER_DEFINED, or
+ * LWTRANCHE_FIRST_USER_DEFINED for the combined dynamically allocated
+ * tranches.  Counters are read without locking, so a concurrent update may
+ * or may not be included.
+ */
+void
+LWLockGetTrancheStats(int slot, LWLockTrancheStats *stats)
+{
+	int			nprocs = MaxBackends + NUM_AUXILIARY_PROCS;
+	int			i;
+
+	Assert(slot >= 0 && slot < NUM_LWLOCK_STATS_TRANCHES);
+
+	MemSet(stats, 0, sizeof(LWLockTrancheStats));
+	for (i = 0; i < nprocs; i++)
+	{
+		volatile LWLockTrancheStats *procstats;
+
+		procstats = &LWLockStatsArray[i * NUM_LWLOCK_STATS_TRANCHES + slot];
+		stats->acquires += procstats->acquires;
+		stats->contended += procstats->contended;
+		stats->wait_time += procstats->wait_time;
+		stats->max_hold_time = Max(stats->max_hold_time,
+								   procstats->max_hold_time);
+	}
+}
+
 /*
  * GetNamedLWLockTranche - returns the base address of LWLock from the
  *		specified tranche.
@@ -1111,6 +1224,90 @@ LWLockDequeueSelf(LWLock *lock)
 #endif
 }
 
+/*
+ * LWLockSpin - poll a contended lock for a while before going to sleep
+ *
+ * Returns true if we got the lock.  Polls test the lock state with a plain
+ * read and only try the atomic acquisition once the lock looks free, so
+ * that spinners don't keep pulling the cache line away from the holder.
+ *
+ * The number of polls adapts per backend, in the same spirit as
+ * spins_per_delay in s_lock.c: it doubles whenever spinning gets us the
+ * lock and halves whenever it doesn't, so that locks whose holders sleep
+ * while holding them (e.g. WALWriteLock across an fsync) don't burn CPU.
+ */
+static bool
+LWLockSpin(LWLock *lock, LWLockMode mode)
+{
+	uint32		busy_mask;
+	int			budget;
+	int			delay = 1;
+	int			spins;
+
+	/* Spinning is pointless if nobody else can release the lock */
+	if (lwlock_spin_limit <= 0 || !IsUnderPostmaster)
+		return false;
+
+	busy_mask = (mode == LW_EXCLUSIVE) ? LW_LOCK_MASK : LW_VAL_EXCLUSIVE;
+	budget = Min(lwlock_spin_budget, lwlock_spin_limit);
+
+	for (spins = 0; spins < budget; spins++)
+	{
+		uint32		state = pg_atomic_read_u32(&lock->state);
+		int			i;
+
+		/* Queued waiters get the lock first when handoff is fair */
+		if (lwlock_fair_handoff && (state & LW_FLAG_HAS_WAITERS))
+			break;
+
+		if ((state & busy_mask) == 0 && !LWLockAttemptLock(lock, mode))
+		{
+			lwlock_spin_budget = Min(budget * 2, lwlock_spin_limit);
+			return true;
+		}
+
+		for (i = 0; i < delay; i++)
+			SPIN_DELAY();
+		delay = Min(delay * 2, MAX_LWLOCK_SPIN_DELAY);
+	}
+
+	lwlock_spin_budget = Max(budget / 2, MIN_LWLOCK_SPINS);
+	return false;
+}
+
+/*
+ * LWLockRememberHeld - add lock to the list of locks held by this backend
+ *
+ * Also counts the acquisition in the tranche statistics, if enabled.
+ * waitStart is the time we first found the lock busy, or NULL if we got it
+ * without contention.
+ */
+static inline void
+LWLockRememberHeld(LWLock *lock, LWLockMode mode, instr_time *waitStart)
+{
+	LWLockHandle *handle = &held_lwlocks[num_held_lwlocks++];
+
+	handle->lock = lock;
+	handle->mode = mode;
+	INSTR_TIME_SET_ZERO(handle->acquired);
+
+	if (track_lwlock_stats && MyProc != NULL && LWLockStatsArray != NULL)
+	{
+		LWLockTrancheStats *stats = MyLWLockStats(lock->tranche);
+
+		INSTR_TIME_SET_CURRENT(handle->acquired);
+		stats->acquires++;
+		if (waitStart != NULL && !INSTR_TIME_IS_ZERO(*waitStart))
+		{
+			instr_time	waited = handle->acquired;
+
+			INSTR_TIME_SUBTRACT(waited, *waitStart);
+			stats->contended++;
+			stats->wait_time += INSTR_TIME_GET_MICROSEC(waited);
+		}
+	}
+}
+
 /*
  * LWLockAcquire - acquire a lightweight lock in the specified mode
  *
@@ -1125,6 +1322,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	PGPROC	   *proc = MyProc;
 	bool		result = true;
 	int			extraWaits = 0;
+	instr_time	waitStart;
 #ifdef LWLOCK_STATS
 	lwlock_stats *lwstats;
 
@@ -1135,6 +1333,8 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 	PRINT_LWDEBUG("LWLockAcquire", lock, mode);
 
+	INSTR_TIME_SET_ZERO(waitStart);
+
 #ifdef LWLOCK_STATS
 	/* Count lock acquisition attempts */
 	if (mode == LW_EXCLUSIVE)
@@ -1183,9 +1383,14 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 
 		/*
 		 * Try to grab the lock the first time, we're not in the waitqueue
-		 * yet/anymore.
+		 * yet/anymore.  In fair handoff mode, a newly arriving backend
+		 * doesn't barge in ahead of backends already waiting.
 		 */
-		mustwait = LWLockAttemptLock(lock, mode);
+		if (result && lwlock_fair_handoff &&
+			(pg_atomic_read_u32(&lock->state) & LW_FLAG_HAS_WAITERS))
+			mustwait = true;
+		else
+			mustwait = LWLockAttemptLock(lock, mode);
 
 		if (!mustwait)
 		{
@@ -1193,6 +1398,16 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 			break;				/* got the lock */
 		}
 
+		if (track_lwlock_stats && INSTR_TIME_IS_ZERO(waitStart))
+			INSTR_TIME_SET_CURRENT(waitStart);
+
+		/* Spin for a bit, unless we've already slept on this lock */
+		if (result && LWLockSpin(lock, mode))
+		{
+			LOG_LWDEBUG("LWLockAcquire", lock, "acquired after spinning");
+			break;
+		}
+
 		/*
 		 * Ok, at this point we couldn't grab the lock on the first try. We
 		 * cannot simply queue ourselves to the end of the list and wait to be
@@ -1272,8 +1487,7 @@ LWLockAcquire(LWLock *lock, LWLockMode mode)
 	TRACE_POSTGRESQL_LWLOCK_ACQUIRE(T_NAME(lock), mode);
 
 	/* Add lock to list of locks held by this backend */
-	held_lwlocks[num_held_lwlocks].lock = lock;
-	held_lwlocks[num_held_lwlocks++].mode = mode;
+	LWLockRememberHeld(lock, mode, &waitStart);
 
 	/*
 	 * Fix the process wait semaphore's count for any absorbed wakeups.
@@ -1325,8 +1539,7 @@ LWLockConditionalAcquire(LWLock *lock, LWLockMode mode)
 	else
 	{
 		/* Add lock to list of locks held by this backend */
-		held_lwlocks[num_held_lwlocks].lock = lock;
-		held_lwlocks[num_held_lwlocks++].mode = mode;
+		LWLockRememberHeld(lock, mode, NULL);
 		TRACE_POSTGRESQL_LWLOCK_CONDACQUIRE(T_NAME(lock), mode);
 	}
 	return !mustwait;
@@ -1453,8 +1666,7 @@ LWLockAcquireOrWait(LWLock *lock, LWLockMode mode)
 	{
 		LOG_LWDEBUG("LWLockAcquireOrWait", lock, "succeeded");
 		/* Add lock to list of locks held by this backend */
-		held_lwlocks[num_held_lwlocks].lock = lock;
-		held_lwlocks[num_held_lwlocks++].mode = mode;
+		LWLockRememberHeld(lock, mode, NULL);
 		TRACE_POSTGRESQL_LWLOCK_ACQUIRE_OR_WAIT(T_NAME(lock), mode);
 	}
 
@@ -1744,6 +1956,21 @@ LWLockRelease(LWLock *lock)
 
 	mode = held_lwlocks[i].mode;
 
+	/* Track the longest hold time, if we noted when we acquired the lock */
+	if (!INSTR_TIME_IS_ZERO(held_lwlocks[i].acquired) &&
+		MyProc != NULL && LWLockStatsArray != NULL)
+	{
+		LWLockTrancheStats *stats = MyLWLockStats(lock->tranche);
+		instr_time	held;
+		uint64		held_us;
+
+		INSTR_TIME_SET_CURRENT(held);
+		INSTR_TIME_SUBTRACT(held, held_lwlocks[i].acquired);
+		held_us = INSTR_TIME_GET_MICROSEC(held);
+		if (held_us > stats->max_hold_time)
+			stats->max_hold_time = held_us;
+	}
+
 	num_held_lwlocks--;
 	for (; i < num_held_lwlocks; i++)
 		held_lwlocks[i] = held_lwlocks[i + 1];
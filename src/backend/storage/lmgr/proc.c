@@ -119,6 +119,12 @@ ProcGlobalShmemSize(void)
 	size = add_size(size, mul_size(NUM_AUXILIARY_PROCS, sizeof(PGXACT)));
 	size = add_size(size, mul_size(max_prepared_xacts, sizeof(PGXACT)));
 
+	/* fast-path lock arrays, one per PGPROC */
+	size = add_size(size, mul_size(add_size(add_size(MaxBackends,
+													 NUM_AUXILIARY_PROCS),
+											max_prepared_xacts),
+								   FastPathLockShmemSize()));
+
 	return size;
 }
 
@@ -165,6 +171,7 @@ InitProcGlobal(void)
 {
 	PGPROC	   *procs;
 	PGXACT	   *pgxacts;
+	char	   *fpPtr;
 	int			i,
 				j;
 	bool		found;
@@ -217,10 +224,23 @@ InitProcGlobal(void)
 	MemSet(pgxacts, 0, TotalProcs * sizeof(PGXACT));
 	ProcGlobal->allPgXact = pgxacts;
 
+	/*
+	 * The fast-path lock arrays are sized at startup (see
+	 * InitializeFastPathLocks), so they can't be embedded in PGPROC; carve
+	 * them out of one allocation and point each PGPROC at its own piece.
+	 */
+	fpPtr = (char *) ShmemAlloc(TotalProcs * FastPathLockShmemSize());
+	MemSet(fpPtr, 0, TotalProcs * FastPathLockShmemSize());
+
 	for (i = 0; i < TotalProcs; i++)
 	{
 		/* Common initialization for all PGPROCs, regardless of type. */
 
+		procs[i].fpLockBits = (uint64 *) fpPtr;
+		procs[i].fpRelId = (Oid *) (fpPtr +
+									MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64)));
+		fpPtr += FastPathLockShmemSize();
+
 		/*
 		 * Set up per-PGPROC semaphore, latch, and backendLock. Prepared xact
 		 * dummy PGPROCs don't need these though - they're never associated
@@ -39,6 +39,7 @@
 
 #include <sys/stat.h>
 
+#include "access/brin.h"
 #include "access/parallel.h"
 #include "access/printtup.h"
 #include "access/xact.h"
@@ -240,6 +241,7 @@ static char *tree_table_name;
 #define NONE							0
 #define MAX_OP_NUM						2
 #define MAX_NAME_LEN					30
+#define HW_WORD_LOOKAHEAD				8
 
 /*--------------------------------------------------------
  * Definitions for HW support check query cluster
@@ -476,6 +478,9 @@ struct HW_IR {
 	int filter_col;
 	int filter_op;
 	float filter_value;
+	// Block-skip list for the filter, from BRIN summaries (NULL if none)
+	TIDBitmap *filter_blocks;
+	double filter_page_num;
 	// Aggregation info
 	bool aggr_flag;
 	int aggr_op;	
@@ -623,6 +628,8 @@ hw_ophashmap(char* str) {
 		return TREE;
 	else if (hw_strcmp(str, (char*)"madlib.forest_predict"))
 		return FOREST;
+	else
+		return NONE;
 }
 
 static int
@@ -768,7 +775,8 @@ extract_operation_info(char** word_array, int word_size, struct operation_info *
 						i += 2;
 						if (hw_strcmp(word_array[i], (char*)"ARRAY")){
 							arr_len = 0;
-							while ((!hw_strcmp(word_array[i + 1 + arr_len], (char*)"FROM")) & 
+							while ((i + 1 + arr_len < word_size) &
+								   (!hw_strcmp(word_array[i + 1 + arr_len], (char*)"FROM")) & 
 								   (!hw_strcmp(word_array[i + 1 + arr_len], (char*)"ARRAY"))){
 								arr_len++;
 							}
@@ -790,7 +798,8 @@ extract_operation_info(char** word_array, int word_size, struct operation_info *
 						
 						if (hw_strcmp(word_array[i], (char*)"ARRAY")){
 							arr_len = 0;
-							while ((!hw_strcmp(word_array[i + 1 + arr_len], (char*)"FROM")) &
+							while ((i + 1 + arr_len < word_size) &
+								   (!hw_strcmp(word_array[i + 1 + arr_len], (char*)"FROM")) &
 								   (!hw_strcmp(word_array[i + 1 + arr_len], (char*)"ARRAY"))){
 								arr_len++;
 							}
@@ -1779,6 +1788,92 @@ get_data_num(Oid table_oid, int table_size, double *page_num){
 	return total_data_num;
 }
 
+//////////////////////////////////////////////////////////////////
+// Block skipping functionality
+//////////////////////////////////////////////////////////////////
+
+// Build the block-skip list for a single-column filter (col <op> value)
+// from a BRIN index on the filter column.  The list is kept in hw_ir for
+// the device interface.  Nothing packs pages from it yet, so the HW cost
+// estimate is still charged for every page of the table.  Returns the
+// number of candidate pages and sets *blocks, or returns -1 with
+// *blocks = NULL if the table has no usable BRIN index or the value can't
+// be compared exactly.
+static double
+hw_filter_candidate_pages(Oid table_oid, AttrNumber filter_attno, int filter_op,
+						  float filter_value, TIDBitmap **blocks){
+	Relation table_rel;
+	StrategyNumber strategy;
+	Oid atttype;
+	Oid valtype;
+	Datum value;
+	BlockNumber nblocks;
+
+	*blocks = NULL;
+
+	switch (filter_op){
+		case LARGER:
+			strategy = BTGreaterStrategyNumber;
+			break;
+		case LARGERSAME:
+			strategy = BTGreaterEqualStrategyNumber;
+			break;
+		case SAME:
+			strategy = BTEqualStrategyNumber;
+			break;
+		case SMALLER:
+			strategy = BTLessStrategyNumber;
+			break;
+		case SMALLERSAME:
+			strategy = BTLessEqualStrategyNumber;
+			break;
+		default:
+			return -1;
+	}
+
+	if (!(table_rel = try_relation_open(table_oid, AccessShareLock))){
+		printf("hw_filter_candidate_pages - Oid error occured\n");
+		return -1;
+	}
+
+	// the filter value is parsed as float; compare it in the column's own
+	// type family, and only when that comparison is exact
+	atttype = TupleDescAttr(RelationGetDescr(table_rel), filter_attno - 1)->atttypid;
+	switch (atttype){
+		case FLOAT4OID:
+			valtype = FLOAT4OID;
+			value = Float4GetDatum(filter_value);
+			break;
+		case FLOAT8OID:
+			valtype = FLOAT8OID;
+			value = Float8GetDatum((float8) filter_value);
+			break;
+		case INT2OID:
+		case INT4OID:
+		case INT8OID:
+			if (filter_value != rint(filter_value)){
+				relation_close(table_rel, AccessShareLock);
+				return -1;
+			}
+			valtype = INT8OID;
+			value = Int64GetDatum((int64) filter_value);
+			break;
+		default:
+			relation_close(table_rel, AccessShareLock);
+			return -1;
+	}
+
+	nblocks = brin_candidate_blocks(table_rel, filter_attno, strategy, value, valtype,
+									ActiveSnapshotSet() ? GetActiveSnapshot() : NULL,
+									blocks);
+	relation_close(table_rel, AccessShareLock);
+
+	if (nblocks == InvalidBlockNumber){
+		return -1;
+	}
+	return (double) nblocks;
+}
+
 //////////////////////////////////////////////////////////////////
 // HW cost model functionality
 //////////////////////////////////////////////////////////////////
@@ -2168,16 +2263,22 @@ sw_stack_for_hw(const char* query_string, List* querytrees){
 	strcpy(query_str, query_string);
 
 	int word_size = 0;
-	char** word_array = (char**)malloc(sizeof(char *) * (query_length + 1));
+	// extract_operation_info() looks up to HW_WORD_LOOKAHEAD words ahead and
+	// copies words into MAX_NAME_LEN buffers: clip the words and pad the end
+	char** word_array = (char**)malloc(sizeof(char *) * (query_length + 1 + HW_WORD_LOOKAHEAD));
 
     char* word_tmp;
     word_tmp = strtok(query_str, " ,()[];\n'");
 	while (word_tmp != NULL) {
-        word_array[word_size] = (char *)malloc(sizeof(char) * 25);
-		strcpy(word_array[word_size], word_tmp);
+        word_array[word_size] = (char *)malloc(sizeof(char) * MAX_NAME_LEN);
+		strncpy(word_array[word_size], word_tmp, MAX_NAME_LEN - 1);
+		word_array[word_size][MAX_NAME_LEN - 1] = '\0';
 		word_size++;
 		word_tmp = strtok(NULL, " ,()[];\n'");
 	}
+	for (int pad = 0 ; pad < HW_WORD_LOOKAHEAD ; pad++){
+		word_array[word_size + pad] = (char*)"";
+	}
 	// extra check for train phase (tree)
 	for (int i = 0 ; i < word_size ; i++){
 		if (hw_strcmp(word_array[i], (char*)"madlib.tree_train")){
@@ -2187,6 +2288,11 @@ sw_stack_for_hw(const char* query_string, List* querytrees){
 		}
 	}
 
+	// forget the previous query's filter and block-skip list
+	hw_ir.filter_flag = false;
+	hw_ir.filter_blocks = NULL;
+	hw_ir.filter_page_num = 0;
+
 	// extrack HW operation information
 	struct operation_info op_info;
 	init_operation_info(&op_info);
@@ -2318,7 +2424,7 @@ sw_stack_for_hw(const char* query_string, List* querytrees){
 			if (op_info.filter_flag){
 				printf("filter phase\n");
 				if (hw_strcmp(op_info.filter_table_name, op_info.data_table_name)){ // data table = filter table
-					int filter_col_num;
+					int filter_col_num = -1;
 					for (int now_filter_col = 0 ; now_filter_col < rtable_colnum[0] ; now_filter_col++){
 						if (hw_strcmp(op_info.filter_col_name, rtable_colname[0][now_filter_col])){
 							filter_col_num = now_filter_col;
@@ -2326,6 +2432,17 @@ sw_stack_for_hw(const char* query_string, List* querytrees){
 						}
 					}
 					printf("filter col num: %d\n", filter_col_num);
+
+					hw_ir.filter_flag = true;
+					hw_ir.filter_table = 0;
+					hw_ir.filter_col = filter_col_num;
+					hw_ir.filter_op = op_info.filter_operation;
+					hw_ir.filter_value = op_info.filter_value;
+					if (filter_col_num >= 0){
+						hw_ir.filter_page_num = hw_filter_candidate_pages(rtable_relid[0], filter_col_num + 1,
+																		  op_info.filter_operation, op_info.filter_value,
+																		  &hw_ir.filter_blocks);
+					}
 				} else{
 					printf("indefined filter operation");
 				}
@@ -6424,6 +6541,19 @@ ProcessInterrupts(void)
 
 	}
 
+	if (IdleStatsUpdateTimeoutPending)
+	{
+		IdleStatsUpdateTimeoutPending = false;
+
+		/*
+		 * Flush the statistics that couldn't be flushed when we went idle.
+		 * If we are no longer idle, the next idle period will take care of
+		 * them.
+		 */
+		if (DoingCommandRead && !IsTransactionOrTransactionBlock())
+			pgstat_report_stat(true);
+	}
+
 	if (ParallelMessagePending)
 		HandleParallelMessages();
 }
@@ -7001,6 +7131,7 @@ PostgresMain(int argc, char *argv[],
 	sigjmp_buf	local_sigjmp_buf;
 	volatile bool send_ready_for_query = true;
 	bool		disable_idle_in_transaction_timeout = false;
+	bool		disable_idle_stats_update_timeout = false;
 
 	/* Initialize startup process environment if necessary. */
 	if (!IsUnderPostmaster)
@@ -7443,6 +7574,8 @@ PostgresMain(int argc, char *argv[],
 			}
 			else
 			{
+				long		stats_timeout;
+
 				/* Send out notify signals and transmit self-notifies */
 				ProcessCompletedNotifies();
 
@@ -7455,7 +7588,17 @@ PostgresMain(int argc, char *argv[],
 				if (notifyInterruptPending)
 					ProcessNotifyInterrupt();
 
-				pgstat_report_stat(false);
+				/*
+				 * Flush our statistics.  If some of them had to be left
+				 * pending, arrange to retry while we sit idle.
+				 */
+				stats_timeout = pgstat_report_stat(false);
+				if (stats_timeout > 0)
+				{
+					disable_idle_stats_update_timeout = true;
+					enable_timeout_after(IDLE_STATS_UPDATE_TIMEOUT,
+										 stats_timeout);
+				}
 
 				set_ps_display("idle", false);
 				pgstat_report_activity(STATE_IDLE, NULL);
@@ -7648,6 +7791,13 @@ PostgresMain(int argc, char *argv[],
 			disable_idle_in_transaction_timeout = false;
 		}
 
+		/* Likewise for the idle statistics flush timeout */
+		if (disable_idle_stats_update_timeout)
+		{
+			disable_timeout(IDLE_STATS_UPDATE_TIMEOUT, false);
+			disable_idle_stats_update_timeout = false;
+		}
+
 		/*
 		 * (5) disable async signal conditions again.
 		 *
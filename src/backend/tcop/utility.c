@@ -1728,7 +1728,30 @@ ProcessUtilitySlow(ParseState *pstate,
 				break;
 
 			case T_CreateStatsStmt:
-				address = CreateStatistics((CreateStatsStmt *) parsetree);
+				{
+					Oid			relid;
+					CreateStatsStmt *stmt = (CreateStatsStmt *) parsetree;
+					RangeVar   *rel = (RangeVar *) linitial(stmt->relations);
+
+					if (!IsA(rel, RangeVar))
+						ereport(ERROR,
+								(errcode(ERRCODE_FEATURE_NOT_SUPPORTED),
+								 errmsg("only a single relation is allowed in CREATE STATISTICS")));
+
+					/*
+					 * Take the lock CreateStatistics needs (see there) before
+					 * parse analysis, so that the expressions are transformed
+					 * for the same relation the statistics are created on.
+					 */
+					relid = RangeVarGetRelid(rel, ShareUpdateExclusiveLock,
+											 false);
+
+					/* Run parse analysis ... */
+					stmt = transformStatsStmt(relid, stmt, queryString);
+
+					/* ... and do it */
+					address = CreateStatistics(stmt);
+				}
 				break;
 
 			case T_AlterCollationStmt:
@@ -17,6 +17,7 @@
 #include "catalog/pg_type.h"
 #include "funcapi.h"
 #include "miscadmin.h"
+#include "postmaster/proxy.h"
 #include "storage/predicate_internals.h"
 #include "utils/array.h"
 #include "utils/builtins.h"
@@ -686,6 +687,7 @@ pg_advisory_lock_int8(PG_FUNCTION_ARGS)
 	LOCKTAG		tag;
 
 	PreventAdvisoryLocksInParallelMode();
+	SessionPoolPin("advisory lock");
 	SET_LOCKTAG_INT64(tag, key);
 
 	(void) LockAcquire(&tag, ExclusiveLock, true, false);
@@ -721,6 +723,7 @@ pg_advisory_lock_shared_int8(PG_FUNCTION_ARGS)
 	LOCKTAG		tag;
 
 	PreventAdvisoryLocksInParallelMode();
+	SessionPoolPin("advisory lock");
 	SET_LOCKTAG_INT64(tag, key);
 
 	(void) LockAcquire(&tag, ShareLock, true, false);
@@ -759,6 +762,7 @@ pg_try_advisory_lock_int8(PG_FUNCTION_ARGS)
 	LockAcquireResult res;
 
 	PreventAdvisoryLocksInParallelMode();
+	SessionPoolPin("advisory lock");
 	SET_LOCKTAG_INT64(tag, key);
 
 	res = LockAcquire(&tag, ExclusiveLock, true, true);
@@ -800,6 +804,7 @@ pg_try_advisory_lock_shared_int8(PG_FUNCTION_ARGS)
 	LockAcquireResult res;
 
 	PreventAdvisoryLocksInParallelMode();
+	SessionPoolPin("advisory lock");
 	SET_LOCKTAG_INT64(tag, key);
 
 	res = LockAcquire(&tag, ShareLock, true, true);
@@ -879,6 +884,7 @@ pg_advisory_lock_int4(PG_FUNCTION_ARGS)
 	LOCKTAG		tag;
 
 	PreventAdvisoryLocksInParallelMode();
+	SessionPoolPin("advisory lock");
 	SET_LOCKTAG_INT32(tag, key1, key2);
 
 	(void) LockAcquire(&tag, ExclusiveLock, true, false);
@@ -916,6 +922,7 @@ pg_advisory_lock_shared_int4(PG_FUNCTION_ARGS)
 	LOCKTAG		tag;
 
 	PreventAdvisoryLocksInParallelMode();
+	SessionPoolPin("advisory lock");
 	SET_LOCKTAG_INT32(tag, key1, key2);
 
 	(void) LockAcquire(&tag, ShareLock, true, false);
@@ -956,6 +963,7 @@ pg_try_advisory_lock_int4(PG_FUNCTION_ARGS)
 	LockAcquireResult res;
 
 	PreventAdvisoryLocksInParallelMode();
+	SessionPoolPin("advisory lock");
 	SET_LOCKTAG_INT32(tag, key1, key2);
 
 	res = LockAcquire(&tag, ExclusiveLock, true, true);
@@ -999,6 +1007,7 @@ pg_try_advisory_lock_shared_int4(PG_FUNCTION_ARGS)
 	LockAcquireResult res;
 
 	PreventAdvisoryLocksInParallelMode();
+	SessionPoolPin("advisory lock");
 	SET_LOCKTAG_INT32(tag, key1, key2);
 
 	res = LockAcquire(&tag, ShareLock, true, true);
@@ -1510,6 +1510,7 @@ pg_get_statisticsobj_worker(Oid statextid, bool missing_ok)
 	bool		ndistinct_enabled;
 	bool		dependencies_enabled;
 	bool		mcv_enabled;
+	bool		histogram_enabled;
 	int			i;
 
 	statexttup = SearchSysCache1(STATEXTOID, ObjectIdGetDatum(statextid));
@@ -1546,6 +1547,7 @@ pg_get_statisticsobj_worker(Oid statextid, bool missing_ok)
 	ndistinct_enabled = false;
 	dependencies_enabled = false;
 	mcv_enabled = false;
+	histogram_enabled = false;
 
 	for (i = 0; i < ARR_DIMS(arr)[0]; i++)
 	{
@@ -1555,6 +1557,8 @@ pg_get_statisticsobj_worker(Oid statextid, bool missing_ok)
 			dependencies_enabled = true;
 		if (enabled[i] == STATS_EXT_MCV)
 			mcv_enabled = true;
+		if (enabled[i] == STATS_EXT_HISTOGRAM)
+			histogram_enabled = true;
 	}
 
 	/*
@@ -1562,9 +1566,11 @@ pg_get_statisticsobj_worker(Oid statextid, bool missing_ok)
 	 * to show which options are enabled.  We omit the types clause on purpose
 	 * when all options are enabled, so a pg_dump/pg_restore will create all
 	 * statistics types on a newer postgres version, if the statistics had all
-	 * options enabled on the original version.
+	 * options enabled on the original version.  Histograms are never built
+	 * by default, so they always have to be spelled out.
 	 */
-	if (!ndistinct_enabled || !dependencies_enabled || !mcv_enabled)
+	if (!ndistinct_enabled || !dependencies_enabled || !mcv_enabled ||
+		histogram_enabled)
 	{
 		bool		gotone = false;
 
@@ -1583,7 +1589,13 @@ pg_get_statisticsobj_worker(Oid statextid, bool missing_ok)
 		}
 
 		if (mcv_enabled)
+		{
 			appendStringInfo(&buf, "%smcv", gotone ? ", " : "");
+			gotone = true;
+		}
+
+		if (histogram_enabled)
+			appendStringInfo(&buf, "%shistogram", gotone ? ", " : "");
 
 		appendStringInfoChar(&buf, ')');
 	}
@@ -1603,6 +1615,26 @@ pg_get_statisticsobj_worker(Oid statextid, bool missing_ok)
 		appendStringInfoString(&buf, quote_identifier(attname));
 	}
 
+	/* the expressions come after the columns, deparsed as pg_get_expr does */
+	datum = SysCacheGetAttr(STATEXTOID, statexttup,
+							Anum_pg_statistic_ext_stxexprs, &isnull);
+	if (!isnull)
+	{
+		Node	   *exprs = stringToNode(TextDatumGetCString(datum));
+		List	   *context;
+
+		context = deparse_context_for(get_relation_name(statextrec->stxrelid),
+									  statextrec->stxrelid);
+
+		if (colno > 0)
+			appendStringInfoString(&buf, ", ");
+
+		appendStringInfoString(&buf,
+							   deparse_expression_pretty(exprs, context,
+														 false, false,
+														 PRETTYFLAG_INDENT, 0));
+	}
+
 	appendStringInfo(&buf, " FROM %s",
 					 generate_relation_name(statextrec->stxrelid, NIL));
 
@@ -74,6 +74,7 @@ static void ShutdownPostgres(int code, Datum arg);
 static void StatementTimeoutHandler(void);
 static void LockTimeoutHandler(void);
 static void IdleInTransactionSessionTimeoutHandler(void);
+static void IdleStatsUpdateTimeoutHandler(void);
 static bool ThereIsAtLeastOneRole(void);
 static void process_startup_options(Port *port, bool am_superuser);
 static void process_settings(Oid databaseid, Oid roleid);
@@ -502,7 +503,9 @@ pg_split_opts(char **argv, int *argcp, const char *optstr)
 }
 
 /*
- * Initialize MaxBackends value from config options.
+ * Initialize MaxBackends value from config options.  The number of fast-path
+ * lock groups per backend is settled here too, since it feeds into the size
+ * of the PGPROC shared memory.
  *
  * This must be called after modules have had the chance to register background
  * workers in shared_preload_libraries, and before shared memory size is
@@ -525,6 +528,9 @@ InitializeMaxBackends(void)
 	/* internal error because the values were all checked previously */
 	if (MaxBackends > MAX_BACKENDS)
 		elog(ERROR, "too many backends configured");
+
+	/* the fast-path lock area is sized along with the PGPROC array */
+	InitializeFastPathLocks();
 }
 
 /*
@@ -622,6 +628,8 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 		RegisterTimeout(LOCK_TIMEOUT, LockTimeoutHandler);
 		RegisterTimeout(IDLE_IN_TRANSACTION_SESSION_TIMEOUT,
 						IdleInTransactionSessionTimeoutHandler);
+		RegisterTimeout(IDLE_STATS_UPDATE_TIMEOUT,
+						IdleStatsUpdateTimeoutHandler);
 	}
 
 	/*
@@ -689,9 +697,10 @@ InitPostgres(const char *in_dbname, Oid dboid, const char *username,
 
 	/*
 	 * Set up process-exit callback to do pre-shutdown cleanup.  This is the
-	 * first before_shmem_exit callback we register; thus, this will be the
-	 * last thing we do before low-level modules like the buffer manager begin
-	 * to close down.  We need to have this in place before we begin our first
+	 * first before_shmem_exit callback we register apart from the one that
+	 * flushes pending statistics; thus, this will be nearly the last thing we
+	 * do before low-level modules like the buffer manager begin to close
+	 * down.  We need to have this in place before we begin our first
 	 * transaction --- if we fail during the initialization transaction, as is
 	 * entirely possible, we need the AbortTransaction call to clean up.
 	 */
@@ -1232,6 +1241,14 @@ IdleInTransactionSessionTimeoutHandler(void)
 	SetLatch(MyLatch);
 }
 
+static void
+IdleStatsUpdateTimeoutHandler(void)
+{
+	IdleStatsUpdateTimeoutPending = true;
+	InterruptPending = true;
+	SetLatch(MyLatch);
+}
+
 /*
  * Returns true if at least one role is defined in this database cluster.
  */
@@ -49,6 +49,8 @@
 #include "libpq/libpq.h"
 #include "libpq/pqformat.h"
 #include "miscadmin.h"
+#include "optimizer/cardfeedback.h"
+#include "optimizer/costcalib.h"
 #include "optimizer/cost.h"
 #include "optimizer/geqo.h"
 #include "optimizer/optimizer.h"
@@ -63,9 +65,11 @@
 #include "postmaster/bgworker_internals.h"
 #include "postmaster/bgwriter.h"
 #include "postmaster/postmaster.h"
+#include "postmaster/proxy.h"
 #include "postmaster/syslogger.h"
 #include "postmaster/walwriter.h"
 #include "replication/logicallauncher.h"
+#include "replication/reorderbuffer.h"
 #include "replication/slot.h"
 #include "replication/syncrep.h"
 #include "replication/walreceiver.h"
@@ -194,7 +198,6 @@ static bool check_max_wal_senders(int *newval, void **extra, GucSource source);
 static bool check_autovacuum_work_mem(int *newval, void **extra, GucSource source);
 static bool check_effective_io_concurrency(int *newval, void **extra, GucSource source);
 static void assign_effective_io_concurrency(int newval, void *extra);
-static void assign_pgstat_temp_directory(const char *newval, void *extra);
 static bool check_application_name(char **newval, void **extra, GucSource source);
 static void assign_application_name(const char *newval, void *extra);
 static bool check_cluster_name(char **newval, void **extra, GucSource source);
@@ -524,8 +527,6 @@ char	   *HbaFileName;
 char	   *IdentFileName;
 char	   *external_pid_file;
 
-char	   *pgstat_temp_directory;
-
 char	   *application_name;
 
 int			tcp_keepalives_idle;
@@ -910,6 +911,16 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_async_append", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of async append plans."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_async_append,
+		true,
+		NULL, NULL, NULL
+	},
 	{
 		{"enable_bitmapscan", PGC_USERSET, QUERY_TUNING_METHOD,
 			gettext_noop("Enables the planner's use of bitmap-scan plans."),
@@ -1052,6 +1063,39 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_resultcache", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables the planner's use of result caching."),
+			NULL,
+			GUC_EXPLAIN
+		},
+		&enable_resultcache,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_cardinality_feedback", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Enables learning selectivities from executed queries."),
+			gettext_noop("Queries run with row instrumentation record the "
+						 "selectivities they observe, and the planner uses "
+						 "them to correct its estimates for the same clauses."),
+			GUC_EXPLAIN
+		},
+		&enable_cardinality_feedback,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"enable_cost_calibration", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Enables fitting the planner cost constants to measured node times."),
+			gettext_noop("Queries run with timing and buffer instrumentation "
+						 "contribute samples to the fit, which is shown in "
+						 "the pg_cost_calibration view.")
+		},
+		&enable_cost_calibration,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Enables genetic query optimization."),
@@ -1063,6 +1107,18 @@ static struct config_bool ConfigureNamesBool[] =
 		true,
 		NULL, NULL, NULL
 	},
+	{
+		{"enable_dpccp", PGC_USERSET, QUERY_TUNING_METHOD,
+			gettext_noop("Enables join search by enumeration of connected subgraphs."),
+			gettext_noop("The planner then considers only the joins of sets "
+						 "of relations linked by join clauses, instead of "
+						 "all pairs of sets."),
+			GUC_EXPLAIN
+		},
+		&enable_dpccp,
+		false,
+		NULL, NULL, NULL
+	},
 	{
 		/* Not for general use --- used by SET SESSION AUTHORIZATION */
 		{"is_superuser", PGC_INTERNAL, UNGROUPED,
@@ -1407,6 +1463,25 @@ static struct config_bool ConfigureNamesBool[] =
 		false,
 		NULL, NULL, NULL
 	},
+	{
+		{"track_lwlock_stats", PGC_SUSET, STATS_COLLECTOR,
+			gettext_noop("Collects per-tranche statistics for lightweight lock contention."),
+			NULL
+		},
+		&track_lwlock_stats,
+		false,
+		NULL, NULL, NULL
+	},
+	{
+		{"lwlock_fair_handoff", PGC_SIGHUP, LOCK_MANAGEMENT,
+			gettext_noop("Makes lightweight lock acquirers queue behind existing waiters."),
+			gettext_noop("This prevents waiting processes from being starved by "
+						 "newly arriving ones, at some cost in throughput.")
+		},
+		&lwlock_fair_handoff,
+		false,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"update_process_title", PGC_SUSET, PROCESS_TITLE,
@@ -2018,6 +2093,26 @@ static struct config_int ConfigureNamesInt[] =
 		8, 1, INT_MAX,
 		NULL, NULL, NULL
 	},
+	{
+		{"greedy_join_threshold", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the threshold of FROM items beyond which the greedy join search is used."),
+			gettext_noop("Zero disables the greedy join search."),
+			GUC_EXPLAIN
+		},
+		&greedy_join_threshold,
+		0, 0, INT_MAX,
+		NULL, NULL, NULL
+	},
+	{
+		{"cardinality_feedback_max_entries", PGC_POSTMASTER, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the maximum number of clause lists whose "
+						 "observed selectivity is remembered."),
+			NULL
+		},
+		&cardinality_feedback_max_entries,
+		1000, 16, INT_MAX / 2,
+		NULL, NULL, NULL
+	},
 	{
 		{"geqo_threshold", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("Sets the threshold of FROM items beyond which GEQO is used."),
@@ -2183,6 +2278,36 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"connection_proxies", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the number of connection proxy processes."),
+			gettext_noop("Zero disables built-in connection pooling.")
+		},
+		&ConnectionProxies,
+		0, 0, MAX_CONNECTION_PROXIES,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"proxy_port", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the TCP port connection proxies listen on."),
+			NULL
+		},
+		&ProxyPortNumber,
+		6543, 1, 65535,
+		NULL, NULL, NULL
+	},
+
+	{
+		{"session_pool_size", PGC_SIGHUP, CONN_AUTH_SETTINGS,
+			gettext_noop("Sets the maximum number of backends each connection proxy keeps for one combination of connection parameters."),
+			NULL
+		},
+		&SessionPoolSize,
+		10, 1, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"unix_socket_permissions", PGC_POSTMASTER, CONN_AUTH_SETTINGS,
 			gettext_noop("Sets the access permissions of the Unix-domain socket."),
@@ -2251,6 +2376,19 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"logical_decoding_work_mem", PGC_USERSET, RESOURCES_MEM,
+			gettext_noop("Sets the maximum memory to be used for logical decoding."),
+			gettext_noop("This much memory can be used by each internal "
+						 "reorder buffer before spilling to disk or streaming "
+						 "the largest transaction."),
+			GUC_UNIT_KB
+		},
+		&logical_decoding_work_mem,
+		65536, 64, MAX_KILOBYTES,
+		NULL, NULL, NULL
+	},
+
 	/*
 	 * We use the hopefully-safely-small value of 100kB as the compiled-in
 	 * default for max_stack_depth.  InitializeGUCOptions will increase it if
@@ -2506,6 +2644,16 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"lwlock_spin_limit", PGC_SUSET, LOCK_MANAGEMENT,
+			gettext_noop("Sets the maximum number of times to poll a busy lightweight lock before sleeping."),
+			gettext_noop("Zero disables spinning.")
+		},
+		&lwlock_spin_limit,
+		50, 0, 10000,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"authentication_timeout", PGC_SIGHUP, CONN_AUTH_AUTH,
 			gettext_noop("Sets the maximum allowed time to complete client authentication."),
@@ -2821,6 +2969,18 @@ static struct config_int ConfigureNamesInt[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"max_parallel_apply_workers_per_subscription",
+			PGC_SIGHUP,
+			REPLICATION_SUBSCRIBERS,
+			gettext_noop("Maximum number of parallel apply workers per subscription."),
+			gettext_noop("Zero applies all transactions in the apply worker itself."),
+		},
+		&max_parallel_apply_workers_per_subscription,
+		0, 0, MAX_BACKENDS,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"log_rotation_age", PGC_SIGHUP, LOGGING_WHERE,
 			gettext_noop("Automatic log file rotation will occur after N minutes."),
@@ -2993,6 +3153,15 @@ static struct config_int ConfigureNamesInt[] =
 		3, 1, MAX_BACKENDS,
 		check_autovacuum_max_workers, NULL, NULL
 	},
+	{
+		{"autovacuum_max_parallel_workers", PGC_SIGHUP, AUTOVACUUM,
+			gettext_noop("Sets the maximum number of parallel workers an autovacuum worker can use for index vacuuming."),
+			gettext_noop("Zero disables parallel vacuum in autovacuum.")
+		},
+		&autovacuum_max_parallel_workers,
+		0, 0, MAX_PARALLEL_WORKER_LIMIT,
+		NULL, NULL, NULL
+	},
 
 	{
 		{"max_parallel_maintenance_workers", PGC_USERSET, RESOURCES_ASYNCHRONOUS,
@@ -3314,6 +3483,16 @@ static struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"cost_calibration_ridge", PGC_USERSET, QUERY_TUNING_COST,
+			gettext_noop("Sets the ridge penalty of the cost calibration fit."),
+			gettext_noop("Relative to the sum of squares of each cost term.")
+		},
+		&cost_calibration_ridge,
+		0.01, 0.0, 1000.0,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"cursor_tuple_fraction", PGC_USERSET, QUERY_TUNING_OTHER,
 			gettext_noop("Sets the planner's estimate of the fraction of "
@@ -3326,6 +3505,18 @@ static struct config_real ConfigureNamesReal[] =
 		NULL, NULL, NULL
 	},
 
+	{
+		{"cardinality_feedback_decay", PGC_USERSET, QUERY_TUNING_OTHER,
+			gettext_noop("Sets the weight of earlier observations in learned selectivities."),
+			gettext_noop("Each new observation of a clause list's selectivity "
+						 "is given a weight of one minus this value."),
+			GUC_EXPLAIN
+		},
+		&cardinality_feedback_decay,
+		0.5, 0.0, 1.0,
+		NULL, NULL, NULL
+	},
+
 	{
 		{"geqo_selection_bias", PGC_USERSET, QUERY_TUNING_GEQO,
 			gettext_noop("GEQO: selective pressure within the population."),
@@ -4072,17 +4263,6 @@ static struct config_string ConfigureNamesString[] =
 		NULL, NULL, NULL
 	},
 
-	{
-		{"stats_temp_directory", PGC_SIGHUP, STATS_COLLECTOR,
-			gettext_noop("Writes temporary statistics files to the specified directory."),
-			NULL,
-			GUC_SUPERUSER_ONLY
-		},
-		&pgstat_temp_directory,
-		PG_STAT_TMP_DIR,
-		check_canonical_path, assign_pgstat_temp_directory, NULL
-	},
-
 	{
 		{"synchronous_standby_names", PGC_SIGHUP, REPLICATION_MASTER,
 			gettext_noop("Number of synchronous standbys and list of names of potential synchronous ones."),
@@ -6938,6 +7118,15 @@ set_config_option(const char *name, const char *value,
 		changeVal = false;
 	}
 
+	/*
+	 * A session-level SET leaves state behind that later transactions of the
+	 * session depend on, so a pooled session must keep its backend from now
+	 * on.  Transaction characteristics are reset at commit anyway.
+	 */
+	if (changeVal && source == PGC_S_SESSION && action == GUC_ACTION_SET &&
+		strncmp(record->name, "transaction_", 12) != 0)
+		SessionPoolPin("SET");
+
 	/*
 	 * Evaluate value and set variable.
 	 */
@@ -11383,35 +11572,6 @@ assign_effective_io_concurrency(int newval, void *extra)
 #endif							/* USE_PREFETCH */
 }
 
-static void
-assign_pgstat_temp_directory(const char *newval, void *extra)
-{
-	/* check_canonical_path already canonicalized newval for us */
-	char	   *dname;
-	char	   *tname;
-	char	   *fname;
-
-	/* directory */
-	dname = guc_malloc(ERROR, strlen(newval) + 1);	/* runtime dir */
-	sprintf(dname, "%s", newval);
-
-	/* global stats */
-	tname = guc_malloc(ERROR, strlen(newval) + 12); /* /global.tmp */
-	sprintf(tname, "%s/global.tmp", newval);
-	fname = guc_malloc(ERROR, strlen(newval) + 13); /* /global.stat */
-	sprintf(fname, "%s/global.stat", newval);
-
-	if (pgstat_stat_directory)
-		free(pgstat_stat_directory);
-	pgstat_stat_directory = dname;
-	if (pgstat_stat_tmpname)
-		free(pgstat_stat_tmpname);
-	pgstat_stat_tmpname = tname;
-	if (pgstat_stat_filename)
-		free(pgstat_stat_filename);
-	pgstat_stat_filename = fname;
-}
-
 static bool
 check_application_name(char **newval, void **extra, GucSource source)
 {
@@ -627,6 +627,7 @@ typedef struct _SubscriptionInfo
 	char	   *subconninfo;
 	char	   *subslotname;
 	char	   *subsynccommit;
+	char	   *substream;
 	char	   *subpublications;
 } SubscriptionInfo;
 
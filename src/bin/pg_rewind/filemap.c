@@ -55,9 +55,7 @@ struct exclude_list_item
 static const char *excludeDirContents[] =
 {
 	/*
-	 * Skip temporary statistics files. PG_STAT_TMP_DIR must be skipped even
-	 * when stats_temp_directory is set because PGSS_TEXT_FILE is always
-	 * created there.
+	 * Skip temporary statistics files.  PGSS_TEXT_FILE is created there.
 	 */
 	"pg_stat_tmp",				/* defined as PG_STAT_TMP_DIR */
 
@@ -464,7 +464,9 @@ typedef enum MetaCommand
 	META_IF,					/* \if */
 	META_ELIF,					/* \elif */
 	META_ELSE,					/* \else */
-	META_ENDIF					/* \endif */
+	META_ENDIF,					/* \endif */
+	META_STARTPIPELINE,			/* \startpipeline */
+	META_ENDPIPELINE			/* \endpipeline */
 } MetaCommand;
 
 typedef enum QueryMode
@@ -2493,6 +2495,10 @@ getMetaCommand(const char *cmd)
 		mc = META_ENDIF;
 	else if (pg_strcasecmp(cmd, "gset") == 0)
 		mc = META_GSET;
+	else if (pg_strcasecmp(cmd, "startpipeline") == 0)
+		mc = META_STARTPIPELINE;
+	else if (pg_strcasecmp(cmd, "endpipeline") == 0)
+		mc = META_ENDPIPELINE;
 	else
 		mc = META_NONE;
 	return mc;
@@ -2640,6 +2646,36 @@ chooseScript(TState *thread)
 	return i - 1;
 }
 
+/*
+ * Prepare all the SQL commands of the client's current script, unless that
+ * was already done on this connection.
+ */
+static void
+prepareCommands(CState *st)
+{
+	int			j;
+	Command   **commands = sql_script[st->use_file].commands;
+
+	if (st->prepared[st->use_file])
+		return;
+
+	for (j = 0; commands[j] != NULL; j++)
+	{
+		PGresult   *res;
+		char		name[MAX_PREPARE_NAME];
+
+		if (commands[j]->type != SQL_COMMAND)
+			continue;
+		preparedStatementName(name, st->use_file, j);
+		res = PQprepare(st->con, name,
+						commands[j]->argv[0], commands[j]->argc - 1, NULL);
+		if (PQresultStatus(res) != PGRES_COMMAND_OK)
+			fprintf(stderr, "%s", PQerrorMessage(st->con));
+		PQclear(res);
+	}
+	st->prepared[st->use_file] = true;
+}
+
 /* Send a SQL command, using the chosen querymode */
 static bool
 sendCommand(CState *st, Command *command)
@@ -2675,27 +2711,8 @@ sendCommand(CState *st, Command *command)
 		char		name[MAX_PREPARE_NAME];
 		const char *params[MAX_ARGS];
 
-		if (!st->prepared[st->use_file])
-		{
-			int			j;
-			Command   **commands = sql_script[st->use_file].commands;
-
-			for (j = 0; commands[j] != NULL; j++)
-			{
-				PGresult   *res;
-				char		name[MAX_PREPARE_NAME];
-
-				if (commands[j]->type != SQL_COMMAND)
-					continue;
-				preparedStatementName(name, st->use_file, j);
-				res = PQprepare(st->con, name,
-								commands[j]->argv[0], commands[j]->argc - 1, NULL);
-				if (PQresultStatus(res) != PGRES_COMMAND_OK)
-					fprintf(stderr, "%s", PQerrorMessage(st->con));
-				PQclear(res);
-			}
-			st->prepared[st->use_file] = true;
-		}
+		/* in pipeline mode, this was done by \startpipeline */
+		prepareCommands(st);
 
 		getQueryParams(st, command, params);
 		preparedStatementName(name, st->use_file, st->command);
@@ -2833,6 +2850,61 @@ error:
 	return false;
 }
 
+/*
+ * Collect the results of the commands sent since \startpipeline, up to and
+ * including the Sync sent by \endpipeline, then leave pipeline mode.
+ *
+ * Returns 1 once done, 0 if more input is needed before we can continue, and
+ * -1 on error.  Results are discarded: \gset is not allowed in a pipeline.
+ */
+static int
+readPipelineResults(CState *st)
+{
+	PGresult   *res;
+
+	for (;;)
+	{
+		if (PQisBusy(st->con))
+			return 0;			/* don't have the whole result yet */
+
+		res = PQgetResult(st->con);
+		if (res == NULL)
+			continue;			/* end of one command's results */
+
+		switch (PQresultStatus(res))
+		{
+			case PGRES_COMMAND_OK:
+			case PGRES_TUPLES_OK:
+			case PGRES_EMPTY_QUERY:
+				break;
+
+			case PGRES_PIPELINE_SYNC:
+				PQclear(res);
+				if (!PQexitPipelineMode(st->con))
+				{
+					fprintf(stderr, "client %d could not exit pipeline mode: %s",
+							st->id, PQerrorMessage(st->con));
+					st->ecnt++;
+					return -1;
+				}
+				return 1;
+
+			default:
+				/* an error, or a command skipped because of one */
+				fprintf(stderr,
+						"client %d script %d aborted in pipeline ending at command %d: %s",
+						st->id, st->use_file, st->command,
+						PQresultStatus(res) == PGRES_PIPELINE_ABORTED ?
+						"command skipped because of an earlier error in the pipeline\n" :
+						PQerrorMessage(st->con));
+				PQclear(res);
+				st->ecnt++;
+				return -1;
+		}
+		PQclear(res);
+	}
+}
+
 /*
  * Parse the argument to a \sleep command, and return the requested amount
  * of delay, in microseconds.  Returns true on success, false on error.
@@ -3064,6 +3136,11 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 						commandFailed(st, "SQL", "SQL command send failed");
 						st->state = CSTATE_ABORTED;
 					}
+					else if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+					{
+						/* results are collected by \endpipeline */
+						st->state = CSTATE_END_COMMAND;
+					}
 					else
 						st->state = CSTATE_WAIT_RESULT;
 				}
@@ -3073,6 +3150,7 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 					 * Possible state changes when executing meta commands:
 					 * - on errors CSTATE_ABORTED
 					 * - on sleep CSTATE_SLEEP
+					 * - on \endpipeline CSTATE_WAIT_RESULT
 					 * - else CSTATE_END_COMMAND
 					 */
 					st->state = executeMetaCommand(st, &now);
@@ -3199,6 +3277,18 @@ advanceConnectionState(TState *thread, CState *st, StatsData *agg)
 					st->state = CSTATE_ABORTED;
 					break;
 				}
+
+				/* collect the results of a whole pipeline at \endpipeline */
+				if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+				{
+					int			rc = readPipelineResults(st);
+
+					if (rc == 0)
+						return;	/* don't have the whole result yet */
+					st->state = rc > 0 ? CSTATE_END_COMMAND : CSTATE_ABORTED;
+					break;
+				}
+
 				if (PQisBusy(st->con))
 					return;		/* don't have the whole result yet */
 
@@ -3441,6 +3531,39 @@ executeMetaCommand(CState *st, instr_time *now)
 			return CSTATE_ABORTED;
 		}
 	}
+	else if (command->meta == META_STARTPIPELINE)
+	{
+		if (PQpipelineStatus(st->con) != PQ_PIPELINE_OFF)
+		{
+			commandFailed(st, "startpipeline", "already in pipeline mode");
+			return CSTATE_ABORTED;
+		}
+
+		/* PQprepare can't be used in pipeline mode, so do it up front */
+		if (querymode == QUERY_PREPARED)
+			prepareCommands(st);
+
+		if (!PQenterPipelineMode(st->con))
+		{
+			commandFailed(st, "startpipeline", "failed to enter pipeline mode");
+			return CSTATE_ABORTED;
+		}
+	}
+	else if (command->meta == META_ENDPIPELINE)
+	{
+		if (PQpipelineStatus(st->con) == PQ_PIPELINE_OFF)
+		{
+			commandFailed(st, "endpipeline", "not in pipeline mode");
+			return CSTATE_ABORTED;
+		}
+		if (!PQpipelineSync(st->con))
+		{
+			commandFailed(st, "endpipeline", "failed to send a pipeline sync");
+			return CSTATE_ABORTED;
+		}
+		/* collect the results of the whole pipeline */
+		return CSTATE_WAIT_RESULT;
+	}
 
 	/*
 	 * executing the expression or shell command might have taken a
@@ -4361,7 +4484,9 @@ process_backslash_command(PsqlScanState sstate, const char *source)
 			syntax_error(source, lineno, my_command->first_line, my_command->argv[0],
 						 "missing command", NULL, -1);
 	}
-	else if (my_command->meta == META_ELSE || my_command->meta == META_ENDIF)
+	else if (my_command->meta == META_ELSE || my_command->meta == META_ENDIF ||
+			 my_command->meta == META_STARTPIPELINE ||
+			 my_command->meta == META_ENDPIPELINE)
 	{
 		if (my_command->argc != 1)
 			syntax_error(source, lineno, my_command->first_line, my_command->argv[0],
@@ -4394,6 +4519,56 @@ ConditionError(const char *desc, int cmdn, const char *msg)
 	exit(1);
 }
 
+/*
+ * Check that \startpipeline and \endpipeline are properly paired, and that
+ * nothing inside a pipeline needs the result of a query.
+ */
+static void
+CheckPipeline(ParsedScript ps)
+{
+	bool		in_pipeline = false;
+	const char *msg = NULL;
+	int			i;
+
+	for (i = 0; ps.commands[i] != NULL && msg == NULL; i++)
+	{
+		Command    *cmd = ps.commands[i];
+
+		if (cmd->type == SQL_COMMAND)
+		{
+			if (in_pipeline && cmd->varprefix != NULL)
+				msg = "\\gset is not allowed in a pipeline";
+		}
+		else if (cmd->meta == META_STARTPIPELINE)
+		{
+			if (in_pipeline)
+				msg = "\\startpipeline within a pipeline";
+			in_pipeline = true;
+		}
+		else if (cmd->meta == META_ENDPIPELINE)
+		{
+			if (!in_pipeline)
+				msg = "\\endpipeline without matching \\startpipeline";
+			in_pipeline = false;
+		}
+		else if (in_pipeline && cmd->meta != META_SET)
+			msg = "only SQL commands and \\set are allowed in a pipeline";
+	}
+	if (msg == NULL && in_pipeline)
+	{
+		msg = "\\startpipeline without matching \\endpipeline";
+		i++;
+	}
+
+	if (msg != NULL)
+	{
+		fprintf(stderr,
+				"pipeline error in script \"%s\" command %d: %s\n",
+				ps.desc, i, msg);
+		exit(1);
+	}
+}
+
 /*
  * Partial evaluation of conditionals before recording and running the script.
  */
@@ -4764,6 +4939,7 @@ addScript(ParsedScript script)
 	}
 
 	CheckConditional(script);
+	CheckPipeline(script);
 
 	sql_script[num_scripts] = script;
 	num_scripts++;
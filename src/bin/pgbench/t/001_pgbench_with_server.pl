@@ -567,6 +567,44 @@ SELECT 0 AS i4, 4 AS i4 \gset
 }
 	});
 
+# working \startpipeline / \endpipeline, in every query mode
+for my $mode (qw(simple extended prepared))
+{
+	pgbench(
+		"-n -t 10 -M $mode", 0,
+		[ qr{type: .*/001_pgbench_pipeline_$mode}, qr{processed: 10/10} ],
+		[qr{^$}],
+		"pgbench pipeline, $mode query mode",
+		{
+			"001_pgbench_pipeline_$mode" => q{
+-- test pipeline mode
+\set aid random(1, 100000)
+\startpipeline
+SELECT abalance FROM pgbench_accounts WHERE aid = :aid;
+UPDATE pgbench_accounts SET abalance = abalance + 1 WHERE aid = :aid;
+\set bid random(1, 1)
+SELECT :bid;
+\endpipeline
+}
+		});
+}
+
+# the benchmark in src/tools/fastpath_bench, whose lookups lock more
+# relations than a group of fast-path slots holds
+my $fastpath_bench = '../../tools/fastpath_bench';
+$node->command_ok(
+	[
+		'psql', '-X', '-q', '-v', 'ON_ERROR_STOP=1',
+		'-v', 'partitions=32', '-f', "$fastpath_bench/setup.sql"
+	],
+	'fast-path benchmark setup');
+pgbench(
+	"-n -t 10 -c 2 -f $fastpath_bench/lookup.sql",
+	0,
+	[ qr{processed: 20/20}, qr{type: .*/lookup.sql} ],
+	[qr{^$}],
+	'fast-path benchmark lookups');
+
 # trigger many expression errors
 my @errors = (
 
@@ -581,6 +619,17 @@ my @errors = (
 		],
 		q{-- SQL syntax error
     SELECT 1 + ;
+}
+	],
+	[
+		'sql error in pipeline', 2,
+		[ qr{ERROR:  division by zero}, qr{aborted in pipeline ending at command 4} ],
+		q{-- a failing command aborts the client at \endpipeline
+\startpipeline
+SELECT 1;
+SELECT 1/0;
+SELECT 2;
+\endpipeline
 }
 	],
 	[
@@ -271,6 +271,28 @@ my @script_tests = (
 		[qr{unexpected argument in command "endif"}],
 		{ 'endif-bad.sql' => "\\if 0\n\\endif BAD\n" }
 	],
+	[
+		'missing endpipeline',
+		[qr{\\startpipeline without matching \\endpipeline}],
+		{ 'pipeline-noend.sql' => "\\startpipeline\nSELECT 1;\n" }
+	],
+	[
+		'missing startpipeline',
+		[qr{\\endpipeline without matching \\startpipeline}],
+		{ 'pipeline-nostart.sql' => "SELECT 1;\n\\endpipeline\n" }
+	],
+	[
+		'nested startpipeline',
+		[qr{\\startpipeline within a pipeline}],
+		{   'pipeline-nested.sql' =>
+			  "\\startpipeline\n\\startpipeline\n\\endpipeline\n" }
+	],
+	[
+		'gset in pipeline',
+		[qr{\\gset is not allowed in a pipeline}],
+		{   'pipeline-gset.sql' =>
+			  "\\startpipeline\nSELECT 1 AS one \\gset\n\\endpipeline\n" }
+	],
 	[
 		'not enough arguments for least',
 		[qr{at least one argument expected \(least\)}],
@@ -2653,7 +2653,9 @@ describeOneTableDetails(const char *schemaname,
 							  "        a.attnum = s.attnum AND NOT attisdropped)) AS columns,\n"
 							  "  'd' = any(stxkind) AS ndist_enabled,\n"
 							  "  'f' = any(stxkind) AS deps_enabled,\n"
-							  "  'm' = any(stxkind) AS mcv_enabled\n"
+							  "  'm' = any(stxkind) AS mcv_enabled,\n"
+							  "  'h' = any(stxkind) AS histogram_enabled,\n"
+							  "  pg_catalog.pg_get_expr(stxexprs, stxrelid) AS exprs\n"
 							  "FROM pg_catalog.pg_statistic_ext stat "
 							  "WHERE stxrelid = '%s'\n"
 							  "ORDER BY 1;",
@@ -2696,10 +2698,23 @@ describeOneTableDetails(const char *schemaname,
 					if (strcmp(PQgetvalue(result, i, 7), "t") == 0)
 					{
 						appendPQExpBuffer(&buf, "%smcv", gotone ? ", " : "");
+						gotone = true;
+					}
+
+					if (strcmp(PQgetvalue(result, i, 8), "t") == 0)
+					{
+						appendPQExpBuffer(&buf, "%shistogram", gotone ? ", " : "");
 					}
 
-					appendPQExpBuffer(&buf, ") ON %s FROM %s",
-									  PQgetvalue(result, i, 4),
+					/* columns, followed by the expressions */
+					appendPQExpBuffer(&buf, ") ON %s", PQgetvalue(result, i, 4));
+
+					if (!PQgetisnull(result, i, 9))
+						appendPQExpBuffer(&buf, "%s%s",
+										  PQgetisnull(result, i, 4) ? "" : ", ",
+										  PQgetvalue(result, i, 9));
+
+					appendPQExpBuffer(&buf, " FROM %s",
 									  PQgetvalue(result, i, 1));
 
 					printTableAddFooter(&cont, buf.data);
@@ -5882,7 +5897,7 @@ describeSubscriptions(const char *pattern, bool verbose)
 	PGresult   *res;
 	printQueryOpt myopt = pset.popt;
 	static const bool translate_columns[] = {false, false, false, false,
-	false, false};
+	false, false, false};
 
 	if (pset.sversion < 100000)
 	{
@@ -5909,8 +5924,10 @@ describeSubscriptions(const char *pattern, bool verbose)
 	if (verbose)
 	{
 		appendPQExpBuffer(&buf,
+						  ",  substream AS \"%s\"\n"
 						  ",  subsynccommit AS \"%s\"\n"
 						  ",  subconninfo AS \"%s\"\n",
+						  gettext_noop("Streaming"),
 						  gettext_noop("Synchronous commit"),
 						  gettext_noop("Conninfo"));
 	}
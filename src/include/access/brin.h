@@ -10,9 +10,12 @@
 #ifndef BRIN_H
 #define BRIN_H
 
+#include "access/stratnum.h"
 #include "fmgr.h"
 #include "nodes/execnodes.h"
+#include "nodes/tidbitmap.h"
 #include "utils/relcache.h"
+#include "utils/snapshot.h"
 
 
 /*
@@ -48,5 +51,11 @@ typedef struct BrinStatsData
 
 
 extern void brinGetStats(Relation index, BrinStatsData *stats);
+extern BlockNumber brin_candidate_blocks(Relation heapRel, AttrNumber attno,
+										 StrategyNumber strategy, Datum value,
+										 Oid valtype, Snapshot snapshot,
+										 TIDBitmap **blocks);
+extern bool brin_minmax_bound(Relation heapRel, AttrNumber attno, Oid sortop,
+							  Oid *boundop, Datum *bound);
 
 #endif							/* BRIN_H */
@@ -19,11 +19,34 @@
 #include "catalog/pg_statistic.h"
 #include "catalog/pg_type.h"
 #include "nodes/parsenodes.h"
+#include "port/atomics.h"
 #include "storage/buf.h"
 #include "storage/lock.h"
 #include "utils/relcache.h"
 
 
+/*
+ * Flags for amparallelvacuumoptions to control the participation of an index
+ * AM in parallel vacuum.  An AM can only take part if its bulk-delete and
+ * cleanup callbacks return a plain IndexBulkDeleteResult, since the result is
+ * copied through shared memory between the processes that handle the index
+ * in successive passes.
+ */
+/* the index AM can't participate in parallel vacuum */
+#define VACUUM_OPTION_NO_PARALLEL			0
+
+/* ambulkdelete can be performed by a parallel worker */
+#define VACUUM_OPTION_PARALLEL_BULKDEL		(1 << 0)
+
+/*
+ * amvacuumcleanup can be performed by a parallel worker if ambulkdelete was
+ * never called for the index, i.e. cleanup has to do the full index scan.
+ */
+#define VACUUM_OPTION_PARALLEL_COND_CLEANUP	(1 << 1)
+
+/* amvacuumcleanup can always be performed by a parallel worker */
+#define VACUUM_OPTION_PARALLEL_CLEANUP		(1 << 2)
+
 /*----------
  * ANALYZE builds one of these structs for each attribute (column) that is
  * to be analyzed.  The struct and subsidiary data are in anl_context,
@@ -184,6 +207,13 @@ typedef struct VacuumParams
 										 * default value depends on reloptions */
 	VacOptTernaryValue truncate;	/* Truncate empty pages at the end,
 									 * default value depends on reloptions */
+
+	/*
+	 * The number of parallel workers to use for index vacuum and cleanup.
+	 * 0 means choose based on the number of indexes, -1 disables parallel
+	 * vacuum.
+	 */
+	int			nworkers;
 } VacuumParams;
 
 /* GUC parameters */
@@ -193,6 +223,11 @@ extern int	vacuum_freeze_table_age;
 extern int	vacuum_multixact_freeze_min_age;
 extern int	vacuum_multixact_freeze_table_age;
 
+/* Variables for cost-based parallel vacuum */
+extern pg_atomic_uint32 *VacuumSharedCostBalance;
+extern pg_atomic_uint32 *VacuumActiveNWorkers;
+extern int	VacuumCostBalanceLocal;
+
 
 /* in commands/vacuum.c */
 extern void ExecVacuum(ParseState *pstate, VacuumStmt *vacstmt, bool isTopLevel);
@@ -149,6 +149,19 @@ typedef struct Port
 	 */
 	char	   *application_name;
 
+	/*
+	 * Startup packet parameters sent by a connection proxy (see
+	 * postmaster/proxy.c), and whether they were found valid.  "proxied"
+	 * means the connection comes from a proxy and the remote address is that
+	 * of the proxy's client; proxy_preauth means the proxy has already
+	 * authenticated the client.
+	 */
+	char	   *proxy_token;
+	char	   *proxy_client_addr;
+	char	   *proxy_client_port;
+	bool		proxy_preauth;
+	bool		proxied;
+
 	/*
 	 * Information that needs to be held during the authentication cycle.
 	 */
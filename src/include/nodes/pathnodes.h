@@ -880,6 +880,7 @@ typedef struct StatisticExtInfo
 	RelOptInfo *rel;			/* back-link to statistic's table */
 	char		kind;			/* statistic kind of this entry */
 	Bitmapset  *keys;			/* attnums of the columns covered */
+	List	   *exprs;			/* expressions covered, after the columns */
 } StatisticExtInfo;
 
 /*
@@ -1423,6 +1424,26 @@ typedef struct MaterialPath
 	Path	   *subpath;
 } MaterialPath;
 
+/*
+ * ResultCachePath represents a ResultCache plan node, i.e., a cache of the
+ * rows returned by a parameterized subpath, keyed by the values of
+ * param_exprs.  This is useful on the inner side of a nested loop when the
+ * outer side is expected to supply the same parameter values many times.
+ */
+typedef struct ResultCachePath
+{
+	Path		path;
+	Path	   *subpath;		/* outerpath to cache tuples from */
+	List	   *hash_operators; /* hash equality operators for each key */
+	List	   *param_exprs;	/* cache keys */
+	bool		singlerow;		/* true if the cache entry is to be marked as
+								 * complete after caching the first record. */
+	double		calls;			/* expected number of rescans */
+	uint32		est_entries;	/* The maximum number of entries that the
+								 * planner expects will fit in the cache, or 0
+								 * if unknown */
+} ResultCachePath;
+
 /*
  * UniquePath represents elimination of distinct rows from the output of
  * its subpath.
@@ -2265,6 +2286,11 @@ typedef struct PlaceHolderInfo
  * This struct describes one potentially index-optimizable MIN/MAX aggregate
  * function.  MinMaxAggPath contains a list of these, and if we accept that
  * path, the list is stored into root->minmax_aggs for use during setrefs.c.
+ *
+ * If the subquery was narrowed down using the summaries of a BRIN index, it
+ * may come up empty even though the table has rows; then an unbounded
+ * fallback subquery supplies the result, and the aggregate is replaced by
+ * COALESCE(param, fallback_param).
  */
 typedef struct MinMaxAggInfo
 {
@@ -2277,6 +2303,9 @@ typedef struct MinMaxAggInfo
 	Path	   *path;			/* access path for subquery */
 	Cost		pathcost;		/* estimated cost to fetch first row */
 	Param	   *param;			/* param for subplan's output */
+	PlannerInfo *fallback_subroot;	/* "root" for the fallback subquery */
+	Path	   *fallback_path;	/* access path for it, or NULL if none */
+	Param	   *fallback_param; /* param for its subplan's output */
 } MinMaxAggInfo;
 
 /*
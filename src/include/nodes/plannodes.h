@@ -133,6 +133,11 @@ typedef struct Plan
 	bool		parallel_aware; /* engage parallel-aware logic? */
 	bool		parallel_safe;	/* OK to use as part of parallel plan? */
 
+	/*
+	 * information needed for asynchronous execution
+	 */
+	bool		async_capable;	/* engage asynchronous-capable logic? */
+
 	/*
 	 * Common structural data for all Plan types.
 	 */
@@ -756,6 +761,27 @@ typedef struct Material
 	Plan		plan;
 } Material;
 
+/* ----------------
+ *		result cache node
+ *
+ * Caches the rows produced by the subplan for each distinct set of values
+ * of param_exprs, so that rescans with parameter values seen before can be
+ * answered without re-executing the subplan.
+ * ----------------
+ */
+typedef struct ResultCache
+{
+	Plan		plan;
+	int			numKeys;		/* size of the two arrays below */
+	Oid		   *hashOperators;	/* hash equality operators for each key */
+	Oid		   *collations;		/* collations for each key */
+	List	   *param_exprs;	/* expressions that form the cache key */
+	bool		singlerow;		/* true if the cache entry is complete after
+								 * storing its first tuple */
+	uint32		est_entries;	/* planner's estimate of the number of cache
+								 * entries, or 0 if unknown */
+} ResultCache;
+
 /* ----------------
  *		sort node
  * ----------------
@@ -918,6 +944,18 @@ typedef struct Hash
 	bool		skewInherit;	/* is outer join rel an inheritance tree? */
 	/* all other info is in the parent HashJoin node */
 	double		rows_total;		/* estimate total rows if parallel_aware */
+
+	/*
+	 * Keys whose range is collected while building the hash table, so that
+	 * the outer side of the join can skip the partitions that can't match.
+	 * prunekeyidx gives the keys' positions in hashkeys, and pruneparams
+	 * the PARAM_EXEC params receiving each key's minimum and maximum, in
+	 * that order.
+	 */
+	List	   *prunekeyidx;	/* integer list of positions in hashkeys */
+	List	   *prunecmpfuncs;	/* OID list of btree comparison functions */
+	List	   *prunecollations;	/* OID list of collations */
+	List	   *pruneparams;	/* integer list of paramids */
 } Hash;
 
 /* ----------------
@@ -0,0 +1,33 @@
+/*-------------------------------------------------------------------------
+ *
+ * cardfeedback.h
+ *	  prototypes for cardfeedback.c.
+ *
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/optimizer/cardfeedback.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef CARDFEEDBACK_H
+#define CARDFEEDBACK_H
+
+#include "nodes/execnodes.h"
+#include "nodes/pathnodes.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT bool enable_cardinality_feedback;
+extern PGDLLIMPORT double cardinality_feedback_decay;
+extern PGDLLIMPORT int cardinality_feedback_max_entries;
+
+extern Size CardinalityFeedbackShmemSize(void);
+extern void CardinalityFeedbackShmemInit(void);
+
+extern Selectivity cardinality_feedback_adjust(PlannerInfo *root,
+											   List *clauses,
+											   Selectivity s);
+extern void cardinality_feedback_record(PlanState *planstate);
+
+#endif							/* CARDFEEDBACK_H */
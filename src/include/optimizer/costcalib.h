@@ -0,0 +1,28 @@
+/*-------------------------------------------------------------------------
+ *
+ * costcalib.h
+ *	  prototypes for costcalib.c.
+ *
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/optimizer/costcalib.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef COSTCALIB_H
+#define COSTCALIB_H
+
+#include "nodes/execnodes.h"
+
+/* GUC parameters */
+extern PGDLLIMPORT bool enable_cost_calibration;
+extern PGDLLIMPORT double cost_calibration_ridge;
+
+extern Size CostCalibrationShmemSize(void);
+extern void CostCalibrationShmemInit(void);
+
+extern void cost_calibration_record(PlanState *planstate);
+
+#endif							/* COSTCALIB_H */
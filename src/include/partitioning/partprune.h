@@ -73,6 +73,11 @@ extern PartitionPruneInfo *make_partition_pruneinfo(struct PlannerInfo *root,
 													List *subpaths,
 													List *partitioned_rels,
 													List *prunequal);
+extern List *make_hashjoin_pruning_quals(struct PlannerInfo *root,
+										 struct RelOptInfo *outerrel,
+										 List *hashclauses,
+										 List **keyidx, List **cmpfuncs,
+										 List **collations, List **params);
 extern Bitmapset *prune_append_rel_partitions(struct RelOptInfo *rel);
 extern Bitmapset *get_matching_partitions(PartitionPruneContext *context,
 										  List *pruning_steps);
@@ -30,6 +30,7 @@ typedef enum
 extern bool autovacuum_start_daemon;
 extern int	autovacuum_max_workers;
 extern int	autovacuum_work_mem;
+extern int	autovacuum_max_parallel_workers;
 extern int	autovacuum_naptime;
 extern int	autovacuum_vac_thresh;
 extern double autovacuum_vac_scale;
@@ -0,0 +1,39 @@
+/*-------------------------------------------------------------------------
+ *
+ * proxy.h
+ *	  Exports from postmaster/proxy.c.
+ *
+ * Portions Copyright (c) 1996-2019, PostgreSQL Global Development Group
+ * Portions Copyright (c) 1994, Regents of the University of California
+ *
+ * src/include/postmaster/proxy.h
+ *
+ *-------------------------------------------------------------------------
+ */
+#ifndef _PROXY_H
+#define _PROXY_H
+
+#include "libpq/libpq-be.h"
+
+/* Upper limit for the connection_proxies GUC */
+#define MAX_CONNECTION_PROXIES	64
+
+/* GUC options */
+extern int	ConnectionProxies;
+extern int	ProxyPortNumber;
+extern int	SessionPoolSize;
+
+/* functions called by postmaster */
+extern void ConnectionProxyListen(void);
+extern void ConnectionProxyCloseSockets(void);
+extern int	StartConnectionProxy(int id);
+
+/* shared memory */
+extern Size ProxyShmemSize(void);
+extern void ProxyShmemInit(void);
+
+/* functions called by backends */
+extern void ProxyValidateBackendConnection(Port *port);
+extern void SessionPoolPin(const char *reason);
+
+#endif							/* _PROXY_H */
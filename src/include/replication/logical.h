@@ -53,6 +53,13 @@ typedef struct LogicalDecodingContext
 	OutputPluginCallbacks callbacks;
 	OutputPluginOptions options;
 
+	/*
+	 * Does the output plugin support streaming of in-progress transactions,
+	 * and is it enabled?  Set if the plugin defines the stream callbacks; the
+	 * startup callback may disable it again, e.g. based on the options.
+	 */
+	bool		streaming;
+
 	/*
 	 * User specified options
 	 */
@@ -17,6 +17,8 @@
 #include "access/xlogdefs.h"
 #include "catalog/pg_subscription.h"
 #include "datatype/timestamp.h"
+#include "lib/stringinfo.h"
+#include "storage/dsm.h"
 #include "storage/lock.h"
 
 typedef struct LogicalRepWorker
@@ -48,6 +50,12 @@ typedef struct LogicalRepWorker
 	XLogRecPtr	relstate_lsn;
 	slock_t		relmutex;
 
+	/*
+	 * Used for parallel apply workers: PID of the apply worker handing them
+	 * transactions, 0 for other workers.
+	 */
+	pid_t		leader_pid;
+
 	/* Stats. */
 	XLogRecPtr	last_lsn;
 	TimestampTz last_send_time;
@@ -59,6 +67,9 @@ typedef struct LogicalRepWorker
 /* Main memory context for apply worker. Permanent during worker lifetime. */
 extern MemoryContext ApplyContext;
 
+/* Memory context reset after each replication protocol message. */
+extern MemoryContext ApplyMessageContext;
+
 /* libpqreceiver connection */
 extern struct WalReceiverConn *wrconn;
 
@@ -72,8 +83,10 @@ extern void logicalrep_worker_attach(int slot);
 extern LogicalRepWorker *logicalrep_worker_find(Oid subid, Oid relid,
 												bool only_running);
 extern List *logicalrep_workers_find(Oid subid, bool only_running);
-extern void logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname,
-									 Oid userid, Oid relid);
+extern bool logicalrep_worker_launch(Oid dbid, Oid subid, const char *subname,
+									 Oid userid, Oid relid,
+									 dsm_handle subworker_dsm,
+									 int subworker_index);
 extern void logicalrep_worker_stop(Oid subid, Oid relid);
 extern void logicalrep_worker_stop_at_commit(Oid subid, Oid relid);
 extern void logicalrep_worker_wakeup(Oid subid, Oid relid);
@@ -85,6 +98,21 @@ extern char *LogicalRepSyncTableStart(XLogRecPtr *origin_startpos);
 void		process_syncing_tables(XLogRecPtr current_lsn);
 void		invalidate_syncing_table_states(Datum arg, int cacheid,
 											uint32 hashvalue);
+extern bool AllTablesyncsReady(void);
+
+extern void InitializeApplyWorker(void);
+extern void apply_dispatch(StringInfo s);
+extern void store_flush_position(XLogRecPtr remote_lsn,
+								 XLogRecPtr local_lsn);
+
+/* Parallel apply, see applyparallelworker.c */
+extern bool pa_handle_message(char action, StringInfo s, int msgstart);
+extern void pa_wait_all(void);
+extern void pa_process_finished(void);
+extern bool pa_has_busy_workers(void);
+extern void pa_start_transaction(TransactionId xid);
+extern void pa_wait_for_preceding(void);
+extern void pa_finish_transaction(XLogRecPtr remote_end, XLogRecPtr local_end);
 
 static inline bool
 am_tablesync_worker(void)
@@ -92,4 +120,10 @@ am_tablesync_worker(void)
 	return OidIsValid(MyLogicalRepWorker->relid);
 }
 
+static inline bool
+am_parallel_apply_worker(void)
+{
+	return MyLogicalRepWorker->leader_pid != 0;
+}
+
 #endif							/* WORKER_INTERNAL_H */
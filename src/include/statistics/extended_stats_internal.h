@@ -75,6 +75,14 @@ extern MCVList *statext_mcv_build(int numrows, HeapTuple *rows,
 extern bytea *statext_mcv_serialize(MCVList *mcv, VacAttrStats **stats);
 extern MCVList *statext_mcv_deserialize(bytea *data);
 
+extern MVHistogram *statext_histogram_build(int numrows, HeapTuple *rows,
+											Bitmapset *attrs,
+											VacAttrStats **stats);
+extern bytea *statext_histogram_serialize(MVHistogram *histogram,
+										  VacAttrStats **stats);
+extern MVHistogram *statext_histogram_deserialize(bytea *data);
+
+extern MultiSortSupport build_mss(VacAttrStats **stats, int numattrs);
 extern MultiSortSupport multi_sort_init(int ndims);
 extern void multi_sort_add_dimension(MultiSortSupport mss, int sortdim,
 									 Oid oper, Oid collation);
@@ -97,8 +105,11 @@ extern SortItem *build_sorted_items(int numrows, int *nitems, HeapTuple *rows,
 									TupleDesc tdesc, MultiSortSupport mss,
 									int numattrs, AttrNumber *attnums);
 
+extern bool examine_opclause_args(OpExpr *expr, Node **exprp,
+								  Const **cstp, bool *expronleftp);
 extern bool examine_opclause_expression(OpExpr *expr, Var **varp,
 										Const **cstp, bool *varonleftp);
+extern int	statext_histogram_dimension(StatisticExtInfo *stat, Node *expr);
 
 extern Selectivity mcv_clauselist_selectivity(PlannerInfo *root,
 											  StatisticExtInfo *stat,
@@ -110,4 +121,12 @@ extern Selectivity mcv_clauselist_selectivity(PlannerInfo *root,
 											  Selectivity *basesel,
 											  Selectivity *totalsel);
 
+extern Selectivity histogram_clauselist_selectivity(PlannerInfo *root,
+													StatisticExtInfo *stat,
+													List *clauses,
+													int varRelid,
+													JoinType jointype,
+													SpecialJoinInfo *sjinfo,
+													RelOptInfo *rel);
+
 #endif							/* EXTENDED_STATS_INTERNAL_H */
@@ -93,9 +93,44 @@ typedef struct MCVList
 	MCVItem		items[FLEXIBLE_ARRAY_MEMBER];	/* array of MCV items */
 } MCVList;
 
+/* used to flag stats serialized to bytea */
+#define STATS_HIST_MAGIC		0x7F8C5670	/* marks serialized bytea */
+#define STATS_HIST_TYPE_BASIC	1	/* basic histogram type */
+
+/* max buckets in a histogram */
+#define STATS_HIST_MAX_BUCKETS	16384
+
+/*
+ * Multivariate histograms
+ *
+ * Each bucket is a hyper-rectangle in the space of the statistics columns,
+ * described by the smallest and largest value of the sampled rows it holds
+ * in each dimension (both inclusive), together with the fraction of the
+ * rows falling into it.  Rows with a NULL in any of the columns are not
+ * assigned to any bucket, and are only tracked in nullfrac.
+ */
+typedef struct MVBucket
+{
+	double		frequency;		/* fraction of non-NULL rows in the bucket */
+	Datum	   *min;			/* lower boundaries (inclusive) */
+	Datum	   *max;			/* upper boundaries (inclusive) */
+} MVBucket;
+
+typedef struct MVHistogram
+{
+	uint32		magic;			/* magic constant marker */
+	uint32		type;			/* type of histogram (BASIC) */
+	uint32		nbuckets;		/* number of buckets in the array */
+	AttrNumber	ndimensions;	/* number of dimensions */
+	double		nullfrac;		/* fraction of rows with any NULL value */
+	Oid			types[STATS_MAX_DIMENSIONS];	/* OIDs of data types */
+	MVBucket	buckets[FLEXIBLE_ARRAY_MEMBER]; /* array of buckets */
+} MVHistogram;
+
 extern MVNDistinct *statext_ndistinct_load(Oid mvoid);
 extern MVDependencies *statext_dependencies_load(Oid mvoid);
 extern MCVList *statext_mcv_load(Oid mvoid);
+extern MVHistogram *statext_histogram_load(Oid mvoid);
 
 extern void BuildRelationExtStatistics(Relation onerel, double totalrows,
 									   int numrows, HeapTuple *rows,
@@ -143,6 +143,11 @@ typedef enum LWLockMode
 extern bool Trace_lwlocks;
 #endif
 
+/* GUC variables */
+extern int	lwlock_spin_limit;
+extern bool lwlock_fair_handoff;
+extern bool track_lwlock_stats;
+
 extern bool LWLockAcquire(LWLock *lock, LWLockMode mode);
 extern bool LWLockConditionalAcquire(LWLock *lock, LWLockMode mode);
 extern bool LWLockAcquireOrWait(LWLock *lock, LWLockMode mode);
@@ -158,6 +163,8 @@ extern void LWLockUpdateVar(LWLock *lock, uint64 *valptr, uint64 value);
 extern Size LWLockShmemSize(void);
 extern void CreateLWLocks(void);
 extern void InitLWLockAccess(void);
+extern Size LWLockStatsShmemSize(void);
+extern void LWLockStatsShmemInit(void);
 
 extern const char *GetLWLockIdentifier(uint32 classId, uint16 eventId);
 
@@ -220,9 +227,31 @@ typedef enum BuiltinTrancheIds
 	LWTRANCHE_TBM,
 	LWTRANCHE_PARALLEL_APPEND,
 	LWTRANCHE_SXACT,
+	LWTRANCHE_PGSTATS_DSA,
+	LWTRANCHE_PGSTATS_DB_HASH,
+	LWTRANCHE_PGSTATS_TABLE_HASH,
+	LWTRANCHE_CARDINALITY_FEEDBACK,
+	LWTRANCHE_COST_CALIBRATION,
 	LWTRANCHE_FIRST_USER_DEFINED
 }			BuiltinTrancheIds;
 
+/*
+ * Per-tranche contention statistics, collected when track_lwlock_stats is
+ * on.  Times are in microseconds.  Tranches allocated by LWLockNewTrancheId
+ * are counted together in one extra slot.
+ */
+typedef struct LWLockTrancheStats
+{
+	uint64		acquires;		/* successful acquisitions */
+	uint64		contended;		/* acquisitions that found the lock busy */
+	uint64		wait_time;		/* total time spent spinning or sleeping */
+	uint64		max_hold_time;	/* longest time the lock was held */
+} LWLockTrancheStats;
+
+#define NUM_LWLOCK_STATS_TRANCHES	(LWTRANCHE_FIRST_USER_DEFINED + 1)
+
+extern void LWLockGetTrancheStats(int slot, LWLockTrancheStats *stats);
+
 /*
  * Prior to PostgreSQL 9.4, we used an enum type called LWLockId to refer
  * to LWLocks.  New code should instead use LWLock *.  However, for the
@@ -67,8 +67,24 @@ struct XidCache
  * RowShareLock, RowExclusiveLock) to be recorded in the PGPROC structure
  * rather than the main lock table.  This eases contention on the lock
  * manager LWLocks.  See storage/lmgr/README for additional details.
+ *
+ * The slots are organized in groups of FP_LOCK_SLOTS_PER_GROUP.  A relation
+ * can only be recorded in the group its OID hashes to, so a lookup has to
+ * search just one group.  The number of groups is derived from
+ * max_locks_per_transaction at postmaster startup (see
+ * InitializeFastPathLocks), so that queries touching many relations, such
+ * as those on heavily partitioned tables, can still use the fast path.
  */
-#define		FP_LOCK_SLOTS_PER_BACKEND 16
+extern PGDLLIMPORT int FastPathLockGroupsPerBackend;
+
+#define		FP_LOCK_GROUPS_PER_BACKEND_MAX	1024
+#define		FP_LOCK_SLOTS_PER_GROUP		16	/* don't change, see fpLockBits */
+#define		FastPathLockSlotsPerBackend() \
+	(FP_LOCK_SLOTS_PER_GROUP * FastPathLockGroupsPerBackend)
+/* per-PGPROC shared memory needed for fpLockBits and fpRelId */
+#define		FastPathLockShmemSize() \
+	(MAXALIGN(FastPathLockGroupsPerBackend * sizeof(uint64)) + \
+	 MAXALIGN(FastPathLockSlotsPerBackend() * sizeof(Oid)))
 
 /*
  * An invalid pgprocno.  Must be larger than the maximum number of PGPROC
@@ -190,8 +206,9 @@ struct PGPROC
 	LWLock		backendLock;
 
 	/* Lock manager data, recording fast-path locks taken by this backend. */
-	uint64		fpLockBits;		/* lock modes held for each fast-path slot */
-	Oid			fpRelId[FP_LOCK_SLOTS_PER_BACKEND]; /* slots for rel oids */
+	uint64	   *fpLockBits;		/* lock modes held for each fast-path slot
+								 * group (one uint64 per group) */
+	Oid		   *fpRelId;		/* slots for rel oids */
 	bool		fpVXIDLock;		/* are we holding a fast-path VXID lock? */
 	LocalTransactionId fpLocalTransactionId;	/* lxid for fast-path VXID
 												 * lock */
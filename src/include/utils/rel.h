@@ -278,6 +278,7 @@ typedef struct StdRdOptions
 	int			parallel_workers;	/* max number of parallel workers */
 	bool		vacuum_index_cleanup;	/* enables index vacuuming and cleanup */
 	bool		vacuum_truncate;	/* enables vacuum to truncate a relation */
+	bool		deduplicate_items;	/* Try to deduplicate btree items? */
 } StdRdOptions;
 
 #define HEAP_MIN_FILLFACTOR			10
@@ -31,6 +31,7 @@ typedef enum TimeoutId
 	STANDBY_TIMEOUT,
 	STANDBY_LOCK_TIMEOUT,
 	IDLE_IN_TRANSACTION_SESSION_TIMEOUT,
+	IDLE_STATS_UPDATE_TIMEOUT,
 	/* First user-definable timeout reason */
 	USER_TIMEOUT,
 	/* Maximum number of timeout reasons */
@@ -46,15 +47,16 @@ typedef void (*timeout_handler_proc) (void);
 typedef enum TimeoutType
 {
 	TMPARAM_AFTER,
-	TMPARAM_AT
+	TMPARAM_AT,
+	TMPARAM_EVERY
 } TimeoutType;
 
 typedef struct
 {
 	TimeoutId	id;				/* timeout to set */
-	TimeoutType type;			/* TMPARAM_AFTER or TMPARAM_AT */
-	int			delay_ms;		/* only used for TMPARAM_AFTER */
-	TimestampTz fin_time;		/* only used for TMPARAM_AT */
+	TimeoutType type;			/* TMPARAM_AFTER, TMPARAM_AT, or TMPARAM_EVERY */
+	int			delay_ms;		/* only used for TMPARAM_AFTER/EVERY */
+	TimestampTz fin_time;		/* only used for TMPARAM_AT/EVERY */
 } EnableTimeoutParams;
 
 /*
@@ -74,6 +76,8 @@ extern void reschedule_timeouts(void);
 /* timeout operation */
 extern void enable_timeout_after(TimeoutId id, int delay_ms);
 extern void enable_timeout_at(TimeoutId id, TimestampTz fin_time);
+extern void enable_timeout_every(TimeoutId id, TimestampTz fin_time,
+								 int delay_ms);
 extern void enable_timeouts(const EnableTimeoutParams *timeouts, int count);
 extern void disable_timeout(TimeoutId id, bool keep_indicator);
 extern void disable_timeouts(const DisableTimeoutParams *timeouts, int count);
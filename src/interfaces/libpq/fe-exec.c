@@ -40,7 +40,9 @@ char	   *const pgresStatus[] = {
 	"PGRES_NONFATAL_ERROR",
 	"PGRES_FATAL_ERROR",
 	"PGRES_COPY_BOTH",
-	"PGRES_SINGLE_TUPLE"
+	"PGRES_SINGLE_TUPLE",
+	"PGRES_PIPELINE_SYNC",
+	"PGRES_PIPELINE_ABORTED"
 };
 
 /*
@@ -71,6 +73,20 @@ static PGresult *PQexecFinish(PGconn *conn);
 static int	PQsendDescribe(PGconn *conn, char desc_type,
 						   const char *desc_target);
 static int	check_field_number(const PGresult *res, int field_num);
+static PGcmdQueueEntry *pqAllocCmdQueueEntry(PGconn *conn);
+static void pqRecycleCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry);
+static int	pqLaunchCommand(PGconn *conn, PGcmdQueueEntry *entry,
+							PGQueryClass queryclass, const char *query);
+static void pqCommandQueueAdvance(PGconn *conn);
+static void pqPipelineProcessQueue(PGconn *conn);
+static int	pqPipelineFlush(PGconn *conn);
+
+/*
+ * In pipeline mode, commands are only pushed to the server once this much
+ * data has accumulated in the output buffer (or when the application asks for
+ * a Sync or a flush), so that many small commands travel in few packets.
+ */
+#define OUTBUFFER_THRESHOLD	65536
 
 
 /* ----------------
@@ -1210,8 +1226,8 @@ pqRowProcessor(PGconn *conn, const char **errmsgp)
 		/* Stash old result for re-use later */
 		conn->next_result = conn->result;
 		conn->result = res;
-		/* And mark the result ready to return */
-		conn->asyncStatus = PGASYNC_READY;
+		/* And mark the result ready to return, with more to follow */
+		conn->asyncStatus = PGASYNC_READY_MORE;
 	}
 
 	return 1;
@@ -1234,6 +1250,14 @@ fail:
 int
 PQsendQuery(PGconn *conn, const char *query)
 {
+	/*
+	 * The simple Query protocol has an implicit Sync after every message, so
+	 * it can't be used in pipeline mode.  Send the query with the extended
+	 * protocol instead; this means only a single statement is allowed.
+	 */
+	if (conn && conn->pipelineStatus != PQ_PIPELINE_OFF)
+		return PQsendQueryParams(conn, query, 0, NULL, NULL, NULL, NULL, 0);
+
 	if (!PQsendQueryStart(conn))
 		return 0;
 
@@ -1332,6 +1356,8 @@ PQsendPrepare(PGconn *conn,
 			  const char *stmtName, const char *query,
 			  int nParams, const Oid *paramTypes)
 {
+	PGcmdQueueEntry *entry = NULL;
+
 	if (!PQsendQueryStart(conn))
 		return 0;
 
@@ -1363,6 +1389,14 @@ PQsendPrepare(PGconn *conn,
 		return 0;
 	}
 
+	/* in pipeline mode, get a queue entry before sending anything */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		entry = pqAllocCmdQueueEntry(conn);
+		if (entry == NULL)
+			return 0;			/* error msg already set */
+	}
+
 	/* construct the Parse message */
 	if (pqPutMsgStart('P', false, conn) < 0 ||
 		pqPuts(stmtName, conn) < 0 ||
@@ -1389,32 +1423,20 @@ PQsendPrepare(PGconn *conn,
 	if (pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless in pipeline mode */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are doing just a Parse */
-	conn->queryclass = PGQUERY_PREPARE;
-
-	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	conn->last_query = strdup(query);
-
-	/*
-	 * Give the data a push.  In nonblock mode, don't complain if we're unable
-	 * to send it all; PQgetResult() will do any additional flushing needed.
-	 */
-	if (pqFlush(conn) < 0)
+	/* remember we are doing just a Parse, and send it off */
+	if (!pqLaunchCommand(conn, entry, PGQUERY_PREPARE, query))
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
 	return 1;
 
 sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
 	/* error message should be set up already */
 	return 0;
 }
@@ -1480,6 +1502,27 @@ PQsendQueryStart(PGconn *conn)
 						  libpq_gettext("no connection to the server\n"));
 		return false;
 	}
+
+	/*
+	 * In pipeline mode, commands are queued behind whatever is in progress;
+	 * that's the whole point.  We only need to refuse while a COPY is going
+	 * on, since the COPY data would get mixed up with the new command.  The
+	 * result-accumulation state belongs to the command being processed, so
+	 * leave it alone.
+	 */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		if (conn->asyncStatus == PGASYNC_COPY_IN ||
+			conn->asyncStatus == PGASYNC_COPY_OUT ||
+			conn->asyncStatus == PGASYNC_COPY_BOTH)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot queue commands during COPY\n"));
+			return false;
+		}
+		return true;
+	}
+
 	/* Can't send while already busy, either. */
 	if (conn->asyncStatus != PGASYNC_IDLE)
 	{
@@ -1517,6 +1560,7 @@ PQsendQueryGuts(PGconn *conn,
 				int resultFormat)
 {
 	int			i;
+	PGcmdQueueEntry *entry = NULL;
 
 	/* This isn't gonna work on a 2.0 server */
 	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
@@ -1526,9 +1570,18 @@ PQsendQueryGuts(PGconn *conn,
 		return 0;
 	}
 
+	/* in pipeline mode, get a queue entry before sending anything */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		entry = pqAllocCmdQueueEntry(conn);
+		if (entry == NULL)
+			return 0;			/* error msg already set */
+	}
+
 	/*
-	 * We will send Parse (if needed), Bind, Describe Portal, Execute, Sync,
-	 * using specified statement name and the unnamed portal.
+	 * We will send Parse (if needed), Bind, Describe Portal, Execute, Sync
+	 * (unless in pipeline mode), using specified statement name and the
+	 * unnamed portal.
 	 */
 
 	if (command)
@@ -1638,35 +1691,20 @@ PQsendQueryGuts(PGconn *conn,
 		pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless in pipeline mode */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are using extended query protocol */
-	conn->queryclass = PGQUERY_EXTENDED;
-
-	/* and remember the query text too, if possible */
-	/* if insufficient memory, last_query just winds up NULL */
-	if (conn->last_query)
-		free(conn->last_query);
-	if (command)
-		conn->last_query = strdup(command);
-	else
-		conn->last_query = NULL;
-
-	/*
-	 * Give the data a push.  In nonblock mode, don't complain if we're unable
-	 * to send it all; PQgetResult() will do any additional flushing needed.
-	 */
-	if (pqFlush(conn) < 0)
+	/* remember we are using extended query protocol, and send it off */
+	if (!pqLaunchCommand(conn, entry, PGQUERY_EXTENDED, command))
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
 	return 1;
 
 sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
 	/* error message should be set up already */
 	return 0;
 }
@@ -1847,9 +1885,36 @@ PQgetResult(PGconn *conn)
 			break;
 		case PGASYNC_READY:
 			res = pqPrepareAsyncResult(conn);
-			/* Set the state back to BUSY, allowing parsing to proceed. */
+			if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+			{
+				/*
+				 * In pipeline mode, each command yields exactly one result
+				 * (not counting single-row results), so the current command
+				 * is now done.  The next call returns NULL to mark the end
+				 * of its results and moves on to the next queued command,
+				 * except after a Sync, which has no trailing NULL.
+				 */
+				pqCommandQueueAdvance(conn);
+				conn->asyncStatus = PGASYNC_PIPELINE_IDLE;
+				if (res && res->resultStatus == PGRES_PIPELINE_SYNC)
+					pqPipelineProcessQueue(conn);
+			}
+			else
+			{
+				/* Set the state back to BUSY, allowing parsing to proceed. */
+				conn->asyncStatus = PGASYNC_BUSY;
+			}
+			break;
+		case PGASYNC_READY_MORE:
+			/* a single-row result; the command has more results coming */
+			res = pqPrepareAsyncResult(conn);
 			conn->asyncStatus = PGASYNC_BUSY;
 			break;
+		case PGASYNC_PIPELINE_IDLE:
+			/* end of a pipelined command's results; start on the next one */
+			res = NULL;
+			pqPipelineProcessQueue(conn);
+			break;
 		case PGASYNC_COPY_IN:
 			res = getCopyResult(conn, PGRES_COPY_IN);
 			break;
@@ -2026,6 +2091,13 @@ PQexecStart(PGconn *conn)
 	if (!conn)
 		return false;
 
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("synchronous command execution functions are not allowed in pipeline mode\n"));
+		return false;
+	}
+
 	/*
 	 * Silently discard any prior query result that application didn't eat.
 	 * This is probably poor design, but it's here for backward compatibility.
@@ -2220,6 +2292,8 @@ PQsendDescribePortal(PGconn *conn, const char *portal)
 static int
 PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 {
+	PGcmdQueueEntry *entry = NULL;
+
 	/* Treat null desc_target as empty string */
 	if (!desc_target)
 		desc_target = "";
@@ -2235,6 +2309,14 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 		return 0;
 	}
 
+	/* in pipeline mode, get a queue entry before sending anything */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		entry = pqAllocCmdQueueEntry(conn);
+		if (entry == NULL)
+			return 0;			/* error msg already set */
+	}
+
 	/* construct the Describe message */
 	if (pqPutMsgStart('D', false, conn) < 0 ||
 		pqPutc(desc_type, conn) < 0 ||
@@ -2242,37 +2324,487 @@ PQsendDescribe(PGconn *conn, char desc_type, const char *desc_target)
 		pqPutMsgEnd(conn) < 0)
 		goto sendFailed;
 
-	/* construct the Sync message */
-	if (pqPutMsgStart('S', false, conn) < 0 ||
-		pqPutMsgEnd(conn) < 0)
+	/* construct the Sync message, unless in pipeline mode */
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF &&
+		(pqPutMsgStart('S', false, conn) < 0 ||
+		 pqPutMsgEnd(conn) < 0))
 		goto sendFailed;
 
-	/* remember we are doing a Describe */
-	conn->queryclass = PGQUERY_DESCRIBE;
+	/*
+	 * remember we are doing a Describe (the last-query string is not
+	 * relevant now), and send it off
+	 */
+	if (!pqLaunchCommand(conn, entry, PGQUERY_DESCRIBE, NULL))
+		goto sendFailed;
 
-	/* reset last-query string (not relevant now) */
-	if (conn->last_query)
+	return 1;
+
+sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
+	/* error message should be set up already */
+	return 0;
+}
+
+/* ====== pipeline mode support ======== */
+
+/*
+ * pqAllocCmdQueueEntry
+ *		Get a command queue entry, recycling a previously used one if we can.
+ *
+ * Returns NULL, with conn->errorMessage set, if out of memory.
+ */
+static PGcmdQueueEntry *
+pqAllocCmdQueueEntry(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	if (conn->cmd_queue_recycle == NULL)
+	{
+		entry = (PGcmdQueueEntry *) malloc(sizeof(PGcmdQueueEntry));
+		if (entry == NULL)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("out of memory\n"));
+			return NULL;
+		}
+	}
+	else
+	{
+		entry = conn->cmd_queue_recycle;
+		conn->cmd_queue_recycle = entry->next;
+	}
+	entry->next = NULL;
+	entry->query = NULL;
+
+	return entry;
+}
+
+/*
+ * pqRecycleCmdQueueEntry
+ *		Push a command queue entry onto the freelist.  entry may be NULL.
+ */
+static void
+pqRecycleCmdQueueEntry(PGconn *conn, PGcmdQueueEntry *entry)
+{
+	if (entry == NULL)
+		return;
+
+	/* recyclable entries should not have a follow-on command */
+	Assert(entry->next == NULL);
+
+	if (entry->query)
+	{
+		free(entry->query);
+		entry->query = NULL;
+	}
+
+	entry->next = conn->cmd_queue_recycle;
+	conn->cmd_queue_recycle = entry;
+}
+
+/*
+ * pqLaunchCommand
+ *		Common tail of the query-sending routines, run once all messages for
+ *		the command are in the output buffer.
+ *
+ * Outside pipeline mode, remember the query class and text, push the data
+ * out and mark the connection busy.  In pipeline mode, record the same
+ * information in entry and append it to the command queue instead; if
+ * nothing was in progress, the new command becomes the current one.
+ *
+ * Returns 1 if OK, 0 if error (conn->errorMessage is set).  On error, the
+ * caller still owns entry.
+ */
+static int
+pqLaunchCommand(PGconn *conn, PGcmdQueueEntry *entry,
+				PGQueryClass queryclass, const char *query)
+{
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		conn->queryclass = queryclass;
+
+		/* and remember the query text too, if possible */
+		/* if insufficient memory, last_query just winds up NULL */
+		if (conn->last_query)
+			free(conn->last_query);
+		conn->last_query = query ? strdup(query) : NULL;
+
+		/*
+		 * Give the data a push.  In nonblock mode, don't complain if we're
+		 * unable to send it all; PQgetResult() will do any additional
+		 * flushing needed.
+		 */
+		if (pqFlush(conn) < 0)
+			return 0;
+
+		/* OK, it's launched! */
+		conn->asyncStatus = PGASYNC_BUSY;
+		return 1;
+	}
+
+	Assert(entry != NULL);
+	entry->queryclass = queryclass;
+	/* if insufficient memory, the query text just winds up NULL */
+	entry->query = query ? strdup(query) : NULL;
+
+	/*
+	 * Only push the data out if enough has piled up; PQpipelineSync and
+	 * PQsendFlushRequest take care of the rest.
+	 */
+	if (pqPipelineFlush(conn) < 0)
+		return 0;
+
+	/* OK, it's queued */
+	if (conn->cmd_queue_tail == NULL)
+		conn->cmd_queue_head = entry;
+	else
+		conn->cmd_queue_tail->next = entry;
+	conn->cmd_queue_tail = entry;
+
+	/*
+	 * If the connection was idle, start processing this command right away.
+	 * Otherwise it's picked up once the results of the commands ahead of it
+	 * have been consumed.
+	 */
+	if (conn->asyncStatus == PGASYNC_IDLE)
+		pqPipelineProcessQueue(conn);
+
+	return 1;
+}
+
+/*
+ * pqCommandQueueAdvance
+ *		Remove the current command from the head of the queue, once all its
+ *		results have been returned to the application.
+ */
+static void
+pqCommandQueueAdvance(PGconn *conn)
+{
+	PGcmdQueueEntry *prevquery;
+
+	if (conn->cmd_queue_head == NULL)
+		return;
+
+	prevquery = conn->cmd_queue_head;
+	conn->cmd_queue_head = prevquery->next;
+	if (conn->cmd_queue_head == NULL)
+		conn->cmd_queue_tail = NULL;
+
+	prevquery->next = NULL;
+	pqRecycleCmdQueueEntry(conn, prevquery);
+}
+
+/*
+ * pqPipelineProcessQueue
+ *		Make the command at the head of the queue the current one, if the
+ *		results of the previous one have been consumed.
+ *
+ * If the pipeline is aborted, commands other than a Sync are not going to be
+ * executed by the server; for those we produce a PGRES_PIPELINE_ABORTED
+ * result right away.
+ */
+static void
+pqPipelineProcessQueue(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	switch (conn->asyncStatus)
+	{
+		case PGASYNC_COPY_IN:
+		case PGASYNC_COPY_OUT:
+		case PGASYNC_COPY_BOTH:
+		case PGASYNC_READY:
+		case PGASYNC_READY_MORE:
+		case PGASYNC_BUSY:
+			/* client still has to process the current command's results */
+			return;
+		case PGASYNC_IDLE:
+		case PGASYNC_PIPELINE_IDLE:
+			break;
+	}
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+		return;
+
+	/* Nothing more queued?  Then the connection is idle. */
+	entry = conn->cmd_queue_head;
+	if (entry == NULL)
 	{
+		conn->asyncStatus = PGASYNC_IDLE;
+		return;
+	}
+
+	/* Make the entry the current command; conn takes over the query text */
+	conn->queryclass = entry->queryclass;
+	if (conn->last_query)
 		free(conn->last_query);
-		conn->last_query = NULL;
+	conn->last_query = entry->query;
+	entry->query = NULL;
+
+	/* initialize async result-accumulation state */
+	pqClearAsyncResult(conn);
+
+	/* reset single-row processing mode */
+	conn->singleRowMode = false;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_ABORTED &&
+		entry->queryclass != PGQUERY_SYNC)
+	{
+		conn->result = PQmakeEmptyPGresult(conn, PGRES_PIPELINE_ABORTED);
+		if (!conn->result)
+		{
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("out of memory\n"));
+			pqSaveErrorResult(conn);
+		}
+		conn->asyncStatus = PGASYNC_READY;
 	}
+	else
+		conn->asyncStatus = PGASYNC_BUSY;
+}
+
+/*
+ * pqPipelineFlush
+ *		In pipeline mode, flush the output buffer only if it holds at least
+ *		OUTBUFFER_THRESHOLD bytes; otherwise behave like pqFlush.
+ */
+static int
+pqPipelineFlush(PGconn *conn)
+{
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF ||
+		conn->outCount >= OUTBUFFER_THRESHOLD)
+		return pqFlush(conn);
+	return 0;
+}
+
+/*
+ * PQpipelineStatus
+ *		Returns the current pipeline mode status of the connection.
+ */
+PGpipelineStatus
+PQpipelineStatus(const PGconn *conn)
+{
+	if (!conn)
+		return PQ_PIPELINE_OFF;
+
+	return conn->pipelineStatus;
+}
+
+/*
+ * PQenterPipelineMode
+ *		Put an idle connection in pipeline mode.
+ *
+ * Returns 1 on success, 0 on failure (conn->errorMessage is set).  Entering
+ * pipeline mode when already in it is a no-op.
+ *
+ * In pipeline mode, commands sent with the PQsend* functions are queued
+ * without waiting for the results of earlier ones, and no Sync is sent after
+ * each of them; the application marks the end of a batch with
+ * PQpipelineSync.  Results are consumed with PQgetResult, in the order the
+ * commands were sent.
+ */
+int
+PQenterPipelineMode(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	/* succeed with no action if already in pipeline mode */
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+		return 1;
+
+	if (conn->asyncStatus != PGASYNC_IDLE)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot enter pipeline mode, connection not idle\n"));
+		return 0;
+	}
+
+	/* This isn't gonna work on a 2.0 server */
+	if (PG_PROTOCOL_MAJOR(conn->pversion) < 3)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("function requires at least protocol version 3.0\n"));
+		return 0;
+	}
+
+	conn->pipelineStatus = PQ_PIPELINE_ON;
+
+	return 1;
+}
+
+/*
+ * PQexitPipelineMode
+ *		End pipeline mode and return to normal command mode.
+ *
+ * Returns 1 on success (including when not in pipeline mode), 0 if there
+ * are still commands whose results haven't been consumed, in which case
+ * conn->errorMessage is set.
+ */
+int
+PQexitPipelineMode(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+		return 1;
+
+	switch (conn->asyncStatus)
+	{
+		case PGASYNC_READY:
+		case PGASYNC_READY_MORE:
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot exit pipeline mode with uncollected results\n"));
+			return 0;
+
+		case PGASYNC_BUSY:
+		case PGASYNC_PIPELINE_IDLE:
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot exit pipeline mode while busy\n"));
+			return 0;
+
+		case PGASYNC_COPY_IN:
+		case PGASYNC_COPY_OUT:
+		case PGASYNC_COPY_BOTH:
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot exit pipeline mode while in COPY\n"));
+			return 0;
+
+		case PGASYNC_IDLE:
+			/* OK */
+			break;
+	}
+
+	/* still work to process */
+	if (conn->cmd_queue_head != NULL)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot exit pipeline mode with uncollected results\n"));
+		return 0;
+	}
+
+	conn->pipelineStatus = PQ_PIPELINE_OFF;
+
+	/* Flush any pending data in out buffer */
+	if (pqFlush(conn) < 0)
+		return 0;				/* error message is setup already */
+
+	return 1;
+}
+
+/*
+ * PQpipelineSync
+ *		Send a Sync message as part of a pipeline, and flush to server.
+ *
+ * The Sync marks the end of a batch of commands: if one of them fails, the
+ * server skips the rest up to the Sync.  Its result is PGRES_PIPELINE_SYNC.
+ *
+ * Returns 1 on success, 0 on failure (conn->errorMessage is set).
+ */
+int
+PQpipelineSync(PGconn *conn)
+{
+	PGcmdQueueEntry *entry;
+
+	if (!conn)
+		return 0;
+
+	if (conn->pipelineStatus == PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("cannot send pipeline when not in pipeline mode\n"));
+		return 0;
+	}
+
+	switch (conn->asyncStatus)
+	{
+		case PGASYNC_COPY_IN:
+		case PGASYNC_COPY_OUT:
+		case PGASYNC_COPY_BOTH:
+			printfPQExpBuffer(&conn->errorMessage,
+							  libpq_gettext("cannot send pipeline while in COPY\n"));
+			return 0;
+		default:
+			break;
+	}
+
+	entry = pqAllocCmdQueueEntry(conn);
+	if (entry == NULL)
+		return 0;				/* error msg already set */
+
+	/* construct the Sync message */
+	if (pqPutMsgStart('S', false, conn) < 0 ||
+		pqPutMsgEnd(conn) < 0)
+		goto sendFailed;
 
 	/*
-	 * Give the data a push.  In nonblock mode, don't complain if we're unable
-	 * to send it all; PQgetResult() will do any additional flushing needed.
+	 * Queue it and give the data a push.  In nonblock mode, don't complain if
+	 * we're unable to send it all; PQgetResult() will do any additional
+	 * flushing needed.
 	 */
+	entry->queryclass = PGQUERY_SYNC;
 	if (pqFlush(conn) < 0)
 		goto sendFailed;
 
-	/* OK, it's launched! */
-	conn->asyncStatus = PGASYNC_BUSY;
+	if (conn->cmd_queue_tail == NULL)
+		conn->cmd_queue_head = entry;
+	else
+		conn->cmd_queue_tail->next = entry;
+	conn->cmd_queue_tail = entry;
+
+	if (conn->asyncStatus == PGASYNC_IDLE)
+		pqPipelineProcessQueue(conn);
+
 	return 1;
 
 sendFailed:
+	pqRecycleCmdQueueEntry(conn, entry);
 	/* error message should be set up already */
 	return 0;
 }
 
+/*
+ * PQsendFlushRequest
+ *		Send a Flush message to the server, asking it to send back any
+ *		results it has buffered without waiting for a Sync.
+ *
+ * Returns 1 on success, 0 on failure (conn->errorMessage is set).
+ */
+int
+PQsendFlushRequest(PGconn *conn)
+{
+	if (!conn)
+		return 0;
+
+	/* Don't try to send if we know there's no live connection. */
+	if (conn->status != CONNECTION_OK)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("no connection to the server\n"));
+		return 0;
+	}
+
+	/* Can't send while in COPY, either. */
+	if (conn->asyncStatus == PGASYNC_COPY_IN ||
+		conn->asyncStatus == PGASYNC_COPY_OUT ||
+		conn->asyncStatus == PGASYNC_COPY_BOTH)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("another command is already in progress\n"));
+		return 0;
+	}
+
+	if (pqPutMsgStart('H', false, conn) < 0 ||
+		pqPutMsgEnd(conn) < 0)
+		return 0;				/* error message should be set up already */
+
+	if (pqPipelineFlush(conn) < 0)
+		return 0;
+
+	return 1;
+}
+
 /*
  * PQnotifies
  *	  returns a PGnotify* structure of the latest async notification
@@ -2666,6 +3198,13 @@ PQfn(PGconn *conn,
 	/* clear the error string */
 	resetPQExpBuffer(&conn->errorMessage);
 
+	if (conn->pipelineStatus != PQ_PIPELINE_OFF)
+	{
+		printfPQExpBuffer(&conn->errorMessage,
+						  libpq_gettext("PQfn not allowed in pipeline mode\n"));
+		return NULL;
+	}
+
 	if (conn->sock == PGINVALID_SOCKET || conn->asyncStatus != PGASYNC_IDLE ||
 		conn->result != NULL)
 	{
@@ -0,0 +1,91 @@
+# Tests for the built-in connection pooler.  Clients connect to the
+# connection proxy over its Unix-domain socket, which the proxy cannot
+# have on Windows.
+
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More;
+if ($windows_os)
+{
+	plan skip_all => "connection proxies are not supported on Windows";
+}
+else
+{
+	plan tests => 9;
+}
+
+my $node = get_new_node('master');
+my $proxy_port = get_free_port();
+$node->init;
+$node->append_conf(
+	'postgresql.conf', qq{
+connection_proxies = 1
+proxy_port = $proxy_port
+session_pool_size = 1
+});
+$node->start;
+
+# Run the given SQL in one session through the proxy.  Each statement is
+# sent as a separate query, so it may be run by a different backend unless
+# the session is pinned.
+sub proxy_psql
+{
+	my ($sql, $connopts) = @_;
+	my ($stdout, $stderr);
+
+	$connopts = '' unless defined $connopts;
+	IPC::Run::run [
+		'psql', '-XAtq', '-d',
+		"host=" . $node->host . " port=$proxy_port dbname=postgres $connopts",
+		'-f', '-'
+	  ],
+	  '<', \$sql, '>', \$stdout, '2>', \$stderr;
+	chomp $stdout;
+	return ($stdout, $stderr);
+}
+
+my ($out, $err) = proxy_psql('SELECT 1');
+is($out, '1', 'query through connection proxy');
+
+# Sessions with the same connection parameters share the pool's backend
+my ($pid1) = proxy_psql('SELECT pg_backend_pid()');
+my ($pid2) = proxy_psql('SELECT pg_backend_pid()');
+is($pid1, $pid2, 'consecutive sessions reuse the pooled backend');
+
+($out) = proxy_psql('SHOW application_name', 'application_name=pooled');
+is($out, 'pooled', 'startup parameters are passed to the backend');
+
+# Session state pins the session to its backend
+($out) = proxy_psql(
+	"SET work_mem = '1234kB';
+	 SELECT 1;
+	 SHOW work_mem;");
+is($out, "1\n1234kB", 'session-level SET survives across transactions');
+
+($out, $err) = proxy_psql(
+	"CREATE TEMP TABLE proxy_tmp (a int);
+	 INSERT INTO proxy_tmp VALUES (42);
+	 SELECT a FROM proxy_tmp;
+	 SELECT pg_backend_pid();");
+my ($tmp_result, $pinned_pid) = split /\n/, $out;
+is($tmp_result, '42', 'temporary table survives across transactions');
+
+# A pinned backend goes away with its session
+my ($pid3) = proxy_psql('SELECT pg_backend_pid()');
+isnt($pid3, $pinned_pid, 'pinned backend is not reused by other sessions');
+
+($out) = proxy_psql(
+	"PREPARE proxy_stmt AS SELECT 10 + 1;
+	 EXECUTE proxy_stmt;");
+is($out, '11', 'prepared statement survives across transactions');
+
+# Errors from the backend reach the client, and the session goes on
+($out, $err) = proxy_psql(
+	"SELECT 1/0;
+	 SELECT 'after error';");
+like($err, qr/division by zero/, 'error is relayed to the client');
+is($out, 'after error', 'session continues after an error');
+
+$node->stop;
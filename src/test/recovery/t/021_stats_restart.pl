@@ -0,0 +1,82 @@
+#
+# Tests that the statistics in shared memory are kept across a clean
+# restart, and discarded after a crash and after recovery.
+#
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 10;
+
+my $node_master = get_new_node('master');
+$node_master->init(allows_streaming => 1);
+$node_master->append_conf('postgresql.conf', 'autovacuum = off');
+$node_master->start;
+
+my $statfile = $node_master->data_dir . '/pg_stat/pgstat.stat';
+my $stats_query =
+  "SELECT n_tup_ins, seq_scan FROM pg_stat_user_tables WHERE relname = 'tab_stats'";
+
+$node_master->safe_psql('postgres', 'CREATE TABLE tab_stats (a int)');
+$node_master->safe_psql('postgres',
+	'INSERT INTO tab_stats SELECT generate_series(1, 10)');
+$node_master->safe_psql('postgres', 'SELECT count(*) FROM tab_stats');
+
+# Backends report their counts when they exit, so wait for that
+$node_master->poll_query_until('postgres', $stats_query, '10|1')
+  or die "Timed out while waiting for statistics to be reported";
+
+# A clean shutdown saves the statistics, and the next start loads them
+$node_master->stop;
+ok(-f $statfile, 'statistics file written at shutdown');
+$node_master->start;
+is($node_master->safe_psql('postgres', $stats_query),
+	'10|1', 'statistics kept across a clean restart');
+ok(!-f $statfile, 'statistics file removed once loaded');
+
+# Set up a standby, whose statistics are independent of the master's
+my $backup_name = 'my_backup';
+$node_master->backup($backup_name);
+my $node_standby = get_new_node('standby');
+$node_standby->init_from_backup($node_master, $backup_name,
+	has_streaming => 1);
+$node_standby->start;
+
+# An immediate shutdown doesn't save anything, and recovery starts from
+# scratch
+$node_master->safe_psql('postgres', 'SELECT count(*) FROM tab_stats');
+$node_master->poll_query_until('postgres', $stats_query, '10|2')
+  or die "Timed out while waiting for statistics to be reported";
+$node_master->stop('immediate');
+ok(!-f $statfile, 'no statistics file written at immediate shutdown');
+$node_master->start;
+is($node_master->safe_psql('postgres', $stats_query),
+	'0|0', 'statistics discarded after a crash');
+
+# The file a standby saves at a clean shutdown is stale once it replayed
+# more WAL, so it's not loaded, nor after promotion.
+$node_master->safe_psql('postgres',
+	'INSERT INTO tab_stats SELECT generate_series(11, 20)');
+$node_master->wait_for_catchup($node_standby, 'replay',
+	$node_master->lsn('insert'));
+$node_standby->safe_psql('postgres', 'SELECT count(*) FROM tab_stats');
+$node_standby->poll_query_until('postgres',
+	"SELECT seq_scan FROM pg_stat_user_tables WHERE relname = 'tab_stats'",
+	'1')
+  or die "Timed out while waiting for statistics to be reported";
+
+my $standby_statfile = $node_standby->data_dir . '/pg_stat/pgstat.stat';
+$node_standby->stop;
+ok(-f $standby_statfile, 'statistics file written at standby shutdown');
+$node_standby->start;
+ok(!-f $standby_statfile, 'statistics file removed by recovery');
+is($node_standby->safe_psql('postgres', $stats_query),
+	'0|0', 'statistics not loaded by a standby');
+
+$node_standby->promote;
+$node_standby->poll_query_until('postgres', 'SELECT NOT pg_is_in_recovery()')
+  or die "Timed out while waiting for promotion";
+is($node_standby->safe_psql('postgres', $stats_query),
+	'0|0', 'statistics not loaded at promotion');
+is($node_standby->safe_psql('postgres', 'SELECT count(*) FROM tab_stats'),
+	'20', 'promoted standby has the replayed rows');
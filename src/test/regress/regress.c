@@ -19,7 +19,9 @@
 #include <math.h>
 #include <signal.h>
 
+#include "access/brin.h"
 #include "access/htup_details.h"
+#include "access/table.h"
 #include "access/transam.h"
 #include "access/tuptoaster.h"
 #include "access/xact.h"
@@ -38,6 +40,7 @@
 #include "utils/builtins.h"
 #include "utils/geo_decls.h"
 #include "utils/rel.h"
+#include "utils/snapmgr.h"
 #include "utils/typcache.h"
 #include "utils/memutils.h"
 
@@ -1050,3 +1053,32 @@ test_support_func(PG_FUNCTION_ARGS)
 
 	PG_RETURN_POINTER(ret);
 }
+
+/*
+ * Count the heap blocks that a BRIN index on the given column says may hold
+ * rows satisfying "attnum <strategy> value", or return NULL if there's no
+ * usable index.
+ */
+PG_FUNCTION_INFO_V1(test_brin_candidate_blocks);
+Datum
+test_brin_candidate_blocks(PG_FUNCTION_ARGS)
+{
+	Oid			relid = PG_GETARG_OID(0);
+	AttrNumber	attnum = PG_GETARG_INT16(1);
+	StrategyNumber strategy = PG_GETARG_INT16(2);
+	int64		value = PG_GETARG_INT64(3);
+	Relation	rel;
+	TIDBitmap  *blocks;
+	BlockNumber nblocks;
+
+	rel = table_open(relid, AccessShareLock);
+	nblocks = brin_candidate_blocks(rel, attnum, strategy,
+									Int64GetDatum(value), INT8OID,
+									GetActiveSnapshot(), &blocks);
+	table_close(rel, AccessShareLock);
+
+	if (nblocks == InvalidBlockNumber)
+		PG_RETURN_NULL();
+	tbm_free(blocks);
+	PG_RETURN_INT64((int64) nblocks);
+}
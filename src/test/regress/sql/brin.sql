@@ -499,3 +499,33 @@ SELECT * FROM brintest_3 WHERE b < '0';
 
 DROP TABLE brintest_3;
 RESET enable_seqscan;
+
+-- Candidate blocks for a range predicate, as used to skip blocks when
+-- offloading a filter (strategies: 1 is <, 3 is =, 5 is >)
+CREATE TABLE brin_skip (a int, b int);
+INSERT INTO brin_skip SELECT i, i % 7 FROM generate_series(1, 100000) s(i);
+CREATE INDEX brin_skip_a_idx ON brin_skip USING brin (a) WITH (pages_per_range = 4);
+ANALYZE brin_skip;
+SELECT pg_relation_size('brin_skip') / current_setting('block_size')::int AS pages;
+SELECT test_brin_candidate_blocks('brin_skip', 1::int2, 1::int2, 100);
+SELECT test_brin_candidate_blocks('brin_skip', 1::int2, 3::int2, 50000);
+SELECT test_brin_candidate_blocks('brin_skip', 1::int2, 5::int2, 0);
+SELECT test_brin_candidate_blocks('brin_skip', 1::int2, 5::int2, 100000);
+-- no index on b
+SELECT test_brin_candidate_blocks('brin_skip', 2::int2, 1::int2, 100);
+
+-- MIN/MAX answered from the ranges the BRIN summaries point at
+EXPLAIN (COSTS OFF)
+SELECT min(a), max(a) FROM brin_skip;
+SELECT min(a), max(a) FROM brin_skip;
+EXPLAIN (COSTS OFF)
+SELECT max(a) FROM brin_skip WHERE b = 3;
+SELECT max(a) FROM brin_skip WHERE b = 3;
+-- the summaries still cover deleted rows, so a cached plan must fall back
+-- to scanning everything when the bounded scan comes up empty
+PREPARE brin_skip_min AS SELECT min(a), max(a) FROM brin_skip;
+EXECUTE brin_skip_min;
+DELETE FROM brin_skip WHERE a < 5000 OR a > 95000;
+EXECUTE brin_skip_min;
+DEALLOCATE brin_skip_min;
+DROP TABLE brin_skip;
@@ -160,3 +160,54 @@ VACUUM delete_test_table;
 -- The vacuum above should've turned the leaf page into a fast root. We just
 -- need to insert some rows to cause the fast root page to split.
 INSERT INTO delete_test_table SELECT i, 1, 2, 3 FROM generate_series(1,1000) i;
+
+--
+-- Test deduplication with the deduplicate_items storage parameter
+--
+CREATE TABLE dedup_unique_test_table (a int) WITH (autovacuum_enabled=false);
+CREATE INDEX dedup_test_idx ON dedup_unique_test_table (a) WITH (deduplicate_items=on);
+INSERT INTO dedup_unique_test_table SELECT i % 10 FROM generate_series(1,10000) i;
+-- Posting list splits and VACUUM of posting list tuples
+INSERT INTO dedup_unique_test_table SELECT i % 10 FROM generate_series(1,1000) i;
+DELETE FROM dedup_unique_test_table WHERE a = 1;
+VACUUM dedup_unique_test_table;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT a, count(*) FROM dedup_unique_test_table WHERE a < 4 GROUP BY a ORDER BY a;
+SELECT count(*) FROM dedup_unique_test_table WHERE a = 7;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+-- Rebuild with deduplication during CREATE INDEX
+REINDEX INDEX dedup_test_idx;
+SELECT count(*) FROM dedup_unique_test_table WHERE a = 3;
+-- Can be disabled
+ALTER INDEX dedup_test_idx SET (deduplicate_items = off);
+INSERT INTO dedup_unique_test_table SELECT 3 FROM generate_series(1,500);
+SELECT count(*) FROM dedup_unique_test_table WHERE a = 3;
+SELECT reloptions FROM pg_class WHERE oid = 'dedup_test_idx'::regclass;
+-- Fail while setting improper values
+CREATE INDEX dedup_idx_err ON dedup_unique_test_table (a) WITH (deduplicate_items = 'string');
+DROP TABLE dedup_unique_test_table;
+
+--
+-- Test repeated index probes that reuse the previously visited leaf page
+--
+CREATE TABLE btree_probe_test (a int, b int);
+INSERT INTO btree_probe_test SELECT i, i % 7 FROM generate_series(1, 20000) i;
+CREATE INDEX btree_probe_test_a ON btree_probe_test (a);
+VACUUM ANALYZE btree_probe_test;
+SET enable_seqscan = off;
+SET enable_bitmapscan = off;
+SELECT count(*), sum(b) FROM btree_probe_test
+  WHERE a = ANY ('{5, 6, 7, 300, 301, 9999, 20000, 20001, -1}'::int[]);
+SELECT a FROM btree_probe_test
+  WHERE a = ANY ('{19999, 2, 3, 500, 17}'::int[]) ORDER BY a DESC;
+SET enable_hashjoin = off;
+SET enable_mergejoin = off;
+SELECT count(*), sum(t.b) FROM generate_series(1000, 1500) g
+  JOIN btree_probe_test t ON t.a = g;
+RESET enable_hashjoin;
+RESET enable_mergejoin;
+RESET enable_seqscan;
+RESET enable_bitmapscan;
+DROP TABLE btree_probe_test;
@@ -0,0 +1,75 @@
+--
+-- Learned cardinality feedback
+--
+
+-- Return the estimated and actual row counts of the top plan node
+create function card_fb_estimated_rows(text) returns table (estimated int, actual int)
+language plpgsql as
+$$
+declare
+    ln text;
+    tmp text[];
+    first_row bool := true;
+begin
+    for ln in
+        execute format('explain analyze %s', $1)
+    loop
+        if first_row then
+            first_row := false;
+            tmp := regexp_match(ln, 'rows=(\d*) .* rows=(\d*)');
+            return query select tmp[1]::int, tmp[2]::int;
+        end if;
+    end loop;
+end;
+$$;
+
+-- a and b are perfectly correlated, so the planner underestimates a = b
+CREATE TABLE card_fb (a INT, b INT);
+INSERT INTO card_fb SELECT mod(i, 100), mod(i, 100) FROM generate_series(1, 10000) s(i);
+ANALYZE card_fb;
+
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE a = 1 AND b = 1');
+
+SET enable_cardinality_feedback = on;
+SET cardinality_feedback_decay = 0;
+
+-- the first execution teaches the planner, the second one benefits
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE a = 1 AND b = 1');
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE a = 1 AND b = 1');
+
+-- clause order doesn't matter, constants do
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE b = 1 AND a = 1');
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE a = 2 AND b = 2');
+
+-- nothing is used while disabled
+SET enable_cardinality_feedback = off;
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE a = 1 AND b = 1');
+SET enable_cardinality_feedback = on;
+
+-- with decay, the planner's trust grows with the number of observations
+SELECT pg_cardinality_feedback_reset();
+SET cardinality_feedback_decay = 0.5;
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE a = 1 AND b = 1');
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE a = 1 AND b = 1');
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb WHERE a = 1 AND b = 1');
+
+-- joins
+CREATE TABLE card_fb_join (a INT, b INT);
+INSERT INTO card_fb_join SELECT mod(i, 10), mod(i, 10) FROM generate_series(1, 1000) s(i);
+ANALYZE card_fb_join;
+
+SET cardinality_feedback_decay = 0;
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb_join t1 JOIN card_fb_join t2 ON t1.a = t2.a AND t1.b = t2.b');
+SELECT * FROM card_fb_estimated_rows('SELECT * FROM card_fb_join t1 JOIN card_fb_join t2 ON t2.b = t1.b AND t2.a = t1.a');
+
+RESET enable_mergejoin;
+RESET enable_nestloop;
+RESET cardinality_feedback_decay;
+RESET enable_cardinality_feedback;
+SELECT pg_cardinality_feedback_reset();
+
+DROP TABLE card_fb;
+DROP TABLE card_fb_join;
+DROP FUNCTION card_fb_estimated_rows(text);
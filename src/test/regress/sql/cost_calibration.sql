@@ -0,0 +1,44 @@
+--
+-- Cost constant calibration
+--
+SELECT pg_cost_calibration_reset();
+
+-- nothing is sampled while disabled
+DO $$
+BEGIN
+    EXECUTE 'EXPLAIN (ANALYZE, BUFFERS) SELECT count(*) FROM tenk1 WHERE ten > 3';
+END
+$$;
+SELECT count(*) FROM pg_cost_calibration;
+
+SET enable_cost_calibration = on;
+
+-- nor without timing or buffer counts
+DO $$
+BEGIN
+    EXECUTE 'EXPLAIN (ANALYZE, TIMING OFF, BUFFERS) SELECT count(*) FROM tenk1 WHERE ten > 3';
+    EXECUTE 'EXPLAIN ANALYZE SELECT count(*) FROM tenk1 WHERE ten > 3';
+END
+$$;
+SELECT count(*) FROM pg_cost_calibration;
+
+SET enable_mergejoin = off;
+SET enable_nestloop = off;
+DO $$
+BEGIN
+    EXECUTE 'EXPLAIN (ANALYZE, BUFFERS) SELECT count(*) FROM tenk1 WHERE ten > 3';
+    EXECUTE 'EXPLAIN (ANALYZE, BUFFERS) SELECT * FROM tenk1 WHERE unique1 = 42';
+    EXECUTE 'EXPLAIN (ANALYZE, BUFFERS) SELECT * FROM tenk1 ORDER BY stringu1';
+    EXECUTE 'EXPLAIN (ANALYZE, BUFFERS) SELECT count(*) FROM tenk1 a JOIN tenk1 b ON a.unique1 = b.unique2';
+END
+$$;
+RESET enable_mergejoin;
+RESET enable_nestloop;
+
+SELECT node_type, tablespace, parameter, samples > 0 AS sampled
+  FROM pg_cost_calibration
+  ORDER BY node_type, parameter;
+
+RESET enable_cost_calibration;
+SELECT pg_cost_calibration_reset();
+SELECT count(*) FROM pg_cost_calibration;
@@ -50,3 +50,25 @@ select count(*) > 0 as ok from gin_test_tbl where i @> array[1];
 select count(*) > 0 as ok from gin_test_tbl where i @> array[1];
 
 reset gin_fuzzy_search_limit;
+
+-- Test parallel index build
+create table gin_parallel_tbl(i int4[]) with (parallel_workers = 2);
+insert into gin_parallel_tbl select array[1, g % 100, g] from generate_series(1, 20000) g;
+insert into gin_parallel_tbl select null from generate_series(1, 10);
+insert into gin_parallel_tbl select '{}' from generate_series(1, 10);
+set max_parallel_maintenance_workers = 2;
+set min_parallel_table_scan_size = 0;
+set maintenance_work_mem = '1MB';
+create index gin_parallel_idx on gin_parallel_tbl using gin (i);
+reset max_parallel_maintenance_workers;
+reset min_parallel_table_scan_size;
+reset maintenance_work_mem;
+
+set enable_seqscan = off;
+select count(*) from gin_parallel_tbl where i @> array[1];
+select count(*) from gin_parallel_tbl where i @> array[42];
+select count(*) from gin_parallel_tbl where i @> array[19999];
+select count(*) from gin_parallel_tbl where i <@ array[1, 2, 3];
+reset enable_seqscan;
+
+drop table gin_parallel_tbl;
@@ -0,0 +1,62 @@
+--
+-- Alternative join search strategies: DPccp and the greedy search
+--
+-- These must find the same results as the standard join search; the
+-- plans chosen may differ, so we only check the results here.
+CREATE TABLE js_fact AS
+  SELECT i, i % 10 AS d1, i % 20 AS d2, i % 5 AS d3, i % 4 AS d4
+  FROM generate_series(1, 1000) i;
+CREATE TABLE js_d1 AS SELECT id, id % 2 AS grp FROM generate_series(0, 9) id;
+CREATE TABLE js_d2 AS SELECT id FROM generate_series(0, 19) id;
+CREATE TABLE js_d3 AS SELECT id FROM generate_series(0, 3) id;
+CREATE TABLE js_d4 AS SELECT id FROM generate_series(0, 3) id;
+ANALYZE js_fact, js_d1, js_d2, js_d3, js_d4;
+-- a star join
+SELECT count(*) FROM js_fact f, js_d1, js_d2, js_d3, js_d4
+  WHERE f.d1 = js_d1.id AND f.d2 = js_d2.id AND f.d3 = js_d3.id
+    AND f.d4 = js_d4.id AND js_d1.grp = 0;
+-- with an outer join, which limits the legal join orders
+SELECT count(*) FROM js_fact f
+  JOIN js_d1 ON f.d1 = js_d1.id
+  JOIN js_d2 ON f.d2 = js_d2.id
+  LEFT JOIN js_d3 ON f.d3 = js_d3.id
+  JOIN js_d4 ON f.d4 = js_d4.id
+  WHERE js_d1.grp = 0;
+-- with a semijoin
+SELECT count(*) FROM js_fact f, js_d1, js_d2
+  WHERE f.d1 = js_d1.id AND f.d2 = js_d2.id AND js_d1.grp = 0
+    AND EXISTS (SELECT 1 FROM js_d3 WHERE js_d3.id = f.d3);
+-- a cartesian product
+SELECT count(*) FROM js_d1, js_d3 WHERE js_d1.grp = 0;
+SET enable_dpccp = on;
+SELECT count(*) FROM js_fact f, js_d1, js_d2, js_d3, js_d4
+  WHERE f.d1 = js_d1.id AND f.d2 = js_d2.id AND f.d3 = js_d3.id
+    AND f.d4 = js_d4.id AND js_d1.grp = 0;
+SELECT count(*) FROM js_fact f
+  JOIN js_d1 ON f.d1 = js_d1.id
+  JOIN js_d2 ON f.d2 = js_d2.id
+  LEFT JOIN js_d3 ON f.d3 = js_d3.id
+  JOIN js_d4 ON f.d4 = js_d4.id
+  WHERE js_d1.grp = 0;
+SELECT count(*) FROM js_fact f, js_d1, js_d2
+  WHERE f.d1 = js_d1.id AND f.d2 = js_d2.id AND js_d1.grp = 0
+    AND EXISTS (SELECT 1 FROM js_d3 WHERE js_d3.id = f.d3);
+-- DPccp can't do this one; the usual search is used instead
+SELECT count(*) FROM js_d1, js_d3 WHERE js_d1.grp = 0;
+RESET enable_dpccp;
+SET greedy_join_threshold = 2;
+SELECT count(*) FROM js_fact f, js_d1, js_d2, js_d3, js_d4
+  WHERE f.d1 = js_d1.id AND f.d2 = js_d2.id AND f.d3 = js_d3.id
+    AND f.d4 = js_d4.id AND js_d1.grp = 0;
+SELECT count(*) FROM js_fact f
+  JOIN js_d1 ON f.d1 = js_d1.id
+  JOIN js_d2 ON f.d2 = js_d2.id
+  LEFT JOIN js_d3 ON f.d3 = js_d3.id
+  JOIN js_d4 ON f.d4 = js_d4.id
+  WHERE js_d1.grp = 0;
+SELECT count(*) FROM js_fact f, js_d1, js_d2
+  WHERE f.d1 = js_d1.id AND f.d2 = js_d2.id AND js_d1.grp = 0
+    AND EXISTS (SELECT 1 FROM js_d3 WHERE js_d3.id = f.d3);
+SELECT count(*) FROM js_d1, js_d3 WHERE js_d1.grp = 0;
+RESET greedy_join_threshold;
+DROP TABLE js_fact, js_d1, js_d2, js_d3, js_d4;
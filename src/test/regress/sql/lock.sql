@@ -113,6 +113,29 @@ LOCK TABLE ONLY lock_tbl1;
 ROLLBACK;
 RESET ROLE;
 
+--
+-- Fast-path locks beyond the first group of 16
+--
+CREATE TABLE lock_fp (a int) PARTITION BY HASH (a);
+DO $$
+BEGIN
+  FOR i IN 0..39 LOOP
+    EXECUTE format('CREATE TABLE lock_fp_%s PARTITION OF lock_fp '
+                   'FOR VALUES WITH (MODULUS 40, REMAINDER %s)', i, i);
+  END LOOP;
+END $$;
+BEGIN;
+SELECT count(*) FROM lock_fp;
+-- a few may miss the fast path if their group fills up
+SELECT count(*) AS locked, count(*) FILTER (WHERE fastpath) > 16 AS fastpath
+  FROM pg_locks
+ WHERE pid = pg_backend_pid() AND locktype = 'relation' AND
+       relation IN (SELECT oid FROM pg_class WHERE relname LIKE 'lock\_fp%');
+COMMIT;
+SELECT count(*) FROM pg_locks
+ WHERE pid = pg_backend_pid() AND locktype = 'relation' AND
+       relation IN (SELECT oid FROM pg_class WHERE relname LIKE 'lock\_fp%');
+
 --
 -- Clean up
 --
@@ -126,6 +149,7 @@ DROP TABLE lock_tbl3;
 DROP TABLE lock_tbl2;
 DROP TABLE lock_tbl1;
 DROP TABLE lock_tbl1a;
+DROP TABLE lock_fp;
 DROP SCHEMA lock_schema1 CASCADE;
 DROP ROLE regress_rol_lock1;
 
@@ -1198,3 +1198,52 @@ explain (costs off) select * from hp_contradict_test where a === 1 and b === 1 a
 drop table hp_contradict_test;
 drop operator class part_test_int4_ops2 using hash;
 drop operator ===(int4, int4);
+
+--
+-- Run-time pruning of the outer side of a hash join, using the range of the
+-- inner join keys collected while building the hash table
+--
+-- Hash memory usage is platform-dependent, so filter it out.
+create function explain_hashjoin_prune(text) returns setof text
+language plpgsql as
+$$
+declare
+    ln text;
+begin
+    for ln in
+        execute format('explain (analyze, costs off, summary off, timing off) %s',
+            $1)
+    loop
+        if ln like '%Buckets:%' then
+            continue;
+        end if;
+        return next ln;
+    end loop;
+end;
+$$;
+
+create table hjp (a int, b int) partition by range (a);
+create table hjp_1 partition of hjp for values from (0) to (10);
+create table hjp_2 partition of hjp for values from (10) to (20);
+create table hjp_3 partition of hjp for values from (20) to (30);
+insert into hjp select i % 30, i from generate_series(0, 2999) i;
+create table hjp_dim (k int, tag text);
+insert into hjp_dim values (12, 'x'), (15, 'x'), (25, 'y');
+analyze hjp, hjp_dim;
+
+-- Earlier tests left hash joins disabled
+reset enable_hashjoin;
+set enable_nestloop = off;
+set enable_mergejoin = off;
+
+-- Only hjp_2 can contain the keys 12 and 15
+select explain_hashjoin_prune('select count(*) from hjp f join hjp_dim d on f.a = d.k where d.tag = ''x''');
+select count(*) from hjp f join hjp_dim d on f.a = d.k where d.tag = 'x';
+
+-- No pruning when unmatched outer rows are needed
+select explain_hashjoin_prune('select count(*) from hjp f left join hjp_dim d on f.a = d.k and d.tag = ''x''');
+
+reset enable_nestloop;
+reset enable_mergejoin;
+drop table hjp, hjp_dim;
+drop function explain_hashjoin_prune(text);
@@ -64,6 +64,31 @@ explain (costs off)
 	from part_pa_test pa2;
 drop table part_pa_test;
 
+-- Parallel Append over partial subplans of very different sizes
+create table part_pa_uneven(p int, b int) partition by list(p);
+create table part_pa_uneven_1 partition of part_pa_uneven for values in (1);
+create table part_pa_uneven_2 partition of part_pa_uneven for values in (2);
+create table part_pa_uneven_3 partition of part_pa_uneven for values in (3);
+create table part_pa_uneven_4 partition of part_pa_uneven for values in (4);
+insert into part_pa_uneven select 1, g from generate_series(1, 20000) g;
+insert into part_pa_uneven select 2, g from generate_series(1, 2000) g;
+insert into part_pa_uneven select 3, g from generate_series(1, 200) g;
+insert into part_pa_uneven select 4, g from generate_series(1, 20) g;
+analyze part_pa_uneven;
+explain (costs off)
+  select count(*), sum(b) from part_pa_uneven;
+select count(*), sum(b) from part_pa_uneven;
+set enable_partitionwise_aggregate = on;
+explain (costs off)
+  select p, count(*), sum(b) from part_pa_uneven group by p order by p;
+select p, count(*), sum(b) from part_pa_uneven group by p order by p;
+set parallel_leader_participation = off;
+select count(*), sum(b) from part_pa_uneven;
+select p, count(*), sum(b) from part_pa_uneven group by p order by p;
+reset parallel_leader_participation;
+reset enable_partitionwise_aggregate;
+drop table part_pa_uneven;
+
 -- test with leader participation disabled
 set parallel_leader_participation = off;
 explain (costs off)
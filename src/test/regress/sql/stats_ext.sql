@@ -492,6 +492,97 @@ SELECT * FROM check_estimated_rows('SELECT * FROM mcv_lists_bool WHERE NOT a AND
 
 SELECT * FROM check_estimated_rows('SELECT * FROM mcv_lists_bool WHERE NOT a AND b AND NOT c');
 
+-- histograms
+CREATE TABLE histograms (
+    a INT,
+    b INT,
+    c INT
+)
+WITH (autovacuum_enabled = off);
+
+-- perfectly correlated (a, b) and anti-correlated (a, c) columns
+INSERT INTO histograms (a, b, c)
+     SELECT i, i, 10001 - i FROM generate_series(1,10000) s(i);
+
+ANALYZE histograms;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms WHERE a < 1000 AND b < 1000');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms WHERE a < 5000 AND c < 5000');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms WHERE a > 2500 AND b < 3500 AND c >= 7000');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms WHERE a >= 1234 AND b < 4321');
+
+-- create statistics
+CREATE STATISTICS histograms_stats (histogram) ON a, b, c FROM histograms;
+
+ANALYZE histograms;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms WHERE a < 1000 AND b < 1000');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms WHERE a < 5000 AND c < 5000');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms WHERE a > 2500 AND b < 3500 AND c >= 7000');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms WHERE a >= 1234 AND b < 4321');
+
+-- check change of column type resets the histogram
+ALTER TABLE histograms ALTER COLUMN c TYPE numeric;
+SELECT d.stxdhistogram IS NULL
+  FROM pg_statistic_ext s, pg_statistic_ext_data d
+ WHERE s.stxname = 'histograms_stats'
+   AND d.stxoid = s.oid;
+
+DROP TABLE histograms;
+
+-- histograms on expressions
+CREATE TABLE histograms_exprs (
+    a INT,
+    b INT,
+    c INT
+)
+WITH (autovacuum_enabled = off);
+
+INSERT INTO histograms_exprs (a, b, c)
+     SELECT mod(i,100), mod(i,100), mod(i,100) FROM generate_series(1,10000) s(i);
+
+ANALYZE histograms_exprs;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms_exprs WHERE (a * b) > 9000');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms_exprs WHERE (a * b) < 2500 AND c < 50');
+
+-- only histograms are supported on expressions, and built by default
+CREATE STATISTICS histograms_exprs_stats (mcv) ON (a * b), c FROM histograms_exprs;
+CREATE STATISTICS histograms_exprs_stats ON (a * b), c FROM histograms_exprs;
+
+ANALYZE histograms_exprs;
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms_exprs WHERE (a * b) > 9000');
+
+SELECT * FROM check_estimated_rows('SELECT * FROM histograms_exprs WHERE (a * b) < 2500 AND c < 50');
+
+-- invalid expressions
+CREATE STATISTICS tst ON (a + random()), c FROM histograms_exprs;
+CREATE STATISTICS tst ON point(a, b), c FROM histograms_exprs;
+CREATE STATISTICS tst ON (a * b), (a * b) FROM histograms_exprs;
+CREATE STATISTICS tst ON (ctid::text), c FROM histograms_exprs;
+
+SELECT pg_get_statisticsobjdef(oid) FROM pg_statistic_ext WHERE stxname = 'histograms_exprs_stats';
+\d histograms_exprs
+
+-- the expressions are cloned by LIKE
+CREATE TABLE histograms_exprs_like (LIKE histograms_exprs INCLUDING STATISTICS);
+\d histograms_exprs_like
+
+-- columns used in the expressions can't change their type
+ALTER TABLE histograms_exprs ALTER COLUMN a TYPE numeric;
+ALTER TABLE histograms_exprs ALTER COLUMN c TYPE numeric;
+
+DROP TABLE histograms_exprs_like;
+DROP TABLE histograms_exprs;
+
 -- Permission tests. Users should not be able to see specific data values in
 -- the extended statistics, if they lack permission to see those values in
 -- the underlying table.
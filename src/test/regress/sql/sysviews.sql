@@ -32,6 +32,14 @@ select count(*) = 0 as ok from pg_prepared_statements;
 -- See also prepared_xacts.sql
 select count(*) >= 0 as ok from pg_prepared_xacts;
 
+-- LWLock statistics are only collected while track_lwlock_stats is on,
+-- but any query takes plenty of buffer content locks
+set track_lwlock_stats = on;
+select count(*) > 0 as ok from pg_class;
+select sum(acquires) > 0 as ok, sum(contended) <= sum(acquires) as ok2
+  from pg_stat_lwlocks;
+reset track_lwlock_stats;
+
 -- This is to record the prevailing planner enable_foo settings during
 -- a regression test run.
 select name, setting from pg_settings where name like 'enable%';
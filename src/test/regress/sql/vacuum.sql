@@ -121,6 +121,55 @@ SELECT pg_relation_size('vac_truncate_test') = 0;
 VACUUM (TRUNCATE FALSE, FULL TRUE) vac_truncate_test;
 DROP TABLE vac_truncate_test;
 
+-- PARALLEL option
+CREATE TABLE pvactst (i INT, a INT[], p POINT) with (autovacuum_enabled = off);
+INSERT INTO pvactst SELECT i, array[1,2,3], point(i, i+1) FROM generate_series(1,1000) i;
+CREATE INDEX btree_pvactst ON pvactst USING btree (i);
+CREATE INDEX hash_pvactst ON pvactst USING hash (i);
+CREATE INDEX brin_pvactst ON pvactst USING brin (i);
+CREATE INDEX gin_pvactst ON pvactst USING gin (a);
+CREATE INDEX gist_pvactst ON pvactst USING gist (p);
+CREATE INDEX spgist_pvactst ON pvactst USING spgist (p);
+-- VACUUM invokes parallel index cleanup
+SET min_parallel_index_scan_size to 0;
+VACUUM (PARALLEL 2) pvactst;
+-- VACUUM invokes parallel bulk-deletion
+UPDATE pvactst SET i = i WHERE i < 1000;
+VACUUM (PARALLEL 2) pvactst;
+UPDATE pvactst SET i = i WHERE i < 1000;
+VACUUM (PARALLEL 0) pvactst; -- disable parallel vacuum
+SELECT count(*) FROM pvactst WHERE i = 500;
+VACUUM (PARALLEL -1) pvactst; -- error
+VACUUM (PARALLEL 2, INDEX_CLEANUP FALSE) pvactst;
+VACUUM (PARALLEL 2, FULL TRUE) pvactst; -- error, cannot use both PARALLEL and FULL
+VACUUM (PARALLEL) pvactst; -- error, cannot use PARALLEL option without parallel degree
+CREATE TEMPORARY TABLE tmp (a int PRIMARY KEY);
+CREATE INDEX tmp_idx1 ON tmp (a);
+VACUUM (PARALLEL 1) tmp; -- disables parallel vacuum option
+-- VACUUM scans the heap in parallel
+SET min_parallel_table_scan_size TO 0;
+CREATE TABLE pvacheap (i INT, t TEXT) WITH (autovacuum_enabled = off);
+INSERT INTO pvacheap SELECT i, repeat('x', 100) FROM generate_series(1, 20000) i;
+CREATE INDEX pvacheap_i ON pvacheap (i);
+DELETE FROM pvacheap WHERE i % 3 = 0;
+VACUUM (PARALLEL 2) pvacheap;
+SELECT reltuples FROM pg_class WHERE oid = 'pvacheap'::regclass;
+DELETE FROM pvacheap WHERE i % 3 = 1;
+VACUUM (PARALLEL 2, FREEZE, DISABLE_PAGE_SKIPPING) pvacheap;
+SELECT reltuples FROM pg_class WHERE oid = 'pvacheap'::regclass;
+SET enable_seqscan TO off;
+SELECT count(*) FROM pvacheap WHERE i BETWEEN 1 AND 20000;
+RESET enable_seqscan;
+DROP INDEX pvacheap_i;
+DELETE FROM pvacheap WHERE i % 3 = 2;
+VACUUM (PARALLEL 2) pvacheap;
+SELECT reltuples FROM pg_class WHERE oid = 'pvacheap'::regclass;
+RESET min_parallel_table_scan_size;
+RESET min_parallel_index_scan_size;
+DROP TABLE pvactst;
+DROP TABLE pvacheap;
+DROP TABLE tmp;
+
 -- partitioned table
 CREATE TABLE vacparted (a int, b char) PARTITION BY LIST (a);
 CREATE TABLE vacparted1 PARTITION OF vacparted FOR VALUES IN (1);
@@ -0,0 +1,137 @@
+# Test applying transactions in parallel apply workers
+use strict;
+use warnings;
+use PostgresNode;
+use TestLib;
+use Test::More tests => 5;
+
+# Create publisher node
+my $node_publisher = get_new_node('publisher');
+$node_publisher->init(allows_streaming => 'logical');
+$node_publisher->start;
+
+# Create subscriber node
+my $node_subscriber = get_new_node('subscriber');
+$node_subscriber->init(allows_streaming => 'logical');
+$node_subscriber->append_conf('postgresql.conf',
+	'max_parallel_apply_workers_per_subscription = 2');
+$node_subscriber->start;
+
+# Create some preexisting content on publisher
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE test_tab (a int primary key, b text)");
+$node_publisher->safe_psql('postgres',
+	"CREATE TABLE test_trig (a int primary key, b int)");
+$node_publisher->safe_psql('postgres',
+	"INSERT INTO test_tab VALUES (1, 'foo'), (2, 'bar')");
+
+# Setup structure on subscriber, with a trigger making test_trig serialized
+$node_subscriber->safe_psql('postgres',
+	"CREATE TABLE test_tab (a int primary key, b text)");
+$node_subscriber->safe_psql(
+	'postgres', q{
+CREATE TABLE test_trig (a int primary key, b int);
+CREATE TABLE test_trig_log (a int, b int);
+CREATE FUNCTION test_trig_fn() RETURNS trigger LANGUAGE plpgsql AS $$
+BEGIN
+  INSERT INTO public.test_trig_log VALUES (NEW.a, NEW.b);
+  RETURN NEW;
+END $$;
+CREATE TRIGGER test_trig_trg BEFORE INSERT OR UPDATE ON test_trig
+  FOR EACH ROW EXECUTE PROCEDURE test_trig_fn();
+ALTER TABLE test_trig ENABLE REPLICA TRIGGER test_trig_trg;
+});
+
+# Setup logical replication
+my $publisher_connstr = $node_publisher->connstr . ' dbname=postgres';
+$node_publisher->safe_psql('postgres',
+	"CREATE PUBLICATION tap_pub FOR TABLE test_tab, test_trig");
+
+my $appname = 'tap_sub';
+$node_subscriber->safe_psql('postgres',
+	"CREATE SUBSCRIPTION tap_sub CONNECTION '$publisher_connstr application_name=$appname' PUBLICATION tap_pub"
+);
+
+$node_publisher->wait_for_catchup($appname);
+
+# Also wait for initial table sync to finish
+my $synced_query =
+  "SELECT count(1) = 0 FROM pg_subscription_rel WHERE srsubstate NOT IN ('r', 's');";
+$node_subscriber->poll_query_until('postgres', $synced_query)
+  or die "Timed out while waiting for subscriber to synchronize data";
+
+my $result =
+  $node_subscriber->safe_psql('postgres', "SELECT count(*) FROM test_tab");
+is($result, qq(2), 'check initial data was copied to subscriber');
+
+# Many small transactions, some of them changing the same rows, must end up
+# in the state they have on the publisher.
+$node_publisher->safe_psql(
+	'postgres', q{
+DO $$
+BEGIN
+  FOR i IN 3..500 LOOP
+    INSERT INTO test_tab VALUES (i, md5(i::text));
+    COMMIT;
+    UPDATE test_tab SET b = b || 'x' WHERE a = mod(i, 10) + 1;
+    COMMIT;
+    IF mod(i, 7) = 0 THEN
+      DELETE FROM test_tab WHERE a = i - 1;
+      COMMIT;
+    END IF;
+  END LOOP;
+END $$;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+my $expected = $node_publisher->safe_psql('postgres',
+	"SELECT count(*), md5(string_agg(a || b, ',' ORDER BY a)) FROM test_tab");
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), md5(string_agg(a || b, ',' ORDER BY a)) FROM test_tab");
+is($result, $expected, 'check transactions were applied in parallel');
+
+my $logfile = slurp_file($node_subscriber->logfile());
+ok( $logfile =~
+	  qr/logical replication parallel apply worker for subscription "tap_sub" has started/,
+	'check parallel apply workers were started');
+
+# Changes to a relation with triggers are applied in commit order.
+$node_publisher->safe_psql(
+	'postgres', q{
+DO $$
+BEGIN
+  FOR i IN 1..100 LOOP
+    INSERT INTO test_trig VALUES (i, i);
+    COMMIT;
+  END LOOP;
+END $$;
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), bool_and(a = b), (SELECT count(*) FROM test_trig_log) FROM test_trig"
+);
+is($result, qq(100|t|100),
+	'check changes to relation with triggers were applied');
+
+# TRUNCATE waits for the preceding transactions.
+$node_publisher->safe_psql(
+	'postgres', q{
+INSERT INTO test_tab VALUES (1001, 'a');
+TRUNCATE test_tab;
+INSERT INTO test_tab VALUES (1002, 'b');
+});
+
+$node_publisher->wait_for_catchup($appname);
+
+$result = $node_subscriber->safe_psql('postgres',
+	"SELECT count(*), min(a) FROM test_tab");
+is($result, qq(1|1002), 'check truncate was applied in order');
+
+$node_subscriber->safe_psql('postgres', "DROP SUBSCRIPTION tap_sub");
+$node_publisher->safe_psql('postgres', "DROP PUBLICATION tap_pub");
+
+$node_subscriber->stop;
+$node_publisher->stop;
@@ -0,0 +1,4 @@
+-- Look rows up by the indexed column that isn't the partition key, so no
+-- partition can be pruned, and every partition and index is locked.
+\set val random(0, 999)
+SELECT id FROM fastpath_bench WHERE val = :val;
@@ -0,0 +1,20 @@
+#!/bin/sh
+
+# Measure the throughput of lookup.sql against the number of partitions.
+# Connection settings come from the usual PG* environment variables.
+#
+# usage: run.sh [clients [seconds]]
+
+dir=`dirname "$0"`
+clients=${1:-8}
+seconds=${2:-30}
+
+echo "partitions tps"
+for partitions in 1 2 4 8 16 32 64 128 256 512 1024
+do
+	psql -X -q -v ON_ERROR_STOP=1 -v partitions=$partitions \
+		-f "$dir/setup.sql" >/dev/null || exit 1
+	tps=`pgbench -n -c $clients -j $clients -T $seconds -f "$dir/lookup.sql" |
+		sed -n 's/^tps = \([0-9.]*\) (excluding.*/\1/p'`
+	echo "$partitions $tps"
+done
@@ -0,0 +1,15 @@
+--
+-- Create the hash-partitioned table used by lookup.sql, with an index on a
+-- column other than the partition key.  Set the number of partitions with
+--
+--	psql -v partitions=N -f setup.sql
+--
+DROP TABLE IF EXISTS fastpath_bench;
+CREATE TABLE fastpath_bench (id int, val int) PARTITION BY HASH (id);
+SELECT format('CREATE TABLE fastpath_bench_%s PARTITION OF fastpath_bench '
+			  'FOR VALUES WITH (MODULUS %s, REMAINDER %s)', i, :partitions, i)
+  FROM generate_series(0, :partitions - 1) i
+\gexec
+CREATE INDEX ON fastpath_bench (val);
+INSERT INTO fastpath_bench SELECT i, i % 1000 FROM generate_series(1, 100000) i;
+VACUUM ANALYZE fastpath_bench;